@@ -0,0 +1,310 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * port/posix/posix_flash_mmap.c
+ *
+ * Flash on a POSIX-based simulator using a memory mapped file
+ */
+
+#include <stddef.h>     /* For NULL */
+#include <fcntl.h>      /* For O_xxxx */
+#include <sys/types.h>  /* For off_t */
+#include <sys/stat.h>   /* For fstat */
+#include <sys/mman.h>   /* For mmap, msync, munmap */
+#include <unistd.h>     /* For close, ftruncate */
+#include <string.h>     /* For memset, memcpy, memcmp */
+
+#include "wolfhsm/wh_error.h"
+#include "wolfhsm/wh_flash.h"
+
+#include "posix_flash_mmap.h"
+
+/** Local declarations */
+#define MAX_OFFSET(_context) (_context->partition_size * 2)
+
+/* Check the context is mapped and the range lies within it */
+static int pfmCheckRange(posixFlashMmapContext* context, uint32_t offset,
+        uint32_t size);
+
+/** Local implementations */
+static int pfmCheckRange(posixFlashMmapContext* context, uint32_t offset,
+        uint32_t size)
+{
+    if (    (context == NULL) ||
+            (context->ptr == NULL) ||
+            (size > MAX_OFFSET(context)) ||
+            (offset > MAX_OFFSET(context) - size)) {
+        return WH_ERROR_BADARGS;
+    }
+    return 0;
+}
+
+
+int posixFlashMmap_Init(void* c, const void* cf)
+{
+    posixFlashMmapContext* context = c;
+    const posixFlashMmapConfig* config = cf;
+    struct stat st = {0};
+    off_t file_size = 0;
+    void* ptr = NULL;
+
+    int ret = 0;
+    int rc = 0;
+
+    if (    (context == NULL) ||
+            (config == NULL) ||
+            (config->partition_size == 0)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    /* Open the storage backend */
+    rc = open(config->filename, O_RDWR|O_CREAT, S_IRUSR | S_IWUSR);
+    if (rc < 0) {
+        /* Failed to open initially */
+        return WH_ERROR_ABORTED;
+    }
+
+    /* File is open, setup context */
+    memset(context, 0, sizeof(*context));
+    context->fd_p1 = rc + 1;
+    context->partition_size = config->partition_size;
+    context->erased_byte = config->erased_byte;
+    context->sync = config->sync;
+
+    rc = fstat(context->fd_p1 - 1, &st);
+    if (rc == 0) {
+        file_size = st.st_size;
+        if (file_size != MAX_OFFSET(context)) {
+            /* Grow or shrink to the storage size */
+            rc = ftruncate(context->fd_p1 - 1, MAX_OFFSET(context));
+        }
+    }
+    if (rc == 0) {
+        ptr = mmap(NULL, MAX_OFFSET(context), PROT_READ | PROT_WRITE,
+                MAP_SHARED, context->fd_p1 - 1, 0);
+        if (ptr == MAP_FAILED) {
+            rc = -1;
+        } else {
+            context->ptr = ptr;
+        }
+    }
+    if (rc != 0) {
+        /* Error at some point. Clean up */
+        ret = WH_ERROR_ABORTED;
+        (void)posixFlashMmap_Cleanup(context);
+        return ret;
+    }
+
+    if (file_size < MAX_OFFSET(context)) {
+        /* Newly added space reads as erased */
+        memset(context->ptr + file_size, context->erased_byte,
+                MAX_OFFSET(context) - file_size);
+    }
+    return 0;
+}
+
+int posixFlashMmap_Cleanup(void* c)
+{
+    posixFlashMmapContext* context = c;
+
+    if (context == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    if (context->ptr != NULL) {
+        /* Ignore errors here */
+        if ((context->sync & POSIX_FLASH_MMAP_SYNC_CLEANUP) != 0) {
+            (void)msync(context->ptr, MAX_OFFSET(context), MS_SYNC);
+        }
+        (void)munmap(context->ptr, MAX_OFFSET(context));
+        context->ptr = NULL;
+    }
+    if (context->fd_p1 > 0) {
+        (void)close(context->fd_p1 - 1);
+        context->fd_p1 = 0;
+    }
+    return 0;
+}
+
+uint32_t posixFlashMmap_PartitionSize(void* c)
+{
+    posixFlashMmapContext* context = c;
+    if (context == NULL) {
+        return 0;
+    }
+    return context->partition_size;
+}
+
+int posixFlashMmap_WriteLock(void* c, uint32_t offset, uint32_t size)
+{
+    posixFlashMmapContext* context = c;
+    (void)offset; (void)size;
+
+    if (context == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+    context->unlocked = 0;
+
+    if (    (context->ptr != NULL) &&
+            ((context->sync & POSIX_FLASH_MMAP_SYNC_LOCK) != 0)) {
+        /* Programs are complete, make them durable */
+        if (msync(context->ptr, MAX_OFFSET(context), MS_SYNC) != 0) {
+            return WH_ERROR_ABORTED;
+        }
+    }
+    return 0;
+}
+
+int posixFlashMmap_WriteUnlock(void* c, uint32_t offset, uint32_t size)
+{
+    posixFlashMmapContext* context = c;
+    (void)offset; (void)size;
+
+    if (context == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+    context->unlocked = 1;
+    return 0;
+}
+
+int posixFlashMmap_Read(void* c, uint32_t offset, uint32_t size,
+        uint8_t* data)
+{
+    posixFlashMmapContext* context = c;
+    int ret = pfmCheckRange(context, offset, size);
+
+    if (ret != 0) {
+        return ret;
+    }
+
+    if (    (data == NULL) ||
+            (size == 0)) {
+        /* No need to read */
+        return 0;
+    }
+
+    memcpy(data, context->ptr + offset, size);
+    return 0;
+}
+
+int posixFlashMmap_Program(void* c, uint32_t offset, uint32_t size,
+        const uint8_t* data)
+{
+    posixFlashMmapContext* context = c;
+    int ret = pfmCheckRange(context, offset, size);
+
+    if (ret != 0) {
+        return ret;
+    }
+
+    if (    (data == NULL) ||
+            (size == 0)) {
+        /* No need to write */
+        return 0;
+    }
+
+    if (!context->unlocked) {
+        /* Programming is locked */
+        return WH_ERROR_LOCKED;
+    }
+
+    memcpy(context->ptr + offset, data, size);
+    return 0;
+}
+
+int posixFlashMmap_Verify(void* c, uint32_t offset, uint32_t size,
+        const uint8_t* data)
+{
+    posixFlashMmapContext* context = c;
+    int ret = pfmCheckRange(context, offset, size);
+
+    if (ret != 0) {
+        return ret;
+    }
+
+    if (    (data == NULL) ||
+            (size == 0)) {
+        /* No need to verify */
+        return 0;
+    }
+
+    if (memcmp(context->ptr + offset, data, size) != 0) {
+        return WH_ERROR_NOTVERIFIED;
+    }
+    return 0;
+}
+
+int posixFlashMmap_Erase(void* c, uint32_t offset, uint32_t size)
+{
+    posixFlashMmapContext* context = c;
+    int ret = pfmCheckRange(context, offset, size);
+
+    if (ret != 0) {
+        return ret;
+    }
+
+    if (size == 0) {
+        /* No need to erase */
+        return 0;
+    }
+
+    if (!context->unlocked) {
+        /* Erasing is locked */
+        return WH_ERROR_LOCKED;
+    }
+
+    memset(context->ptr + offset, context->erased_byte, size);
+    return 0;
+}
+
+int posixFlashMmap_BlankCheck(void* c, uint32_t offset, uint32_t size)
+{
+    posixFlashMmapContext* context = c;
+    const uint8_t* p = NULL;
+    uint32_t i = 0;
+    int ret = pfmCheckRange(context, offset, size);
+
+    if (ret != 0) {
+        return ret;
+    }
+
+    p = context->ptr + offset;
+    for (i = 0; i < size; i++) {
+        if (p[i] != context->erased_byte) {
+            /* Didn't match.  Early return */
+            return WH_ERROR_NOTBLANK;
+        }
+    }
+    return 0;
+}
+
+int posixFlashMmap_Map(void* c, uint32_t offset, uint32_t size,
+        const uint8_t** out_ptr)
+{
+    posixFlashMmapContext* context = c;
+    int ret = pfmCheckRange(context, offset, size);
+
+    if ((ret == 0) && (out_ptr == NULL)) {
+        ret = WH_ERROR_BADARGS;
+    }
+    if (ret == 0) {
+        *out_ptr = context->ptr + offset;
+    }
+    return ret;
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * port/posix/posix_flash_mmap.h
+ */
+
+#ifndef PORT_POSIX_POSIX_FLASH_MMAP_H_
+#define PORT_POSIX_POSIX_FLASH_MMAP_H_
+
+/*
+ * This POSIX flash simulator has the same layout and semantics as
+ * posix_flash_file, two partitions of partition_size bytes in a single file,
+ * but maps the file into memory.  Reads, programs, verifies and blank checks
+ * are memory operations with no system calls.  The mapping is shared, so the
+ * file holds the contents once the kernel writes them back, or immediately
+ * when sync requests an msync on write lock or cleanup.
+ */
+
+#include <stdint.h>
+
+#include "wolfhsm/wh_flash.h"
+
+/* msync points, combined in posixFlashMmapConfig.sync */
+#define POSIX_FLASH_MMAP_SYNC_NONE      0x00
+#define POSIX_FLASH_MMAP_SYNC_LOCK      0x01    /* On WriteLock */
+#define POSIX_FLASH_MMAP_SYNC_CLEANUP   0x02    /* On Cleanup */
+
+/* In memory context structure associated with a flash instance */
+typedef struct posixFlashMmapContext_t {
+    uint8_t* ptr;           /* Mapped file, NULL when not mapped */
+    int fd_p1;              /* fd + 1, so fd == 0 is invalid */
+    int unlocked;
+    uint32_t partition_size;
+    uint8_t erased_byte;
+    uint8_t sync;
+    uint8_t padding[2];
+} posixFlashMmapContext;
+
+/* In memory configuration structure associated with an NVM instance */
+typedef struct posixFlashMmapConfig_t {
+    const char* filename;       /* Null terminated */
+    uint32_t partition_size;
+    uint8_t erased_byte;
+    uint8_t sync;               /* POSIX_FLASH_MMAP_SYNC_* */
+    uint8_t padding[2];
+} posixFlashMmapConfig;
+
+int posixFlashMmap_Init(void* c, const void* cf);
+int posixFlashMmap_Cleanup(void* c);
+uint32_t posixFlashMmap_PartitionSize(void* c);
+int posixFlashMmap_WriteLock(void* c, uint32_t offset, uint32_t size);
+int posixFlashMmap_WriteUnlock(void* c, uint32_t offset, uint32_t size);
+int posixFlashMmap_Read(void* c, uint32_t offset, uint32_t size, uint8_t* data);
+int posixFlashMmap_Program(void* c, uint32_t offset, uint32_t size,
+        const uint8_t* data);
+int posixFlashMmap_Erase(void* c, uint32_t offset, uint32_t size);
+int posixFlashMmap_Verify(void* c, uint32_t offset, uint32_t size,
+        const uint8_t* data);
+int posixFlashMmap_BlankCheck(void* c, uint32_t offset, uint32_t size);
+int posixFlashMmap_Map(void* c, uint32_t offset, uint32_t size,
+        const uint8_t** out_ptr);
+
+#define POSIX_FLASH_MMAP_CB                         \
+{                                                   \
+    .Init = posixFlashMmap_Init,                    \
+    .Cleanup = posixFlashMmap_Cleanup,              \
+    .PartitionSize = posixFlashMmap_PartitionSize,  \
+    .WriteLock = posixFlashMmap_WriteLock,          \
+    .WriteUnlock = posixFlashMmap_WriteUnlock,      \
+    .Read = posixFlashMmap_Read,                    \
+    .Program = posixFlashMmap_Program,              \
+    .Erase = posixFlashMmap_Erase,                  \
+    .Verify = posixFlashMmap_Verify,                \
+    .BlankCheck = posixFlashMmap_BlankCheck,        \
+    .Map = posixFlashMmap_Map,                      \
+}
+
+#endif /* PORT_POSIX_POSIX_FLASH_MMAP_H_ */
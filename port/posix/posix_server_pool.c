@@ -0,0 +1,195 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * port/posix/posix_server_pool.c
+ *
+ * Implementation of a pthread server worker pool
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sched.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "wolfhsm/wh_error.h"
+#include "wolfhsm/wh_comm.h"
+#include "wolfhsm/wh_server.h"
+#include "port/posix/posix_server_pool.h"
+
+/** Local declarations */
+
+/* Handle requests until the pool is stopped or a request fails */
+static void* posixServerPool_Worker(void* arg);
+
+/** Local implementations */
+static void* posixServerPool_Worker(void* arg)
+{
+    posixServerPoolWorker* worker = (posixServerPoolWorker*)arg;
+    posixServerPool* pool = worker->pool;
+    int rc = 0;
+
+    while (pool->stop == 0) {
+        rc = wh_Server_HandleRequestMessage(worker->server);
+        if (rc == WH_ERROR_NOTREADY) {
+            rc = 0;
+            if (pool->idle_us != 0) {
+                (void)usleep(pool->idle_us);
+            } else {
+                (void)sched_yield();
+            }
+        } else if (rc != 0) {
+            break;
+        }
+    }
+    worker->rc = rc;
+    return NULL;
+}
+
+/** Pool functions */
+int posixServerPool_Init(posixServerPool* pool)
+{
+    if (pool == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    memset(pool, 0, sizeof(*pool));
+    if (pthread_mutex_init(&pool->nvm_lock, NULL) != 0) {
+        return WH_ERROR_ABORTED;
+    }
+    pool->initialized = 1;
+    return 0;
+}
+
+int posixServerPool_Start(posixServerPool* pool,
+        const posixServerPoolConfig* config)
+{
+    int rc = 0;
+    uint16_t i = 0;
+
+    if (    (pool == NULL) ||
+            (pool->initialized == 0) ||
+            (config == NULL) ||
+            (config->server_config == NULL) ||
+            (config->worker_count == 0) ||
+            (config->worker_count > PSP_MAX_WORKERS)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    pool->stop = 0;
+    pool->idle_us = config->idle_us;
+    pool->worker_count = 0;
+
+    for (i = 0; i < config->worker_count; i++) {
+        posixServerPoolWorker* worker = &pool->worker[i];
+
+        memset(worker, 0, sizeof(*worker));
+        worker->pool = pool;
+        rc = wh_Server_Init(worker->server, &config->server_config[i]);
+        if (rc != 0) {
+            break;
+        }
+        pool->worker_count++;
+
+        /* Endpoints are polled from the start, as in a single server loop */
+        (void)wh_Server_SetConnected(worker->server, WH_COMM_CONNECTED);
+        if (pthread_create(&worker->thread, NULL, posixServerPool_Worker,
+                worker) != 0) {
+            rc = WH_ERROR_ABORTED;
+            break;
+        }
+        worker->started = 1;
+    }
+
+    if (rc != 0) {
+        (void)posixServerPool_Stop(pool);
+    }
+    return rc;
+}
+
+int posixServerPool_Stop(posixServerPool* pool)
+{
+    int rc = 0;
+    uint16_t i = 0;
+
+    if (pool == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    pool->stop = 1;
+    for (i = 0; i < pool->worker_count; i++) {
+        posixServerPoolWorker* worker = &pool->worker[i];
+
+        if (worker->started != 0) {
+            (void)pthread_join(worker->thread, NULL);
+            worker->started = 0;
+            if (rc == 0) {
+                rc = worker->rc;
+            }
+        }
+        (void)wh_Server_Cleanup(worker->server);
+    }
+    pool->worker_count = 0;
+    return rc;
+}
+
+int posixServerPool_Cleanup(posixServerPool* pool)
+{
+    if (    (pool == NULL) ||
+            (pool->worker_count != 0)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    if (pool->initialized != 0) {
+        (void)pthread_mutex_destroy(&pool->nvm_lock);
+        pool->initialized = 0;
+    }
+    return 0;
+}
+
+int posixServerPool_NvmLock(void* context)
+{
+    posixServerPool* pool = (posixServerPool*)context;
+
+    if (    (pool == NULL) ||
+            (pool->initialized == 0)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    if (pthread_mutex_lock(&pool->nvm_lock) != 0) {
+        return WH_ERROR_ABORTED;
+    }
+    return 0;
+}
+
+int posixServerPool_NvmUnlock(void* context)
+{
+    posixServerPool* pool = (posixServerPool*)context;
+
+    if (    (pool == NULL) ||
+            (pool->initialized == 0)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    if (pthread_mutex_unlock(&pool->nvm_lock) != 0) {
+        return WH_ERROR_ABORTED;
+    }
+    return 0;
+}
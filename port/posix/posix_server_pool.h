@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * port/posix/posix_server_pool.h
+ *
+ * Pool of server worker threads sharing one NVM instance
+ */
+
+#ifndef PORT_POSIX_POSIX_SERVER_POOL_H_
+#define PORT_POSIX_POSIX_SERVER_POOL_H_
+
+/* Each worker owns a complete whServerContext, including its own crypto
+ * context, key cache and comm endpoints, and runs its own
+ * wh_Server_HandleRequestMessage loop.  Requests on endpoints owned by
+ * different workers are handled in parallel.  The shared NVM is serialized by
+ * the pool mutex through the NVM lock hooks.
+ *
+ * Keys cached in RAM are private to the worker that owns the client's
+ * endpoint, so assign each client to exactly one worker.  Committed keys are
+ * visible to every worker through NVM.
+ *
+ * Example usage:
+ *
+ * posixServerPool pool[1] = {0};
+ * whNvmLockCb nlcb[1] = {PSP_NVM_LOCK_CB};
+ * whNvmConfig n_conf[1] = {{
+ *      .cb = nfcb,
+ *      .context = nfc,
+ *      .config = nf_conf,
+ *      .lock_cb = nlcb,
+ *      .lock_context = pool,
+ * }};
+ *
+ * whServerConfig s_conf[2] = {
+ *      {.comm_config = cs_conf0, .nvm = nvm, .crypto = crypto0},
+ *      {.comm_config = cs_conf1, .nvm = nvm, .crypto = crypto1},
+ * };
+ * posixServerPoolConfig psp_conf[1] = {{
+ *      .server_config = s_conf,
+ *      .worker_count = 2,
+ *      .idle_us = 100,
+ * }};
+ *
+ * posixServerPool_Init(pool);
+ * wh_Nvm_Init(nvm, n_conf);
+ * posixServerPool_Start(pool, psp_conf);
+ * ...
+ * posixServerPool_Stop(pool);
+ * posixServerPool_Cleanup(pool);
+ */
+
+#include <stdint.h>
+#include <pthread.h>
+
+#include "wolfhsm/wh_nvm.h"
+#include "wolfhsm/wh_server.h"
+
+#ifndef PSP_MAX_WORKERS
+#define PSP_MAX_WORKERS 4
+#endif
+
+typedef struct {
+    whServerConfig* server_config;  /* Array of worker_count configs */
+    uint16_t worker_count;
+    uint8_t padding[2];
+    uint32_t idle_us;               /* Sleep when idle. 0 yields instead */
+} posixServerPoolConfig;
+
+typedef struct posixServerPool_t posixServerPool;
+
+typedef struct {
+    whServerContext server[1];
+    posixServerPool* pool;
+    pthread_t thread;
+    int rc;                         /* Result of the worker loop */
+    int started;
+} posixServerPoolWorker;
+
+struct posixServerPool_t {
+    pthread_mutex_t nvm_lock;
+    posixServerPoolWorker worker[PSP_MAX_WORKERS];
+    volatile int stop;
+    int initialized;
+    uint32_t idle_us;
+    uint16_t worker_count;
+    uint8_t padding[2];
+};
+
+/* Prepare the NVM lock.  Must be called before the NVM is initialized */
+int posixServerPool_Init(posixServerPool* pool);
+
+/* Initialize each worker server and start its thread */
+int posixServerPool_Start(posixServerPool* pool,
+        const posixServerPoolConfig* config);
+
+/* Stop and join all workers, then clean up their servers.  Returns the first
+ * error reported by a worker loop */
+int posixServerPool_Stop(posixServerPool* pool);
+
+/* Release the NVM lock.  Workers must be stopped */
+int posixServerPool_Cleanup(posixServerPool* pool);
+
+/* NVM lock callbacks.  The lock context is the pool */
+int posixServerPool_NvmLock(void* context);
+int posixServerPool_NvmUnlock(void* context);
+
+#define PSP_NVM_LOCK_CB                     \
+{                                           \
+    .Lock =     posixServerPool_NvmLock,    \
+    .Unlock =   posixServerPool_NvmUnlock,  \
+}
+
+#endif /* PORT_POSIX_POSIX_SERVER_POOL_H_ */
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * port/posix/posix_transport_mem_futex.c
+ *
+ * Implementation of memory transport notify/wait hooks using Linux futexes
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "wolfhsm/wh_error.h"
+#include "wolfhsm/wh_transport_mem.h"
+#include "port/posix/posix_transport_mem_futex.h"
+
+/* Futex word covering the notify and len fields of a CSR */
+static uint32_t* posixTransportMemFutex_Word(volatile whTransportMemCsr* csr);
+
+static uint32_t* posixTransportMemFutex_Word(volatile whTransportMemCsr* csr)
+{
+    return (uint32_t*)(uintptr_t)csr;
+}
+
+int posixTransportMemFutex_Notify(void* arg, volatile whTransportMemCsr* csr)
+{
+    long rc = 0;
+    (void)arg;
+
+    if (csr == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    rc = syscall(SYS_futex, posixTransportMemFutex_Word(csr), FUTEX_WAKE,
+            1, NULL, NULL, 0);
+    if (rc < 0) {
+        return WH_ERROR_ABORTED;
+    }
+    return 0;
+}
+
+int posixTransportMemFutex_Wait(void* arg, volatile whTransportMemCsr* csr,
+        whTransportMemCsr seen)
+{
+    posixTransportMemFutexConfig* config = arg;
+    struct timespec ts = {0};
+    struct timespec* timeout = NULL;
+    uint32_t* word = NULL;
+    long rc = 0;
+
+    if (csr == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    if ((config != NULL) && (config->timeout_us != 0)) {
+        ts.tv_sec = config->timeout_us / 1000000;
+        ts.tv_nsec = (config->timeout_us % 1000000) * 1000;
+        timeout = &ts;
+    }
+
+    /* Sleeps only if notify and len still match what the caller saw */
+    word = posixTransportMemFutex_Word(&seen);
+    rc = syscall(SYS_futex, posixTransportMemFutex_Word(csr), FUTEX_WAIT,
+            *word, timeout, NULL, 0);
+    if (rc < 0) {
+        switch (errno) {
+        case EAGAIN:
+            /* Value already changed */
+            return 0;
+        case EINTR:
+        case ETIMEDOUT:
+            return WH_ERROR_NOTREADY;
+        default:
+            return WH_ERROR_ABORTED;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * port/posix/posix_transport_mem_futex.h
+ *
+ * Linux futex doorbell for the memory transport notify/wait hooks
+ */
+
+#ifndef PORT_POSIX_POSIX_TRANSPORT_MEM_FUTEX_H_
+#define PORT_POSIX_POSIX_TRANSPORT_MEM_FUTEX_H_
+
+/* Example usage:
+ *
+ * posixTransportMemFutexConfig ptmfcfg[1] = {{
+ *      .timeout_us = 10000,
+ * }};
+ *
+ * whTransportMemConfig tmcfg[1] = {{
+ *      .req = req_buffer,
+ *      .req_size = sizeof(req_buffer),
+ *      .resp = resp_buffer
+ *      .resp_size = sizeof(resp_buffer),
+ *      .notify_cb = posixTransportMemFutex_Notify,
+ *      .wait_cb = posixTransportMemFutex_Wait,
+ *      .notify_arg = ptmfcfg,
+ * }};
+ *
+ * Waits sleep on the first 32 bits of the peer CSR, which hold notify and
+ * len, so the buffers may be shared between threads or mapped between
+ * processes.  timeout_us bounds the wake-up latency if a doorbell is missed.
+ */
+
+#include <stdint.h>
+
+#include "wolfhsm/wh_transport_mem.h"
+
+/** Notify argument, shared by client and server */
+typedef struct {
+    uint32_t timeout_us;    /* 0 waits until notified */
+} posixTransportMemFutexConfig;
+
+int posixTransportMemFutex_Notify(void* arg, volatile whTransportMemCsr* csr);
+int posixTransportMemFutex_Wait(void* arg, volatile whTransportMemCsr* csr,
+        whTransportMemCsr seen);
+
+#endif /* PORT_POSIX_POSIX_TRANSPORT_MEM_FUTEX_H_ */
@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * port/posix/posix_transport_shm.c
+ *
+ * Implementation of transport callbacks using POSIX shared memory
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "wolfhsm/wh_error.h"
+#include "wolfhsm/wh_comm.h"
+#include "wolfhsm/wh_transport_mem.h"
+#include "port/posix/posix_transport_shm.h"
+
+/** Local declarations */
+
+/* Common function to open and map the shared object */
+static int posixTransportShm_Map(posixTransportShmContext* c,
+        const posixTransportShmConfig* cf);
+
+/** Local implementations */
+static int posixTransportShm_Map(posixTransportShmContext* c,
+        const posixTransportShmConfig* cf)
+{
+    int rc = 0;
+    struct stat st;
+
+    if (    (c == NULL) ||
+            (cf == NULL) ||
+            (cf->name == NULL) ||
+            (cf->req_size == 0) ||
+            ((cf->req_size % sizeof(uint64_t)) != 0) ||
+            (cf->resp_size == 0)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    memset(c, 0, sizeof(*c));
+    c->name = cf->name;
+    c->size = (size_t)cf->req_size + cf->resp_size;
+
+    rc = shm_open(cf->name, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+    if (rc < 0) {
+        return WH_ERROR_ABORTED;
+    }
+    c->fd_p1 = rc + 1;
+
+    /* Only grow a new object.  A peer may already be using it */
+    rc = fstat(c->fd_p1 - 1, &st);
+    if (    (rc == 0) &&
+            ((size_t)st.st_size < c->size)) {
+        rc = ftruncate(c->fd_p1 - 1, c->size);
+    }
+    if (rc == 0) {
+        c->ptr = mmap(NULL, c->size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                c->fd_p1 - 1, 0);
+        if (c->ptr == MAP_FAILED) {
+            c->ptr = NULL;
+            rc = -1;
+        }
+    }
+    if (rc != 0) {
+        close(c->fd_p1 - 1);
+        c->fd_p1 = 0;
+        return WH_ERROR_ABORTED;
+    }
+    return 0;
+}
+
+int posixTransportShm_InitClient(void* context, const void* config,
+        whCommSetConnectedCb connectcb, void* connectcb_arg)
+{
+    int rc = 0;
+    posixTransportShmContext* c = context;
+    const posixTransportShmConfig* cf = config;
+    whTransportMemConfig mem_cf[1] = {{0}};
+
+    rc = posixTransportShm_Map(c, cf);
+    if (rc == 0) {
+        mem_cf->req = c->ptr;
+        mem_cf->req_size = cf->req_size;
+        mem_cf->resp = (uint8_t*)c->ptr + cf->req_size;
+        mem_cf->resp_size = cf->resp_size;
+        rc = wh_TransportMem_InitClear(&c->mem, mem_cf,
+                connectcb, connectcb_arg);
+        if (rc != 0) {
+            (void)posixTransportShm_Cleanup(c);
+        }
+    }
+    return rc;
+}
+
+int posixTransportShm_InitServer(void* context, const void* config,
+        whCommSetConnectedCb connectcb, void* connectcb_arg)
+{
+    int rc = 0;
+    posixTransportShmContext* c = context;
+    const posixTransportShmConfig* cf = config;
+    whTransportMemConfig mem_cf[1] = {{0}};
+
+    rc = posixTransportShm_Map(c, cf);
+    if (rc == 0) {
+        c->owner = 1;
+        mem_cf->req = c->ptr;
+        mem_cf->req_size = cf->req_size;
+        mem_cf->resp = (uint8_t*)c->ptr + cf->req_size;
+        mem_cf->resp_size = cf->resp_size;
+        rc = wh_TransportMem_Init(&c->mem, mem_cf, connectcb, connectcb_arg);
+        if (rc != 0) {
+            (void)posixTransportShm_Cleanup(c);
+        }
+    }
+    return rc;
+}
+
+int posixTransportShm_Cleanup(void* context)
+{
+    posixTransportShmContext* c = context;
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    (void)wh_TransportMem_Cleanup(&c->mem);
+
+    if (c->ptr != NULL) {
+        (void)munmap(c->ptr, c->size);
+        c->ptr = NULL;
+    }
+    if (c->fd_p1 != 0) {
+        close(c->fd_p1 - 1);
+        c->fd_p1 = 0;
+    }
+    if (c->owner != 0) {
+        (void)shm_unlink(c->name);
+        c->owner = 0;
+    }
+
+    return 0;
+}
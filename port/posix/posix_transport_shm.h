@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * port/posix/posix_transport_shm.h
+ *
+ * wolfHSM Transport binding using POSIX shared memory between processes
+ */
+
+#ifndef PORT_POSIX_POSIX_TRANSPORT_SHM_H_
+#define PORT_POSIX_POSIX_TRANSPORT_SHM_H_
+
+/* Example usage:
+ *
+ * posixTransportShmConfig ptscfg[1] = {{
+ *      .name = "/wolfhsm",
+ *      .req_size = 4096,
+ *      .resp_size = 4096,
+ * }};
+ *
+ * wh_TransportClient_Cb ptsccb[1] = {PTS_CLIENT_CB};
+ * posixTransportShmContext ptscc[1] = {0};
+ * whCommClientConfig ccc[1] = {{
+ *      .transport_cb = ptsccb,
+ *      .transport_context = ptscc,
+ *      .transport_config = ptscfg,
+ *      .client_id = 1234,
+ * }}
+ *
+ * wh_TransportServer_Cb ptsscb[1] = {PTS_SERVER_CB};
+ * posixTransportShmContext ptssc[1] = {0};
+ * whCommServerConfig csc[1] = {{
+ *      .transport_cb = ptsscb,
+ *      .transport_context = ptssc,
+ *      .transport_config = ptscfg,
+ *      .server_id = 5678,
+ * }}
+ *
+ * Both sides shm_open the named object, creating it if needed, and map the
+ * request buffer followed by the response buffer.  The memory transport CSR
+ * protocol then runs unchanged across the processes.  The client clears the
+ * buffers on init like wh_TransportMem_InitClear, and the server unlinks the
+ * object on cleanup.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "wolfhsm/wh_comm.h"
+#include "wolfhsm/wh_transport_mem.h"
+
+/** Common configuration structure */
+typedef struct {
+    const char* name;       /* shm_open name, starting with '/' */
+    uint16_t req_size;      /* Multiple of 8 */
+    uint16_t resp_size;
+    uint8_t padding[4];
+} posixTransportShmConfig;
+
+/** Common context.  The memory transport context must be first so the
+ * wh_TransportMem callbacks can be used directly. */
+typedef struct {
+    whTransportMemContext mem;
+    void* ptr;
+    size_t size;
+    const char* name;
+    int fd_p1;              /* fd plus 1 so 0 is invalid */
+    int owner;              /* Server unlinks the object on cleanup */
+} posixTransportShmContext;
+
+int posixTransportShm_InitClient(void* context, const void* config,
+        whCommSetConnectedCb connectcb, void* connectcb_arg);
+int posixTransportShm_InitServer(void* context, const void* config,
+        whCommSetConnectedCb connectcb, void* connectcb_arg);
+int posixTransportShm_Cleanup(void* context);
+
+#define PTS_CLIENT_CB                               \
+{                                                   \
+    .Init =     posixTransportShm_InitClient,       \
+    .Send =     wh_TransportMem_SendRequest,        \
+    .SendV =    wh_TransportMem_SendRequestV,       \
+    .Recv =     wh_TransportMem_RecvResponse,       \
+    .Cleanup =  posixTransportShm_Cleanup,          \
+}
+
+#define PTS_SERVER_CB                               \
+{                                                   \
+    .Init =     posixTransportShm_InitServer,       \
+    .Recv =     wh_TransportMem_RecvRequest,        \
+    .Send =     wh_TransportMem_SendResponse,       \
+    .Cleanup =  posixTransportShm_Cleanup,          \
+}
+
+#endif /* PORT_POSIX_POSIX_TRANSPORT_SHM_H_ */
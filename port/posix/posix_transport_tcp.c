@@ -35,6 +35,7 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <poll.h>
+#include <sys/uio.h>
 
 #include "wolfhsm/wh_error.h"
 #include "wolfhsm/wh_comm.h"
@@ -49,14 +50,26 @@ static int posixTransportTcp_MakeNonBlocking(int fd);
 /* Server utility function to make a socket no linger and reuse addr */
 static int posixTransportTcp_MakeNoLinger(int sock);
 
-/* Common send/write function with a byte buffer */
+/* Common utility function to disable Nagle on a connected socket */
+static int posixTransportTcp_MakeNoDelay(int sock);
+
+/* Common send/write function.  Fragments go out in one sendmsg, and are only
+ * copied into the byte buffer to finish a partial write */
 static int posixTransportTcp_Send(int fd, uint16_t* buffer_offset,
-        uint8_t* buffer, uint16_t size, const void* data);
+        uint8_t* buffer, uint16_t iov_count, const whCommIov* iov);
 
 /* Common recv/read function with a byte buffer */
 static int posixTransportTcp_Recv(int fd, uint16_t* buffer_offset,
         uint8_t* buffer, uint16_t *out_size, void* data);
 
+/* Server utility function to create a non-blocking listening socket */
+static int posixTransportTcp_Listen(const posixTransportTcpConfig* cf,
+        struct sockaddr_in* server_addr, int backlog);
+
+/* Multi-client server utility functions to accept and drop connections */
+static void posixTransportTcp_AcceptAll(posixTransportTcpMultiServerContext* c);
+static void posixTransportTcp_Drop(posixTransportTcpConnection* conn);
+
 /** Local implementations */
 static int posixTransportTcp_MakeNonBlocking(int fd)
 {
@@ -96,32 +109,101 @@ static int posixTransportTcp_MakeNoLinger(int sock)
     return 0;
 }
 
+static int posixTransportTcp_MakeNoDelay(int sock)
+{
+    int enable = 1;
+    int rc = 0;
+
+    rc = setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+    if (rc != 0) {
+        return WH_ERROR_ABORTED;
+    }
+    return 0;
+}
+
 static int posixTransportTcp_Send(int fd, uint16_t* buffer_offset,
-        uint8_t* buffer, uint16_t size, const void* data)
+        uint8_t* buffer, uint16_t iov_count, const whCommIov* iov)
 {
     int rc = 0;
     int send_size = 0;
     uint32_t* packet_len = (uint32_t*)&(buffer[0]);
-    void* packet_data = &(buffer[sizeof(uint32_t)]);
+    uint8_t* packet_data = &(buffer[sizeof(uint32_t)]);
+    uint32_t len_prefix = 0;
+    struct iovec vec[WH_COMM_IOV_MAX_COUNT + 2];
+    struct msghdr msg;
+    size_t size = 0;
+    int i = 0;
 
     if (    (fd < 0) ||
             (buffer_offset == NULL) ||
             (buffer == NULL) ||
-            (size == 0) ||
-            (size > PTT_PACKET_MAX_SIZE) ||
-            (data == NULL) ) {
+            (iov_count == 0) ||
+            (iov_count > WH_COMM_IOV_MAX_COUNT + 1) ||
+            (iov == NULL) ) {
         return WH_ERROR_BADARGS;
     }
 
     if(*buffer_offset == 0) {
-        /* Initial write.  Copy data to buffer */
-        /* Prepend packet data with the size in network order */
-        *packet_len = htonl((uint32_t)size);
-        memcpy(packet_data, data, size);
+        for (i = 0; i < iov_count; i++) {
+            if ((iov[i].data == NULL) && (iov[i].len != 0)) {
+                return WH_ERROR_BADARGS;
+            }
+            size += iov[i].len;
+        }
+        if (    (size == 0) ||
+                (size > PTT_PACKET_MAX_SIZE)) {
+            return WH_ERROR_BADARGS;
+        }
+
+        /* Initial write.  Send the size in network order and the fragments
+         * in a single call without staging them */
+        len_prefix = htonl((uint32_t)size);
+        vec[0].iov_base = &len_prefix;
+        vec[0].iov_len = sizeof(len_prefix);
+        for (i = 0; i < iov_count; i++) {
+            vec[i + 1].iov_base = (void*)iov[i].data;
+            vec[i + 1].iov_len = iov[i].len;
+        }
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = vec;
+        msg.msg_iovlen = iov_count + 1;
         send_size = sizeof(uint32_t) + size;
+
+        rc = sendmsg(fd, &msg, MSG_NOSIGNAL);
+        if (rc < 0) {
+            switch (errno) {
+            case EAGAIN:
+            case EINTR:
+                /* Not connected yet or not enough buffer space */
+                return WH_ERROR_NOTREADY;
+
+            default:
+                /* Other error. Assume fatal. */
+                return WH_ERROR_ABORTED;
+            }
+        }
+        if (rc == send_size) {
+            /* All good */
+            return 0;
+        }
+
+        /* Incomplete write.  Stage the packet so the remainder does not
+         * depend on the caller's buffers */
+        *packet_len = len_prefix;
+        for (i = 0; i < iov_count; i++) {
+            if (iov[i].len != 0) {
+                memcpy(packet_data, iov[i].data, iov[i].len);
+                packet_data += iov[i].len;
+            }
+        }
+        *buffer_offset = rc;
+        return WH_ERROR_NOTREADY;
     }
-    int remaining_size = send_size - *buffer_offset;
 
+    /* Resuming a partial write.  Size is already in the buffer */
+    size = ntohl(*packet_len);
+    send_size = sizeof(uint32_t) + size;
+    int remaining_size = send_size - *buffer_offset;
 
     rc = send(fd, &(buffer[*buffer_offset]), remaining_size, MSG_NOSIGNAL);
 
@@ -129,7 +211,7 @@ static int posixTransportTcp_Send(int fd, uint16_t* buffer_offset,
         switch (errno) {
         case EAGAIN:
         case EINTR:
-            /* Not connected yet or not enough buffer space */
+            /* Not enough buffer space */
             return WH_ERROR_NOTREADY;
 
         default:
@@ -184,6 +266,11 @@ static int posixTransportTcp_Recv(int fd, uint16_t* buffer_offset,
                 return WH_ERROR_ABORTED;
             }
         }
+        if (rc == 0) {
+            /* Peer closed the connection */
+            *buffer_offset = 0;
+            return WH_ERROR_ABORTED;
+        }
         *buffer_offset += rc;
     }
     if(*buffer_offset < sizeof(uint32_t)) {
@@ -215,6 +302,11 @@ static int posixTransportTcp_Recv(int fd, uint16_t* buffer_offset,
             return WH_ERROR_ABORTED;
         }
     }
+    if (rc == 0) {
+        /* Peer closed the connection */
+        *buffer_offset = 0;
+        return WH_ERROR_ABORTED;
+    }
     *buffer_offset += rc;
     size_remaining -= rc;
     if (size_remaining > 0) {
@@ -232,6 +324,51 @@ static int posixTransportTcp_Recv(int fd, uint16_t* buffer_offset,
     return 0;
 }
 
+static int posixTransportTcp_Listen(const posixTransportTcpConfig* cf,
+        struct sockaddr_in* server_addr, int backlog)
+{
+    int rc = 0;
+    int fd = -1;
+
+    rc = inet_pton(AF_INET, cf->server_ip_string, &server_addr->sin_addr);
+    if (rc != 1) {
+        /* rc == -1 means errno set. rc == 0 means string is not understood. */
+        return WH_ERROR_BADARGS;
+    }
+    server_addr->sin_port = htons(cf->server_port);
+    server_addr->sin_family = AF_INET;
+
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return WH_ERROR_ABORTED;
+    }
+
+    /* Make socket non-blocking */
+    rc = posixTransportTcp_MakeNonBlocking(fd);
+    if (rc != 0) {
+        close(fd);
+        return WH_ERROR_ABORTED;
+    }
+
+    /* Ensure listen port does not linger */
+    rc = posixTransportTcp_MakeNoLinger(fd);
+    /* Ok to fail to linger.  Annoying, but ok. */
+
+    rc = bind(fd, (struct sockaddr*)server_addr, sizeof(*server_addr));
+    if (rc < 0) {
+        perror("bind failed\n");
+        close(fd);
+        return WH_ERROR_ABORTED;
+    }
+
+    rc = listen(fd, backlog);
+    if (rc < 0) {
+        close(fd);
+        return WH_ERROR_ABORTED;
+    }
+    return fd;
+}
+
 /** Client functions */
 int posixTransportTcp_InitConnect(void* context, const void* config,
         whCommSetConnectedCb connectcb, void* connectcb_arg)
@@ -268,6 +405,11 @@ int posixTransportTcp_InitConnect(void* context, const void* config,
         return WH_ERROR_ABORTED;
     }
 
+    if (cf->nodelay != 0) {
+        /* Ok to fail.  Small packets may be delayed */
+        (void)posixTransportTcp_MakeNoDelay(c->connect_fd_p1 - 1);
+    }
+
 
     /* Start the connect process */
     rc = connect(c->connect_fd_p1 - 1,
@@ -304,14 +446,29 @@ int posixTransportTcp_InitConnect(void* context, const void* config,
 
 int posixTransportTcp_SendRequest(void* context,
         uint16_t size, const void* data)
+{
+    whCommIov iov[1];
+
+    if (    (size == 0) ||
+            (size > PTT_PACKET_MAX_SIZE) ||
+            (data == NULL) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    iov->data = data;
+    iov->len = size;
+    return posixTransportTcp_SendRequestV(context, 1, iov);
+}
+
+int posixTransportTcp_SendRequestV(void* context,
+        uint16_t iov_count, const whCommIov* iov)
 {
     int rc = 0;
     posixTransportTcpClientContext* c = context;
     if (    (c == NULL) ||
             (c->connect_fd_p1 == 0) ||
-            (size == 0) ||
-            (size > PTT_PACKET_MAX_SIZE) ||
-            (data == NULL) ) {
+            (iov_count == 0) ||
+            (iov == NULL) ) {
         return WH_ERROR_BADARGS;
     }
 
@@ -348,7 +505,7 @@ int posixTransportTcp_SendRequest(void* context,
             c->connect_fd_p1 - 1,
             &c->buffer_offset,
             c->buffer,
-            size, data);
+            iov_count, iov);
 
     if (rc != WH_ERROR_NOTREADY) {
         /* Reset state */
@@ -437,48 +594,12 @@ int posixTransportTcp_InitListen(void* context, const void* config,
 
     memset(c, 0, sizeof(*c));
 
-    rc = inet_pton(AF_INET, cf->server_ip_string, &c->server_addr.sin_addr);
-    if (rc != 1) {
-        /* rc == -1 means errno set. rc == 0 means string is not understood. */
-        return WH_ERROR_BADARGS;
-    }
-    c->server_addr.sin_port = htons(cf->server_port);
-    c->server_addr.sin_family = AF_INET;
-
-    rc = socket(AF_INET, SOCK_STREAM, 0);
+    rc = posixTransportTcp_Listen(cf, &c->server_addr, 1);
     if (rc < 0) {
-        return WH_ERROR_ABORTED;
+        return rc;
     }
     c->listen_fd_p1 = rc + 1;
-
-    /* Make socket non-blocking */
-    rc = posixTransportTcp_MakeNonBlocking(c->listen_fd_p1 - 1);
-    if (rc != 0) {
-        close(c->listen_fd_p1 - 1);
-        c->listen_fd_p1 = 0;
-        return WH_ERROR_ABORTED;
-    }
-
-    /* Ensure listen port does not linger */
-    rc = posixTransportTcp_MakeNoLinger(c->listen_fd_p1 - 1);
-    /* Ok to fail to linger.  Annoying, but ok. */
-
-    rc = bind(c->listen_fd_p1 - 1,
-            (struct sockaddr*)&c->server_addr,
-            sizeof(c->server_addr));
-    if (rc < 0) {
-        perror("bind failed\n");
-        close(c->listen_fd_p1 - 1);
-        c->listen_fd_p1 = 0;
-        return WH_ERROR_ABORTED;
-    }
-
-    rc = listen(c->listen_fd_p1 - 1, 1);
-    if (rc < 0) {
-        close(c->listen_fd_p1 - 1);
-        c->listen_fd_p1 = 0;
-        return WH_ERROR_ABORTED;
-    }
+    c->nodelay = cf->nodelay;
 
     c->connectcb = connectcb;
     c->connectcb_arg = connectcb_arg;
@@ -523,6 +644,9 @@ int posixTransportTcp_RecvRequest(void* context,
             }
         }
         c->accept_fd_p1 = rc + 1;
+        if (c->nodelay != 0) {
+            (void)posixTransportTcp_MakeNoDelay(c->accept_fd_p1 - 1);
+        }
     }
 
     if (c->request_recv == 1) {
@@ -557,6 +681,7 @@ int posixTransportTcp_SendResponse(void* context,
 {
     int rc = 0;
     posixTransportTcpServerContext* c = context;
+    whCommIov iov[1];
     if (    (c == NULL) ||
             (c->listen_fd_p1 == 0) ||
             (c->accept_fd_p1 == 0) ||
@@ -570,11 +695,13 @@ int posixTransportTcp_SendResponse(void* context,
         return WH_ERROR_NOTREADY;
     }
 
+    iov->data = data;
+    iov->len = size;
     rc = posixTransportTcp_Send(
             c->accept_fd_p1 - 1,
             &c->buffer_offset,
             c->buffer,
-            size, data);
+            1, iov);
 
     if (rc != WH_ERROR_NOTREADY) {
         /* Reset state */
@@ -614,3 +741,233 @@ int posixTransportTcp_CleanupListen(void* context)
 
     return 0;
 }
+
+/** Multi-client server functions */
+static void posixTransportTcp_AcceptAll(posixTransportTcpMultiServerContext* c)
+{
+    struct sockaddr_in client_addr;
+    socklen_t client_len = 0;
+    int fd = -1;
+    int i = 0;
+
+    while (1) {
+        client_len = sizeof(client_addr);
+        fd = accept(c->listen_fd_p1 - 1,
+                (struct sockaddr*)&client_addr,
+                &client_len);
+        if (fd < 0) {
+            /* No more pending connections or a transient error */
+            return;
+        }
+
+        for (i = 0; i < PTT_MAX_CONNECTIONS; i++) {
+            if (c->conns[i].fd_p1 == 0) {
+                break;
+            }
+        }
+        if (    (i == PTT_MAX_CONNECTIONS) ||
+                (posixTransportTcp_MakeNonBlocking(fd) != 0)) {
+            /* No room. Refuse the connection */
+            close(fd);
+            continue;
+        }
+        if (c->nodelay != 0) {
+            (void)posixTransportTcp_MakeNoDelay(fd);
+        }
+
+        memset(&c->conns[i], 0, sizeof(c->conns[i]));
+        c->conns[i].fd_p1 = fd + 1;
+        c->conns[i].client_id = (uint8_t)(i + 1);
+    }
+}
+
+static void posixTransportTcp_Drop(posixTransportTcpConnection* conn)
+{
+    if (conn->fd_p1 != 0) {
+        close(conn->fd_p1 - 1);
+    }
+    conn->fd_p1 = 0;
+    conn->buffer_offset = 0;
+}
+
+int posixTransportTcp_InitMultiListen(void* context, const void* config,
+        whCommSetConnectedCb connectcb, void* connectcb_arg)
+{
+    int rc = 0;
+    posixTransportTcpMultiServerContext* c = context;
+    const posixTransportTcpConfig* cf = config;
+
+    if ( (c == NULL) || (cf == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    memset(c, 0, sizeof(*c));
+
+    rc = posixTransportTcp_Listen(cf, &c->server_addr, PTT_MAX_CONNECTIONS);
+    if (rc < 0) {
+        return rc;
+    }
+    c->listen_fd_p1 = rc + 1;
+    c->nodelay = cf->nodelay;
+
+    c->connectcb = connectcb;
+    c->connectcb_arg = connectcb_arg;
+
+    /* Individual clients come and go, so the server stays connected */
+    if (c->connectcb != NULL) {
+        c->connectcb(c->connectcb_arg, WH_COMM_CONNECTED);
+    }
+
+    /* All good */
+    return 0;
+}
+
+int posixTransportTcp_RecvMultiRequest(void* context,
+        uint16_t* out_size, void* data)
+{
+    int rc = 0;
+    int i = 0;
+    int n = 0;
+    posixTransportTcpMultiServerContext* c = context;
+    posixTransportTcpConnection* conn = NULL;
+    struct pollfd pfds[PTT_MAX_CONNECTIONS];
+
+    if (    (c == NULL) ||
+            (c->listen_fd_p1 == 0) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    if (c->current_p1 != 0) {
+        /* Already working on a request. */
+        return WH_ERROR_NOTREADY;
+    }
+
+    posixTransportTcp_AcceptAll(c);
+
+    /* Negative fds are ignored by poll */
+    for (i = 0; i < PTT_MAX_CONNECTIONS; i++) {
+        pfds[i].fd = c->conns[i].fd_p1 - 1;
+        pfds[i].events = POLLIN;
+        pfds[i].revents = 0;
+    }
+    rc = poll(pfds, PTT_MAX_CONNECTIONS, 0);
+    if (rc <= 0) {
+        /* Nothing readable or interrupted */
+        return WH_ERROR_NOTREADY;
+    }
+
+    /* Start after the last served connection so no client is starved */
+    for (n = 0; n < PTT_MAX_CONNECTIONS; n++) {
+        i = (c->next + n) % PTT_MAX_CONNECTIONS;
+        conn = &c->conns[i];
+        if (    (conn->fd_p1 == 0) ||
+                (pfds[i].revents == 0)) {
+            continue;
+        }
+
+        rc = posixTransportTcp_Recv(
+                conn->fd_p1 - 1,
+                &conn->buffer_offset,
+                conn->buffer,
+                out_size,
+                data);
+        if (rc == 0) {
+            conn->buffer_offset = 0;
+            c->current_p1 = i + 1;
+            c->next = (i + 1) % PTT_MAX_CONNECTIONS;
+            return 0;
+        }
+        if (rc != WH_ERROR_NOTREADY) {
+            /* Closed or broken. Only this client is lost */
+            posixTransportTcp_Drop(conn);
+        }
+    }
+    return WH_ERROR_NOTREADY;
+}
+
+int posixTransportTcp_SendMultiResponse(void* context,
+        uint16_t size, const void* data)
+{
+    int rc = 0;
+    posixTransportTcpMultiServerContext* c = context;
+    posixTransportTcpConnection* conn = NULL;
+    whCommIov iov[1];
+    if (    (c == NULL) ||
+            (c->listen_fd_p1 == 0) ||
+            (size == 0) ||
+            (size > PTT_PACKET_MAX_SIZE) ||
+            (data == NULL) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    if (c->current_p1 == 0) {
+        return WH_ERROR_NOTREADY;
+    }
+    conn = &c->conns[c->current_p1 - 1];
+
+    iov->data = data;
+    iov->len = size;
+    rc = posixTransportTcp_Send(
+            conn->fd_p1 - 1,
+            &conn->buffer_offset,
+            conn->buffer,
+            1, iov);
+
+    if (rc != WH_ERROR_NOTREADY) {
+        /* Done with this request either way */
+        c->current_p1 = 0;
+        conn->buffer_offset = 0;
+        if (rc != 0) {
+            posixTransportTcp_Drop(conn);
+        }
+    }
+    return rc;
+}
+
+int posixTransportTcp_GetMultiClientId(void* context, uint8_t* out_client_id)
+{
+    posixTransportTcpMultiServerContext* c = context;
+    if (    (c == NULL) ||
+            (out_client_id == NULL) ||
+            (c->current_p1 == 0) ) {
+        return WH_ERROR_BADARGS;
+    }
+    *out_client_id = c->conns[c->current_p1 - 1].client_id;
+    return 0;
+}
+
+int posixTransportTcp_SetMultiClientId(void* context, uint8_t client_id)
+{
+    posixTransportTcpMultiServerContext* c = context;
+    if (    (c == NULL) ||
+            (c->current_p1 == 0) ) {
+        return WH_ERROR_BADARGS;
+    }
+    c->conns[c->current_p1 - 1].client_id = client_id;
+    return 0;
+}
+
+int posixTransportTcp_CleanupMultiListen(void* context)
+{
+    posixTransportTcpMultiServerContext* c = context;
+    int i = 0;
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    /* Trigger disconnect */
+    if (c->connectcb != NULL) {
+        c->connectcb(c->connectcb_arg, WH_COMM_DISCONNECTED);
+    }
+
+    for (i = 0; i < PTT_MAX_CONNECTIONS; i++) {
+        posixTransportTcp_Drop(&c->conns[i]);
+    }
+    c->current_p1 = 0;
+    if (c->listen_fd_p1 != 0) {
+        close(c->listen_fd_p1 - 1);
+        c->listen_fd_p1 = 0;
+    }
+
+    return 0;
+}
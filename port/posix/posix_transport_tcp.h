@@ -30,6 +30,7 @@
  * posixTransportTcpConfig pttcfg[1] = {{
  *      .server_ip_string = "127.0.0.1",
  *      .server_port = 2345,
+ *      .nodelay = 1,
  * }};
  *
  * wh_TransportClient_Cb pttccb[1] = {PTT_CLIENT_CB};
@@ -68,7 +69,8 @@
 typedef struct {
     char* server_ip_string;
     short int server_port;
-    uint8_t padding[6];
+    uint8_t nodelay;        /* Set TCP_NODELAY on connections */
+    uint8_t padding[5];
 } posixTransportTcpConfig;
 
 
@@ -90,6 +92,8 @@ int posixTransportTcp_InitConnect(void* context, const void* config,
         whCommSetConnectedCb connectcb, void* connectcb_arg);
 int posixTransportTcp_SendRequest(void* context, uint16_t size,
         const void* data);
+int posixTransportTcp_SendRequestV(void* context, uint16_t iov_count,
+        const whCommIov* iov);
 int posixTransportTcp_RecvResponse(void* context, uint16_t *out_size,
         void* data);
 int posixTransportTcp_CleanupConnect(void* context);
@@ -98,6 +102,7 @@ int posixTransportTcp_CleanupConnect(void* context);
 {                                                   \
     .Init =     posixTransportTcp_InitConnect,      \
     .Send =     posixTransportTcp_SendRequest,      \
+    .SendV =    posixTransportTcp_SendRequestV,     \
     .Recv =     posixTransportTcp_RecvResponse,     \
     .Cleanup =  posixTransportTcp_CleanupConnect,   \
 }
@@ -115,7 +120,8 @@ typedef struct {
     int request_recv;
     uint16_t buffer_offset;
     uint8_t buffer[PTT_BUFFER_SIZE];
-    uint8_t padding[6];
+    uint8_t nodelay;
+    uint8_t padding[5];
 } posixTransportTcpServerContext;
 
 int posixTransportTcp_InitListen(void* context, const void* config,
@@ -134,4 +140,59 @@ int posixTransportTcp_CleanupListen(void* context);
     .Cleanup =  posixTransportTcp_CleanupListen,    \
 }
 
+
+/** Multi-client server context and functions
+ * Accepts up to PTT_MAX_CONNECTIONS clients on one listening socket and polls
+ * them round-robin, so one busy client cannot starve the others.  Requests
+ * are still handled one at a time.  Each connection starts with a client id
+ * of its slot index plus 1, and keeps the id set by a comm init on it.
+ *
+ * wh_TransportServer_Cb pttmscb[1] = {PTT_MULTI_SERVER_CB};
+ * posixTransportTcpMultiServerContext pttmsc[1] = {0};
+ */
+
+#ifndef PTT_MAX_CONNECTIONS
+#define PTT_MAX_CONNECTIONS 16
+#endif
+
+typedef struct {
+    int fd_p1;              /* fd plus 1 so 0 is invalid */
+    uint16_t buffer_offset;
+    uint8_t client_id;
+    uint8_t padding[5];
+    uint8_t buffer[PTT_BUFFER_SIZE];
+} posixTransportTcpConnection;
+
+typedef struct {
+    whCommSetConnectedCb connectcb;
+    void* connectcb_arg;
+    struct sockaddr_in server_addr;
+    int listen_fd_p1;       /* fd plus 1 so 0 is invalid */
+    int current_p1;         /* Connection index plus 1 of current request */
+    int next;               /* Connection index to poll first */
+    uint8_t nodelay;
+    uint8_t padding[3];
+    posixTransportTcpConnection conns[PTT_MAX_CONNECTIONS];
+} posixTransportTcpMultiServerContext;
+
+int posixTransportTcp_InitMultiListen(void* context, const void* config,
+        whCommSetConnectedCb connectcb, void* connectcb_arg);
+int posixTransportTcp_RecvMultiRequest(void* context, uint16_t *out_size,
+        void* data);
+int posixTransportTcp_SendMultiResponse(void* context, uint16_t size,
+        const void* data);
+int posixTransportTcp_GetMultiClientId(void* context, uint8_t* out_client_id);
+int posixTransportTcp_SetMultiClientId(void* context, uint8_t client_id);
+int posixTransportTcp_CleanupMultiListen(void* context);
+
+#define PTT_MULTI_SERVER_CB                             \
+{                                                       \
+    .Init =         posixTransportTcp_InitMultiListen,  \
+    .Recv =         posixTransportTcp_RecvMultiRequest, \
+    .Send =         posixTransportTcp_SendMultiResponse,\
+    .GetClientId =  posixTransportTcp_GetMultiClientId, \
+    .SetClientId =  posixTransportTcp_SetMultiClientId, \
+    .Cleanup =      posixTransportTcp_CleanupMultiListen,\
+}
+
 #endif /* WH_TRANSPORT_TCP_H_ */
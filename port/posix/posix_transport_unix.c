@@ -0,0 +1,542 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * port/posix/posix_transport_unix.c
+ *
+ * Implementation of transport callbacks using AF_UNIX sequenced packets
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#include "wolfhsm/wh_error.h"
+#include "wolfhsm/wh_comm.h"
+#include "port/posix/posix_transport_unix.h"
+
+
+/** Local declarations */
+
+/* Common utility function to make a fd non-blocking */
+static int posixTransportUnix_MakeNonBlocking(int fd);
+
+/* Common utility function to fill in the socket address from a path */
+static int posixTransportUnix_MakeAddr(const char* path,
+        struct sockaddr_un* addr);
+
+/* Common function to send the fragments as one packet */
+static int posixTransportUnix_Send(int fd, uint16_t iov_count,
+        const whCommIov* iov);
+
+/* Common function to receive one packet */
+static int posixTransportUnix_Recv(int fd, uint16_t *out_size, void* data);
+
+/* Client utility function to connect once the server is listening */
+static int posixTransportUnix_Connect(posixTransportUnixClientContext* c);
+
+/* Server utility function to close a lost client so the next can connect */
+static void posixTransportUnix_Drop(posixTransportUnixServerContext* c);
+
+/** Local implementations */
+static int posixTransportUnix_MakeNonBlocking(int fd)
+{
+    int rc = 0;
+    rc = fcntl(fd, F_GETFL, 0);
+    if (rc == -1) {
+        /* Error getting flags */
+        return WH_ERROR_ABORTED;
+    }
+    /* Set the nonblocking flag */
+    rc = fcntl(fd, F_SETFL, rc | O_NONBLOCK);
+    if (rc == -1) {
+        /* Error setting flags */
+        return WH_ERROR_ABORTED;
+    }
+    return 0;
+}
+
+static int posixTransportUnix_MakeAddr(const char* path,
+        struct sockaddr_un* addr)
+{
+    if (    (path == NULL) ||
+            (strlen(path) >= sizeof(addr->sun_path))) {
+        return WH_ERROR_BADARGS;
+    }
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    strcpy(addr->sun_path, path);
+    return 0;
+}
+
+static int posixTransportUnix_Send(int fd, uint16_t iov_count,
+        const whCommIov* iov)
+{
+    int rc = 0;
+    struct iovec vec[WH_COMM_IOV_MAX_COUNT + 1];
+    struct msghdr msg;
+    size_t size = 0;
+    int i = 0;
+
+    if (    (fd < 0) ||
+            (iov_count == 0) ||
+            (iov_count > WH_COMM_IOV_MAX_COUNT + 1) ||
+            (iov == NULL) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    for (i = 0; i < iov_count; i++) {
+        if ((iov[i].data == NULL) && (iov[i].len != 0)) {
+            return WH_ERROR_BADARGS;
+        }
+        vec[i].iov_base = (void*)iov[i].data;
+        vec[i].iov_len = iov[i].len;
+        size += iov[i].len;
+    }
+    if (    (size == 0) ||
+            (size > PTU_PACKET_MAX_SIZE)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = vec;
+    msg.msg_iovlen = iov_count;
+
+    /* Packets are atomic.  Either all is queued or nothing is */
+    rc = sendmsg(fd, &msg, MSG_NOSIGNAL);
+    if (rc < 0) {
+        switch (errno) {
+        case EAGAIN:
+        case EINTR:
+            /* Not enough buffer space */
+            return WH_ERROR_NOTREADY;
+
+        default:
+            /* Other error. Assume fatal. */
+            return WH_ERROR_ABORTED;
+        }
+    }
+    return 0;
+}
+
+static int posixTransportUnix_Recv(int fd, uint16_t *out_size, void* data)
+{
+    int rc = 0;
+    uint8_t buffer[PTU_PACKET_MAX_SIZE];
+    struct iovec vec[1];
+    struct msghdr msg;
+
+    if (fd < 0) {
+        return WH_ERROR_BADARGS;
+    }
+
+    /* Receive straight into the caller's buffer when there is one */
+    vec->iov_base = (data != NULL) ? data : buffer;
+    vec->iov_len = PTU_PACKET_MAX_SIZE;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = vec;
+    msg.msg_iovlen = 1;
+
+    rc = recvmsg(fd, &msg, 0);
+    if (rc < 0) {
+        switch (errno) {
+        case EAGAIN:
+        case EINTR:
+            /* No recv data */
+            return WH_ERROR_NOTREADY;
+
+        default:
+            /* Other error. Assume fatal. */
+            return WH_ERROR_ABORTED;
+        }
+    }
+    if (    (rc == 0) ||
+            ((msg.msg_flags & MSG_TRUNC) != 0)) {
+        /* Peer closed or sent an oversize packet */
+        return WH_ERROR_ABORTED;
+    }
+
+    if (out_size != NULL) {
+        *out_size = (uint16_t)rc;
+    }
+    return 0;
+}
+
+static int posixTransportUnix_Connect(posixTransportUnixClientContext* c)
+{
+    int rc = 0;
+    struct sockaddr_un addr;
+
+    rc = posixTransportUnix_MakeAddr(c->socket_path, &addr);
+    if (rc != 0) {
+        return rc;
+    }
+
+    if (c->connect_fd_p1 == 0) {
+        rc = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+        if (rc < 0) {
+            return WH_ERROR_ABORTED;
+        }
+        c->connect_fd_p1 = rc + 1;
+
+        rc = posixTransportUnix_MakeNonBlocking(c->connect_fd_p1 - 1);
+        if (rc != 0) {
+            close(c->connect_fd_p1 - 1);
+            c->connect_fd_p1 = 0;
+            return WH_ERROR_ABORTED;
+        }
+    }
+
+    rc = connect(c->connect_fd_p1 - 1, (struct sockaddr*)&addr, sizeof(addr));
+    if ((rc < 0) && (errno != EISCONN)) {
+        switch (errno) {
+        case ENOENT:
+        case ECONNREFUSED:
+        case EAGAIN:
+        case EINTR:
+            /* Server is not listening yet or is busy.  Start over later */
+            close(c->connect_fd_p1 - 1);
+            c->connect_fd_p1 = 0;
+            return WH_ERROR_NOTREADY;
+
+        default:
+            /* Some other error. Assume fatal. */
+            close(c->connect_fd_p1 - 1);
+            c->connect_fd_p1 = 0;
+            return WH_ERROR_ABORTED;
+        }
+    }
+    c->connected = 1;
+    return 0;
+}
+
+static void posixTransportUnix_Drop(posixTransportUnixServerContext* c)
+{
+    if (c->accept_fd_p1 != 0) {
+        close(c->accept_fd_p1 - 1);
+    }
+    c->accept_fd_p1 = 0;
+    c->request_recv = 0;
+}
+
+/** Client functions */
+int posixTransportUnix_InitConnect(void* context, const void* config,
+        whCommSetConnectedCb connectcb, void* connectcb_arg)
+{
+    posixTransportUnixClientContext* c = context;
+    const posixTransportUnixConfig* cf = config;
+    struct sockaddr_un addr;
+
+    if (    (c == NULL) ||
+            (cf == NULL) ||
+            (posixTransportUnix_MakeAddr(cf->socket_path, &addr) != 0)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    memset(c, 0, sizeof(*c));
+    c->socket_path = cf->socket_path;
+    c->connectcb = connectcb;
+    c->connectcb_arg = connectcb_arg;
+
+    /* Connecting happens on the first send, so report connected now and
+     * monitor the status during send/recv.
+     */
+    if (c->connectcb != NULL) {
+        c->connectcb(connectcb_arg, WH_COMM_CONNECTED);
+    }
+    /* All good */
+    return 0;
+}
+
+int posixTransportUnix_SendRequest(void* context,
+        uint16_t size, const void* data)
+{
+    whCommIov iov[1];
+
+    if (    (size == 0) ||
+            (size > PTU_PACKET_MAX_SIZE) ||
+            (data == NULL) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    iov->data = data;
+    iov->len = size;
+    return posixTransportUnix_SendRequestV(context, 1, iov);
+}
+
+int posixTransportUnix_SendRequestV(void* context,
+        uint16_t iov_count, const whCommIov* iov)
+{
+    int rc = 0;
+    posixTransportUnixClientContext* c = context;
+    if (    (c == NULL) ||
+            (c->socket_path == NULL) ||
+            (iov_count == 0) ||
+            (iov == NULL) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    if (c->request_sent == 1) {
+        return WH_ERROR_NOTREADY;
+    }
+
+    /* Handle late connect */
+    if (c->connected == 0) {
+        rc = posixTransportUnix_Connect(c);
+        if (rc != 0) {
+            return rc;
+        }
+    }
+
+    rc = posixTransportUnix_Send(c->connect_fd_p1 - 1, iov_count, iov);
+    if (rc == 0) {
+        c->request_sent = 1;
+    } else if (rc != WH_ERROR_NOTREADY) {
+        /* Assume fatal error and trigger disconnect */
+        if (c->connectcb != NULL) {
+            c->connectcb(c->connectcb_arg, WH_COMM_DISCONNECTED);
+        }
+    }
+    return rc;
+}
+
+int posixTransportUnix_RecvResponse(void* context,
+        uint16_t* out_size, void* data)
+{
+    int rc = 0;
+    posixTransportUnixClientContext* c = context;
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    if (c->request_sent != 1) {
+        return WH_ERROR_NOTREADY;
+    }
+
+    rc = posixTransportUnix_Recv(c->connect_fd_p1 - 1, out_size, data);
+    if (rc != WH_ERROR_NOTREADY) {
+        /* Success or fatal.  Reset state either way */
+        c->request_sent = 0;
+        if (rc != 0) {
+            /* Assume fatal error and trigger disconnect */
+            if (c->connectcb != NULL) {
+                c->connectcb(c->connectcb_arg, WH_COMM_DISCONNECTED);
+            }
+        }
+    }
+    return rc;
+}
+
+int posixTransportUnix_CleanupConnect(void* context)
+{
+    posixTransportUnixClientContext* c = context;
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    /* Trigger disconnect */
+    if (c->connectcb != NULL) {
+        c->connectcb(c->connectcb_arg, WH_COMM_DISCONNECTED);
+    }
+
+    if (c->connect_fd_p1 != 0) {
+        close(c->connect_fd_p1 - 1);
+        c->connect_fd_p1 = 0;
+    }
+    c->connected = 0;
+
+    return 0;
+}
+
+
+/** Server Functions */
+int posixTransportUnix_InitListen(void* context, const void* config,
+        whCommSetConnectedCb connectcb, void* connectcb_arg)
+{
+    int rc = 0;
+    posixTransportUnixServerContext* c = context;
+    const posixTransportUnixConfig* cf = config;
+    struct sockaddr_un addr;
+
+    if (    (c == NULL) ||
+            (cf == NULL) ||
+            (posixTransportUnix_MakeAddr(cf->socket_path, &addr) != 0)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    memset(c, 0, sizeof(*c));
+    c->socket_path = cf->socket_path;
+
+    rc = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+    if (rc < 0) {
+        return WH_ERROR_ABORTED;
+    }
+    c->listen_fd_p1 = rc + 1;
+
+    /* Make socket non-blocking */
+    rc = posixTransportUnix_MakeNonBlocking(c->listen_fd_p1 - 1);
+    if (rc != 0) {
+        close(c->listen_fd_p1 - 1);
+        c->listen_fd_p1 = 0;
+        return WH_ERROR_ABORTED;
+    }
+
+    /* Remove a stale socket left behind by a previous server */
+    (void)unlink(c->socket_path);
+
+    rc = bind(c->listen_fd_p1 - 1, (struct sockaddr*)&addr, sizeof(addr));
+    if (rc < 0) {
+        perror("bind failed\n");
+        close(c->listen_fd_p1 - 1);
+        c->listen_fd_p1 = 0;
+        return WH_ERROR_ABORTED;
+    }
+
+    rc = listen(c->listen_fd_p1 - 1, 1);
+    if (rc < 0) {
+        close(c->listen_fd_p1 - 1);
+        c->listen_fd_p1 = 0;
+        (void)unlink(c->socket_path);
+        return WH_ERROR_ABORTED;
+    }
+
+    c->connectcb = connectcb;
+    c->connectcb_arg = connectcb_arg;
+
+    /* Connecting is handled internally so we need server to call recv */
+    if (c->connectcb != NULL) {
+        c->connectcb(c->connectcb_arg, WH_COMM_CONNECTED);
+    }
+
+    /* All good */
+    return 0;
+}
+
+int posixTransportUnix_RecvRequest(void* context,
+        uint16_t* out_size, void* data)
+{
+    int rc = 0;
+    posixTransportUnixServerContext* c = context;
+    if (    (c == NULL) ||
+            (c->listen_fd_p1 == 0) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    if (c->accept_fd_p1 == 0) {
+        rc = accept(c->listen_fd_p1 - 1, NULL, NULL);
+        if (rc < 0) {
+            switch (errno) {
+            case EAGAIN:
+            case EINTR:
+                /* No client */
+                return WH_ERROR_NOTREADY;
+
+            default:
+                /* Other error. Assume fatal. */
+                close(c->listen_fd_p1 - 1);
+                c->listen_fd_p1 = 0;
+                return WH_ERROR_ABORTED;
+            }
+        }
+        c->accept_fd_p1 = rc + 1;
+        if (posixTransportUnix_MakeNonBlocking(c->accept_fd_p1 - 1) != 0) {
+            close(c->accept_fd_p1 - 1);
+            c->accept_fd_p1 = 0;
+            return WH_ERROR_ABORTED;
+        }
+    }
+
+    if (c->request_recv == 1) {
+        /* Already working on a request. */
+        return WH_ERROR_NOTREADY;
+    }
+
+    rc = posixTransportUnix_Recv(c->accept_fd_p1 - 1, out_size, data);
+    if (rc == 0) {
+        c->request_recv = 1;
+    } else if (rc != WH_ERROR_NOTREADY) {
+        /* Client closed or broke.  Drop it and accept the next one */
+        posixTransportUnix_Drop(c);
+        rc = WH_ERROR_NOTREADY;
+    }
+    return rc;
+}
+
+int posixTransportUnix_SendResponse(void* context,
+        uint16_t size, const void* data)
+{
+    int rc = 0;
+    posixTransportUnixServerContext* c = context;
+    whCommIov iov[1];
+    if (    (c == NULL) ||
+            (c->listen_fd_p1 == 0) ||
+            (c->accept_fd_p1 == 0) ||
+            (size == 0) ||
+            (size > PTU_PACKET_MAX_SIZE) ||
+            (data == NULL) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    if (c->request_recv == 0) {
+        return WH_ERROR_NOTREADY;
+    }
+
+    iov->data = data;
+    iov->len = size;
+    rc = posixTransportUnix_Send(c->accept_fd_p1 - 1, 1, iov);
+    if (rc == 0) {
+        c->request_recv = 0;
+    } else if (rc != WH_ERROR_NOTREADY) {
+        /* Only this client is lost */
+        posixTransportUnix_Drop(c);
+    }
+    return rc;
+}
+
+int posixTransportUnix_CleanupListen(void* context)
+{
+    posixTransportUnixServerContext* c = context;
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    /* Trigger disconnect */
+    if (c->connectcb != NULL) {
+        c->connectcb(c->connectcb_arg, WH_COMM_DISCONNECTED);
+    }
+
+    if (c->accept_fd_p1 != 0) {
+        close(c->accept_fd_p1 - 1);
+        c->accept_fd_p1 = 0;
+    }
+    if (c->listen_fd_p1 != 0) {
+        close(c->listen_fd_p1 - 1);
+        c->listen_fd_p1 = 0;
+        (void)unlink(c->socket_path);
+    }
+
+    return 0;
+}
@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * port/posix/posix_transport_unix.h
+ *
+ * wolfHSM Transport binding using AF_UNIX SOCK_SEQPACKET sockets
+ */
+
+#ifndef PORT_POSIX_POSIX_TRANSPORT_UNIX_H_
+#define PORT_POSIX_POSIX_TRANSPORT_UNIX_H_
+
+/* Example usage:
+ *
+ * posixTransportUnixConfig ptucfg[1] = {{
+ *      .socket_path = "/tmp/wolfhsm.sock",
+ * }};
+ *
+ * wh_TransportClient_Cb ptuccb[1] = {PTU_CLIENT_CB};
+ * posixTransportUnixClientContext ptucc[1] = {0};
+ * whCommClientConfig ccc[1] = {{
+ *      .transport_cb = ptuccb,
+ *      .transport_context = ptucc,
+ *      .transport_config = ptucfg,
+ *      .client_id = 1234,
+ * }}
+ * whCommClient cc[1] ={0};
+ * wh_CommClient_Init(cc, ccc);
+ *
+ * wh_TransportServer_Cb ptuscb[1] = {PTU_SERVER_CB};
+ * posixTransportUnixServerContext ptusc[1] = {0};
+ * whCommServerConfig csc[1] = {{
+ *      .transport_cb = ptuscb,
+ *      .transport_context = ptusc,
+ *      .transport_config = ptucfg,
+ *      .server_id = 5678,
+ * }}
+ * whCommServer cs[1] = {0};
+ * wh_CommServer_Init(cs, csc);
+ *
+ * Sequenced packets keep message boundaries, so each comm packet is sent as
+ * one record with no length framing and no staging buffer.  The client
+ * connects lazily, so it may be initialized before the server listens.
+ */
+
+#include <stdint.h>
+
+#include "wolfhsm/wh_comm.h"
+
+#define PTU_PACKET_MAX_SIZE WH_COMM_MTU
+
+/** Common configuration structure */
+typedef struct {
+    const char* socket_path;    /* Filesystem path of the listening socket */
+} posixTransportUnixConfig;
+
+
+/** Client context and functions */
+
+typedef struct {
+    whCommSetConnectedCb connectcb;
+    void* connectcb_arg;
+    const char* socket_path;
+    int connect_fd_p1;      /* fd plus 1 so 0 is invalid */
+    int connected;
+    int request_sent;
+    uint8_t padding[4];
+} posixTransportUnixClientContext;
+
+int posixTransportUnix_InitConnect(void* context, const void* config,
+        whCommSetConnectedCb connectcb, void* connectcb_arg);
+int posixTransportUnix_SendRequest(void* context, uint16_t size,
+        const void* data);
+int posixTransportUnix_SendRequestV(void* context, uint16_t iov_count,
+        const whCommIov* iov);
+int posixTransportUnix_RecvResponse(void* context, uint16_t *out_size,
+        void* data);
+int posixTransportUnix_CleanupConnect(void* context);
+
+#define PTU_CLIENT_CB                               \
+{                                                   \
+    .Init =     posixTransportUnix_InitConnect,     \
+    .Send =     posixTransportUnix_SendRequest,     \
+    .SendV =    posixTransportUnix_SendRequestV,    \
+    .Recv =     posixTransportUnix_RecvResponse,    \
+    .Cleanup =  posixTransportUnix_CleanupConnect,  \
+}
+
+
+/** Server context and functions */
+
+typedef struct {
+    whCommSetConnectedCb connectcb;
+    void* connectcb_arg;
+    const char* socket_path;
+    int listen_fd_p1;       /* fd plus 1 so 0 is invalid */
+    int accept_fd_p1;       /* fd plus 1 so 0 is invalid */
+    int request_recv;
+    uint8_t padding[4];
+} posixTransportUnixServerContext;
+
+int posixTransportUnix_InitListen(void* context, const void* config,
+        whCommSetConnectedCb connectcb, void* connectcb_arg);
+int posixTransportUnix_RecvRequest(void* context, uint16_t *out_size,
+        void* data);
+int posixTransportUnix_SendResponse(void* context, uint16_t size,
+        const void* data);
+int posixTransportUnix_CleanupListen(void* context);
+
+#define PTU_SERVER_CB                               \
+{                                                   \
+    .Init =     posixTransportUnix_InitListen,      \
+    .Recv =     posixTransportUnix_RecvRequest,     \
+    .Send =     posixTransportUnix_SendResponse,    \
+    .Cleanup =  posixTransportUnix_CleanupListen,   \
+}
+
+#endif /* PORT_POSIX_POSIX_TRANSPORT_UNIX_H_ */
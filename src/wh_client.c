@@ -47,6 +47,7 @@
 #include "wolfhsm/wh_message.h"
 #include "wolfhsm/wh_message_comm.h"
 #include "wolfhsm/wh_message_customcb.h"
+#include "wolfhsm/wh_message_counter.h"
 
 #include "wolfhsm/wh_packet.h"
 #include "wolfhsm/wh_client.h"
@@ -58,12 +59,23 @@ int wh_Client_Init(whClientContext* c, const whClientConfig* config)
         return WH_ERROR_BADARGS;
     }
 
+    if ((config->nvm_cache_count != 0) && (config->nvm_cache == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+
     memset(c, 0, sizeof(*c));
+    if (config->nvm_cache_count != 0) {
+        c->nvm_cache = config->nvm_cache;
+        c->nvm_cache_count = config->nvm_cache_count;
+        memset(c->nvm_cache, 0,
+                sizeof(*c->nvm_cache) * c->nvm_cache_count);
+    }
 
     if (    ((rc = wh_CommClient_Init(c->comm, config->comm)) == 0) &&
 #ifndef WOLFHSM_NO_CRYPTO
             ((rc = wolfCrypt_Init()) == 0) &&
             ((rc = wc_CryptoCb_RegisterDevice(WOLFHSM_DEV_ID, wolfHSM_CryptoCb, c)) == 0) &&
+            ((rc = wc_CryptoCb_RegisterDevice(WOLFHSM_DEV_ID_DMA, wolfHSM_CryptoCbDma, c)) == 0) &&
 #endif  /* WOLFHSM_NO_CRYPTO */
             1) {
         /* All good */
@@ -92,6 +104,37 @@ int wh_Client_Cleanup(whClientContext* c)
 int wh_Client_SendRequest(whClientContext* c,
         uint16_t group, uint16_t action,
         uint16_t data_size, const void* data)
+{
+    whCommIov iov[1];
+
+    iov->data = data;
+    iov->len = data_size;
+    return wh_Client_SendRequestV(c, group, action, 1, iov);
+}
+
+int wh_Client_SendRequestV(whClientContext* c,
+        uint16_t group, uint16_t action,
+        uint16_t iov_count, const whCommIov* iov)
+{
+    uint16_t req_id = 0;
+    uint16_t kind = WH_MESSAGE_KIND(group, action);
+    int rc = 0;
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+    rc = wh_CommClient_SendRequestV(c->comm, WH_COMM_MAGIC_NATIVE, kind,
+        &req_id, iov_count, iov);
+    if (rc == 0) {
+        c->last_req_kind = kind;
+        c->last_req_id = req_id;
+    }
+    return rc;
+}
+
+int wh_Client_SendRequestFragV(whClientContext* c,
+        uint16_t group, uint16_t action,
+        uint16_t iov_count, const whCommIov* iov)
 {
     uint16_t req_id = 0;
     uint16_t kind = WH_MESSAGE_KIND(group, action);
@@ -100,8 +143,8 @@ int wh_Client_SendRequest(whClientContext* c,
     if (c == NULL) {
         return WH_ERROR_BADARGS;
     }
-    rc = wh_CommClient_SendRequest(c->comm, WH_COMM_MAGIC_NATIVE, kind, &req_id,
-        data_size, data);
+    rc = wh_CommClient_SendRequestFragV(c->comm, WH_COMM_MAGIC_NATIVE, kind,
+        &req_id, iov_count, iov);
     if (rc == 0) {
         c->last_req_kind = kind;
         c->last_req_id = req_id;
@@ -359,199 +402,759 @@ int wh_Client_Echo(whClientContext* c, uint16_t snd_len, const void* snd_data,
     return rc;
 }
 
-int wh_Client_CustomCbRequest(whClientContext* c, const whMessageCustomCb_Request* req)
+int wh_Client_CommBatchRequest(whClientContext* c, uint16_t size,
+        const void* batch)
 {
-    if (NULL == c || req == NULL || req->id >= WH_CUSTOM_CB_NUM_CALLBACKS) {
+    if (    (c == NULL) ||
+            (batch == NULL) ||
+            (size < sizeof(whMessageCommBatchHeader)) ||
+            (size > WH_COMM_DATA_LEN)) {
         return WH_ERROR_BADARGS;
     }
 
-    return wh_Client_SendRequest(c, WH_MESSAGE_GROUP_CUSTOM, req->id,
-                                 sizeof(*req), req);
+    return wh_Client_SendRequest(c,
+            WH_MESSAGE_GROUP_COMM, WH_MESSAGE_COMM_ACTION_BATCH,
+            size, batch);
 }
 
-int wh_Client_CustomCbResponse(whClientContext*          c,
-                             whMessageCustomCb_Response* outResp)
+int wh_Client_CommBatchResponse(whClientContext* c, uint16_t* out_size,
+        void* batch)
 {
-    whMessageCustomCb_Response resp;
-    uint16_t                 resp_group  = 0;
-    uint16_t                 resp_action = 0;
-    uint16_t                 resp_size   = 0;
-    int32_t                  rc          = 0;
+    int rc = 0;
+    uint16_t resp_group = 0;
+    uint16_t resp_action = 0;
+    uint16_t resp_size = 0;
 
-    if (NULL == c || outResp == NULL) {
+    if (    (c == NULL) ||
+            (batch == NULL)) {
         return WH_ERROR_BADARGS;
     }
 
-    rc =
-        wh_Client_RecvResponse(c, &resp_group, &resp_action, &resp_size, &resp);
-    if (rc != WH_ERROR_OK) {
-        return rc;
+    rc = wh_Client_RecvResponse(c,
+            &resp_group, &resp_action,
+            &resp_size, batch);
+    if (rc == 0) {
+        /* Validate response */
+        if (    (resp_group != WH_MESSAGE_GROUP_COMM) ||
+                (resp_action != WH_MESSAGE_COMM_ACTION_BATCH) ||
+                (resp_size < sizeof(whMessageCommBatchHeader)) ){
+            /* Invalid message */
+            rc = WH_ERROR_ABORTED;
+        } else {
+            /* Valid message */
+            if (out_size != NULL) {
+                *out_size = resp_size;
+            }
+        }
     }
+    return rc;
+}
 
-    if (resp_size != sizeof(resp) || resp_group != WH_MESSAGE_GROUP_CUSTOM ||
-        resp_action >= WH_CUSTOM_CB_NUM_CALLBACKS) {
-        /* message invalid */
-        return WH_ERROR_ABORTED;
+int wh_Client_CommBatch(whClientContext* c, uint16_t size, const void* batch,
+        uint16_t* out_size, void* out_batch)
+{
+    int rc = 0;
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
     }
+    do {
+        rc = wh_Client_CommBatchRequest(c, size, batch);
+    } while (rc == WH_ERROR_NOTREADY);
 
-    memcpy(outResp, &resp, sizeof(resp));
-
-    return WH_ERROR_OK;
+    if (rc == 0) {
+        do {
+            rc = wh_Client_CommBatchResponse(c, out_size, out_batch);
+        } while (rc == WH_ERROR_NOTREADY);
+    }
+    return rc;
 }
 
-int wh_Client_CustomCheckRegisteredRequest(whClientContext* c, uint32_t id)
+int wh_Client_JobRequest(whClientContext* c, uint16_t id)
 {
-    whMessageCustomCb_Request req = {0};
+    whMessageCommJobRequest msg = {0};
 
-    if (c == NULL || id >= WH_CUSTOM_CB_NUM_CALLBACKS) {
+    if (c == NULL) {
         return WH_ERROR_BADARGS;
     }
 
-    req.id = id;
-    req.type = WH_MESSAGE_CUSTOM_CB_TYPE_QUERY;
-
-    return wh_Client_SendRequest(c, WH_MESSAGE_GROUP_CUSTOM, req.id,
-                                 sizeof(req), &req);
+    msg.id = id;
+    return wh_Client_SendRequest(c,
+            WH_MESSAGE_GROUP_COMM, WH_MESSAGE_COMM_ACTION_JOB,
+            sizeof(msg), &msg);
 }
 
-
-int wh_Client_CustomCbCheckRegisteredResponse(whClientContext* c, uint16_t* outId, int* responseError)
+int wh_Client_JobResponse(whClientContext* c, int32_t* out_rc,
+        uint16_t* out_kind, uint16_t* inout_size, void* data)
 {
     int rc = 0;
-    whMessageCustomCb_Response resp = {0};
+    uint64_t buffer[WH_COMM_DATA_LEN / sizeof(uint64_t)];
+    whMessageCommJobResponse* msg = (whMessageCommJobResponse*)buffer;
+    uint16_t resp_group = 0;
+    uint16_t resp_action = 0;
+    uint16_t resp_size = 0;
 
-    if (c == NULL || outId == NULL || responseError == NULL) {
+    if (c == NULL) {
         return WH_ERROR_BADARGS;
     }
 
-    rc = wh_Client_CustomCbResponse(c, &resp);
-    if (rc != WH_ERROR_OK) {
-        return rc;
-    }
-
-    if (resp.type != WH_MESSAGE_CUSTOM_CB_TYPE_QUERY) {
-        /* message invalid */
-        return WH_ERROR_ABORTED;
-    }
-
-    if (resp.err != WH_ERROR_OK && resp.err != WH_ERROR_NOHANDLER) {
-        /* error codes that aren't related to the query should be fatal */
-        return WH_ERROR_ABORTED;
+    rc = wh_Client_RecvResponse(c,
+            &resp_group, &resp_action,
+            &resp_size, buffer);
+    if (rc == 0) {
+        /* Validate response */
+        if (    (resp_group != WH_MESSAGE_GROUP_COMM) ||
+                (resp_action != WH_MESSAGE_COMM_ACTION_JOB) ||
+                (resp_size < sizeof(*msg)) ){
+            /* Invalid message */
+            rc = WH_ERROR_ABORTED;
+        } else {
+            /* Valid message */
+            if (msg->len > resp_size - sizeof(*msg)) {
+                /* Bad incoming msg len.  Truncate */
+                msg->len = resp_size - sizeof(*msg);
+            }
+            if (out_rc != NULL) {
+                *out_rc = msg->rc;
+            }
+            if (out_kind != NULL) {
+                *out_kind = msg->kind;
+            }
+            if (inout_size != NULL) {
+                if (msg->len > *inout_size) {
+                    rc = WH_ERROR_NOSPACE;
+                } else {
+                    if ((data != NULL) && (msg->len > 0)) {
+                        memcpy(data, msg + 1, msg->len);
+                    }
+                    *inout_size = msg->len;
+                }
+            }
+        }
     }
-
-    *outId = resp.id;
-    *responseError = resp.err;
-
-    return WH_ERROR_OK;
+    return rc;
 }
 
-
-int wh_Client_CustomCbCheckRegistered(whClientContext* c, uint16_t id, int* responseError)
+int wh_Client_Job(whClientContext* c, uint16_t id, int32_t* out_rc,
+        uint16_t* out_kind, uint16_t* inout_size, void* data)
 {
     int rc = 0;
-
-    if (NULL == c || NULL == responseError || id >= WH_CUSTOM_CB_NUM_CALLBACKS) {
+    if (c == NULL) {
         return WH_ERROR_BADARGS;
     }
-
     do {
-        rc = wh_Client_CustomCheckRegisteredRequest(c, id);
+        rc = wh_Client_JobRequest(c, id);
     } while (rc == WH_ERROR_NOTREADY);
 
-    if (rc == WH_ERROR_OK) {
+    if (rc == 0) {
         do {
-            rc = wh_Client_CustomCbCheckRegisteredResponse(c, &id, responseError);
+            rc = wh_Client_JobResponse(c, out_rc, out_kind, inout_size, data);
         } while (rc == WH_ERROR_NOTREADY);
     }
-
     return rc;
 }
 
-
-#ifndef WOLFHSM_NO_CRYPTO
-
-int wh_Client_KeyCacheRequest_ex(whClientContext* c, uint32_t flags,
-    uint8_t* label, uint32_t labelSz, uint8_t* in, uint32_t inSz,
-    uint16_t keyId)
+int wh_Client_CommStatsRequest(whClientContext* c, uint16_t start,
+        uint8_t reset)
 {
-    uint8_t rawPacket[WH_COMM_MTU] = {0};
-    whPacket* packet = (whPacket*)rawPacket;
-    uint8_t* packIn = (uint8_t*)(&packet->keyCacheReq + 1);
-    if (c == NULL || in == NULL || inSz == 0)
+    whMessageCommStatsRequest msg = {0};
+
+    if (c == NULL) {
         return WH_ERROR_BADARGS;
-    packet->keyCacheReq.id = keyId;
-    packet->keyCacheReq.flags = flags;
-    packet->keyCacheReq.sz = inSz;
-    if (label == NULL)
-        packet->keyCacheReq.labelSz = 0;
-    else {
-        packet->keyCacheReq.labelSz = labelSz;
-        /* write label */
-        if (labelSz > WOLFHSM_NVM_LABEL_LEN)
-            XMEMCPY(packet->keyCacheReq.label, label, WOLFHSM_NVM_LABEL_LEN);
-        else
-            XMEMCPY(packet->keyCacheReq.label, label, labelSz);
     }
-    /* write in */
-    XMEMCPY(packIn, in, inSz);
-    /* write request */
-    return wh_Client_SendRequest(c, WH_MESSAGE_GROUP_KEY, WH_KEY_CACHE,
-            WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->keyCacheReq) + inSz,
-            (uint8_t*)packet);
-}
 
-int wh_Client_KeyCacheRequest(whClientContext* c, uint32_t flags,
-    uint8_t* label, uint32_t labelSz, uint8_t* in, uint32_t inSz)
-{
-    return wh_Client_KeyCacheRequest_ex(c, flags, label, labelSz, in, inSz,
-        WOLFHSM_KEYID_ERASED);
+    msg.start = start;
+    msg.reset = reset;
+    return wh_Client_SendRequest(c,
+            WH_MESSAGE_GROUP_COMM, WH_MESSAGE_COMM_ACTION_STATS,
+            sizeof(msg), &msg);
 }
 
-int wh_Client_KeyCacheResponse(whClientContext* c, uint16_t* keyId)
+int wh_Client_CommStatsResponse(whClientContext* c, uint16_t* out_total,
+        uint16_t* inout_count, whMessageCommStatsEntry* entries)
 {
-    uint16_t group;
-    uint16_t action;
-    uint16_t size;
-    int ret;
-    whPacket packet[1] = {0};
-    if (c == NULL || keyId == NULL)
+    int rc = 0;
+    uint64_t buffer[WH_COMM_DATA_LEN / sizeof(uint64_t)];
+    whMessageCommStatsResponse* msg = (whMessageCommStatsResponse*)buffer;
+    uint16_t resp_group = 0;
+    uint16_t resp_action = 0;
+    uint16_t resp_size = 0;
+    uint16_t count = 0;
+
+    if (c == NULL) {
         return WH_ERROR_BADARGS;
-    ret = wh_Client_RecvResponse(c, &group, &action, &size, (uint8_t*)packet);
-    if (ret == 0) {
-        if (packet->rc != 0)
-            ret = packet->rc;
-        else
-            *keyId = packet->keyCacheRes.id;
     }
-    return ret;
+
+    rc = wh_Client_RecvResponse(c,
+            &resp_group, &resp_action,
+            &resp_size, buffer);
+    if (rc == 0) {
+        /* Validate response */
+        if (    (resp_group != WH_MESSAGE_GROUP_COMM) ||
+                (resp_action != WH_MESSAGE_COMM_ACTION_STATS) ||
+                (resp_size < sizeof(*msg)) ||
+                (resp_size < sizeof(*msg) +
+                    msg->count * sizeof(whMessageCommStatsEntry))) {
+            /* Invalid message */
+            rc = WH_ERROR_ABORTED;
+        } else {
+            /* Valid message */
+            count = msg->count;
+            if (inout_count != NULL) {
+                if (count > *inout_count) {
+                    count = *inout_count;
+                }
+                if ((entries != NULL) && (count > 0)) {
+                    memcpy(entries, msg + 1,
+                            count * sizeof(whMessageCommStatsEntry));
+                }
+                *inout_count = count;
+            }
+            if (out_total != NULL) {
+                *out_total = msg->total;
+            }
+        }
+    }
+    return rc;
 }
 
-int wh_Client_KeyCache(whClientContext* c, uint32_t flags,
-    uint8_t* label, uint32_t labelSz, uint8_t* in, uint32_t inSz,
-    uint16_t* keyId)
+int wh_Client_CommStats(whClientContext* c, uint16_t start, uint8_t reset,
+        uint16_t* out_total, uint16_t* inout_count,
+        whMessageCommStatsEntry* entries)
 {
-    int ret;
-    ret = wh_Client_KeyCacheRequest_ex(c, flags, label, labelSz, in, inSz,
-        *keyId);
-    if (ret == 0) {
+    int rc = 0;
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+    do {
+        rc = wh_Client_CommStatsRequest(c, start, reset);
+    } while (rc == WH_ERROR_NOTREADY);
+
+    if (rc == 0) {
         do {
-            ret = wh_Client_KeyCacheResponse(c, keyId);
-        } while (ret == WH_ERROR_NOTREADY);
+            rc = wh_Client_CommStatsResponse(c, out_total, inout_count,
+                    entries);
+        } while (rc == WH_ERROR_NOTREADY);
     }
-    return ret;
+    return rc;
 }
 
-int wh_Client_KeyEvictRequest(whClientContext* c, uint16_t keyId)
+int wh_Client_DmaMapRequest(whClientContext* c, const void* addr, size_t len,
+        uint8_t access)
 {
-    whPacket packet[1] = {0};
-    if (c == NULL || keyId == WOLFHSM_KEYID_ERASED)
+    whMessageCommDmaMapRequest msg = {0};
+
+    if (    (c == NULL) ||
+            (addr == NULL) ||
+            (len == 0) ) {
         return WH_ERROR_BADARGS;
-    /* set the keyId */
-    packet->keyEvictReq.id = keyId;
-    /* write request */
-    return wh_Client_SendRequest(c, WH_MESSAGE_GROUP_KEY, WH_KEY_EVICT,
-            WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->keyEvictReq),
-            (uint8_t*)packet);
+    }
+
+    msg.addr = (uint64_t)(uintptr_t)addr;
+    msg.len = len;
+    msg.access = access;
+    return wh_Client_SendRequest(c,
+            WH_MESSAGE_GROUP_COMM, WH_MESSAGE_COMM_ACTION_DMAMAP,
+            sizeof(msg), &msg);
+}
+
+/* Shared by the map and unmap responses */
+static int _DmaMapResponse(whClientContext* c, uint16_t action,
+        int32_t* out_rc, uint32_t* out_handle)
+{
+    whMessageCommDmaMapResponse msg = {0};
+    int rc = 0;
+    uint16_t resp_group = 0;
+    uint16_t resp_action = 0;
+    uint16_t resp_size = 0;
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    rc = wh_Client_RecvResponse(c,
+            &resp_group, &resp_action,
+            &resp_size, &msg);
+    if (rc == 0) {
+        /* Validate response */
+        if (    (resp_group != WH_MESSAGE_GROUP_COMM) ||
+                (resp_action != action) ||
+                (resp_size != sizeof(msg)) ){
+            /* Invalid message */
+            rc = WH_ERROR_ABORTED;
+        } else {
+            /* Valid message */
+            if (out_rc != NULL) {
+                *out_rc = msg.rc;
+            }
+            if (out_handle != NULL) {
+                *out_handle = msg.handle;
+            }
+        }
+    }
+    return rc;
+}
+
+int wh_Client_DmaMapResponse(whClientContext* c, int32_t* out_rc,
+        uint32_t* out_handle)
+{
+    return _DmaMapResponse(c, WH_MESSAGE_COMM_ACTION_DMAMAP, out_rc,
+            out_handle);
+}
+
+int wh_Client_DmaMap(whClientContext* c, const void* addr, size_t len,
+        uint8_t access, int32_t* out_rc, uint32_t* out_handle)
+{
+    int rc = 0;
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+    do {
+        rc = wh_Client_DmaMapRequest(c, addr, len, access);
+    } while (rc == WH_ERROR_NOTREADY);
+
+    if (rc == 0) {
+        do {
+            rc = wh_Client_DmaMapResponse(c, out_rc, out_handle);
+        } while (rc == WH_ERROR_NOTREADY);
+    }
+    return rc;
+}
+
+int wh_Client_DmaUnmapRequest(whClientContext* c, uint32_t handle)
+{
+    whMessageCommDmaUnmapRequest msg = {0};
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    msg.handle = handle;
+    return wh_Client_SendRequest(c,
+            WH_MESSAGE_GROUP_COMM, WH_MESSAGE_COMM_ACTION_DMAUNMAP,
+            sizeof(msg), &msg);
+}
+
+int wh_Client_DmaUnmapResponse(whClientContext* c, int32_t* out_rc)
+{
+    return _DmaMapResponse(c, WH_MESSAGE_COMM_ACTION_DMAUNMAP, out_rc, NULL);
+}
+
+int wh_Client_DmaUnmap(whClientContext* c, uint32_t handle, int32_t* out_rc)
+{
+    int rc = 0;
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+    do {
+        rc = wh_Client_DmaUnmapRequest(c, handle);
+    } while (rc == WH_ERROR_NOTREADY);
+
+    if (rc == 0) {
+        do {
+            rc = wh_Client_DmaUnmapResponse(c, out_rc);
+        } while (rc == WH_ERROR_NOTREADY);
+    }
+    return rc;
+}
+
+int wh_Client_CustomCbRequest(whClientContext* c, const whMessageCustomCb_Request* req)
+{
+    if (NULL == c || req == NULL || req->id >= WH_CUSTOM_CB_NUM_CALLBACKS) {
+        return WH_ERROR_BADARGS;
+    }
+
+    return wh_Client_SendRequest(c, WH_MESSAGE_GROUP_CUSTOM, req->id,
+                                 sizeof(*req), req);
+}
+
+int wh_Client_CustomCbResponse(whClientContext*          c,
+                             whMessageCustomCb_Response* outResp)
+{
+    whMessageCustomCb_Response resp;
+    uint16_t                 resp_group  = 0;
+    uint16_t                 resp_action = 0;
+    uint16_t                 resp_size   = 0;
+    int32_t                  rc          = 0;
+
+    if (NULL == c || outResp == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    rc =
+        wh_Client_RecvResponse(c, &resp_group, &resp_action, &resp_size, &resp);
+    if (rc != WH_ERROR_OK) {
+        return rc;
+    }
+
+    if (resp_size != sizeof(resp) || resp_group != WH_MESSAGE_GROUP_CUSTOM ||
+        resp_action >= WH_CUSTOM_CB_NUM_CALLBACKS) {
+        /* message invalid */
+        return WH_ERROR_ABORTED;
+    }
+
+    memcpy(outResp, &resp, sizeof(resp));
+
+    return WH_ERROR_OK;
+}
+
+int wh_Client_CustomCheckRegisteredRequest(whClientContext* c, uint32_t id)
+{
+    whMessageCustomCb_Request req = {0};
+
+    if (c == NULL || id >= WH_CUSTOM_CB_NUM_CALLBACKS) {
+        return WH_ERROR_BADARGS;
+    }
+
+    req.id = id;
+    req.type = WH_MESSAGE_CUSTOM_CB_TYPE_QUERY;
+
+    return wh_Client_SendRequest(c, WH_MESSAGE_GROUP_CUSTOM, req.id,
+                                 sizeof(req), &req);
+}
+
+
+int wh_Client_CustomCbCheckRegisteredResponse(whClientContext* c, uint16_t* outId, int* responseError)
+{
+    int rc = 0;
+    whMessageCustomCb_Response resp = {0};
+
+    if (c == NULL || outId == NULL || responseError == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    rc = wh_Client_CustomCbResponse(c, &resp);
+    if (rc != WH_ERROR_OK) {
+        return rc;
+    }
+
+    if (resp.type != WH_MESSAGE_CUSTOM_CB_TYPE_QUERY) {
+        /* message invalid */
+        return WH_ERROR_ABORTED;
+    }
+
+    if (resp.err != WH_ERROR_OK && resp.err != WH_ERROR_NOHANDLER) {
+        /* error codes that aren't related to the query should be fatal */
+        return WH_ERROR_ABORTED;
+    }
+
+    *outId = resp.id;
+    *responseError = resp.err;
+
+    return WH_ERROR_OK;
+}
+
+
+int wh_Client_CustomCbCheckRegistered(whClientContext* c, uint16_t id, int* responseError)
+{
+    int rc = 0;
+
+    if (NULL == c || NULL == responseError || id >= WH_CUSTOM_CB_NUM_CALLBACKS) {
+        return WH_ERROR_BADARGS;
+    }
+
+    do {
+        rc = wh_Client_CustomCheckRegisteredRequest(c, id);
+    } while (rc == WH_ERROR_NOTREADY);
+
+    if (rc == WH_ERROR_OK) {
+        do {
+            rc = wh_Client_CustomCbCheckRegisteredResponse(c, &id, responseError);
+        } while (rc == WH_ERROR_NOTREADY);
+    }
+
+    return rc;
+}
+
+
+int wh_Client_CustomCbRawRequest(whClientContext* c, uint32_t id,
+                                 uint32_t type, uint16_t req_size,
+                                 const void* req_data)
+{
+    whMessageCustomCb_RawRequest hdr    = {0};
+    whCommIov                    iov[2];
+
+    if (NULL == c || (req_data == NULL && req_size != 0)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    hdr.id   = id;
+    hdr.type = type;
+
+    /* Payload is gathered straight from the caller's buffer, in fragments if
+     * it does not fit in a single packet */
+    iov[0].data = &hdr;
+    iov[0].len  = sizeof(hdr);
+    iov[1].data = req_data;
+    iov[1].len  = req_size;
+    return wh_Client_SendRequestFragV(c, WH_MESSAGE_GROUP_CUSTOM,
+                                      WH_MESSAGE_CUSTOM_CB_ACTION_RAW, 2, iov);
+}
+
+int wh_Client_CustomCbRawResponse(whClientContext* c, int32_t* out_rc,
+                                  uint16_t* inout_resp_size, void* resp_data)
+{
+    whMessageCustomCb_RawResponse resp;
+    uint8_t*                      packet      = NULL;
+    uint16_t                      resp_group  = 0;
+    uint16_t                      resp_action = 0;
+    uint16_t                      resp_size   = 0;
+    int                           rc          = 0;
+
+    if (NULL == c || out_rc == NULL || inout_resp_size == NULL ||
+        (resp_data == NULL && *inout_resp_size != 0)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    /* Receive in place and copy the payload out once */
+    packet = wh_CommClient_GetDataPtr(c->comm);
+    rc = wh_Client_RecvResponse(c, &resp_group, &resp_action, &resp_size,
+                                packet);
+    if (rc != WH_ERROR_OK) {
+        return rc;
+    }
+
+    if (resp_size < sizeof(resp) || resp_group != WH_MESSAGE_GROUP_CUSTOM ||
+        resp_action != WH_MESSAGE_CUSTOM_CB_ACTION_RAW) {
+        /* message invalid */
+        return WH_ERROR_ABORTED;
+    }
+
+    memcpy(&resp, packet, sizeof(resp));
+    if (resp.err != WH_ERROR_OK) {
+        return resp.err;
+    }
+
+    resp_size -= sizeof(resp);
+    if (resp_size > *inout_resp_size) {
+        return WH_ERROR_NOSPACE;
+    }
+    if (resp_size != 0 && resp_data != packet + sizeof(resp)) {
+        memcpy(resp_data, packet + sizeof(resp), resp_size);
+    }
+    *inout_resp_size = resp_size;
+    *out_rc          = resp.rc;
+
+    return WH_ERROR_OK;
+}
+
+int wh_Client_CustomCbRaw(whClientContext* c, uint32_t id, uint32_t type,
+                          uint16_t req_size, const void* req_data,
+                          int32_t* out_rc, uint16_t* inout_resp_size,
+                          void* resp_data)
+{
+    int rc = 0;
+
+    do {
+        rc = wh_Client_CustomCbRawRequest(c, id, type, req_size, req_data);
+    } while (rc == WH_ERROR_NOTREADY);
+
+    if (rc == WH_ERROR_OK) {
+        do {
+            rc = wh_Client_CustomCbRawResponse(c, out_rc, inout_resp_size,
+                                               resp_data);
+        } while (rc == WH_ERROR_NOTREADY);
+    }
+
+    return rc;
+}
+
+/** Counter functions */
+static int _CounterRequest(whClientContext* c, uint16_t action,
+        whCounterId id)
+{
+    whMessageCounter_Request msg = {0};
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    msg.id = id;
+    return wh_Client_SendRequest(c, WH_MESSAGE_GROUP_KEY, action,
+            sizeof(msg), &msg);
+}
+
+static int _CounterResponse(whClientContext* c, uint16_t action,
+        int32_t* out_rc, uint32_t* out_value)
+{
+    whMessageCounter_Response msg = {0};
+    int rc = 0;
+    uint16_t resp_group = 0;
+    uint16_t resp_action = 0;
+    uint16_t resp_size = 0;
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    rc = wh_Client_RecvResponse(c, &resp_group, &resp_action, &resp_size,
+            &msg);
+    if (rc == 0) {
+        /* Validate response */
+        if (    (resp_group != WH_MESSAGE_GROUP_KEY) ||
+                (resp_action != action) ||
+                (resp_size != sizeof(msg)) ){
+            /* Invalid message */
+            rc = WH_ERROR_ABORTED;
+        } else {
+            /* Valid message */
+            if (out_rc != NULL) {
+                *out_rc = msg.rc;
+            }
+            if (out_value != NULL) {
+                *out_value = msg.value;
+            }
+        }
+    }
+    return rc;
+}
+
+int wh_Client_CounterReadRequest(whClientContext* c, whCounterId id)
+{
+    return _CounterRequest(c, WH_MESSAGE_COUNTER_ACTION_READ, id);
+}
+
+int wh_Client_CounterReadResponse(whClientContext* c, int32_t* out_rc,
+        uint32_t* out_value)
+{
+    return _CounterResponse(c, WH_MESSAGE_COUNTER_ACTION_READ, out_rc,
+            out_value);
+}
+
+int wh_Client_CounterRead(whClientContext* c, whCounterId id,
+        int32_t* out_rc, uint32_t* out_value)
+{
+    int rc = 0;
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+    do {
+        rc = wh_Client_CounterReadRequest(c, id);
+    } while (rc == WH_ERROR_NOTREADY);
+
+    if (rc == 0) {
+        do {
+            rc = wh_Client_CounterReadResponse(c, out_rc, out_value);
+        } while (rc == WH_ERROR_NOTREADY);
+    }
+    return rc;
+}
+
+int wh_Client_CounterIncrementRequest(whClientContext* c, whCounterId id)
+{
+    return _CounterRequest(c, WH_MESSAGE_COUNTER_ACTION_INCREMENT, id);
+}
+
+int wh_Client_CounterIncrementResponse(whClientContext* c, int32_t* out_rc,
+        uint32_t* out_value)
+{
+    return _CounterResponse(c, WH_MESSAGE_COUNTER_ACTION_INCREMENT, out_rc,
+            out_value);
+}
+
+int wh_Client_CounterIncrement(whClientContext* c, whCounterId id,
+        int32_t* out_rc, uint32_t* out_value)
+{
+    int rc = 0;
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+    do {
+        rc = wh_Client_CounterIncrementRequest(c, id);
+    } while (rc == WH_ERROR_NOTREADY);
+
+    if (rc == 0) {
+        do {
+            rc = wh_Client_CounterIncrementResponse(c, out_rc, out_value);
+        } while (rc == WH_ERROR_NOTREADY);
+    }
+    return rc;
+}
+
+
+#ifndef WOLFHSM_NO_CRYPTO
+
+int wh_Client_KeyCacheRequest_ex(whClientContext* c, uint32_t flags,
+    uint8_t* label, uint32_t labelSz, uint8_t* in, uint32_t inSz,
+    uint16_t keyId)
+{
+    uint8_t rawPacket[WH_COMM_MTU] = {0};
+    whPacket* packet = (whPacket*)rawPacket;
+    uint8_t* packIn = (uint8_t*)(&packet->keyCacheReq + 1);
+    if (c == NULL || in == NULL || inSz == 0)
+        return WH_ERROR_BADARGS;
+    packet->keyCacheReq.id = keyId;
+    packet->keyCacheReq.flags = flags;
+    packet->keyCacheReq.sz = inSz;
+    if (label == NULL)
+        packet->keyCacheReq.labelSz = 0;
+    else {
+        packet->keyCacheReq.labelSz = labelSz;
+        /* write label */
+        if (labelSz > WOLFHSM_NVM_LABEL_LEN)
+            XMEMCPY(packet->keyCacheReq.label, label, WOLFHSM_NVM_LABEL_LEN);
+        else
+            XMEMCPY(packet->keyCacheReq.label, label, labelSz);
+    }
+    /* write in */
+    XMEMCPY(packIn, in, inSz);
+    /* write request */
+    return wh_Client_SendRequest(c, WH_MESSAGE_GROUP_KEY, WH_KEY_CACHE,
+            WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->keyCacheReq) + inSz,
+            (uint8_t*)packet);
+}
+
+int wh_Client_KeyCacheRequest(whClientContext* c, uint32_t flags,
+    uint8_t* label, uint32_t labelSz, uint8_t* in, uint32_t inSz)
+{
+    return wh_Client_KeyCacheRequest_ex(c, flags, label, labelSz, in, inSz,
+        WOLFHSM_KEYID_ERASED);
+}
+
+int wh_Client_KeyCacheResponse(whClientContext* c, uint16_t* keyId)
+{
+    uint16_t group;
+    uint16_t action;
+    uint16_t size;
+    int ret;
+    whPacket packet[1] = {0};
+    if (c == NULL || keyId == NULL)
+        return WH_ERROR_BADARGS;
+    ret = wh_Client_RecvResponse(c, &group, &action, &size, (uint8_t*)packet);
+    if (ret == 0) {
+        if (packet->rc != 0)
+            ret = packet->rc;
+        else
+            *keyId = packet->keyCacheRes.id;
+    }
+    return ret;
+}
+
+int wh_Client_KeyCache(whClientContext* c, uint32_t flags,
+    uint8_t* label, uint32_t labelSz, uint8_t* in, uint32_t inSz,
+    uint16_t* keyId)
+{
+    int ret;
+    ret = wh_Client_KeyCacheRequest_ex(c, flags, label, labelSz, in, inSz,
+        *keyId);
+    if (ret == 0) {
+        do {
+            ret = wh_Client_KeyCacheResponse(c, keyId);
+        } while (ret == WH_ERROR_NOTREADY);
+    }
+    return ret;
+}
+
+int wh_Client_KeyEvictRequest(whClientContext* c, uint16_t keyId)
+{
+    whPacket packet[1] = {0};
+    if (c == NULL || keyId == WOLFHSM_KEYID_ERASED)
+        return WH_ERROR_BADARGS;
+    /* set the keyId */
+    packet->keyEvictReq.id = keyId;
+    /* write request */
+    return wh_Client_SendRequest(c, WH_MESSAGE_GROUP_KEY, WH_KEY_EVICT,
+            WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->keyEvictReq),
+            (uint8_t*)packet);
 }
 
 int wh_Client_KeyEvictResponse(whClientContext* c)
@@ -559,198 +1162,1112 @@ int wh_Client_KeyEvictResponse(whClientContext* c)
     uint16_t group;
     uint16_t action;
     uint16_t size;
-    int ret;
-    whPacket packet[1] = {0};
-    if (c == NULL)
+    int ret;
+    whPacket packet[1] = {0};
+    if (c == NULL)
+        return WH_ERROR_BADARGS;
+    ret = wh_Client_RecvResponse(c, &group, &action, &size, (uint8_t*)packet);
+    if (ret == 0) {
+        if (packet->rc != 0)
+            ret = packet->rc;
+    }
+    return ret;
+}
+
+int wh_Client_KeyEvict(whClientContext* c, uint16_t keyId)
+{
+    int ret;
+    ret = wh_Client_KeyEvictRequest(c, keyId);
+    if (ret == 0) {
+        do {
+            ret = wh_Client_KeyEvictResponse(c);
+        } while (ret == WH_ERROR_NOTREADY);
+    }
+    return ret;
+}
+
+int wh_Client_KeyExportRequest(whClientContext* c, uint16_t keyId)
+{
+    whPacket packet[1] = {0};
+    if (c == NULL || keyId == WOLFHSM_KEYID_ERASED)
+        return WH_ERROR_BADARGS;
+    /* set keyId */
+    packet->keyExportReq.id = keyId;
+    /* write request */
+    return wh_Client_SendRequest(c, WH_MESSAGE_GROUP_KEY, WH_KEY_EXPORT,
+            WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->keyExportReq),
+            (uint8_t*)packet);
+}
+
+int wh_Client_KeyExportResponse(whClientContext* c, uint8_t* label,
+    uint32_t labelSz, uint8_t* out, uint32_t* outSz)
+{
+    uint16_t group;
+    uint16_t action;
+    uint16_t size;
+    int ret;
+    uint8_t rawPacket[WH_COMM_MTU] = {0};
+    whPacket* packet = (whPacket*)rawPacket;
+    uint8_t* packOut = (uint8_t*)(&packet->keyExportRes + 1);
+    if (c == NULL || outSz == NULL)
+        return WH_ERROR_BADARGS;
+    ret = wh_Client_RecvResponse(c, &group, &action, &size, rawPacket);
+    if (ret == 0) {
+        if (packet->rc != 0)
+            ret = packet->rc;
+        else  {
+            if (out == NULL) {
+                *outSz = packet->keyExportRes.len;
+            }
+            else if (*outSz < packet->keyExportRes.len) {
+                ret = WH_ERROR_ABORTED;
+            }
+            else {
+                XMEMCPY(out, packOut, packet->keyExportRes.len);
+                *outSz = packet->keyExportRes.len;
+            }
+            if (label != NULL) {
+                if (labelSz > sizeof(packet->keyExportRes.label)) {
+                    XMEMCPY(label, packet->keyExportRes.label,
+                        WOLFHSM_NVM_LABEL_LEN);
+                }
+                else
+                    XMEMCPY(label, packet->keyExportRes.label, labelSz);
+            }
+        }
+    }
+    return ret;
+}
+
+int wh_Client_KeyExport(whClientContext* c, uint16_t keyId,
+    uint8_t* label, uint32_t labelSz, uint8_t* out, uint32_t* outSz)
+{
+    int ret;
+    ret = wh_Client_KeyExportRequest(c, keyId);
+    if (ret == 0) {
+        do {
+            ret = wh_Client_KeyExportResponse(c, label, labelSz, out, outSz);
+        } while (ret == WH_ERROR_NOTREADY);
+    }
+    return ret;
+}
+
+int wh_Client_KeyCommitRequest(whClientContext* c, whNvmId keyId)
+{
+    whPacket packet[1] = {0};
+    if (c == NULL || keyId == WOLFHSM_KEYID_ERASED)
+        return WH_ERROR_BADARGS;
+    /* set keyId */
+    packet->keyCommitReq.id = keyId;
+    /* write request */
+    return wh_Client_SendRequest(c, WH_MESSAGE_GROUP_KEY, WH_KEY_COMMIT,
+            WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->keyCommitReq),
+            (uint8_t*)packet);
+}
+
+int wh_Client_KeyCommitResponse(whClientContext* c)
+{
+    uint16_t group;
+    uint16_t action;
+    uint16_t size;
+    int ret;
+    whPacket packet[1] = {0};
+    if (c == NULL)
+        return WH_ERROR_BADARGS;
+    ret = wh_Client_RecvResponse(c, &group, &action, &size, (uint8_t*)packet);
+    if (ret == 0) {
+        if (packet->rc != 0)
+            ret = packet->rc;
+    }
+    return ret;
+}
+
+int wh_Client_KeyCommit(whClientContext* c, whNvmId keyId)
+{
+    int ret;
+    ret = wh_Client_KeyCommitRequest(c, keyId);
+    if (ret == 0) {
+        do {
+            ret = wh_Client_KeyCommitResponse(c);
+        } while (ret == WH_ERROR_NOTREADY);
+    }
+    return ret;
+}
+
+int wh_Client_KeyCommitManyRequest(whClientContext* c, uint16_t count,
+    const whNvmId* keyIds)
+{
+    uint16_t i;
+    whPacket packet[1] = {0};
+    if (c == NULL || keyIds == NULL || count == 0 ||
+        count > WOLFHSM_PACKET_KEY_COMMIT_MANY_MAX) {
+        return WH_ERROR_BADARGS;
+    }
+    /* set keyIds */
+    packet->keyCommitManyReq.count = count;
+    for (i = 0; i < count; i++) {
+        if (keyIds[i] == WOLFHSM_KEYID_ERASED)
+            return WH_ERROR_BADARGS;
+        packet->keyCommitManyReq.ids[i] = keyIds[i];
+    }
+    /* write request */
+    return wh_Client_SendRequest(c, WH_MESSAGE_GROUP_KEY, WH_KEY_COMMIT_MANY,
+            WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->keyCommitManyReq),
+            (uint8_t*)packet);
+}
+
+int wh_Client_KeyCommitManyResponse(whClientContext* c)
+{
+    uint16_t group;
+    uint16_t action;
+    uint16_t size;
+    int ret;
+    whPacket packet[1] = {0};
+    if (c == NULL)
+        return WH_ERROR_BADARGS;
+    ret = wh_Client_RecvResponse(c, &group, &action, &size, (uint8_t*)packet);
+    if (ret == 0) {
+        if (packet->rc != 0)
+            ret = packet->rc;
+    }
+    return ret;
+}
+
+int wh_Client_KeyCommitMany(whClientContext* c, uint16_t count,
+    const whNvmId* keyIds)
+{
+    int ret = 0;
+    uint16_t chunk;
+    if (c == NULL || keyIds == NULL)
+        return WH_ERROR_BADARGS;
+    while (ret == 0 && count > 0) {
+        chunk = (count > WOLFHSM_PACKET_KEY_COMMIT_MANY_MAX) ?
+            WOLFHSM_PACKET_KEY_COMMIT_MANY_MAX : count;
+        ret = wh_Client_KeyCommitManyRequest(c, chunk, keyIds);
+        if (ret == 0) {
+            do {
+                ret = wh_Client_KeyCommitManyResponse(c);
+            } while (ret == WH_ERROR_NOTREADY);
+        }
+        keyIds += chunk;
+        count -= chunk;
+    }
+    return ret;
+}
+
+int wh_Client_KeyEraseRequest(whClientContext* c, whNvmId keyId)
+{
+    whPacket packet[1] = {0};
+    if (c == NULL || keyId == WOLFHSM_KEYID_ERASED)
+        return WH_ERROR_BADARGS;
+    /* set keyId */
+    packet->keyEraseReq.id = keyId;
+    /* write request */
+    return wh_Client_SendRequest(c, WH_MESSAGE_GROUP_KEY, WH_KEY_ERASE,
+            WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->keyEraseReq),
+            (uint8_t*)packet);
+}
+
+int wh_Client_KeyEraseResponse(whClientContext* c)
+{
+    uint16_t group;
+    uint16_t action;
+    uint16_t size;
+    int ret;
+    whPacket packet[1] = {0};
+    if (c == NULL)
+        return WH_ERROR_BADARGS;
+    ret = wh_Client_RecvResponse(c, &group, &action, &size, (uint8_t*)packet);
+    if (ret == 0) {
+        if (packet->rc != 0)
+            ret = packet->rc;
+    }
+    return ret;
+}
+
+int wh_Client_KeyErase(whClientContext* c, whNvmId keyId)
+{
+    int ret;
+    ret = wh_Client_KeyEraseRequest(c, keyId);
+    if (ret == 0) {
+        do {
+            ret = wh_Client_KeyEraseResponse(c);
+        } while (ret == WH_ERROR_NOTREADY);
+    }
+    return ret;
+}
+
+#ifdef HAVE_CURVE25519
+void wh_Client_SetKeyCurve25519(curve25519_key* key, whNvmId keyId)
+{
+    key->devCtx = (void*)((intptr_t)keyId);
+}
+#endif
+
+#ifndef NO_RSA
+void wh_Client_SetKeyRsa(RsaKey* key, whNvmId keyId)
+{
+    key->devCtx = (void*)((intptr_t)keyId);
+}
+#endif
+
+#ifndef NO_AES
+void wh_Client_SetKeyAes(Aes* key, whNvmId keyId)
+{
+    key->devCtx = (void*)((intptr_t)keyId);
+}
+
+int wh_Client_CipherSessionInitRequest(whClientContext* c, uint32_t type,
+    int enc, whNvmId keyId, const uint8_t* iv, uint32_t ivSz,
+    const uint8_t* authIn, uint32_t authInSz)
+{
+    uint8_t* packIn;
+    whPacket* packet;
+    if (c == NULL || keyId == WOLFHSM_KEYID_ERASED ||
+        (ivSz > 0 && iv == NULL) || (authInSz > 0 && authIn == NULL) ||
+        ivSz + authInSz > WOLFHSM_PACKET_CIPHER_SESSION_MAX_SZ) {
+        return WH_ERROR_BADARGS;
+    }
+    packet = (whPacket*)wh_CommClient_GetDataPtr(c->comm);
+    memset(&packet->cipherSessionReq, 0, sizeof(packet->cipherSessionReq));
+    /* iv and authIn are after fixed sized fields */
+    packIn = (uint8_t*)(&packet->cipherSessionReq + 1);
+    packet->cipherSessionReq.op = WH_CIPHER_SESSION_INIT;
+    packet->cipherSessionReq.type = type;
+    packet->cipherSessionReq.enc = (enc != 0);
+    packet->cipherSessionReq.keyId = keyId;
+    packet->cipherSessionReq.ivSz = ivSz;
+    packet->cipherSessionReq.authInSz = authInSz;
+    if (ivSz > 0)
+        memcpy(packIn, iv, ivSz);
+    if (authInSz > 0)
+        memcpy(packIn + ivSz, authIn, authInSz);
+    return wh_Client_SendRequest(c, WH_MESSAGE_GROUP_CRYPTO,
+        WH_CRYPTO_CIPHER_SESSION, WOLFHSM_PACKET_STUB_SIZE +
+        sizeof(packet->cipherSessionReq) + ivSz + authInSz, (uint8_t*)packet);
+}
+
+int wh_Client_CipherSessionInitResponse(whClientContext* c,
+    uint16_t* out_session)
+{
+    int ret;
+    uint16_t group;
+    uint16_t action;
+    uint16_t size;
+    whPacket* packet;
+    if (c == NULL || out_session == NULL)
+        return WH_ERROR_BADARGS;
+    packet = (whPacket*)wh_CommClient_GetDataPtr(c->comm);
+    ret = wh_Client_RecvResponse(c, &group, &action, &size, (uint8_t*)packet);
+    if (ret == 0) {
+        if (packet->rc != 0)
+            ret = packet->rc;
+        else
+            *out_session = (uint16_t)packet->cipherSessionRes.session;
+    }
+    return ret;
+}
+
+int wh_Client_CipherSessionInit(whClientContext* c, uint32_t type, int enc,
+    whNvmId keyId, const uint8_t* iv, uint32_t ivSz, const uint8_t* authIn,
+    uint32_t authInSz, uint16_t* out_session)
+{
+    int ret;
+    ret = wh_Client_CipherSessionInitRequest(c, type, enc, keyId, iv, ivSz,
+        authIn, authInSz);
+    if (ret == 0) {
+        do {
+            ret = wh_Client_CipherSessionInitResponse(c, out_session);
+        } while (ret == WH_ERROR_NOTREADY);
+    }
+    return ret;
+}
+
+int wh_Client_CipherSessionUpdateRequest(whClientContext* c, uint16_t session,
+    const uint8_t* in, uint32_t sz)
+{
+    uint8_t* packIn;
+    whPacket* packet;
+    if (c == NULL || (sz > 0 && in == NULL) ||
+        sz > WOLFHSM_PACKET_CIPHER_SESSION_MAX_SZ) {
+        return WH_ERROR_BADARGS;
+    }
+    packet = (whPacket*)wh_CommClient_GetDataPtr(c->comm);
+    memset(&packet->cipherSessionReq, 0, sizeof(packet->cipherSessionReq));
+    /* in is after fixed sized fields */
+    packIn = (uint8_t*)(&packet->cipherSessionReq + 1);
+    packet->cipherSessionReq.op = WH_CIPHER_SESSION_UPDATE;
+    packet->cipherSessionReq.session = session;
+    packet->cipherSessionReq.sz = sz;
+    if (sz > 0)
+        memcpy(packIn, in, sz);
+    return wh_Client_SendRequest(c, WH_MESSAGE_GROUP_CRYPTO,
+        WH_CRYPTO_CIPHER_SESSION, WOLFHSM_PACKET_STUB_SIZE +
+        sizeof(packet->cipherSessionReq) + sz, (uint8_t*)packet);
+}
+
+int wh_Client_CipherSessionUpdateResponse(whClientContext* c, uint8_t* out,
+    uint32_t* inout_sz)
+{
+    int ret;
+    uint16_t group;
+    uint16_t action;
+    uint16_t size;
+    uint8_t* packOut;
+    whPacket* packet;
+    if (c == NULL || inout_sz == NULL || (*inout_sz > 0 && out == NULL))
+        return WH_ERROR_BADARGS;
+    packet = (whPacket*)wh_CommClient_GetDataPtr(c->comm);
+    /* out is after fixed sized fields */
+    packOut = (uint8_t*)(&packet->cipherSessionRes + 1);
+    ret = wh_Client_RecvResponse(c, &group, &action, &size, (uint8_t*)packet);
+    if (ret == 0) {
+        if (packet->rc != 0)
+            ret = packet->rc;
+        else if (packet->cipherSessionRes.sz > *inout_sz)
+            ret = WH_ERROR_ABORTED;
+        else {
+            memcpy(out, packOut, packet->cipherSessionRes.sz);
+            *inout_sz = packet->cipherSessionRes.sz;
+        }
+    }
+    return ret;
+}
+
+int wh_Client_CipherSessionUpdate(whClientContext* c, uint16_t session,
+    const uint8_t* in, uint32_t sz, uint8_t* out)
+{
+    int ret = 0;
+    uint32_t chunk;
+    uint32_t outSz;
+    if (c == NULL || (sz > 0 && (in == NULL || out == NULL)))
+        return WH_ERROR_BADARGS;
+    while (ret == 0 && sz > 0) {
+        chunk = (sz > WOLFHSM_PACKET_CIPHER_SESSION_MAX_SZ) ?
+            WOLFHSM_PACKET_CIPHER_SESSION_MAX_SZ : sz;
+        ret = wh_Client_CipherSessionUpdateRequest(c, session, in, chunk);
+        if (ret == 0) {
+            do {
+                outSz = chunk;
+                ret = wh_Client_CipherSessionUpdateResponse(c, out, &outSz);
+            } while (ret == WH_ERROR_NOTREADY);
+        }
+        in += chunk;
+        out += chunk;
+        sz -= chunk;
+    }
+    return ret;
+}
+
+int wh_Client_CipherSessionFinalRequest(whClientContext* c, uint16_t session,
+    const uint8_t* authTag, uint32_t authTagSz)
+{
+    uint32_t sz = 0;
+    whPacket* packet;
+    if (c == NULL || authTagSz > WOLFHSM_PACKET_CIPHER_SESSION_MAX_SZ)
+        return WH_ERROR_BADARGS;
+    packet = (whPacket*)wh_CommClient_GetDataPtr(c->comm);
+    memset(&packet->cipherSessionReq, 0, sizeof(packet->cipherSessionReq));
+    packet->cipherSessionReq.op = WH_CIPHER_SESSION_FINAL;
+    packet->cipherSessionReq.session = session;
+    packet->cipherSessionReq.authTagSz = authTagSz;
+    /* the tag to check is after fixed sized fields */
+    if (authTag != NULL && authTagSz > 0) {
+        memcpy((uint8_t*)(&packet->cipherSessionReq + 1), authTag, authTagSz);
+        sz = authTagSz;
+    }
+    return wh_Client_SendRequest(c, WH_MESSAGE_GROUP_CRYPTO,
+        WH_CRYPTO_CIPHER_SESSION, WOLFHSM_PACKET_STUB_SIZE +
+        sizeof(packet->cipherSessionReq) + sz, (uint8_t*)packet);
+}
+
+int wh_Client_CipherSessionFinalResponse(whClientContext* c, uint8_t* authTag,
+    uint32_t authTagSz)
+{
+    int ret;
+    uint16_t group;
+    uint16_t action;
+    uint16_t size;
+    whPacket* packet;
+    if (c == NULL)
+        return WH_ERROR_BADARGS;
+    packet = (whPacket*)wh_CommClient_GetDataPtr(c->comm);
+    ret = wh_Client_RecvResponse(c, &group, &action, &size, (uint8_t*)packet);
+    if (ret == 0) {
+        if (packet->rc != 0)
+            ret = packet->rc;
+        else if (packet->cipherSessionRes.authTagSz > 0) {
+            /* the tag is after fixed sized fields */
+            if (authTag == NULL ||
+                packet->cipherSessionRes.authTagSz > authTagSz)
+                ret = WH_ERROR_ABORTED;
+            else {
+                memcpy(authTag, (uint8_t*)(&packet->cipherSessionRes + 1),
+                    packet->cipherSessionRes.authTagSz);
+            }
+        }
+    }
+    return ret;
+}
+
+int wh_Client_CipherSessionFinal(whClientContext* c, uint16_t session,
+    uint8_t* authTag, uint32_t authTagSz)
+{
+    int ret;
+    ret = wh_Client_CipherSessionFinalRequest(c, session, authTag, authTagSz);
+    if (ret == 0) {
+        do {
+            ret = wh_Client_CipherSessionFinalResponse(c, authTag, authTagSz);
+        } while (ret == WH_ERROR_NOTREADY);
+    }
+    return ret;
+}
+
+/* write the key field of a one-shot AES request and return its length.  A
+ * WOLFHSM_SYMMETRIC_INTERNAL server takes the cached key id, others take the
+ * key itself.  With key NULL only the length is returned */
+static uint32_t _Client_AesKeyWrite(Aes* aes, uint8_t* key)
+{
+#ifdef WOLFHSM_SYMMETRIC_INTERNAL
+    uint32_t keyId = (uint32_t)((intptr_t)aes->devCtx);
+    if (key != NULL)
+        memcpy(key, &keyId, sizeof(keyId));
+    return sizeof(keyId);
+#else
+    if (key != NULL)
+        memcpy(key, aes->devKey, aes->keylen);
+    return aes->keylen;
+#endif
+}
+
+#ifdef HAVE_AES_CBC
+int wh_Client_AesCbcRequest(whClientContext* c, Aes* aes, int enc,
+    const uint8_t* in, uint32_t sz)
+{
+    uint32_t keyLen;
+    uint8_t* key;
+    whPacket* packet;
+    if (c == NULL || aes == NULL || (sz > 0 && in == NULL))
+        return WH_ERROR_BADARGS;
+    keyLen = _Client_AesKeyWrite(aes, NULL);
+    if (    WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->cipherAesCbcReq) +
+            keyLen + AES_IV_SIZE + sz > WH_COMM_DATA_LEN) {
+        return WH_ERROR_BADARGS;
+    }
+    packet = (whPacket*)wh_CommClient_GetDataPtr(c->comm);
+    memset(&packet->cipherAesCbcReq, 0, sizeof(packet->cipherAesCbcReq));
+    packet->cipherAesCbcReq.type = WC_CIPHER_AES_CBC;
+    packet->cipherAesCbcReq.enc = (enc != 0);
+    packet->cipherAesCbcReq.keyLen = keyLen;
+    packet->cipherAesCbcReq.sz = sz;
+    /* key, iv and in are after the fixed size fields */
+    key = (uint8_t*)(&packet->cipherAesCbcReq + 1);
+    _Client_AesKeyWrite(aes, key);
+    memcpy(key + keyLen, aes->reg, AES_IV_SIZE);
+    if (sz > 0)
+        memcpy(key + keyLen + AES_IV_SIZE, in, sz);
+    return wh_Client_SendRequest(c, WH_MESSAGE_GROUP_CRYPTO,
+        WC_ALGO_TYPE_CIPHER, WOLFHSM_PACKET_STUB_SIZE +
+        sizeof(packet->cipherAesCbcReq) + keyLen + AES_IV_SIZE + sz,
+        (uint8_t*)packet);
+}
+
+int wh_Client_AesCbcResponse(whClientContext* c, uint8_t* out,
+    uint32_t* inout_sz)
+{
+    int ret;
+    uint16_t group;
+    uint16_t action;
+    uint16_t size;
+    whPacket* packet;
+    if (c == NULL || out == NULL || inout_sz == NULL)
         return WH_ERROR_BADARGS;
+    packet = (whPacket*)wh_CommClient_GetDataPtr(c->comm);
     ret = wh_Client_RecvResponse(c, &group, &action, &size, (uint8_t*)packet);
     if (ret == 0) {
         if (packet->rc != 0)
             ret = packet->rc;
+        else if (packet->cipherAesCbcRes.sz > *inout_sz)
+            ret = WH_ERROR_ABORTED;
+        else {
+            memcpy(out, &packet->cipherAesCbcRes + 1,
+                packet->cipherAesCbcRes.sz);
+            *inout_sz = packet->cipherAesCbcRes.sz;
+        }
     }
     return ret;
 }
 
-int wh_Client_KeyEvict(whClientContext* c, uint16_t keyId)
+int wh_Client_AesCbc(whClientContext* c, Aes* aes, int enc,
+    const uint8_t* in, uint32_t sz, uint8_t* out)
 {
     int ret;
-    ret = wh_Client_KeyEvictRequest(c, keyId);
+    uint32_t outSz = sz;
+    ret = wh_Client_AesCbcRequest(c, aes, enc, in, sz);
     if (ret == 0) {
         do {
-            ret = wh_Client_KeyEvictResponse(c);
+            ret = wh_Client_AesCbcResponse(c, out, &outSz);
         } while (ret == WH_ERROR_NOTREADY);
     }
     return ret;
 }
+#endif /* HAVE_AES_CBC */
 
-int wh_Client_KeyExportRequest(whClientContext* c, uint16_t keyId)
+#ifdef HAVE_AESGCM
+int wh_Client_AesGcmRequest(whClientContext* c, Aes* aes, int enc,
+    const uint8_t* in, uint32_t sz, const uint8_t* iv, uint32_t ivSz,
+    const uint8_t* authIn, uint32_t authInSz, const uint8_t* authTag,
+    uint32_t authTagSz)
 {
-    whPacket packet[1] = {0};
-    if (c == NULL || keyId == WOLFHSM_KEYID_ERASED)
+    uint32_t keyLen;
+    uint8_t* packIn;
+    whPacket* packet;
+    if (    (c == NULL) ||
+            (aes == NULL) ||
+            (sz > 0 && in == NULL) ||
+            (ivSz > 0 && iv == NULL) ||
+            (authInSz > 0 && authIn == NULL) ||
+            (enc == 0 && authTagSz > 0 && authTag == NULL)) {
         return WH_ERROR_BADARGS;
-    /* set keyId */
-    packet->keyExportReq.id = keyId;
-    /* write request */
-    return wh_Client_SendRequest(c, WH_MESSAGE_GROUP_KEY, WH_KEY_EXPORT,
-            WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->keyExportReq),
-            (uint8_t*)packet);
+    }
+    keyLen = _Client_AesKeyWrite(aes, NULL);
+    /* the tag travels in the request only when decrypting, but the response
+     * carries it after the output when encrypting */
+    if (    WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->cipherAesGcmReq) +
+            keyLen + ivSz + sz + authInSz + authTagSz > WH_COMM_DATA_LEN) {
+        return WH_ERROR_BADARGS;
+    }
+    packet = (whPacket*)wh_CommClient_GetDataPtr(c->comm);
+    memset(&packet->cipherAesGcmReq, 0, sizeof(packet->cipherAesGcmReq));
+    packet->cipherAesGcmReq.type = WC_CIPHER_AES_GCM;
+    packet->cipherAesGcmReq.enc = (enc != 0);
+    packet->cipherAesGcmReq.keyLen = keyLen;
+    packet->cipherAesGcmReq.sz = sz;
+    packet->cipherAesGcmReq.ivSz = ivSz;
+    packet->cipherAesGcmReq.authInSz = authInSz;
+    packet->cipherAesGcmReq.authTagSz = authTagSz;
+    /* key, iv, in, authIn and authTag are after the fixed size fields */
+    packIn = (uint8_t*)(&packet->cipherAesGcmReq + 1);
+    packIn += _Client_AesKeyWrite(aes, packIn);
+    if (ivSz > 0)
+        memcpy(packIn, iv, ivSz);
+    packIn += ivSz;
+    if (sz > 0)
+        memcpy(packIn, in, sz);
+    packIn += sz;
+    if (authInSz > 0)
+        memcpy(packIn, authIn, authInSz);
+    packIn += authInSz;
+    if (enc == 0) {
+        if (authTagSz > 0)
+            memcpy(packIn, authTag, authTagSz);
+        packIn += authTagSz;
+    }
+    return wh_Client_SendRequest(c, WH_MESSAGE_GROUP_CRYPTO,
+        WC_ALGO_TYPE_CIPHER, (uint16_t)(packIn - (uint8_t*)packet),
+        (uint8_t*)packet);
 }
 
-int wh_Client_KeyExportResponse(whClientContext* c, uint8_t* label,
-    uint32_t labelSz, uint8_t* out, uint32_t* outSz)
+int wh_Client_AesGcmResponse(whClientContext* c, uint8_t* out,
+    uint32_t* inout_sz, uint8_t* authTag, uint32_t authTagSz)
 {
+    int ret;
     uint16_t group;
     uint16_t action;
     uint16_t size;
-    int ret;
-    uint8_t rawPacket[WH_COMM_MTU] = {0};
-    whPacket* packet = (whPacket*)rawPacket;
-    uint8_t* packOut = (uint8_t*)(&packet->keyExportRes + 1);
-    if (c == NULL || outSz == NULL)
+    uint8_t* packOut;
+    whPacket* packet;
+    if (c == NULL || inout_sz == NULL || (*inout_sz > 0 && out == NULL))
         return WH_ERROR_BADARGS;
-    ret = wh_Client_RecvResponse(c, &group, &action, &size, rawPacket);
+    packet = (whPacket*)wh_CommClient_GetDataPtr(c->comm);
+    ret = wh_Client_RecvResponse(c, &group, &action, &size, (uint8_t*)packet);
     if (ret == 0) {
+        /* out and the encrypt tag are after the fixed size fields */
+        packOut = (uint8_t*)(&packet->cipherAesGcmRes + 1);
         if (packet->rc != 0)
             ret = packet->rc;
-        else  {
-            if (out == NULL) {
-                *outSz = packet->keyExportRes.len;
+        else if (    (packet->cipherAesGcmRes.sz > *inout_sz) ||
+                    (packet->cipherAesGcmRes.authTagSz > 0 &&
+                        (authTag == NULL ||
+                        packet->cipherAesGcmRes.authTagSz > authTagSz))) {
+            ret = WH_ERROR_ABORTED;
+        }
+        else {
+            if (packet->cipherAesGcmRes.sz > 0)
+                memcpy(out, packOut, packet->cipherAesGcmRes.sz);
+            *inout_sz = packet->cipherAesGcmRes.sz;
+            if (packet->cipherAesGcmRes.authTagSz > 0) {
+                memcpy(authTag, packOut + packet->cipherAesGcmRes.sz,
+                    packet->cipherAesGcmRes.authTagSz);
             }
-            else if (*outSz < packet->keyExportRes.len) {
+        }
+    }
+    return ret;
+}
+
+int wh_Client_AesGcm(whClientContext* c, Aes* aes, int enc,
+    const uint8_t* in, uint32_t sz, const uint8_t* iv, uint32_t ivSz,
+    const uint8_t* authIn, uint32_t authInSz, uint8_t* authTag,
+    uint32_t authTagSz, uint8_t* out)
+{
+    int ret;
+    uint32_t outSz = sz;
+    ret = wh_Client_AesGcmRequest(c, aes, enc, in, sz, iv, ivSz, authIn,
+        authInSz, authTag, authTagSz);
+    if (ret == 0) {
+        do {
+            ret = wh_Client_AesGcmResponse(c, out, &outSz,
+                (enc != 0) ? authTag : NULL, authTagSz);
+        } while (ret == WH_ERROR_NOTREADY);
+    }
+    return ret;
+}
+#endif /* HAVE_AESGCM */
+#endif /* !NO_AES */
+
+/* send a hash session request with no inline data */
+static int _Client_HashSessionSend(whClientContext* c, uint32_t op, uint32_t type,
+    whNvmId keyId, uint16_t session, uint64_t in, uint32_t sz)
+{
+    whPacket* packet;
+    if (c == NULL)
+        return WH_ERROR_BADARGS;
+    packet = (whPacket*)wh_CommClient_GetDataPtr(c->comm);
+    memset(&packet->hashSessionReq, 0, sizeof(packet->hashSessionReq));
+    packet->hashSessionReq.op = op;
+    packet->hashSessionReq.type = type;
+    packet->hashSessionReq.keyId = keyId;
+    packet->hashSessionReq.session = session;
+    packet->hashSessionReq.in = in;
+    packet->hashSessionReq.sz = sz;
+    return wh_Client_SendRequest(c, WH_MESSAGE_GROUP_CRYPTO,
+        WH_CRYPTO_HASH_SESSION, WOLFHSM_PACKET_STUB_SIZE +
+        sizeof(packet->hashSessionReq), (uint8_t*)packet);
+}
+
+/* receive a hash session response, copying out the digest if any */
+static int _Client_HashSessionRecv(whClientContext* c, uint16_t* out_session,
+    uint8_t* out, uint32_t* inout_sz)
+{
+    int ret;
+    uint16_t group;
+    uint16_t action;
+    uint16_t size;
+    whPacket* packet;
+    if (c == NULL)
+        return WH_ERROR_BADARGS;
+    packet = (whPacket*)wh_CommClient_GetDataPtr(c->comm);
+    ret = wh_Client_RecvResponse(c, &group, &action, &size, (uint8_t*)packet);
+    if (ret == 0) {
+        if (packet->rc != 0)
+            ret = packet->rc;
+        else if (inout_sz != NULL) {
+            /* the digest is after fixed sized fields */
+            if (out == NULL || packet->hashSessionRes.sz > *inout_sz)
                 ret = WH_ERROR_ABORTED;
-            }
             else {
-                XMEMCPY(out, packOut, packet->keyExportRes.len);
-                *outSz = packet->keyExportRes.len;
-            }
-            if (label != NULL) {
-                if (labelSz > sizeof(packet->keyExportRes.label)) {
-                    XMEMCPY(label, packet->keyExportRes.label,
-                        WOLFHSM_NVM_LABEL_LEN);
-                }
-                else
-                    XMEMCPY(label, packet->keyExportRes.label, labelSz);
+                memcpy(out, (uint8_t*)(&packet->hashSessionRes + 1),
+                    packet->hashSessionRes.sz);
+                *inout_sz = packet->hashSessionRes.sz;
             }
         }
+        if (ret == 0 && out_session != NULL)
+            *out_session = (uint16_t)packet->hashSessionRes.session;
     }
     return ret;
 }
 
-int wh_Client_KeyExport(whClientContext* c, uint16_t keyId,
-    uint8_t* label, uint32_t labelSz, uint8_t* out, uint32_t* outSz)
+int wh_Client_HashSessionInitRequest(whClientContext* c, uint32_t type,
+    whNvmId keyId)
+{
+    return _Client_HashSessionSend(c, WH_HASH_SESSION_INIT, type, keyId, 0, 0, 0);
+}
+
+int wh_Client_HashSessionInitResponse(whClientContext* c,
+    uint16_t* out_session)
+{
+    if (out_session == NULL)
+        return WH_ERROR_BADARGS;
+    return _Client_HashSessionRecv(c, out_session, NULL, NULL);
+}
+
+int wh_Client_HashSessionInit(whClientContext* c, uint32_t type,
+    whNvmId keyId, uint16_t* out_session)
 {
     int ret;
-    ret = wh_Client_KeyExportRequest(c, keyId);
+    if (out_session == NULL)
+        return WH_ERROR_BADARGS;
+    ret = wh_Client_HashSessionInitRequest(c, type, keyId);
     if (ret == 0) {
         do {
-            ret = wh_Client_KeyExportResponse(c, label, labelSz, out, outSz);
+            ret = wh_Client_HashSessionInitResponse(c, out_session);
         } while (ret == WH_ERROR_NOTREADY);
     }
     return ret;
 }
 
-int wh_Client_KeyCommitRequest(whClientContext* c, whNvmId keyId)
+int wh_Client_HashSessionUpdateRequest(whClientContext* c, uint16_t session,
+    const uint8_t* in, uint32_t sz)
 {
-    whPacket packet[1] = {0};
-    if (c == NULL || keyId == WOLFHSM_KEYID_ERASED)
+    whPacket* packet;
+    if (c == NULL || (sz > 0 && in == NULL) ||
+        sz > WOLFHSM_PACKET_HASH_SESSION_MAX_SZ) {
         return WH_ERROR_BADARGS;
-    /* set keyId */
-    packet->keyCommitReq.id = keyId;
-    /* write request */
-    return wh_Client_SendRequest(c, WH_MESSAGE_GROUP_KEY, WH_KEY_COMMIT,
-            WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->keyCommitReq),
-            (uint8_t*)packet);
+    }
+    packet = (whPacket*)wh_CommClient_GetDataPtr(c->comm);
+    memset(&packet->hashSessionReq, 0, sizeof(packet->hashSessionReq));
+    packet->hashSessionReq.op = WH_HASH_SESSION_UPDATE;
+    packet->hashSessionReq.session = session;
+    packet->hashSessionReq.sz = sz;
+    /* in is after fixed sized fields */
+    if (sz > 0)
+        memcpy((uint8_t*)(&packet->hashSessionReq + 1), in, sz);
+    return wh_Client_SendRequest(c, WH_MESSAGE_GROUP_CRYPTO,
+        WH_CRYPTO_HASH_SESSION, WOLFHSM_PACKET_STUB_SIZE +
+        sizeof(packet->hashSessionReq) + sz, (uint8_t*)packet);
 }
 
-int wh_Client_KeyCommitResponse(whClientContext* c)
+int wh_Client_HashSessionUpdateDmaRequest(whClientContext* c,
+    uint16_t session, const uint8_t* in, uint32_t sz)
+{
+    if (sz > 0 && in == NULL)
+        return WH_ERROR_BADARGS;
+    return _Client_HashSessionSend(c, WH_HASH_SESSION_UPDATE_DMA, 0, 0, session,
+        (uint64_t)(uintptr_t)in, sz);
+}
+
+int wh_Client_HashSessionUpdateResponse(whClientContext* c)
+{
+    return _Client_HashSessionRecv(c, NULL, NULL, NULL);
+}
+
+int wh_Client_HashSessionUpdate(whClientContext* c, uint16_t session,
+    const uint8_t* in, uint32_t sz)
+{
+    int ret = 0;
+    uint32_t chunk;
+    if (c == NULL || (sz > 0 && in == NULL))
+        return WH_ERROR_BADARGS;
+    while (ret == 0 && sz > 0) {
+        chunk = (sz > WOLFHSM_PACKET_HASH_SESSION_MAX_SZ) ?
+            WOLFHSM_PACKET_HASH_SESSION_MAX_SZ : sz;
+        ret = wh_Client_HashSessionUpdateRequest(c, session, in, chunk);
+        if (ret == 0) {
+            do {
+                ret = wh_Client_HashSessionUpdateResponse(c);
+            } while (ret == WH_ERROR_NOTREADY);
+        }
+        in += chunk;
+        sz -= chunk;
+    }
+    return ret;
+}
+
+int wh_Client_HashSessionUpdateDma(whClientContext* c, uint16_t session,
+    const uint8_t* in, uint32_t sz)
+{
+    int ret;
+    ret = wh_Client_HashSessionUpdateDmaRequest(c, session, in, sz);
+    if (ret == 0) {
+        do {
+            ret = wh_Client_HashSessionUpdateResponse(c);
+        } while (ret == WH_ERROR_NOTREADY);
+    }
+    return ret;
+}
+
+int wh_Client_HashSessionFinalRequest(whClientContext* c, uint16_t session)
+{
+    return _Client_HashSessionSend(c, WH_HASH_SESSION_FINAL, 0, 0, session, 0, 0);
+}
+
+int wh_Client_HashSessionFinalResponse(whClientContext* c, uint8_t* out,
+    uint32_t* inout_sz)
+{
+    if (inout_sz == NULL)
+        return WH_ERROR_BADARGS;
+    return _Client_HashSessionRecv(c, NULL, out, inout_sz);
+}
+
+int wh_Client_HashSessionFinal(whClientContext* c, uint16_t session,
+    uint8_t* out, uint32_t* inout_sz)
+{
+    int ret;
+    if (inout_sz == NULL)
+        return WH_ERROR_BADARGS;
+    ret = wh_Client_HashSessionFinalRequest(c, session);
+    if (ret == 0) {
+        do {
+            ret = wh_Client_HashSessionFinalResponse(c, out, inout_sz);
+        } while (ret == WH_ERROR_NOTREADY);
+    }
+    return ret;
+}
+
+#ifdef HAVE_ECC
+int wh_Client_EccSignRequest(whClientContext* c, whNvmId keyId, int curveId,
+    const uint8_t* hash, uint32_t hashSz)
+{
+    whPacket* packet;
+    if (    (c == NULL) ||
+            (hashSz > 0 && hash == NULL) ||
+            (WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->pkEccSignReq) +
+                hashSz > WH_COMM_DATA_LEN)) {
+        return WH_ERROR_BADARGS;
+    }
+    packet = (whPacket*)wh_CommClient_GetDataPtr(c->comm);
+    packet->pkEccSignReq.type = WC_PK_TYPE_ECDSA_SIGN;
+    packet->pkEccSignReq.keyId = keyId;
+    packet->pkEccSignReq.curveId = curveId;
+    packet->pkEccSignReq.sz = hashSz;
+    /* hash is after the fixed size fields */
+    if (hashSz > 0)
+        memcpy(&packet->pkEccSignReq + 1, hash, hashSz);
+    return wh_Client_SendRequest(c, WH_MESSAGE_GROUP_CRYPTO, WC_ALGO_TYPE_PK,
+        WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->pkEccSignReq) + hashSz,
+        (uint8_t*)packet);
+}
+
+int wh_Client_EccSignResponse(whClientContext* c, uint8_t* sig,
+    uint32_t* inout_sigSz)
 {
+    int ret;
     uint16_t group;
     uint16_t action;
     uint16_t size;
-    int ret;
-    whPacket packet[1] = {0};
-    if (c == NULL)
+    whPacket* packet;
+    if (c == NULL || sig == NULL || inout_sigSz == NULL)
         return WH_ERROR_BADARGS;
+    packet = (whPacket*)wh_CommClient_GetDataPtr(c->comm);
     ret = wh_Client_RecvResponse(c, &group, &action, &size, (uint8_t*)packet);
     if (ret == 0) {
         if (packet->rc != 0)
             ret = packet->rc;
+        else if (packet->pkEccSignRes.sz > *inout_sigSz)
+            ret = WH_ERROR_ABORTED;
+        else {
+            memcpy(sig, &packet->pkEccSignRes + 1, packet->pkEccSignRes.sz);
+            *inout_sigSz = packet->pkEccSignRes.sz;
+        }
     }
     return ret;
 }
 
-int wh_Client_KeyCommit(whClientContext* c, whNvmId keyId)
+int wh_Client_EccSign(whClientContext* c, whNvmId keyId, int curveId,
+    const uint8_t* hash, uint32_t hashSz, uint8_t* sig, uint32_t* inout_sigSz)
 {
     int ret;
-    ret = wh_Client_KeyCommitRequest(c, keyId);
+    ret = wh_Client_EccSignRequest(c, keyId, curveId, hash, hashSz);
     if (ret == 0) {
         do {
-            ret = wh_Client_KeyCommitResponse(c);
+            ret = wh_Client_EccSignResponse(c, sig, inout_sigSz);
         } while (ret == WH_ERROR_NOTREADY);
     }
     return ret;
 }
 
-int wh_Client_KeyEraseRequest(whClientContext* c, whNvmId keyId)
+int wh_Client_EccVerifyRequest(whClientContext* c, whNvmId keyId,
+    int curveId, const uint8_t* sig, uint32_t sigSz, const uint8_t* hash,
+    uint32_t hashSz)
 {
-    whPacket packet[1] = {0};
-    if (c == NULL || keyId == WOLFHSM_KEYID_ERASED)
+    uint8_t* packIn;
+    whPacket* packet;
+    if (    (c == NULL) ||
+            (sigSz > 0 && sig == NULL) ||
+            (hashSz > 0 && hash == NULL) ||
+            (WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->pkEccVerifyReq) +
+                sigSz + hashSz > WH_COMM_DATA_LEN)) {
         return WH_ERROR_BADARGS;
-    /* set keyId */
-    packet->keyEraseReq.id = keyId;
-    /* write request */
-    return wh_Client_SendRequest(c, WH_MESSAGE_GROUP_KEY, WH_KEY_ERASE,
-            WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->keyEraseReq),
-            (uint8_t*)packet);
+    }
+    packet = (whPacket*)wh_CommClient_GetDataPtr(c->comm);
+    packet->pkEccVerifyReq.type = WC_PK_TYPE_ECDSA_VERIFY;
+    packet->pkEccVerifyReq.keyId = keyId;
+    packet->pkEccVerifyReq.curveId = curveId;
+    packet->pkEccVerifyReq.sigSz = sigSz;
+    packet->pkEccVerifyReq.hashSz = hashSz;
+    /* sig and hash are after the fixed size fields */
+    packIn = (uint8_t*)(&packet->pkEccVerifyReq + 1);
+    if (sigSz > 0)
+        memcpy(packIn, sig, sigSz);
+    if (hashSz > 0)
+        memcpy(packIn + sigSz, hash, hashSz);
+    return wh_Client_SendRequest(c, WH_MESSAGE_GROUP_CRYPTO, WC_ALGO_TYPE_PK,
+        WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->pkEccVerifyReq) + sigSz +
+        hashSz, (uint8_t*)packet);
 }
 
-int wh_Client_KeyEraseResponse(whClientContext* c)
+int wh_Client_EccVerifyResponse(whClientContext* c, int* out_res)
 {
+    int ret;
     uint16_t group;
     uint16_t action;
     uint16_t size;
+    whPacket* packet;
+    if (c == NULL || out_res == NULL)
+        return WH_ERROR_BADARGS;
+    packet = (whPacket*)wh_CommClient_GetDataPtr(c->comm);
+    ret = wh_Client_RecvResponse(c, &group, &action, &size, (uint8_t*)packet);
+    if (ret == 0) {
+        if (packet->rc != 0)
+            ret = packet->rc;
+        else
+            *out_res = (int)packet->pkEccVerifyRes.res;
+    }
+    return ret;
+}
+
+int wh_Client_EccVerify(whClientContext* c, whNvmId keyId, int curveId,
+    const uint8_t* sig, uint32_t sigSz, const uint8_t* hash, uint32_t hashSz,
+    int* out_res)
+{
     int ret;
-    whPacket packet[1] = {0};
-    if (c == NULL)
+    ret = wh_Client_EccVerifyRequest(c, keyId, curveId, sig, sigSz, hash,
+        hashSz);
+    if (ret == 0) {
+        do {
+            ret = wh_Client_EccVerifyResponse(c, out_res);
+        } while (ret == WH_ERROR_NOTREADY);
+    }
+    return ret;
+}
+
+int wh_Client_EccVerifyBatchRequest(whClientContext* c, int curveId,
+    const whClientEccVerifyItem* items, uint16_t count)
+{
+    uint32_t sz;
+    uint16_t i;
+    uint8_t* out;
+    whPacket* packet;
+    wh_Packet_pk_ecc_verify_batch_entry* entry;
+    if (    (c == NULL) ||
+            (items == NULL && count > 0) ||
+            (count > WOLFHSM_PACKET_ECC_VERIFY_BATCH_MAX)) {
+        return WH_ERROR_BADARGS;
+    }
+    /* make sure everything fits before touching the packet */
+    sz = WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->pkEccVerifyBatchReq);
+    for (i = 0; i < count; i++) {
+        if (items[i].sig == NULL || items[i].hash == NULL)
+            return WH_ERROR_BADARGS;
+        sz += sizeof(*entry) + items[i].sigSz + items[i].hashSz;
+    }
+    if (sz > WH_COMM_DATA_LEN)
+        return WH_ERROR_BADARGS;
+    packet = (whPacket*)wh_CommClient_GetDataPtr(c->comm);
+    packet->pkEccVerifyBatchReq.curveId = curveId;
+    packet->pkEccVerifyBatchReq.count = count;
+    /* entries are after the fixed size fields */
+    out = (uint8_t*)(&packet->pkEccVerifyBatchReq + 1);
+    for (i = 0; i < count; i++) {
+        entry = (wh_Packet_pk_ecc_verify_batch_entry*)out;
+        entry->keyId = items[i].keyId;
+        entry->sigSz = items[i].sigSz;
+        entry->hashSz = items[i].hashSz;
+        out += sizeof(*entry);
+        memcpy(out, items[i].sig, items[i].sigSz);
+        out += items[i].sigSz;
+        memcpy(out, items[i].hash, items[i].hashSz);
+        out += items[i].hashSz;
+    }
+    return wh_Client_SendRequest(c, WH_MESSAGE_GROUP_CRYPTO,
+        WH_CRYPTO_ECC_VERIFY_BATCH, sz, (uint8_t*)packet);
+}
+
+int wh_Client_EccVerifyBatchResponse(whClientContext* c, uint32_t* out_res)
+{
+    int ret;
+    uint16_t group;
+    uint16_t action;
+    uint16_t size;
+    whPacket* packet;
+    if (c == NULL || out_res == NULL)
         return WH_ERROR_BADARGS;
+    packet = (whPacket*)wh_CommClient_GetDataPtr(c->comm);
     ret = wh_Client_RecvResponse(c, &group, &action, &size, (uint8_t*)packet);
     if (ret == 0) {
         if (packet->rc != 0)
             ret = packet->rc;
+        else
+            *out_res = packet->pkEccVerifyBatchRes.res;
     }
     return ret;
 }
 
-int wh_Client_KeyErase(whClientContext* c, whNvmId keyId)
+int wh_Client_EccVerifyBatch(whClientContext* c, int curveId,
+    const whClientEccVerifyItem* items, uint16_t count, uint32_t* out_res)
 {
     int ret;
-    ret = wh_Client_KeyEraseRequest(c, keyId);
+    ret = wh_Client_EccVerifyBatchRequest(c, curveId, items, count);
     if (ret == 0) {
         do {
-            ret = wh_Client_KeyEraseResponse(c);
+            ret = wh_Client_EccVerifyBatchResponse(c, out_res);
         } while (ret == WH_ERROR_NOTREADY);
     }
     return ret;
 }
+#endif /* HAVE_ECC */
 
-#ifdef HAVE_CURVE25519
-void wh_Client_SetKeyCurve25519(curve25519_key* key, whNvmId keyId)
+int wh_Client_ImageVerifyRequest(whClientContext* c, whNvmId keyId,
+    uint32_t sigType, int curveId, uint32_t hashType, const uint8_t* image,
+    uint64_t imageSz, const uint8_t* sig, uint32_t sigSz)
 {
-    key->devCtx = (void*)((intptr_t)keyId);
+    uint32_t sz;
+    whPacket* packet;
+    if (    (c == NULL) ||
+            (image == NULL && imageSz > 0) ||
+            (sig == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    sz = WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->imageVerifyReq);
+    if (sigSz > WH_COMM_DATA_LEN - sz)
+        return WH_ERROR_BADARGS;
+    packet = (whPacket*)wh_CommClient_GetDataPtr(c->comm);
+    /* the image stays in client memory */
+    packet->imageVerifyReq.addr = (uintptr_t)image;
+    packet->imageVerifyReq.sz = imageSz;
+    packet->imageVerifyReq.keyId = keyId;
+    packet->imageVerifyReq.hashType = hashType;
+    packet->imageVerifyReq.sigType = sigType;
+    packet->imageVerifyReq.curveId = curveId;
+    packet->imageVerifyReq.sigSz = sigSz;
+    /* sig is after the fixed size fields */
+    memcpy((uint8_t*)(&packet->imageVerifyReq + 1), sig, sigSz);
+    return wh_Client_SendRequest(c, WH_MESSAGE_GROUP_IMAGE, WH_IMAGE_VERIFY,
+        sz + sigSz, (uint8_t*)packet);
 }
-#endif
 
-#ifndef NO_RSA
-void wh_Client_SetKeyRsa(RsaKey* key, whNvmId keyId)
+int wh_Client_ImageVerifyResponse(whClientContext* c, int* out_res)
 {
-    key->devCtx = (void*)((intptr_t)keyId);
+    int ret;
+    uint16_t group;
+    uint16_t action;
+    uint16_t size;
+    whPacket* packet;
+    if (c == NULL || out_res == NULL)
+        return WH_ERROR_BADARGS;
+    packet = (whPacket*)wh_CommClient_GetDataPtr(c->comm);
+    ret = wh_Client_RecvResponse(c, &group, &action, &size, (uint8_t*)packet);
+    if (ret == 0) {
+        if (packet->rc != 0)
+            ret = packet->rc;
+        else
+            *out_res = (int)packet->imageVerifyRes.res;
+    }
+    return ret;
 }
-#endif
 
-#ifndef NO_AES
-void wh_Client_SetKeyAes(Aes* key, whNvmId keyId)
+int wh_Client_ImageVerify(whClientContext* c, whNvmId keyId,
+    uint32_t sigType, int curveId, uint32_t hashType, const uint8_t* image,
+    uint64_t imageSz, const uint8_t* sig, uint32_t sigSz, int* out_res)
 {
-    key->devCtx = (void*)((intptr_t)keyId);
+    int ret;
+    ret = wh_Client_ImageVerifyRequest(c, keyId, sigType, curveId, hashType,
+        image, imageSz, sig, sigSz);
+    if (ret == 0) {
+        do {
+            ret = wh_Client_ImageVerifyResponse(c, out_res);
+        } while (ret == WH_ERROR_NOTREADY);
+    }
+    return ret;
 }
-#endif
 #endif  /* !WOLFHSM_NO_CRYPTO */
@@ -54,37 +54,104 @@
 #include "wolfhsm/wh_message.h"
 #include "wolfhsm/wh_cryptocb.h"
 
-int wolfHSM_CryptoCb(int devId, wc_CryptoInfo* info, void* inCtx)
+#ifndef WC_NO_RNG
+/* fetch up to sz random bytes from the server in one request */
+static int _wolfHSM_RngFetch(whClientContext* ctx, uint8_t* rawPacket,
+    uint8_t* out, uint32_t sz, uint32_t* outSz)
 {
-#if 0
-    uint32_t field;
-    uint8_t* key;
-    uint8_t* iv;
-    uint8_t* authIn;
-    uint8_t* authTag;
-    uint8_t* sig;
-    uint8_t* hash;
+    int ret;
+    whPacket* packet = (whPacket*)rawPacket;
+    uint16_t group = WH_MESSAGE_GROUP_CRYPTO;
+    uint16_t action;
+    uint16_t dataSz;
+    if (sz > WOLFHSM_PACKET_RNG_MAX_SZ)
+        sz = WOLFHSM_PACKET_RNG_MAX_SZ;
+    packet->rngReq.sz = sz;
+    /* write request */
+    ret = wh_Client_SendRequest(ctx, group, WC_ALGO_TYPE_RNG,
+        WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->rngReq), rawPacket);
+    if (ret == 0) {
+        do {
+            ret = wh_Client_RecvResponse(ctx, &group, &action, &dataSz,
+                rawPacket);
+        } while (ret == WH_ERROR_NOTREADY);
+    }
+    if (ret == 0) {
+        if (packet->rc != 0)
+            ret = packet->rc;
+        else if (packet->rngRes.sz == 0 || packet->rngRes.sz > sz)
+            ret = WH_ERROR_ABORTED;
+        /* read out, which is after the fixed size fields */
+        else {
+            XMEMCPY(out, (uint8_t*)(&packet->rngRes + 1), packet->rngRes.sz);
+            *outSz = packet->rngRes.sz;
+        }
+    }
+    return ret;
+}
+
+/* fill out with random bytes.  Calls smaller than the cache are served from
+ * it, refilling it a whole block at a time, larger ones go to the server */
+static int _wolfHSM_RngGenerate(whClientContext* ctx, uint8_t* rawPacket,
+    uint8_t* out, uint32_t sz)
+{
+    int ret = 0;
+    uint32_t got = 0;
+#if WOLFHSM_CLIENT_RNG_CACHE_SIZE > 0
+    uint32_t take;
 #endif
+    while (ret == 0 && sz > 0) {
+#if WOLFHSM_CLIENT_RNG_CACHE_SIZE > 0
+        if (ctx->rngCacheLen > 0) {
+            /* cached bytes are handed out once and wiped */
+            take = (sz < ctx->rngCacheLen) ? sz : ctx->rngCacheLen;
+            ctx->rngCacheLen -= take;
+            XMEMCPY(out, ctx->rngCache + ctx->rngCacheLen, take);
+            XMEMSET(ctx->rngCache + ctx->rngCacheLen, 0, take);
+            out += take;
+            sz -= take;
+            continue;
+        }
+        if (sz < WOLFHSM_CLIENT_RNG_CACHE_SIZE) {
+            ret = _wolfHSM_RngFetch(ctx, rawPacket, ctx->rngCache,
+                WOLFHSM_CLIENT_RNG_CACHE_SIZE, &got);
+            if (ret == 0)
+                ctx->rngCacheLen = (uint16_t)got;
+            continue;
+        }
+#endif
+        ret = _wolfHSM_RngFetch(ctx, rawPacket, out, sz, &got);
+        if (ret == 0) {
+            out += got;
+            sz -= got;
+        }
+    }
+    return ret;
+}
+#endif /* !WC_NO_RNG */
+
+int wolfHSM_CryptoCb(int devId, wc_CryptoInfo* info, void* inCtx)
+{
     int ret = CRYPTOCB_UNAVAILABLE;
     whClientContext* ctx = inCtx;
-    uint8_t rawPacket[WH_COMM_DATA_LEN];
-    whPacket* packet = (whPacket*)rawPacket;
+    uint8_t* rawPacket;
+    whPacket* packet;
     uint16_t group = WH_MESSAGE_GROUP_CRYPTO;
     uint16_t action;
     uint16_t dataSz;
     uint8_t* in;
     uint8_t* out;
-    uint8_t* authIn;
-    uint8_t* authTag;
-    uint8_t* key;
-    uint8_t* iv;
-    uint8_t* sig;
-    uint8_t* hash;
 
-    if (devId == INVALID_DEVID || info == NULL)
+    if (devId == INVALID_DEVID || info == NULL || ctx == NULL)
         return BAD_FUNC_ARG;
 
-    XMEMSET(rawPacket, 0, sizeof(rawPacket));
+    /* build the request in place in the comm buffer, no stack copy. Only the
+     * stub needs clearing, every request sets all of its own fields */
+    rawPacket = wh_CommClient_GetDataPtr(ctx->comm);
+    if (rawPacket == NULL)
+        return BAD_FUNC_ARG;
+    packet = (whPacket*)rawPacket;
+    XMEMSET(packet, 0, WOLFHSM_PACKET_STUB_SIZE);
 
     switch (info->algo_type)
     {
@@ -98,149 +165,23 @@ int wolfHSM_CryptoCb(int devId, wc_CryptoInfo* info, void* inCtx)
 #ifndef NO_AES
 #ifdef HAVE_AES_CBC
         case WC_CIPHER_AES_CBC:
-            /* key, iv, in, and out are after fixed size fields */
-            key = (uint8_t*)(&packet->cipherAesCbcReq + 1);
-            out = (uint8_t*)(&packet->cipherAesCbcRes + 1);
-#ifdef WOLFHSM_SYMMETRIC_INTERNAL
-            /* set iv to be after key id */
-            iv = key + sizeof(uint32_t);
-            dataSz = sizeof(packet->cipherAesCbcReq) + sizeof(uint32_t) +
-                AES_IV_SIZE + info->cipher.aescbc.sz;
-            /* set keyLen, sizeof key id */
-            packet->cipherAesCbcReq.keyLen = sizeof(uint32_t);
-#else
-            iv = key + info->cipher.aescbc.aes->keylen;
-            dataSz = sizeof(packet->cipherAesCbcReq) +
-                info->cipher.aescbc.aes->keylen + AES_IV_SIZE +
-                info->cipher.aescbc.sz;
-            /* set keyLen */
-            packet->cipherAesCbcReq.keyLen =
-                info->cipher.aescbc.aes->keylen;
-#endif
-            /* set in to be after iv */
-            in = iv + AES_IV_SIZE;
-            /* set sz */
-            packet->cipherAesCbcReq.sz = info->cipher.aescbc.sz;
-#ifdef WOLFHSM_SYMMETRIC_INTERNAL
-            /* set keyId */
-            XMEMCPY(key, (void*)&info->cipher.aescbc.aes->devCtx,
-                sizeof(uint32_t));
-#else
-            /* set key */
-            XMEMCPY(key, info->cipher.aescbc.aes->devKey,
-                info->cipher.aescbc.aes->keylen);
-#endif
-            /* set iv */
-            XMEMCPY(iv, info->cipher.aescbc.aes->reg, AES_IV_SIZE);
-            /* set in */
-            XMEMCPY(in, info->cipher.aescbc.in, info->cipher.aescbc.sz);
-            /* write request */
-            ret = wh_Client_SendRequest(ctx, group,
-                WC_ALGO_TYPE_CIPHER,
-                WOLFHSM_PACKET_STUB_SIZE + dataSz,
-                rawPacket);
-            /* read response */
-            if (ret == 0) {
-                do {
-                    ret = wh_Client_RecvResponse(ctx, &group, &action, &dataSz,
-                        rawPacket);
-                } while (ret == WH_ERROR_NOTREADY);
-            }
-            if (ret == 0) {
-                if (packet->rc != 0)
-                    ret = packet->rc;
-                else {
-                    /* copy the response out */
-                    XMEMCPY(info->cipher.aescbc.out, out,
-                        packet->cipherAesCbcRes.sz);
-                }
-            }
+            ret = wh_Client_AesCbc(ctx, info->cipher.aescbc.aes,
+                info->cipher.enc, info->cipher.aescbc.in,
+                info->cipher.aescbc.sz, info->cipher.aescbc.out);
             break;
 #endif /* HAVE_AES_CBC */
 #ifdef HAVE_AESGCM
         case WC_CIPHER_AES_GCM:
-            /* key, iv, in, authIn, and out are after fixed size fields */
-            key = (uint8_t*)(&packet->cipherAesGcmReq + 1);
-            out = (uint8_t*)(&packet->cipherAesGcmRes + 1);
-#ifdef WOLFHSM_SYMMETRIC_INTERNAL
-            /* set iv to be after key id */
-            iv = key + sizeof(uint32_t);
-            dataSz = sizeof(packet->cipherAesGcmReq) + sizeof(uint32_t) +
-                info->cipher.aesgcm_enc.ivSz + info->cipher.aesgcm_enc.sz +
-                info->cipher.aesgcm_enc.authInSz +
-                info->cipher.aesgcm_enc.authTagSz;
-            /* set keyLen, sizeof key id */
-            packet->cipherAesGcmReq.keyLen = sizeof(uint32_t);
-#else
-            iv = key + info->cipher.aesgcm_enc.aes->keylen;
-            dataSz = sizeof(packet->cipherAesGcmReq) +
-                info->cipher.aesgcm_enc.aes->keylen +
-                info->cipher.aesgcm_enc.ivSz + info->cipher.aesgcm_enc.sz +
-                info->cipher.aesgcm_enc.authInSz +
-                info->cipher.aesgcm_enc.authTagSz;
-            /* set keyLen */
-            packet->cipherAesGcmReq.keyLen =
-                info->cipher.aesgcm_enc.aes->keylen;
-#endif
-            /* set the rest of the buffers */
-            in = iv + info->cipher.aesgcm_enc.ivSz;
-            authIn = in + info->cipher.aesgcm_enc.sz;
-            if (info->cipher.enc == 0)
-                authTag = authIn + info->cipher.aesgcm_enc.authInSz;
-            else
-                authTag = out + info->cipher.aesgcm_enc.sz;
-            /* set metadata */
-            packet->cipherAesGcmReq.sz = info->cipher.aesgcm_enc.sz;
-            packet->cipherAesGcmReq.ivSz = info->cipher.aesgcm_enc.ivSz;
-            packet->cipherAesGcmReq.authInSz = info->cipher.aesgcm_enc.authInSz;
-            packet->cipherAesGcmReq.authTagSz =
-                info->cipher.aesgcm_enc.authTagSz;
-#ifdef WOLFHSM_SYMMETRIC_INTERNAL
-            /* set keyId */
-            XMEMCPY(key, (uint8_t*)&info->cipher.aesgcm_enc.aes->devCtx,
-                sizeof(uint32_t));
-#else
-            /* set key */
-            XMEMCPY(key, info->cipher.aesgcm_enc.aes->devKey,
-                info->cipher.aesgcm_enc.aes->keylen);
-#endif
-            /* write the bulk data */
-            XMEMCPY(iv, info->cipher.aesgcm_enc.iv,
-                info->cipher.aesgcm_enc.ivSz);
-            XMEMCPY(in, info->cipher.aesgcm_enc.in, info->cipher.aesgcm_enc.sz);
-            XMEMCPY(authIn, info->cipher.aesgcm_enc.authIn,
-                info->cipher.aesgcm_enc.authInSz);
-            /* set auth tag by direction */
-            if (info->cipher.enc == 0) {
-                XMEMCPY(authTag, info->cipher.aesgcm_dec.authTag,
-                    info->cipher.aesgcm_enc.authTagSz);
-            }
-            /* write request */
-            ret = wh_Client_SendRequest(ctx, group,
-                WC_ALGO_TYPE_CIPHER,
-                WOLFHSM_PACKET_STUB_SIZE + dataSz,
-                rawPacket);
-            /* read response */
-            if (ret == 0) {
-                do {
-                    ret = wh_Client_RecvResponse(ctx, &group, &action, &dataSz,
-                        rawPacket);
-                } while (ret == WH_ERROR_NOTREADY);
-            }
-            if (ret == 0) {
-                if (packet->rc != 0)
-                    ret = packet->rc;
-                else {
-                    /* copy the response out */
-                    XMEMCPY(info->cipher.aesgcm_enc.out, out,
-                        packet->cipherAesGcmRes.sz);
-                    /* write the authTag if applicable */
-                    if (info->cipher.enc == 1) {
-                        XMEMCPY(info->cipher.aesgcm_enc.authTag, authTag,
-                            packet->cipherAesGcmRes.authTagSz);
-                    }
-                }
-            }
+            /* the tag is written when encrypting and checked when decrypting */
+            ret = wh_Client_AesGcm(ctx, info->cipher.aesgcm_enc.aes,
+                info->cipher.enc, info->cipher.aesgcm_enc.in,
+                info->cipher.aesgcm_enc.sz, info->cipher.aesgcm_enc.iv,
+                info->cipher.aesgcm_enc.ivSz, info->cipher.aesgcm_enc.authIn,
+                info->cipher.aesgcm_enc.authInSz,
+                (info->cipher.enc != 0) ? info->cipher.aesgcm_enc.authTag :
+                    (uint8_t*)info->cipher.aesgcm_dec.authTag,
+                info->cipher.aesgcm_enc.authTagSz,
+                info->cipher.aesgcm_enc.out);
             break;
 #endif /* HAVE_AESGCM */
 #endif /* NO_AES */
@@ -261,6 +202,8 @@ int wolfHSM_CryptoCb(int devId, wc_CryptoInfo* info, void* inCtx)
             packet->pkRsakgReq.size = info->pk.rsakg.size;
             /* set e */
             packet->pkRsakgReq.e = info->pk.rsakg.e;
+            /* keygen is slow, let the server run it as a job */
+            packet->flags = WOLFHSM_PACKET_FLAG_JOB;
             /* write request */
             ret = wh_Client_SendRequest(ctx, group,
                 WC_ALGO_TYPE_PK,
@@ -272,6 +215,20 @@ int wolfHSM_CryptoCb(int devId, wc_CryptoInfo* info, void* inCtx)
                         rawPacket);
                 } while (ret == WH_ERROR_NOTREADY);
             }
+            /* poll the job until the keygen response is ready */
+            if (    (ret == 0) &&
+                    (packet->rc == 0) &&
+                    ((packet->flags & WOLFHSM_PACKET_FLAG_JOB) != 0)) {
+                uint16_t jobId = (uint16_t)packet->jobRes.jobId;
+                int32_t jobRc = 0;
+                do {
+                    dataSz = WH_COMM_DATA_LEN;
+                    ret = wh_Client_Job(ctx, jobId, &jobRc, NULL, &dataSz,
+                        rawPacket);
+                } while ((ret == 0) && (jobRc == WH_ERROR_NOTREADY));
+                if ((ret == 0) && (jobRc != 0))
+                    ret = jobRc;
+            }
             if (ret == 0) {
                 if (packet->rc != 0)
                     ret = packet->rc;
@@ -409,79 +366,24 @@ int wolfHSM_CryptoCb(int devId, wc_CryptoInfo* info, void* inCtx)
             }
             break;
         case WC_PK_TYPE_ECDSA_SIGN:
-            /* in and out are after the fixed size fields */
-            in = (uint8_t*)(&packet->pkEccSignReq + 1);
-            out = (uint8_t*)(&packet->pkEccSignRes + 1);
-            /* set keyId */
-            packet->pkEccSignReq.keyId = (intptr_t)info->pk.eccsign.key->devCtx;
-            /* set curveId */
-            packet->pkEccSignReq.curveId =
-                wc_ecc_get_curve_id(info->pk.eccsign.key->idx);
-            /* set sz */
-            packet->pkEccSignReq.sz = info->pk.eccsign.inlen;
-            /* set in */
-            XMEMCPY(in, info->pk.eccsign.in, info->pk.eccsign.inlen);
-            /* write request */
-            ret = wh_Client_SendRequest(ctx, group,
-                WC_ALGO_TYPE_PK,
-                WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->pkEccSignReq) +
-                    info->pk.eccsign.inlen,
-                rawPacket);
-            /* read response */
-            if (ret == 0) {
-                do {
-                    ret = wh_Client_RecvResponse(ctx, &group, &action, &dataSz,
-                        rawPacket);
-                } while (ret == WH_ERROR_NOTREADY);
-            }
-            if (ret == 0) {
-                if (packet->rc != 0)
-                    ret = packet->rc;
-                else {
-                    /* read out */
-                    XMEMCPY(info->pk.eccsign.out, out, packet->pkEccSignRes.sz);
-                    *info->pk.eccsign.outlen = packet->pkEccSignRes.sz;
-                }
+            {
+                uint32_t sigSz = *info->pk.eccsign.outlen;
+                ret = wh_Client_EccSign(ctx,
+                    (whNvmId)((intptr_t)info->pk.eccsign.key->devCtx),
+                    wc_ecc_get_curve_id(info->pk.eccsign.key->idx),
+                    info->pk.eccsign.in, info->pk.eccsign.inlen,
+                    info->pk.eccsign.out, &sigSz);
+                if (ret == 0)
+                    *info->pk.eccsign.outlen = sigSz;
             }
             break;
         case WC_PK_TYPE_ECDSA_VERIFY:
-            /* sig and hash are after the fixed size fields */
-            sig = (uint8_t*)(&packet->pkEccVerifyReq + 1);
-            hash = (uint8_t*)(&packet->pkEccVerifyReq + 1) +
-                info->pk.eccverify.siglen;
-            /* set keyId */
-            packet->pkEccVerifyReq.keyId =
-                (intptr_t)info->pk.eccverify.key->devCtx;
-            /* set curveId */
-            packet->pkEccVerifyReq.curveId =
-                wc_ecc_get_curve_id(info->pk.eccverify.key->idx);
-            /* set sig and hash sz */
-            packet->pkEccVerifyReq.sigSz = info->pk.eccverify.siglen;
-            packet->pkEccVerifyReq.hashSz = info->pk.eccverify.hashlen;
-            /* copy sig and hash */
-            XMEMCPY(sig, info->pk.eccverify.sig, info->pk.eccverify.siglen);
-            XMEMCPY(hash, info->pk.eccverify.hash, info->pk.eccverify.hashlen);
-            /* write request */
-            ret = wh_Client_SendRequest(ctx, group,
-                WC_ALGO_TYPE_PK,
-                WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->pkEccVerifyReq) +
-                info->pk.eccverify.siglen + info->pk.eccverify.hashlen,
-                rawPacket);
-            /* read response */
-            if (ret == 0) {
-                do {
-                    ret = wh_Client_RecvResponse(ctx, &group, &action, &dataSz,
-                        rawPacket);
-                } while (ret == WH_ERROR_NOTREADY);
-            }
-            if (ret == 0) {
-                if (packet->rc != 0)
-                    ret = packet->rc;
-                else {
-                    /* read out */
-                    *info->pk.eccverify.res = packet->pkEccVerifyRes.res;
-                }
-            }
+            ret = wh_Client_EccVerify(ctx,
+                (whNvmId)((intptr_t)info->pk.eccverify.key->devCtx),
+                wc_ecc_get_curve_id(info->pk.eccverify.key->idx),
+                info->pk.eccverify.sig, info->pk.eccverify.siglen,
+                info->pk.eccverify.hash, info->pk.eccverify.hashlen,
+                info->pk.eccverify.res);
             break;
         case WC_PK_TYPE_EC_CHECK_PRIV_KEY:
             /* set keyId */
@@ -572,26 +474,8 @@ int wolfHSM_CryptoCb(int devId, wc_CryptoInfo* info, void* inCtx)
         break;
 #ifndef WC_NO_RNG
     case WC_ALGO_TYPE_RNG:
-        /* out is after the fixed size fields */
-        out = (uint8_t*)(&packet->rngRes + 1);
-        /* set sz */
-        packet->rngReq.sz = info->rng.sz;
-        /* write request */
-        ret = wh_Client_SendRequest(ctx, group, WC_ALGO_TYPE_RNG,
-            WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->rngReq), rawPacket);
-        if (ret == 0) {
-            do {
-                ret = wh_Client_RecvResponse(ctx, &group, &action, &dataSz,
-                    rawPacket);
-            } while (ret == WH_ERROR_NOTREADY);
-        }
-        if (ret == 0) {
-            if (packet->rc != 0)
-                ret = packet->rc;
-            /* read out */
-            else
-                XMEMCPY(info->rng.out, out, packet->rngRes.sz);
-        }
+        ret = _wolfHSM_RngGenerate(ctx, rawPacket, info->rng.out,
+            info->rng.sz);
         break;
 #endif /* !WC_NO_RNG */
     case WC_ALGO_TYPE_NONE:
@@ -602,4 +486,134 @@ int wolfHSM_CryptoCb(int devId, wc_CryptoInfo* info, void* inCtx)
 
     return ret;
 }
+
+int wolfHSM_CryptoCbDma(int devId, wc_CryptoInfo* info, void* inCtx)
+{
+    int ret = CRYPTOCB_UNAVAILABLE;
+    whClientContext* ctx = inCtx;
+    uint8_t* rawPacket;
+    whPacket* packet;
+    uint16_t group = WH_MESSAGE_GROUP_CRYPTO;
+    uint16_t action;
+    uint16_t dataSz;
+    uint8_t* key;
+    uint8_t* iv;
+    uint8_t* authIn;
+    uint8_t* authTag;
+    Aes* aes = NULL;
+    const uint8_t* ivIn = NULL;
+    const uint8_t* authInIn = NULL;
+    const uint8_t* authTagIn = NULL;
+    uint32_t keyLen;
+
+    if (devId == INVALID_DEVID || info == NULL)
+        return BAD_FUNC_ARG;
+
+    /* only bulk ciphers gain from dma, everything else goes in the packet */
+    if (info->algo_type != WC_ALGO_TYPE_CIPHER)
+        return wolfHSM_CryptoCb(devId, info, inCtx);
+
+    if (ctx == NULL)
+        return BAD_FUNC_ARG;
+    rawPacket = wh_CommClient_GetDataPtr(ctx->comm);
+    if (rawPacket == NULL)
+        return BAD_FUNC_ARG;
+    packet = (whPacket*)rawPacket;
+    /* CBC leaves the gcm sizes unset, so clear the whole fixed header */
+    XMEMSET(packet, 0,
+        WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->cipherDmaReq));
+    packet->cipherDmaReq.type = info->cipher.type;
+    packet->cipherDmaReq.enc = info->cipher.enc;
+    switch (info->cipher.type)
+    {
+#ifndef NO_AES
+#ifdef HAVE_AES_CBC
+    case WC_CIPHER_AES_CBC:
+        aes = info->cipher.aescbc.aes;
+        ivIn = (const uint8_t*)aes->reg;
+        packet->cipherDmaReq.in = (uintptr_t)info->cipher.aescbc.in;
+        packet->cipherDmaReq.out = (uintptr_t)info->cipher.aescbc.out;
+        packet->cipherDmaReq.sz = info->cipher.aescbc.sz;
+        packet->cipherDmaReq.ivSz = AES_IV_SIZE;
+        ret = 0;
+        break;
+#endif /* HAVE_AES_CBC */
+#ifdef HAVE_AESGCM
+    case WC_CIPHER_AES_GCM:
+        aes = info->cipher.aesgcm_enc.aes;
+        ivIn = info->cipher.aesgcm_enc.iv;
+        authInIn = info->cipher.aesgcm_enc.authIn;
+        if (info->cipher.enc == 0)
+            authTagIn = info->cipher.aesgcm_dec.authTag;
+        packet->cipherDmaReq.in = (uintptr_t)info->cipher.aesgcm_enc.in;
+        packet->cipherDmaReq.out = (uintptr_t)info->cipher.aesgcm_enc.out;
+        packet->cipherDmaReq.sz = info->cipher.aesgcm_enc.sz;
+        packet->cipherDmaReq.ivSz = info->cipher.aesgcm_enc.ivSz;
+        packet->cipherDmaReq.authInSz = info->cipher.aesgcm_enc.authInSz;
+        packet->cipherDmaReq.authTagSz = info->cipher.aesgcm_enc.authTagSz;
+        ret = 0;
+        break;
+#endif /* HAVE_AESGCM */
+#endif /* NO_AES */
+    default:
+        break;
+    }
+    if (ret != 0)
+        return ret;
+
+#ifndef NO_AES
+#ifdef WOLFHSM_SYMMETRIC_INTERNAL
+    keyLen = sizeof(uint32_t);
+#else
+    keyLen = aes->keylen;
+#endif
+    /* key, iv, authIn and the tag to check are after fixed size fields */
+    key = (uint8_t*)(&packet->cipherDmaReq + 1);
+    iv = key + keyLen;
+    authIn = iv + packet->cipherDmaReq.ivSz;
+    authTag = authIn + packet->cipherDmaReq.authInSz;
+    dataSz = sizeof(packet->cipherDmaReq) + keyLen +
+        packet->cipherDmaReq.ivSz + packet->cipherDmaReq.authInSz +
+        (authTagIn != NULL ? packet->cipherDmaReq.authTagSz : 0);
+    if (WOLFHSM_PACKET_STUB_SIZE + (uint32_t)dataSz > WH_COMM_DATA_LEN)
+        return BAD_FUNC_ARG;
+    packet->cipherDmaReq.keyLen = keyLen;
+#ifdef WOLFHSM_SYMMETRIC_INTERNAL
+    /* set keyId */
+    XMEMCPY(key, (uint8_t*)&aes->devCtx, sizeof(uint32_t));
+#else
+    /* set key */
+    XMEMCPY(key, aes->devKey, keyLen);
+#endif
+    XMEMCPY(iv, ivIn, packet->cipherDmaReq.ivSz);
+    if (authInIn != NULL)
+        XMEMCPY(authIn, authInIn, packet->cipherDmaReq.authInSz);
+    if (authTagIn != NULL)
+        XMEMCPY(authTag, authTagIn, packet->cipherDmaReq.authTagSz);
+    /* write request */
+    ret = wh_Client_SendRequest(ctx, group, WH_CRYPTO_CIPHER_DMA,
+        WOLFHSM_PACKET_STUB_SIZE + dataSz, rawPacket);
+    /* read response */
+    if (ret == 0) {
+        do {
+            ret = wh_Client_RecvResponse(ctx, &group, &action, &dataSz,
+                rawPacket);
+        } while (ret == WH_ERROR_NOTREADY);
+    }
+    if (ret == 0) {
+        if (packet->rc != 0)
+            ret = packet->rc;
+#ifdef HAVE_AESGCM
+        /* write the authTag if applicable */
+        else if (info->cipher.type == WC_CIPHER_AES_GCM &&
+            info->cipher.enc == 1) {
+            XMEMCPY(info->cipher.aesgcm_enc.authTag,
+                (uint8_t*)(&packet->cipherDmaRes + 1),
+                packet->cipherDmaRes.authTagSz);
+        }
+#endif
+    }
+#endif /* NO_AES */
+    return ret;
+}
 #endif  /* WOLFHSM_NO_CRYPTO */
@@ -34,6 +34,75 @@
 
 #include "wolfhsm/wh_client.h"
 
+/** NVM metadata cache */
+
+/* Drop the cached metadata once the server reports a new epoch */
+static void _NvmCacheEpoch(whClientContext* c, uint32_t epoch)
+{
+    if (    (c->nvm_cache != NULL) &&
+            (epoch != c->nvm_epoch)) {
+        memset(c->nvm_cache, 0,
+                sizeof(*c->nvm_cache) * c->nvm_cache_count);
+    }
+    c->nvm_epoch = epoch;
+}
+
+static const whNvmMetadata* _NvmCacheFind(whClientContext* c, whNvmId id)
+{
+    uint16_t i = 0;
+
+    if (id == 0) {
+        return NULL;
+    }
+    for (i = 0; i < c->nvm_cache_count; i++) {
+        if (c->nvm_cache[i].id == id) {
+            return &c->nvm_cache[i];
+        }
+    }
+    return NULL;
+}
+
+/* Cache the metadata in a GetMetadata response, replacing entries in turn
+ * once the cache is full */
+static void _NvmCacheStore(whClientContext* c,
+        const whMessageNvm_GetMetadataResponse* msg)
+{
+    whNvmMetadata* entry = NULL;
+    uint16_t i = 0;
+
+    if (    (c->nvm_cache == NULL) ||
+            (msg->id == 0)) {
+        return;
+    }
+    for (i = 0; i < c->nvm_cache_count; i++) {
+        if (    (c->nvm_cache[i].id == msg->id) ||
+                ((entry == NULL) && (c->nvm_cache[i].id == 0))) {
+            entry = &c->nvm_cache[i];
+        }
+    }
+    if (entry == NULL) {
+        entry = &c->nvm_cache[c->nvm_cache_next];
+        c->nvm_cache_next = (c->nvm_cache_next + 1) % c->nvm_cache_count;
+    }
+    entry->id = msg->id;
+    entry->access = msg->access;
+    entry->flags = msg->flags;
+    entry->len = msg->len;
+    memcpy(entry->label, msg->label, sizeof(entry->label));
+}
+
+int wh_Client_NvmCacheInvalidate(whClientContext* c)
+{
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+    if (c->nvm_cache != NULL) {
+        memset(c->nvm_cache, 0,
+                sizeof(*c->nvm_cache) * c->nvm_cache_count);
+    }
+    return 0;
+}
+
 /** NVM Init */
 int wh_Client_NvmInitRequest(whClientContext* c)
 {
@@ -84,6 +153,8 @@ int wh_Client_NvmInitResponse(whClientContext* c, int32_t *out_rc,
             if (out_servernvm_id != NULL) {
                 *out_servernvm_id = msg.servernvm_id;
             }
+            /* The server may have restarted, resetting its epoch */
+            (void)wh_Client_NvmCacheInvalidate(c);
         }
     }
     return rc;
@@ -147,6 +218,7 @@ int wh_Client_NvmCleanupResponse(whClientContext* c, int32_t *out_rc)
             rc = WH_ERROR_ABORTED;
         } else {
             /* Valid message */
+            _NvmCacheEpoch(c, msg.epoch);
             if (out_rc != NULL) {
                 *out_rc = msg.rc;
             }
@@ -213,6 +285,7 @@ int wh_Client_NvmGetAvailableResponse(whClientContext* c, int32_t *out_rc,
             rc = WH_ERROR_ABORTED;
         } else {
             /* Valid message */
+            _NvmCacheEpoch(c, msg.epoch);
             if (out_rc != NULL) {
                 *out_rc = msg.rc;
             }
@@ -257,40 +330,120 @@ int wh_Client_NvmGetAvailable(whClientContext* c, int32_t *out_rc,
     return rc;
 }
 
+/** NVM GetStats */
+int wh_Client_NvmGetStatsRequest(whClientContext* c)
+{
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    return wh_Client_SendRequest(c,
+            WH_MESSAGE_GROUP_NVM, WH_MESSAGE_NVM_ACTION_GETSTATS,
+            0, NULL);
+}
+
+int wh_Client_NvmGetStatsResponse(whClientContext* c, int32_t *out_rc,
+        whNvmStats* out_stats)
+{
+    whMessageNvm_GetStatsResponse msg = {0};
+    int rc = 0;
+    uint16_t resp_group = 0;
+    uint16_t resp_action = 0;
+    uint16_t resp_size = 0;
+
+    if (c == NULL){
+        return WH_ERROR_BADARGS;
+    }
+
+    rc = wh_Client_RecvResponse(c,
+            &resp_group, &resp_action,
+            &resp_size, &msg);
+    if (rc == 0) {
+        /* Validate response */
+        if (    (resp_group != WH_MESSAGE_GROUP_NVM) ||
+                (resp_action != WH_MESSAGE_NVM_ACTION_GETSTATS) ||
+                (resp_size != sizeof(msg)) ){
+            /* Invalid message */
+            rc = WH_ERROR_ABORTED;
+        } else {
+            /* Valid message */
+            if (out_rc != NULL) {
+                *out_rc = msg.rc;
+            }
+            if (out_stats != NULL) {
+                memset(out_stats, 0, sizeof(*out_stats));
+                out_stats->program_ops = msg.program_ops;
+                out_stats->erase_ops = msg.erase_ops;
+                out_stats->blank_checks = msg.blank_checks;
+                out_stats->verifies = msg.verifies;
+                out_stats->compactions = msg.compactions;
+                out_stats->partition_erases[0] = msg.partition_erases[0];
+                out_stats->partition_erases[1] = msg.partition_erases[1];
+                out_stats->data_bytes = msg.data_bytes;
+                out_stats->program_bytes = msg.program_bytes;
+                out_stats->erase_bytes = msg.erase_bytes;
+            }
+        }
+    }
+    return rc;
+}
+
+int wh_Client_NvmGetStats(whClientContext* c, int32_t *out_rc,
+        whNvmStats* out_stats)
+{
+    int rc = 0;
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    do {
+        rc = wh_Client_NvmGetStatsRequest(c);
+    } while (rc == WH_ERROR_NOTREADY);
+
+    if (rc == 0) {
+        do {
+            rc = wh_Client_NvmGetStatsResponse(c, out_rc, out_stats);
+        } while (rc == WH_ERROR_NOTREADY);
+    }
+    return rc;
+}
+
 /** NVM AddObject */
 int wh_Client_NvmAddObjectRequest(whClientContext* c,
         whNvmId id, whNvmAccess access, whNvmFlags flags,
         whNvmSize label_len, uint8_t* label,
         whNvmSize len, const uint8_t* data)
 {
-    /*TODO: Add scatter/gather into CommClient to avoid construction here */
-    uint8_t buffer[WH_COMM_DATA_LEN] = {0};
-    whMessageNvm_AddObjectRequest* msg = (whMessageNvm_AddObjectRequest*)buffer;
-    uint16_t hdr_len = sizeof(*msg);
-    uint8_t* payload = (uint8_t*)buffer + hdr_len;
+    whMessageNvm_AddObjectRequest msg = {0};
+    whCommIov iov[2];
 
     if (    (c == NULL) ||
             ((label == NULL) && (label_len > 0)) ||
             (label_len > WOLFHSM_NVM_LABEL_LEN) ||
             ((data == NULL) && (len > 0)) ||
-            (len > WH_MESSAGE_NVM_MAX_ADD_OBJECT_LEN) ){
+            (len > UINT16_MAX - sizeof(msg)) ){
         return WH_ERROR_BADARGS;
     }
 
-    msg->id = id;
-    msg->access = access;
-    msg->flags = flags;
-    msg->len = len;
+    msg.id = id;
+    msg.access = access;
+    msg.flags = flags;
+    msg.len = len;
     if(label_len > 0) {
-        memcpy(msg->label, label, label_len);
-    }
-    if(len > 0) {
-        memcpy(payload, data, len);
+        memcpy(msg.label, label, label_len);
     }
 
-    return wh_Client_SendRequest(c,
+    /* Header and payload are gathered directly into the transport.  Objects
+     * larger than WH_MESSAGE_NVM_MAX_ADD_OBJECT_LEN are sent in fragments */
+    iov[0].data = &msg;
+    iov[0].len = sizeof(msg);
+    iov[1].data = data;
+    iov[1].len = len;
+
+    return wh_Client_SendRequestFragV(c,
             WH_MESSAGE_GROUP_NVM, WH_MESSAGE_NVM_ACTION_ADDOBJECT,
-            hdr_len + len, buffer);
+            2, iov);
 }
 
 int wh_Client_NvmAddObjectResponse(whClientContext* c, int32_t *out_rc)
@@ -317,6 +470,7 @@ int wh_Client_NvmAddObjectResponse(whClientContext* c, int32_t *out_rc)
             rc = WH_ERROR_ABORTED;
         } else {
             /* Valid message */
+            _NvmCacheEpoch(c, msg.epoch);
             if (out_rc != NULL) {
                 *out_rc = msg.rc;
             }
@@ -337,95 +491,424 @@ int wh_Client_NvmAddObject(whClientContext* c,
     }
 
     do {
-        rc = wh_Client_NvmAddObjectRequest(c,
-                id, access, flags,
-                label_len, label,
-                len, data);
+        rc = wh_Client_NvmAddObjectRequest(c,
+                id, access, flags,
+                label_len, label,
+                len, data);
+    } while (rc == WH_ERROR_NOTREADY);
+    if (rc == 0) {
+        do {
+            rc = wh_Client_NvmAddObjectResponse(c, out_rc);
+        } while (rc == WH_ERROR_NOTREADY);
+    }
+    return rc;
+}
+
+/** NVM AddObject streaming */
+/* Shared by the stream and scatter-gather responses, all SimpleResponse */
+static int _NvmStreamResponse(whClientContext* c, uint16_t action,
+        int32_t *out_rc)
+{
+    whMessageNvm_SimpleResponse msg = {0};
+    int rc = 0;
+    uint16_t resp_group = 0;
+    uint16_t resp_action = 0;
+    uint16_t resp_size = 0;
+
+    if (c == NULL){
+        return WH_ERROR_BADARGS;
+    }
+
+    rc = wh_Client_RecvResponse(c,
+            &resp_group, &resp_action,
+            &resp_size, &msg);
+    if (rc == 0) {
+        /* Validate response */
+        if (    (resp_group != WH_MESSAGE_GROUP_NVM) ||
+                (resp_action != action) ||
+                (resp_size != sizeof(msg)) ){
+            /* Invalid message */
+            rc = WH_ERROR_ABORTED;
+        } else {
+            /* Valid message */
+            _NvmCacheEpoch(c, msg.epoch);
+            if (out_rc != NULL) {
+                *out_rc = msg.rc;
+            }
+        }
+    }
+    return rc;
+}
+
+int wh_Client_NvmAddObjectBeginRequest(whClientContext* c,
+        whNvmId id, whNvmAccess access, whNvmFlags flags,
+        whNvmSize label_len, uint8_t* label, whNvmSize len)
+{
+    whMessageNvm_AddObjectRequest msg = {0};
+
+    if (    (c == NULL) ||
+            ((label == NULL) && (label_len > 0)) ||
+            (label_len > WOLFHSM_NVM_LABEL_LEN) ){
+        return WH_ERROR_BADARGS;
+    }
+
+    msg.id = id;
+    msg.access = access;
+    msg.flags = flags;
+    msg.len = len;
+    if(label_len > 0) {
+        memcpy(msg.label, label, label_len);
+    }
+
+    return wh_Client_SendRequest(c,
+            WH_MESSAGE_GROUP_NVM, WH_MESSAGE_NVM_ACTION_ADDOBJECTBEGIN,
+            sizeof(msg), &msg);
+}
+
+int wh_Client_NvmAddObjectBeginResponse(whClientContext* c, int32_t *out_rc)
+{
+    return _NvmStreamResponse(c, WH_MESSAGE_NVM_ACTION_ADDOBJECTBEGIN,
+            out_rc);
+}
+
+int wh_Client_NvmAddObjectBegin(whClientContext* c,
+        whNvmId id, whNvmAccess access, whNvmFlags flags,
+        whNvmSize label_len, uint8_t* label, whNvmSize len, int32_t *out_rc)
+{
+    int rc = 0;
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    do {
+        rc = wh_Client_NvmAddObjectBeginRequest(c,
+                id, access, flags,
+                label_len, label, len);
+    } while (rc == WH_ERROR_NOTREADY);
+    if (rc == 0) {
+        do {
+            rc = wh_Client_NvmAddObjectBeginResponse(c, out_rc);
+        } while (rc == WH_ERROR_NOTREADY);
+    }
+    return rc;
+}
+
+int wh_Client_NvmAddObjectWriteRequest(whClientContext* c,
+        whNvmSize offset, whNvmSize len, const uint8_t* data)
+{
+    whMessageNvm_AddObjectWriteRequest msg = {0};
+    whCommIov iov[2];
+
+    if (    (c == NULL) ||
+            ((data == NULL) && (len > 0)) ||
+            (len > WH_MESSAGE_NVM_MAX_ADD_OBJECT_WRITE_LEN) ){
+        return WH_ERROR_BADARGS;
+    }
+
+    msg.offset = offset;
+    msg.data_len = len;
+
+    iov[0].data = &msg;
+    iov[0].len = sizeof(msg);
+    iov[1].data = data;
+    iov[1].len = len;
+
+    return wh_Client_SendRequestV(c,
+            WH_MESSAGE_GROUP_NVM, WH_MESSAGE_NVM_ACTION_ADDOBJECTWRITE,
+            2, iov);
+}
+
+int wh_Client_NvmAddObjectWriteResponse(whClientContext* c, int32_t *out_rc)
+{
+    return _NvmStreamResponse(c, WH_MESSAGE_NVM_ACTION_ADDOBJECTWRITE,
+            out_rc);
+}
+
+int wh_Client_NvmAddObjectWrite(whClientContext* c,
+        whNvmSize offset, whNvmSize len, const uint8_t* data, int32_t *out_rc)
+{
+    int rc = 0;
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    do {
+        rc = wh_Client_NvmAddObjectWriteRequest(c, offset, len, data);
+    } while (rc == WH_ERROR_NOTREADY);
+    if (rc == 0) {
+        do {
+            rc = wh_Client_NvmAddObjectWriteResponse(c, out_rc);
+        } while (rc == WH_ERROR_NOTREADY);
+    }
+    return rc;
+}
+
+int wh_Client_NvmAddObjectFinishRequest(whClientContext* c, int commit)
+{
+    whMessageNvm_AddObjectFinishRequest msg = {0};
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    msg.commit = (commit != 0);
+
+    return wh_Client_SendRequest(c,
+            WH_MESSAGE_GROUP_NVM, WH_MESSAGE_NVM_ACTION_ADDOBJECTFINISH,
+            sizeof(msg), &msg);
+}
+
+int wh_Client_NvmAddObjectFinishResponse(whClientContext* c, int32_t *out_rc)
+{
+    return _NvmStreamResponse(c, WH_MESSAGE_NVM_ACTION_ADDOBJECTFINISH,
+            out_rc);
+}
+
+int wh_Client_NvmAddObjectFinish(whClientContext* c, int commit,
+        int32_t *out_rc)
+{
+    int rc = 0;
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    do {
+        rc = wh_Client_NvmAddObjectFinishRequest(c, commit);
+    } while (rc == WH_ERROR_NOTREADY);
+    if (rc == 0) {
+        do {
+            rc = wh_Client_NvmAddObjectFinishResponse(c, out_rc);
+        } while (rc == WH_ERROR_NOTREADY);
+    }
+    return rc;
+}
+
+int wh_Client_NvmAddObjectStream(whClientContext* c,
+        whNvmId id, whNvmAccess access, whNvmFlags flags,
+        whNvmSize label_len, uint8_t* label,
+        whNvmSize len, const uint8_t* data, int32_t *out_rc)
+{
+    int rc = 0;
+    int32_t server_rc = 0;
+    whNvmSize offset = 0;
+    whNvmSize chunk = 0;
+    int opened = 0;
+
+    if (    (c == NULL) ||
+            ((data == NULL) && (len > 0)) ){
+        return WH_ERROR_BADARGS;
+    }
+
+    rc = wh_Client_NvmAddObjectBegin(c, id, access, flags,
+            label_len, label, len, &server_rc);
+    opened = (rc == 0) && (server_rc == 0);
+    while ((rc == 0) && (server_rc == 0) && (offset < len)) {
+        chunk = len - offset;
+        if (chunk > WH_MESSAGE_NVM_MAX_ADD_OBJECT_WRITE_LEN) {
+            chunk = WH_MESSAGE_NVM_MAX_ADD_OBJECT_WRITE_LEN;
+        }
+        rc = wh_Client_NvmAddObjectWrite(c, offset, chunk, data + offset,
+                &server_rc);
+        offset += chunk;
+    }
+    if ((rc == 0) && (server_rc == 0)) {
+        rc = wh_Client_NvmAddObjectFinish(c, 1, &server_rc);
+    } else if ((rc == 0) && opened) {
+        /* Release the stream, keeping the first error */
+        (void)wh_Client_NvmAddObjectFinish(c, 0, NULL);
+    }
+    if (out_rc != NULL) {
+        *out_rc = server_rc;
+    }
+    return rc;
+}
+
+/** NVM List */
+int wh_Client_NvmListRequest(whClientContext* c,
+        whNvmAccess access, whNvmFlags flags, whNvmId start_id)
+{
+    whMessageNvm_ListRequest msg = {0};
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    msg.access = access;
+    msg.flags = flags;
+    msg.startId = start_id;
+
+    return wh_Client_SendRequest(c,
+            WH_MESSAGE_GROUP_NVM, WH_MESSAGE_NVM_ACTION_LIST,
+            sizeof(msg), &msg);
+}
+
+int wh_Client_NvmListResponse(whClientContext* c, int32_t *out_rc,
+        whNvmId *out_count, whNvmId *out_id)
+{
+    whMessageNvm_ListResponse msg = {0};
+    int rc = 0;
+    uint16_t resp_group = 0;
+    uint16_t resp_action = 0;
+    uint16_t resp_size = 0;
+
+    if (c == NULL){
+        return WH_ERROR_BADARGS;
+    }
+
+    rc = wh_Client_RecvResponse(c,
+            &resp_group, &resp_action,
+            &resp_size, &msg);
+    if (rc == 0) {
+        /* Validate response */
+        if (    (resp_group != WH_MESSAGE_GROUP_NVM) ||
+                (resp_action != WH_MESSAGE_NVM_ACTION_LIST) ||
+                (resp_size != sizeof(msg)) ){
+            /* Invalid message */
+            rc = WH_ERROR_ABORTED;
+        } else {
+            /* Valid message */
+            _NvmCacheEpoch(c, msg.epoch);
+            if (out_rc != NULL) {
+                *out_rc = msg.rc;
+            }
+            if (out_count != NULL) {
+                *out_count = msg.count;
+            }
+            if (out_id != NULL) {
+                *out_id = msg.id;
+            }
+        }
+    }
+    return rc;
+}
+
+int wh_Client_NvmList(whClientContext* c,
+        whNvmAccess access, whNvmFlags flags, whNvmId start_id,
+        int32_t *out_rc, whNvmId *out_count, whNvmId *out_id)
+{
+    int rc = 0;
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    do {
+        rc = wh_Client_NvmListRequest(c, access, flags, start_id);
     } while (rc == WH_ERROR_NOTREADY);
+
     if (rc == 0) {
         do {
-            rc = wh_Client_NvmAddObjectResponse(c, out_rc);
+            rc = wh_Client_NvmListResponse(c, out_rc,
+                    out_count, out_id);
         } while (rc == WH_ERROR_NOTREADY);
     }
     return rc;
 }
 
-/** NVM List */
-int wh_Client_NvmListRequest(whClientContext* c,
-        whNvmAccess access, whNvmFlags flags, whNvmId start_id)
+/** NVM ListMetadata */
+int wh_Client_NvmListMetadataRequest(whClientContext* c,
+        whNvmAccess access, whNvmFlags flags, uint32_t cursor,
+        whNvmId max_count)
 {
-    whMessageNvm_ListRequest msg = {0};
+    whMessageNvm_ListMetadataRequest msg = {0};
 
     if (c == NULL) {
         return WH_ERROR_BADARGS;
     }
 
+    msg.cursor = cursor;
     msg.access = access;
     msg.flags = flags;
-    msg.startId = start_id;
+    msg.max_count = max_count;
 
     return wh_Client_SendRequest(c,
-            WH_MESSAGE_GROUP_NVM, WH_MESSAGE_NVM_ACTION_LIST,
+            WH_MESSAGE_GROUP_NVM, WH_MESSAGE_NVM_ACTION_LISTMETADATA,
             sizeof(msg), &msg);
 }
 
-int wh_Client_NvmListResponse(whClientContext* c, int32_t *out_rc,
-        whNvmId *out_count, whNvmId *out_id)
+int wh_Client_NvmListMetadataResponse(whClientContext* c, int32_t *out_rc,
+        uint32_t *out_cursor, whNvmId max_count, whNvmId *out_count,
+        whNvmMetadata* out_meta)
 {
-    whMessageNvm_ListResponse msg = {0};
+    uint8_t buffer[WH_COMM_DATA_LEN] = {0};
+    whMessageNvm_ListMetadataResponse* msg =
+            (whMessageNvm_ListMetadataResponse*)buffer;
+    uint16_t hdr_len = sizeof(*msg);
+    whMessageNvm_ListRecord* records =
+            (whMessageNvm_ListRecord*)(buffer + hdr_len);
+    whNvmId i = 0;
+
     int rc = 0;
     uint16_t resp_group = 0;
     uint16_t resp_action = 0;
     uint16_t resp_size = 0;
 
-    if (c == NULL){
+    if (    (c == NULL) ||
+            ((max_count > 0) && (out_meta == NULL)) ) {
         return WH_ERROR_BADARGS;
     }
 
     rc = wh_Client_RecvResponse(c,
             &resp_group, &resp_action,
-            &resp_size, &msg);
+            &resp_size, buffer);
     if (rc == 0) {
         /* Validate response */
         if (    (resp_group != WH_MESSAGE_GROUP_NVM) ||
-                (resp_action != WH_MESSAGE_NVM_ACTION_LIST) ||
-                (resp_size != sizeof(msg)) ){
+                (resp_action != WH_MESSAGE_NVM_ACTION_LISTMETADATA) ||
+                (resp_size < hdr_len) ||
+                (msg->count > max_count) ||
+                (resp_size != hdr_len +
+                        msg->count * sizeof(whMessageNvm_ListRecord)) ){
             /* Invalid message */
             rc = WH_ERROR_ABORTED;
         } else {
-            /* Valid message */
+            /* Valid message.  Only the label prefix is returned */
+            for (i = 0; i < msg->count; i++) {
+                memset(&out_meta[i], 0, sizeof(out_meta[i]));
+                out_meta[i].id = records[i].id;
+                out_meta[i].access = records[i].access;
+                out_meta[i].flags = records[i].flags;
+                out_meta[i].len = records[i].len;
+                memcpy(out_meta[i].label, records[i].label,
+                        sizeof(records[i].label));
+            }
             if (out_rc != NULL) {
-                *out_rc = msg.rc;
+                *out_rc = msg->rc;
             }
-            if (out_count != NULL) {
-                *out_count = msg.count;
+            if (out_cursor != NULL) {
+                *out_cursor = msg->cursor;
             }
-            if (out_id != NULL) {
-                *out_id = msg.id;
+            if (out_count != NULL) {
+                *out_count = msg->count;
             }
         }
     }
     return rc;
 }
 
-int wh_Client_NvmList(whClientContext* c,
-        whNvmAccess access, whNvmFlags flags, whNvmId start_id,
-        int32_t *out_rc, whNvmId *out_count, whNvmId *out_id)
+int wh_Client_NvmListMetadata(whClientContext* c,
+        whNvmAccess access, whNvmFlags flags, uint32_t *inout_cursor,
+        whNvmId max_count, int32_t *out_rc, whNvmId *out_count,
+        whNvmMetadata* out_meta)
 {
     int rc = 0;
 
-    if (c == NULL) {
+    if ((c == NULL) || (inout_cursor == NULL)) {
         return WH_ERROR_BADARGS;
     }
 
     do {
-        rc = wh_Client_NvmListRequest(c, access, flags, start_id);
+        rc = wh_Client_NvmListMetadataRequest(c, access, flags,
+                *inout_cursor, max_count);
     } while (rc == WH_ERROR_NOTREADY);
 
     if (rc == 0) {
         do {
-            rc = wh_Client_NvmListResponse(c, out_rc,
-                    out_count, out_id);
+            rc = wh_Client_NvmListMetadataResponse(c, out_rc,
+                    inout_cursor, max_count, out_count, out_meta);
         } while (rc == WH_ERROR_NOTREADY);
     }
     return rc;
@@ -473,6 +956,7 @@ int wh_Client_NvmGetMetadataResponse(whClientContext* c, int32_t *out_rc,
             rc = WH_ERROR_ABORTED;
         } else {
             /* Valid message */
+            _NvmCacheEpoch(c, msg.epoch);
             if (out_rc != NULL) {
                 *out_rc = msg.rc;
             }
@@ -494,6 +978,9 @@ int wh_Client_NvmGetMetadataResponse(whClientContext* c, int32_t *out_rc,
                 }
                 memcpy(label, msg.label, label_len);
             }
+            if (msg.rc == 0) {
+                _NvmCacheStore(c, &msg);
+            }
         }
     }
     return rc;
@@ -505,10 +992,29 @@ int wh_Client_NvmGetMetadata(whClientContext* c, whNvmId id,
         whNvmSize label_len, uint8_t* label)
 {
     int rc = 0;
+    const whNvmMetadata* meta = NULL;
 
     if (c == NULL) {
         return WH_ERROR_BADARGS;
     }
+
+    meta = _NvmCacheFind(c, id);
+    if (meta != NULL) {
+        /* Unchanged since the last epoch seen, so answer locally */
+        if (out_rc != NULL) *out_rc = 0;
+        if (out_id != NULL) *out_id = meta->id;
+        if (out_access != NULL) *out_access = meta->access;
+        if (out_flags != NULL) *out_flags = meta->flags;
+        if (out_len != NULL) *out_len = meta->len;
+        if (label != NULL) {
+            if (label_len > sizeof(meta->label)) {
+                label_len = sizeof(meta->label);
+            }
+            memcpy(label, meta->label, label_len);
+        }
+        return 0;
+    }
+
     do {
         rc = wh_Client_NvmGetMetadataRequest(c, id);
     } while (rc == WH_ERROR_NOTREADY);
@@ -569,6 +1075,7 @@ int wh_Client_NvmDestroyObjectsResponse(whClientContext* c, int32_t *out_rc)
             rc = WH_ERROR_ABORTED;
         } else {
             /* Valid message */
+            _NvmCacheEpoch(c, msg.epoch);
             if (out_rc != NULL) {
                 *out_rc = msg.rc;
             }
@@ -682,6 +1189,133 @@ int wh_Client_NvmRead(whClientContext* c,
     return rc;
 }
 
+/** NVM ReadObjects */
+int wh_Client_NvmReadObjectsRequest(whClientContext* c,
+        whNvmId list_count, const whNvmId* id_list)
+{
+    whMessageNvm_ReadObjectsRequest msg = {0};
+    int counter = 0;
+
+    if (    (c == NULL) ||
+            ((list_count > 0) && (id_list == NULL)) ||
+            (list_count > WH_MESSAGE_NVM_MAX_READ_OBJECTS_COUNT)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    for (counter = 0; counter < list_count; counter++) {
+        msg.list[counter] = id_list[counter];
+    }
+    msg.list_count = list_count;
+    return wh_Client_SendRequest(c,
+            WH_MESSAGE_GROUP_NVM, WH_MESSAGE_NVM_ACTION_READOBJECTS,
+            sizeof(msg), &msg);
+}
+
+int wh_Client_NvmReadObjectsResponse(whClientContext* c, int32_t *out_rc,
+        whNvmId max_count, whNvmId *out_count, whNvmMetadata* out_meta,
+        whNvmSize *out_lens, whNvmSize data_size, uint8_t* data)
+{
+    uint8_t buffer[WH_COMM_DATA_LEN] = {0};
+    whMessageNvm_ReadObjectsResponse* msg =
+            (whMessageNvm_ReadObjectsResponse*)buffer;
+    whMessageNvm_ReadObjectsRecord* record = NULL;
+    uint16_t offset = sizeof(*msg);
+    uint16_t step = 0;
+    uint32_t used = 0;
+    uint16_t i = 0;
+
+    int rc = 0;
+    uint16_t resp_group = 0;
+    uint16_t resp_action = 0;
+    uint16_t resp_size = 0;
+
+    if (    (c == NULL) ||
+            ((max_count > 0) && ((out_meta == NULL) || (out_lens == NULL))) ||
+            ((data_size > 0) && (data == NULL))) {
+        return WH_ERROR_BADARGS;
+    }
+
+    rc = wh_Client_RecvResponse(c,
+            &resp_group, &resp_action,
+            &resp_size, buffer);
+    if (rc == 0) {
+        /* Validate response */
+        if (    (resp_group != WH_MESSAGE_GROUP_NVM) ||
+                (resp_action != WH_MESSAGE_NVM_ACTION_READOBJECTS) ||
+                (resp_size < offset) ||
+                (msg->count > max_count) ){
+            /* Invalid message */
+            rc = WH_ERROR_ABORTED;
+        }
+        /* Unpack the records, placing the data back to back in data */
+        for (i = 0; (rc == 0) && (i < msg->count); i++) {
+            record = (whMessageNvm_ReadObjectsRecord*)(buffer + offset);
+            if (    (offset + sizeof(*record) > resp_size) ||
+                    (record->data_len > record->len) ) {
+                rc = WH_ERROR_ABORTED;
+                break;
+            }
+            step = sizeof(*record) + ((record->data_len + 3) & ~3u);
+            if (offset + step > resp_size) {
+                rc = WH_ERROR_ABORTED;
+                break;
+            }
+            if (used + record->data_len > data_size) {
+                rc = WH_ERROR_NOSPACE;
+                break;
+            }
+            memset(&out_meta[i], 0, sizeof(out_meta[i]));
+            out_meta[i].id = record->id;
+            out_meta[i].access = record->access;
+            out_meta[i].flags = record->flags;
+            out_meta[i].len = record->len;
+            memcpy(out_meta[i].label, record->label,
+                    sizeof(out_meta[i].label));
+            if (record->data_len > 0) {
+                memcpy(data + used, (uint8_t*)record + sizeof(*record),
+                        record->data_len);
+            }
+            out_lens[i] = record->data_len;
+            used += record->data_len;
+            offset += step;
+        }
+        if (rc == 0) {
+            /* Valid message */
+            if (out_rc != NULL) {
+                *out_rc = msg->rc;
+            }
+            if (out_count != NULL) {
+                *out_count = msg->count;
+            }
+        }
+    }
+    return rc;
+}
+
+int wh_Client_NvmReadObjects(whClientContext* c,
+        whNvmId list_count, const whNvmId* id_list,
+        int32_t *out_rc, whNvmId *out_count, whNvmMetadata* out_meta,
+        whNvmSize *out_lens, whNvmSize data_size, uint8_t* data)
+{
+    int rc = 0;
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    do {
+        rc = wh_Client_NvmReadObjectsRequest(c, list_count, id_list);
+    } while (rc == WH_ERROR_NOTREADY);
+
+    if (rc == 0) {
+        do {
+            rc = wh_Client_NvmReadObjectsResponse(c, out_rc, list_count,
+                    out_count, out_meta, out_lens, data_size, data);
+        } while (rc == WH_ERROR_NOTREADY);
+    }
+    return rc;
+}
+
 /** NVM AddObjectDma32 */
 int wh_Client_NvmAddObjectDma32Request(whClientContext* c,
         uint32_t metadata_hostaddr,
@@ -726,6 +1360,7 @@ int wh_Client_NvmAddObjectDma32Response(whClientContext* c, int32_t *out_rc)
             rc = WH_ERROR_ABORTED;
         } else {
             /* Valid message */
+            _NvmCacheEpoch(c, msg.epoch);
             if (out_rc != NULL) {
                 *out_rc = msg.rc;
             }
@@ -800,6 +1435,7 @@ int wh_Client_NvmAddObjectDma64Response(whClientContext* c, int32_t *out_rc)
             rc = WH_ERROR_ABORTED;
         } else {
             /* Valid message */
+            _NvmCacheEpoch(c, msg.epoch);
             if (out_rc != NULL) {
                 *out_rc = msg.rc;
             }
@@ -918,6 +1554,7 @@ int wh_Client_NvmReadDma32Response(whClientContext* c, int32_t *out_rc)
             rc = WH_ERROR_ABORTED;
         } else {
             /* Valid message */
+            _NvmCacheEpoch(c, msg.epoch);
             if (out_rc != NULL) {
                 *out_rc = msg.rc;
             }
@@ -991,6 +1628,7 @@ int wh_Client_NvmReadDma64Response(whClientContext* c, int32_t *out_rc)
             rc = WH_ERROR_ABORTED;
         } else {
             /* Valid message */
+            _NvmCacheEpoch(c, msg.epoch);
             if (out_rc != NULL) {
                 *out_rc = msg.rc;
             }
@@ -1064,3 +1702,210 @@ int wh_Client_NvmReadDma(whClientContext* c,
     return WH_ERROR_BADARGS;
 }
 
+/** NVM ReadObjectsDma */
+int wh_Client_NvmReadObjectsDmaRequest(whClientContext* c,
+        whNvmId list_count, const whNvmId* id_list, whNvmMetadata* meta,
+        uint8_t* const* data, const whNvmSize* data_size)
+{
+    whMessageNvm_ReadObjectsDmaRequest msg = {0};
+    int counter = 0;
+
+    if (    (c == NULL) ||
+            (list_count > WH_MESSAGE_NVM_MAX_READ_OBJECTS_COUNT) ||
+            ((list_count > 0) && (  (id_list == NULL) ||
+                                    (meta == NULL) ||
+                                    (data == NULL) ||
+                                    (data_size == NULL)))) {
+        return WH_ERROR_BADARGS;
+    }
+
+    msg.metadata_hostaddr = (uint64_t)(uintptr_t)meta;
+    msg.list_count = list_count;
+    for (counter = 0; counter < list_count; counter++) {
+        msg.list[counter].data_hostaddr = (uint64_t)(uintptr_t)data[counter];
+        msg.list[counter].id = id_list[counter];
+        msg.list[counter].data_size = data_size[counter];
+    }
+    return wh_Client_SendRequest(c,
+            WH_MESSAGE_GROUP_NVM, WH_MESSAGE_NVM_ACTION_READOBJECTSDMA,
+            sizeof(msg), &msg);
+}
+
+int wh_Client_NvmReadObjectsDmaResponse(whClientContext* c, int32_t *out_rc,
+        whNvmId *out_count)
+{
+    whMessageNvm_ReadObjectsResponse msg = {0};
+    int rc = 0;
+    uint16_t resp_group = 0;
+    uint16_t resp_action = 0;
+    uint16_t resp_size = 0;
+
+    if (c == NULL){
+        return WH_ERROR_BADARGS;
+    }
+
+    rc = wh_Client_RecvResponse(c,
+            &resp_group, &resp_action,
+            &resp_size, &msg);
+    if (rc == 0) {
+        /* Validate response */
+        if (    (resp_group != WH_MESSAGE_GROUP_NVM) ||
+                (resp_action != WH_MESSAGE_NVM_ACTION_READOBJECTSDMA) ||
+                (resp_size != sizeof(msg)) ){
+            /* Invalid message */
+            rc = WH_ERROR_ABORTED;
+        } else {
+            /* Valid message */
+            if (out_rc != NULL) {
+                *out_rc = msg.rc;
+            }
+            if (out_count != NULL) {
+                *out_count = msg.count;
+            }
+        }
+    }
+    return rc;
+}
+
+int wh_Client_NvmReadObjectsDma(whClientContext* c,
+        whNvmId list_count, const whNvmId* id_list, whNvmMetadata* meta,
+        uint8_t* const* data, const whNvmSize* data_size,
+        int32_t *out_rc, whNvmId *out_count)
+{
+    int rc = 0;
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+    do {
+        rc = wh_Client_NvmReadObjectsDmaRequest(c, list_count, id_list, meta,
+                data, data_size);
+    } while (rc == WH_ERROR_NOTREADY);
+    if (rc == 0) {
+        do {
+            rc = wh_Client_NvmReadObjectsDmaResponse(c, out_rc, out_count);
+        } while (rc == WH_ERROR_NOTREADY);
+    }
+    return rc;
+}
+
+/** NVM scatter-gather DMA */
+/* Fill in the request list, the server checks the total length */
+static int _NvmDmaSgList(uint16_t sg_count, const whClientDmaSg* sg,
+        whMessageNvm_DmaSgEntry* out_sg)
+{
+    uint16_t i = 0;
+
+    if (    (sg_count > WH_MESSAGE_NVM_MAX_DMA_SG_COUNT) ||
+            ((sg_count > 0) && (sg == NULL))) {
+        return WH_ERROR_BADARGS;
+    }
+    for (i = 0; i < sg_count; i++) {
+        if (    (sg[i].data == NULL) ||
+                (sg[i].len == 0) ||
+                (sg[i].len > WOLFHSM_NVM_MAX_OBJECT_SIZE)) {
+            return WH_ERROR_BADARGS;
+        }
+        out_sg[i].data_hostaddr = (uint64_t)(uintptr_t)sg[i].data;
+        out_sg[i].data_len = (uint32_t)sg[i].len;
+    }
+    return 0;
+}
+
+int wh_Client_NvmAddObjectDmaSgRequest(whClientContext* c,
+        whNvmMetadata* metadata, uint16_t sg_count, const whClientDmaSg* sg)
+{
+    whMessageNvm_AddObjectDmaSgRequest msg = {0};
+    int rc = 0;
+
+    if (    (c == NULL) ||
+            (metadata == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    rc = _NvmDmaSgList(sg_count, sg, msg.sg);
+    if (rc != 0) {
+        return rc;
+    }
+    msg.metadata_hostaddr = (uint64_t)(uintptr_t)metadata;
+    msg.sg_count = sg_count;
+
+    return wh_Client_SendRequest(c,
+            WH_MESSAGE_GROUP_NVM, WH_MESSAGE_NVM_ACTION_ADDOBJECTDMASG,
+            sizeof(msg), &msg);
+}
+
+int wh_Client_NvmAddObjectDmaSgResponse(whClientContext* c, int32_t *out_rc)
+{
+    return _NvmStreamResponse(c, WH_MESSAGE_NVM_ACTION_ADDOBJECTDMASG,
+            out_rc);
+}
+
+int wh_Client_NvmAddObjectDmaSg(whClientContext* c,
+        whNvmMetadata* metadata, uint16_t sg_count, const whClientDmaSg* sg,
+        int32_t *out_rc)
+{
+    int rc = 0;
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+    do {
+        rc = wh_Client_NvmAddObjectDmaSgRequest(c, metadata, sg_count, sg);
+    } while (rc == WH_ERROR_NOTREADY);
+    if (rc == 0) {
+        do {
+            rc = wh_Client_NvmAddObjectDmaSgResponse(c, out_rc);
+        } while (rc == WH_ERROR_NOTREADY);
+    }
+    return rc;
+}
+
+int wh_Client_NvmReadDmaSgRequest(whClientContext* c,
+        whNvmId id, whNvmSize offset, uint16_t sg_count,
+        const whClientDmaSg* sg)
+{
+    whMessageNvm_ReadDmaSgRequest msg = {0};
+    int rc = 0;
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    rc = _NvmDmaSgList(sg_count, sg, msg.sg);
+    if (rc != 0) {
+        return rc;
+    }
+    msg.id = id;
+    msg.offset = offset;
+    msg.sg_count = sg_count;
+
+    return wh_Client_SendRequest(c,
+            WH_MESSAGE_GROUP_NVM, WH_MESSAGE_NVM_ACTION_READDMASG,
+            sizeof(msg), &msg);
+}
+
+int wh_Client_NvmReadDmaSgResponse(whClientContext* c, int32_t *out_rc)
+{
+    return _NvmStreamResponse(c, WH_MESSAGE_NVM_ACTION_READDMASG, out_rc);
+}
+
+int wh_Client_NvmReadDmaSg(whClientContext* c,
+        whNvmId id, whNvmSize offset, uint16_t sg_count,
+        const whClientDmaSg* sg, int32_t *out_rc)
+{
+    int rc = 0;
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+    do {
+        rc = wh_Client_NvmReadDmaSgRequest(c, id, offset, sg_count, sg);
+    } while (rc == WH_ERROR_NOTREADY);
+    if (rc == 0) {
+        do {
+            rc = wh_Client_NvmReadDmaSgResponse(c, out_rc);
+        } while (rc == WH_ERROR_NOTREADY);
+    }
+    return rc;
+}
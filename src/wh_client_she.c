@@ -167,6 +167,49 @@ int wh_Client_SheSecureBoot(whClientContext* c, uint8_t* bootloader,
     return ret;
 }
 
+int wh_Client_SheSecureBootDmaRequest(whClientContext* c,
+    const uint8_t* bootloader, uint32_t bootloaderLen)
+{
+    whPacket* packet;
+    if (c == NULL || bootloader == NULL || bootloaderLen == 0)
+        return WH_ERROR_BADARGS;
+    packet = (whPacket*)wh_CommClient_GetDataPtr(c->comm);
+    packet->sheSecureBootDmaReq.addr = (uint64_t)((uintptr_t)bootloader);
+    packet->sheSecureBootDmaReq.sz = bootloaderLen;
+    return wh_Client_SendRequest(c, WH_MESSAGE_GROUP_SHE,
+        WH_SHE_SECURE_BOOT_DMA, WOLFHSM_PACKET_STUB_SIZE +
+        sizeof(packet->sheSecureBootDmaReq), (uint8_t*)packet);
+}
+
+int wh_Client_SheSecureBootDmaResponse(whClientContext* c)
+{
+    uint16_t group;
+    uint16_t action;
+    uint16_t dataSz;
+    int ret;
+    whPacket* packet;
+    if (c == NULL)
+        return WH_ERROR_BADARGS;
+    packet = (whPacket*)wh_CommClient_GetDataPtr(c->comm);
+    ret = wh_Client_RecvResponse(c, &group, &action, &dataSz, (uint8_t*)packet);
+    if (ret == 0)
+        ret = packet->rc;
+    return ret;
+}
+
+int wh_Client_SheSecureBootDma(whClientContext* c, const uint8_t* bootloader,
+    uint32_t bootloaderLen)
+{
+    int ret;
+    ret = wh_Client_SheSecureBootDmaRequest(c, bootloader, bootloaderLen);
+    if (ret == 0) {
+        do {
+            ret = wh_Client_SheSecureBootDmaResponse(c);
+        } while (ret == WH_ERROR_NOTREADY);
+    }
+    return ret;
+}
+
 int wh_Client_SheGetStatusRequest(whClientContext* c)
 {
     int ret;
@@ -277,6 +320,89 @@ int wh_Client_SheLoadKey(whClientContext* c, uint8_t* messageOne,
     return ret;
 }
 
+/* messageOne, messageTwo and messageThree each hold count messages back to
+ * back, messageFour and messageFive receive count messages the same way */
+int wh_Client_SheLoadKeyBatchRequest(whClientContext* c, uint32_t count,
+    uint8_t* messageOne, uint8_t* messageTwo, uint8_t* messageThree)
+{
+    int ret;
+    uint32_t i;
+    whPacket* packet;
+    wh_Packet_she_load_key_req* keys;
+    if (c == NULL || messageOne == NULL || messageTwo == NULL ||
+        messageThree == NULL || count == 0 ||
+        count > WOLFHSM_PACKET_SHE_LOAD_KEY_BATCH_MAX) {
+        return WH_ERROR_BADARGS;
+    }
+    packet = (whPacket*)wh_CommClient_GetDataPtr(c->comm);
+    keys = (wh_Packet_she_load_key_req*)(&packet->sheLoadKeyBatchReq + 1);
+    packet->sheLoadKeyBatchReq.count = count;
+    /* copy in messages 1-3 for each key */
+    for (i = 0; i < count; i++) {
+        memcpy(keys[i].messageOne, messageOne + i * WOLFHSM_SHE_M1_SZ,
+            sizeof(keys[i].messageOne));
+        memcpy(keys[i].messageTwo, messageTwo + i * WOLFHSM_SHE_M2_SZ,
+            sizeof(keys[i].messageTwo));
+        memcpy(keys[i].messageThree, messageThree + i * WOLFHSM_SHE_M3_SZ,
+            sizeof(keys[i].messageThree));
+    }
+    /* send load key batch req */
+    ret = wh_Client_SendRequest(c, WH_MESSAGE_GROUP_SHE,
+        WH_SHE_LOAD_KEY_BATCH, WOLFHSM_PACKET_STUB_SIZE +
+        sizeof(packet->sheLoadKeyBatchReq) + count * sizeof(*keys),
+        (uint8_t*)packet);
+    return ret;
+}
+
+int wh_Client_SheLoadKeyBatchResponse(whClientContext* c, uint32_t count,
+    uint8_t* messageFour, uint8_t* messageFive)
+{
+    int ret;
+    uint32_t i;
+    uint16_t group;
+    uint16_t action;
+    uint16_t dataSz;
+    whPacket* packet;
+    wh_Packet_she_load_key_res* keys;
+    if (c == NULL || messageFour == NULL || messageFive == NULL)
+        return WH_ERROR_BADARGS;
+    packet = (whPacket*)wh_CommClient_GetDataPtr(c->comm);
+    keys = (wh_Packet_she_load_key_res*)(&packet->sheLoadKeyBatchRes + 1);
+    ret = wh_Client_RecvResponse(c, &group, &action, &dataSz, (uint8_t*)packet);
+    if (ret == 0) {
+        if (packet->rc != WOLFHSM_SHE_ERC_NO_ERROR)
+            ret = packet->rc;
+        else if (packet->sheLoadKeyBatchRes.count != count)
+            ret = WH_ERROR_ABORTED;
+        else {
+            /* copy out message 4 and 5 for each key */
+            for (i = 0; i < count; i++) {
+                memcpy(messageFour + i * WOLFHSM_SHE_M4_SZ,
+                    keys[i].messageFour, sizeof(keys[i].messageFour));
+                memcpy(messageFive + i * WOLFHSM_SHE_M5_SZ,
+                    keys[i].messageFive, sizeof(keys[i].messageFive));
+            }
+        }
+    }
+    return ret;
+}
+
+int wh_Client_SheLoadKeyBatch(whClientContext* c, uint32_t count,
+    uint8_t* messageOne, uint8_t* messageTwo, uint8_t* messageThree,
+    uint8_t* messageFour, uint8_t* messageFive)
+{
+    int ret;
+    ret = wh_Client_SheLoadKeyBatchRequest(c, count, messageOne, messageTwo,
+        messageThree);
+    if (ret == 0) {
+        do {
+            ret = wh_Client_SheLoadKeyBatchResponse(c, count, messageFour,
+                messageFive);
+        } while (ret == WH_ERROR_NOTREADY);
+    }
+    return ret;
+}
+
 int wh_Client_SheLoadPlainKeyRequest(whClientContext* c, uint8_t* key,
     uint32_t keySz)
 {
@@ -472,6 +598,116 @@ int wh_Client_SheRnd(whClientContext* c, uint8_t* out, uint32_t* outSz)
     return ret;
 }
 
+int wh_Client_SheRndBulkRequest(whClientContext* c, uint32_t sz)
+{
+    whPacket* packet;
+    if (c == NULL || sz == 0 || (sz % WOLFHSM_SHE_KEY_SZ) != 0 ||
+        sz > WOLFHSM_PACKET_SHE_RND_BULK_MAX_SZ) {
+        return WH_ERROR_BADARGS;
+    }
+    packet = (whPacket*)wh_CommClient_GetDataPtr(c->comm);
+    packet->sheRndBulkReq.sz = sz;
+    return wh_Client_SendRequest(c, WH_MESSAGE_GROUP_SHE, WH_SHE_RND_BULK,
+        WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->sheRndBulkReq),
+        (uint8_t*)packet);
+}
+
+int wh_Client_SheRndBulkResponse(whClientContext* c, uint8_t* out,
+    uint32_t* outSz)
+{
+    int ret;
+    uint16_t group;
+    uint16_t action;
+    uint16_t dataSz;
+    uint8_t* packOut;
+    whPacket* packet;
+    if (c == NULL || out == NULL || outSz == NULL)
+        return WH_ERROR_BADARGS;
+    packet = (whPacket*)wh_CommClient_GetDataPtr(c->comm);
+    /* rnd is after fixed sized fields */
+    packOut = (uint8_t*)(&packet->sheRndBulkRes + 1);
+    ret = wh_Client_RecvResponse(c, &group, &action, &dataSz, (uint8_t*)packet);
+    if (ret == 0) {
+        if (packet->rc != WOLFHSM_SHE_ERC_NO_ERROR)
+            ret = packet->rc;
+        else if (*outSz < packet->sheRndBulkRes.sz)
+            ret = WH_ERROR_BADARGS;
+        else {
+            memcpy(out, packOut, packet->sheRndBulkRes.sz);
+            *outSz = packet->sheRndBulkRes.sz;
+        }
+    }
+    return ret;
+}
+
+int wh_Client_SheRndBulk(whClientContext* c, uint8_t* out, uint32_t sz)
+{
+    int ret = 0;
+    uint32_t chunk;
+    uint32_t chunkSz;
+    if (c == NULL || out == NULL || sz == 0 ||
+        (sz % WOLFHSM_SHE_KEY_SZ) != 0) {
+        return WH_ERROR_BADARGS;
+    }
+    /* as many blocks as a response can carry per round trip */
+    while (ret == 0 && sz > 0) {
+        chunk = sz;
+        if (chunk > WOLFHSM_PACKET_SHE_RND_BULK_MAX_SZ)
+            chunk = WOLFHSM_PACKET_SHE_RND_BULK_MAX_SZ;
+        ret = wh_Client_SheRndBulkRequest(c, chunk);
+        if (ret == 0) {
+            do {
+                chunkSz = chunk;
+                ret = wh_Client_SheRndBulkResponse(c, out, &chunkSz);
+            } while (ret == WH_ERROR_NOTREADY);
+        }
+        out += chunk;
+        sz -= chunk;
+    }
+    return ret;
+}
+
+int wh_Client_SheRndDmaRequest(whClientContext* c, uint8_t* out, uint32_t sz)
+{
+    whPacket* packet;
+    if (c == NULL || out == NULL || sz == 0 || (sz % WOLFHSM_SHE_KEY_SZ) != 0)
+        return WH_ERROR_BADARGS;
+    packet = (whPacket*)wh_CommClient_GetDataPtr(c->comm);
+    packet->sheRndDmaReq.addr = (uint64_t)((uintptr_t)out);
+    packet->sheRndDmaReq.sz = sz;
+    return wh_Client_SendRequest(c, WH_MESSAGE_GROUP_SHE, WH_SHE_RND_DMA,
+        WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->sheRndDmaReq),
+        (uint8_t*)packet);
+}
+
+int wh_Client_SheRndDmaResponse(whClientContext* c)
+{
+    uint16_t group;
+    uint16_t action;
+    uint16_t dataSz;
+    int ret;
+    whPacket* packet;
+    if (c == NULL)
+        return WH_ERROR_BADARGS;
+    packet = (whPacket*)wh_CommClient_GetDataPtr(c->comm);
+    ret = wh_Client_RecvResponse(c, &group, &action, &dataSz, (uint8_t*)packet);
+    if (ret == 0)
+        ret = packet->rc;
+    return ret;
+}
+
+int wh_Client_SheRndDma(whClientContext* c, uint8_t* out, uint32_t sz)
+{
+    int ret;
+    ret = wh_Client_SheRndDmaRequest(c, out, sz);
+    if (ret == 0) {
+        do {
+            ret = wh_Client_SheRndDmaResponse(c);
+        } while (ret == WH_ERROR_NOTREADY);
+    }
+    return ret;
+}
+
 int wh_Client_SheExtendSeedRequest(whClientContext* c, uint8_t* entropy,
     uint32_t entropySz)
 {
@@ -882,3 +1118,195 @@ int wh_Client_SheVerifyMac(whClientContext* c, uint8_t keyId, uint8_t* message,
     }
     return ret;
 }
+
+/* all stream responses share one layout, out only set by inline updates */
+static int _Client_SheCipherStreamResponse(whClientContext* c, uint8_t* out,
+    uint32_t sz)
+{
+    int ret;
+    uint16_t group;
+    uint16_t action;
+    uint16_t dataSz;
+    uint8_t* packOut;
+    whPacket* packet;
+    if (c == NULL)
+        return WH_ERROR_BADARGS;
+    packet = (whPacket*)wh_CommClient_GetDataPtr(c->comm);
+    /* out is after fixed sized fields */
+    packOut = (uint8_t*)(&packet->sheCipherStreamRes + 1);
+    ret = wh_Client_RecvResponse(c, &group, &action, &dataSz, (uint8_t*)packet);
+    if (ret == 0) {
+        if (packet->rc != WOLFHSM_SHE_ERC_NO_ERROR)
+            ret = packet->rc;
+        else if (out != NULL) {
+            if (sz < packet->sheCipherStreamRes.sz)
+                ret = WH_ERROR_BADARGS;
+            else
+                memcpy(out, packOut, packet->sheCipherStreamRes.sz);
+        }
+    }
+    return ret;
+}
+
+int wh_Client_SheCipherInitRequest(whClientContext* c, uint8_t keyId,
+    uint8_t mode, int enc, uint8_t* iv, uint32_t ivSz)
+{
+    whPacket* packet;
+    if (c == NULL || (mode != WOLFHSM_SHE_CIPHER_ECB &&
+        mode != WOLFHSM_SHE_CIPHER_CBC) ||
+        (mode == WOLFHSM_SHE_CIPHER_CBC &&
+        (iv == NULL || ivSz < WOLFHSM_SHE_KEY_SZ))) {
+        return WH_ERROR_BADARGS;
+    }
+    packet = (whPacket*)wh_CommClient_GetDataPtr(c->comm);
+    memset(&packet->sheCipherStreamReq, 0, sizeof(packet->sheCipherStreamReq));
+    packet->sheCipherStreamReq.op = WH_SHE_CIPHER_STREAM_INIT;
+    packet->sheCipherStreamReq.keyId = keyId;
+    packet->sheCipherStreamReq.mode = mode;
+    packet->sheCipherStreamReq.enc = enc != 0 ? 1 : 0;
+    if (mode == WOLFHSM_SHE_CIPHER_CBC)
+        memcpy(packet->sheCipherStreamReq.iv, iv, WOLFHSM_SHE_KEY_SZ);
+    return wh_Client_SendRequest(c, WH_MESSAGE_GROUP_SHE, WH_SHE_CIPHER_STREAM,
+        WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->sheCipherStreamReq),
+        (uint8_t*)packet);
+}
+
+int wh_Client_SheCipherInitResponse(whClientContext* c)
+{
+    return _Client_SheCipherStreamResponse(c, NULL, 0);
+}
+
+int wh_Client_SheCipherInit(whClientContext* c, uint8_t keyId, uint8_t mode,
+    int enc, uint8_t* iv, uint32_t ivSz)
+{
+    int ret;
+    ret = wh_Client_SheCipherInitRequest(c, keyId, mode, enc, iv, ivSz);
+    if (ret == 0) {
+        do {
+            ret = wh_Client_SheCipherInitResponse(c);
+        } while (ret == WH_ERROR_NOTREADY);
+    }
+    return ret;
+}
+
+int wh_Client_SheCipherUpdateRequest(whClientContext* c, uint8_t* in,
+    uint32_t sz)
+{
+    uint8_t* packIn;
+    whPacket* packet;
+    if (c == NULL || in == NULL || (sz % WOLFHSM_SHE_KEY_SZ) != 0 ||
+        sz > WOLFHSM_PACKET_SHE_CIPHER_STREAM_MAX_SZ) {
+        return WH_ERROR_BADARGS;
+    }
+    packet = (whPacket*)wh_CommClient_GetDataPtr(c->comm);
+    /* in is after fixed sized fields */
+    packIn = (uint8_t*)(&packet->sheCipherStreamReq + 1);
+    packet->sheCipherStreamReq.op = WH_SHE_CIPHER_STREAM_UPDATE;
+    packet->sheCipherStreamReq.sz = sz;
+    memcpy(packIn, in, sz);
+    return wh_Client_SendRequest(c, WH_MESSAGE_GROUP_SHE, WH_SHE_CIPHER_STREAM,
+        WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->sheCipherStreamReq) + sz,
+        (uint8_t*)packet);
+}
+
+int wh_Client_SheCipherUpdateResponse(whClientContext* c, uint8_t* out,
+    uint32_t sz)
+{
+    if (out == NULL)
+        return WH_ERROR_BADARGS;
+    return _Client_SheCipherStreamResponse(c, out, sz);
+}
+
+int wh_Client_SheCipherUpdate(whClientContext* c, uint8_t* in, uint8_t* out,
+    uint32_t sz)
+{
+    int ret = 0;
+    uint32_t chunk;
+    if (c == NULL || in == NULL || out == NULL ||
+        (sz % WOLFHSM_SHE_KEY_SZ) != 0) {
+        return WH_ERROR_BADARGS;
+    }
+    /* split the input over as few requests as possible, the server carries
+     * the chain from one to the next */
+    while (ret == 0 && sz > 0) {
+        chunk = sz;
+        if (chunk > WOLFHSM_PACKET_SHE_CIPHER_STREAM_MAX_SZ)
+            chunk = WOLFHSM_PACKET_SHE_CIPHER_STREAM_MAX_SZ;
+        ret = wh_Client_SheCipherUpdateRequest(c, in, chunk);
+        if (ret == 0) {
+            do {
+                ret = wh_Client_SheCipherUpdateResponse(c, out, chunk);
+            } while (ret == WH_ERROR_NOTREADY);
+        }
+        in += chunk;
+        out += chunk;
+        sz -= chunk;
+    }
+    return ret;
+}
+
+int wh_Client_SheCipherUpdateDmaRequest(whClientContext* c, const uint8_t* in,
+    uint8_t* out, uint32_t sz)
+{
+    whPacket* packet;
+    if (c == NULL || in == NULL || out == NULL ||
+        (sz % WOLFHSM_SHE_KEY_SZ) != 0) {
+        return WH_ERROR_BADARGS;
+    }
+    packet = (whPacket*)wh_CommClient_GetDataPtr(c->comm);
+    packet->sheCipherStreamReq.op = WH_SHE_CIPHER_STREAM_UPDATE_DMA;
+    packet->sheCipherStreamReq.in = (uint64_t)((uintptr_t)in);
+    packet->sheCipherStreamReq.out = (uint64_t)((uintptr_t)out);
+    packet->sheCipherStreamReq.sz = sz;
+    return wh_Client_SendRequest(c, WH_MESSAGE_GROUP_SHE, WH_SHE_CIPHER_STREAM,
+        WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->sheCipherStreamReq),
+        (uint8_t*)packet);
+}
+
+int wh_Client_SheCipherUpdateDmaResponse(whClientContext* c)
+{
+    return _Client_SheCipherStreamResponse(c, NULL, 0);
+}
+
+int wh_Client_SheCipherUpdateDma(whClientContext* c, const uint8_t* in,
+    uint8_t* out, uint32_t sz)
+{
+    int ret;
+    ret = wh_Client_SheCipherUpdateDmaRequest(c, in, out, sz);
+    if (ret == 0) {
+        do {
+            ret = wh_Client_SheCipherUpdateDmaResponse(c);
+        } while (ret == WH_ERROR_NOTREADY);
+    }
+    return ret;
+}
+
+int wh_Client_SheCipherFinalRequest(whClientContext* c)
+{
+    whPacket* packet;
+    if (c == NULL)
+        return WH_ERROR_BADARGS;
+    packet = (whPacket*)wh_CommClient_GetDataPtr(c->comm);
+    packet->sheCipherStreamReq.op = WH_SHE_CIPHER_STREAM_FINAL;
+    packet->sheCipherStreamReq.sz = 0;
+    return wh_Client_SendRequest(c, WH_MESSAGE_GROUP_SHE, WH_SHE_CIPHER_STREAM,
+        WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->sheCipherStreamReq),
+        (uint8_t*)packet);
+}
+
+int wh_Client_SheCipherFinalResponse(whClientContext* c)
+{
+    return _Client_SheCipherStreamResponse(c, NULL, 0);
+}
+
+int wh_Client_SheCipherFinal(whClientContext* c)
+{
+    int ret;
+    ret = wh_Client_SheCipherFinalRequest(c);
+    if (ret == 0) {
+        do {
+            ret = wh_Client_SheCipherFinalResponse(c);
+        } while (ret == WH_ERROR_NOTREADY);
+    }
+    return ret;
+}
@@ -35,6 +35,26 @@ uint8_t wh_Translate8(uint16_t magic, uint8_t val)
     return val;
 }
 
+#ifdef WOLFHSM_COMM_NATIVE
+/* Only native packets are accepted, so translations are the identity */
+uint16_t wh_Translate16(uint16_t magic, uint16_t val)
+{
+    (void) magic;
+    return val;
+}
+
+uint32_t wh_Translate32(uint16_t magic, uint32_t val)
+{
+    (void) magic;
+    return val;
+}
+
+uint64_t wh_Translate64(uint16_t magic, uint64_t val)
+{
+    (void) magic;
+    return val;
+}
+#else
 uint16_t wh_Translate16(uint16_t magic, uint16_t val)
 {
     return WH_COMM_FLAGS_SWAPTEST(magic) ? val :
@@ -46,7 +66,7 @@ uint32_t wh_Translate32(uint16_t magic, uint32_t val)
     return WH_COMM_FLAGS_SWAPTEST(magic) ? val :
             ((val & 0xFF000000ul) >> 24) |
             ((val & 0xFF0000ul) >> 8) |
-            ((val & 0xFF00ul) >> 8) |
+            ((val & 0xFF00ul) << 8) |
             ((val & 0xFFul) << 24);
 }
 
@@ -62,10 +82,166 @@ uint64_t wh_Translate64(uint16_t magic, uint64_t val)
             ((val & 0xFF00ull) << 40) |
             ((val & 0xFFull) << 56);
 }
+#endif /* WOLFHSM_COMM_NATIVE */
+
+
+#ifdef WOLFHSM_COMM_STATS
+/** Endpoint statistics */
+
+static void _CommStats_Init(whCommStatsState* state, whCommTimeCb time_cb,
+        void* time_context)
+{
+    memset(state, 0, sizeof(*state));
+    state->time_cb = time_cb;
+    state->time_context = time_context;
+}
+
+/* Account for the result of one transport call in direction dir.  The time is
+ * only sampled at the start and end of a spin */
+static void _CommStats_Count(whCommStatsState* state, whCommStatsDir* dir,
+        uint32_t* spin, uint64_t* spin_start, int rc, uint16_t size)
+{
+    if (rc == WH_ERROR_NOTREADY) {
+        if ((*spin == 0) && (state->time_cb != NULL)) {
+            *spin_start = state->time_cb(state->time_context);
+        }
+        (*spin)++;
+        dir->notready++;
+        return;
+    }
+    if (rc == 0) {
+        if (*spin > dir->spin_max) {
+            dir->spin_max = *spin;
+        }
+        if ((*spin != 0) && (state->time_cb != NULL)) {
+            uint64_t elapsed = state->time_cb(state->time_context) -
+                    *spin_start;
+            if (elapsed > dir->spin_time_max) {
+                dir->spin_time_max = elapsed;
+            }
+        }
+        dir->packets++;
+        dir->bytes += size;
+    }
+    *spin = 0;
+}
+
+static void _CommStats_Tx(whCommStatsState* state, int rc, uint16_t size)
+{
+    _CommStats_Count(state, &state->stats.tx, &state->tx_spin,
+            &state->tx_spin_start, rc, size);
+}
+
+static void _CommStats_Rx(whCommStatsState* state, int rc, uint16_t size,
+        uint16_t seq)
+{
+    _CommStats_Count(state, &state->stats.rx, &state->rx_spin,
+            &state->rx_spin_start, rc, size);
+    if (rc == 0) {
+        if (    (state->stats.rx.packets > 1) &&
+                (seq != (uint16_t)(state->rx_seq + 1))) {
+            state->stats.seq_gaps++;
+        }
+        state->rx_seq = seq;
+    }
+}
+#endif /* WOLFHSM_COMM_STATS */
 
 
 /** Client functions */
 
+/* Find an in-flight slot with the matching seq in the given state, or in any
+ * non-free state if state is WH_COMM_SLOT_FREE */
+static whCommClientSlot* _CommClient_FindSlot(whCommClient* context,
+        uint16_t state, uint16_t seq)
+{
+    int i = 0;
+    for (i = 0; i < context->slot_count; i++) {
+        whCommClientSlot* slot = &context->slots[i];
+        if (    (slot->state != WH_COMM_SLOT_FREE) &&
+                (slot->seq == seq) &&
+                ((state == WH_COMM_SLOT_FREE) || (slot->state == state))) {
+            return slot;
+        }
+    }
+    return NULL;
+}
+
+static void _CommClient_ReleaseSlot(whCommClient* context,
+        whCommClientSlot* slot)
+{
+    slot->state = WH_COMM_SLOT_FREE;
+    slot->size = 0;
+    context->inflight--;
+}
+
+/* Split a received packet into header fields and copy out the data */
+static int _CommClient_Unpack(const void* packet, uint16_t size,
+        uint16_t* out_magic, uint16_t* out_kind, uint16_t* out_seq,
+        uint16_t* out_aux, uint16_t* out_size, void* data)
+{
+    const whCommHeader* hdr = (const whCommHeader*)packet;
+    const uint8_t* packet_data = (const uint8_t*)(hdr + 1);
+    uint16_t magic = 0;
+    uint16_t data_size = 0;
+
+    if (size < sizeof(*hdr)) {
+        /* Size is too small */
+        return WH_ERROR_ABORTED;
+    }
+
+    data_size = size - sizeof(*hdr);
+    magic = hdr->magic;
+#ifdef WOLFHSM_COMM_NATIVE
+    if (!(WH_COMM_FLAGS_SWAPTEST(magic))) {
+        /* Peer is not native endian */
+        return WH_ERROR_ABORTED;
+    }
+#endif
+    if (    (data != NULL) &&
+            (data_size != 0) &&
+            (data != packet_data)) {
+        memcpy(data, packet_data, data_size);
+    }
+    if (out_magic != NULL) *out_magic = magic;
+    if (out_kind != NULL) *out_kind = wh_Translate16(magic, hdr->kind);
+    if (out_seq != NULL) *out_seq = wh_Translate16(magic, hdr->seq);
+    if (out_aux != NULL) *out_aux = wh_Translate16(magic, hdr->aux);
+    if (out_size != NULL) *out_size = data_size;
+    return 0;
+}
+
+/* Pull the next packet from the transport into the context buffer and get its
+ * seq */
+static int _CommClient_RecvPacket(whCommClient* context, uint16_t* out_size,
+        uint16_t* out_seq)
+{
+    int rc = WH_ERROR_NOTREADY;
+    uint16_t size = sizeof(context->packet);
+
+    if ((context->initialized != 0) &&
+        (context->transport_cb != NULL) &&
+        (context->transport_cb->Recv != NULL)) {
+
+        rc = context->transport_cb->Recv(context->transport_context,
+                &size,
+                context->hdr);
+        if (rc == 0) {
+            if (size < sizeof(*context->hdr)) {
+                /* Size is too small */
+                return WH_ERROR_ABORTED;
+            }
+            *out_size = size;
+            *out_seq = wh_Translate16(context->hdr->magic, context->hdr->seq);
+        }
+#ifdef WOLFHSM_COMM_STATS
+        _CommStats_Rx(&context->stats, rc, size,
+                (rc == 0) ? *out_seq : 0);
+#endif
+    }
+    return rc;
+}
+
 int wh_CommClient_Init(whCommClient* context, const whCommClientConfig* config)
 {
     int rc = 0;
@@ -75,17 +251,38 @@ int wh_CommClient_Init(whCommClient* context, const whCommClientConfig* config)
         return WH_ERROR_BADARGS;
     }
 
+    if ((config->slot_count != 0) && (config->slots == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+
     memset(context, 0, sizeof(*context));
     context->transport_cb = config->transport_cb;
     context->transport_context = config->transport_context;
     context->client_id = config->client_id;
+#ifdef WOLFHSM_COMM_STATS
+    _CommStats_Init(&context->stats, config->time_cb, config->time_context);
+#endif
     context->connect_cb = config->connect_cb;
+    if (config->slot_count != 0) {
+        context->slots = config->slots;
+        context->slot_count = config->slot_count;
+        memset(context->slots, 0,
+                sizeof(*context->slots) * context->slot_count);
+    }
     if (context->transport_cb->Init != NULL) {
         rc = context->transport_cb->Init(context->transport_context,
                 config->transport_config, NULL, NULL);
     }
     if (rc == 0) {
         uintptr_t packet_addr = (uintptr_t)context->packet;
+        if (context->transport_cb->GetBuffer != NULL) {
+            uint8_t* buffer = context->transport_cb->GetBuffer(
+                    context->transport_context);
+            if (buffer != NULL) {
+                /* Build and parse packets in place */
+                packet_addr = (uintptr_t)buffer;
+            }
+        }
         context->hdr = (whCommHeader*)(packet_addr);
         context->data = (void*)(packet_addr + sizeof(*(context->hdr)));
         context->initialized = 1;
@@ -98,18 +295,49 @@ int wh_CommClient_Init(whCommClient* context, const whCommClientConfig* config)
     return rc;
 }
 
-/* If a request buffer is available, send a new request to the server.  The
- * sequence number will be incremented on transport success.
- */
-int wh_CommClient_SendRequest(whCommClient* context, uint16_t magic,
-    uint16_t kind, uint16_t *out_seq, uint16_t data_size, const void* data)
+/* Build the header with the given aux and send the gathered data */
+static int _CommClient_Send(whCommClient* context, uint16_t magic,
+    uint16_t kind, uint16_t aux, uint16_t *out_seq,
+    uint16_t iov_count, const whCommIov* iov)
 {
     int rc = WH_ERROR_NOTREADY;
+    whCommClientSlot* slot = NULL;
+    size_t data_size = 0;
+    int i = 0;
 
-    if (context == NULL) {
+    if (    (context == NULL) ||
+            (iov_count > WH_COMM_IOV_MAX_COUNT) ||
+            ((iov_count > 0) && (iov == NULL))) {
         return WH_ERROR_BADARGS;
     }
 
+    for (i = 0; i < iov_count; i++) {
+        if ((iov[i].data == NULL) && (iov[i].len != 0)) {
+            return WH_ERROR_BADARGS;
+        }
+        data_size += iov[i].len;
+    }
+    if (data_size > WH_COMM_DATA_LEN) {
+        return WH_ERROR_BADARGS;
+    }
+
+    if (    (context->slot_count == 0) &&
+            (context->inflight != 0)) {
+        /* Shared in-place header is still in use by the server */
+        return WH_ERROR_NOTREADY;
+    }
+
+    if (context->slot_count != 0) {
+        /* Window is full until a response is claimed */
+        if (context->inflight >= context->slot_count) {
+            return WH_ERROR_NOTREADY;
+        }
+        slot = context->slots;
+        while (slot->state != WH_COMM_SLOT_FREE) {
+            slot++;
+        }
+    }
+
     if ((context->initialized != 0) &&
         (context->transport_cb != NULL) &&
         (context->transport_cb->Send != NULL)) {
@@ -117,22 +345,72 @@ int wh_CommClient_SendRequest(whCommClient* context, uint16_t magic,
         context->hdr->magic = magic;
         context->hdr->kind = wh_Translate16(magic, kind);
         context->hdr->seq = wh_Translate16(magic, context->seq + 1);
-        if (    (data != NULL) &&
-                (data_size != 0) &&
-                (data != context->data)) {
-            memcpy(context->data, data, data_size);
+        context->hdr->aux = wh_Translate16(magic, aux);
+
+        if (context->transport_cb->SendV != NULL) {
+            /* Let the transport gather the header and fragments */
+            whCommIov vec[WH_COMM_IOV_MAX_COUNT + 1];
+            vec[0].data = context->hdr;
+            vec[0].len = sizeof(*(context->hdr));
+            for (i = 0; i < iov_count; i++) {
+                vec[i + 1] = iov[i];
+            }
+            rc = context->transport_cb->SendV(context->transport_context,
+                    iov_count + 1, vec);
+        } else {
+            /* Gather into the internal buffer */
+            uint8_t* dest = context->data;
+            for (i = 0; i < iov_count; i++) {
+                if (    (iov[i].len != 0) &&
+                        (iov[i].data != dest)) {
+                    memcpy(dest, iov[i].data, iov[i].len);
+                }
+                dest += iov[i].len;
+            }
+            rc = context->transport_cb->Send(context->transport_context,
+                    sizeof(*(context->hdr)) + data_size,
+                    context->hdr);
         }
-        rc = context->transport_cb->Send(context->transport_context,
-                sizeof(*(context->hdr)) + data_size,
-                context->packet);
+#ifdef WOLFHSM_COMM_STATS
+        _CommStats_Tx(&context->stats, rc,
+                sizeof(*(context->hdr)) + data_size);
+#endif
         if (rc == 0) {
             context->seq++;
             if (out_seq != NULL) *out_seq = context->seq;
+            if (slot != NULL) {
+                slot->seq = context->seq;
+                slot->state = WH_COMM_SLOT_PENDING;
+                context->inflight++;
+            } else if ((void*)context->hdr != (void*)context->packet) {
+                /* Hold the transport buffer until the response arrives */
+                context->inflight++;
+            }
         }
     }
     return rc;
 }
 
+/* If a request buffer is available, send a new request to the server.  The
+ * sequence number will be incremented on transport success.
+ */
+int wh_CommClient_SendRequest(whCommClient* context, uint16_t magic,
+    uint16_t kind, uint16_t *out_seq, uint16_t data_size, const void* data)
+{
+    whCommIov iov[1];
+
+    iov->data = data;
+    iov->len = data_size;
+    return wh_CommClient_SendRequestV(context, magic, kind, out_seq, 1, iov);
+}
+
+int wh_CommClient_SendRequestV(whCommClient* context, uint16_t magic,
+    uint16_t kind, uint16_t *out_seq, uint16_t iov_count, const whCommIov* iov)
+{
+    return _CommClient_Send(context, magic, kind, WH_COMM_AUX_REQ_NORMAL,
+            out_seq, iov_count, iov);
+}
+
 /* If a response packet has been buffered, get the header and copy the data out
  * of the buffer.
  */
@@ -140,48 +418,239 @@ int wh_CommClient_RecvResponse(whCommClient* context,
         uint16_t* out_magic, uint16_t* out_kind, uint16_t* out_seq,
         uint16_t* out_size, void* data)
 {
-    int rc = WH_ERROR_NOTREADY;
-    uint16_t magic = 0;
-    uint16_t kind = 0;
+    int rc = 0;
+    uint16_t size = 0;
     uint16_t seq = 0;
-    uint16_t size = sizeof(context->packet);
-    uint16_t data_size = 0;
+    whCommClientSlot* slot = NULL;
+    int i = 0;
 
     if (context == NULL) {
         return WH_ERROR_BADARGS;
     }
 
-    if ((context->initialized != 0) &&
-        (context->transport_cb != NULL) &&
-        (context->transport_cb->Recv != NULL)) {
+    /* Claim the oldest parked response first */
+    for (i = 0; i < context->slot_count; i++) {
+        whCommClientSlot* cur = &context->slots[i];
+        if (    (cur->state == WH_COMM_SLOT_READY) &&
+                ((slot == NULL) ||
+                 ((uint16_t)(context->seq - cur->seq) >
+                  (uint16_t)(context->seq - slot->seq)))) {
+            slot = cur;
+        }
+    }
+    if (slot != NULL) {
+        rc = _CommClient_Unpack(slot->packet, slot->size,
+                out_magic, out_kind, out_seq, NULL, out_size, data);
+        _CommClient_ReleaseSlot(context, slot);
+        return rc;
+    }
 
-        rc = context->transport_cb->Recv(context->transport_context,
-                &size,
-                context->packet);
+    rc = _CommClient_RecvPacket(context, &size, &seq);
+    if (rc == 0) {
+        if (context->slot_count != 0) {
+            slot = _CommClient_FindSlot(context, WH_COMM_SLOT_PENDING, seq);
+            if (slot == NULL) {
+                /* Response to a request that is not in flight */
+                return WH_ERROR_ABORTED;
+            }
+            _CommClient_ReleaseSlot(context, slot);
+        } else {
+            context->inflight = 0;
+        }
+        rc = _CommClient_Unpack(context->hdr, size,
+                out_magic, out_kind, out_seq, NULL, out_size, data);
+    }
+    return rc;
+}
+
+static int _CommClient_RecvSeq(whCommClient* context, uint16_t seq,
+        uint16_t* out_magic, uint16_t* out_kind, uint16_t* out_aux,
+        uint16_t* out_size, void* data)
+{
+    int rc = 0;
+    uint16_t size = 0;
+    uint16_t recv_seq = 0;
+    whCommClientSlot* slot = NULL;
+    whCommClientSlot* other = NULL;
+
+    if (context == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    slot = _CommClient_FindSlot(context, WH_COMM_SLOT_FREE, seq);
+    if (slot == NULL) {
+        /* Not pipelining or seq is not in flight */
+        return WH_ERROR_BADARGS;
+    }
+
+    if (slot->state == WH_COMM_SLOT_READY) {
+        rc = _CommClient_Unpack(slot->packet, slot->size,
+                out_magic, out_kind, NULL, out_aux, out_size, data);
+        _CommClient_ReleaseSlot(context, slot);
+        return rc;
+    }
+
+    rc = _CommClient_RecvPacket(context, &size, &recv_seq);
+    if (rc != 0) {
+        return rc;
+    }
+
+    if (recv_seq == seq) {
+        _CommClient_ReleaseSlot(context, slot);
+        return _CommClient_Unpack(context->hdr, size,
+                out_magic, out_kind, NULL, out_aux, out_size, data);
+    }
+
+    /* Park a response that arrived ahead of the one requested */
+    other = _CommClient_FindSlot(context, WH_COMM_SLOT_PENDING, recv_seq);
+    if (other == NULL) {
+        /* Response to a request that is not in flight */
+        return WH_ERROR_ABORTED;
+    }
+    memcpy(other->packet, context->hdr, size);
+    other->size = size;
+    other->state = WH_COMM_SLOT_READY;
+    return WH_ERROR_NOTREADY;
+}
+
+int wh_CommClient_RecvResponseSeq(whCommClient* context, uint16_t seq,
+        uint16_t* out_magic, uint16_t* out_kind,
+        uint16_t* out_size, void* data)
+{
+    return _CommClient_RecvSeq(context, seq, out_magic, out_kind, NULL,
+            out_size, data);
+}
+
+/* Collect the ack for the outstanding fragment */
+static int _CommClient_RecvFragAck(whCommClient* context)
+{
+    int rc = 0;
+    uint16_t size = 0;
+    uint16_t seq = 0;
+    uint16_t aux = 0;
+
+    if (context->slot_count != 0) {
+        rc = _CommClient_RecvSeq(context, context->frag_seq, NULL, NULL,
+                &aux, NULL, NULL);
+    } else {
+        rc = _CommClient_RecvPacket(context, &size, &seq);
         if (rc == 0) {
-            if (size >= sizeof(*context->hdr)) {
-                data_size = size - sizeof(*context->hdr);
-                magic = context->hdr->magic;
-                kind = wh_Translate16(magic, context->hdr->kind);
-                seq = wh_Translate16(magic, context->hdr->seq);
-                if (    (data != NULL) &&
-                        (data_size != 0) &&
-                        (data != context->data)) {
-                    memcpy(data, context->data, data_size);
-                }
-                if (out_magic != NULL) *out_magic = magic;
-                if (out_kind != NULL) *out_kind = kind;
-                if (out_seq != NULL) *out_seq = seq;
-                if (out_size != NULL) *out_size = data_size;
-            } else {
-                /* Size is too small */
+            context->inflight = 0;
+            if (seq != context->frag_seq) {
+                /* Ack for a fragment that is not in flight */
                 return WH_ERROR_ABORTED;
             }
+            rc = _CommClient_Unpack(context->hdr, size,
+                    NULL, NULL, NULL, &aux, NULL, NULL);
+        }
+    }
+    if (rc == 0) {
+        switch (aux) {
+        case WH_COMM_AUX_RESP_OK:
+            break;
+        case WH_COMM_AUX_RESP_UNSUPP:
+            rc = WH_ERROR_NOHANDLER;
+            break;
+        default:
+            rc = WH_ERROR_ABORTED;
+            break;
         }
     }
     return rc;
 }
 
+/* Select the bytes [offset, offset + len) of the gathered data */
+static uint16_t _CommClient_SliceIov(uint16_t iov_count, const whCommIov* iov,
+        size_t offset, size_t len, whCommIov* out_iov)
+{
+    uint16_t count = 0;
+    int i = 0;
+
+    for (i = 0; (i < iov_count) && (len != 0); i++) {
+        size_t take = iov[i].len;
+        if (offset >= take) {
+            offset -= take;
+            continue;
+        }
+        take -= offset;
+        if (take > len) {
+            take = len;
+        }
+        out_iov[count].data = (const uint8_t*)iov[i].data + offset;
+        out_iov[count].len = take;
+        count++;
+        len -= take;
+        offset = 0;
+    }
+    return count;
+}
+
+int wh_CommClient_SendRequestFragV(whCommClient* context, uint16_t magic,
+    uint16_t kind, uint16_t *out_seq, uint16_t iov_count, const whCommIov* iov)
+{
+    int rc = 0;
+    whCommIov vec[WH_COMM_IOV_MAX_COUNT];
+    size_t data_size = 0;
+    size_t chunk = 0;
+    uint16_t count = 0;
+    uint16_t aux = 0;
+    uint16_t seq = 0;
+    int i = 0;
+
+    if (    (context == NULL) ||
+            (iov_count > WH_COMM_IOV_MAX_COUNT) ||
+            ((iov_count > 0) && (iov == NULL))) {
+        return WH_ERROR_BADARGS;
+    }
+
+    for (i = 0; i < iov_count; i++) {
+        if ((iov[i].data == NULL) && (iov[i].len != 0)) {
+            return WH_ERROR_BADARGS;
+        }
+        data_size += iov[i].len;
+    }
+    if (    (data_size > UINT16_MAX) ||
+            (data_size < context->frag_offset)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    while (1) {
+        if (context->frag_wait != 0) {
+            rc = _CommClient_RecvFragAck(context);
+            if (rc == WH_ERROR_NOTREADY) {
+                return rc;
+            }
+            context->frag_wait = 0;
+            if (rc != 0) {
+                /* Server dropped the partial request */
+                context->frag_offset = 0;
+                return rc;
+            }
+        }
+
+        chunk = data_size - context->frag_offset;
+        aux = WH_COMM_AUX_REQ_NORMAL;
+        if (chunk > WH_COMM_DATA_LEN) {
+            chunk = WH_COMM_DATA_LEN;
+            aux = WH_COMM_AUX_REQ_MORE;
+        }
+        count = _CommClient_SliceIov(iov_count, iov, context->frag_offset,
+                chunk, vec);
+        rc = _CommClient_Send(context, magic, kind, aux, &seq, count, vec);
+        if (rc != 0) {
+            return rc;
+        }
+        if (aux == WH_COMM_AUX_REQ_NORMAL) {
+            context->frag_offset = 0;
+            if (out_seq != NULL) *out_seq = seq;
+            return 0;
+        }
+        context->frag_offset += chunk;
+        context->frag_seq = seq;
+        context->frag_wait = 1;
+    }
+}
+
 uint8_t* wh_CommClient_GetDataPtr(whCommClient* context)
 {
     if (context == NULL) {
@@ -219,6 +688,28 @@ int wh_CommClient_Cleanup(whCommClient* context)
     return rc;
 }
 
+#ifdef WOLFHSM_COMM_STATS
+int wh_CommClient_StatsGet(whCommClient* context, whCommStats* out_stats)
+{
+    if (    (context == NULL) ||
+            (out_stats == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    memcpy(out_stats, &context->stats.stats, sizeof(*out_stats));
+    return 0;
+}
+
+int wh_CommClient_StatsReset(whCommClient* context)
+{
+    if (context == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+    _CommStats_Init(&context->stats, context->stats.time_cb,
+            context->stats.time_context);
+    return 0;
+}
+#endif /* WOLFHSM_COMM_STATS */
+
 
 /** Server Functions */
 
@@ -236,12 +727,27 @@ int wh_CommServer_Init(whCommServer* context, const whCommServerConfig* config,
     context->transport_context = config->transport_context;
     context->transport_cb = config->transport_cb;
     context->server_id = config->server_id;
+#ifdef WOLFHSM_COMM_STATS
+    _CommStats_Init(&context->stats, config->time_cb, config->time_context);
+#endif
+    if (config->frag_buffer != NULL) {
+        context->frag_buffer = config->frag_buffer;
+        context->frag_size = config->frag_size;
+    }
     if (context->transport_cb->Init != NULL) {
         rc = context->transport_cb->Init(context->transport_context,
                 config->transport_config, connectcb, connectcb_arg);
     }
     if (rc == 0) {
         uintptr_t packet_addr = (uintptr_t)context->packet;
+        if (context->transport_cb->GetBuffer != NULL) {
+            uint8_t* buffer = context->transport_cb->GetBuffer(
+                    context->transport_context);
+            if (buffer != NULL) {
+                /* Parse and respond in place */
+                packet_addr = (uintptr_t)buffer;
+            }
+        }
         context->hdr = (whCommHeader*)packet_addr;
         context->data = (void*)(packet_addr + sizeof(*(context->hdr)));
         context->initialized = 1;
@@ -249,21 +755,104 @@ int wh_CommServer_Init(whCommServer* context, const whCommServerConfig* config,
     return rc;
 }
 
-int wh_CommServer_RecvRequest(whCommServer* context,
+/* Build the header with the given aux and send the response data */
+static int _CommServer_Send(whCommServer* context,
+        uint16_t magic, uint16_t kind, uint16_t seq, uint16_t aux,
+        uint16_t data_size, const void* data)
+{
+    int rc = WH_ERROR_NOTREADY;
+
+    if (data_size > WH_COMM_DATA_LEN) {
+        return WH_ERROR_BADARGS;
+    }
+
+    if ((context->initialized != 0) &&
+        (context->transport_cb != NULL) &&
+        (context->transport_cb->Send != NULL)) {
+
+        context->hdr->magic = magic;
+        context->hdr->kind = wh_Translate16(magic, kind);
+        context->hdr->seq = wh_Translate16(magic, seq);
+        context->hdr->aux = wh_Translate16(magic, aux);
+
+        /* Copy the data into the internal buffer if necessary */
+        if (    (data != NULL) &&
+                (data_size != 0) &&
+                (data != context->data) ) {
+            memcpy(context->data, data, data_size);
+        }
+        if (context->transport_cb->SetClientId != NULL) {
+            (void)context->transport_cb->SetClientId(
+                    context->transport_context, context->client_id);
+        }
+        rc = context->transport_cb->Send(context->transport_context,
+                sizeof(*(context->hdr)) + data_size,
+                context->hdr);
+#ifdef WOLFHSM_COMM_STATS
+        _CommStats_Tx(&context->stats, rc,
+                sizeof(*(context->hdr)) + data_size);
+#endif
+    }
+    return rc;
+}
+
+/* Forget a reassembly its client abandoned by starting another request */
+static void _CommServer_DropStaleFrag(whCommServer* context, uint16_t kind,
+        uint16_t seq)
+{
+    if (    (context->frag_len != 0) &&
+            (context->frag_client_id == context->client_id) &&
+            ((context->frag_kind != kind) ||
+             (seq != (uint16_t)(context->frag_seq + 1)))) {
+        context->frag_len = 0;
+    }
+}
+
+/* Append a fragment to the reassembly buffer and acknowledge it */
+static int _CommServer_AddFrag(whCommServer* context, int allow_frag,
+        uint16_t magic, uint16_t kind, uint16_t seq, uint16_t data_size)
+{
+    int rc = 0;
+    uint16_t aux = WH_COMM_AUX_RESP_OK;
+
+    if (    (allow_frag == 0) ||
+            (context->frag_buffer == NULL)) {
+        aux = WH_COMM_AUX_RESP_UNSUPP;
+    } else if (     (context->frag_len != 0) &&
+                    (context->frag_client_id != context->client_id)) {
+        /* Reassembly buffer is busy with another client */
+        aux = WH_COMM_AUX_RESP_ERROR;
+    } else if (data_size > context->frag_size - context->frag_len) {
+        /* Request is too large. Drop it */
+        context->frag_len = 0;
+        aux = WH_COMM_AUX_RESP_ERROR;
+    } else {
+        memcpy(context->frag_buffer + context->frag_len, context->data,
+                data_size);
+        context->frag_len += data_size;
+        context->frag_kind = kind;
+        context->frag_seq = seq;
+        context->frag_client_id = context->client_id;
+    }
+
+    do {
+        rc = _CommServer_Send(context, magic, kind, seq, aux, 0, NULL);
+    } while (rc == WH_ERROR_NOTREADY);
+    return rc;
+}
+
+static int _CommServer_Recv(whCommServer* context, int allow_frag,
         uint16_t* out_magic, uint16_t* out_kind, uint16_t* out_seq,
-        uint16_t* out_size, void* data)
+        uint16_t* out_size, uint8_t** out_data)
 {
     int rc = WH_ERROR_NOTREADY;
     uint16_t magic = 0;
     uint16_t kind = 0;
     uint16_t seq = 0;
+    uint16_t aux = 0;
     uint16_t size = sizeof(context->packet);
     uint16_t data_size = 0;
-
-    if (    (context == NULL) ||
-            (data == NULL)) {
-        return WH_ERROR_BADARGS;
-    }
+    uint8_t* data = NULL;
 
     if ((context->initialized != 0) &&
         (context->transport_cb != NULL) &&
@@ -271,25 +860,68 @@ int wh_CommServer_RecvRequest(whCommServer* context,
 
         rc = context->transport_cb->Recv(context->transport_context,
                 &size,
-                context->packet);
+                context->hdr);
+#ifdef WOLFHSM_COMM_STATS
+        if (rc != 0) {
+            _CommStats_Rx(&context->stats, rc, 0, 0);
+        }
+#endif
         if (rc == 0) {
             if (size >= sizeof(*context->hdr)) {
 
                 data_size = size - sizeof(*context->hdr);
                 magic = context->hdr->magic;
+#ifdef WOLFHSM_COMM_NATIVE
+                if (!(WH_COMM_FLAGS_SWAPTEST(magic))) {
+                    /* Client is not native endian */
+                    return WH_ERROR_ABORTED;
+                }
+#endif
                 kind = wh_Translate16(magic, context->hdr->kind);
                 seq = wh_Translate16(magic, context->hdr->seq);
+                aux = wh_Translate16(magic, context->hdr->aux);
+                data = context->data;
+#ifdef WOLFHSM_COMM_STATS
+                _CommStats_Rx(&context->stats, rc, size, seq);
+#endif
+
+                /* Requests run as the client bound to their connection */
+                if (context->transport_cb->GetClientId != NULL) {
+                    (void)context->transport_cb->GetClientId(
+                            context->transport_context, &context->client_id);
+                }
+
+                _CommServer_DropStaleFrag(context, kind, seq);
+
+                if (aux == WH_COMM_AUX_REQ_MORE) {
+                    rc = _CommServer_AddFrag(context, allow_frag,
+                            magic, kind, seq, data_size);
+                    return (rc == 0) ? WH_ERROR_NOTREADY : rc;
+                }
 
-                /* Copy the data from the internal buffer if necessary */
-                if (    (data != NULL) &&
-                        (data_size != 0) &&
-                        (data != context->data) ) {
-                    memcpy(data, context->data, data_size);
+                if (    (context->frag_len != 0) &&
+                        (context->frag_client_id == context->client_id)) {
+                    /* Final fragment completes the request */
+                    if (data_size > context->frag_size - context->frag_len) {
+                        context->frag_len = 0;
+                        do {
+                            rc = _CommServer_Send(context, magic, kind, seq,
+                                    WH_COMM_AUX_RESP_ERROR, 0, NULL);
+                        } while (rc == WH_ERROR_NOTREADY);
+                        return (rc == 0) ? WH_ERROR_NOTREADY : rc;
+                    }
+                    memcpy(context->frag_buffer + context->frag_len,
+                            context->data, data_size);
+                    data_size += context->frag_len;
+                    data = context->frag_buffer;
+                    context->frag_len = 0;
                 }
+
                 if (out_magic != NULL) *out_magic = magic;
                 if (out_kind != NULL) *out_kind = kind;
                 if (out_seq != NULL) *out_seq = seq;
                 if (out_size != NULL) *out_size = data_size;
+                *out_data = data;
             } else {
                 /* Size is too small */
                 rc = WH_ERROR_ABORTED;
@@ -299,37 +931,57 @@ int wh_CommServer_RecvRequest(whCommServer* context,
     return rc;
 }
 
-int wh_CommServer_SendResponse(whCommServer* context,
-        uint16_t magic, uint16_t kind, uint16_t seq,
-        uint16_t data_size, const void* data)
+int wh_CommServer_RecvRequest(whCommServer* context,
+        uint16_t* out_magic, uint16_t* out_kind, uint16_t* out_seq,
+        uint16_t* out_size, void* data)
 {
-    int rc = WH_ERROR_NOTREADY;
+    int rc = 0;
+    uint8_t* packet_data = NULL;
+    uint16_t data_size = 0;
 
-    if (context == NULL) {
+    if (    (context == NULL) ||
+            (data == NULL)) {
         return WH_ERROR_BADARGS;
     }
 
-    if ((context->initialized != 0) &&
-        (context->transport_cb != NULL) &&
-        (context->transport_cb->Send != NULL)) {
-
-        context->hdr->magic = magic;
-        context->hdr->kind = wh_Translate16(magic, kind);
-        context->hdr->seq = wh_Translate16(magic, seq);
-
-        /* Copy the data into the internal buffer if necessary */
-        if (    (data != NULL) &&
-                (data_size != 0) &&
-                (data != context->data) ) {
-            memcpy(context->data, data, data_size);
+    rc = _CommServer_Recv(context, 0, out_magic, out_kind, out_seq,
+            &data_size, &packet_data);
+    if (rc == 0) {
+        /* Copy the data from the internal buffer if necessary */
+        if (    (data_size != 0) &&
+                (data != packet_data) ) {
+            memcpy(data, packet_data, data_size);
         }
-        rc = context->transport_cb->Send(context->transport_context,
-                sizeof(*(context->hdr)) + data_size,
-                context->packet);
+        if (out_size != NULL) *out_size = data_size;
     }
     return rc;
 }
 
+int wh_CommServer_RecvRequestFrag(whCommServer* context,
+        uint16_t* out_magic, uint16_t* out_kind, uint16_t* out_seq,
+        uint16_t* out_size, uint8_t** out_data)
+{
+    if (    (context == NULL) ||
+            (out_data == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    return _CommServer_Recv(context, 1, out_magic, out_kind, out_seq,
+            out_size, out_data);
+}
+
+int wh_CommServer_SendResponse(whCommServer* context,
+        uint16_t magic, uint16_t kind, uint16_t seq,
+        uint16_t data_size, const void* data)
+{
+    if (context == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    return _CommServer_Send(context, magic, kind, seq, WH_COMM_AUX_RESP_OK,
+            data_size, data);
+}
+
 uint8_t* wh_CommServer_GetDataPtr(whCommServer* context)
 {
     if (context == NULL) {
@@ -355,3 +1007,25 @@ int wh_CommServer_Cleanup(whCommServer* context)
     context->initialized = 0;
     return rc;
 }
+
+#ifdef WOLFHSM_COMM_STATS
+int wh_CommServer_StatsGet(whCommServer* context, whCommStats* out_stats)
+{
+    if (    (context == NULL) ||
+            (out_stats == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    memcpy(out_stats, &context->stats.stats, sizeof(*out_stats));
+    return 0;
+}
+
+int wh_CommServer_StatsReset(whCommServer* context)
+{
+    if (context == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+    _CommStats_Init(&context->stats, context->stats.time_cb,
+            context->stats.time_context);
+    return 0;
+}
+#endif /* WOLFHSM_COMM_STATS */
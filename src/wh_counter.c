@@ -0,0 +1,329 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * src/wh_counter.c
+ *
+ * Journaled monotonic counters on top of generic flash layer
+ *
+ */
+
+#include <stddef.h>     /* For NULL */
+#include <string.h>     /* For memset */
+
+#include "wolfhsm/wh_common.h"
+#include "wolfhsm/wh_error.h"
+#include "wolfhsm/wh_flash.h"
+#include "wolfhsm/wh_flash_unit.h"
+#include "wolfhsm/wh_counter.h"
+
+/* Fixed patterns keep every programmed unit distinct from erased flash,
+ * whether the part erases to 0 or to 1 */
+#define WHC_MAGIC           (0x57434E54ul)  /* "WCNT" */
+#define WHC_RECORD_TAG      (0x5743u)       /* "WC" */
+
+/* Pack and unpack two 32-bit halves of a unit */
+#define WHC_UNIT(_hi, _lo) \
+            ((((whFlashUnit)(_hi)) << 32) | (whFlashUnit)(uint32_t)(_lo))
+#define WHC_UNIT_HI(_u) ((uint32_t)((_u) >> 32))
+#define WHC_UNIT_LO(_u) ((uint32_t)((_u) & 0xFFFFFFFFul))
+
+/* Partition layout in units: header, checkpoint, then records */
+#define WHC_HEADER_UNIT         0
+#define WHC_CHECKPOINT_UNIT     1
+#define WHC_CHECKPOINT_UNITS    ((WOLFHSM_NUM_COUNTERS + 1) / 2)
+#define WHC_FIRST_RECORD_UNIT   (WHC_CHECKPOINT_UNIT + WHC_CHECKPOINT_UNITS)
+
+static uint32_t _Counter_Offset(whCounterContext* context, uint16_t partition)
+{
+    return partition * context->partition_units;
+}
+
+/* Read a partition header.  Returns WH_ERROR_NOTFOUND unless it holds a
+ * complete checkpoint */
+static int _Counter_ReadHeader(whCounterContext* context, uint16_t partition,
+        uint32_t* out_epoch)
+{
+    whFlashUnit unit = 0;
+    int rc = wh_FlashUnit_Read(context->cb, context->flash,
+            _Counter_Offset(context, partition) + WHC_HEADER_UNIT, 1, &unit);
+    if (rc != 0) {
+        return rc;
+    }
+    if (WHC_UNIT_HI(unit) != WHC_MAGIC) {
+        return WH_ERROR_NOTFOUND;
+    }
+    *out_epoch = WHC_UNIT_LO(unit);
+    return 0;
+}
+
+/* Load the checkpoint of the active partition and replay its journal */
+static int _Counter_Load(whCounterContext* context)
+{
+    uint32_t base = _Counter_Offset(context, context->active);
+    whFlashUnit units[WHC_CHECKPOINT_UNITS];
+    whFlashUnit unit = 0;
+    uint32_t limit = 0;
+    uint16_t id = 0;
+    int i = 0;
+    int rc = 0;
+
+    rc = wh_FlashUnit_Read(context->cb, context->flash,
+            base + WHC_CHECKPOINT_UNIT, WHC_CHECKPOINT_UNITS, units);
+    if (rc != 0) {
+        return rc;
+    }
+    for (i = 0; i < WOLFHSM_NUM_COUNTERS; i++) {
+        context->limit[i] = ((i % 2) == 0) ? WHC_UNIT_HI(units[i / 2]) :
+                WHC_UNIT_LO(units[i / 2]);
+    }
+
+    /* Records are appended in order, so the journal ends at the first blank
+     * unit.  Damaged records are skipped */
+    context->next_unit = WHC_FIRST_RECORD_UNIT;
+    while (context->next_unit < context->partition_units) {
+        rc = wh_FlashUnit_BlankCheck(context->cb, context->flash,
+                base + context->next_unit, 1);
+        if (rc == 0) {
+            break;
+        }
+        rc = wh_FlashUnit_Read(context->cb, context->flash,
+                base + context->next_unit, 1, &unit);
+        if (rc != 0) {
+            return rc;
+        }
+        id = (uint16_t)WHC_UNIT_HI(unit);
+        limit = WHC_UNIT_LO(unit);
+        if (    ((WHC_UNIT_HI(unit) >> 16) == WHC_RECORD_TAG) &&
+                (id < WOLFHSM_NUM_COUNTERS) &&
+                (limit > context->limit[id])) {
+            context->limit[id] = limit;
+        }
+        context->next_unit++;
+    }
+    return 0;
+}
+
+int wh_Counter_Checkpoint(whCounterContext* context)
+{
+    uint16_t next = 0;
+    uint32_t base = 0;
+    whFlashUnit units[WHC_CHECKPOINT_UNITS];
+    whFlashUnit header = 0;
+    int i = 0;
+    int rc = 0;
+
+    if ((context == NULL) || (context->initialized == 0)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    next = (uint16_t)(1 - context->active);
+    base = _Counter_Offset(context, next);
+    memset(units, 0, sizeof(units));
+    for (i = 0; i < WOLFHSM_NUM_COUNTERS; i++) {
+        if ((i % 2) == 0) {
+            units[i / 2] = WHC_UNIT(context->limit[i], 0);
+        } else {
+            units[i / 2] |= (whFlashUnit)context->limit[i];
+        }
+    }
+
+    /* The header commits the checkpoint, so it is programmed last */
+    rc = wh_FlashUnit_Erase(context->cb, context->flash, base,
+            context->partition_units);
+    if (rc == 0) {
+        rc = wh_FlashUnit_Program(context->cb, context->flash,
+                base + WHC_CHECKPOINT_UNIT, WHC_CHECKPOINT_UNITS, units);
+    }
+    if (rc == 0) {
+        header = WHC_UNIT(WHC_MAGIC, context->epoch + 1);
+        rc = wh_FlashUnit_Program(context->cb, context->flash,
+                base + WHC_HEADER_UNIT, 1, &header);
+    }
+    if (rc == 0) {
+        context->active = next;
+        context->epoch++;
+        context->next_unit = WHC_FIRST_RECORD_UNIT;
+    }
+    return rc;
+}
+
+int wh_Counter_Init(whCounterContext* context, const whCounterConfig* config)
+{
+    uint32_t partition_size = 0;
+    uint32_t epoch[2] = {0, 0};
+    int found[2] = {0, 0};
+    int i = 0;
+    int rc = 0;
+
+    if (    (context == NULL) ||
+            (config == NULL) ||
+            (config->cb == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    if (config->cb->Init != NULL) {
+        rc = config->cb->Init(config->context, config->config);
+    }
+    if (rc != 0) {
+        return rc;
+    }
+
+    memset(context, 0, sizeof(*context));
+    context->cb = config->cb;
+    context->flash = config->context;
+    context->reserve = (config->reserve != 0) ? config->reserve : 1;
+
+    partition_size = config->partition_size;
+    if ((partition_size == 0) && (context->cb->PartitionSize != NULL)) {
+        partition_size = context->cb->PartitionSize(context->flash);
+    }
+    context->partition_units = partition_size / WHFU_BYTES_PER_UNIT;
+    if (    ((partition_size % WHFU_BYTES_PER_UNIT) != 0) ||
+            (context->partition_units <= WHC_FIRST_RECORD_UNIT)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    (void)wh_FlashUnit_WriteUnlock(context->cb, context->flash, 0,
+            2 * context->partition_units);
+
+    for (i = 0; i < 2; i++) {
+        rc = _Counter_ReadHeader(context, (uint16_t)i, &epoch[i]);
+        if (rc == 0) {
+            found[i] = 1;
+        } else if (rc != WH_ERROR_NOTFOUND) {
+            return rc;
+        }
+    }
+
+    context->initialized = 1;
+    if ((found[0] == 0) && (found[1] == 0)) {
+        /* Blank or foreign flash.  Checkpoint all zero counters into
+         * partition 0 */
+        context->active = 1;
+        rc = wh_Counter_Checkpoint(context);
+    } else {
+        /* The newer checkpoint wins, allowing for the epoch wrapping */
+        if (    (found[1] != 0) &&
+                ((found[0] == 0) || ((int32_t)(epoch[1] - epoch[0]) > 0))) {
+            context->active = 1;
+        }
+        context->epoch = epoch[context->active];
+        rc = _Counter_Load(context);
+    }
+    if (rc != 0) {
+        context->initialized = 0;
+        return rc;
+    }
+
+    /* Values handed out before a restart are unknown, so resume at the
+     * limits */
+    for (i = 0; i < WOLFHSM_NUM_COUNTERS; i++) {
+        context->value[i] = context->limit[i];
+    }
+    return 0;
+}
+
+int wh_Counter_Cleanup(whCounterContext* context)
+{
+    int rc = 0;
+
+    if (context == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    if (context->initialized == 0) {
+        /* Already cleaned up*/
+        return 0;
+    }
+
+    /* Ignore errors here */
+    (void)wh_FlashUnit_WriteLock(context->cb, context->flash, 0,
+            2 * context->partition_units);
+
+    if (context->cb->Cleanup != NULL) {
+        rc = context->cb->Cleanup(context->flash);
+    }
+    context->initialized = 0;
+    return rc;
+}
+
+int wh_Counter_Read(whCounterContext* context, whCounterId id,
+        uint32_t* out_value)
+{
+    if (    (context == NULL) ||
+            (context->initialized == 0) ||
+            (id >= WOLFHSM_NUM_COUNTERS) ||
+            (out_value == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    *out_value = context->value[id];
+    return 0;
+}
+
+int wh_Counter_Increment(whCounterContext* context, whCounterId id,
+        uint32_t* out_value)
+{
+    uint32_t limit = 0;
+    uint32_t old_limit = 0;
+    whFlashUnit record = 0;
+    int rc = 0;
+
+    if (    (context == NULL) ||
+            (context->initialized == 0) ||
+            (id >= WOLFHSM_NUM_COUNTERS) ||
+            (out_value == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    if (context->value[id] == UINT32_MAX) {
+        return WH_ERROR_NOSPACE;
+    }
+
+    if (context->value[id] == context->limit[id]) {
+        /* Reserve the next run of values before handing any out */
+        limit = context->value[id] + context->reserve;
+        if (limit < context->value[id]) {
+            limit = UINT32_MAX;
+        }
+        if (context->next_unit < context->partition_units) {
+            record = WHC_UNIT(((uint32_t)WHC_RECORD_TAG << 16) | id, limit);
+            rc = wh_FlashUnit_Program(context->cb, context->flash,
+                    _Counter_Offset(context, context->active) +
+                    context->next_unit, 1, &record);
+            if (rc == 0) {
+                context->next_unit++;
+                context->limit[id] = limit;
+            }
+        } else {
+            /* Journal is full, the checkpoint carries the new limit */
+            old_limit = context->limit[id];
+            context->limit[id] = limit;
+            rc = wh_Counter_Checkpoint(context);
+            if (rc != 0) {
+                context->limit[id] = old_limit;
+            }
+        }
+        if (rc != 0) {
+            return rc;
+        }
+    }
+
+    *out_value = ++context->value[id];
+    return 0;
+}
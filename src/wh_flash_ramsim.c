@@ -27,6 +27,10 @@
 
 static bool isMemoryErased(whFlashRamsimCtx* context, uint32_t offset,
                            uint32_t size);
+static int   startOperation(whFlashRamsimCtx* ctx, int op, uint32_t offset,
+                            uint32_t size, const uint8_t* data);
+static void  chargeTime(whFlashRamsimCtx* ctx, uint32_t count,
+                        uint32_t nsEach);
 
 
 static bool isMemoryErased(whFlashRamsimCtx* context, uint32_t offset,
@@ -41,6 +45,36 @@ static bool isMemoryErased(whFlashRamsimCtx* context, uint32_t offset,
     return true;
 }
 
+static int startOperation(whFlashRamsimCtx* ctx, int op, uint32_t offset,
+                          uint32_t size, const uint8_t* data)
+{
+    if ((ctx == NULL) || (ctx->memory == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    if (ctx->pendingOp != WH_FLASH_RAMSIM_OP_NONE) {
+        return WH_ERROR_NOTREADY;
+    }
+
+    /* Arguments are checked when the operation runs in Poll */
+    ctx->pendingOp     = op;
+    ctx->pendingOffset = offset;
+    ctx->pendingSize   = size;
+    ctx->pendingData   = data;
+    ctx->pendingPolls  = ctx->busyPolls;
+    return WH_ERROR_OK;
+}
+
+/* Add the modeled time of count bytes, pages or sectors */
+static void chargeTime(whFlashRamsimCtx* ctx, uint32_t count, uint32_t nsEach)
+{
+    uint64_t ns = (uint64_t)count * nsEach;
+
+    ctx->stats.timeNs += ns;
+    if (ctx->clockNs != NULL) {
+        *ctx->clockNs += ns;
+    }
+}
+
 
 /* Simulator functions */
 int whFlashRamsim_Init(void* context, const void* config)
@@ -58,7 +92,16 @@ int whFlashRamsim_Init(void* context, const void* config)
     ctx->pageSize    = cfg->pageSize;
     ctx->memory      = (uint8_t*)malloc(ctx->size);
     ctx->erasedByte  = cfg->erasedByte;
+    ctx->busyPolls   = cfg->busyPolls;
+    ctx->mapped      = cfg->mapped;
     ctx->writeLocked = 0;
+    ctx->pendingOp   = WH_FLASH_RAMSIM_OP_NONE;
+
+    ctx->readNsPerByte    = cfg->readNsPerByte;
+    ctx->programNsPerPage = cfg->programNsPerPage;
+    ctx->eraseNsPerSector = cfg->eraseNsPerSector;
+    ctx->clockNs          = cfg->clockNs;
+    memset(&ctx->stats, 0, sizeof(ctx->stats));
 
     if (!ctx->memory) {
         return WH_ERROR_BADARGS;
@@ -96,6 +139,11 @@ int whFlashRamsim_Program(void* context, uint32_t offset, uint32_t size,
         return WH_ERROR_BADARGS;
     }
 
+    /* The flash is busy until a started operation completes */
+    if (ctx->pendingOp != WH_FLASH_RAMSIM_OP_NONE) {
+        return WH_ERROR_NOTREADY;
+    }
+
     /* Ensure offset and size are within bounds and size is a multiple of page
      * size */
     if (offset + size > ctx->size || size % ctx->pageSize != 0) {
@@ -115,6 +163,10 @@ int whFlashRamsim_Program(void* context, uint32_t offset, uint32_t size,
     /* Perform the programming operation */
     memcpy(ctx->memory + offset, data, size);
 
+    ctx->stats.programs++;
+    ctx->stats.programPages += size / ctx->pageSize;
+    chargeTime(ctx, size / ctx->pageSize, ctx->programNsPerPage);
+
     return WH_ERROR_OK;
 }
 
@@ -128,7 +180,15 @@ int whFlashRamsim_Read(void* context, uint32_t offset, uint32_t size,
         return WH_ERROR_BADARGS;
     }
 
+    if (ctx->pendingOp != WH_FLASH_RAMSIM_OP_NONE) {
+        return WH_ERROR_NOTREADY;
+    }
+
     memcpy(data, ctx->memory + offset, size);
+
+    ctx->stats.reads++;
+    ctx->stats.readBytes += size;
+    chargeTime(ctx, size, ctx->readNsPerByte);
     return WH_ERROR_OK;
 }
 
@@ -141,6 +201,10 @@ int whFlashRamsim_Erase(void* context, uint32_t offset, uint32_t size)
         return WH_ERROR_BADARGS;
     }
 
+    if (ctx->pendingOp != WH_FLASH_RAMSIM_OP_NONE) {
+        return WH_ERROR_NOTREADY;
+    }
+
     if (offset % ctx->sectorSize != 0 || size % ctx->sectorSize != 0) {
         return WH_ERROR_BADARGS;
     }
@@ -153,6 +217,10 @@ int whFlashRamsim_Erase(void* context, uint32_t offset, uint32_t size)
     /* Perform the erase */
     memset(ctx->memory + offset, ctx->erasedByte, size);
 
+    ctx->stats.erases++;
+    ctx->stats.eraseSectors += size / ctx->sectorSize;
+    chargeTime(ctx, size / ctx->sectorSize, ctx->eraseNsPerSector);
+
     return WH_ERROR_OK;
 }
 
@@ -166,6 +234,13 @@ int whFlashRamsim_Verify(void* context, uint32_t offset, uint32_t size,
         return WH_ERROR_BADARGS;
     }
 
+    if (ctx->pendingOp != WH_FLASH_RAMSIM_OP_NONE) {
+        return WH_ERROR_NOTREADY;
+    }
+
+    ctx->stats.verifies++;
+    chargeTime(ctx, size, ctx->readNsPerByte);
+
     /* Check stored data equals input data */
     for (i = 0; i < size; ++i) {
         if (ctx->memory[offset + i] != data[i]) {
@@ -186,6 +261,13 @@ int whFlashRamsim_BlankCheck(void* context, uint32_t offset, uint32_t size)
         return WH_ERROR_BADARGS;
     }
 
+    if (ctx->pendingOp != WH_FLASH_RAMSIM_OP_NONE) {
+        return WH_ERROR_NOTREADY;
+    }
+
+    ctx->stats.blankChecks++;
+    chargeTime(ctx, size, ctx->readNsPerByte);
+
     if (!isMemoryErased(ctx, offset, size)) {
         return WH_ERROR_NOTBLANK;
     }
@@ -238,3 +320,99 @@ int whFlashRamsim_WriteUnlock(void* context, uint32_t offset, uint32_t size)
 
     return WH_ERROR_OK;
 }
+
+
+int whFlashRamsim_EraseStart(void* context, uint32_t offset, uint32_t size)
+{
+    return startOperation((whFlashRamsimCtx*)context,
+                          WH_FLASH_RAMSIM_OP_ERASE, offset, size, NULL);
+}
+
+
+int whFlashRamsim_ProgramStart(void* context, uint32_t offset, uint32_t size,
+                               const uint8_t* data)
+{
+    return startOperation((whFlashRamsimCtx*)context,
+                          WH_FLASH_RAMSIM_OP_PROGRAM, offset, size, data);
+}
+
+
+int whFlashRamsim_Poll(void* context)
+{
+    whFlashRamsimCtx* ctx = (whFlashRamsimCtx*)context;
+    int               op  = 0;
+
+    if (ctx == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+    if (ctx->pendingOp == WH_FLASH_RAMSIM_OP_NONE) {
+        return WH_ERROR_OK;
+    }
+    if (ctx->pendingPolls > 0) {
+        ctx->pendingPolls--;
+        return WH_ERROR_NOTREADY;
+    }
+
+    /* Complete the operation now, as the synchronous version would */
+    op             = ctx->pendingOp;
+    ctx->pendingOp = WH_FLASH_RAMSIM_OP_NONE;
+    if (op == WH_FLASH_RAMSIM_OP_ERASE) {
+        return whFlashRamsim_Erase(ctx, ctx->pendingOffset, ctx->pendingSize);
+    }
+    return whFlashRamsim_Program(ctx, ctx->pendingOffset, ctx->pendingSize,
+                                 ctx->pendingData);
+}
+
+
+int whFlashRamsim_Map(void* context, uint32_t offset, uint32_t size,
+                      const uint8_t** out_ptr)
+{
+    whFlashRamsimCtx* ctx = (whFlashRamsimCtx*)context;
+
+    if ((ctx == NULL) || (ctx->memory == NULL) ||
+        ((offset + size) > ctx->size) || (out_ptr == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    if (!ctx->mapped) {
+        return WH_ERROR_NOTIMPL;
+    }
+
+    if (ctx->pendingOp != WH_FLASH_RAMSIM_OP_NONE) {
+        return WH_ERROR_NOTREADY;
+    }
+
+    /* Charged as the read the caller will make in place */
+    ctx->stats.reads++;
+    ctx->stats.readBytes += size;
+    chargeTime(ctx, size, ctx->readNsPerByte);
+
+    *out_ptr = ctx->memory + offset;
+    return WH_ERROR_OK;
+}
+
+
+int whFlashRamsim_GetStats(void* context, whFlashRamsimStats* out_stats)
+{
+    whFlashRamsimCtx* ctx = (whFlashRamsimCtx*)context;
+
+    if ((ctx == NULL) || (out_stats == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    memcpy(out_stats, &ctx->stats, sizeof(*out_stats));
+    return WH_ERROR_OK;
+}
+
+
+int whFlashRamsim_ResetStats(void* context)
+{
+    whFlashRamsimCtx* ctx = (whFlashRamsimCtx*)context;
+
+    if (ctx == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    memset(&ctx->stats, 0, sizeof(ctx->stats));
+    return WH_ERROR_OK;
+}
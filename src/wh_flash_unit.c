@@ -67,9 +67,11 @@ int wh_FlashUnit_Read(const whFlashCb* cb, void* context,
     return cb->Read(context, byte_offset, byte_count,(uint8_t*) data);
 }
 
-/* Program from data count units starting at offset */
-int wh_FlashUnit_Program(const whFlashCb* cb, void* context,
-        uint32_t offset, uint32_t count, const whFlashUnit* data)
+/* Blank check, program and, when asked, verify count units at offset.  Each
+ * operation issued is added to stats when it is not NULL */
+static int _ProgramVerify(const whFlashCb* cb, void* context,
+        uint32_t offset, uint32_t count, const whFlashUnit* data, int verify,
+        whFlashUnitStats* stats)
 {
     uint32_t byte_offset = offset * WHFU_BYTES_PER_UNIT;
     uint32_t byte_count = count * WHFU_BYTES_PER_UNIT;
@@ -77,13 +79,16 @@ int wh_FlashUnit_Program(const whFlashCb* cb, void* context,
     if (    (cb == NULL) ||
             (cb->BlankCheck == NULL) ||
             (cb->Program == NULL) ||
-            (cb->Verify == NULL)) {
+            ((verify != 0) && (cb->Verify == NULL))) {
             return WH_ERROR_BADARGS;
     }
     /* Blank check first */
     ret = cb->BlankCheck(context,
             byte_offset,
             byte_count);
+    if (stats != NULL) {
+        stats->blank_checks++;
+    }
     if (ret == 0) {
         /* Program the output data */
         ret = cb->Program(
@@ -91,18 +96,32 @@ int wh_FlashUnit_Program(const whFlashCb* cb, void* context,
                 byte_offset,
                 byte_count,
                 (uint8_t*) data);
-        if (ret == 0) {
+        if (stats != NULL) {
+            stats->program_ops++;
+            stats->program_bytes += byte_count;
+        }
+        if ((ret == 0) && (verify != 0)) {
             /* Verify the programming was successful */
             ret = cb->Verify(
                     context,
                     byte_offset,
                     byte_count,
                     (uint8_t*) data);
+            if (stats != NULL) {
+                stats->verifies++;
+            }
         }
     }
     return ret;
 }
 
+/* Program from data count units starting at offset */
+int wh_FlashUnit_Program(const whFlashCb* cb, void* context,
+        uint32_t offset, uint32_t count, const whFlashUnit* data)
+{
+    return _ProgramVerify(cb, context, offset, count, data, 1, NULL);
+}
+
 int wh_FlashUnit_BlankCheck(const whFlashCb* cb, void* context,
         uint32_t offset, uint32_t count)
 {
@@ -137,6 +156,68 @@ int wh_FlashUnit_Erase(const whFlashCb* cb, void* context,
     return ret;
 }
 
+int wh_FlashUnit_EraseStart(const whFlashCb* cb, void* context,
+        uint32_t offset, uint32_t count)
+{
+    int ret = 0;
+
+    if (cb == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+    if ((cb->EraseStart == NULL) || (cb->Poll == NULL)) {
+        return wh_FlashUnit_Erase(cb, context, offset, count);
+    }
+
+    if (count == 0) return 0;
+
+    ret = cb->EraseStart(context, offset * WHFU_BYTES_PER_UNIT,
+            count * WHFU_BYTES_PER_UNIT);
+    if (ret == 0) {
+        ret = WH_ERROR_NOTREADY;
+    }
+    return ret;
+}
+
+int wh_FlashUnit_ProgramStart(const whFlashCb* cb, void* context,
+        uint32_t offset, uint32_t count, const whFlashUnit* data)
+{
+    uint32_t byte_offset = offset * WHFU_BYTES_PER_UNIT;
+    uint32_t byte_count = count * WHFU_BYTES_PER_UNIT;
+    int ret = 0;
+
+    if (cb == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+    if ((cb->ProgramStart == NULL) || (cb->Poll == NULL)) {
+        return wh_FlashUnit_Program(cb, context, offset, count, data);
+    }
+    if (cb->BlankCheck == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    /* Blank check first, the result is only known once Poll completes */
+    ret = cb->BlankCheck(context, byte_offset, byte_count);
+    if (ret == 0) {
+        ret = cb->ProgramStart(context, byte_offset, byte_count,
+                (const uint8_t*)data);
+    }
+    if (ret == 0) {
+        ret = WH_ERROR_NOTREADY;
+    }
+    return ret;
+}
+
+int wh_FlashUnit_Poll(const whFlashCb* cb, void* context)
+{
+    if (cb == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+    if (cb->Poll == NULL) {
+        return 0;
+    }
+    return cb->Poll(context);
+}
+
 /** Helper functions to use buffered reads and writes for bytes */
 
 uint32_t wh_FlashUnit_Bytes2Units(uint32_t bytes)
@@ -164,9 +245,9 @@ int wh_FlashUnit_ReadBytes(const whFlashCb* cb, void* context,
     if (offset_rem != 0) {
         ret = wh_FlashUnit_Read(cb, context, offset_units, 1, &buffer.unit);
         if (ret == 0) {
-            uint32_t this_size = offset_rem;
+            uint32_t this_size = WHFU_BYTES_PER_UNIT - offset_rem;
             if (data_len < this_size) this_size = data_len;
-            memcpy(data, &buffer.bytes[WHFU_BYTES_PER_UNIT - offset_rem], this_size);
+            memcpy(data, &buffer.bytes[offset_rem], this_size);
             data += this_size;
             data_len -= this_size;
             offset_units++;
@@ -194,6 +275,18 @@ int wh_FlashUnit_ReadBytes(const whFlashCb* cb, void* context,
     return ret;
 }
 
+int wh_FlashUnit_MapBytes(const whFlashCb* cb, void* context,
+        uint32_t byte_offset, uint32_t byte_count, const uint8_t** out_data)
+{
+    if ((cb == NULL) || (out_data == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    if (cb->Map == NULL) {
+        return WH_ERROR_NOTIMPL;
+    }
+    return cb->Map(context, byte_offset, byte_count, out_data);
+}
+
 int wh_FlashUnit_ProgramBytes(const whFlashCb* cb, void* context,
         uint32_t byte_offset, uint32_t byte_count, const uint8_t* data)
 {
@@ -225,3 +318,168 @@ int wh_FlashUnit_ProgramBytes(const whFlashCb* cb, void* context,
     }
     return ret;
 }
+
+/** Write combining helpers */
+
+int wh_FlashUnit_WriterInit(whFlashUnitWriter* w, const whFlashCb* cb,
+        void* context, uint32_t page_bytes, whFlashUnitVerify verify)
+{
+    if ((w == NULL) || (cb == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    memset(w, 0, sizeof(*w));
+    w->cb = cb;
+    w->context = context;
+    w->verify = verify;
+    if ((page_bytes % WHFU_BYTES_PER_UNIT) == 0) {
+        w->page_units = page_bytes / WHFU_BYTES_PER_UNIT;
+    }
+    return 0;
+}
+
+void wh_FlashUnit_WriterSetStats(whFlashUnitWriter* w,
+        whFlashUnitStats* stats)
+{
+    if (w != NULL) {
+        w->stats = stats;
+    }
+}
+
+int wh_FlashUnit_WriterFlush(whFlashUnitWriter* w)
+{
+    int ret = 0;
+
+    if (w == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+    if (w->count > 0) {
+        ret = _ProgramVerify(w->cb, w->context, w->offset, w->count,
+                w->buffer, w->verify == WHFU_VERIFY_ALWAYS, w->stats);
+        w->count = 0;
+    }
+    return ret;
+}
+
+void wh_FlashUnit_WriterDiscard(whFlashUnitWriter* w)
+{
+    if (w != NULL) {
+        w->count = 0;
+    }
+}
+
+int wh_FlashUnit_WriterProgram(whFlashUnitWriter* w, uint32_t offset,
+        uint32_t count, const whFlashUnit* data)
+{
+    int ret = 0;
+    uint32_t room = 0;
+    uint32_t page_room = 0;
+
+    if ((w == NULL) || ((count > 0) && (data == NULL))) {
+        return WH_ERROR_BADARGS;
+    }
+
+    while ((ret == 0) && (count > 0)) {
+        /* Only a write that extends the buffered range joins it */
+        if ((w->count > 0) && (offset != w->offset + w->count)) {
+            ret = wh_FlashUnit_WriterFlush(w);
+            if (ret != 0) {
+                break;
+            }
+        }
+
+        /* Never combine across a program page */
+        page_room = count;
+        if (w->page_units != 0) {
+            page_room = w->page_units - (offset % w->page_units);
+            if (page_room > count) {
+                page_room = count;
+            }
+        }
+
+        if (w->count == 0) {
+            /* Runs that fill the rest of a page or overflow the buffer need
+             * no combining.  Program them straight from data */
+            if (    ((w->page_units != 0) && (page_room > 0) &&
+                        (((offset + page_room) % w->page_units) == 0)) ||
+                    ((w->page_units == 0) && (count > WHFU_WRITER_UNITS))) {
+                ret = _ProgramVerify(w->cb, w->context, offset, page_room,
+                        data, w->verify == WHFU_VERIFY_ALWAYS, w->stats);
+                offset += page_room;
+                data += page_room;
+                count -= page_room;
+                continue;
+            }
+            w->offset = offset;
+        }
+
+        room = WHFU_WRITER_UNITS - w->count;
+        if (room > page_room) {
+            room = page_room;
+        }
+
+        memcpy(&w->buffer[w->count], data, room * WHFU_BYTES_PER_UNIT);
+        w->count += room;
+        offset += room;
+        data += room;
+        count -= room;
+
+        /* Program a full buffer or page right away */
+        if (    (w->count == WHFU_WRITER_UNITS) ||
+                ((w->page_units != 0) && ((offset % w->page_units) == 0))) {
+            ret = wh_FlashUnit_WriterFlush(w);
+        }
+    }
+    if (ret != 0) {
+        wh_FlashUnit_WriterDiscard(w);
+    }
+    return ret;
+}
+
+int wh_FlashUnit_WriterProgramBytes(whFlashUnitWriter* w, uint32_t byte_offset,
+        uint32_t byte_count, const uint8_t* data)
+{
+    int ret = 0;
+    whFlashUnitBuffer buffer = {0};
+    uint32_t offset = byte_offset / WHFU_BYTES_PER_UNIT;
+    uint32_t count = byte_count / WHFU_BYTES_PER_UNIT;
+    uint32_t rem = byte_count % WHFU_BYTES_PER_UNIT;
+
+    if ((w == NULL) || ((byte_count > 0) && (data == NULL))) {
+        return WH_ERROR_BADARGS;
+    }
+
+    /* Unaligned writes are skipped */
+    data += byte_offset % WHFU_BYTES_PER_UNIT;
+
+    /* Aligned programming, copied into the buffer with memcpy */
+    ret = wh_FlashUnit_WriterProgram(w, offset, count,
+            (const whFlashUnit*)data);
+
+    /* Final partial unit */
+    if ((ret == 0) && (rem != 0)) {
+        data = data + count * WHFU_BYTES_PER_UNIT;
+        memcpy(buffer.bytes, data, rem);
+        ret = wh_FlashUnit_WriterProgram(w, offset + count, 1, &buffer.unit);
+    }
+    return ret;
+}
+
+int wh_FlashUnit_WriterFinish(whFlashUnitWriter* w, uint32_t offset,
+        uint32_t count, const whFlashUnit* data)
+{
+    int ret = 0;
+
+    if (w == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    ret = wh_FlashUnit_WriterFlush(w);
+    if ((ret == 0) && (count > 0)) {
+        ret = _ProgramVerify(w->cb, w->context, offset, count, data,
+                w->verify != WHFU_VERIFY_NEVER, w->stats);
+    }
+    if (ret != 0) {
+        wh_FlashUnit_WriterDiscard(w);
+    }
+    return ret;
+}
@@ -68,3 +68,212 @@ int wh_MessageComm_TranslateLenData(uint16_t magic,
     return 0;
 }
 
+int wh_MessageComm_TranslateJobRequest(uint16_t magic,
+        const whMessageCommJobRequest* src,
+        whMessageCommJobRequest* dest)
+{
+    if (    (src == NULL) ||
+            (dest == NULL)  ) {
+        return WH_ERROR_BADARGS;
+    }
+    dest->id = wh_Translate16(magic, src->id);
+    return 0;
+}
+
+int wh_MessageComm_TranslateJobResponse(uint16_t magic,
+        const whMessageCommJobResponse* src,
+        whMessageCommJobResponse* dest)
+{
+    if (    (src == NULL) ||
+            (dest == NULL)  ) {
+        return WH_ERROR_BADARGS;
+    }
+    dest->rc = (int32_t)wh_Translate32(magic, (uint32_t)src->rc);
+    dest->id = wh_Translate16(magic, src->id);
+    dest->kind = wh_Translate16(magic, src->kind);
+    dest->len = wh_Translate16(magic, src->len);
+    return 0;
+}
+
+int wh_MessageComm_TranslateStatsRequest(uint16_t magic,
+        const whMessageCommStatsRequest* src,
+        whMessageCommStatsRequest* dest)
+{
+    if (    (src == NULL) ||
+            (dest == NULL)  ) {
+        return WH_ERROR_BADARGS;
+    }
+    dest->start = wh_Translate16(magic, src->start);
+    dest->reset = src->reset;
+    return 0;
+}
+
+int wh_MessageComm_TranslateStatsResponse(uint16_t magic,
+        const whMessageCommStatsResponse* src,
+        whMessageCommStatsResponse* dest)
+{
+    if (    (src == NULL) ||
+            (dest == NULL)  ) {
+        return WH_ERROR_BADARGS;
+    }
+    dest->rc = (int32_t)wh_Translate32(magic, (uint32_t)src->rc);
+    dest->total = wh_Translate16(magic, src->total);
+    dest->count = wh_Translate16(magic, src->count);
+    return 0;
+}
+
+int wh_MessageComm_TranslateStatsEntry(uint16_t magic,
+        const whMessageCommStatsEntry* src,
+        whMessageCommStatsEntry* dest)
+{
+    int i = 0;
+
+    if (    (src == NULL) ||
+            (dest == NULL)  ) {
+        return WH_ERROR_BADARGS;
+    }
+    dest->count = wh_Translate32(magic, src->count);
+    dest->bytes_in = wh_Translate32(magic, src->bytes_in);
+    dest->bytes_out = wh_Translate32(magic, src->bytes_out);
+    dest->time_min = wh_Translate32(magic, src->time_min);
+    dest->time_max = wh_Translate32(magic, src->time_max);
+    dest->time_mean = wh_Translate32(magic, src->time_mean);
+    for (i = 0; i < WH_MESSAGE_COMM_STATS_HIST_BINS; i++) {
+        dest->hist[i] = wh_Translate32(magic, src->hist[i]);
+    }
+    dest->kind = wh_Translate16(magic, src->kind);
+    return 0;
+}
+
+int wh_MessageComm_TranslateDmaMapRequest(uint16_t magic,
+        const whMessageCommDmaMapRequest* src,
+        whMessageCommDmaMapRequest* dest)
+{
+    if (    (src == NULL) ||
+            (dest == NULL)  ) {
+        return WH_ERROR_BADARGS;
+    }
+    dest->addr = wh_Translate64(magic, src->addr);
+    dest->len = wh_Translate64(magic, src->len);
+    dest->access = src->access;
+    return 0;
+}
+
+int wh_MessageComm_TranslateDmaMapResponse(uint16_t magic,
+        const whMessageCommDmaMapResponse* src,
+        whMessageCommDmaMapResponse* dest)
+{
+    if (    (src == NULL) ||
+            (dest == NULL)  ) {
+        return WH_ERROR_BADARGS;
+    }
+    dest->rc = (int32_t)wh_Translate32(magic, (uint32_t)src->rc);
+    dest->handle = wh_Translate32(magic, src->handle);
+    return 0;
+}
+
+int wh_MessageComm_TranslateDmaUnmapRequest(uint16_t magic,
+        const whMessageCommDmaUnmapRequest* src,
+        whMessageCommDmaUnmapRequest* dest)
+{
+    if (    (src == NULL) ||
+            (dest == NULL)  ) {
+        return WH_ERROR_BADARGS;
+    }
+    dest->handle = wh_Translate32(magic, src->handle);
+    return 0;
+}
+
+
+int wh_MessageComm_BatchInit(void* batch, uint16_t batch_size)
+{
+    if (    (batch == NULL) ||
+            (batch_size < sizeof(whMessageCommBatchHeader))) {
+        return WH_ERROR_BADARGS;
+    }
+    /* Zero is the same in either endianness */
+    memset(batch, 0, sizeof(whMessageCommBatchHeader));
+    return 0;
+}
+
+int wh_MessageComm_BatchAppend(uint16_t magic, void* batch, uint16_t batch_size,
+        uint16_t kind, int32_t rc, uint16_t len, const void* data)
+{
+    whMessageCommBatchHeader* hdr = (whMessageCommBatchHeader*)batch;
+    whMessageCommBatchEntry* entry = NULL;
+    uint32_t offset = 0;
+    uint32_t padded = 0;
+
+    if (    (batch == NULL) ||
+            (batch_size < sizeof(*hdr)) ||
+            ((len > 0) && (data == NULL))) {
+        return WH_ERROR_BADARGS;
+    }
+
+    offset = sizeof(*hdr) + wh_Translate16(magic, hdr->len);
+    padded = sizeof(*entry) +
+            ((len + WH_MESSAGE_COMM_BATCH_ALIGN - 1) &
+             ~(uint32_t)(WH_MESSAGE_COMM_BATCH_ALIGN - 1));
+    if (offset + padded > batch_size) {
+        return WH_ERROR_NOSPACE;
+    }
+
+    entry = (whMessageCommBatchEntry*)((uint8_t*)batch + offset);
+    entry->kind = wh_Translate16(magic, kind);
+    entry->len = wh_Translate16(magic, len);
+    entry->rc = (int32_t)wh_Translate32(magic, (uint32_t)rc);
+    if ((len > 0) && (data != (const void*)(entry + 1))) {
+        memmove(entry + 1, data, len);
+    }
+    if (padded > sizeof(*entry) + len) {
+        memset((uint8_t*)(entry + 1) + len, 0, padded - sizeof(*entry) - len);
+    }
+
+    hdr->count = wh_Translate16(magic, wh_Translate16(magic, hdr->count) + 1);
+    hdr->len = wh_Translate16(magic,
+            (uint16_t)(offset + padded - sizeof(*hdr)));
+    return 0;
+}
+
+int wh_MessageComm_BatchNext(uint16_t magic, const void* batch,
+        uint16_t batch_size, uint16_t* inout_offset,
+        uint16_t* out_kind, int32_t* out_rc, uint16_t* out_len,
+        const void** out_data)
+{
+    const whMessageCommBatchEntry* entry = NULL;
+    uint32_t end = batch_size;
+    uint32_t offset = 0;
+    uint16_t len = 0;
+
+    if (    (batch == NULL) ||
+            (batch_size < sizeof(whMessageCommBatchHeader)) ||
+            (inout_offset == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    offset = *inout_offset;
+    if (offset == 0) {
+        offset = sizeof(whMessageCommBatchHeader);
+    }
+    if (offset + sizeof(*entry) > end) {
+        return WH_ERROR_NOTFOUND;
+    }
+
+    entry = (const whMessageCommBatchEntry*)((const uint8_t*)batch + offset);
+    len = wh_Translate16(magic, entry->len);
+    offset += sizeof(*entry) +
+            ((len + WH_MESSAGE_COMM_BATCH_ALIGN - 1) &
+             ~(uint32_t)(WH_MESSAGE_COMM_BATCH_ALIGN - 1));
+    if (offset > end) {
+        /* Entry runs past the end of the batch */
+        return WH_ERROR_ABORTED;
+    }
+
+    if (out_kind != NULL) *out_kind = wh_Translate16(magic, entry->kind);
+    if (out_rc != NULL) *out_rc = (int32_t)wh_Translate32(magic,
+            (uint32_t)entry->rc);
+    if (out_len != NULL) *out_len = len;
+    if (out_data != NULL) *out_data = entry + 1;
+    *inout_offset = (uint16_t)offset;
+    return 0;
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * src/wh_message_counter.c
+ *
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "wolfhsm/wh_comm.h"
+
+#include "wolfhsm/wh_message.h"
+#include "wolfhsm/wh_message_counter.h"
+
+#include "wolfhsm/wh_error.h"
+
+int wh_MessageCounter_TranslateRequest(uint16_t magic,
+        const whMessageCounter_Request* src,
+        whMessageCounter_Request* dest)
+{
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T16(magic, dest, src, id);
+    return 0;
+}
+
+int wh_MessageCounter_TranslateResponse(uint16_t magic,
+        const whMessageCounter_Response* src,
+        whMessageCounter_Response* dest)
+{
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T32(magic, dest, src, rc);
+    WH_T32(magic, dest, src, value);
+    return 0;
+}
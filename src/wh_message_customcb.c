@@ -99,4 +99,39 @@ int wh_MessageCustomCb_TranslateResponse(uint16_t magic,
     _translateCustomData(magic, dst->type, &src->data, &dst->data);
 
     return WH_ERROR_OK;
-}
\ No newline at end of file
+}
+
+
+int wh_MessageCustomCb_TranslateRawRequest(
+    uint16_t magic, const whMessageCustomCb_RawRequest* src,
+    whMessageCustomCb_RawRequest* dst)
+{
+    if ((src == NULL) || (dst == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    dst->id   = wh_Translate32(magic, src->id);
+    dst->type = wh_Translate32(magic, src->type);
+    if (src != dst) {
+        memset(dst->padding, 0, sizeof(dst->padding));
+    }
+
+    return WH_ERROR_OK;
+}
+
+
+int wh_MessageCustomCb_TranslateRawResponse(
+    uint16_t magic, const whMessageCustomCb_RawResponse* src,
+    whMessageCustomCb_RawResponse* dst)
+{
+    if ((src == NULL) || (dst == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    dst->id   = wh_Translate32(magic, src->id);
+    dst->type = wh_Translate32(magic, src->type);
+    dst->rc   = wh_Translate32(magic, src->rc);
+    dst->err  = wh_Translate32(magic, src->err);
+
+    return WH_ERROR_OK;
+}
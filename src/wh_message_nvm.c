@@ -41,6 +41,7 @@ int wh_MessageNvm_TranslateSimpleResponse(uint16_t magic,
         return WH_ERROR_BADARGS;
     }
     WH_T32(magic, dest, src, rc);
+    WH_T32(magic, dest, src, epoch);
     return 0;
 }
 
@@ -91,6 +92,49 @@ int wh_MessageNvm_TranslateListResponse(uint16_t magic,
     WH_T32(magic, dest, src, rc);
     WH_T16(magic, dest, src, count);
     WH_T16(magic, dest, src, id);
+    WH_T32(magic, dest, src, epoch);
+    return 0;
+}
+
+int wh_MessageNvm_TranslateListMetadataRequest(uint16_t magic,
+        const whMessageNvm_ListMetadataRequest* src,
+        whMessageNvm_ListMetadataRequest* dest)
+{
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T32(magic, dest, src, cursor);
+    WH_T16(magic, dest, src, access);
+    WH_T16(magic, dest, src, flags);
+    WH_T16(magic, dest, src, max_count);
+    return 0;
+}
+
+int wh_MessageNvm_TranslateListMetadataResponse(uint16_t magic,
+        const whMessageNvm_ListMetadataResponse* src,
+        whMessageNvm_ListMetadataResponse* dest)
+{
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T32(magic, dest, src, rc);
+    WH_T32(magic, dest, src, cursor);
+    WH_T16(magic, dest, src, count);
+    return 0;
+}
+
+int wh_MessageNvm_TranslateListRecord(uint16_t magic,
+        const whMessageNvm_ListRecord* src,
+        whMessageNvm_ListRecord* dest)
+{
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T16(magic, dest, src, id);
+    WH_T16(magic, dest, src, access);
+    WH_T16(magic, dest, src, flags);
+    WH_T16(magic, dest, src, len);
+    memcpy(dest->label, src->label, sizeof(dest->label));
     return 0;
 }
 
@@ -106,6 +150,28 @@ int wh_MessageNvm_TranslateGetAvailableResponse(uint16_t magic,
     WH_T32(magic, dest, src, reclaim_size);
     WH_T16(magic, dest, src, avail_objects);
     WH_T16(magic, dest, src, reclaim_objects);
+    WH_T32(magic, dest, src, epoch);
+    return 0;
+}
+
+int wh_MessageNvm_TranslateGetStatsResponse(uint16_t magic,
+        const whMessageNvm_GetStatsResponse* src,
+        whMessageNvm_GetStatsResponse* dest)
+{
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T32(magic, dest, src, rc);
+    WH_T32(magic, dest, src, program_ops);
+    WH_T32(magic, dest, src, erase_ops);
+    WH_T32(magic, dest, src, blank_checks);
+    WH_T32(magic, dest, src, verifies);
+    WH_T32(magic, dest, src, compactions);
+    WH_T32(magic, dest, src, partition_erases[0]);
+    WH_T32(magic, dest, src, partition_erases[1]);
+    WH_T64(magic, dest, src, data_bytes);
+    WH_T64(magic, dest, src, program_bytes);
+    WH_T64(magic, dest, src, erase_bytes);
     return 0;
 }
 
@@ -128,6 +194,7 @@ int wh_MessageNvm_TranslateGetMetadataResponse(uint16_t magic,
         return WH_ERROR_BADARGS;
     }
     WH_T32(magic, dest, src, rc);
+    WH_T32(magic, dest, src, epoch);
     WH_T16(magic, dest, src, id);
     WH_T16(magic, dest, src, access);
     WH_T16(magic, dest, src, flags);
@@ -151,6 +218,29 @@ int wh_MessageNvm_TranslateAddObjectRequest(uint16_t magic,
     return 0;
 }
 
+int wh_MessageNvm_TranslateAddObjectWriteRequest(uint16_t magic,
+        const whMessageNvm_AddObjectWriteRequest* src,
+        whMessageNvm_AddObjectWriteRequest* dest)
+{
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T16(magic, dest, src, offset);
+    WH_T16(magic, dest, src, data_len);
+    return 0;
+}
+
+int wh_MessageNvm_TranslateAddObjectFinishRequest(uint16_t magic,
+        const whMessageNvm_AddObjectFinishRequest* src,
+        whMessageNvm_AddObjectFinishRequest* dest)
+{
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T16(magic, dest, src, commit);
+    return 0;
+}
+
 int wh_MessageNvm_TranslateDestroyObjectsRequest(uint16_t magic,
         const whMessageNvm_DestroyObjectsRequest* src,
         whMessageNvm_DestroyObjectsRequest* dest)
@@ -190,6 +280,50 @@ int wh_MessageNvm_TranslateReadResponse(uint16_t magic,
     return 0;
 }
 
+int wh_MessageNvm_TranslateReadObjectsRequest(uint16_t magic,
+        const whMessageNvm_ReadObjectsRequest* src,
+        whMessageNvm_ReadObjectsRequest* dest)
+{
+    int counter = 0;
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    for (counter = 0; counter < WH_MESSAGE_NVM_MAX_READ_OBJECTS_COUNT;
+            counter++) {
+        WH_T16(magic, dest, src, list[counter]);
+    }
+    WH_T16(magic, dest, src, list_count);
+    return 0;
+}
+
+int wh_MessageNvm_TranslateReadObjectsResponse(uint16_t magic,
+        const whMessageNvm_ReadObjectsResponse* src,
+        whMessageNvm_ReadObjectsResponse* dest)
+{
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T32(magic, dest, src, rc);
+    WH_T16(magic, dest, src, count);
+    return 0;
+}
+
+int wh_MessageNvm_TranslateReadObjectsRecord(uint16_t magic,
+        const whMessageNvm_ReadObjectsRecord* src,
+        whMessageNvm_ReadObjectsRecord* dest)
+{
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T16(magic, dest, src, id);
+    WH_T16(magic, dest, src, access);
+    WH_T16(magic, dest, src, flags);
+    WH_T16(magic, dest, src, len);
+    WH_T16(magic, dest, src, data_len);
+    memcpy(dest->label, src->label, sizeof(dest->label));
+    return 0;
+}
+
 int wh_MessageNvm_TranslateAddObjectDma32Request(uint16_t magic,
         const whMessageNvm_AddObjectDma32Request* src,
         whMessageNvm_AddObjectDma32Request* dest)
@@ -243,3 +377,57 @@ int wh_MessageNvm_TranslateReadDma64Request(uint16_t magic,
     WH_T16(magic, dest, src, data_len);
     return 0;
 }
+
+int wh_MessageNvm_TranslateReadObjectsDmaRequest(uint16_t magic,
+        const whMessageNvm_ReadObjectsDmaRequest* src,
+        whMessageNvm_ReadObjectsDmaRequest* dest)
+{
+    int counter = 0;
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T64(magic, dest, src, metadata_hostaddr);
+    WH_T16(magic, dest, src, list_count);
+    for (counter = 0; counter < WH_MESSAGE_NVM_MAX_READ_OBJECTS_COUNT;
+            counter++) {
+        WH_T64(magic, dest, src, list[counter].data_hostaddr);
+        WH_T16(magic, dest, src, list[counter].id);
+        WH_T16(magic, dest, src, list[counter].data_size);
+    }
+    return 0;
+}
+
+int wh_MessageNvm_TranslateAddObjectDmaSgRequest(uint16_t magic,
+        const whMessageNvm_AddObjectDmaSgRequest* src,
+        whMessageNvm_AddObjectDmaSgRequest* dest)
+{
+    int counter = 0;
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T64(magic, dest, src, metadata_hostaddr);
+    WH_T16(magic, dest, src, sg_count);
+    for (counter = 0; counter < WH_MESSAGE_NVM_MAX_DMA_SG_COUNT; counter++) {
+        WH_T64(magic, dest, src, sg[counter].data_hostaddr);
+        WH_T32(magic, dest, src, sg[counter].data_len);
+    }
+    return 0;
+}
+
+int wh_MessageNvm_TranslateReadDmaSgRequest(uint16_t magic,
+        const whMessageNvm_ReadDmaSgRequest* src,
+        whMessageNvm_ReadDmaSgRequest* dest)
+{
+    int counter = 0;
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T16(magic, dest, src, id);
+    WH_T16(magic, dest, src, offset);
+    WH_T16(magic, dest, src, sg_count);
+    for (counter = 0; counter < WH_MESSAGE_NVM_MAX_DMA_SG_COUNT; counter++) {
+        WH_T64(magic, dest, src, sg[counter].data_hostaddr);
+        WH_T32(magic, dest, src, sg[counter].data_len);
+    }
+    return 0;
+}
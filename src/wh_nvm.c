@@ -31,6 +31,22 @@
 
 #include "wolfhsm/wh_nvm.h"
 
+static int _Nvm_Lock(whNvmContext* context)
+{
+    if (    (context->lock_cb == NULL) ||
+            (context->lock_cb->Lock == NULL)) {
+        return 0;
+    }
+    return context->lock_cb->Lock(context->lock_context);
+}
+
+static void _Nvm_Unlock(whNvmContext* context)
+{
+    if (    (context->lock_cb != NULL) &&
+            (context->lock_cb->Unlock != NULL)) {
+        (void)context->lock_cb->Unlock(context->lock_context);
+    }
+}
 
 int wh_Nvm_Init(whNvmContext* context, const whNvmConfig *config)
 {
@@ -43,6 +59,9 @@ int wh_Nvm_Init(whNvmContext* context, const whNvmConfig *config)
 
     context->cb = config->cb;
     context->context = config->context;
+    context->lock_cb = config->lock_cb;
+    context->lock_context = config->lock_context;
+    context->epoch = 0;
 
     if (context->cb->Init != NULL) {
         rc = context->cb->Init(context->context, config->config);
@@ -73,6 +92,8 @@ int wh_Nvm_GetAvailable(whNvmContext* context,
         uint32_t *out_avail_size, whNvmId *out_avail_objects,
         uint32_t *out_reclaim_size, whNvmId *out_reclaim_objects)
 {
+    int rc = 0;
+
     if (    (context == NULL) ||
             (context->cb == NULL) ) {
         return WH_ERROR_BADARGS;
@@ -82,15 +103,22 @@ int wh_Nvm_GetAvailable(whNvmContext* context,
     if (context->cb->GetAvailable == NULL) {
         return WH_ERROR_ABORTED;
     }
-    return context->cb->GetAvailable(context->context,
-            out_avail_size, out_avail_objects,
-            out_reclaim_size, out_reclaim_objects);
+    rc = _Nvm_Lock(context);
+    if (rc == 0) {
+        rc = context->cb->GetAvailable(context->context,
+                out_avail_size, out_avail_objects,
+                out_reclaim_size, out_reclaim_objects);
+        _Nvm_Unlock(context);
+    }
+    return rc;
 }
 
 
 int wh_Nvm_AddObject(whNvmContext* context, whNvmMetadata *meta,
         whNvmSize data_len, const uint8_t* data)
 {
+    int rc = 0;
+
     if (    (context == NULL) ||
             (context->cb == NULL) ) {
         return WH_ERROR_BADARGS;
@@ -100,13 +128,123 @@ int wh_Nvm_AddObject(whNvmContext* context, whNvmMetadata *meta,
     if (context->cb->AddObject == NULL) {
         return WH_ERROR_ABORTED;
     }
-    return context->cb->AddObject(context->context, meta, data_len, data);
+    rc = _Nvm_Lock(context);
+    if (rc == 0) {
+        rc = context->cb->AddObject(context->context, meta, data_len, data);
+        /* Even a failed add may have replaced the object */
+        context->epoch++;
+        _Nvm_Unlock(context);
+    }
+    return rc;
+}
+
+int wh_Nvm_AddObjectBegin(whNvmContext* context, whNvmMetadata *meta,
+        whNvmSize data_len)
+{
+    int rc = 0;
+
+    if (    (context == NULL) ||
+            (context->cb == NULL) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    /* No callback? The object has to be added whole */
+    if (context->cb->AddObjectBegin == NULL) {
+        return WH_ERROR_NOTIMPL;
+    }
+    rc = _Nvm_Lock(context);
+    if (rc == 0) {
+        rc = context->cb->AddObjectBegin(context->context, meta, data_len);
+        _Nvm_Unlock(context);
+    }
+    return rc;
+}
+
+int wh_Nvm_AddObjectWrite(whNvmContext* context, whNvmSize offset,
+        whNvmSize data_len, const uint8_t* data)
+{
+    int rc = 0;
+
+    if (    (context == NULL) ||
+            (context->cb == NULL) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    if (context->cb->AddObjectWrite == NULL) {
+        return WH_ERROR_NOTIMPL;
+    }
+    rc = _Nvm_Lock(context);
+    if (rc == 0) {
+        rc = context->cb->AddObjectWrite(context->context, offset, data_len,
+                data);
+        _Nvm_Unlock(context);
+    }
+    return rc;
+}
+
+int wh_Nvm_AddObjectFinish(whNvmContext* context, int commit)
+{
+    int rc = 0;
+
+    if (    (context == NULL) ||
+            (context->cb == NULL) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    if (context->cb->AddObjectFinish == NULL) {
+        return WH_ERROR_NOTIMPL;
+    }
+    rc = _Nvm_Lock(context);
+    if (rc == 0) {
+        rc = context->cb->AddObjectFinish(context->context, commit);
+        if (commit != 0) {
+            context->epoch++;
+        }
+        _Nvm_Unlock(context);
+    }
+    return rc;
+}
+
+int wh_Nvm_AddObjects(whNvmContext* context, whNvmId count,
+        whNvmMetadata* meta, const uint8_t* const* data)
+{
+    int rc = 0;
+    whNvmId i = 0;
+
+    if (    (context == NULL) ||
+            (context->cb == NULL) ||
+            ((count > 0) && ((meta == NULL) || (data == NULL))) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    /* No callback? Return ABORTED */
+    if (    (context->cb->AddObjects == NULL) &&
+            (context->cb->AddObject == NULL) ) {
+        return WH_ERROR_ABORTED;
+    }
+    rc = _Nvm_Lock(context);
+    if (rc == 0) {
+        if (context->cb->AddObjects != NULL) {
+            rc = context->cb->AddObjects(context->context, count, meta, data);
+        } else {
+            /* Add one at a time */
+            for (i = 0; (rc == 0) && (i < count); i++) {
+                rc = context->cb->AddObject(context->context, &meta[i],
+                        meta[i].len, data[i]);
+            }
+        }
+        context->epoch++;
+        _Nvm_Unlock(context);
+    }
+    return rc;
 }
 
 int wh_Nvm_List(whNvmContext* context,
         whNvmAccess access, whNvmFlags flags, whNvmId start_id,
         whNvmId *out_count, whNvmId *out_id)
 {
+    int rc = 0;
+
     if (    (context == NULL) ||
             (context->cb == NULL) ) {
         return WH_ERROR_BADARGS;
@@ -116,13 +254,71 @@ int wh_Nvm_List(whNvmContext* context,
     if (context->cb->List == NULL) {
         return WH_ERROR_ABORTED;
     }
-    return context->cb->List(context->context, access, flags, start_id,
-            out_count, out_id);
+    rc = _Nvm_Lock(context);
+    if (rc == 0) {
+        rc = context->cb->List(context->context, access, flags, start_id,
+                out_count, out_id);
+        _Nvm_Unlock(context);
+    }
+    return rc;
+}
+
+int wh_Nvm_ListMetadata(whNvmContext* context,
+        whNvmAccess access, whNvmFlags flags, uint32_t *inout_cursor,
+        whNvmId max_count, whNvmId *out_count, whNvmMetadata* out_meta)
+{
+    int rc = 0;
+    whNvmId count = 0;
+    whNvmId list_count = 0;
+    whNvmId list_id = 0;
+
+    if (    (context == NULL) ||
+            (context->cb == NULL) ||
+            (inout_cursor == NULL) ||
+            ((max_count > 0) && (out_meta == NULL)) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    /* No callback? Walk List and GetMetadata with the last id as cursor */
+    if (    (context->cb->ListMetadata == NULL) &&
+            (   (context->cb->List == NULL) ||
+                (context->cb->GetMetadata == NULL) ) ) {
+        return WH_ERROR_ABORTED;
+    }
+    rc = _Nvm_Lock(context);
+    if (rc == 0) {
+        if (context->cb->ListMetadata != NULL) {
+            rc = context->cb->ListMetadata(context->context, access, flags,
+                    inout_cursor, max_count, &count, out_meta);
+        }
+        else {
+            while ((rc == 0) && (count < max_count)) {
+                rc = context->cb->List(context->context, access, flags,
+                        (whNvmId)*inout_cursor, &list_count, &list_id);
+                if ((rc != 0) || (list_count == 0)) {
+                    break;
+                }
+                rc = context->cb->GetMetadata(context->context, list_id,
+                        &out_meta[count]);
+                if (rc == 0) {
+                    *inout_cursor = list_id;
+                    count++;
+                }
+            }
+        }
+        _Nvm_Unlock(context);
+    }
+    if ((rc == 0) && (out_count != NULL)) {
+        *out_count = count;
+    }
+    return rc;
 }
 
 int wh_Nvm_GetMetadata(whNvmContext* context, whNvmId id,
         whNvmMetadata* meta)
 {
+    int rc = 0;
+
     if (    (context == NULL) ||
             (context->cb == NULL) ) {
         return WH_ERROR_BADARGS;
@@ -132,13 +328,20 @@ int wh_Nvm_GetMetadata(whNvmContext* context, whNvmId id,
     if (context->cb->GetMetadata == NULL) {
         return WH_ERROR_ABORTED;
     }
-    return context->cb->GetMetadata(context->context, id, meta);
+    rc = _Nvm_Lock(context);
+    if (rc == 0) {
+        rc = context->cb->GetMetadata(context->context, id, meta);
+        _Nvm_Unlock(context);
+    }
+    return rc;
 }
 
 
 int wh_Nvm_DestroyObjects(whNvmContext* context, whNvmId list_count,
         const whNvmId* id_list)
 {
+    int rc = 0;
+
     if (    (context == NULL) ||
             (context->cb == NULL) ) {
         return WH_ERROR_BADARGS;
@@ -148,13 +351,74 @@ int wh_Nvm_DestroyObjects(whNvmContext* context, whNvmId list_count,
     if (context->cb->DestroyObjects == NULL) {
         return WH_ERROR_ABORTED;
     }
-    return context->cb->DestroyObjects(context->context, list_count, id_list);
+    rc = _Nvm_Lock(context);
+    if (rc == 0) {
+        rc = context->cb->DestroyObjects(context->context, list_count, id_list);
+        if (list_count != 0) {
+            /* An empty list only compacts */
+            context->epoch++;
+        }
+        _Nvm_Unlock(context);
+    }
+    return rc;
+}
+
+
+int wh_Nvm_Compact(whNvmContext* context)
+{
+    int rc = 0;
+
+    if (    (context == NULL) ||
+            (context->cb == NULL) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    /* No callback? Regenerate through an empty destroy */
+    if (    (context->cb->Compact == NULL) &&
+            (context->cb->DestroyObjects == NULL) ) {
+        return WH_ERROR_ABORTED;
+    }
+    rc = _Nvm_Lock(context);
+    if (rc == 0) {
+        if (context->cb->Compact != NULL) {
+            rc = context->cb->Compact(context->context);
+        }
+        else {
+            rc = context->cb->DestroyObjects(context->context, 0, NULL);
+        }
+        _Nvm_Unlock(context);
+    }
+    return rc;
+}
+
+
+int wh_Nvm_CompactStep(whNvmContext* context)
+{
+    int rc = 0;
+
+    if (    (context == NULL) ||
+            (context->cb == NULL) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    /* No callback? Nothing is ever deferred */
+    if (context->cb->CompactStep == NULL) {
+        return 0;
+    }
+    rc = _Nvm_Lock(context);
+    if (rc == 0) {
+        rc = context->cb->CompactStep(context->context);
+        _Nvm_Unlock(context);
+    }
+    return rc;
 }
 
 
 int wh_Nvm_Read(whNvmContext* context, whNvmId id, whNvmSize offset,
         whNvmSize data_len, uint8_t* data)
 {
+    int rc = 0;
+
     if (    (context == NULL) ||
             (context->cb == NULL) ) {
         return WH_ERROR_BADARGS;
@@ -164,6 +428,68 @@ int wh_Nvm_Read(whNvmContext* context, whNvmId id, whNvmSize offset,
     if (context->cb->Read == NULL) {
         return WH_ERROR_ABORTED;
     }
-    return context->cb->Read(context->context, id, offset, data_len, data);
+    rc = _Nvm_Lock(context);
+    if (rc == 0) {
+        rc = context->cb->Read(context->context, id, offset, data_len, data);
+        _Nvm_Unlock(context);
+    }
+    return rc;
 }
 
+int wh_Nvm_ReadPointer(whNvmContext* context, whNvmId id, whNvmSize offset,
+        whNvmSize data_len, const uint8_t** out_data)
+{
+    int rc = 0;
+
+    if (    (context == NULL) ||
+            (context->cb == NULL) ||
+            (out_data == NULL) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    /* No callback? Caller reads a copy instead */
+    if (context->cb->ReadPointer == NULL) {
+        return WH_ERROR_NOTIMPL;
+    }
+    rc = _Nvm_Lock(context);
+    if (rc == 0) {
+        rc = context->cb->ReadPointer(context->context, id, offset, data_len,
+                out_data);
+        _Nvm_Unlock(context);
+    }
+    return rc;
+}
+
+int wh_Nvm_GetEpoch(whNvmContext* context, uint32_t* out_epoch)
+{
+    if (    (context == NULL) ||
+            (out_epoch == NULL) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    /* Single aligned word, so no lock is needed to read it */
+    *out_epoch = context->epoch;
+    return 0;
+}
+
+int wh_Nvm_GetStats(whNvmContext* context, whNvmStats* out_stats)
+{
+    int rc = 0;
+
+    if (    (context == NULL) ||
+            (context->cb == NULL) ||
+            (out_stats == NULL) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    /* No callback? Nothing is tracked */
+    if (context->cb->GetStats == NULL) {
+        return WH_ERROR_NOTIMPL;
+    }
+    rc = _Nvm_Lock(context);
+    if (rc == 0) {
+        rc = context->cb->GetStats(context->context, out_stats);
+        _Nvm_Unlock(context);
+    }
+    return rc;
+}
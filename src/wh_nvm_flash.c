@@ -85,11 +85,25 @@ typedef struct {
 #define NF_PARTITION_DIRECTORY_OFFSET WHFU_BYTES2UNITS(offsetof(nfPartition, directory))
 #define NF_PARTITION_DATA_OFFSET WHFU_BYTES2UNITS(sizeof(nfPartition))
 
+/* Add _n to a wear counter when built with WOLFHSM_NVM_STATS */
+#ifdef WOLFHSM_NVM_STATS
+#define NF_STATS_ADD(_context, _field, _n) ((_context)->_field += (_n))
+#else
+#define NF_STATS_ADD(_context, _field, _n) do { } while (0)
+#endif
+
+/* ListMetadata cursor: the low bits of the partition epoch above the index of
+ * the next entry to examine */
+#define NF_CURSOR(_epoch, _entry) \
+            ((((uint32_t)(_epoch) & 0xFFFFu) << 16) | (uint32_t)(_entry))
+#define NF_CURSOR_EPOCH(_cursor) ((uint32_t)(_cursor) >> 16)
+#define NF_CURSOR_ENTRY(_cursor) ((int)((_cursor) & 0xFFFFu))
+
 /** Local declarations */
 static int nfMemState_Read(whNvmFlashContext* context, uint32_t offset,
         nfMemState* state);
 static int nfMemObject_Read(whNvmFlashContext* context, uint32_t offset,
-        nfMemObject* object);
+        nfMemEntry* entry, whNvmMetadata* metadata);
 
 static uint32_t nfPartition_Offset(whNvmFlashContext* context, int partition);
 static uint32_t nfPartition_DataOffset(whNvmFlashContext* context,
@@ -97,9 +111,13 @@ static uint32_t nfPartition_DataOffset(whNvmFlashContext* context,
 static int nfPartition_WriteLock(whNvmFlashContext* context, int partition);
 static int nfPartition_WriteUnlock(whNvmFlashContext* context, int partition);
 static int nfPartition_BlankCheck(whNvmFlashContext* context, int partition);
+static void nfPartition_CountErase(whNvmFlashContext* context, int partition);
 static int nfPartition_Erase(whNvmFlashContext* context, int partition);
+static int nfPartition_EraseStart(whNvmFlashContext* context, int partition);
 static int nfPartition_ReadMemState(whNvmFlashContext* context, int partition,
         nfMemState* state);
+static int nfPartition_ReadSummarized(whNvmFlashContext* context,
+        uint32_t offset, int index, int count, nfMemDirectory* directory);
 static int nfPartition_ReadMemDirectory(whNvmFlashContext* context,
         int partition, nfMemDirectory* directory);
 static int nfPartition_ReadParseMemDirectory(whNvmFlashContext* context,
@@ -130,12 +148,32 @@ static int nfObject_Program(whNvmFlashContext* context, int partition,
 static int nfObject_ReadDataBytes(whNvmFlashContext* context, int partition,
         int object_index, uint32_t byte_offset, uint32_t byte_count,
         uint8_t* out_data);
+static int nfObject_MapDataBytes(whNvmFlashContext* context, int partition,
+        int object_index, uint32_t byte_offset, uint32_t byte_count,
+        const uint8_t** out_data);
 static int nfObject_Copy(whNvmFlashContext* context, int object_index,
         int partition, uint32_t *inout_next_object, uint32_t *inout_next_data);
+static void nfDataCache_Invalidate(whNvmFlashContext* context, whNvmId id);
+static int nfDataCache_Read(whNvmFlashContext* context, int object_index,
+        uint32_t byte_offset, uint32_t byte_count, uint8_t* out_data);
+static int nfObject_Tombstone(whNvmFlashContext* context, int object_index);
+static void nfCompact_Start(whNvmFlashContext* context);
+static void nfCompact_Restart(whNvmFlashContext* context);
+static int nfCompact_Poll(whNvmFlashContext* context, int wait);
+static int nfCompact_Step(whNvmFlashContext* context, int max_objects);
+static int nfPartition_Regenerate(whNvmFlashContext* context,
+        whNvmId list_count, const whNvmId* id_list);
 
 static int nfMemDirectory_Parse(nfMemDirectory* d);
+static uint32_t nfMemDirectory_IndexSlot(nfMemDirectory* d, whNvmId id);
+static void nfMemDirectory_IndexInsert(nfMemDirectory* d, int object_index);
+static int nfMemObject_Matches(const nfMemDirectory* d, int object_index,
+        whNvmAccess access, whNvmFlags flags);
 static int nfMemDirectory_FindObjectIndexById(nfMemDirectory* d, whNvmId id,
         int *out_object_index);
+static void nfMemDirectory_Append(nfMemDirectory* d, uint32_t epoch,
+        const whNvmMetadata* meta, int oldentry);
+static void nfStream_Abandon(whNvmFlashContext* context);
 
 
 static int nfMemState_Read(whNvmFlashContext* context, uint32_t offset,
@@ -153,6 +191,7 @@ static int nfMemState_Read(whNvmFlashContext* context, uint32_t offset,
 
     memset(state, 0, sizeof(*state));
     state->status = NF_STATUS_UNKNOWN;
+    NF_STATS_ADD(context, stats.blank_checks, 3);
 
     blank_epoch = wh_FlashUnit_BlankCheck(
             context->cb,
@@ -219,25 +258,27 @@ static int nfMemState_Read(whNvmFlashContext* context, uint32_t offset,
 }
 
 static int nfMemObject_Read(whNvmFlashContext* context,
-        uint32_t offset, nfMemObject* object)
+        uint32_t offset, nfMemEntry* entry, whNvmMetadata* metadata)
 {
     whFlashUnit buffer[NF_UNITS_PER_METADATA];
     int clear_metadata = 1;
     int rc = 0;
 
-    if ((context == NULL) || (object == NULL)) {
+    if (    (context == NULL) ||
+            (entry == NULL) ||
+            (metadata == NULL)) {
         return WH_ERROR_BADARGS;
     }
 
     rc = nfMemState_Read(
                 context,
                 offset + NF_OBJECT_STATE_OFFSET,
-                &object->state);
+                &entry->state);
 
     /* Read the metadata if it is intact, clear if not */
     if( (rc == 0) &&
-        ((object->state.status == NF_STATUS_USED) ||
-         (object->state.status == NF_STATUS_DATA_BAD))) {
+        ((entry->state.status == NF_STATUS_USED) ||
+         (entry->state.status == NF_STATUS_DATA_BAD))) {
         rc = wh_FlashUnit_Read(
                 context->cb,
                 context->flash,
@@ -246,14 +287,24 @@ static int nfMemObject_Read(whNvmFlashContext* context,
                 buffer);
         if (rc == 0) {
             /* Copy the metadata out of the buffer */
-            memcpy(&object->metadata, buffer, sizeof(object->metadata));
+            memcpy(metadata, buffer, sizeof(*metadata));
             clear_metadata = 0;
         }
     }
     if (clear_metadata != 0){
         /* Clear the object metadata */
-        memset(&object->metadata, 0, sizeof(object->metadata));
-    }
+        memset(metadata, 0, sizeof(*metadata));
+    }
+    if (    (rc == 0) &&
+            (entry->state.status == NF_STATUS_DATA_BAD) &&
+            (entry->state.start <=
+                context->partition_units - NF_PARTITION_DATA_OFFSET)) {
+        /* The count was never programmed, so any of the rest of the data
+         * area may have been.  Reclaim all of it rather than reuse it */
+        entry->state.count = context->partition_units -
+                NF_PARTITION_DATA_OFFSET - entry->state.start;
+    }
+    entry->id = metadata->id;
     return rc;
 }
 
@@ -309,6 +360,7 @@ static int nfPartition_BlankCheck(whNvmFlashContext* context, int partition)
         return WH_ERROR_BADARGS;
     }
 
+    NF_STATS_ADD(context, stats.blank_checks, 1);
     return wh_FlashUnit_BlankCheck(
             context->cb,
             context->flash,
@@ -316,12 +368,31 @@ static int nfPartition_BlankCheck(whNvmFlashContext* context, int partition)
             context->partition_units);
 }
 
+/* Count an erase of the whole partition */
+static void nfPartition_CountErase(whNvmFlashContext* context, int partition)
+{
+#ifdef WOLFHSM_NVM_STATS
+    context->stats.erase_ops++;
+    context->stats.erase_bytes +=
+            (uint64_t)context->partition_units * WHFU_BYTES_PER_UNIT;
+    context->partition_erases[partition & 1]++;
+#else
+    (void)context; (void)partition;
+#endif
+}
+
 static int nfPartition_Erase(whNvmFlashContext* context, int partition)
 {
     if (context == NULL) {
         return WH_ERROR_BADARGS;
     }
 
+    /* Nothing buffered by a failed sequence may land after the erase */
+    wh_FlashUnit_WriterDiscard(&context->writer);
+
+    /* The erase is blank checked afterwards */
+    nfPartition_CountErase(context, partition);
+    NF_STATS_ADD(context, stats.blank_checks, 1);
     return wh_FlashUnit_Erase(
             context->cb,
             context->flash,
@@ -329,6 +400,33 @@ static int nfPartition_Erase(whNvmFlashContext* context, int partition)
             context->partition_units);
 }
 
+/* Erase without waiting when the flash supports it.  Returns
+ * WH_ERROR_NOTREADY while the erase is outstanding, see nfCompact_Poll */
+static int nfPartition_EraseStart(whNvmFlashContext* context, int partition)
+{
+    int ret = 0;
+
+    if (context == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    wh_FlashUnit_WriterDiscard(&context->writer);
+
+    nfPartition_CountErase(context, partition);
+    ret = wh_FlashUnit_EraseStart(
+            context->cb,
+            context->flash,
+            nfPartition_Offset(context, partition),
+            context->partition_units);
+    if (ret == WH_ERROR_NOTREADY) {
+        context->erasing = 1;
+    } else {
+        /* Erased synchronously, which blank checks as well */
+        NF_STATS_ADD(context, stats.blank_checks, 1);
+    }
+    return ret;
+}
+
 static int nfPartition_ReadMemState(whNvmFlashContext* context, int partition,
         nfMemState* state)
 {
@@ -345,12 +443,57 @@ static int nfPartition_ReadMemState(whNvmFlashContext* context, int partition,
             state);
 }
 
+/* Decode count on-flash objects starting at index without blank checking.
+ * Only entries vouched for by a checkpoint are read this way, and they cannot
+ * change once written.  Returns how many decoded cleanly, stopping at the
+ * first that does not carry the written state pattern. */
+static int nfPartition_ReadSummarized(whNvmFlashContext* context,
+        uint32_t offset, int index, int count, nfMemDirectory* directory)
+{
+    nfObject buffer[NF_SUMMARY_READ_OBJECTS];
+    int done = 0;
+    int i = 0;
+
+    while (done < count) {
+        int this_count = count - done;
+        if (this_count > NF_SUMMARY_READ_OBJECTS) {
+            this_count = NF_SUMMARY_READ_OBJECTS;
+        }
+        if (wh_FlashUnit_Read(context->cb, context->flash,
+                offset + NF_DIRECTORY_OBJECT_OFFSET(index + done),
+                this_count * NF_UNITS_PER_OBJECT,
+                (whFlashUnit*)buffer) != 0) {
+            return done;
+        }
+        for (i = 0; i < this_count; i++) {
+            nfMemEntry* entry = &directory->entries[index + done];
+            if (    ((buffer[i].state.epoch & ~0xFFFFFFFFull) != BASE_STATE) ||
+                    ((buffer[i].state.start & ~0xFFFFFFFFull) != BASE_STATE) ||
+                    ((buffer[i].state.count & ~0xFFFFFFFFull) != BASE_STATE)) {
+                return done;
+            }
+            entry->state.status = NF_STATUS_USED;
+            entry->state.epoch = (uint32_t)buffer[i].state.epoch;
+            entry->state.start = (uint32_t)buffer[i].state.start;
+            entry->state.count = (uint32_t)buffer[i].state.count;
+            entry->id = buffer[i].u.metadata.id;
+            memcpy(&directory->metadata[index + done], &buffer[i].u.metadata,
+                    sizeof(directory->metadata[0]));
+            done++;
+        }
+    }
+    return done;
+}
+
 static int nfPartition_ReadMemDirectory(whNvmFlashContext* context, int partition,
             nfMemDirectory* directory)
 {
     int ret = 0;
     int index = 0;
+    int summarized = 0;
     uint32_t offset = 0;
+    nfMemState part_state = {0};
+    nfMemEntry* first = NULL;
 
     if ((context == NULL) || (directory == NULL)) {
         return WH_ERROR_BADARGS;
@@ -360,12 +503,40 @@ static int nfPartition_ReadMemDirectory(whNvmFlashContext* context, int partitio
                 NF_PARTITION_DIRECTORY_OFFSET;
     memset(directory, 0, sizeof(*directory));
 
-    for(index = 0; (index < NF_OBJECT_COUNT) && (ret == 0); index++) {
+    /* A checkpoint in the first entry written for this partition epoch
+     * vouches for the entries copied in after it */
+    first = &directory->entries[0];
+    ret = nfMemObject_Read(context, offset + NF_DIRECTORY_OBJECT_OFFSET(0),
+            first, &directory->metadata[0]);
+    if (    (ret == 0) &&
+            (first->state.status == NF_STATUS_USED) &&
+            (first->state.epoch & NF_EPOCH_CHECKPOINT) &&
+            (first->id == WH_NVM_INVALID_ID) &&
+            (directory->metadata[0].len < NF_OBJECT_COUNT) &&
+            (nfPartition_ReadMemState(context, partition, &part_state) == 0) &&
+            ((first->state.epoch & ~NF_EPOCH_FLAGS) ==
+                (part_state.epoch & ~NF_EPOCH_FLAGS))) {
+        summarized = nfPartition_ReadSummarized(context, offset, 1,
+                directory->metadata[0].len, directory);
+    }
+
+    /* Scan the rest entry by entry up to the first free one */
+    for (index = 1 + summarized;
+            (ret == 0) &&
+            (directory->entries[index - 1].state.status != NF_STATUS_FREE) &&
+            (index < NF_OBJECT_COUNT);
+            index++) {
         /* TODO: Handle errors better here.  Break out of loop? */
         ret = nfMemObject_Read(
                 context,
                 offset + NF_DIRECTORY_OBJECT_OFFSET(index),
-                &directory->objects[index]);
+                &directory->entries[index],
+                &directory->metadata[index]);
+    }
+
+    /* Entries are allocated in order, so everything after is free too */
+    for (; index < NF_OBJECT_COUNT; index++) {
+        directory->entries[index].state.status = NF_STATUS_FREE;
     }
     return ret;
 }
@@ -389,9 +560,8 @@ static int nfPartition_ProgramEpoch(whNvmFlashContext* context,
         return WH_ERROR_BADARGS;
     }
 
-    return wh_FlashUnit_Program(
-            context->cb,
-            context->flash,
+    return wh_FlashUnit_WriterFinish(
+            &context->writer,
             nfPartition_Offset(context, partition) +
                 NF_PARTITION_STATE_OFFSET + NF_STATE_EPOCH_OFFSET,
             1,
@@ -407,9 +577,8 @@ static int nfPartition_ProgramStart(whNvmFlashContext* context,
         return WH_ERROR_BADARGS;
     }
 
-    return wh_FlashUnit_Program(
-            context->cb,
-            context->flash,
+    return wh_FlashUnit_WriterFinish(
+            &context->writer,
             nfPartition_Offset(context, partition) +
                 NF_PARTITION_STATE_OFFSET + NF_STATE_START_OFFSET,
             1,
@@ -425,9 +594,8 @@ static int nfPartition_ProgramCount(whNvmFlashContext* context,
         return WH_ERROR_BADARGS;
     }
 
-    return wh_FlashUnit_Program(
-            context->cb,
-            context->flash,
+    return wh_FlashUnit_WriterFinish(
+            &context->writer,
             nfPartition_Offset(context, partition) +
                 NF_PARTITION_STATE_OFFSET + NF_STATE_COUNT_OFFSET,
             1,
@@ -536,27 +704,24 @@ static int nfObject_ProgramBegin(whNvmFlashContext* context, int partition,
     object_offset = nfObject_Offset(context, partition, object_index);
 
     /* Program the object epoch */
-    rc = wh_FlashUnit_Program(
-            context->cb,
-            context->flash,
+    rc = wh_FlashUnit_WriterProgram(
+            &context->writer,
             object_offset + NF_OBJECT_STATE_OFFSET + NF_STATE_EPOCH_OFFSET,
             1,
             &state_epoch);
 
     if (rc == 0) {
         /* Program the object metadata */
-        rc = wh_FlashUnit_Program(
-                context->cb,
-                context->flash,
+        rc = wh_FlashUnit_WriterProgram(
+                &context->writer,
                 object_offset + NF_OBJECT_METADATA_OFFSET,
                 NF_UNITS_PER_METADATA,
                 (whFlashUnit*)meta);
 
         if (rc == 0) {
             /* Program the object start */
-            rc = wh_FlashUnit_Program(
-                    context->cb,
-                    context->flash,
+            rc = wh_FlashUnit_WriterProgram(
+                    &context->writer,
                     object_offset + NF_OBJECT_STATE_OFFSET + NF_STATE_START_OFFSET,
                     1,
                     &state_start);
@@ -584,9 +749,8 @@ static int nfObject_ProgramDataBytes(whNvmFlashContext* context, int partition,
     }
 
     /* Program the data */
-    return wh_FlashUnit_ProgramBytes(
-            context->cb,
-            context->flash,
+    return wh_FlashUnit_WriterProgramBytes(
+            &context->writer,
             data_offset * WHFU_BYTES_PER_UNIT,
             byte_count,
             data);
@@ -604,10 +768,9 @@ static int nfObject_ProgramFinish(whNvmFlashContext* context, int partition,
 
     object_offset = nfObject_Offset(context, partition, object_index);
 
-    /* Program the object flag->state_count */
-    return wh_FlashUnit_Program(
-            context->cb,
-            context->flash,
+    /* Program the object flag->state_count once everything before it is */
+    return wh_FlashUnit_WriterFinish(
+            &context->writer,
             object_offset + NF_OBJECT_STATE_OFFSET + NF_STATE_COUNT_OFFSET,
             1,
             &state_count);
@@ -648,7 +811,7 @@ static int nfObject_ReadDataBytes(whNvmFlashContext* context, int partition,
         return WH_ERROR_BADARGS;
     }
 
-    start = context->directory.objects[object_index].state.start;
+    start = context->directory.entries[object_index].state.start;
     startOffset = nfPartition_DataOffset(context, partition) + start;
 
     /* Ensure we don't read off the end of the active partition */
@@ -666,6 +829,104 @@ static int nfObject_ReadDataBytes(whNvmFlashContext* context, int partition,
             out_data);
 }
 
+static int nfObject_MapDataBytes(whNvmFlashContext* context, int partition,
+        int object_index,
+        uint32_t byte_offset, uint32_t byte_count, const uint8_t** out_data)
+{
+    uint32_t startOffset = 0;
+
+    if ((context == NULL) || (context->cb == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    startOffset = (nfPartition_DataOffset(context, partition) +
+            context->directory.entries[object_index].state.start) *
+            WHFU_BYTES_PER_UNIT + byte_offset;
+    if (WH_ERROR_OK != nfPartition_CheckDataRange(context, partition,
+                                    startOffset, byte_count)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    return wh_FlashUnit_MapBytes(context->cb, context->flash, startOffset,
+            byte_count, out_data);
+}
+
+/* Drop the cached data of id, which is about to be replaced or destroyed */
+static void nfDataCache_Invalidate(whNvmFlashContext* context, whNvmId id)
+{
+#if NF_DATA_CACHE_COUNT > 0
+    int i = 0;
+
+    for (i = 0; i < NF_DATA_CACHE_COUNT; i++) {
+        if (context->cache[i].id == id) {
+            context->cache[i].id = WH_NVM_INVALID_ID;
+            context->cache[i].used = 0;
+        }
+    }
+#else
+    (void)context;
+    (void)id;
+#endif
+}
+
+/* Serve a read of a small object from RAM, filling the least recently read
+ * entry from flash on a miss.  Returns WH_ERROR_NOTFOUND when the object or
+ * the range is not cacheable, so the caller reads the flash directly.
+ */
+static int nfDataCache_Read(whNvmFlashContext* context, int object_index,
+        uint32_t byte_offset, uint32_t byte_count, uint8_t* out_data)
+{
+#if NF_DATA_CACHE_COUNT > 0
+    int ret = 0;
+    int i = 0;
+    int victim = 0;
+    nfDataCacheEntry* entry = NULL;
+    const whNvmMetadata* meta =
+            &context->directory.metadata[object_index];
+
+    if (    (meta->len > NF_DATA_CACHE_BYTES) ||
+            (byte_offset + byte_count > meta->len) ) {
+        return WH_ERROR_NOTFOUND;
+    }
+
+    for (i = 0; i < NF_DATA_CACHE_COUNT; i++) {
+        if (context->cache[i].id == meta->id) {
+            entry = &context->cache[i];
+            break;
+        }
+        if (context->cache[i].used < context->cache[victim].used) {
+            victim = i;
+        }
+    }
+
+    if (entry == NULL) {
+        /* Miss.  Read the whole object so any later range hits */
+        entry = &context->cache[victim];
+        entry->id = WH_NVM_INVALID_ID;
+        entry->used = 0;
+        ret = nfObject_ReadDataBytes(context, context->active, object_index,
+                0, meta->len, entry->data);
+        if (ret != 0) {
+            return ret;
+        }
+        entry->id = meta->id;
+    }
+
+    entry->used = ++context->cache_tick;
+    if (byte_count > 0) {
+        memcpy(out_data, &entry->data[byte_offset], byte_count);
+    }
+    return 0;
+#else
+    (void)context;
+    (void)object_index;
+    (void)byte_offset;
+    (void)byte_count;
+    (void)out_data;
+    return WH_ERROR_NOTFOUND;
+#endif
+}
+
 static int nfObject_Copy(whNvmFlashContext* context, int object_index,
         int partition, uint32_t *inout_next_object, uint32_t *inout_next_data)
 {
@@ -686,12 +947,12 @@ static int nfObject_Copy(whNvmFlashContext* context, int object_index,
     dest_data = *inout_next_data;
     d = &context->directory;
 
-    data_len = d->objects[object_index].metadata.len;
+    data_len = d->metadata[object_index].len;
 
     /* Copy the object to the new partition */
     ret = nfObject_ProgramBegin(context, partition, dest_object,
-            d->objects[object_index].state.epoch,
-            dest_data, &d->objects[object_index].metadata);
+            d->entries[object_index].state.epoch,
+            dest_data, &d->metadata[object_index]);
     if (ret != 0) return ret;
 
     /* Loop through reading the old data into buffer */
@@ -736,12 +997,70 @@ static int nfObject_Copy(whNvmFlashContext* context, int object_index,
     return ret;
 }
 
+/* Destroy an object in place by appending a data-less copy of its metadata
+ * whose epoch is flagged as a tombstone.  The tombstone only becomes valid once
+ * its count is programmed, so an interrupted destroy leaves the object intact.
+ */
+static int nfObject_Tombstone(whNvmFlashContext* context, int object_index)
+{
+    int ret = 0;
+    nfMemDirectory* d = NULL;
+    nfMemEntry* tomb = NULL;
+    whNvmMetadata meta = {0};
+    uint32_t epoch = 0;
+
+    if (context == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    d = &context->directory;
+    if (d->next_free_object == NF_OBJECT_COUNT) {
+        return WH_ERROR_NOSPACE;
+    }
+
+    memcpy(&meta, &d->metadata[object_index], sizeof(meta));
+    meta.len = 0;
+    epoch = (d->entries[object_index].state.epoch + 1) | NF_EPOCH_TOMBSTONE;
+
+    nfCompact_Restart(context);
+
+    ret = nfObject_ProgramBegin(context, context->active,
+            d->next_free_object, epoch, d->next_free_data, &meta);
+    if (ret == 0) {
+        ret = nfObject_ProgramFinish(context, context->active,
+                d->next_free_object, 0);
+    }
+    if (ret == 0) {
+        /* Both the tombstone and the object it hides are reclaimable */
+        tomb = &d->entries[d->next_free_object];
+        tomb->state.status = NF_STATUS_DATA_BAD;
+        tomb->state.epoch = epoch;
+        tomb->state.start = d->next_free_data;
+        tomb->state.count = 0;
+        tomb->id = meta.id;
+        memcpy(&d->metadata[d->next_free_object], &meta, sizeof(meta));
+        d->next_free_object++;
+
+        d->entries[object_index].state.status = NF_STATUS_DATA_BAD;
+        d->reclaimable_entries += 2;
+        d->reclaimable_data += d->entries[object_index].state.count;
+    }
+    return ret;
+}
+
+/* Nonzero once enough is reclaimable that a destroy should compact */
+static int nfMemDirectory_CompactDue(whNvmFlashContext* context)
+{
+    nfMemDirectory* d = &context->directory;
+
+    return  ((uint32_t)d->reclaimable_entries >= context->compact_objects) ||
+            (d->reclaimable_data >= context->compact_units);
+}
 
 static int nfMemDirectory_Parse(nfMemDirectory* d)
 {
     int done = 0;
     int this_entry = 0;
-    int that_entry = 0;
 
     if (d == NULL) {
         return WH_ERROR_BADARGS;
@@ -755,7 +1074,7 @@ static int nfMemDirectory_Parse(nfMemDirectory* d)
             d->next_free_object < NF_OBJECT_COUNT;
             d->next_free_object++)
     {
-        switch(d->objects[d->next_free_object].state.status) {
+        switch(d->entries[d->next_free_object].state.status) {
         case NF_STATUS_FREE:
             /* This must be the last. We are done */
             done = 1;
@@ -763,8 +1082,8 @@ static int nfMemDirectory_Parse(nfMemDirectory* d)
         case NF_STATUS_USED:
             /* Advance the data pointer to after this data and keep looking */
             d->next_free_data =
-                d->objects[d->next_free_object].state.start +
-                d->objects[d->next_free_object].state.count;
+                d->entries[d->next_free_object].state.start +
+                d->entries[d->next_free_object].state.count;
             break;
         case NF_STATUS_META_BAD:
             /* Metadata is incomplete.  Skip it*/
@@ -774,10 +1093,10 @@ static int nfMemDirectory_Parse(nfMemDirectory* d)
             /* Data is incomplete, but we must advance the pointer */
             d->reclaimable_entries++;
             d->reclaimable_data +=
-                d->objects[d->next_free_object].state.count;
+                d->entries[d->next_free_object].state.count;
             d->next_free_data =
-                d->objects[d->next_free_object].state.start +
-                d->objects[d->next_free_object].state.count;
+                d->entries[d->next_free_object].state.start +
+                d->entries[d->next_free_object].state.count;
             break;
         default:
             /* Unknown state.  Better barf */
@@ -786,46 +1105,157 @@ static int nfMemDirectory_Parse(nfMemDirectory* d)
         if (done) break;
     }
 
-    /* Now walk through backwards and reclaim any duplicate meta->id data counts */
-    for (this_entry = NF_OBJECT_COUNT - 1; this_entry >= 0; this_entry --) {
-        if (d->objects[this_entry].state.status == NF_STATUS_USED) {
-            whNvmId this_id = d->objects[this_entry].metadata.id;
-            for (that_entry = this_entry - 1; that_entry >= 0; that_entry --) {
-                if (    (d->objects[that_entry].state.status == NF_STATUS_USED) &&
-                        (d->objects[that_entry].metadata.id == this_id)) {
-                    /* Found duplicate.  Mark it as reclaimable and break out of this loop */
-                    d->reclaimable_entries++;
-                    d->reclaimable_data += d->objects[that_entry].state.count;
-                    d->objects[that_entry].state.status = NF_STATUS_DATA_BAD;
-                }
+    /* Walk forward rebuilding the id index.  A later object with the same id
+     * hides the earlier one, and a tombstone also hides itself. */
+    memset(d->index, 0, sizeof(d->index));
+    for (this_entry = 0; this_entry < d->next_free_object; this_entry++) {
+        nfMemEntry* obj = &d->entries[this_entry];
+        uint32_t slot = 0;
+
+        if (obj->state.status != NF_STATUS_USED) {
+            continue;
+        }
+        if (obj->state.epoch & NF_EPOCH_CHECKPOINT) {
+            /* Mount summary, not an object */
+            obj->state.status = NF_STATUS_DATA_BAD;
+            continue;
+        }
+
+        slot = nfMemDirectory_IndexSlot(d, obj->id);
+        if (d->index[slot] != 0) {
+            nfMemEntry* older = &d->entries[d->index[slot] - 1];
+            if (older->state.status == NF_STATUS_USED) {
+                /* Found duplicate.  Mark it as reclaimable */
+                d->reclaimable_entries++;
+                d->reclaimable_data += older->state.count;
+                older->state.status = NF_STATUS_DATA_BAD;
             }
         }
+        d->index[slot] = (uint16_t)(this_entry + 1);
+
+        if (obj->state.epoch & NF_EPOCH_TOMBSTONE) {
+            d->reclaimable_entries++;
+            obj->state.status = NF_STATUS_DATA_BAD;
+        }
     }
     return 0;
 }
 
+static uint32_t nfMemDirectory_IndexHash(whNvmId id)
+{
+    /* Multiplicative hash spreads sequential ids across the table */
+    return ((uint32_t)id * 40503u) % NF_INDEX_COUNT;
+}
+
+/* Probe from the id's hash to the slot holding it, or the empty slot it would
+ * claim.  The table is never full, so the probe always terminates */
+static uint32_t nfMemDirectory_IndexSlot(nfMemDirectory* d, whNvmId id)
+{
+    uint32_t slot = nfMemDirectory_IndexHash(id);
+
+    while (     (d->index[slot] != 0) &&
+                (d->entries[d->index[slot] - 1].id != id)) {
+        slot = (slot + 1) % NF_INDEX_COUNT;
+    }
+    return slot;
+}
+
+/* Point the id's slot at object_index */
+static void nfMemDirectory_IndexInsert(nfMemDirectory* d, int object_index)
+{
+    d->index[nfMemDirectory_IndexSlot(d,
+            d->entries[object_index].id)] =
+            (uint16_t)(object_index + 1);
+}
+
+/* Nonzero for a used object that passes the List access and flags filters.
+ * Access must match exactly and every requested flag must be set */
+static int nfMemObject_Matches(const nfMemDirectory* d, int object_index,
+        whNvmAccess access, whNvmFlags flags)
+{
+    /* Unfiltered lists only touch the dense entries */
+    return  (d->entries[object_index].state.status == NF_STATUS_USED) &&
+            (   (access == WOLFHSM_NVM_ACCESS_ANY) ||
+                (d->metadata[object_index].access == access)) &&
+            (   (flags == WOLFHSM_NVM_FLAGS_ANY) ||
+                ((d->metadata[object_index].flags & flags) == flags));
+}
+
 static int nfMemDirectory_FindObjectIndexById(nfMemDirectory* d, whNvmId id,
         int *out_object_index)
 {
     int index = 0;
+    uint32_t slot = 0;
     int ret = WH_ERROR_NOTFOUND;
 
     if (d == NULL) {
         return WH_ERROR_BADARGS;
     }
 
-    /* Find first used index that matches the id. */
-    for (index = 0; index< d->next_free_object; index++) {
-        if ((d->objects[index].state.status == NF_STATUS_USED) &&
-                (d->objects[index].metadata.id == id)) {
+    /* A slot left pointing at a reclaimed object means the id is gone */
+    slot = nfMemDirectory_IndexSlot(d, id);
+    if (d->index[slot] != 0) {
+        index = d->index[slot] - 1;
+        if (d->entries[index].state.status == NF_STATUS_USED) {
             if (out_object_index != NULL) *out_object_index = index;
             ret = 0;
-            break;
         }
     }
     return ret;
 }
 
+/* Record a newly programmed object at the next free entry and data, retiring
+ * the entry it replaces */
+static void nfMemDirectory_Append(nfMemDirectory* d, uint32_t epoch,
+        const whNvmMetadata* meta, int oldentry)
+{
+    nfMemEntry* obj = &d->entries[d->next_free_object];
+
+    obj->state.status = NF_STATUS_USED;
+    obj->state.epoch = epoch;
+    obj->state.start = d->next_free_data;
+    obj->state.count = WHFU_BYTES2UNITS(meta->len);
+    obj->id = meta->id;
+    memcpy(&d->metadata[d->next_free_object], meta, sizeof(*meta));
+    nfMemDirectory_IndexInsert(d, d->next_free_object);
+    d->next_free_data += obj->state.count;
+    d->next_free_object++;
+
+    /* Update directory to reclaim old entry */
+    if (oldentry >= 0) {
+        d->entries[oldentry].state.status = NF_STATUS_DATA_BAD;
+        d->reclaimable_entries++;
+        d->reclaimable_data += d->entries[oldentry].state.count;
+    }
+}
+
+/* Give up on a streamed object.  Its header and whatever data was written stay
+ * in flash without a count, exactly like an AddObject interrupted by power
+ * loss, so the entry and all of its reserved data are left to compaction */
+static void nfStream_Abandon(whNvmFlashContext* context)
+{
+    nfMemDirectory* d = &context->directory;
+    nfMemEntry* obj = &d->entries[d->next_free_object];
+
+    /* The header must land so the entries after it can still be found */
+    (void)wh_FlashUnit_WriterFlush(&context->writer);
+    wh_FlashUnit_WriterDiscard(&context->writer);
+
+    obj->state.status = NF_STATUS_DATA_BAD;
+    obj->state.epoch = context->stream_epoch;
+    obj->state.start = d->next_free_data;
+    obj->state.count = WHFU_BYTES2UNITS(context->stream_meta.len);
+    obj->id = context->stream_meta.id;
+    memcpy(&d->metadata[d->next_free_object], &context->stream_meta,
+            sizeof(context->stream_meta));
+    d->reclaimable_entries++;
+    d->reclaimable_data += obj->state.count;
+    d->next_free_data += obj->state.count;
+    d->next_free_object++;
+
+    context->streaming = 0;
+}
+
 
 
 /*************  WolfHSM NVM Interfaces  ***********/
@@ -850,6 +1280,16 @@ int wh_NvmFlash_Init(void* c, const void* cf)
         memset(context, 0, sizeof(*context));
         context->cb = config->cb;
         context->flash = config->context;
+        context->checkpoint = config->checkpoint;
+        wh_FlashUnit_WriterInit(&context->writer, context->cb, context->flash,
+                config->program_page, (whFlashUnitVerify)config->verify);
+#ifdef WOLFHSM_NVM_STATS
+        wh_FlashUnit_WriterSetStats(&context->writer, &context->stats);
+#endif
+        context->compact_objects = config->compact_objects;
+        if (context->compact_objects == 0) {
+            context->compact_objects = NF_COMPACT_DEFAULT_OBJECTS;
+        }
 
         /* Get partition size from flash device */
         if (context->cb->PartitionSize != NULL) {
@@ -857,6 +1297,18 @@ int wh_NvmFlash_Init(void* c, const void* cf)
                     context->cb->PartitionSize(context->flash) /
                     WHFU_BYTES_PER_UNIT;
         }
+        if (context->partition_units <= NF_PARTITION_DATA_OFFSET) {
+            /* The directory must fit with room for data */
+            if (context->cb->Cleanup != NULL) {
+                (void)context->cb->Cleanup(context->flash);
+            }
+            return WH_ERROR_BADARGS;
+        }
+        context->compact_units = config->compact_units;
+        if (context->compact_units == 0) {
+            context->compact_units = context->partition_units /
+                    NF_COMPACT_DEFAULT_DIVISOR;
+        }
 
         /* Unlock the both partitions */
         nfPartition_WriteUnlock(context, 0);
@@ -916,6 +1368,11 @@ int wh_NvmFlash_Cleanup(void* c)
         return 0;
     }
 
+    (void)nfCompact_Poll(context, 1);
+    if (context->streaming != 0) {
+        nfStream_Abandon(context);
+    }
+
     /* Ignore errors here */
     (void)nfPartition_WriteLock(context, 0);
     (void)nfPartition_WriteLock(context, 1);
@@ -930,11 +1387,8 @@ int wh_NvmFlash_List(void* c,
         whNvmAccess access, whNvmFlags flags, whNvmId start_id,
         whNvmId *out_count, whNvmId *out_id)
 {
-    /* TODO: Implement access and flag matching */
-    (void)access; (void)flags;
-
     whNvmFlashContext* context = c;
-    int this_entry;
+    int this_entry = 0;
     int this_count = 0;
     whNvmId this_id = 0;
     nfMemDirectory* d = NULL;
@@ -945,45 +1399,23 @@ int wh_NvmFlash_List(void* c,
 
     d = &context->directory;
 
-    /* Find the starting id */
-    for (this_entry = 0; this_entry < d->next_free_object; this_entry++) {
-        if (d->objects[this_entry].state.status == NF_STATUS_USED) {
-            this_id = d->objects[this_entry].metadata.id;
-            if ((start_id == 0) || (start_id == this_id)) {
-                break;
-            }
-        }
-    }
-    if (this_entry >= d->next_free_object) {
-        /* None found */
-        this_count = 0;
-        this_id = 0;
-    } else {
-        /* III id is NOT allowed to be 0, so this is simply stopping a loop */
-        if (this_id != 0) {
-            this_count = 1;
-        }
-        if (start_id != 0) {
-            /* Find the next one */
+    /* Resume after the starting id, found through the index */
+    if (start_id != 0) {
+        if (nfMemDirectory_FindObjectIndexById(d, start_id, &this_entry) != 0) {
+            /* None found */
+            this_entry = d->next_free_object;
+        } else {
             this_entry++;
-            for (; this_entry < d->next_free_object; this_entry++) {
-                if (d->objects[this_entry].state.status == NF_STATUS_USED) {
-                    this_id = d->objects[this_entry].metadata.id;
-                    break;
-                }
-            }
-            if (this_entry >= d->next_free_object) {
-                /* None found */
-                this_count = 0;
-                this_id = 0;
-            }
         }
+    }
 
-        /* Now count how many more there are */
-        for (this_entry++; this_entry < d->next_free_object; this_entry++) {
-            if (d->objects[this_entry].state.status == NF_STATUS_USED) {
-                this_count++;
+    /* Take the next match, then count how many more there are */
+    for (; this_entry < d->next_free_object; this_entry++) {
+        if (nfMemObject_Matches(d, this_entry, access, flags)) {
+            if (this_count == 0) {
+                this_id = d->entries[this_entry].id;
             }
+            this_count++;
         }
     }
     if (out_count != NULL) *out_count = this_count;
@@ -991,6 +1423,47 @@ int wh_NvmFlash_List(void* c,
     return 0;
 }
 
+int wh_NvmFlash_ListMetadata(void* c,
+        whNvmAccess access, whNvmFlags flags, uint32_t *inout_cursor,
+        whNvmId max_count, whNvmId *out_count, whNvmMetadata* out_meta)
+{
+    whNvmFlashContext* context = c;
+    nfMemDirectory* d = NULL;
+    int this_entry = 0;
+    whNvmId this_count = 0;
+
+    if (    (context == NULL) ||
+            (inout_cursor == NULL) ||
+            ((max_count > 0) && (out_meta == NULL))) {
+        return WH_ERROR_BADARGS;
+    }
+
+    d = &context->directory;
+
+    /* Entries move when the partition is regenerated, so a cursor from an
+     * older epoch no longer points where the caller left off */
+    if (*inout_cursor != 0) {
+        if (    NF_CURSOR_EPOCH(*inout_cursor) !=
+                NF_CURSOR_EPOCH(NF_CURSOR(context->state.epoch, 0))) {
+            return WH_ERROR_ABORTED;
+        }
+        this_entry = NF_CURSOR_ENTRY(*inout_cursor);
+    }
+
+    for (;  (this_entry < d->next_free_object) && (this_count < max_count);
+            this_entry++) {
+        if (nfMemObject_Matches(d, this_entry, access, flags)) {
+            memcpy( &out_meta[this_count],
+                    &d->metadata[this_entry],
+                    sizeof(*out_meta));
+            this_count++;
+        }
+    }
+    *inout_cursor = NF_CURSOR(context->state.epoch, this_entry);
+    if (out_count != NULL) *out_count = this_count;
+    return 0;
+}
+
 int wh_NvmFlash_GetAvailable(void* c,
         uint32_t *out_avail_size, whNvmId *out_avail_objects,
         uint32_t *out_reclaim_size, whNvmId *out_reclaim_objects)
@@ -1031,7 +1504,7 @@ int wh_NvmFlash_GetMetadata(void* c, whNvmId id, whNvmMetadata* meta)
     if (ret == 0) {
         if (meta != NULL) {
            memcpy(  meta,
-                    &context->directory.objects[entry].metadata,
+                    &context->directory.metadata[entry],
                     sizeof(*meta));
         }
     }
@@ -1049,30 +1522,51 @@ int wh_NvmFlash_AddObject(void* c, whNvmMetadata *meta,
     int oldentry = -1;
     int ret = 0;
     uint32_t epoch = 0;
-    uint32_t count = 0;
 
     if (    (context == NULL) ||
             (meta == NULL) ||
             ((data_len > 0) && (data == NULL)) ) {
         return WH_ERROR_BADARGS;
     }
+    if (context->streaming != 0) {
+        /* The open stream owns the writer and the next free entry */
+        return WH_ERROR_NOTREADY;
+    }
+
+    /* The flash is unusable until a background erase completes.  A failed
+     * erase only abandons the compaction */
+    (void)nfCompact_Poll(context, 1);
+    nfDataCache_Invalidate(context, meta->id);
 
     d = &context->directory;
     if (    (d->next_free_object == NF_OBJECT_COUNT) ||
             (d->next_free_data * WHFU_BYTES_PER_UNIT + data_len >
                 context->partition_units * WHFU_BYTES_PER_UNIT) ) {
-        return WH_ERROR_NOSPACE;
+        /* Out of space.  Compact if that would free anything */
+        if (d->reclaimable_entries == 0) {
+            return WH_ERROR_NOSPACE;
+        }
+        ret = nfPartition_Regenerate(context, 0, NULL);
+        if (ret != 0) {
+            return ret;
+        }
+        if (    (d->next_free_object == NF_OBJECT_COUNT) ||
+                (d->next_free_data * WHFU_BYTES_PER_UNIT + data_len >
+                    context->partition_units * WHFU_BYTES_PER_UNIT) ) {
+            return WH_ERROR_NOSPACE;
+        }
     }
 
     /* Find existing object so we can increment the epoch */
     ret = nfMemDirectory_FindObjectIndexById(d, meta->id, &oldentry);
     if (oldentry >= 0) {
-        epoch = d->objects[oldentry].state.epoch + 1;
+        epoch = d->entries[oldentry].state.epoch + 1;
     }
 
     /* Update meta with data size */
     meta->len = data_len;
-    count = WHFU_BYTES2UNITS(meta->len);
+
+    nfCompact_Restart(context);
 
     ret = nfObject_Program(context,
             context->active,
@@ -1083,60 +1577,477 @@ int wh_NvmFlash_AddObject(void* c, whNvmMetadata *meta,
             data);
 
     if (ret == 0) {
-        /* Update directory with new object */
-        d->objects[d->next_free_object].state.status = NF_STATUS_USED;
-        d->objects[d->next_free_object].state.epoch = epoch;
-        d->objects[d->next_free_object].state.start = d->next_free_data;
-        d->objects[d->next_free_object].state.count = count;
-        memcpy(&d->objects[d->next_free_object].metadata, meta, sizeof(*meta));
-        d->next_free_data += count;
-        d->next_free_object++;
+        nfMemDirectory_Append(d, epoch, meta, oldentry);
+        NF_STATS_ADD(context, data_bytes, data_len);
+    }
+    return ret;
+}
 
-        /* Update directory to reclaim old entry */
+/* Add a batch of objects back to back.  All headers are programmed first, then
+ * all data in one contiguous run, and finally each count, which is what makes
+ * an object valid.
+ */
+int wh_NvmFlash_AddObjects(void* c, whNvmId count, whNvmMetadata* meta,
+        const uint8_t* const* data)
+{
+    whNvmFlashContext* context = c;
+    nfMemDirectory* d = NULL;
+    int oldentry = -1;
+    int ret = 0;
+    whNvmId i = 0;
+    whNvmId j = 0;
+    uint32_t epoch = 0;
+    uint32_t units = 0;
+    uint32_t start = 0;
+
+    if (    (context == NULL) ||
+            ((count > 0) && ((meta == NULL) || (data == NULL))) ) {
+        return WH_ERROR_BADARGS;
+    }
+    if (context->streaming != 0) {
+        /* The open stream owns the writer and the next free entry */
+        return WH_ERROR_NOTREADY;
+    }
+
+    (void)nfCompact_Poll(context, 1);
+    for (i = 0; i < count; i++) {
+        nfDataCache_Invalidate(context, meta[i].id);
+    }
+
+    d = &context->directory;
+
+    /* Check the whole batch fits before touching the flash */
+    for (i = 0; i < count; i++) {
+        if ((meta[i].len > 0) && (data[i] == NULL)) {
+            return WH_ERROR_BADARGS;
+        }
+        /* Each id may only appear once, so epochs stay consistent */
+        for (j = 0; j < i; j++) {
+            if (meta[j].id == meta[i].id) {
+                return WH_ERROR_BADARGS;
+            }
+        }
+        units += WHFU_BYTES2UNITS(meta[i].len);
+    }
+    if (    (count > NF_OBJECT_COUNT - d->next_free_object) ||
+            ((d->next_free_data + units) >
+                (context->partition_units - NF_PARTITION_DATA_OFFSET)) ) {
+        /* Out of space.  Compact if that would free anything */
+        if (d->reclaimable_entries == 0) {
+            return WH_ERROR_NOSPACE;
+        }
+        ret = nfPartition_Regenerate(context, 0, NULL);
+        if (ret != 0) {
+            return ret;
+        }
+        if (    (count > NF_OBJECT_COUNT - d->next_free_object) ||
+                ((d->next_free_data + units) >
+                    (context->partition_units - NF_PARTITION_DATA_OFFSET)) ) {
+            return WH_ERROR_NOSPACE;
+        }
+    }
+
+    nfCompact_Restart(context);
+
+    /* Program every object's epoch, metadata and start */
+    start = d->next_free_data;
+    for (i = 0; (ret == 0) && (i < count); i++) {
+        epoch = 0;
+        oldentry = -1;
+        (void)nfMemDirectory_FindObjectIndexById(d, meta[i].id, &oldentry);
         if (oldentry >= 0) {
-            d->objects[oldentry].state.status = NF_STATUS_DATA_BAD;
-            d->reclaimable_entries++;
-            d->reclaimable_data += d->objects[oldentry].state.count;
+            epoch = d->entries[oldentry].state.epoch + 1;
+        }
+        ret = nfObject_ProgramBegin(context, context->active,
+                d->next_free_object + i, epoch, start, &meta[i]);
+        start += WHFU_BYTES2UNITS(meta[i].len);
+    }
+
+    /* Program all of the data back to back */
+    start = d->next_free_data;
+    for (i = 0; (ret == 0) && (i < count); i++) {
+        ret = nfObject_ProgramDataBytes(context, context->active, start,
+                meta[i].len, data[i]);
+        start += WHFU_BYTES2UNITS(meta[i].len);
+    }
+
+    /* Finish each object and add it to the directory */
+    for (i = 0; (ret == 0) && (i < count); i++) {
+        ret = nfObject_ProgramFinish(context, context->active,
+                d->next_free_object, meta[i].len);
+        if (ret == 0) {
+            epoch = 0;
+            oldentry = -1;
+            (void)nfMemDirectory_FindObjectIndexById(d, meta[i].id,
+                    &oldentry);
+            if (oldentry >= 0) {
+                epoch = d->entries[oldentry].state.epoch + 1;
+            }
+            nfMemDirectory_Append(d, epoch, &meta[i], oldentry);
+            NF_STATS_ADD(context, data_bytes, meta[i].len);
         }
     }
     return ret;
 }
 
-/* Destroy a list of objects by replicating the current state without the id's
- * in the provided list.  Id's in the list that are not present do not cause an
- * error.
+/* Start streaming an object of data_len bytes.  The entry and data are
+ * reserved and the header programmed now, the data is programmed by
+ * AddObjectWrite and the object only becomes valid at AddObjectFinish, so
+ * the previous version stays readable until then.  Only one stream may be open
+ * and nothing else may modify the store until it is finished.
  */
-int wh_NvmFlash_DestroyObjects(void* c, whNvmId list_count,
-        const whNvmId* id_list)
+int wh_NvmFlash_AddObjectBegin(void* c, whNvmMetadata* meta,
+        whNvmSize data_len)
+{
+    whNvmFlashContext* context = c;
+    nfMemDirectory* d = NULL;
+    int oldentry = -1;
+    int ret = 0;
+    uint32_t epoch = 0;
+    uint32_t units = WHFU_BYTES2UNITS(data_len);
+
+    if (    (context == NULL) ||
+            (meta == NULL) ) {
+        return WH_ERROR_BADARGS;
+    }
+    if (context->streaming != 0) {
+        return WH_ERROR_NOTREADY;
+    }
+
+    (void)nfCompact_Poll(context, 1);
+
+    d = &context->directory;
+    if (    (d->next_free_object == NF_OBJECT_COUNT) ||
+            ((d->next_free_data + units) >
+                (context->partition_units - NF_PARTITION_DATA_OFFSET)) ) {
+        /* Out of space.  Compact if that would free anything */
+        if (d->reclaimable_entries == 0) {
+            return WH_ERROR_NOSPACE;
+        }
+        ret = nfPartition_Regenerate(context, 0, NULL);
+        if (ret != 0) {
+            return ret;
+        }
+        if (    (d->next_free_object == NF_OBJECT_COUNT) ||
+                ((d->next_free_data + units) >
+                    (context->partition_units - NF_PARTITION_DATA_OFFSET)) ) {
+            return WH_ERROR_NOSPACE;
+        }
+    }
+
+    (void)nfMemDirectory_FindObjectIndexById(d, meta->id, &oldentry);
+    if (oldentry >= 0) {
+        epoch = d->entries[oldentry].state.epoch + 1;
+    }
+
+    meta->len = data_len;
+
+    nfCompact_Restart(context);
+
+    context->streaming = 1;
+    context->stream_epoch = epoch;
+    context->stream_written = 0;
+    memcpy(&context->stream_meta, meta, sizeof(*meta));
+
+    ret = nfObject_ProgramBegin(context, context->active,
+            d->next_free_object, epoch, d->next_free_data, meta);
+    if (ret != 0) {
+        nfStream_Abandon(context);
+    }
+    return ret;
+}
+
+/* Program the next data_len bytes of the streamed object.  Pieces are written
+ * in order and all but the last must be a whole number of units */
+int wh_NvmFlash_AddObjectWrite(void* c, whNvmSize offset,
+        whNvmSize data_len, const uint8_t* data)
 {
+    whNvmFlashContext* context = c;
     int ret = 0;
+
+    if (    (context == NULL) ||
+            (context->streaming == 0) ||
+            ((data_len > 0) && (data == NULL)) ||
+            (offset != context->stream_written) ||
+            ((offset % WHFU_BYTES_PER_UNIT) != 0) ||
+            (data_len > context->stream_meta.len - offset) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    ret = nfObject_ProgramDataBytes(context, context->active,
+            context->directory.next_free_data + offset / WHFU_BYTES_PER_UNIT,
+            data_len, data);
+    if (ret != 0) {
+        nfStream_Abandon(context);
+        return ret;
+    }
+    context->stream_written += data_len;
+    NF_STATS_ADD(context, data_bytes, data_len);
+    return 0;
+}
+
+/* Commit the streamed object once all of its data is written, replacing any
+ * earlier version, or abandon it when commit is 0 */
+int wh_NvmFlash_AddObjectFinish(void* c, int commit)
+{
     whNvmFlashContext* context = c;
     nfMemDirectory* d = NULL;
-    nfMemState new_state =  {0};
+    int oldentry = -1;
+    int ret = 0;
+
+    if (    (context == NULL) ||
+            (context->streaming == 0) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    if (commit == 0) {
+        nfStream_Abandon(context);
+        return 0;
+    }
+    if (context->stream_written != context->stream_meta.len) {
+        /* Data is missing, so the object can never become valid */
+        nfStream_Abandon(context);
+        return WH_ERROR_BADARGS;
+    }
+
+    d = &context->directory;
+    ret = nfObject_ProgramFinish(context, context->active,
+            d->next_free_object, context->stream_meta.len);
+    if (ret != 0) {
+        nfStream_Abandon(context);
+        return ret;
+    }
+
+    nfDataCache_Invalidate(context, context->stream_meta.id);
+    (void)nfMemDirectory_FindObjectIndexById(d, context->stream_meta.id,
+            &oldentry);
+    nfMemDirectory_Append(d, context->stream_epoch, &context->stream_meta,
+            oldentry);
+    context->streaming = 0;
+    return 0;
+}
+
+/* Begin compacting into the inactive partition.  Any earlier attempt is
+ * abandoned; its partition never had a count programmed, so it is invalid and
+ * gets erased again.
+ */
+static void nfCompact_Start(whNvmFlashContext* context)
+{
+    nfMemDirectory* d = &context->directory;
+    int used = 0;
+    int entry = 0;
+
+    context->compact_step = NF_COMPACT_ERASE;
+    context->compact_entry = 0;
+    context->compact_object = 0;
+    context->compact_data = 0;
+    context->compact_reserved = 0;
+
+    /* Keep the first entry for the checkpoint if everything else fits */
+    if (context->checkpoint != 0) {
+        for (entry = 0; entry < d->next_free_object; entry++) {
+            if (d->entries[entry].state.status == NF_STATUS_USED) {
+                used++;
+            }
+        }
+        if (used < NF_OBJECT_COUNT) {
+            context->compact_object = 1;
+            context->compact_reserved = 1;
+        }
+    }
+}
+
+/* Objects already copied may change once the active directory is written, so
+ * a copy that has not been committed has to start over.  Erasing either
+ * partition does not depend on the active directory and can carry on.
+ */
+static void nfCompact_Restart(whNvmFlashContext* context)
+{
+    if (    (context->compact_step == NF_COMPACT_COPY) ||
+            (context->compact_step == NF_COMPACT_COMMIT)) {
+        nfCompact_Start(context);
+    }
+}
+
+/* Complete an outstanding compaction erase of the inactive partition.  With
+ * wait set, spin until it is done, otherwise return WH_ERROR_NOTREADY while the
+ * flash is still busy.  A failed erase abandons the compaction.
+ */
+static int nfCompact_Poll(whNvmFlashContext* context, int wait)
+{
+    int ret = 0;
+
+    if (context->erasing == 0) {
+        return 0;
+    }
+
+    do {
+        ret = wh_FlashUnit_Poll(context->cb, context->flash);
+    } while ((wait != 0) && (ret == WH_ERROR_NOTREADY));
+    if (ret == WH_ERROR_NOTREADY) {
+        return ret;
+    }
+    context->erasing = 0;
+
+    if (ret == 0) {
+        ret = nfPartition_BlankCheck(context, !context->active);
+    }
+    if ((ret != 0) || (context->compact_step == NF_COMPACT_RETIRE)) {
+        context->compact_step = NF_COMPACT_IDLE;
+    }
+    return ret;
+}
+
+/* Advance a compaction by one erase, at most max_objects object copies or the
+ * commit.  Returns WH_ERROR_NOTREADY while steps remain and 0 when idle.  The
+ * new partition only becomes valid once its count is programmed, so power loss
+ * at any step recovers to the old partition, or to the new one once committed.
+ */
+static int nfCompact_Step(whNvmFlashContext* context, int max_objects)
+{
+    int ret = 0;
+    nfMemDirectory* d = &context->directory;
+    int src_part = context->active;
+    int dest_part = !context->active;
+
+    /* Nothing else may touch the flash while it erases */
+    ret = nfCompact_Poll(context, 0);
+    if (ret != 0) {
+        return ret;
+    }
+
+    switch (context->compact_step) {
+    case NF_COMPACT_IDLE:
+        return 0;
+
+    case NF_COMPACT_ERASE:
+        /* Blank check the inactive partition and erase if not blank */
+        ret = nfPartition_BlankCheck(context, dest_part);
+        if (ret == WH_ERROR_NOTBLANK) {
+            ret = nfPartition_EraseStart(context, dest_part);
+            if (ret == WH_ERROR_NOTREADY) {
+                return ret;
+            }
+        }
+        if (ret == 0) {
+            ret = nfPartition_ProgramEpoch(context, dest_part,
+                    context->state.epoch + 1);
+        }
+        /* Write partition start */
+        if (ret == 0) {
+            ret = nfPartition_ProgramStart(context, dest_part,
+                    context->state.start);
+        }
+        if (ret == 0) {
+            context->compact_step = NF_COMPACT_COPY;
+        }
+        break;
+
+    case NF_COMPACT_COPY:
+        /* Write the next few used objects to new partition */
+        while (     (ret == 0) &&
+                    (max_objects > 0) &&
+                    (context->compact_entry < d->next_free_object)) {
+            if (d->entries[context->compact_entry].state.status ==
+                    NF_STATUS_USED) {
+                ret = nfObject_Copy(context, context->compact_entry,
+                        dest_part, &context->compact_object,
+                        &context->compact_data);
+                max_objects--;
+            }
+            context->compact_entry++;
+        }
+        if (    (ret == 0) &&
+                (context->compact_entry >= d->next_free_object)) {
+            context->compact_step = NF_COMPACT_COMMIT;
+        }
+        break;
+
+    case NF_COMPACT_COMMIT:
+        /* Summarize the copied objects in the reserved first entry.  A full
+         * directory has no entry to spare and is written without one */
+        if (context->compact_reserved != 0) {
+            whNvmMetadata summary = {0};
+
+            summary.id = WH_NVM_INVALID_ID;
+            summary.len = (whNvmSize)(context->compact_object - 1);
+            ret = nfObject_ProgramBegin(context, dest_part, 0,
+                    (context->state.epoch + 1) | NF_EPOCH_CHECKPOINT, 0,
+                    &summary);
+            if (ret == 0) {
+                ret = nfObject_ProgramFinish(context, dest_part, 0, 0);
+            }
+        }
+
+        /* Write partition count */
+        if (ret == 0) {
+            ret = nfPartition_ProgramCount(context, dest_part,
+                    context->state.count);
+        }
+
+        /* Read and parse the new directory */
+        if (ret == 0) {
+            ret = nfPartition_ReadParseMemDirectory(context,
+                    dest_part, &context->directory);
+            if (ret != 0) {
+                /* Failed to reread the directory.  Read the previous one */
+                (void)nfPartition_ReadParseMemDirectory(context,
+                        src_part, &context->directory);
+            }
+        }
+
+        /* Update to use new partition */
+        if (ret == 0) {
+            context->active = dest_part;
+            context->state.status = NF_STATUS_USED;
+            context->state.epoch++;
+            context->compact_step = NF_COMPACT_RETIRE;
+            NF_STATS_ADD(context, compactions, 1);
+        }
+        break;
+
+    case NF_COMPACT_RETIRE:
+        /* Erase the old directory, now the inactive partition */
+        ret = nfPartition_EraseStart(context, dest_part);
+        if (ret == WH_ERROR_NOTREADY) {
+            return ret;
+        }
+        if (ret == 0) {
+            context->compact_step = NF_COMPACT_IDLE;
+            return 0;
+        }
+        break;
+
+    default:
+        ret = WH_ERROR_ABORTED;
+        break;
+    }
+
+    if (ret != 0) {
+        context->compact_step = NF_COMPACT_IDLE;
+        return ret;
+    }
+    return WH_ERROR_NOTREADY;
+}
+
+/* Replicate the current state into the inactive partition without the id's in
+ * the provided list or any reclaimable objects, then switch to it.
+ */
+static int nfPartition_Regenerate(whNvmFlashContext* context,
+        whNvmId list_count, const whNvmId* id_list)
+{
+    int ret = 0;
+    nfMemDirectory* d = NULL;
     int list_entry = 0;
     int entry = 0;
-    int src_part = 0;
-    int dest_part = 0;
-    uint32_t dest_object = 0;
-    uint32_t dest_data = 0;
 
     if (    (context == NULL) ||
             ((list_count > 0) && (id_list == NULL)) ) {
         return WH_ERROR_BADARGS;
     }
 
-    /* Context is valid.  Generate helper values */
-    d = &context->directory;
-    src_part = context->active;
-    dest_part = !context->active;
-    new_state =  (nfMemState)   {
-                                    .status = NF_STATUS_FREE,
-                                    .epoch = context->state.epoch + 1,
-                                    .start = context->state.start,
-                                    .count = context->state.count,
-                                };
-
     /* Go through the current directory and mark the listed id's as bad */
+    d = &context->directory;
     for (list_entry = 0; list_entry < list_count; list_entry++) {
         /* Mark all matching entries as bad.  Should only be 1. */
         do {
@@ -1144,65 +2055,116 @@ int wh_NvmFlash_DestroyObjects(void* c, whNvmId list_count,
             ret = nfMemDirectory_FindObjectIndexById(d, id_list[list_entry],
                     &entry);
             if ((ret == 0) && (entry >= 0)) {
-                d->objects[entry].state.status = NF_STATUS_DATA_BAD;
+                d->entries[entry].state.status = NF_STATUS_DATA_BAD;
             }
         } while (entry >= 0);
     }
 
-    /* Blank check the inactive partition and erase if not blank */
-    ret = nfPartition_BlankCheck(context, dest_part);
-    if (ret == WH_ERROR_NOTBLANK) {
-        ret = nfPartition_Erase(context, dest_part);
+    /* Run every step now */
+    nfCompact_Start(context);
+    do {
+        ret = nfCompact_Step(context, NF_OBJECT_COUNT);
+    } while (ret == WH_ERROR_NOTREADY);
+    return ret;
+}
+
+/* Destroy a list of objects.  Each listed object that is present gets a
+ * tombstone, so a destroy normally costs one directory entry and no erase.
+ * The partition is only regenerated when the list is empty, when there are
+ * not enough free entries for the tombstones, or once the reclaimable space
+ * crosses the configured thresholds.  Id's in the list that are not present do
+ * not cause an error.
+ */
+int wh_NvmFlash_DestroyObjects(void* c, whNvmId list_count,
+        const whNvmId* id_list)
+{
+    int ret = 0;
+    whNvmFlashContext* context = c;
+    nfMemDirectory* d = NULL;
+    int list_entry = 0;
+    int entry = 0;
+    int present = 0;
+
+    if (    (context == NULL) ||
+            ((list_count > 0) && (id_list == NULL)) ) {
+        return WH_ERROR_BADARGS;
     }
-    if (ret != 0) {
-        return ret;
+    if (context->streaming != 0) {
+        /* The open stream owns the writer and the next free entry */
+        return WH_ERROR_NOTREADY;
     }
 
-    ret = nfPartition_ProgramEpoch(context, dest_part, new_state.epoch);
-    if (ret != 0) {
-        return ret;
+    (void)nfCompact_Poll(context, 1);
+    for (list_entry = 0; list_entry < list_count; list_entry++) {
+        nfDataCache_Invalidate(context, id_list[list_entry]);
     }
 
-    /* Write partition start */
-    ret = nfPartition_ProgramStart(context, dest_part, new_state.start);
-    if (ret != 0) {
-        return ret;
+    /* An empty list is an explicit request to compact */
+    if (list_count == 0) {
+        return nfPartition_Regenerate(context, 0, NULL);
     }
 
-    /* Write each used object to new partition */
-    for (entry = 0; entry < NF_OBJECT_COUNT; entry++) {
-        if (d->objects[entry].state.status == NF_STATUS_USED) {
-            /* TODO: Handle errors here better. Break out of loop? */
-            ret = nfObject_Copy(context, entry,
-                    dest_part, &dest_object, &dest_data);
+    d = &context->directory;
+    for (list_entry = 0; list_entry < list_count; list_entry++) {
+        if (nfMemDirectory_FindObjectIndexById(d, id_list[list_entry],
+                NULL) == 0) {
+            present++;
         }
     }
+    if (present == 0) {
+        return 0;
+    }
 
-    /* Write partition count */
-    ret = nfPartition_ProgramCount(context, dest_part, new_state.count);
-    if (ret != 0) {
-        return ret;
+    /* No room to record them all, so replicate without them instead */
+    if (present > NF_OBJECT_COUNT - d->next_free_object) {
+        return nfPartition_Regenerate(context, list_count, id_list);
     }
 
-    /* Read and parse the new directory */
-    ret = nfPartition_ReadParseMemDirectory(context,
-            dest_part, &context->directory);
-    if (ret != 0) {
-        /* Failed to reread the directory.  Read the previous one instead */
-        (void)nfPartition_ReadParseMemDirectory(context,
-                src_part, &context->directory);
-        return ret;
+    for (list_entry = 0; (ret == 0) && (list_entry < list_count);
+            list_entry++) {
+        if (nfMemDirectory_FindObjectIndexById(d, id_list[list_entry],
+                &entry) == 0) {
+            ret = nfObject_Tombstone(context, entry);
+        }
     }
 
-    /* Update to use new partition */
-    context->active = dest_part;
-    new_state.status = NF_STATUS_USED;
-    context->state = new_state;
+    /* Compact in the background from the next idle ticks */
+    if (    (ret == 0) &&
+            (context->compact_step == NF_COMPACT_IDLE) &&
+            nfMemDirectory_CompactDue(context)) {
+        nfCompact_Start(context);
+    }
+    return ret;
+}
 
-    /* Erase the old directory */
-    ret = nfPartition_Erase(context, src_part);
+/* Regenerate the partition with only the accessible objects */
+int wh_NvmFlash_Compact(void* c)
+{
+    whNvmFlashContext* context = c;
 
-    return ret;
+    if (context == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+    if (context->streaming != 0) {
+        return WH_ERROR_NOTREADY;
+    }
+    return nfPartition_Regenerate(context, 0, NULL);
+}
+
+/* Advance a background compaction by a bounded amount */
+int wh_NvmFlash_CompactStep(void* c)
+{
+    whNvmFlashContext* context = c;
+
+    if (context == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+    if (context->streaming != 0) {
+        /* Hold off until the stream releases the writer */
+        return (context->compact_step == NF_COMPACT_IDLE) ?
+                0 : WH_ERROR_NOTREADY;
+    }
+    return nfCompact_Step(context, NF_COMPACT_STEP_OBJECTS);
 }
 
 /* Read the data of the object starting at the byte offset */
@@ -1212,17 +2174,32 @@ int wh_NvmFlash_Read(void* c, whNvmId id, whNvmSize offset,
     whNvmFlashContext* context = c;
     int ret = 0;
     int object_index = -1;
+    const uint8_t* mapped = NULL;
 
     if (    (context == NULL) ||
             ((data_len > 0) && (data == NULL)) ){
         return WH_ERROR_BADARGS;
     }
 
+    (void)nfCompact_Poll(context, 1);
+
     ret = nfMemDirectory_FindObjectIndexById(
             &context->directory,
             id,
             &object_index);
     if (ret == 0) {
+        /* Memory mapped flash is read in place */
+        ret = nfObject_MapDataBytes(context, context->active, object_index,
+                offset, data_len, &mapped);
+        if ((ret == 0) && (data_len > 0)) {
+            memcpy(data, mapped, data_len);
+        }
+    }
+    if (ret == WH_ERROR_NOTIMPL) {
+        ret = nfDataCache_Read(context, object_index, offset, data_len, data);
+    }
+    if ((ret == WH_ERROR_NOTFOUND) && (object_index >= 0)) {
+        /* Too large to cache */
         ret = nfObject_ReadDataBytes(
                 context,
                 context->active,
@@ -1233,3 +2210,53 @@ int wh_NvmFlash_Read(void* c, whNvmId id, whNvmSize offset,
     }
     return ret;
 }
+
+int wh_NvmFlash_ReadPointer(void* c, whNvmId id, whNvmSize offset,
+        whNvmSize data_len, const uint8_t** out_data)
+{
+    whNvmFlashContext* context = c;
+    int ret = 0;
+    int object_index = -1;
+
+    if ((context == NULL) || (out_data == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    /* The active partition must be readable in place */
+    (void)nfCompact_Poll(context, 1);
+
+    ret = nfMemDirectory_FindObjectIndexById(
+            &context->directory,
+            id,
+            &object_index);
+    if (ret == 0) {
+        ret = nfObject_MapDataBytes(context, context->active, object_index,
+                offset, data_len, out_data);
+    }
+    return ret;
+}
+
+int wh_NvmFlash_GetStats(void* c, whNvmStats* out_stats)
+{
+    whNvmFlashContext* context = c;
+
+    if ((context == NULL) || (out_stats == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+#ifdef WOLFHSM_NVM_STATS
+    memset(out_stats, 0, sizeof(*out_stats));
+    out_stats->data_bytes = context->data_bytes;
+    out_stats->program_bytes = context->stats.program_bytes;
+    out_stats->erase_bytes = context->stats.erase_bytes;
+    out_stats->program_ops = context->stats.program_ops;
+    out_stats->erase_ops = context->stats.erase_ops;
+    out_stats->blank_checks = context->stats.blank_checks;
+    out_stats->verifies = context->stats.verifies;
+    out_stats->compactions = context->compactions;
+    out_stats->partition_erases[0] = context->partition_erases[0];
+    out_stats->partition_erases[1] = context->partition_erases[1];
+    return 0;
+#else
+    return WH_ERROR_NOTIMPL;
+#endif
+}
@@ -0,0 +1,1127 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * src/wh_nvm_flashlog.c
+ *
+ * Log structured NVM object management on top of generic flash layer
+ *
+ */
+
+#include <stddef.h>     /* For NULL */
+#include <string.h>     /* For memset, memcpy */
+
+#include "wolfhsm/wh_common.h"
+#include "wolfhsm/wh_error.h"
+#include "wolfhsm/wh_flash.h"
+#include "wolfhsm/wh_flash_unit.h"
+#include "wolfhsm/wh_nvm.h"
+#include "wolfhsm/wh_nvm_flashlog.h"
+
+enum {
+    NFL_COPY_BUFFER_LEN = 8 * WHFU_BYTES_PER_UNIT,
+};
+
+/* Fixed patterns keep every programmed unit distinct from erased flash,
+ * whether the part erases to 0 or to 1 */
+#define NFL_SECTOR_MAGIC        (0x574C4F47ul)  /* "WLOG" */
+#define NFL_RECORD_TAG          (0xA500u)
+#define NFL_RECORD_TAG_MASK     (0xFF00u)
+#define NFL_RECORD_TOMBSTONE    (0x0001u)
+
+/* Pack and unpack two 32-bit halves of a unit */
+#define NFL_UNIT(_hi, _lo) \
+            ((((whFlashUnit)(_hi)) << 32) | (whFlashUnit)(uint32_t)(_lo))
+#define NFL_UNIT_HI(_u) ((uint32_t)((_u) >> 32))
+#define NFL_UNIT_LO(_u) ((uint32_t)((_u) & 0xFFFFFFFFul))
+
+/* Sector layout in units */
+#define NFL_SECTOR_HEADER_UNIT  0   /* Magic and erase count */
+#define NFL_SECTOR_SEQ_UNIT     1   /* Log sequence, blank while free */
+#define NFL_SECTOR_FIRST_UNIT   2   /* First record */
+
+/* Record layout in units: head, metadata, data and commit */
+#define NFL_UNITS_PER_METADATA WHFU_BYTES2UNITS(sizeof(whNvmMetadata))
+#define NFL_RECORD_META_UNIT 1
+#define NFL_RECORD_DATA_UNIT (NFL_RECORD_META_UNIT + NFL_UNITS_PER_METADATA)
+#define NFL_RECORD_OVERHEAD (NFL_RECORD_DATA_UNIT + 1)
+#define NFL_RECORD_UNITS(_len) (NFL_RECORD_OVERHEAD + WHFU_BYTES2UNITS(_len))
+
+/* Decoded record head */
+typedef struct {
+    uint32_t epoch;
+    whNvmSize len;
+    uint16_t flags;
+} nflRecordHead;
+
+/* Called for each record of a sector during a scan */
+typedef int (*nflRecordCb)(whNvmFlashLogContext* context, uint16_t sector,
+        uint32_t unit, const nflRecordHead* head, int committed);
+
+/** Local declarations */
+static uint32_t nflSector_Offset(whNvmFlashLogContext* context,
+        uint16_t sector);
+static int nflSector_Format(whNvmFlashLogContext* context, uint16_t sector,
+        uint32_t erase_count);
+static int nflSector_Open(whNvmFlashLogContext* context);
+static int nflSector_FreeCount(whNvmFlashLogContext* context);
+static int nflSector_Victim(whNvmFlashLogContext* context);
+static int nflSector_Scan(whNvmFlashLogContext* context, uint16_t sector,
+        nflRecordCb cb, uint32_t* out_end, uint32_t* out_damaged);
+static int nflSector_Relocate(whNvmFlashLogContext* context, uint16_t sector);
+static int nflSector_Reclaim(whNvmFlashLogContext* context, uint16_t sector);
+
+static int nflRecord_ReadHead(whNvmFlashLogContext* context, uint16_t sector,
+        uint32_t unit, nflRecordHead* out_head);
+static int nflRecord_Begin(whNvmFlashLogContext* context, uint32_t epoch,
+        uint16_t flags, const whNvmMetadata* meta, uint16_t* out_sector,
+        uint32_t* out_unit);
+static int nflRecord_Finish(whNvmFlashLogContext* context, uint16_t sector,
+        uint32_t unit, uint32_t epoch, whNvmSize len);
+static int nflRecord_Copy(whNvmFlashLogContext* context, nflEntry* entry);
+
+static nflEntry* nflEntry_Find(whNvmFlashLogContext* context, whNvmId id);
+static nflEntry* nflEntry_FindRecord(whNvmFlashLogContext* context,
+        uint16_t sector, uint32_t unit);
+static nflEntry* nflEntry_Alloc(whNvmFlashLogContext* context);
+static int nflEntry_LiveCount(whNvmFlashLogContext* context);
+static void nflEntry_Supersede(whNvmFlashLogContext* context, nflEntry* entry);
+static int nflEntry_Matches(const nflEntry* entry, whNvmAccess access,
+        whNvmFlags flags);
+
+static int nflLog_Load(whNvmFlashLogContext* context);
+static int nflLog_Reserve(whNvmFlashLogContext* context, uint32_t units);
+
+static int nflScan_Load(whNvmFlashLogContext* context, uint16_t sector,
+        uint32_t unit, const nflRecordHead* head, int committed);
+static int nflScan_Release(whNvmFlashLogContext* context, uint16_t sector,
+        uint32_t unit, const nflRecordHead* head, int committed);
+static int nflScan_Relocate(whNvmFlashLogContext* context, uint16_t sector,
+        uint32_t unit, const nflRecordHead* head, int committed);
+
+
+/** Sectors */
+
+static uint32_t nflSector_Offset(whNvmFlashLogContext* context,
+        uint16_t sector)
+{
+    return (uint32_t)sector * context->sector_units;
+}
+
+/* Erase a sector and record its new erase count.  The sector is then free */
+static int nflSector_Format(whNvmFlashLogContext* context, uint16_t sector,
+        uint32_t erase_count)
+{
+    int ret = 0;
+    nflSector* s = &context->sectors[sector];
+    whFlashUnit header = NFL_UNIT(NFL_SECTOR_MAGIC, erase_count);
+
+    ret = wh_FlashUnit_Erase(context->cb, context->flash,
+            nflSector_Offset(context, sector), context->sector_units);
+    if (ret == 0) {
+        ret = wh_FlashUnit_Program(context->cb, context->flash,
+                nflSector_Offset(context, sector) + NFL_SECTOR_HEADER_UNIT,
+                1, &header);
+    }
+
+    s->seq = 0;
+    s->erase_count = erase_count;
+    s->next_unit = NFL_SECTOR_FIRST_UNIT;
+    s->garbage = 0;
+    if (ret != 0) {
+        /* Unusable until formatted again */
+        s->next_unit = context->sector_units;
+    }
+    return ret;
+}
+
+/* Append a free sector to the log, preferring the least worn */
+static int nflSector_Open(whNvmFlashLogContext* context)
+{
+    int ret = 0;
+    int best = -1;
+    uint16_t sector = 0;
+    uint32_t seq = context->seq + 1;
+    whFlashUnit seq_unit = NFL_UNIT(~seq, seq);
+    nflSector* old = NULL;
+
+    for (sector = 0; sector < context->sector_count; sector++) {
+        if (    (context->sectors[sector].seq == 0) &&
+                (context->sectors[sector].next_unit ==
+                    NFL_SECTOR_FIRST_UNIT) &&
+                (   (best < 0) ||
+                    (context->sectors[sector].erase_count <
+                        context->sectors[best].erase_count))) {
+            best = sector;
+        }
+    }
+    if (best < 0) {
+        return WH_ERROR_NOSPACE;
+    }
+
+    ret = wh_FlashUnit_Program(context->cb, context->flash,
+            nflSector_Offset(context, (uint16_t)best) + NFL_SECTOR_SEQ_UNIT,
+            1, &seq_unit);
+    old = &context->sectors[context->head];
+    if ((ret == 0) && (old->seq != 0)) {
+        /* Whatever the old head could not fit is reclaimed with it */
+        old->garbage += context->sector_units - old->next_unit;
+        old->next_unit = context->sector_units;
+    }
+    if (ret == 0) {
+        context->seq = seq;
+        context->sectors[best].seq = seq;
+        context->head = (uint16_t)best;
+    }
+    return ret;
+}
+
+static int nflSector_FreeCount(whNvmFlashLogContext* context)
+{
+    int count = 0;
+    uint16_t sector = 0;
+
+    for (sector = 0; sector < context->sector_count; sector++) {
+        if (    (context->sectors[sector].seq == 0) &&
+                (context->sectors[sector].next_unit ==
+                    NFL_SECTOR_FIRST_UNIT)) {
+            count++;
+        }
+    }
+    return count;
+}
+
+/* The closed sector with the most garbage, the least worn of equals.  -1 when
+ * nothing is reclaimable */
+static int nflSector_Victim(whNvmFlashLogContext* context)
+{
+    int best = -1;
+    uint16_t sector = 0;
+    const nflSector* s = NULL;
+
+    for (sector = 0; sector < context->sector_count; sector++) {
+        s = &context->sectors[sector];
+        if ((s->seq == 0) || (sector == context->head) || (s->garbage == 0)) {
+            continue;
+        }
+        if (    (best < 0) ||
+                (s->garbage > context->sectors[best].garbage) ||
+                (   (s->garbage == context->sectors[best].garbage) &&
+                    (s->erase_count < context->sectors[best].erase_count))) {
+            best = sector;
+        }
+    }
+    return best;
+}
+
+/* Walk the records of a log sector in order, passing each to cb.  Returns the
+ * first cb error.  Stops at the first blank head, setting out_end to its unit,
+ * or at a head that cannot be decoded, setting out_damaged to the units from
+ * there to the end of the sector.  Either may be NULL */
+static int nflSector_Scan(whNvmFlashLogContext* context, uint16_t sector,
+        nflRecordCb cb, uint32_t* out_end, uint32_t* out_damaged)
+{
+    int ret = 0;
+    int committed = 0;
+    uint32_t unit = NFL_SECTOR_FIRST_UNIT;
+    uint32_t units = 0;
+    nflRecordHead head = {0};
+    whFlashUnit commit = 0;
+
+    while ((ret == 0) && (unit < context->sector_units)) {
+        ret = nflRecord_ReadHead(context, sector, unit, &head);
+        if (ret == WH_ERROR_NOTFOUND) {
+            /* End of the log in this sector */
+            ret = 0;
+            break;
+        }
+        units = NFL_RECORD_UNITS(head.len);
+        if ((ret != 0) || (units > context->sector_units - unit)) {
+            /* Damaged head.  Nothing after it can be trusted */
+            ret = 0;
+            if (out_damaged != NULL) {
+                *out_damaged = context->sector_units - unit;
+            }
+            unit = context->sector_units;
+            break;
+        }
+
+        committed = 0;
+        ret = wh_FlashUnit_Read(context->cb, context->flash,
+                nflSector_Offset(context, sector) + unit + units - 1, 1,
+                &commit);
+        if (    (ret == 0) &&
+                (commit == NFL_UNIT(~head.epoch, head.epoch))) {
+            committed = 1;
+        }
+        if (ret == 0) {
+            ret = cb(context, sector, unit, &head, committed);
+        }
+        unit += units;
+    }
+
+    if (out_end != NULL) {
+        *out_end = unit;
+    }
+    return ret;
+}
+
+/* Move the current records out of a closed sector, then erase it.  Tombstones
+ * are dropped once no older record of their id is left anywhere else */
+static int nflSector_Relocate(whNvmFlashLogContext* context, uint16_t sector)
+{
+    int ret = 0;
+
+    /* First forget the older records this sector holds, so the tombstones
+     * know whether they are still needed */
+    ret = nflSector_Scan(context, sector, nflScan_Release, NULL, NULL);
+    if (ret == 0) {
+        ret = nflSector_Scan(context, sector, nflScan_Relocate, NULL, NULL);
+    }
+    if (ret == 0) {
+        ret = nflSector_Format(context, sector,
+                context->sectors[sector].erase_count + 1);
+    }
+    return ret;
+}
+
+/* Relocate a sector, restoring a consistent directory if that fails */
+static int nflSector_Reclaim(whNvmFlashLogContext* context, uint16_t sector)
+{
+    int ret = 0;
+
+    ret = nflSector_Relocate(context, sector);
+    if (ret != 0) {
+        /* The directory was changed part way.  Rebuild it from flash */
+        (void)nflLog_Load(context);
+    }
+    return ret;
+}
+
+
+/** Records */
+
+/* Returns 0 for a valid head, WH_ERROR_NOTFOUND when blank or another error
+ * when the head is damaged */
+static int nflRecord_ReadHead(whNvmFlashLogContext* context, uint16_t sector,
+        uint32_t unit, nflRecordHead* out_head)
+{
+    int ret = 0;
+    whFlashUnit head = 0;
+    uint32_t offset = nflSector_Offset(context, sector) + unit;
+
+    ret = wh_FlashUnit_BlankCheck(context->cb, context->flash, offset, 1);
+    if (ret == 0) {
+        return WH_ERROR_NOTFOUND;
+    }
+    if (ret != WH_ERROR_NOTBLANK) {
+        return ret;
+    }
+
+    ret = wh_FlashUnit_Read(context->cb, context->flash, offset, 1, &head);
+    if (ret == 0) {
+        out_head->epoch = NFL_UNIT_HI(head);
+        out_head->len = (whNvmSize)(NFL_UNIT_LO(head) >> 16);
+        out_head->flags = (uint16_t)(NFL_UNIT_LO(head) & 0xFFFFu);
+        if ((out_head->flags & NFL_RECORD_TAG_MASK) != NFL_RECORD_TAG) {
+            ret = WH_ERROR_NOTVERIFIED;
+        }
+    }
+    return ret;
+}
+
+/* Program the head and metadata of a new record at the end of the log.  The
+ * space is consumed, and counted as garbage, until the record is finished */
+static int nflRecord_Begin(whNvmFlashLogContext* context, uint32_t epoch,
+        uint16_t flags, const whNvmMetadata* meta, uint16_t* out_sector,
+        uint32_t* out_unit)
+{
+    int ret = 0;
+    uint32_t units = NFL_RECORD_UNITS(meta->len);
+    nflSector* s = &context->sectors[context->head];
+    whFlashUnit head = NFL_UNIT(epoch,
+            ((uint32_t)meta->len << 16) | NFL_RECORD_TAG | flags);
+    uint32_t offset = 0;
+
+    if (units > context->sector_units - NFL_SECTOR_FIRST_UNIT) {
+        return WH_ERROR_NOSPACE;
+    }
+    if (units > context->sector_units - s->next_unit) {
+        ret = nflSector_Open(context);
+        if (ret != 0) {
+            return ret;
+        }
+        s = &context->sectors[context->head];
+    }
+
+    *out_sector = context->head;
+    *out_unit = s->next_unit;
+    offset = nflSector_Offset(context, context->head) + s->next_unit;
+    s->next_unit += units;
+    s->garbage += units;
+
+    ret = wh_FlashUnit_Program(context->cb, context->flash, offset, 1, &head);
+    if (ret == 0) {
+        ret = wh_FlashUnit_Program(context->cb, context->flash,
+                offset + NFL_RECORD_META_UNIT, NFL_UNITS_PER_METADATA,
+                (const whFlashUnit*)meta);
+    }
+    return ret;
+}
+
+/* Program the commit that makes a record valid */
+static int nflRecord_Finish(whNvmFlashLogContext* context, uint16_t sector,
+        uint32_t unit, uint32_t epoch, whNvmSize len)
+{
+    int ret = 0;
+    uint32_t units = NFL_RECORD_UNITS(len);
+    whFlashUnit commit = NFL_UNIT(~epoch, epoch);
+
+    ret = wh_FlashUnit_Program(context->cb, context->flash,
+            nflSector_Offset(context, sector) + unit + units - 1, 1, &commit);
+    if (ret == 0) {
+        context->sectors[sector].garbage -= units;
+    }
+    return ret;
+}
+
+/* Append a copy of the current record of entry and point the entry at it */
+static int nflRecord_Copy(whNvmFlashLogContext* context, nflEntry* entry)
+{
+    int ret = 0;
+    uint16_t sector = 0;
+    uint32_t unit = 0;
+    uint32_t data_offset = 0;
+    uint32_t src = 0;
+    uint32_t dest = 0;
+    uint16_t flags = 0;
+
+    if (entry->status == NFL_ENTRY_TOMB) {
+        flags = NFL_RECORD_TOMBSTONE;
+    }
+    src = (nflSector_Offset(context, entry->sector) + entry->unit +
+            NFL_RECORD_DATA_UNIT) * WHFU_BYTES_PER_UNIT;
+
+    ret = nflRecord_Begin(context, entry->epoch, flags, &entry->metadata,
+            &sector, &unit);
+    dest = (nflSector_Offset(context, sector) + unit + NFL_RECORD_DATA_UNIT) *
+            WHFU_BYTES_PER_UNIT;
+
+    while ((ret == 0) && (data_offset < entry->metadata.len)) {
+        uint8_t buffer[NFL_COPY_BUFFER_LEN];
+        uint32_t this_len = sizeof(buffer);
+
+        if ((entry->metadata.len - data_offset) < this_len) {
+            this_len = entry->metadata.len - data_offset;
+        }
+        ret = wh_FlashUnit_ReadBytes(context->cb, context->flash,
+                src + data_offset, this_len, buffer);
+        if (ret == 0) {
+            ret = wh_FlashUnit_ProgramBytes(context->cb, context->flash,
+                    dest + data_offset, this_len, buffer);
+        }
+        data_offset += this_len;
+    }
+
+    if (ret == 0) {
+        ret = nflRecord_Finish(context, sector, unit, entry->epoch,
+                entry->metadata.len);
+    }
+    if (ret == 0) {
+        entry->sector = sector;
+        entry->unit = unit;
+    }
+    return ret;
+}
+
+
+/** Directory entries */
+
+static nflEntry* nflEntry_Find(whNvmFlashLogContext* context, whNvmId id)
+{
+    int i = 0;
+
+    for (i = 0; i < NFL_ENTRY_COUNT; i++) {
+        if (    (context->entries[i].status != NFL_ENTRY_FREE) &&
+                (context->entries[i].metadata.id == id)) {
+            return &context->entries[i];
+        }
+    }
+    return NULL;
+}
+
+static nflEntry* nflEntry_FindRecord(whNvmFlashLogContext* context,
+        uint16_t sector, uint32_t unit)
+{
+    int i = 0;
+
+    for (i = 0; i < NFL_ENTRY_COUNT; i++) {
+        if (    (context->entries[i].status != NFL_ENTRY_FREE) &&
+                (context->entries[i].sector == sector) &&
+                (context->entries[i].unit == unit)) {
+            return &context->entries[i];
+        }
+    }
+    return NULL;
+}
+
+static nflEntry* nflEntry_Alloc(whNvmFlashLogContext* context)
+{
+    int i = 0;
+
+    for (i = 0; i < NFL_ENTRY_COUNT; i++) {
+        if (context->entries[i].status == NFL_ENTRY_FREE) {
+            return &context->entries[i];
+        }
+    }
+    return NULL;
+}
+
+static int nflEntry_LiveCount(whNvmFlashLogContext* context)
+{
+    int i = 0;
+    int count = 0;
+
+    for (i = 0; i < NFL_ENTRY_COUNT; i++) {
+        if (context->entries[i].status == NFL_ENTRY_LIVE) {
+            count++;
+        }
+    }
+    return count;
+}
+
+/* The current record of entry is about to be replaced and becomes garbage */
+static void nflEntry_Supersede(whNvmFlashLogContext* context, nflEntry* entry)
+{
+    context->sectors[entry->sector].garbage +=
+            NFL_RECORD_UNITS(entry->metadata.len);
+    entry->stale++;
+}
+
+static int nflEntry_Matches(const nflEntry* entry, whNvmAccess access,
+        whNvmFlags flags)
+{
+    return  (entry->status == NFL_ENTRY_LIVE) &&
+            (   (access == WOLFHSM_NVM_ACCESS_ANY) ||
+                (entry->metadata.access == access)) &&
+            (   (flags == WOLFHSM_NVM_FLAGS_ANY) ||
+                ((entry->metadata.flags & flags) == flags));
+}
+
+
+/** Scan callbacks */
+
+/* Mount: the newest epoch of each id becomes current, ties going to the later
+ * record, which is the copy a reclaim made */
+static int nflScan_Load(whNvmFlashLogContext* context, uint16_t sector,
+        uint32_t unit, const nflRecordHead* head, int committed)
+{
+    int ret = 0;
+    uint32_t units = NFL_RECORD_UNITS(head->len);
+    whNvmMetadata meta = {0};
+    nflEntry* entry = NULL;
+
+    if (committed) {
+        ret = wh_FlashUnit_Read(context->cb, context->flash,
+                nflSector_Offset(context, sector) + unit +
+                    NFL_RECORD_META_UNIT,
+                NFL_UNITS_PER_METADATA, (whFlashUnit*)&meta);
+    }
+    if ((ret != 0) || (!committed) || (meta.len != head->len)) {
+        /* Interrupted or unreadable, only the space is left */
+        context->sectors[sector].garbage += units;
+        return 0;
+    }
+
+    entry = nflEntry_Find(context, meta.id);
+    if ((entry != NULL) && (head->epoch < entry->epoch)) {
+        context->sectors[sector].garbage += units;
+        entry->stale++;
+        return 0;
+    }
+    if (entry != NULL) {
+        nflEntry_Supersede(context, entry);
+    } else {
+        entry = nflEntry_Alloc(context);
+        if (entry == NULL) {
+            context->sectors[sector].garbage += units;
+            return 0;
+        }
+        entry->stale = 0;
+    }
+
+    memcpy(&entry->metadata, &meta, sizeof(meta));
+    entry->epoch = head->epoch;
+    entry->sector = sector;
+    entry->unit = unit;
+    entry->status = (head->flags & NFL_RECORD_TOMBSTONE) ?
+            NFL_ENTRY_TOMB : NFL_ENTRY_LIVE;
+    return 0;
+}
+
+/* Reclaim, first pass: older records in the sector stop counting as stale */
+static int nflScan_Release(whNvmFlashLogContext* context, uint16_t sector,
+        uint32_t unit, const nflRecordHead* head, int committed)
+{
+    int ret = 0;
+    whNvmMetadata meta = {0};
+    nflEntry* entry = NULL;
+
+    (void)head;
+    if ((!committed) || (nflEntry_FindRecord(context, sector, unit) != NULL)) {
+        return 0;
+    }
+
+    ret = wh_FlashUnit_Read(context->cb, context->flash,
+            nflSector_Offset(context, sector) + unit + NFL_RECORD_META_UNIT,
+            NFL_UNITS_PER_METADATA, (whFlashUnit*)&meta);
+    if (ret == 0) {
+        entry = nflEntry_Find(context, meta.id);
+        if ((entry != NULL) && (entry->stale > 0)) {
+            entry->stale--;
+        }
+    }
+    return ret;
+}
+
+/* Reclaim, second pass: carry the current records forward */
+static int nflScan_Relocate(whNvmFlashLogContext* context, uint16_t sector,
+        uint32_t unit, const nflRecordHead* head, int committed)
+{
+    nflEntry* entry = NULL;
+
+    (void)head;
+    if (!committed) {
+        return 0;
+    }
+    entry = nflEntry_FindRecord(context, sector, unit);
+    if (entry == NULL) {
+        return 0;
+    }
+    if ((entry->status == NFL_ENTRY_TOMB) && (entry->stale == 0)) {
+        /* Nothing left for it to hide */
+        memset(entry, 0, sizeof(*entry));
+        return 0;
+    }
+    return nflRecord_Copy(context, entry);
+}
+
+
+/** Log */
+
+/* Rebuild the directory and sector states from flash */
+static int nflLog_Load(whNvmFlashLogContext* context)
+{
+    int ret = 0;
+    uint16_t sector = 0;
+    uint32_t max_erase = 0;
+    uint32_t last_seq = 0;
+    int next = 0;
+    uint32_t damaged = 0;
+    whFlashUnit value = 0;
+    nflSector* s = NULL;
+    uint8_t formatted[NFL_MAX_SECTORS];
+
+    memset(context->sectors, 0, sizeof(context->sectors));
+    memset(context->entries, 0, sizeof(context->entries));
+    memset(formatted, 0, sizeof(formatted));
+    context->seq = 0;
+    context->head = 0;
+
+    /* Classify each sector from its header and sequence units */
+    for (sector = 0; sector < context->sector_count; sector++) {
+        s = &context->sectors[sector];
+        ret = wh_FlashUnit_Read(context->cb, context->flash,
+                nflSector_Offset(context, sector) + NFL_SECTOR_HEADER_UNIT,
+                1, &value);
+        if ((ret != 0) || (NFL_UNIT_HI(value) != NFL_SECTOR_MAGIC)) {
+            continue;
+        }
+        formatted[sector] = 1;
+        s->erase_count = NFL_UNIT_LO(value);
+        if (s->erase_count > max_erase) {
+            max_erase = s->erase_count;
+        }
+        s->next_unit = NFL_SECTOR_FIRST_UNIT;
+
+        if (wh_FlashUnit_BlankCheck(context->cb, context->flash,
+                nflSector_Offset(context, sector) + NFL_SECTOR_SEQ_UNIT,
+                1) == 0) {
+            /* Free */
+            continue;
+        }
+        ret = wh_FlashUnit_Read(context->cb, context->flash,
+                nflSector_Offset(context, sector) + NFL_SECTOR_SEQ_UNIT,
+                1, &value);
+        if (    (ret != 0) ||
+                (NFL_UNIT_HI(value) != ~NFL_UNIT_LO(value)) ||
+                (NFL_UNIT_LO(value) == 0)) {
+            formatted[sector] = 0;
+            continue;
+        }
+        s->seq = NFL_UNIT_LO(value);
+    }
+
+    /* Blank or damaged sectors lost their count, assume the most worn */
+    for (sector = 0; sector < context->sector_count; sector++) {
+        if (formatted[sector] == 0) {
+            ret = nflSector_Format(context, sector, max_erase);
+            if (ret != 0) {
+                return ret;
+            }
+        }
+    }
+
+    /* Replay the log sectors in sequence order */
+    do {
+        next = -1;
+        for (sector = 0; sector < context->sector_count; sector++) {
+            s = &context->sectors[sector];
+            if (    (s->seq > last_seq) &&
+                    ((next < 0) || (s->seq < context->sectors[next].seq))) {
+                next = sector;
+            }
+        }
+        if (next >= 0) {
+            s = &context->sectors[next];
+            damaged = 0;
+            ret = nflSector_Scan(context, (uint16_t)next, nflScan_Load,
+                    &s->next_unit, &damaged);
+            if (ret != 0) {
+                return ret;
+            }
+            s->garbage += damaged;
+            last_seq = context->sectors[next].seq;
+            context->head = (uint16_t)next;
+        }
+    } while (next >= 0);
+    context->seq = last_seq;
+
+    /* Only the head is appended to.  The unused tail of the others was
+     * counted as garbage when they were closed */
+    for (sector = 0; sector < context->sector_count; sector++) {
+        s = &context->sectors[sector];
+        if ((s->seq != 0) && (sector != context->head)) {
+            s->garbage += context->sector_units - s->next_unit;
+            s->next_unit = context->sector_units;
+        }
+    }
+
+    if (last_seq == 0) {
+        /* Empty store.  Start the log */
+        ret = nflSector_Open(context);
+    }
+
+    /* An interrupted reclaim can leave no spare.  Its victim has been copied,
+     * so reclaiming it again only erases it */
+    while ((ret == 0) && (nflSector_FreeCount(context) == 0)) {
+        next = nflSector_Victim(context);
+        if (next < 0) {
+            ret = WH_ERROR_NOSPACE;
+            break;
+        }
+        ret = nflSector_Relocate(context, (uint16_t)next);
+    }
+    return ret;
+}
+
+/* Make room to append units while still leaving a spare sector afterwards,
+ * reclaiming the sectors with the most garbage as needed */
+static int nflLog_Reserve(whNvmFlashLogContext* context, uint32_t units)
+{
+    int ret = 0;
+    int attempts = 0;
+    int victim = 0;
+    const nflSector* head = NULL;
+
+    if (units > context->sector_units - NFL_SECTOR_FIRST_UNIT) {
+        return WH_ERROR_NOSPACE;
+    }
+
+    for (attempts = 0; attempts <= context->sector_count; attempts++) {
+        head = &context->sectors[context->head];
+        if (    (units <= context->sector_units - head->next_unit) ||
+                (nflSector_FreeCount(context) > 1)) {
+            return 0;
+        }
+        victim = nflSector_Victim(context);
+        if (victim < 0) {
+            break;
+        }
+        ret = nflSector_Reclaim(context, (uint16_t)victim);
+        if (ret != 0) {
+            return ret;
+        }
+    }
+    return WH_ERROR_NOSPACE;
+}
+
+
+/** whNvm Interface */
+
+int wh_NvmFlashLog_Init(void* c, const void* cf)
+{
+    whNvmFlashLogContext* context = c;
+    const whNvmFlashLogConfig* config = cf;
+    uint32_t sector_size = 0;
+    int ret = 0;
+
+    if (    (context == NULL) ||
+            (config == NULL) ||
+            (config->cb == NULL) ||
+            (config->sector_count < 3) ||
+            (config->sector_count > NFL_MAX_SECTORS)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    if (config->cb->Init != NULL) {
+        ret = config->cb->Init(config->context, config->config);
+    }
+    if (ret != 0) {
+        return ret;
+    }
+
+    memset(context, 0, sizeof(*context));
+    context->cb = config->cb;
+    context->flash = config->context;
+    context->sector_count = config->sector_count;
+
+    sector_size = config->sector_size;
+    if ((sector_size == 0) && (context->cb->PartitionSize != NULL)) {
+        sector_size = context->cb->PartitionSize(context->flash);
+    }
+    context->sector_units = sector_size / WHFU_BYTES_PER_UNIT;
+    if (    ((sector_size % WHFU_BYTES_PER_UNIT) != 0) ||
+            (context->sector_units <
+                NFL_SECTOR_FIRST_UNIT + NFL_RECORD_OVERHEAD)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    (void)wh_FlashUnit_WriteUnlock(context->cb, context->flash, 0,
+            context->sector_units * context->sector_count);
+
+    ret = nflLog_Load(context);
+    if (ret == 0) {
+        context->initialized = 1;
+    }
+    return ret;
+}
+
+int wh_NvmFlashLog_Cleanup(void* c)
+{
+    whNvmFlashLogContext* context = c;
+    int rc = 0;
+
+    if (context == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    if (context->initialized == 0) {
+        /* Already cleaned up*/
+        return 0;
+    }
+
+    /* Ignore errors here */
+    (void)wh_FlashUnit_WriteLock(context->cb, context->flash, 0,
+            context->sector_units * context->sector_count);
+
+    if (context->cb->Cleanup != NULL) {
+        rc = context->cb->Cleanup(context->flash);
+    }
+    context->initialized = 0;
+    return rc;
+}
+
+int wh_NvmFlashLog_List(void* c,
+        whNvmAccess access, whNvmFlags flags, whNvmId start_id,
+        whNvmId *out_count, whNvmId *out_id)
+{
+    whNvmFlashLogContext* context = c;
+    int this_entry = 0;
+    int this_count = 0;
+    whNvmId this_id = 0;
+    const nflEntry* start = NULL;
+
+    if (context == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    /* Resume after the starting id */
+    if (start_id != 0) {
+        start = nflEntry_Find(context, start_id);
+        if ((start == NULL) || (start->status != NFL_ENTRY_LIVE)) {
+            /* None found */
+            this_entry = NFL_ENTRY_COUNT;
+        } else {
+            this_entry = (int)(start - context->entries) + 1;
+        }
+    }
+
+    /* Take the next match, then count how many more there are */
+    for (; this_entry < NFL_ENTRY_COUNT; this_entry++) {
+        if (nflEntry_Matches(&context->entries[this_entry], access, flags)) {
+            if (this_count == 0) {
+                this_id = context->entries[this_entry].metadata.id;
+            }
+            this_count++;
+        }
+    }
+    if (out_count != NULL) *out_count = this_count;
+    if (out_id != NULL) *out_id = this_id;
+    return 0;
+}
+
+int wh_NvmFlashLog_GetAvailable(void* c,
+        uint32_t *out_avail_size, whNvmId *out_avail_objects,
+        uint32_t *out_reclaim_size, whNvmId *out_reclaim_objects)
+{
+    whNvmFlashLogContext* context = c;
+    uint32_t room = 0;
+    uint32_t garbage = 0;
+    uint32_t reclaim_objects = 0;
+    uint16_t sector = 0;
+    int i = 0;
+
+    if (context == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    if (out_avail_size != NULL) {
+        /* Largest record that fits without a reclaim, in the head or in a
+         * fresh sector while one stays spare */
+        room = context->sector_units -
+                context->sectors[context->head].next_unit;
+        if (nflSector_FreeCount(context) > 1) {
+            room = context->sector_units - NFL_SECTOR_FIRST_UNIT;
+        }
+        if (room < NFL_RECORD_OVERHEAD) {
+            room = NFL_RECORD_OVERHEAD;
+        }
+        *out_avail_size = (room - NFL_RECORD_OVERHEAD) * WHFU_BYTES_PER_UNIT;
+    }
+    if (out_avail_objects != NULL) {
+        *out_avail_objects =
+                (whNvmId)(WOLFHSM_NUM_NVMOBJECTS - nflEntry_LiveCount(context));
+    }
+    if (out_reclaim_size != NULL) {
+        for (sector = 0; sector < context->sector_count; sector++) {
+            garbage += context->sectors[sector].garbage;
+        }
+        *out_reclaim_size = garbage * WHFU_BYTES_PER_UNIT;
+    }
+    if (out_reclaim_objects != NULL) {
+        /* Superseded records and the tombstones hiding them */
+        for (i = 0; i < NFL_ENTRY_COUNT; i++) {
+            reclaim_objects += context->entries[i].stale;
+            if (context->entries[i].status == NFL_ENTRY_TOMB) {
+                reclaim_objects++;
+            }
+        }
+        *out_reclaim_objects = (whNvmId)reclaim_objects;
+    }
+    return 0;
+}
+
+int wh_NvmFlashLog_GetMetadata(void* c, whNvmId id, whNvmMetadata* meta)
+{
+    whNvmFlashLogContext* context = c;
+    const nflEntry* entry = NULL;
+
+    if (context == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    entry = nflEntry_Find(context, id);
+    if ((entry == NULL) || (entry->status != NFL_ENTRY_LIVE)) {
+        return WH_ERROR_NOTFOUND;
+    }
+    if (meta != NULL) {
+        memcpy(meta, &entry->metadata, sizeof(*meta));
+    }
+    return 0;
+}
+
+/* Append a new record for meta->id.  Reclaim only runs when the log would
+ * otherwise be left without a spare sector */
+int wh_NvmFlashLog_AddObject(void* c, whNvmMetadata *meta,
+        whNvmSize data_len, const uint8_t* data)
+{
+    whNvmFlashLogContext* context = c;
+    nflEntry* entry = NULL;
+    int ret = 0;
+    uint32_t epoch = 0;
+    uint16_t sector = 0;
+    uint32_t unit = 0;
+
+    if (    (context == NULL) ||
+            (meta == NULL) ||
+            ((data_len > 0) && (data == NULL)) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    entry = nflEntry_Find(context, meta->id);
+    if (    ((entry == NULL) || (entry->status != NFL_ENTRY_LIVE)) &&
+            (nflEntry_LiveCount(context) >= WOLFHSM_NUM_NVMOBJECTS)) {
+        return WH_ERROR_NOSPACE;
+    }
+
+    ret = nflLog_Reserve(context, NFL_RECORD_UNITS(data_len));
+    if (ret != 0) {
+        return ret;
+    }
+
+    /* A reclaim may have dropped a tombstone for this id */
+    entry = nflEntry_Find(context, meta->id);
+    if (entry != NULL) {
+        epoch = entry->epoch + 1;
+    } else {
+        entry = nflEntry_Alloc(context);
+        if (entry == NULL) {
+            return WH_ERROR_NOSPACE;
+        }
+    }
+
+    /* Update meta with data size */
+    meta->len = data_len;
+
+    ret = nflRecord_Begin(context, epoch, 0, meta, &sector, &unit);
+    if ((ret == 0) && (data_len > 0)) {
+        ret = wh_FlashUnit_ProgramBytes(context->cb, context->flash,
+                (nflSector_Offset(context, sector) + unit +
+                    NFL_RECORD_DATA_UNIT) * WHFU_BYTES_PER_UNIT,
+                data_len, data);
+    }
+    if (ret == 0) {
+        ret = nflRecord_Finish(context, sector, unit, epoch, data_len);
+    }
+
+    if (ret == 0) {
+        if (entry->status != NFL_ENTRY_FREE) {
+            nflEntry_Supersede(context, entry);
+        }
+        memcpy(&entry->metadata, meta, sizeof(*meta));
+        entry->epoch = epoch;
+        entry->sector = sector;
+        entry->unit = unit;
+        entry->status = NFL_ENTRY_LIVE;
+    }
+    return ret;
+}
+
+/* Destroy a list of objects by appending a tombstone for each one present.
+ * An empty list compacts instead.  Id's in the list that are not present do
+ * not cause an error */
+int wh_NvmFlashLog_DestroyObjects(void* c, whNvmId list_count,
+        const whNvmId* id_list)
+{
+    whNvmFlashLogContext* context = c;
+    nflEntry* entry = NULL;
+    whNvmMetadata meta = {0};
+    int ret = 0;
+    int list_entry = 0;
+    uint32_t epoch = 0;
+    uint16_t sector = 0;
+    uint32_t unit = 0;
+
+    if (    (context == NULL) ||
+            ((list_count > 0) && (id_list == NULL)) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    /* An empty list is an explicit request to compact */
+    if (list_count == 0) {
+        return wh_NvmFlashLog_Compact(context);
+    }
+
+    for (list_entry = 0; (ret == 0) && (list_entry < list_count);
+            list_entry++) {
+        entry = nflEntry_Find(context, id_list[list_entry]);
+        if ((entry == NULL) || (entry->status != NFL_ENTRY_LIVE)) {
+            continue;
+        }
+
+        ret = nflLog_Reserve(context, NFL_RECORD_UNITS(0));
+        if (ret == 0) {
+            memcpy(&meta, &entry->metadata, sizeof(meta));
+            meta.len = 0;
+            epoch = entry->epoch + 1;
+            ret = nflRecord_Begin(context, epoch, NFL_RECORD_TOMBSTONE, &meta,
+                    &sector, &unit);
+        }
+        if (ret == 0) {
+            ret = nflRecord_Finish(context, sector, unit, epoch, 0);
+        }
+        if (ret == 0) {
+            nflEntry_Supersede(context, entry);
+            memcpy(&entry->metadata, &meta, sizeof(meta));
+            entry->epoch = epoch;
+            entry->sector = sector;
+            entry->unit = unit;
+            entry->status = NFL_ENTRY_TOMB;
+        }
+    }
+    return ret;
+}
+
+/* Reclaim every closed sector holding garbage, one sector at a time */
+int wh_NvmFlashLog_Compact(void* c)
+{
+    whNvmFlashLogContext* context = c;
+    int ret = 0;
+    int victim = 0;
+    int count = 0;
+
+    if (context == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    for (count = 0; (ret == 0) && (count < context->sector_count); count++) {
+        victim = nflSector_Victim(context);
+        if (victim < 0) {
+            break;
+        }
+        ret = nflSector_Reclaim(context, (uint16_t)victim);
+    }
+    return ret;
+}
+
+/* Read the data of the object starting at the byte offset */
+int wh_NvmFlashLog_Read(void* c, whNvmId id, whNvmSize offset,
+        whNvmSize data_len, uint8_t* data)
+{
+    whNvmFlashLogContext* context = c;
+    const nflEntry* entry = NULL;
+
+    if (    (context == NULL) ||
+            ((data_len > 0) && (data == NULL)) ){
+        return WH_ERROR_BADARGS;
+    }
+
+    entry = nflEntry_Find(context, id);
+    if ((entry == NULL) || (entry->status != NFL_ENTRY_LIVE)) {
+        return WH_ERROR_NOTFOUND;
+    }
+    if ((uint32_t)offset + data_len > entry->metadata.len) {
+        return WH_ERROR_BADARGS;
+    }
+
+    return wh_FlashUnit_ReadBytes(context->cb, context->flash,
+            (nflSector_Offset(context, entry->sector) + entry->unit +
+                NFL_RECORD_DATA_UNIT) * WHFU_BYTES_PER_UNIT + offset,
+            data_len, data);
+}
@@ -32,40 +32,108 @@
 #include "wolfhsm/wh_message.h"
 #include "wolfhsm/wh_message_comm.h"
 #include "wolfhsm/wh_message_nvm.h"
+#include "wolfhsm/wh_message_counter.h"
 #include "wolfhsm/wh_packet.h"
 
 /* Server API's */
 #include "wolfhsm/wh_server.h"
 #include "wolfhsm/wh_server_nvm.h"
+#include "wolfhsm/wh_server_counter.h"
 #include "wolfhsm/wh_server_crypto.h"
 #include "wolfhsm/wh_server_keystore.h"
+#include "wolfhsm/wh_server_job.h"
+#include "wolfhsm/wh_server_stats.h"
 #if defined(WOLFHSM_SHE_EXTENSION)
 #include "wolfhsm/wh_server_she.h"
 #endif
 
 /** Forward declarations. */
 /* TODO: Move these out to separate C files */
+#ifndef WOLFHSM_SERVER_NO_GROUP_PKCS11
 static int _wh_Server_HandlePkcs11Request(whServerContext* server,
         uint16_t magic, uint16_t action, uint16_t seq,
         uint16_t req_size, const void* req_packet,
         uint16_t *out_resp_size, void* resp_packet);
+#endif
+static int _wh_Server_HandleCommBatch(whServerContext* server,
+        uint16_t magic, uint16_t seq,
+        uint16_t req_size, const void* req_packet,
+        uint16_t* out_resp_size, void* resp_packet);
+static int _wh_Server_HandleCommRequest(whServerContext* server,
+        uint16_t magic, uint16_t action, uint16_t seq,
+        uint16_t req_size, const void* req_packet,
+        uint16_t* out_resp_size, void* resp_packet);
+#ifndef WOLFHSM_SERVER_NO_GROUP_KEY
+static int _wh_Server_HandleKeyGroup(whServerContext* server,
+        uint16_t magic, uint16_t action, uint16_t seq,
+        uint16_t req_size, const void* req_packet,
+        uint16_t* out_resp_size, void* resp_packet);
+#endif
+#ifndef WOLFHSM_NO_CRYPTO
+#ifndef WOLFHSM_SERVER_NO_GROUP_CRYPTO
+static int _wh_Server_HandleCryptoGroup(whServerContext* server,
+        uint16_t magic, uint16_t action, uint16_t seq,
+        uint16_t req_size, const void* req_packet,
+        uint16_t* out_resp_size, void* resp_packet);
+#endif
+#ifndef WOLFHSM_SERVER_NO_GROUP_IMAGE
+static int _wh_Server_HandleImageGroup(whServerContext* server,
+        uint16_t magic, uint16_t action, uint16_t seq,
+        uint16_t req_size, const void* req_packet,
+        uint16_t* out_resp_size, void* resp_packet);
+#endif
+#if defined(WOLFHSM_SHE_EXTENSION) && !defined(WOLFHSM_SERVER_NO_GROUP_SHE)
+static int _wh_Server_HandleSheGroup(whServerContext* server,
+        uint16_t magic, uint16_t action, uint16_t seq,
+        uint16_t req_size, const void* req_packet,
+        uint16_t* out_resp_size, void* resp_packet);
+#endif
+#endif  /* WOLFHSM_NO_CRYPTO */
+static void _wh_Server_InitHandlers(whServerContext* server);
+static int _wh_Server_DispatchRequest(whServerContext* server,
+        uint16_t magic, uint16_t kind, uint16_t seq,
+        uint16_t* inout_size, uint8_t* data);
+static int _wh_Server_SetEndpointConnectedCb(void* e,
+        whCommConnected connected);
+static int _wh_Server_HandleEndpoint(whServerContext* server,
+        whServerEndpoint* ep);
 
 int wh_Server_Init(whServerContext* server, whServerConfig* config)
 {
     int rc = 0;
+    const whCommServerConfig* comm_config[WOLFHSM_SERVER_MAX_COMMS];
+    uint16_t count = 0;
+    uint16_t i = 0;
 
     if ((server == NULL) || (config == NULL)) {
         return WH_ERROR_BADARGS;
     }
 
+    count = (config->comm_count != 0) ? config->comm_count : 1;
+    if (count > WOLFHSM_SERVER_MAX_COMMS) {
+        return WH_ERROR_BADARGS;
+    }
+
     memset(server, 0, sizeof(*server));
     server->nvm = config->nvm;
+    server->counter = config->counter;
+    _wh_Server_InitHandlers(server);
 
 #ifndef WOLFHSM_NO_CRYPTO
     server->crypto = config->crypto;
     if (server->crypto != NULL) {
+        server->crypto->engineCount = 0;
+        server->crypto->engineNext = 0;
+        server->crypto->engines = NULL;
 #if defined(WOLF_CRYPTO_CB)
         server->crypto->devId = config->devId;
+        if (config->engine_count > 0) {
+            if (config->engines == NULL) {
+                return WH_ERROR_BADARGS;
+            }
+            server->crypto->engines = config->engines;
+            server->crypto->engineCount = config->engine_count;
+        }
 #else
         server->crypto->devId = INVALID_DEVID;
 #endif
@@ -73,20 +141,65 @@ int wh_Server_Init(whServerContext* server, whServerConfig* config)
 #ifdef WOLFHSM_SHE_EXTENSION
     server->she = config->she;
 #endif
+    /* Record the key ids already in NVM.  A failure here only costs a
+     * rebuild at the first key id allocation */
+    (void)hsmKeyIdMapBuild(server);
+    /* Have the hot keys resident before the first request.  Keys that fail
+     * to load are still read on first use */
+    (void)hsmPreloadKeys(server, config->preload_count, config->preload_keys);
+    /* Quotas apply to requests, preloaded keys are placed before them */
+    server->keyQuota = config->key_quota;
 #endif
 
-    rc = wh_CommServer_Init(server->comm, config->comm_config,
-            wh_Server_SetConnectedCb, (void*)server);
-    if (rc != 0) {
-        (void)wh_Server_Cleanup(server);
-        return WH_ERROR_ABORTED;
+    /* Insert each endpoint behind those of equal or higher priority */
+    for (i = 0; i < count; i++) {
+        uint8_t priority = 0;
+        uint16_t pos = i;
+
+        if (config->comm_priority != NULL) {
+            priority = config->comm_priority[i];
+        }
+        while ((pos > 0) && (server->endpoint[pos - 1].priority < priority)) {
+            server->endpoint[pos].priority = server->endpoint[pos - 1].priority;
+            comm_config[pos] = comm_config[pos - 1];
+            pos--;
+        }
+        server->endpoint[pos].priority = priority;
+        comm_config[pos] = (config->comm_config != NULL) ?
+                &config->comm_config[i] : NULL;
+    }
+
+    for (i = 0; i < count; i++) {
+        whServerEndpoint* ep = &server->endpoint[i];
+
+        ep->server = server;
+        server->endpoint_count++;
+        rc = wh_CommServer_Init(ep->comm, comm_config[i],
+                _wh_Server_SetEndpointConnectedCb, (void*)ep);
+        if (rc != 0) {
+            (void)wh_Server_Cleanup(server);
+            return WH_ERROR_ABORTED;
+        }
     }
+    server->comm = server->endpoint[0].comm;
+
+#ifdef WOLFHSM_SERVER_STATS
+    server->time_cb = config->time_cb;
+    server->time_context = config->time_context;
+#endif
 
     /* Initialize DMA configuration and callbacks, if provided */
     if (NULL != config->dmaConfig) {
-        server->dma.dmaAddrAllowList = config->dmaConfig->dmaAddrAllowList;
         server->dma.cb32             = config->dmaConfig->cb32;
         server->dma.cb64             = config->dmaConfig->cb64;
+        if (NULL != config->dmaConfig->dmaAddrAllowList) {
+            rc = wh_Server_DmaRegisterAllowList(server,
+                    config->dmaConfig->dmaAddrAllowList);
+            if (rc != 0) {
+                (void)wh_Server_Cleanup(server);
+                return rc;
+            }
+        }
     }
 
     return rc;
@@ -94,11 +207,38 @@ int wh_Server_Init(whServerContext* server, whServerConfig* config)
 
 int wh_Server_Cleanup(whServerContext* server)
 {
+    uint16_t i = 0;
+
     if (server ==NULL) {
         return WH_ERROR_BADARGS;
     }
 
-    (void)wh_CommServer_Cleanup(server->comm);
+    /* Process the POST operations of buffers clients left mapped */
+    wh_Server_DmaUnmapAll(server);
+
+    for (i = 0; i < server->endpoint_count; i++) {
+        (void)wh_CommServer_Cleanup(server->endpoint[i].comm);
+    }
+
+    if (server->nvm_stream_owner != 0) {
+        /* Nobody is left to finish an open NVM stream */
+        (void)wh_Nvm_AddObjectFinish(server->nvm, 0);
+    }
+
+#if !defined(WOLFHSM_NO_CRYPTO) && WOLFHSM_NUM_DECODED_KEYS > 0
+    hsmDecodedKeyFlush(server);
+#endif
+#if !defined(WOLFHSM_NO_CRYPTO) && !defined(NO_AES) && \
+    WOLFHSM_SERVER_MAX_CIPHER_SESSIONS > 0
+    wh_Server_CipherSessionFlush(server);
+#endif
+#if !defined(WOLFHSM_NO_CRYPTO) && WOLFHSM_SERVER_MAX_HASH_SESSIONS > 0
+    wh_Server_HashSessionFlush(server);
+#endif
+#ifdef WOLFHSM_SHE_EXTENSION
+    wh_Server_SheCipherFlush(server);
+    wh_Server_SheCacheFlush(server);
+#endif
 
     memset(server, 0, sizeof(*server));
 
@@ -107,11 +247,16 @@ int wh_Server_Cleanup(whServerContext* server)
 
 int wh_Server_SetConnected(whServerContext *server, whCommConnected connected)
 {
+    uint16_t i = 0;
+
     if (server == NULL) {
         return WH_ERROR_BADARGS;
     }
 
-    server->connected = connected;
+    for (i = 0; i < server->endpoint_count; i++) {
+        (void)_wh_Server_SetEndpointConnectedCb(&server->endpoint[i],
+                connected);
+    }
     return WH_ERROR_OK;
 }
 
@@ -120,6 +265,26 @@ int wh_Server_SetConnectedCb(void* s, whCommConnected connected)
     return wh_Server_SetConnected((whServerContext*)s, connected);
 }
 
+static int _wh_Server_SetEndpointConnectedCb(void* e,
+        whCommConnected connected)
+{
+    whServerEndpoint* ep = (whServerEndpoint*)e;
+
+    if (ep == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    ep->connected = connected;
+    if (    (connected == WH_COMM_DISCONNECTED) &&
+            (ep->server != NULL)) {
+        /* A client that went away can no longer finish its NVM stream or
+         * unmap its buffers, and the next one must not inherit them */
+        wh_Server_NvmStreamAbort(ep->server, ep->comm->client_id);
+        wh_Server_DmaUnmapClient(ep->server, ep->comm->client_id);
+    }
+    return WH_ERROR_OK;
+}
+
 int wh_Server_GetConnected(whServerContext *server,
                             whCommConnected *out_connected)
 {
@@ -128,7 +293,13 @@ int wh_Server_GetConnected(whServerContext *server,
     }
 
     if (out_connected != NULL) {
-        *out_connected = server->connected;
+        uint16_t i = 0;
+        *out_connected = WH_COMM_DISCONNECTED;
+        for (i = 0; i < server->endpoint_count; i++) {
+            if (server->endpoint[i].connected == WH_COMM_CONNECTED) {
+                *out_connected = WH_COMM_CONNECTED;
+            }
+        }
     }
     return WH_ERROR_OK;
 }
@@ -163,9 +334,15 @@ static int _wh_Server_HandleCommRequest(whServerContext* server,
 
     case WH_MESSAGE_COMM_ACTION_CLOSE:
     {
+        uint16_t i = 0;
         /* No message */
-        /* Process the close action */
-        wh_Server_SetConnected(server, WH_COMM_DISCONNECTED);
+        /* Process the close action on the requesting endpoint only */
+        for (i = 0; i < server->endpoint_count; i++) {
+            if (server->endpoint[i].comm == server->comm) {
+                (void)_wh_Server_SetEndpointConnectedCb(&server->endpoint[i],
+                        WH_COMM_DISCONNECTED);
+            }
+        }
         *out_resp_size = 0;
     }; break;
 
@@ -189,6 +366,76 @@ static int _wh_Server_HandleCommRequest(whServerContext* server,
         *out_resp_size = sizeof(resp);
     }; break;
 
+    case WH_MESSAGE_COMM_ACTION_BATCH:
+    {
+        rc = _wh_Server_HandleCommBatch(server, magic, seq,
+                req_size, req_packet, out_resp_size, resp_packet);
+    }; break;
+
+    case WH_MESSAGE_COMM_ACTION_DMAMAP:
+    {
+        whMessageCommDmaMapRequest req = {0};
+        whMessageCommDmaMapResponse resp = {0};
+
+        if (req_size == sizeof(req)) {
+            /* Convert request struct */
+            wh_MessageComm_TranslateDmaMapRequest(magic,
+                    (whMessageCommDmaMapRequest*)req_packet, &req);
+
+            /* Process the map action */
+            resp.rc = wh_Server_DmaMapClientAddress(server,
+                    req.addr, req.len, req.access, &resp.handle);
+        } else {
+            /* Request is malformed */
+            resp.rc = WH_ERROR_ABORTED;
+        }
+
+        /* Convert the response struct */
+        wh_MessageComm_TranslateDmaMapResponse(magic,
+                &resp, (whMessageCommDmaMapResponse*)resp_packet);
+        *out_resp_size = sizeof(resp);
+    }; break;
+
+    case WH_MESSAGE_COMM_ACTION_DMAUNMAP:
+    {
+        whMessageCommDmaUnmapRequest req = {0};
+        whMessageCommDmaMapResponse resp = {0};
+
+        if (req_size == sizeof(req)) {
+            /* Convert request struct */
+            wh_MessageComm_TranslateDmaUnmapRequest(magic,
+                    (whMessageCommDmaUnmapRequest*)req_packet, &req);
+
+            /* Process the unmap action */
+            resp.handle = req.handle;
+            resp.rc = wh_Server_DmaUnmapClientAddress(server, req.handle);
+        } else {
+            /* Request is malformed */
+            resp.rc = WH_ERROR_ABORTED;
+        }
+
+        /* Convert the response struct */
+        wh_MessageComm_TranslateDmaMapResponse(magic,
+                &resp, (whMessageCommDmaMapResponse*)resp_packet);
+        *out_resp_size = sizeof(resp);
+    }; break;
+
+#ifdef WOLFHSM_SERVER_STATS
+    case WH_MESSAGE_COMM_ACTION_STATS:
+    {
+        rc = wh_Server_HandleStatsRequest(server, magic,
+                req_size, req_packet, out_resp_size, resp_packet);
+    }; break;
+#endif
+
+#if WOLFHSM_SERVER_MAX_JOBS > 0
+    case WH_MESSAGE_COMM_ACTION_JOB:
+    {
+        rc = wh_Server_HandleJobRequest(server, magic,
+                req_size, req_packet, out_resp_size, resp_packet);
+    }; break;
+#endif
+
     default:
         /* Unknown request. Respond with empty packet */
         *out_resp_size = 0;
@@ -196,6 +443,76 @@ static int _wh_Server_HandleCommRequest(whServerContext* server,
     return rc;
 }
 
+static int _wh_Server_HandleCommBatch(whServerContext* server,
+        uint16_t magic, uint16_t seq,
+        uint16_t req_size, const void* req_packet,
+        uint16_t* out_resp_size, void* resp_packet)
+{
+    /* Sub-messages are handled in place, so give each a full buffer */
+    uint64_t work[WH_COMM_DATA_LEN / sizeof(uint64_t)];
+    uint8_t* buffer = (uint8_t*)resp_packet;
+    const whMessageCommBatchHeader* req_hdr =
+            (const whMessageCommBatchHeader*)req_packet;
+    uint16_t batch_size = 0;
+    uint16_t in_base = 0;
+    uint16_t in_offset = 0;
+    uint16_t kind = 0;
+    uint16_t len = 0;
+    const void* sub_req = NULL;
+    int rc = 0;
+
+    if (    (req_size < sizeof(*req_hdr)) ||
+            (req_size > WH_COMM_DATA_LEN)) {
+        *out_resp_size = 0;
+        return 0;
+    }
+    batch_size = sizeof(*req_hdr) + wh_Translate16(magic, req_hdr->len);
+    if (batch_size > req_size) {
+        /* Request is malformed */
+        *out_resp_size = 0;
+        return 0;
+    }
+
+    /* Move the request to the end of the buffer so responses can be packed
+     * from the front.  Each request entry is copied out before its space is
+     * reused, and an empty response entry always fits in that space. */
+    in_base = WH_COMM_DATA_LEN - batch_size;
+    memmove(buffer + in_base, req_packet, batch_size);
+    (void)wh_MessageComm_BatchInit(buffer, WH_COMM_DATA_LEN);
+
+    while (wh_MessageComm_BatchNext(magic, buffer + in_base, batch_size,
+            &in_offset, &kind, NULL, &len, &sub_req) == 0) {
+        if (len > sizeof(work)) {
+            len = 0;
+            rc = WH_ERROR_BADARGS;
+        } else if (kind == WH_MESSAGE_KIND(WH_MESSAGE_GROUP_COMM,
+                                          WH_MESSAGE_COMM_ACTION_BATCH)) {
+            /* No nested batches */
+            len = 0;
+            rc = WH_ERROR_BADARGS;
+        } else {
+            memcpy(work, sub_req, len);
+            rc = _wh_Server_DispatchRequest(server, magic, kind, seq,
+                    &len, (uint8_t*)work);
+            if (rc != 0) {
+                len = 0;
+            }
+        }
+
+        /* Space up to the next unconsumed request entry is free */
+        if (wh_MessageComm_BatchAppend(magic, buffer, in_base + in_offset,
+                kind, rc, len, work) != 0) {
+            (void)wh_MessageComm_BatchAppend(magic, buffer,
+                    in_base + in_offset, kind, WH_ERROR_NOSPACE, 0, NULL);
+        }
+    }
+
+    *out_resp_size = sizeof(whMessageCommBatchHeader) +
+            wh_Translate16(magic, ((whMessageCommBatchHeader*)buffer)->len);
+    return 0;
+}
+
+#ifndef WOLFHSM_SERVER_NO_GROUP_PKCS11
 static int _wh_Server_HandlePkcs11Request(whServerContext* server,
         uint16_t magic, uint16_t action, uint16_t seq,
         uint16_t req_size, const void* req_packet,
@@ -210,91 +527,336 @@ static int _wh_Server_HandlePkcs11Request(whServerContext* server,
     }
     return rc;
 }
+#endif
 
-int wh_Server_HandleRequestMessage(whServerContext* server)
+static int _wh_Server_HandleEndpoint(whServerContext* server,
+        whServerEndpoint* ep)
 {
     uint16_t magic = 0;
     uint16_t kind = 0;
-    uint16_t group = 0;
-    uint16_t action = 0;
     uint16_t seq = 0;
     uint16_t size = 0;
     uint8_t* data = NULL;
-
-    if (server == NULL) {
-        return WH_ERROR_BADARGS;
-    }
+    int rc = 0;
 
     /* Use the CommServer internal buffer to avoid copies */
-    data = wh_CommServer_GetDataPtr(server->comm);
+    data = wh_CommServer_GetDataPtr(ep->comm);
 
     /* Are we connected with a valid data pointer? */
-    if (    (server->connected == WH_COMM_DISCONNECTED) ||
+    if (    (ep->connected == WH_COMM_DISCONNECTED) ||
             (data == NULL) ) {
         return WH_ERROR_NOTREADY;
     }
 
-    int rc = wh_CommServer_RecvRequest(server->comm, &magic, &kind, &seq,
-            &size, data);
+    /* Handlers act on behalf of the client bound to this endpoint */
+    server->comm = ep->comm;
+
+    /* Fragmented requests are dispatched from the reassembly buffer */
+    rc = wh_CommServer_RecvRequestFrag(server->comm, &magic, &kind, &seq,
+            &size, &data);
     /* Got a packet? */
     if (rc == 0) {
-        group = WH_MESSAGE_GROUP(kind);
-        action = WH_MESSAGE_ACTION(kind);
-        switch (group) {
+#ifdef WOLFHSM_SERVER_STATS
+        uint16_t req_size = size;
+        uint64_t start = wh_Server_StatsTime(server);
+#endif
+        rc = _wh_Server_DispatchRequest(server, magic, kind, seq, &size, data);
+#ifdef WOLFHSM_SERVER_STATS
+        wh_Server_StatsRecord(server, kind, req_size, (rc == 0) ? size : 0,
+                wh_Server_StatsTime(server) - start);
+#endif
+
+        /* Send a response */
+        /* TODO: Respond with ErrorResponse if handler returns an error */
+        if (rc == 0) {
+            do {
+                rc = wh_CommServer_SendResponse(server->comm, magic, kind, seq,
+                    size, data);
+            } while (rc == WH_ERROR_NOTREADY);
+        }
+    }
+    return rc;
+}
+
+int wh_Server_HandleRequestMessage(whServerContext* server)
+{
+    int rc = WH_ERROR_NOTREADY;
+    uint16_t first = 0;
+    uint16_t end = 0;
+    uint16_t i = 0;
+
+    if (server == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    /* Walk each priority group, starting after its last served endpoint */
+    for (first = 0; first < server->endpoint_count; first = end) {
+        whServerEndpoint* group = &server->endpoint[first];
+        uint16_t n = 0;
 
-        case WH_MESSAGE_GROUP_COMM:
-            rc = _wh_Server_HandleCommRequest(server, magic, action, seq,
-                    size, data, &size, data);
-        break;
+        end = first + 1;
+        while (     (end < server->endpoint_count) &&
+                    (server->endpoint[end].priority == group->priority)) {
+            end++;
+        }
+        n = end - first;
+
+        for (i = 0; i < n; i++) {
+            uint16_t index = (group->next + i) % n;
+            rc = _wh_Server_HandleEndpoint(server,
+                    &server->endpoint[first + index]);
+            if (rc != WH_ERROR_NOTREADY) {
+                group->next = (index + 1) % n;
+                break;
+            }
+        }
+        if (rc != WH_ERROR_NOTREADY) {
+            break;
+        }
+    }
 
-        case WH_MESSAGE_GROUP_NVM:
-            rc = wh_Server_HandleNvmRequest(server, magic, action, seq,
-                    size, data, &size, data);
-        break;
+#if WOLFHSM_SERVER_MAX_JOBS > 0
+    /* Advance a job slice unless the request failed */
+    if (    (rc == WH_ERROR_OK) ||
+            (rc == WH_ERROR_NOTREADY)) {
+        if (wh_Server_JobStep(server) == WH_ERROR_OK) {
+            rc = WH_ERROR_OK;
+        }
+    }
+#endif
+    /* Nothing else to do, advance any background NVM compaction */
+    if (rc == WH_ERROR_NOTREADY && server->nvm != NULL) {
+        (void)wh_Nvm_CompactStep(server->nvm);
+    }
+#if !defined(WOLFHSM_NO_CRYPTO) && !defined(WC_NO_RNG) && \
+    WOLFHSM_SERVER_RNG_POOL_SIZE > 0
+    /* Nothing else to do, top up the random pool */
+    if (rc == WH_ERROR_NOTREADY && server->crypto != NULL) {
+        (void)wh_Server_CryptoRngPoolRefill(server);
+    }
+#endif
+    return rc;
+}
 
+static void _wh_Server_InitHandlers(whServerContext* server)
+{
+    server->handler[WH_MESSAGE_GROUP_INDEX(WH_MESSAGE_GROUP_COMM)] =
+            _wh_Server_HandleCommRequest;
+#ifndef WOLFHSM_SERVER_NO_GROUP_NVM
+    server->handler[WH_MESSAGE_GROUP_INDEX(WH_MESSAGE_GROUP_NVM)] =
+            wh_Server_HandleNvmRequest;
+#endif
+#ifndef WOLFHSM_SERVER_NO_GROUP_KEY
+    server->handler[WH_MESSAGE_GROUP_INDEX(WH_MESSAGE_GROUP_KEY)] =
+            _wh_Server_HandleKeyGroup;
+#endif
 #ifndef WOLFHSM_NO_CRYPTO
-        case WH_MESSAGE_GROUP_KEY:
-            rc = wh_Server_HandleKeyRequest(server, magic, action, seq,
-                    data, &size);
-        break;
-
-        case WH_MESSAGE_GROUP_CRYPTO:
-            rc = wh_Server_HandleCryptoRequest(server, action, data,
-                &size);
-        break;
+#ifndef WOLFHSM_SERVER_NO_GROUP_CRYPTO
+    server->handler[WH_MESSAGE_GROUP_INDEX(WH_MESSAGE_GROUP_CRYPTO)] =
+            _wh_Server_HandleCryptoGroup;
+#endif
+#ifndef WOLFHSM_SERVER_NO_GROUP_IMAGE
+    server->handler[WH_MESSAGE_GROUP_INDEX(WH_MESSAGE_GROUP_IMAGE)] =
+            _wh_Server_HandleImageGroup;
+#endif
+#if defined(WOLFHSM_SHE_EXTENSION) && !defined(WOLFHSM_SERVER_NO_GROUP_SHE)
+    server->handler[WH_MESSAGE_GROUP_INDEX(WH_MESSAGE_GROUP_SHE)] =
+            _wh_Server_HandleSheGroup;
+#endif
 #endif  /* WOLFHSM_NO_CRYPTO */
+#ifndef WOLFHSM_SERVER_NO_GROUP_PKCS11
+    server->handler[WH_MESSAGE_GROUP_INDEX(WH_MESSAGE_GROUP_PKCS11)] =
+            _wh_Server_HandlePkcs11Request;
+#endif
+#ifndef WOLFHSM_SERVER_NO_GROUP_CUSTOM
+    server->handler[WH_MESSAGE_GROUP_INDEX(WH_MESSAGE_GROUP_CUSTOM)] =
+            wh_Server_HandleCustomCbRequest;
+#endif
+}
 
-        case WH_MESSAGE_GROUP_PKCS11:
-            rc = _wh_Server_HandlePkcs11Request(server, magic, action, seq,
-                    size, data, &size, data);
-        break;
+int wh_Server_RegisterGroupHandler(whServerContext* server, uint16_t group,
+        whServerHandlerCb cb)
+{
+    uint16_t index = WH_MESSAGE_GROUP_INDEX(group);
 
-#ifdef WOLFHSM_SHE_EXTENSION
-        case WH_MESSAGE_GROUP_SHE:
-            rc = wh_Server_HandleSheRequest(server, action, data,
-                &size);
-        break;
-#endif
+    if (    (server == NULL) ||
+            (group == WH_MESSAGE_GROUP_NONE) ||
+            (index >= WH_SERVER_GROUP_COUNT)) {
+        return WH_ERROR_BADARGS;
+    }
 
-        case WH_MESSAGE_GROUP_CUSTOM:
-            rc = wh_Server_HandleCustomCbRequest(server, magic, action, seq,
-                    size, data, &size, data);
-        break;
+    server->handler[index] = cb;
+    return WH_ERROR_OK;
+}
+
+int wh_Server_RegisterHandler(whServerContext* server, uint16_t kind,
+        whServerHandlerCb cb)
+{
+#if WOLFHSM_SERVER_MAX_HANDLERS > 0
+    uint16_t index = WH_MESSAGE_GROUP_INDEX(kind);
+    whServerHandler* entry = NULL;
+    int found = 0;
+    int i = 0;
+
+    if (    (server == NULL) ||
+            (WH_MESSAGE_GROUP(kind) == WH_MESSAGE_GROUP_NONE) ||
+            (index >= WH_SERVER_GROUP_COUNT)) {
+        return WH_ERROR_BADARGS;
+    }
 
-        default:
-            /* Unknown group. Return empty packet*/
-            /* TODO: Respond with aux error flag */
-            size = 0;
+    for (i = 0; i < WOLFHSM_SERVER_MAX_HANDLERS; i++) {
+        whServerHandler* e = &server->override[i];
+        if ((e->cb != NULL) && (e->kind == kind)) {
+            entry = e;
+            break;
+        }
+        if ((e->cb == NULL) && (entry == NULL)) {
+            entry = e;
         }
+    }
 
-        /* Send a response */
-        /* TODO: Respond with ErrorResponse if handler returns an error */
-        if (rc == 0) {
-            do {
-                rc = wh_CommServer_SendResponse(server->comm, magic, kind, seq,
-                    size, data);
-            } while (rc == WH_ERROR_NOTREADY);
+    if (cb == NULL) {
+        /* Remove the override, if any */
+        if ((entry != NULL) && (entry->cb != NULL) && (entry->kind == kind)) {
+            memset(entry, 0, sizeof(*entry));
+        }
+    } else {
+        if (entry == NULL) {
+            return WH_ERROR_NOSPACE;
+        }
+        entry->kind = kind;
+        entry->cb = cb;
+    }
+
+    /* Recompute whether this group still has overrides */
+    for (i = 0; i < WOLFHSM_SERVER_MAX_HANDLERS; i++) {
+        if (    (server->override[i].cb != NULL) &&
+                (WH_MESSAGE_GROUP_INDEX(server->override[i].kind) == index)) {
+            found = 1;
+        }
+    }
+    if (found) {
+        server->override_groups |= (1ul << index);
+    } else {
+        server->override_groups &= ~(1ul << index);
+    }
+    return WH_ERROR_OK;
+#else
+    (void)server;
+    (void)kind;
+    (void)cb;
+    return WH_ERROR_NOSPACE;
+#endif
+}
+
+#ifndef WOLFHSM_SERVER_NO_GROUP_KEY
+/* Counters take the actions past the keystore ones */
+static int _wh_Server_HandleKeyGroup(whServerContext* server,
+        uint16_t magic, uint16_t action, uint16_t seq,
+        uint16_t req_size, const void* req_packet,
+        uint16_t* out_resp_size, void* resp_packet)
+{
+    if (action >= WH_MESSAGE_COUNTER_ACTION_READ) {
+        return wh_Server_HandleCounterRequest(server, magic, action, seq,
+                req_size, req_packet, out_resp_size, resp_packet);
+    }
+#ifndef WOLFHSM_NO_CRYPTO
+    (void)req_packet;
+    *out_resp_size = req_size;
+    return wh_Server_HandleKeyRequest(server, magic, action, seq,
+            resp_packet, out_resp_size);
+#else
+    /* No keystore. Respond with empty packet */
+    (void)req_size;
+    *out_resp_size = 0;
+    return 0;
+#endif
+}
+#endif
+
+#ifndef WOLFHSM_NO_CRYPTO
+/* Adapters for handlers that process the packet in place */
+
+#ifndef WOLFHSM_SERVER_NO_GROUP_CRYPTO
+static int _wh_Server_HandleCryptoGroup(whServerContext* server,
+        uint16_t magic, uint16_t action, uint16_t seq,
+        uint16_t req_size, const void* req_packet,
+        uint16_t* out_resp_size, void* resp_packet)
+{
+    (void)magic;
+    (void)seq;
+    (void)req_packet;
+    *out_resp_size = req_size;
+    return wh_Server_HandleCryptoRequest(server, action, resp_packet,
+            out_resp_size);
+}
+#endif
+
+#ifndef WOLFHSM_SERVER_NO_GROUP_IMAGE
+static int _wh_Server_HandleImageGroup(whServerContext* server,
+        uint16_t magic, uint16_t action, uint16_t seq,
+        uint16_t req_size, const void* req_packet,
+        uint16_t* out_resp_size, void* resp_packet)
+{
+    (void)magic;
+    (void)seq;
+    (void)req_packet;
+    *out_resp_size = req_size;
+    return wh_Server_HandleImageRequest(server, action, resp_packet,
+            out_resp_size);
+}
+#endif
+
+#if defined(WOLFHSM_SHE_EXTENSION) && !defined(WOLFHSM_SERVER_NO_GROUP_SHE)
+static int _wh_Server_HandleSheGroup(whServerContext* server,
+        uint16_t magic, uint16_t action, uint16_t seq,
+        uint16_t req_size, const void* req_packet,
+        uint16_t* out_resp_size, void* resp_packet)
+{
+    (void)magic;
+    (void)seq;
+    (void)req_packet;
+    *out_resp_size = req_size;
+    return wh_Server_HandleSheRequest(server, action, resp_packet,
+            out_resp_size);
+}
+#endif
+#endif  /* WOLFHSM_NO_CRYPTO */
+
+static int _wh_Server_DispatchRequest(whServerContext* server,
+        uint16_t magic, uint16_t kind, uint16_t seq,
+        uint16_t* inout_size, uint8_t* data)
+{
+    int rc = 0;
+    uint16_t index = WH_MESSAGE_GROUP_INDEX(kind);
+    uint16_t size = *inout_size;
+    whServerHandlerCb cb = NULL;
+
+    if (index < WH_SERVER_GROUP_COUNT) {
+        cb = server->handler[index];
+#if WOLFHSM_SERVER_MAX_HANDLERS > 0
+        if ((server->override_groups & (1ul << index)) != 0) {
+            int i = 0;
+            for (i = 0; i < WOLFHSM_SERVER_MAX_HANDLERS; i++) {
+                if (    (server->override[i].cb != NULL) &&
+                        (server->override[i].kind == kind)) {
+                    cb = server->override[i].cb;
+                    break;
+                }
+            }
         }
+#endif
     }
+
+    if (cb != NULL) {
+        rc = cb(server, magic, WH_MESSAGE_ACTION(kind), seq,
+                size, data, &size, data);
+    } else {
+        /* Unknown group. Return empty packet*/
+        /* TODO: Respond with aux error flag */
+        size = 0;
+    }
+
+    *inout_size = size;
     return rc;
 }
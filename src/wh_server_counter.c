@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* System libraries */
+#include <stdint.h>
+#include <stdlib.h>  /* For NULL */
+
+/* Common WolfHSM types and defines shared with the server */
+#include "wolfhsm/wh_error.h"
+#include "wolfhsm/wh_comm.h"
+
+#include "wolfhsm/wh_counter.h"
+
+#include "wolfhsm/wh_message.h"
+#include "wolfhsm/wh_message_counter.h"
+#include "wolfhsm/wh_server.h"
+
+#include "wolfhsm/wh_server_counter.h"
+
+int wh_Server_HandleCounterRequest(whServerContext* server,
+        uint16_t magic, uint16_t action, uint16_t seq,
+        uint16_t req_size, const void* req_packet,
+        uint16_t *out_resp_size, void* resp_packet)
+{
+    whMessageCounter_Request req = {0};
+    whMessageCounter_Response resp = {0};
+
+    (void)seq;
+
+    if (    (server == NULL) ||
+            (req_packet == NULL) ||
+            (resp_packet == NULL) ||
+            (out_resp_size == NULL) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    if (    (action != WH_MESSAGE_COUNTER_ACTION_READ) &&
+            (action != WH_MESSAGE_COUNTER_ACTION_INCREMENT)) {
+        /* Unknown request. Respond with empty packet */
+        *out_resp_size = 0;
+        return 0;
+    }
+
+    if (req_size != sizeof(req)) {
+        /* Request is malformed */
+        resp.rc = WH_ERROR_ABORTED;
+    } else if (server->counter == NULL) {
+        /* No counter store configured */
+        resp.rc = WH_ERROR_NOTIMPL;
+    } else {
+        /* Convert request struct */
+        (void)wh_MessageCounter_TranslateRequest(magic,
+                (const whMessageCounter_Request*)req_packet, &req);
+        if (action == WH_MESSAGE_COUNTER_ACTION_READ) {
+            resp.rc = wh_Counter_Read(server->counter, req.id, &resp.value);
+        } else {
+            resp.rc = wh_Counter_Increment(server->counter, req.id,
+                    &resp.value);
+        }
+    }
+
+    /* Convert the response struct */
+    (void)wh_MessageCounter_TranslateResponse(magic,
+            &resp, (whMessageCounter_Response*)resp_packet);
+    *out_resp_size = sizeof(resp);
+    return 0;
+}
@@ -26,11 +26,43 @@
 #include "wolfssl/wolfcrypt/settings.h"
 #include "wolfssl/wolfcrypt/types.h"
 #include "wolfssl/wolfcrypt/error-crypt.h"
+#include "wolfssl/wolfcrypt/hash.h"
+#include "wolfssl/wolfcrypt/signature.h"
+#include "wolfssl/wolfcrypt/asn.h"
 
+#include "wolfhsm/wh_error.h"
+#include "wolfhsm/wh_message.h"
 #include "wolfhsm/wh_server.h"
 #include "wolfhsm/wh_server_keystore.h"
 #include "wolfhsm/wh_packet.h"
 #include "wolfhsm/wh_server_crypto.h"
+#include "wolfhsm/wh_server_job.h"
+
+int wh_Server_CryptoDevId(whServerContext* server, uint32_t cap)
+{
+    crypto_context* crypto;
+    const whServerCryptoEngine* engine;
+    uint16_t i;
+    uint16_t idx;
+    if (server == NULL || server->crypto == NULL)
+        return INVALID_DEVID;
+    crypto = server->crypto;
+    if (crypto->engineCount == 0)
+        return crypto->devId;
+    /* start after the engine used last so equal engines share the load */
+    for (i = 0; i < crypto->engineCount; i++) {
+        idx = (uint16_t)((crypto->engineNext + i) % crypto->engineCount);
+        engine = &crypto->engines[idx];
+        if (    ((engine->caps & cap) == cap) &&
+                ((engine->busy == NULL) ||
+                    (engine->busy(engine->busy_context) == 0))) {
+            crypto->engineNext = (uint16_t)((idx + 1) % crypto->engineCount);
+            return engine->devId;
+        }
+    }
+    /* every capable engine is busy or there is none, run in software */
+    return INVALID_DEVID;
+}
 
 #ifndef NO_RSA
 static int hsmCacheKeyRsa(whServerContext* server, RsaKey* key, whKeyId* outId)
@@ -39,7 +71,7 @@ static int hsmCacheKeyRsa(whServerContext* server, RsaKey* key, whKeyId* outId)
     int slotIdx = 0;
     whKeyId keyId = WOLFHSM_KEYTYPE_CRYPTO;
     /* get a free slot */
-    ret = slotIdx = hsmCacheFindSlot(server);
+    ret = slotIdx = hsmCacheFindSlot(server, WOLFHSM_KEYCACHE_BUFSIZE);
     if (ret >= 0) {
         ret = hsmGetUniqueId(server, &keyId);
     }
@@ -57,28 +89,119 @@ static int hsmCacheKeyRsa(whServerContext* server, RsaKey* key, whKeyId* outId)
         server->cache[slotIdx].meta->len = ret;
         /* export keyId */
         *outId = keyId;
-        ret = 0;
+        ret = hsmCacheIndexSlot(server, slotIdx);
     }
     return ret;
 }
 
-static int hsmLoadKeyRsa(whServerContext* server, RsaKey* key, whKeyId keyId)
+/* load a key from the keystore into *outKey, reusing its decoded copy if
+ * there is one.  scratch is decoded into when no decoded entry is free.
+ * Release the key with hsmPutKeyRsa on success */
+static int hsmGetKeyRsa(whServerContext* server, whKeyId keyId,
+    RsaKey* scratch, RsaKey** outKey)
 {
     int ret = 0;
     int slotIdx = 0;
     uint32_t idx = 0;
     uint32_t size;
+    RsaKey* key = scratch;
+#if WOLFHSM_NUM_DECODED_KEYS > 0
+    whServerDecodedKey* entry;
+#endif
     keyId |= (WOLFHSM_KEYTYPE_CRYPTO | (server->comm->client_id << 8));
     /* freshen the key */
     ret = slotIdx = hsmFreshenKey(server, keyId);
+    if (ret < 0)
+        return ret;
+#if WOLFHSM_NUM_DECODED_KEYS > 0
+    entry = hsmDecodedKeyFind(server, slotIdx, WH_DECODED_KEY_RSA, 0);
+    if (entry != NULL) {
+        *outKey = entry->key.rsa;
+        return 0;
+    }
+    entry = hsmDecodedKeyAlloc(server, slotIdx, 0);
+    if (entry != NULL)
+        key = entry->key.rsa;
+#endif
     /* decode the key */
-    if (ret >= 0) {
-        size = WOLFHSM_KEYCACHE_BUFSIZE;
-        ret = wc_RsaPrivateKeyDecode(server->cache[slotIdx].buffer, (word32*)&idx, key,
-            size);
+    ret = wc_InitRsaKey_ex(key, NULL, INVALID_DEVID);
+    if (ret == 0) {
+        size = server->cache[slotIdx].meta->len;
+        ret = wc_RsaPrivateKeyDecode(server->cache[slotIdx].buffer,
+            (word32*)&idx, key, size);
+        if (ret != 0)
+            wc_FreeRsaKey(key);
+    }
+#if WOLFHSM_NUM_DECODED_KEYS > 0
+    if (entry != NULL) {
+        if (ret == 0)
+            entry->type = WH_DECODED_KEY_RSA;
+        else
+            (void)hsmDecodedKeyRelease(server, key);
+    }
+#endif
+    if (ret == 0)
+        *outKey = key;
+    return ret;
+}
+
+static void hsmPutKeyRsa(whServerContext* server, RsaKey* key)
+{
+#if WOLFHSM_NUM_DECODED_KEYS > 0
+    /* decoded keys stay parsed for the next request */
+    if (hsmDecodedKeyRelease(server, key) == 0)
+        return;
+#else
+    (void)server;
+#endif
+    wc_FreeRsaKey(key);
+}
+
+#ifdef WOLFSSL_KEY_GEN
+static int hsmRsaKeyGen(whServerContext* server, uint32_t size, uint32_t e,
+    whKeyId* outId)
+{
+    int ret;
+    /* init the rsa key */
+    ret = wc_InitRsaKey_ex(server->crypto->rsa, NULL, INVALID_DEVID);
+    /* make the rsa key with the given params */
+    if (ret == 0) {
+        ret = wc_MakeRsaKey(server->crypto->rsa, size, e, server->crypto->rng);
+    }
+    /* cache the generated key, data will be blown away */
+    if (ret == 0) {
+        ret = hsmCacheKeyRsa(server, server->crypto->rsa, outId);
     }
+    wc_FreeRsaKey(server->crypto->rsa);
     return ret;
 }
+
+#if WOLFHSM_SERVER_MAX_JOBS > 0
+/* Job step for RSA keygen.  wolfCrypt has no incremental keygen, so the key is
+ * made in a single slice.  The result is the regular keygen response packet */
+static int hsmRsaKeyGenJob(whServerContext* server, uint8_t* buffer,
+    uint16_t* out_size)
+{
+    whPacket* packet = (whPacket*)buffer;
+    whKeyId keyId = WOLFHSM_KEYID_ERASED;
+    wh_Packet_pk_rsakg_req req;
+    int ret;
+
+    XMEMCPY(&req, buffer, sizeof(req));
+    ret = hsmRsaKeyGen(server, req.size, req.e, &keyId);
+    packet->rc = ret;
+    packet->flags = 0;
+    if (ret == 0) {
+        packet->pkRsakgRes.keyId = (keyId & ~WOLFHSM_KEYUSER_MASK);
+        *out_size = WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->pkRsakgRes);
+    }
+    else {
+        *out_size = WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->rc);
+    }
+    return 0;
+}
+#endif /* WOLFHSM_SERVER_MAX_JOBS > 0 */
+#endif /* WOLFSSL_KEY_GEN */
 #endif /* !NO_RSA */
 
 #ifdef HAVE_CURVE25519
@@ -91,7 +214,7 @@ static int hsmCacheKeyCurve25519(whServerContext* server, curve25519_key* key,
     word32 pubSz = CURVE25519_KEYSIZE;
     whKeyId keyId = WOLFHSM_KEYTYPE_CRYPTO;
     /* get a free slot */
-    ret = slotIdx = hsmCacheFindSlot(server);
+    ret = slotIdx = hsmCacheFindSlot(server, CURVE25519_KEYSIZE * 2);
     if (ret >= 0) {
         ret = hsmGetUniqueId(server, &keyId);
     }
@@ -107,6 +230,7 @@ static int hsmCacheKeyCurve25519(whServerContext* server, curve25519_key* key,
             sizeof(server->cache[slotIdx].meta));
         server->cache[slotIdx].meta->id = keyId;
         server->cache[slotIdx].meta->len = CURVE25519_KEYSIZE * 2;
+        ret = hsmCacheIndexSlot(server, slotIdx);
         /* export keyId */
         *outId = keyId;
     }
@@ -147,7 +271,7 @@ static int hsmCacheKeyEcc(whServerContext* server, ecc_key* key, whKeyId* outId)
     uint32_t qdLen;
     whKeyId keyId = WOLFHSM_KEYTYPE_CRYPTO;
     /* get a free slot */
-    ret = slotIdx = hsmCacheFindSlot(server);
+    ret = slotIdx = hsmCacheFindSlot(server, key->dp->size * 3);
     if (ret >= 0) {
         ret = hsmGetUniqueId(server, &keyId);
     }
@@ -164,32 +288,1183 @@ static int hsmCacheKeyEcc(whServerContext* server, ecc_key* key, whKeyId* outId)
             sizeof(server->cache[slotIdx].meta));
         server->cache[slotIdx].meta->id = keyId;
         server->cache[slotIdx].meta->len = qxLen + qyLen + qdLen;
+        ret = hsmCacheIndexSlot(server, slotIdx);
         /* export keyId */
         *outId = keyId;
     }
     return ret;
 }
 
-static int hsmLoadKeyEcc(whServerContext* server, ecc_key* key, uint16_t keyId,
-    int curveId)
+/* load a key from the keystore into *outKey, like hsmGetKeyRsa */
+static int hsmGetKeyEcc(whServerContext* server, uint16_t keyId, int curveId,
+    ecc_key* scratch, ecc_key** outKey)
 {
     int ret;
     int slotIdx = 0;
     uint32_t keySz;
+    ecc_key* key = scratch;
+#if WOLFHSM_NUM_DECODED_KEYS > 0
+    whServerDecodedKey* entry;
+#endif
     keyId |= WOLFHSM_KEYTYPE_CRYPTO;
     /* freshen the key */
     ret = slotIdx = hsmFreshenKey(server, keyId);
+    if (ret < 0)
+        return ret;
+#if WOLFHSM_NUM_DECODED_KEYS > 0
+    entry = hsmDecodedKeyFind(server, slotIdx, WH_DECODED_KEY_ECC, curveId);
+    if (entry != NULL) {
+        *outKey = entry->key.ecc;
+        return 0;
+    }
+    entry = hsmDecodedKeyAlloc(server, slotIdx, curveId);
+    if (entry != NULL)
+        key = entry->key.ecc;
+#endif
     /* decode the key */
-    if (ret >= 0) {
+    ret = wc_ecc_init_ex(key, NULL,
+        wh_Server_CryptoDevId(server, WH_SERVER_ENGINE_CAP_PK));
+    if (ret == 0) {
         keySz = server->cache[slotIdx].meta->len / 3;
         ret = wc_ecc_import_unsigned(key, server->cache[slotIdx].buffer,
             server->cache[slotIdx].buffer + keySz,
             server->cache[slotIdx].buffer + keySz * 2, curveId);
+        if (ret != 0)
+            wc_ecc_free(key);
+    }
+#if WOLFHSM_NUM_DECODED_KEYS > 0
+    if (entry != NULL) {
+        if (ret == 0)
+            entry->type = WH_DECODED_KEY_ECC;
+        else
+            (void)hsmDecodedKeyRelease(server, key);
+    }
+#endif
+    if (ret == 0)
+        *outKey = key;
+    return ret;
+}
+
+static void hsmPutKeyEcc(whServerContext* server, ecc_key* key)
+{
+#if WOLFHSM_NUM_DECODED_KEYS > 0
+    if (hsmDecodedKeyRelease(server, key) == 0)
+        return;
+#else
+    (void)server;
+#endif
+    wc_ecc_free(key);
+}
+#endif /* HAVE_ECC */
+
+#if !defined(NO_AES) && defined(WOLFHSM_SYMMETRIC_INTERNAL)
+/* AES key schedule kinds, CBC needs a separate schedule per direction */
+enum {
+    HSM_AES_MODE_CBC_ENC = 1,
+    HSM_AES_MODE_CBC_DEC = 2,
+    HSM_AES_MODE_GCM = 3,
+};
+
+/* set up an Aes for a cached key, reusing its expanded schedule if there is
+ * one.  The CBC iv is reset on every call.  Release with hsmPutKeyAes */
+static int hsmGetKeyAes(whServerContext* server, whKeyId keyId, int mode,
+    const uint8_t* iv, Aes** outAes)
+{
+    int ret;
+    int slotIdx = 0;
+    Aes* aes = server->crypto->aes;
+#if WOLFHSM_NUM_DECODED_KEYS > 0
+    whServerDecodedKey* entry;
+#endif
+    keyId |= WOLFHSM_KEYTYPE_CRYPTO;
+    /* freshen the key */
+    ret = slotIdx = hsmFreshenKey(server, keyId);
+    if (ret < 0)
+        return ret;
+#if WOLFHSM_NUM_DECODED_KEYS > 0
+    entry = hsmDecodedKeyFind(server, slotIdx, WH_DECODED_KEY_AES, mode);
+    if (entry != NULL) {
+        ret = 0;
+        if (mode != HSM_AES_MODE_GCM)
+            ret = wc_AesSetIV(entry->key.aes, iv);
+        if (ret == 0)
+            *outAes = entry->key.aes;
+        else
+            (void)hsmDecodedKeyRelease(server, entry->key.aes);
+        return ret;
+    }
+    entry = hsmDecodedKeyAlloc(server, slotIdx, mode);
+    if (entry != NULL)
+        aes = entry->key.aes;
+#endif
+    /* init key with possible hardware */
+    ret = wc_AesInit(aes, NULL,
+        wh_Server_CryptoDevId(server, WH_SERVER_ENGINE_CAP_AES));
+    if (ret == 0) {
+#ifdef HAVE_AESGCM
+        if (mode == HSM_AES_MODE_GCM) {
+            ret = wc_AesGcmSetKey(aes, server->cache[slotIdx].buffer,
+                server->cache[slotIdx].meta->len);
+        }
+        else
+#endif
+        {
+            ret = wc_AesSetKey(aes, server->cache[slotIdx].buffer,
+                server->cache[slotIdx].meta->len, iv,
+                mode == HSM_AES_MODE_CBC_ENC ?
+                AES_ENCRYPTION : AES_DECRYPTION);
+        }
+        if (ret != 0)
+            wc_AesFree(aes);
+    }
+#if WOLFHSM_NUM_DECODED_KEYS > 0
+    if (entry != NULL) {
+        if (ret == 0)
+            entry->type = WH_DECODED_KEY_AES;
+        else
+            (void)hsmDecodedKeyRelease(server, aes);
+    }
+#endif
+    if (ret == 0)
+        *outAes = aes;
+    return ret;
+}
+
+static void hsmPutKeyAes(whServerContext* server, Aes* aes)
+{
+#if WOLFHSM_NUM_DECODED_KEYS > 0
+    /* expanded schedules stay set up for the next request */
+    if (hsmDecodedKeyRelease(server, aes) == 0)
+        return;
+#else
+    (void)server;
+#endif
+    wc_AesFree(aes);
+}
+#endif /* !NO_AES && WOLFHSM_SYMMETRIC_INTERNAL */
+
+#if !defined(NO_AES) || WOLFHSM_SERVER_MAX_HASH_SESSIONS > 0 || \
+    !defined(WOLFHSM_SERVER_NO_GROUP_IMAGE)
+/* map a client buffer with no special flags */
+static int hsmDmaClientAddress(whServerContext* server, uint64_t addr,
+    void** outPtr, uint64_t len, whServerDmaOper oper)
+{
+    whServerDmaFlags flags = {0};
+    return wh_Server_DmaProcessClientAddress(server, addr, outPtr, len, oper,
+        flags);
+}
+#endif
+
+#if !defined(NO_AES) && WOLFHSM_SERVER_MAX_CIPHER_SESSIONS > 0
+static void hsmCipherSessionFree(whServerCipherSession* session)
+{
+    if (session->id != 0)
+        wc_AesFree(session->aes);
+    XMEMSET((uint8_t*)session, 0, sizeof(*session));
+}
+
+/* start a session on a cached key, iv and authIn follow the request */
+static int hsmCipherSessionInit(whServerContext* server,
+    wh_Packet_cipher_session_req* req, uint16_t reqSz, uint16_t* outId)
+{
+    int ret;
+    int i;
+    int slotIdx;
+    whServerCipherSession* session = NULL;
+    uint8_t* iv = (uint8_t*)(req + 1);
+    uint8_t* authIn = iv + req->ivSz;
+    if (    (req->ivSz > WH_COMM_DATA_LEN) ||
+            (req->authInSz > WH_COMM_DATA_LEN) ||
+            (sizeof(*req) + req->ivSz + req->authInSz > reqSz)) {
+        return BAD_FUNC_ARG;
+    }
+    for (i = 0; i < WOLFHSM_SERVER_MAX_CIPHER_SESSIONS; i++) {
+        if (server->cipherSession[i].id == 0) {
+            session = &server->cipherSession[i];
+            break;
+        }
+    }
+    if (session == NULL)
+        return WH_ERROR_NOSPACE;
+    ret = slotIdx = hsmFreshenKey(server,
+        (whKeyId)req->keyId | WOLFHSM_KEYTYPE_CRYPTO);
+    if (ret < 0)
+        return ret;
+    ret = wc_AesInit(session->aes, NULL,
+        wh_Server_CryptoDevId(server, WH_SERVER_ENGINE_CAP_AES));
+    if (ret != 0)
+        return ret;
+    switch (req->type) {
+#ifdef HAVE_AES_CBC
+    case WC_CIPHER_AES_CBC:
+        if (req->ivSz != AES_IV_SIZE || req->authInSz != 0) {
+            ret = BAD_FUNC_ARG;
+            break;
+        }
+        ret = wc_AesSetKey(session->aes, server->cache[slotIdx].buffer,
+            server->cache[slotIdx].meta->len, iv,
+            req->enc == 1 ? AES_ENCRYPTION : AES_DECRYPTION);
+        break;
+#endif
+#if defined(HAVE_AESGCM) && defined(WOLFSSL_AESGCM_STREAM)
+    case WC_CIPHER_AES_GCM:
+        ret = wc_AesGcmInit(session->aes, server->cache[slotIdx].buffer,
+            server->cache[slotIdx].meta->len, iv, req->ivSz);
+        /* the additional data is all given up front */
+        if (ret == 0 && req->authInSz > 0) {
+            if (req->enc == 1) {
+                ret = wc_AesGcmEncryptUpdate(session->aes, NULL, NULL, 0,
+                    authIn, req->authInSz);
+            }
+            else {
+                ret = wc_AesGcmDecryptUpdate(session->aes, NULL, NULL, 0,
+                    authIn, req->authInSz);
+            }
+        }
+        break;
+#endif
+    default:
+        ret = NOT_COMPILED_IN;
+        break;
+    }
+    (void)authIn;
+    if (ret != 0) {
+        wc_AesFree(session->aes);
+        return ret;
+    }
+    /* Id 0 is never handed out */
+    server->cipher_seq++;
+    if (server->cipher_seq == 0)
+        server->cipher_seq++;
+    session->id = server->cipher_seq;
+    session->comm = server->comm;
+    session->type = req->type;
+    session->enc = (req->enc == 1);
+    *outId = session->id;
+    return 0;
+}
+
+/* handle one operation of a cipher session, the session is closed by final
+ * or by any failure */
+static int hsmCipherSession(whServerContext* server, whPacket* packet,
+    uint16_t* size)
+{
+    int ret = 0;
+    int i;
+    uint16_t id = 0;
+    uint32_t sz;
+    uint32_t authTagSz;
+    uint16_t reqSz;
+    uint8_t* in = (uint8_t*)(&packet->cipherSessionReq + 1);
+    uint8_t* out = (uint8_t*)(&packet->cipherSessionRes + 1);
+    whServerCipherSession* session = NULL;
+    if (*size < WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->cipherSessionReq))
+        return BAD_FUNC_ARG;
+    reqSz = *size - WOLFHSM_PACKET_STUB_SIZE;
+    if (packet->cipherSessionReq.op == WH_CIPHER_SESSION_INIT) {
+        ret = hsmCipherSessionInit(server, &packet->cipherSessionReq, reqSz,
+            &id);
+        if (ret == 0) {
+            packet->cipherSessionRes.session = id;
+            packet->cipherSessionRes.sz = 0;
+            packet->cipherSessionRes.authTagSz = 0;
+            *size = WOLFHSM_PACKET_STUB_SIZE +
+                sizeof(packet->cipherSessionRes);
+        }
+        return ret;
+    }
+    /* sessions are only visible to the client that opened them */
+    for (i = 0; i < WOLFHSM_SERVER_MAX_CIPHER_SESSIONS; i++) {
+        if (    (server->cipherSession[i].id != 0) &&
+                (server->cipherSession[i].id ==
+                    packet->cipherSessionReq.session) &&
+                (server->cipherSession[i].comm == server->comm)) {
+            session = &server->cipherSession[i];
+            break;
+        }
+    }
+    if (session == NULL)
+        return WH_ERROR_NOTFOUND;
+    id = session->id;
+    sz = packet->cipherSessionReq.sz;
+    authTagSz = packet->cipherSessionReq.authTagSz;
+    switch (packet->cipherSessionReq.op) {
+    case WH_CIPHER_SESSION_UPDATE:
+        if (    (sz > reqSz - sizeof(packet->cipherSessionReq)) ||
+                ((session->type == WC_CIPHER_AES_CBC) &&
+                    (sz % AES_BLOCK_SIZE != 0))) {
+            ret = BAD_FUNC_ARG;
+            break;
+        }
+        /* move the input down to the output so the cipher runs in place */
+        XMEMMOVE(out, in, sz);
+#ifdef HAVE_AES_CBC
+        if (session->type == WC_CIPHER_AES_CBC) {
+            if (session->enc)
+                ret = wc_AesCbcEncrypt(session->aes, out, out, sz);
+            else
+                ret = wc_AesCbcDecrypt(session->aes, out, out, sz);
+        }
+#endif
+#if defined(HAVE_AESGCM) && defined(WOLFSSL_AESGCM_STREAM)
+        if (session->type == WC_CIPHER_AES_GCM) {
+            if (session->enc) {
+                ret = wc_AesGcmEncryptUpdate(session->aes, out, out, sz,
+                    NULL, 0);
+            }
+            else {
+                ret = wc_AesGcmDecryptUpdate(session->aes, out, out, sz,
+                    NULL, 0);
+            }
+        }
+#endif
+        if (ret == 0) {
+            packet->cipherSessionRes.sz = sz;
+            packet->cipherSessionRes.authTagSz = 0;
+        }
+        break;
+    case WH_CIPHER_SESSION_FINAL:
+        sz = 0;
+#if defined(HAVE_AESGCM) && defined(WOLFSSL_AESGCM_STREAM)
+        if (session->type == WC_CIPHER_AES_GCM) {
+            if (    (authTagSz > AES_BLOCK_SIZE) ||
+                    (!session->enc &&
+                        authTagSz > reqSz - sizeof(packet->cipherSessionReq))) {
+                ret = BAD_FUNC_ARG;
+            }
+            else if (session->enc) {
+                ret = wc_AesGcmEncryptFinal(session->aes, out, authTagSz);
+            }
+            else {
+                ret = wc_AesGcmDecryptFinal(session->aes, in, authTagSz);
+                authTagSz = 0;
+            }
+        }
+        else
+#endif
+        {
+            authTagSz = 0;
+        }
+        if (ret == 0) {
+            packet->cipherSessionRes.sz = 0;
+            packet->cipherSessionRes.authTagSz = authTagSz;
+            sz = authTagSz;
+        }
+        hsmCipherSessionFree(session);
+        break;
+    default:
+        ret = BAD_FUNC_ARG;
+        break;
+    }
+    if (ret != 0) {
+        hsmCipherSessionFree(session);
+        return ret;
+    }
+    packet->cipherSessionRes.session = id;
+    *size = WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->cipherSessionRes) + sz;
+    return 0;
+}
+
+void wh_Server_CipherSessionFlush(whServerContext* server)
+{
+    int i;
+    for (i = 0; i < WOLFHSM_SERVER_MAX_CIPHER_SESSIONS; i++)
+        hsmCipherSessionFree(&server->cipherSession[i]);
+}
+#endif /* !NO_AES && WOLFHSM_SERVER_MAX_CIPHER_SESSIONS > 0 */
+
+#ifndef NO_AES
+/* one-shot AES-CBC or AES-GCM with in and out in client memory */
+static int hsmCipherDma(whServerContext* server, whPacket* packet,
+    uint16_t* size)
+{
+    int ret = 0;
+    int mapIn = 0;
+    int mapOut = 0;
+    wh_Packet_cipher_dma_req req;
+    uint8_t* key;
+    uint8_t* iv;
+    uint8_t* authIn;
+    uint8_t* authTag;
+    uint8_t tag[AES_BLOCK_SIZE];
+    void* in = NULL;
+    void* out = NULL;
+    Aes* aes = NULL;
+#ifdef WOLFHSM_SYMMETRIC_INTERNAL
+    uint32_t keyId;
+#endif
+    if (*size < WOLFHSM_PACKET_STUB_SIZE + sizeof(req))
+        return BAD_FUNC_ARG;
+    /* the response overwrites the request */
+    XMEMCPY((uint8_t*)&req, (uint8_t*)&packet->cipherDmaReq, sizeof(req));
+    if (    (req.keyLen > WH_COMM_DATA_LEN) ||
+            (req.ivSz > WH_COMM_DATA_LEN) ||
+            (req.authInSz > WH_COMM_DATA_LEN) ||
+            (req.authTagSz > sizeof(tag)) ||
+            (req.sz > UINT32_MAX) ||
+            (WOLFHSM_PACKET_STUB_SIZE + sizeof(req) + req.keyLen + req.ivSz +
+                req.authInSz + (req.enc == 1 ? 0 : req.authTagSz) > *size)) {
+        return BAD_FUNC_ARG;
+    }
+    key = (uint8_t*)(&packet->cipherDmaReq + 1);
+    iv = key + req.keyLen;
+    authIn = iv + req.ivSz;
+    authTag = authIn + req.authInSz;
+    switch (req.type) {
+#ifdef HAVE_AES_CBC
+    case WC_CIPHER_AES_CBC:
+        if (req.ivSz != AES_IV_SIZE || req.sz % AES_BLOCK_SIZE != 0)
+            return BAD_FUNC_ARG;
+        break;
+#endif
+#ifdef HAVE_AESGCM
+    case WC_CIPHER_AES_GCM:
+        break;
+#endif
+    default:
+        return NOT_COMPILED_IN;
+    }
+    /* set up the key */
+#ifdef WOLFHSM_SYMMETRIC_INTERNAL
+    if (req.keyLen != sizeof(keyId))
+        return BAD_FUNC_ARG;
+    XMEMCPY((uint8_t*)&keyId, key, sizeof(keyId));
+    ret = hsmGetKeyAes(server, (whKeyId)keyId,
+        req.type == WC_CIPHER_AES_GCM ? HSM_AES_MODE_GCM :
+        (req.enc == 1 ? HSM_AES_MODE_CBC_ENC : HSM_AES_MODE_CBC_DEC), iv,
+        &aes);
+#else
+    ret = wc_AesInit(server->crypto->aes, NULL,
+        wh_Server_CryptoDevId(server, WH_SERVER_ENGINE_CAP_AES));
+    if (ret == 0) {
+        aes = server->crypto->aes;
+#ifdef HAVE_AESGCM
+        if (req.type == WC_CIPHER_AES_GCM)
+            ret = wc_AesGcmSetKey(aes, key, req.keyLen);
+        else
+#endif
+        {
+            ret = wc_AesSetKey(aes, key, req.keyLen, iv,
+                req.enc == 1 ? AES_ENCRYPTION : AES_DECRYPTION);
+        }
+    }
+#endif
+    /* map the client buffers */
+    if (ret == 0) {
+        ret = hsmDmaClientAddress(server, req.in, &in, req.sz,
+            WH_DMA_OPER_CLIENT_READ_PRE);
+        mapIn = (ret == 0);
+    }
+    if (ret == 0) {
+        ret = hsmDmaClientAddress(server, req.out, &out, req.sz,
+            WH_DMA_OPER_CLIENT_WRITE_PRE);
+        mapOut = (ret == 0);
+    }
+    /* do the crypto operation */
+    if (ret == 0) {
+#ifdef HAVE_AESGCM
+        if (req.type == WC_CIPHER_AES_GCM) {
+            if (req.enc == 1) {
+                ret = wc_AesGcmEncrypt(aes, out, in, (word32)req.sz, iv,
+                    req.ivSz, tag, req.authTagSz, authIn, req.authInSz);
+            }
+            else {
+                ret = wc_AesGcmDecrypt(aes, out, in, (word32)req.sz, iv,
+                    req.ivSz, authTag, req.authTagSz, authIn, req.authInSz);
+            }
+        }
+        else
+#endif
+        {
+            if (req.enc == 1)
+                ret = wc_AesCbcEncrypt(aes, out, in, (word32)req.sz);
+            else
+                ret = wc_AesCbcDecrypt(aes, out, in, (word32)req.sz);
+        }
+    }
+    /* unmap whatever was mapped, keeping the first error */
+    if (mapOut) {
+        int rc = hsmDmaClientAddress(server, req.out, &out, req.sz,
+            WH_DMA_OPER_CLIENT_WRITE_POST);
+        if (ret == 0)
+            ret = rc;
+    }
+    if (mapIn) {
+        int rc = hsmDmaClientAddress(server, req.in, &in, req.sz,
+            WH_DMA_OPER_CLIENT_READ_POST);
+        if (ret == 0)
+            ret = rc;
+    }
+#ifdef WOLFHSM_SYMMETRIC_INTERNAL
+    if (aes != NULL)
+        hsmPutKeyAes(server, aes);
+#else
+    wc_AesFree(server->crypto->aes);
+#endif
+    if (ret == 0) {
+        packet->cipherDmaRes.sz = (uint32_t)req.sz;
+        packet->cipherDmaRes.authTagSz = 0;
+        if (req.type == WC_CIPHER_AES_GCM && req.enc == 1) {
+            packet->cipherDmaRes.authTagSz = req.authTagSz;
+            XMEMCPY((uint8_t*)(&packet->cipherDmaRes + 1), tag,
+                req.authTagSz);
+        }
+        *size = WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->cipherDmaRes) +
+            packet->cipherDmaRes.authTagSz;
+    }
+    return ret;
+}
+#endif /* !NO_AES */
+
+#ifdef HAVE_ECC
+/* verify a batch of signatures, decoding each key once for a run of entries
+ * that share it.  A signature that does not verify, or cannot be parsed, only
+ * clears its result bit, any key error fails the whole batch */
+static int hsmEccVerifyBatch(whServerContext* server, whPacket* packet,
+    uint16_t* size)
+{
+    int ret = 0;
+    int res;
+    uint32_t i;
+    uint32_t count;
+    uint32_t curveId;
+    uint32_t results = 0;
+    uint32_t keyId = 0;
+    uint32_t avail;
+    uint8_t* in;
+    wh_Packet_pk_ecc_verify_batch_entry* entry;
+    ecc_key* eccPublic = NULL;
+    if (*size < WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->pkEccVerifyBatchReq))
+        return BAD_FUNC_ARG;
+    count = packet->pkEccVerifyBatchReq.count;
+    curveId = packet->pkEccVerifyBatchReq.curveId;
+    if (count > WOLFHSM_PACKET_ECC_VERIFY_BATCH_MAX)
+        return BAD_FUNC_ARG;
+    /* entries are after the fixed size fields */
+    in = (uint8_t*)(&packet->pkEccVerifyBatchReq + 1);
+    avail = *size - WOLFHSM_PACKET_STUB_SIZE -
+        sizeof(packet->pkEccVerifyBatchReq);
+    for (i = 0; i < count; i++) {
+        entry = (wh_Packet_pk_ecc_verify_batch_entry*)in;
+        if (    (avail < sizeof(*entry)) ||
+                (avail - sizeof(*entry) <
+                    (uint32_t)entry->sigSz + entry->hashSz)) {
+            ret = BAD_FUNC_ARG;
+            break;
+        }
+        in += sizeof(*entry) + entry->sigSz + entry->hashSz;
+        avail -= sizeof(*entry) + entry->sigSz + entry->hashSz;
+        /* only decode the key when it changes */
+        if (eccPublic == NULL || entry->keyId != keyId) {
+            if (eccPublic != NULL)
+                hsmPutKeyEcc(server, eccPublic);
+            eccPublic = NULL;
+            keyId = entry->keyId;
+            ret = hsmGetKeyEcc(server, (uint16_t)keyId, (int)curveId,
+                server->crypto->eccPublic, &eccPublic);
+            if (ret != 0) {
+                eccPublic = NULL;
+                break;
+            }
+        }
+        res = 0;
+        if (    (wc_ecc_verify_hash((uint8_t*)(entry + 1), entry->sigSz,
+                    (uint8_t*)(entry + 1) + entry->sigSz, entry->hashSz, &res,
+                    eccPublic) == 0) &&
+                (res == 1)) {
+            results |= 1u << i;
+        }
+    }
+    if (eccPublic != NULL)
+        hsmPutKeyEcc(server, eccPublic);
+    if (ret == 0) {
+        packet->pkEccVerifyBatchRes.count = count;
+        packet->pkEccVerifyBatchRes.res = results;
+        *size = WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->pkEccVerifyBatchRes);
     }
     return ret;
 }
 #endif /* HAVE_ECC */
 
+#if WOLFHSM_SERVER_MAX_HASH_SESSIONS > 0
+static void hsmHashSessionFree(whServerHashSession* session)
+{
+#if defined(WOLFSSL_CMAC) && !defined(NO_AES)
+    uint8_t tag[AES_BLOCK_SIZE];
+    word32 tagSz = sizeof(tag);
+#endif
+    if (session->id == 0)
+        return;
+    switch (session->type) {
+#ifndef NO_SHA256
+    case WH_HASH_SESSION_SHA256:
+        wc_Sha256Free(session->state.sha256);
+        break;
+#endif
+#ifdef WOLFSSL_SHA384
+    case WH_HASH_SESSION_SHA384:
+        wc_Sha384Free(session->state.sha384);
+        break;
+#endif
+#ifndef NO_HMAC
+    case WH_HASH_SESSION_HMAC_SHA256:
+    case WH_HASH_SESSION_HMAC_SHA384:
+        wc_HmacFree(session->state.hmac);
+        break;
+#endif
+#if defined(WOLFSSL_CMAC) && !defined(NO_AES)
+    case WH_HASH_SESSION_CMAC_AES:
+        /* final is the only call that releases a cmac on every version */
+        (void)wc_CmacFinal(session->state.cmac, tag, &tagSz);
+        break;
+#endif
+    default:
+        break;
+    }
+    XMEMSET((uint8_t*)session, 0, sizeof(*session));
+}
+
+/* start a hash, or a MAC on a cached key that is never exported */
+static int hsmHashSessionInit(whServerContext* server, whServerHashSession*
+    session, uint32_t type, uint32_t keyId)
+{
+    int ret;
+    int slotIdx = 0;
+    /* CMAC runs on the AES engines */
+    int devId = wh_Server_CryptoDevId(server,
+        (type == WH_HASH_SESSION_CMAC_AES) ? WH_SERVER_ENGINE_CAP_AES :
+            WH_SERVER_ENGINE_CAP_HASH);
+    /* only the MAC types use a key */
+    if (    (type == WH_HASH_SESSION_HMAC_SHA256) ||
+            (type == WH_HASH_SESSION_HMAC_SHA384) ||
+            (type == WH_HASH_SESSION_CMAC_AES)) {
+        ret = slotIdx = hsmFreshenKey(server,
+            (whKeyId)keyId | WOLFHSM_KEYTYPE_CRYPTO);
+        if (ret < 0)
+            return ret;
+    }
+    switch (type) {
+#ifndef NO_SHA256
+    case WH_HASH_SESSION_SHA256:
+        ret = wc_InitSha256_ex(session->state.sha256, NULL, devId);
+        break;
+#endif
+#ifdef WOLFSSL_SHA384
+    case WH_HASH_SESSION_SHA384:
+        ret = wc_InitSha384_ex(session->state.sha384, NULL, devId);
+        break;
+#endif
+#ifndef NO_HMAC
+    case WH_HASH_SESSION_HMAC_SHA256:
+    case WH_HASH_SESSION_HMAC_SHA384:
+        ret = wc_HmacInit(session->state.hmac, NULL, devId);
+        if (ret == 0) {
+            ret = wc_HmacSetKey(session->state.hmac,
+                type == WH_HASH_SESSION_HMAC_SHA256 ? WC_SHA256 : WC_SHA384,
+                server->cache[slotIdx].buffer,
+                server->cache[slotIdx].meta->len);
+            if (ret != 0)
+                wc_HmacFree(session->state.hmac);
+        }
+        break;
+#endif
+#if defined(WOLFSSL_CMAC) && !defined(NO_AES)
+    case WH_HASH_SESSION_CMAC_AES:
+        ret = wc_InitCmac_ex(session->state.cmac,
+            server->cache[slotIdx].buffer, server->cache[slotIdx].meta->len,
+            WC_CMAC_AES, NULL, NULL, devId);
+        break;
+#endif
+    default:
+        ret = NOT_COMPILED_IN;
+        break;
+    }
+    return ret;
+}
+
+static int hsmHashSessionUpdate(whServerHashSession* session,
+    const uint8_t* in, uint32_t sz)
+{
+    int ret;
+    switch (session->type) {
+#ifndef NO_SHA256
+    case WH_HASH_SESSION_SHA256:
+        ret = wc_Sha256Update(session->state.sha256, in, sz);
+        break;
+#endif
+#ifdef WOLFSSL_SHA384
+    case WH_HASH_SESSION_SHA384:
+        ret = wc_Sha384Update(session->state.sha384, in, sz);
+        break;
+#endif
+#ifndef NO_HMAC
+    case WH_HASH_SESSION_HMAC_SHA256:
+    case WH_HASH_SESSION_HMAC_SHA384:
+        ret = wc_HmacUpdate(session->state.hmac, in, sz);
+        break;
+#endif
+#if defined(WOLFSSL_CMAC) && !defined(NO_AES)
+    case WH_HASH_SESSION_CMAC_AES:
+        ret = wc_CmacUpdate(session->state.cmac, in, sz);
+        break;
+#endif
+    default:
+        ret = BAD_FUNC_ARG;
+        break;
+    }
+    return ret;
+}
+
+/* write the digest to out and set *outSz, the session is freed by the caller */
+static int hsmHashSessionFinal(whServerHashSession* session, uint8_t* out,
+    uint32_t* outSz)
+{
+    int ret;
+#if defined(WOLFSSL_CMAC) && !defined(NO_AES)
+    word32 tagSz = AES_BLOCK_SIZE;
+#endif
+    switch (session->type) {
+#ifndef NO_SHA256
+    case WH_HASH_SESSION_SHA256:
+        ret = wc_Sha256Final(session->state.sha256, out);
+        *outSz = WC_SHA256_DIGEST_SIZE;
+        break;
+#endif
+#ifdef WOLFSSL_SHA384
+    case WH_HASH_SESSION_SHA384:
+        ret = wc_Sha384Final(session->state.sha384, out);
+        *outSz = WC_SHA384_DIGEST_SIZE;
+        break;
+#endif
+#ifndef NO_HMAC
+    case WH_HASH_SESSION_HMAC_SHA256:
+    case WH_HASH_SESSION_HMAC_SHA384:
+        ret = wc_HmacFinal(session->state.hmac, out);
+        *outSz = session->type == WH_HASH_SESSION_HMAC_SHA256 ?
+            WC_SHA256_DIGEST_SIZE : WC_SHA384_DIGEST_SIZE;
+        break;
+#endif
+#if defined(WOLFSSL_CMAC) && !defined(NO_AES)
+    case WH_HASH_SESSION_CMAC_AES:
+        ret = wc_CmacFinal(session->state.cmac, out, &tagSz);
+        *outSz = tagSz;
+        /* cmac is released by final */
+        if (ret == 0)
+            session->type = 0;
+        break;
+#endif
+    default:
+        ret = BAD_FUNC_ARG;
+        break;
+    }
+    return ret;
+}
+
+/* handle one operation of a hash session, the session is closed by final or
+ * by any failure */
+static int hsmHashSession(whServerContext* server, whPacket* packet,
+    uint16_t* size)
+{
+    int ret = 0;
+    int i;
+    int mapped = 0;
+    uint32_t sz;
+    uint32_t digestSz = 0;
+    uint16_t reqSz;
+    uint64_t inAddr;
+    void* in = NULL;
+    whServerHashSession* session = NULL;
+    if (*size < WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->hashSessionReq))
+        return BAD_FUNC_ARG;
+    reqSz = *size - WOLFHSM_PACKET_STUB_SIZE;
+    sz = packet->hashSessionReq.sz;
+    if (packet->hashSessionReq.op == WH_HASH_SESSION_INIT) {
+        for (i = 0; i < WOLFHSM_SERVER_MAX_HASH_SESSIONS; i++) {
+            if (server->hashSession[i].id == 0) {
+                session = &server->hashSession[i];
+                break;
+            }
+        }
+        if (session == NULL)
+            return WH_ERROR_NOSPACE;
+        ret = hsmHashSessionInit(server, session,
+            packet->hashSessionReq.type, packet->hashSessionReq.keyId);
+        if (ret != 0)
+            return ret;
+        /* Id 0 is never handed out */
+        server->hash_seq++;
+        if (server->hash_seq == 0)
+            server->hash_seq++;
+        session->id = server->hash_seq;
+        session->comm = server->comm;
+        session->type = packet->hashSessionReq.type;
+        packet->hashSessionRes.session = session->id;
+        packet->hashSessionRes.sz = 0;
+        *size = WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->hashSessionRes);
+        return 0;
+    }
+    /* sessions are only visible to the client that opened them */
+    for (i = 0; i < WOLFHSM_SERVER_MAX_HASH_SESSIONS; i++) {
+        if (    (server->hashSession[i].id != 0) &&
+                (server->hashSession[i].id ==
+                    packet->hashSessionReq.session) &&
+                (server->hashSession[i].comm == server->comm)) {
+            session = &server->hashSession[i];
+            break;
+        }
+    }
+    if (session == NULL)
+        return WH_ERROR_NOTFOUND;
+    switch (packet->hashSessionReq.op) {
+    case WH_HASH_SESSION_UPDATE:
+        if (sz > reqSz - sizeof(packet->hashSessionReq)) {
+            ret = BAD_FUNC_ARG;
+            break;
+        }
+        /* input is after the fixed size fields */
+        ret = hsmHashSessionUpdate(session,
+            (uint8_t*)(&packet->hashSessionReq + 1), sz);
+        break;
+    case WH_HASH_SESSION_UPDATE_DMA:
+        /* input stays in client memory */
+        inAddr = packet->hashSessionReq.in;
+        ret = hsmDmaClientAddress(server, inAddr, &in, sz,
+            WH_DMA_OPER_CLIENT_READ_PRE);
+        mapped = (ret == 0);
+        if (ret == 0)
+            ret = hsmHashSessionUpdate(session, (uint8_t*)in, sz);
+        if (mapped) {
+            int rc = hsmDmaClientAddress(server, inAddr, &in, sz,
+                WH_DMA_OPER_CLIENT_READ_POST);
+            if (ret == 0)
+                ret = rc;
+        }
+        break;
+    case WH_HASH_SESSION_FINAL:
+        ret = hsmHashSessionFinal(session,
+            (uint8_t*)(&packet->hashSessionRes + 1), &digestSz);
+        if (ret == 0) {
+            packet->hashSessionRes.session = session->id;
+            packet->hashSessionRes.sz = digestSz;
+            *size = WOLFHSM_PACKET_STUB_SIZE +
+                sizeof(packet->hashSessionRes) + digestSz;
+        }
+        hsmHashSessionFree(session);
+        return ret;
+    default:
+        ret = BAD_FUNC_ARG;
+        break;
+    }
+    if (ret != 0) {
+        hsmHashSessionFree(session);
+        return ret;
+    }
+    packet->hashSessionRes.session = session->id;
+    packet->hashSessionRes.sz = 0;
+    *size = WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->hashSessionRes);
+    return 0;
+}
+
+void wh_Server_HashSessionFlush(whServerContext* server)
+{
+    int i;
+    for (i = 0; i < WOLFHSM_SERVER_MAX_HASH_SESSIONS; i++)
+        hsmHashSessionFree(&server->hashSession[i]);
+}
+#endif /* WOLFHSM_SERVER_MAX_HASH_SESSIONS > 0 */
+
+#ifndef WOLFHSM_SERVER_NO_GROUP_IMAGE
+/* digest state of an image verify */
+typedef union {
+#ifndef NO_SHA256
+    wc_Sha256 sha256[1];
+#endif
+#ifdef WOLFSSL_SHA384
+    wc_Sha384 sha384[1];
+#endif
+    uint64_t align;
+} hsmImageHash;
+
+static int hsmImageHashInit(whServerContext* server, hsmImageHash* hash,
+    uint32_t type)
+{
+    int ret;
+    int devId = wh_Server_CryptoDevId(server, WH_SERVER_ENGINE_CAP_HASH);
+    switch (type) {
+#ifndef NO_SHA256
+    case WH_HASH_SESSION_SHA256:
+        ret = wc_InitSha256_ex(hash->sha256, NULL, devId);
+        break;
+#endif
+#ifdef WOLFSSL_SHA384
+    case WH_HASH_SESSION_SHA384:
+        ret = wc_InitSha384_ex(hash->sha384, NULL, devId);
+        break;
+#endif
+    default:
+        ret = NOT_COMPILED_IN;
+        break;
+    }
+    return ret;
+}
+
+static int hsmImageHashUpdate(hsmImageHash* hash, uint32_t type,
+    const uint8_t* in, uint32_t sz)
+{
+    int ret;
+    switch (type) {
+#ifndef NO_SHA256
+    case WH_HASH_SESSION_SHA256:
+        ret = wc_Sha256Update(hash->sha256, in, sz);
+        break;
+#endif
+#ifdef WOLFSSL_SHA384
+    case WH_HASH_SESSION_SHA384:
+        ret = wc_Sha384Update(hash->sha384, in, sz);
+        break;
+#endif
+    default:
+        ret = BAD_FUNC_ARG;
+        break;
+    }
+    return ret;
+}
+
+/* write the digest to out, or only release the hash when out is NULL */
+static int hsmImageHashFinal(hsmImageHash* hash, uint32_t type, uint8_t* out,
+    uint32_t* outSz)
+{
+    int ret = 0;
+    switch (type) {
+#ifndef NO_SHA256
+    case WH_HASH_SESSION_SHA256:
+        if (out != NULL)
+            ret = wc_Sha256Final(hash->sha256, out);
+        *outSz = WC_SHA256_DIGEST_SIZE;
+        wc_Sha256Free(hash->sha256);
+        break;
+#endif
+#ifdef WOLFSSL_SHA384
+    case WH_HASH_SESSION_SHA384:
+        if (out != NULL)
+            ret = wc_Sha384Final(hash->sha384, out);
+        *outSz = WC_SHA384_DIGEST_SIZE;
+        wc_Sha384Free(hash->sha384);
+        break;
+#endif
+    default:
+        ret = BAD_FUNC_ARG;
+        break;
+    }
+    return ret;
+}
+
+/* hash the image in client memory one chunk at a time.  Each chunk is mapped
+ * before the previous one is hashed, so a DMA callback that copies through a
+ * bounce buffer can fetch it while the hash engine is busy */
+static int hsmImageHashDma(whServerContext* server, hsmImageHash* hash,
+    uint32_t type, uint64_t addr, uint64_t sz)
+{
+    int ret = 0;
+    int rc;
+    uint64_t len;
+    uint64_t nextLen;
+    void* cur = NULL;
+    void* next = NULL;
+    len = sz < WOLFHSM_SERVER_IMAGE_CHUNK_SZ ? sz :
+        WOLFHSM_SERVER_IMAGE_CHUNK_SZ;
+    if (len > 0) {
+        ret = hsmDmaClientAddress(server, addr, &cur, len,
+            WH_DMA_OPER_CLIENT_READ_PRE);
+    }
+    while (ret == 0 && len > 0) {
+        sz -= len;
+        nextLen = sz < WOLFHSM_SERVER_IMAGE_CHUNK_SZ ? sz :
+            WOLFHSM_SERVER_IMAGE_CHUNK_SZ;
+        if (nextLen > 0) {
+            ret = hsmDmaClientAddress(server, addr + len, &next, nextLen,
+                WH_DMA_OPER_CLIENT_READ_PRE);
+        }
+        if (ret == 0) {
+            ret = hsmImageHashUpdate(hash, type, (uint8_t*)cur,
+                (uint32_t)len);
+            if (ret != 0 && nextLen > 0) {
+                (void)hsmDmaClientAddress(server, addr + len, &next,
+                    nextLen, WH_DMA_OPER_CLIENT_READ_POST);
+            }
+        }
+        rc = hsmDmaClientAddress(server, addr, &cur, len,
+            WH_DMA_OPER_CLIENT_READ_POST);
+        if (ret == 0)
+            ret = rc;
+        addr += len;
+        len = nextLen;
+        cur = next;
+    }
+    return ret;
+}
+
+/* verify a signed image in client memory in a single request.  A signature
+ * that does not match only clears res, bad keys and DMA errors fail */
+static int hsmImageVerify(whServerContext* server, whPacket* packet,
+    uint16_t* size)
+{
+    int ret;
+    int res = 0;
+    uint8_t* sig;
+    uint8_t digest[WC_MAX_DIGEST_SIZE];
+    uint32_t digestSz = 0;
+    hsmImageHash hash[1];
+    wh_Packet_image_verify_req req;
+#ifdef HAVE_ECC
+    ecc_key* eccPublic = NULL;
+#endif
+#ifndef NO_RSA
+    RsaKey* rsa = NULL;
+    enum wc_HashType hashType;
+    uint8_t encoded[MAX_DER_DIGEST_SZ];
+    word32 encodedSz = 0;
+#endif
+    if (*size < WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->imageVerifyReq))
+        return BAD_FUNC_ARG;
+    /* the response overwrites the request */
+    XMEMCPY((uint8_t*)&req, (uint8_t*)&packet->imageVerifyReq, sizeof(req));
+    if (req.sigSz > *size - WOLFHSM_PACKET_STUB_SIZE - sizeof(req))
+        return BAD_FUNC_ARG;
+    /* sig is after the fixed size fields */
+    sig = (uint8_t*)(&packet->imageVerifyReq + 1);
+
+    ret = hsmImageHashInit(server, hash, req.hashType);
+    if (ret != 0)
+        return ret;
+    ret = hsmImageHashDma(server, hash, req.hashType, req.addr, req.sz);
+    if (ret == 0)
+        ret = hsmImageHashFinal(hash, req.hashType, digest, &digestSz);
+    else
+        (void)hsmImageHashFinal(hash, req.hashType, NULL, &digestSz);
+    if (ret != 0)
+        return ret;
+
+    switch (req.sigType) {
+#ifdef HAVE_ECC
+    case WH_IMAGE_SIG_ECC:
+        ret = hsmGetKeyEcc(server, (uint16_t)req.keyId, (int)req.curveId,
+            server->crypto->eccPublic, &eccPublic);
+        if (ret == 0) {
+            ret = wc_ecc_verify_hash(sig, req.sigSz, digest, digestSz, &res,
+                eccPublic);
+            hsmPutKeyEcc(server, eccPublic);
+        }
+        break;
+#endif
+#ifndef NO_RSA
+    case WH_IMAGE_SIG_RSA:
+        /* PKCS#1 v1.5 signs the DER encoded DigestInfo, which the hash level
+         * verify compares against as is */
+        hashType = (req.hashType == WH_HASH_SESSION_SHA256) ?
+            WC_HASH_TYPE_SHA256 : WC_HASH_TYPE_SHA384;
+        ret = wc_HashGetOID(hashType);
+        if (ret > 0) {
+            encodedSz = wc_EncodeSignature(encoded, digest, digestSz, ret);
+            ret = (encodedSz > 0) ? 0 : BAD_FUNC_ARG;
+        }
+        else if (ret == 0) {
+            ret = BAD_FUNC_ARG;
+        }
+        if (ret == 0) {
+            ret = hsmGetKeyRsa(server, (whKeyId)req.keyId,
+                server->crypto->rsa, &rsa);
+        }
+        if (ret == 0) {
+            ret = wc_SignatureVerifyHash(hashType,
+                WC_SIGNATURE_TYPE_RSA_W_ENC, encoded, encodedSz, sig,
+                req.sigSz, rsa, sizeof(*rsa));
+            /* a signature that does not decode is a mismatch */
+            if (ret == 0)
+                res = 1;
+            else if (ret == SIG_VERIFY_E || ret == RSA_PAD_E)
+                ret = 0;
+            hsmPutKeyRsa(server, rsa);
+        }
+        break;
+#endif
+    default:
+        ret = NOT_COMPILED_IN;
+        break;
+    }
+    if (ret == 0) {
+        packet->imageVerifyRes.res = (res == 1);
+        *size = WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->imageVerifyRes);
+    }
+    return ret;
+}
+
+int wh_Server_HandleImageRequest(whServerContext* server, uint16_t action,
+    uint8_t* data, uint16_t* size)
+{
+    int ret;
+    whPacket* packet = (whPacket*)data;
+    if (server == NULL || server->crypto == NULL || data == NULL ||
+            size == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+    switch (action) {
+    case WH_IMAGE_VERIFY:
+        ret = hsmImageVerify(server, packet, size);
+        break;
+    default:
+        ret = NOT_COMPILED_IN;
+        break;
+    }
+    packet->rc = ret;
+    if (ret != 0)
+        *size = WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->rc);
+    return 0;
+}
+#endif /* !WOLFHSM_SERVER_NO_GROUP_IMAGE */
+
+#ifndef WC_NO_RNG
+/* fill out with random bytes, using up the pool before generating more */
+static int hsmRngGenerate(whServerContext* server, uint8_t* out, uint32_t sz)
+{
+#if WOLFHSM_SERVER_RNG_POOL_SIZE > 0
+    uint32_t take = sz;
+    if (take > server->rngPoolLen)
+        take = server->rngPoolLen;
+    if (take > 0) {
+        /* pooled bytes are handed out once and wiped */
+        server->rngPoolLen -= take;
+        XMEMCPY(out, server->rngPool + server->rngPoolLen, take);
+        XMEMSET(server->rngPool + server->rngPoolLen, 0, take);
+        out += take;
+        sz -= take;
+    }
+#endif
+    if (sz == 0)
+        return 0;
+    return wc_RNG_GenerateBlock(server->crypto->rng, out, sz);
+}
+
+#if WOLFHSM_SERVER_RNG_POOL_SIZE > 0
+int wh_Server_CryptoRngPoolRefill(whServerContext* server)
+{
+    int ret;
+    uint32_t sz = WOLFHSM_SERVER_RNG_POOL_REFILL;
+    if (server == NULL || server->crypto == NULL)
+        return WH_ERROR_BADARGS;
+    if (server->rngPoolLen >= WOLFHSM_SERVER_RNG_POOL_SIZE)
+        return WH_ERROR_NOTREADY;
+    if (sz > WOLFHSM_SERVER_RNG_POOL_SIZE - server->rngPoolLen)
+        sz = WOLFHSM_SERVER_RNG_POOL_SIZE - server->rngPoolLen;
+    ret = wc_RNG_GenerateBlock(server->crypto->rng,
+        server->rngPool + server->rngPoolLen, sz);
+    if (ret == 0)
+        server->rngPoolLen += sz;
+    return ret;
+}
+#endif
+#endif /* !WC_NO_RNG */
+
 int wh_Server_HandleCryptoRequest(whServerContext* server,
     uint16_t action, uint8_t* data, uint16_t* size)
 {
@@ -206,8 +1481,18 @@ int wh_Server_HandleCryptoRequest(whServerContext* server,
     uint8_t* sig;
     uint8_t* hash;
     whPacket* packet = (whPacket*)data;
-#ifdef WOLFHSM_SYMMETRIC_INTERNAL
-    uint8_t tmpKey[AES_MAX_KEY_SIZE + AES_IV_SIZE];
+#ifndef NO_RSA
+    RsaKey* rsa = NULL;
+#endif
+#ifdef HAVE_ECC
+    ecc_key* eccPrivate = NULL;
+    ecc_key* eccPublic = NULL;
+#endif
+#ifndef NO_AES
+    Aes* aes = NULL;
+#endif
+#ifdef HAVE_CURVE25519
+    int devId;
 #endif
 
     if (server == NULL || server->crypto == NULL || data == NULL || size == NULL)
@@ -227,39 +1512,38 @@ int wh_Server_HandleCryptoRequest(whServerContext* server,
             in = iv + AES_IV_SIZE;
             out = (uint8_t*)(&packet->cipherAesCbcRes + 1);
 #ifdef WOLFHSM_SYMMETRIC_INTERNAL
-            /* load the key from keystore */
-            field = sizeof(tmpKey);
-            ret = hsmReadKey(server, *(uint32_t*)key | WOLFHSM_KEYTYPE_CRYPTO,
-                NULL, tmpKey, &field);
-            if (ret == 0) {
-                /* set key to use tmpKey data */
-                key = tmpKey;
-                /* overwrite keyLen with internal length */
-                packet->cipherAesCbcReq.keyLen = field;
-            }
-#endif
+            /* set up the key from keystore */
+            ret = hsmGetKeyAes(server, *(uint32_t*)key,
+                packet->cipherAesCbcReq.enc == 1 ?
+                HSM_AES_MODE_CBC_ENC : HSM_AES_MODE_CBC_DEC, iv, &aes);
+#else
+            aes = server->crypto->aes;
             /* init key with possible hardware */
-            if (ret == 0) {
-                ret = wc_AesInit(server->crypto->aes, NULL,
-                    server->crypto->devId);
-            }
+            ret = wc_AesInit(aes, NULL,
+                wh_Server_CryptoDevId(server, WH_SERVER_ENGINE_CAP_AES));
             /* load the key */
             if (ret == 0) {
-                ret = wc_AesSetKey(server->crypto->aes, key,
+                ret = wc_AesSetKey(aes, key,
                     packet->cipherAesCbcReq.keyLen, iv,
                     packet->cipherAesCbcReq.enc == 1 ?
                     AES_ENCRYPTION : AES_DECRYPTION);
             }
+#endif
             /* do the crypto operation */
             if (ret == 0) {
                 /* store this since it will be overwritten */
                 field = packet->cipherAesCbcReq.sz;
                 if (packet->cipherAesCbcReq.enc == 1)
-                    ret = wc_AesCbcEncrypt(server->crypto->aes, out, in, field);
+                    ret = wc_AesCbcEncrypt(aes, out, in, field);
                 else
-                    ret = wc_AesCbcDecrypt(server->crypto->aes, out, in, field);
+                    ret = wc_AesCbcDecrypt(aes, out, in, field);
             }
-            wc_AesFree(server->crypto->aes);
+#ifdef WOLFHSM_SYMMETRIC_INTERNAL
+            if (aes != NULL)
+                hsmPutKeyAes(server, aes);
+#else
+            wc_AesFree(aes);
+#endif
             /* encode the return sz */
             if (ret == 0) {
                 /* set sz */
@@ -278,27 +1562,20 @@ int wh_Server_HandleCryptoRequest(whServerContext* server,
             authIn = in + packet->cipherAesGcmReq.sz;
             out = (uint8_t*)(&packet->cipherAesGcmRes + 1);
 #ifdef WOLFHSM_SYMMETRIC_INTERNAL
-            /* load the key from keystore */
-            field = sizeof(tmpKey);
-            ret = hsmReadKey(server, *(uint32_t*)key | WOLFHSM_KEYTYPE_CRYPTO,
-                NULL, tmpKey, &field);
-            if (ret == 0) {
-                /* set key to use tmpKey data */
-                key = tmpKey;
-                /* overwrite keyLen with internal length */
-                packet->cipherAesGcmReq.keyLen = field;
-            }
-#endif
+            /* set up the key from keystore */
+            ret = hsmGetKeyAes(server, *(uint32_t*)key, HSM_AES_MODE_GCM, iv,
+                &aes);
+#else
+            aes = server->crypto->aes;
             /* init key with possible hardware */
-            if (ret == 0) {
-                ret = wc_AesInit(server->crypto->aes, NULL,
-                    server->crypto->devId);
-            }
+            ret = wc_AesInit(aes, NULL,
+                wh_Server_CryptoDevId(server, WH_SERVER_ENGINE_CAP_AES));
             /* load the key */
             if (ret == 0) {
-                ret = wc_AesGcmSetKey(server->crypto->aes, key,
+                ret = wc_AesGcmSetKey(aes, key,
                     packet->cipherAesGcmReq.keyLen);
             }
+#endif
             /* do the crypto operation */
             if (ret == 0) {
                 /* store this since it will be overwritten */
@@ -311,7 +1588,7 @@ int wh_Server_HandleCryptoRequest(whServerContext* server,
                     /* copy authTagSz since it will be overwritten */
                     packet->cipherAesGcmRes.authTagSz =
                         packet->cipherAesGcmReq.authTagSz;
-                    ret = wc_AesGcmEncrypt(server->crypto->aes, out, in, field,
+                    ret = wc_AesGcmEncrypt(aes, out, in, field,
                         iv, packet->cipherAesGcmReq.ivSz, authTag,
                         packet->cipherAesGcmReq.authTagSz, authIn,
                         packet->cipherAesGcmReq.authInSz);
@@ -319,13 +1596,18 @@ int wh_Server_HandleCryptoRequest(whServerContext* server,
                 else {
                     /* set authTag as a packet input */
                     authTag = authIn + packet->cipherAesGcmReq.authInSz;
-                    ret = wc_AesGcmDecrypt(server->crypto->aes, out, in, field,
+                    ret = wc_AesGcmDecrypt(aes, out, in, field,
                         iv, packet->cipherAesGcmReq.ivSz, authTag,
                         packet->cipherAesGcmReq.authTagSz, authIn,
                         packet->cipherAesGcmReq.authInSz);
                 }
             }
-            wc_AesFree(server->crypto->aes);
+#ifdef WOLFHSM_SYMMETRIC_INTERNAL
+            if (aes != NULL)
+                hsmPutKeyAes(server, aes);
+#else
+            wc_AesFree(aes);
+#endif
             /* encode the return sz */
             if (ret == 0) {
                 /* set sz */
@@ -347,20 +1629,24 @@ int wh_Server_HandleCryptoRequest(whServerContext* server,
 #ifndef NO_RSA
 #ifdef WOLFSSL_KEY_GEN
         case WC_PK_TYPE_RSA_KEYGEN:
-            /* init the rsa key */
-            ret = wc_InitRsaKey_ex(server->crypto->rsa, NULL, INVALID_DEVID);
-            /* make the rsa key with the given params */
-            if (ret == 0) {
-                ret = wc_MakeRsaKey(server->crypto->rsa,
-                    packet->pkRsakgReq.size,
-                    packet->pkRsakgReq.e,
-                    server->crypto->rng);
-            }
-            /* cache the generated key, data will be blown away */
-            if (ret == 0) {
-                ret = hsmCacheKeyRsa(server, server->crypto->rsa, &keyId);
+#if WOLFHSM_SERVER_MAX_JOBS > 0
+            if ((packet->flags & WOLFHSM_PACKET_FLAG_JOB) != 0) {
+                uint16_t jobId = 0;
+                /* run as a job, or synchronously if no job is free */
+                if (wh_Server_JobStart(server, hsmRsaKeyGenJob,
+                        WH_MESSAGE_KIND(WH_MESSAGE_GROUP_CRYPTO, action),
+                        sizeof(packet->pkRsakgReq), &packet->pkRsakgReq,
+                        &jobId) == 0) {
+                    packet->flags = WOLFHSM_PACKET_FLAG_JOB;
+                    packet->jobRes.jobId = jobId;
+                    *size = WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->jobRes);
+                    break;
+                }
             }
-            wc_FreeRsaKey(server->crypto->rsa);
+#endif
+            packet->flags = 0;
+            ret = hsmRsaKeyGen(server, packet->pkRsakgReq.size,
+                packet->pkRsakgReq.e, &keyId);
             if (ret == 0) {
                 /* set the assigned id */
                 packet->pkRsakgRes.keyId =
@@ -381,23 +1667,18 @@ int wh_Server_HandleCryptoRequest(whServerContext* server,
                     /* in and out are after the fixed size fields */
                     in = (uint8_t*)(&packet->pkRsaReq + 1);
                     out = (uint8_t*)(&packet->pkRsaRes + 1);
-                    /* init rsa key */
-                    ret = wc_InitRsaKey_ex(server->crypto->rsa, NULL,
-                        INVALID_DEVID);
                     /* load the key from the keystore */
-                    if (ret == 0) {
-                        ret = hsmLoadKeyRsa(server, server->crypto->rsa,
-                            packet->pkRsaReq.keyId);
-                    }
+                    ret = hsmGetKeyRsa(server, packet->pkRsaReq.keyId,
+                        server->crypto->rsa, &rsa);
                     /* do the rsa operation */
                     if (ret == 0) {
                         field = packet->pkRsaReq.outLen;
                         ret = wc_RsaFunction( in, packet->pkRsaReq.inLen,
                             out, (word32*)&field, packet->pkRsaReq.opType,
-                            server->crypto->rsa, server->crypto->rng);
+                            rsa, server->crypto->rng);
+                        /* release the key */
+                        hsmPutKeyRsa(server, rsa);
                     }
-                    /* free the key */
-                    wc_FreeRsaKey(server->crypto->rsa);
                     if (ret == 0) {
                         /*set outLen */
                         packet->pkRsaRes.outLen = field;
@@ -408,18 +1689,14 @@ int wh_Server_HandleCryptoRequest(whServerContext* server,
             }
             break;
         case WC_PK_TYPE_RSA_GET_SIZE:
-            /* init rsa key */
-            ret = wc_InitRsaKey_ex(server->crypto->rsa, NULL,
-                server->crypto->devId);
             /* load the key from the keystore */
+            ret = hsmGetKeyRsa(server, packet->pkRsaGetSizeReq.keyId,
+                server->crypto->rsa, &rsa);
+            /* get the size */
             if (ret == 0) {
-                ret = hsmLoadKeyRsa(server, server->crypto->rsa,
-                    packet->pkRsaGetSizeReq.keyId);
+                ret = wc_RsaEncryptSize(rsa);
+                hsmPutKeyRsa(server, rsa);
             }
-            /* get the size */
-            if (ret == 0)
-                ret = wc_RsaEncryptSize(server->crypto->rsa);
-            wc_FreeRsaKey(server->crypto->rsa);
             if (ret > 0) {
                 /*set keySize */
                 packet->pkRsaGetSizeRes.keySize = ret;
@@ -433,7 +1710,7 @@ int wh_Server_HandleCryptoRequest(whServerContext* server,
         case WC_PK_TYPE_EC_KEYGEN:
             /* init ecc key */
             ret = wc_ecc_init_ex(server->crypto->eccPrivate, NULL,
-                server->crypto->devId);
+                wh_Server_CryptoDevId(server, WH_SERVER_ENGINE_CAP_PK));
             /* generate the key the key */
             if (ret == 0) {
                 ret = wc_ecc_make_key_ex(server->crypto->rng,
@@ -453,35 +1730,28 @@ int wh_Server_HandleCryptoRequest(whServerContext* server,
         case WC_PK_TYPE_ECDH:
             /* out is after the fixed size fields */
             out = (uint8_t*)(&packet->pkEcdhRes + 1);
-            /* init ecc key */
-            ret = wc_ecc_init_ex(server->crypto->eccPrivate, NULL,
-                server->crypto->devId);
-            if (ret == 0)
-                ret = wc_ecc_init_ex(server->crypto->eccPrivate, NULL,
-                    server->crypto->devId);
             /* load the private key */
+            ret = hsmGetKeyEcc(server, packet->pkEcdhReq.privateKeyId,
+                packet->pkEcdhReq.curveId, server->crypto->eccPrivate,
+                &eccPrivate);
             if (ret == 0) {
-                ret = hsmLoadKeyEcc(server, server->crypto->eccPrivate,
-                    packet->pkEcdhReq.privateKeyId, packet->pkEcdhReq.curveId);
-            }
-            /* set rng */
-            if (ret == 0) {
-                ret = wc_ecc_set_rng(server->crypto->eccPrivate,
-                    server->crypto->rng);
-            }
-            /* load the public key */
-            if (ret == 0) {
-                ret = hsmLoadKeyEcc(server, server->crypto->eccPublic,
-                    packet->pkEcdhReq.publicKeyId, packet->pkEcdhReq.curveId);
-            }
-            /* make shared secret */
-            if (ret == 0) {
-                field = server->crypto->eccPrivate->dp->size;
-                ret = wc_ecc_shared_secret(server->crypto->eccPrivate,
-                    server->crypto->eccPublic, out, &field);
+                /* set rng */
+                ret = wc_ecc_set_rng(eccPrivate, server->crypto->rng);
+                /* load the public key */
+                if (ret == 0) {
+                    ret = hsmGetKeyEcc(server, packet->pkEcdhReq.publicKeyId,
+                        packet->pkEcdhReq.curveId, server->crypto->eccPublic,
+                        &eccPublic);
+                }
+                /* make shared secret */
+                if (ret == 0) {
+                    field = eccPrivate->dp->size;
+                    ret = wc_ecc_shared_secret(eccPrivate, eccPublic, out,
+                        &field);
+                    hsmPutKeyEcc(server, eccPublic);
+                }
+                hsmPutKeyEcc(server, eccPrivate);
             }
-            wc_ecc_free(server->crypto->eccPrivate);
-            wc_ecc_free(server->crypto->eccPublic);
             if (ret == 0) {
                 packet->pkEcdhRes.sz = field;
                 *size = WOLFHSM_PACKET_STUB_SIZE +
@@ -492,21 +1762,17 @@ int wh_Server_HandleCryptoRequest(whServerContext* server,
             /* in and out are after the fixed size fields */
             in = (uint8_t*)(&packet->pkEccSignReq + 1);
             out = (uint8_t*)(&packet->pkEccSignRes + 1);
-            /* init pivate key */
-            ret = wc_ecc_init_ex(server->crypto->eccPrivate, NULL,
-                server->crypto->devId);
             /* load the private key */
-            if (ret == 0) {
-                ret = hsmLoadKeyEcc(server, server->crypto->eccPrivate,
-                    packet->pkEccSignReq.keyId, packet->pkEccSignReq.curveId);
-            }
+            ret = hsmGetKeyEcc(server, packet->pkEccSignReq.keyId,
+                packet->pkEccSignReq.curveId, server->crypto->eccPrivate,
+                &eccPrivate);
             /* sign the input */
             if (ret == 0) {
                 field = WH_COMM_MTU - sizeof(packet->pkEccSignRes);
                 ret = wc_ecc_sign_hash(in, packet->pkEccSignReq.sz, out,
-                    &field, server->crypto->rng, server->crypto->eccPrivate);
+                    &field, server->crypto->rng, eccPrivate);
+                hsmPutKeyEcc(server, eccPrivate);
             }
-            wc_ecc_free(server->crypto->eccPrivate);
             if (ret == 0) {
                 packet->pkEccSignRes.sz = field;
                 *size = WOLFHSM_PACKET_STUB_SIZE +
@@ -518,22 +1784,16 @@ int wh_Server_HandleCryptoRequest(whServerContext* server,
             sig = (uint8_t*)(&packet->pkEccVerifyReq + 1);
             hash = (uint8_t*)(&packet->pkEccVerifyReq + 1) +
                 packet->pkEccVerifyReq.sigSz;
-            /* init public key */
-            ret = wc_ecc_init_ex(server->crypto->eccPublic, NULL,
-                server->crypto->devId);
             /* load the public key */
-            if (ret == 0) {
-                ret = hsmLoadKeyEcc(server, server->crypto->eccPublic,
-                    packet->pkEccVerifyReq.keyId,
-                    packet->pkEccVerifyReq.curveId);
-            }
+            ret = hsmGetKeyEcc(server, packet->pkEccVerifyReq.keyId,
+                packet->pkEccVerifyReq.curveId, server->crypto->eccPublic,
+                &eccPublic);
             /* verify the signature */
             if (ret == 0) {
                 ret = wc_ecc_verify_hash(sig, packet->pkEccVerifyReq.sigSz,
-                    hash, packet->pkEccVerifyReq.hashSz, &res,
-                    server->crypto->eccPublic);
+                    hash, packet->pkEccVerifyReq.hashSz, &res, eccPublic);
+                hsmPutKeyEcc(server, eccPublic);
             }
-            wc_ecc_free(server->crypto->eccPublic);
             if (ret == 0) {
                 packet->pkEccVerifyRes.res = res;
                 *size = WOLFHSM_PACKET_STUB_SIZE +
@@ -541,19 +1801,15 @@ int wh_Server_HandleCryptoRequest(whServerContext* server,
             }
             break;
         case WC_PK_TYPE_EC_CHECK_PRIV_KEY:
-            /* init pivate key */
-            ret = wc_ecc_init_ex(server->crypto->eccPrivate, NULL,
-                server->crypto->devId);
             /* load the private key */
-            if (ret == 0) {
-                ret = hsmLoadKeyEcc(server, server->crypto->eccPrivate,
-                    packet->pkEccCheckReq.keyId, packet->pkEccCheckReq.curveId);
-            }
+            ret = hsmGetKeyEcc(server, packet->pkEccCheckReq.keyId,
+                packet->pkEccCheckReq.curveId, server->crypto->eccPrivate,
+                &eccPrivate);
             /* check the key */
             if (ret == 0) {
-                ret = wc_ecc_check_key(server->crypto->eccPrivate);
+                ret = wc_ecc_check_key(eccPrivate);
+                hsmPutKeyEcc(server, eccPrivate);
             }
-            wc_ecc_free(server->crypto->eccPrivate);
             if (ret == 0) {
                 packet->pkEccCheckRes.ok = 1;
                 *size = WOLFHSM_PACKET_STUB_SIZE +
@@ -565,7 +1821,7 @@ int wh_Server_HandleCryptoRequest(whServerContext* server,
         case WC_PK_TYPE_CURVE25519_KEYGEN:
             /* init private key */
             ret = wc_curve25519_init_ex(server->crypto->curve25519Private, NULL,
-                server->crypto->devId);
+                wh_Server_CryptoDevId(server, WH_SERVER_ENGINE_CAP_PK));
             /* make the key */
             if (ret == 0) {
                 ret = wc_curve25519_make_key(server->crypto->rng,
@@ -592,12 +1848,13 @@ int wh_Server_HandleCryptoRequest(whServerContext* server,
         case WC_PK_TYPE_CURVE25519:
             /* out is after the fixed size fields */
             out = (uint8_t*)(&packet->pkCurve25519Res + 1);
-            /* init ecc key */
+            /* init both keys on the same engine */
+            devId = wh_Server_CryptoDevId(server, WH_SERVER_ENGINE_CAP_PK);
             ret = wc_curve25519_init_ex(server->crypto->curve25519Private, NULL,
-                server->crypto->devId);
+                devId);
             if (ret == 0) {
                 ret = wc_curve25519_init_ex(server->crypto->curve25519Public,
-                    NULL, server->crypto->devId);
+                    NULL, devId);
             }
             /* load the private key */
             if (ret == 0) {
@@ -641,14 +1898,37 @@ int wh_Server_HandleCryptoRequest(whServerContext* server,
     case WC_ALGO_TYPE_RNG:
         /* out is after the fixed size fields */
         out = (uint8_t*)(&packet->rngRes + 1);
+        /* one response worth at most */
+        if (packet->rngReq.sz > WOLFHSM_PACKET_RNG_MAX_SZ)
+            packet->rngReq.sz = WOLFHSM_PACKET_RNG_MAX_SZ;
         /* generate the bytes */
-        ret = wc_RNG_GenerateBlock(server->crypto->rng, out, packet->rngReq.sz);
+        ret = hsmRngGenerate(server, out, packet->rngReq.sz);
         if (ret == 0) {
             *size = WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->rngRes) +
                 packet->rngRes.sz;
         }
         break;
 #endif /* !WC_NO_RNG */
+#if !defined(NO_AES) && WOLFHSM_SERVER_MAX_CIPHER_SESSIONS > 0
+    case WH_CRYPTO_CIPHER_SESSION:
+        ret = hsmCipherSession(server, packet, size);
+        break;
+#endif
+#ifndef NO_AES
+    case WH_CRYPTO_CIPHER_DMA:
+        ret = hsmCipherDma(server, packet, size);
+        break;
+#endif
+#if WOLFHSM_SERVER_MAX_HASH_SESSIONS > 0
+    case WH_CRYPTO_HASH_SESSION:
+        ret = hsmHashSession(server, packet, size);
+        break;
+#endif
+#ifdef HAVE_ECC
+    case WH_CRYPTO_ECC_VERIFY_BATCH:
+        ret = hsmEccVerifyBatch(server, packet, size);
+        break;
+#endif
     case WC_ALGO_TYPE_NONE:
     default:
         ret = NOT_COMPILED_IN;
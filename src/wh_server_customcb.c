@@ -16,8 +16,12 @@
  * You should have received a copy of the GNU General Public License
  * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
  */
+#include <stdint.h>
+#include <string.h> /* For memset */
+
 #include "wolfhsm/wh_server.h"
 #include "wolfhsm/wh_common.h"
+#include "wolfhsm/wh_comm.h"
 #include "wolfhsm/wh_error.h"
 #include "wolfhsm/wh_message.h"
 #include "wolfhsm/wh_message_customcb.h"
@@ -37,6 +41,126 @@ int wh_Server_RegisterCustomCb(whServerContext* server, uint16_t action,
 }
 
 
+int wh_Server_RegisterCustomRawCb(whServerContext* server, uint32_t id,
+                                  whServerCustomRawCb cb)
+{
+#if WOLFHSM_SERVER_MAX_CUSTOM_CBS > 0
+    whServerCustomRawEntry* entry = NULL;
+    int                     i     = 0;
+
+    if (NULL == server) {
+        return WH_ERROR_BADARGS;
+    }
+
+    for (i = 0; i < WOLFHSM_SERVER_MAX_CUSTOM_CBS; i++) {
+        whServerCustomRawEntry* e = &server->customRawTable[i];
+        if ((e->cb != NULL) && (e->id == id)) {
+            entry = e;
+            break;
+        }
+        if ((e->cb == NULL) && (entry == NULL)) {
+            entry = e;
+        }
+    }
+
+    if (cb == NULL) {
+        /* Remove the callback, if any */
+        if ((entry != NULL) && (entry->cb != NULL) && (entry->id == id)) {
+            memset(entry, 0, sizeof(*entry));
+        }
+        return WH_ERROR_OK;
+    }
+
+    if (entry == NULL) {
+        return WH_ERROR_NOSPACE;
+    }
+    entry->id = id;
+    entry->cb = cb;
+    return WH_ERROR_OK;
+#else
+    (void)server;
+    (void)id;
+    (void)cb;
+    return WH_ERROR_NOSPACE;
+#endif
+}
+
+
+static whServerCustomRawCb _FindCustomRawCb(whServerContext* server,
+                                            uint32_t id)
+{
+#if WOLFHSM_SERVER_MAX_CUSTOM_CBS > 0
+    int i = 0;
+    for (i = 0; i < WOLFHSM_SERVER_MAX_CUSTOM_CBS; i++) {
+        if ((server->customRawTable[i].cb != NULL) &&
+            (server->customRawTable[i].id == id)) {
+            return server->customRawTable[i].cb;
+        }
+    }
+#else
+    (void)server;
+    (void)id;
+#endif
+    return NULL;
+}
+
+
+/* Invoke a raw callback on the payload following the request header.  The
+ * payload is not copied, so the callback works directly in the comm or
+ * reassembly buffer */
+static int _HandleCustomCbRaw(whServerContext* server, uint16_t magic,
+                              uint16_t req_size, const void* req_packet,
+                              uint16_t* out_resp_size, void* resp_packet)
+{
+    int                           rc        = 0;
+    whMessageCustomCb_RawRequest  req       = {0};
+    whMessageCustomCb_RawResponse resp      = {0};
+    whServerCustomRawCb           cb        = NULL;
+    uint16_t                      resp_size = 0;
+
+    if (req_size < sizeof(req)) {
+        /* Request is malformed */
+        return WH_ERROR_ABORTED;
+    }
+
+    if ((rc = wh_MessageCustomCb_TranslateRawRequest(magic, req_packet,
+                                                     &req)) != WH_ERROR_OK) {
+        return rc;
+    }
+
+    cb = _FindCustomRawCb(server, req.id);
+    if (cb != NULL) {
+        resp_size = WH_COMM_DATA_LEN - sizeof(resp);
+        resp.rc   = cb(server, req.id, req.type,
+                       (const uint8_t*)req_packet + sizeof(req),
+                       req_size - sizeof(req),
+                       (uint8_t*)resp_packet + sizeof(resp), &resp_size);
+        if (resp_size > WH_COMM_DATA_LEN - sizeof(resp)) {
+            /* Callback overran the response buffer */
+            return WH_ERROR_ABORTED;
+        }
+        resp.err = WH_ERROR_OK;
+    }
+    else {
+        /* No callback was registered, populate response error */
+        resp.err = WH_ERROR_NOHANDLER;
+    }
+    resp.id   = req.id;
+    resp.type = req.type;
+
+    /* Written after the callback, as it shares space with the request header
+     * when handled in place */
+    if ((rc = wh_MessageCustomCb_TranslateRawResponse(
+             magic, &resp, resp_packet)) != WH_ERROR_OK) {
+        return rc;
+    }
+
+    *out_resp_size = sizeof(resp) + resp_size;
+
+    return WH_ERROR_OK;
+}
+
+
 int wh_Server_HandleCustomCbRequest(whServerContext* server, uint16_t magic,
                                     uint16_t action, uint16_t seq,
                                     uint16_t req_size, const void* req_packet,
@@ -51,6 +175,11 @@ int wh_Server_HandleCustomCbRequest(whServerContext* server, uint16_t magic,
         return WH_ERROR_BADARGS;
     }
 
+    if (action == WH_MESSAGE_CUSTOM_CB_ACTION_RAW) {
+        return _HandleCustomCbRaw(server, magic, req_size, req_packet,
+                                  out_resp_size, resp_packet);
+    }
+
     if (action >= WH_CUSTOM_CB_NUM_CALLBACKS) {
         /* Invalid callback index  */
         /* TODO: is this the appropriate error to return? */
@@ -27,10 +27,6 @@
 #include "wolfhsm/wh_error.h"
 #include "wolfhsm/wh_server.h"
 
-/* TODO: if the Address allowlist ever gets large, we should consider a more
- * efficient representation (requiring sorted array and binary search, or
- * building a binary tree, etc.) */
-
 static int _checkOperValid(whServerDmaOper oper)
 {
     if (oper < WH_DMA_OPER_CLIENT_READ_PRE ||
@@ -41,37 +37,115 @@ static int _checkOperValid(whServerDmaOper oper)
     return WH_ERROR_OK;
 }
 
-static int _checkAddrAgainstAllowList(const whServerDmaAddrList allowList, void* addr,
-                                      size_t size)
+/* Sort the regions of allowList by address and merge those that overlap or
+ * touch, so a range is allowed when the interval starting at or before it
+ * also covers its end */
+static int _buildAddrIndex(const whServerDmaAddrList allowList,
+                           whServerDmaAddrIndex* index)
+{
+    uintptr_t start = 0;
+    uintptr_t end   = 0;
+    size_t    count = 0;
+    size_t    pos   = 0;
+    int       i     = 0;
+
+    for (i = 0; i < WH_DMA_ADDR_ALLOWLIST_COUNT; i++) {
+        if (0 == allowList[i].size) {
+            continue;
+        }
+        start = (uintptr_t)allowList[i].addr;
+        end   = start + allowList[i].size;
+        if (end < start) {
+            /* Region wraps the address space */
+            return WH_ERROR_BADARGS;
+        }
+
+        /* Insertion sort by start address */
+        pos = count;
+        while ((pos > 0) && (index->start[pos - 1] > start)) {
+            index->start[pos] = index->start[pos - 1];
+            index->end[pos]   = index->end[pos - 1];
+            pos--;
+        }
+        index->start[pos] = start;
+        index->end[pos]   = end;
+        count++;
+    }
+
+    /* Merge each interval into the previous one when they meet */
+    index->count = 0;
+    for (pos = 0; pos < count; pos++) {
+        if ((index->count > 0) &&
+            (index->start[pos] <= index->end[index->count - 1])) {
+            if (index->end[pos] > index->end[index->count - 1]) {
+                index->end[index->count - 1] = index->end[pos];
+            }
+            continue;
+        }
+        index->start[index->count] = index->start[pos];
+        index->end[index->count]   = index->end[pos];
+        index->count++;
+    }
+    return WH_ERROR_OK;
+}
+
+/* Check the range against the index, trying the interval in *hit first and
+ * updating it on a match.  hit may be NULL */
+static int _checkAddrAgainstIndex(const whServerDmaAddrIndex* index,
+                                  uint16_t* hit, void* addr, size_t size)
 {
     uintptr_t startAddr = (uintptr_t)addr;
     uintptr_t endAddr   = startAddr + size;
-    int i = 0;
+    size_t    lo        = 0;
+    size_t    hi        = index->count;
+    size_t    mid       = 0;
 
     if (0 == size) {
         return WH_ERROR_BADARGS;
     }
+    if (endAddr < startAddr) {
+        return WH_ERROR_ACCESS;
+    }
 
-    /* Check if the address range is fully within a allowlist entry */
-    for (i = 0; i < WH_DMA_ADDR_ALLOWLIST_COUNT; i++) {
-        uintptr_t allowListStartAddr = (uintptr_t)allowList[i].addr;
-        uintptr_t allowListEndAddr   = allowListStartAddr + allowList[i].size;
-
-        if (0 == allowList[i].size) {
-            continue;
+    /* Transfers of one client tend to hit the same buffer */
+    if ((NULL != hit) && (0 != *hit) && (*hit <= index->count)) {
+        mid = *hit - 1;
+        if (startAddr >= index->start[mid] && endAddr <= index->end[mid]) {
+            return WH_ERROR_OK;
         }
+    }
 
-        if (startAddr >= allowListStartAddr && endAddr <= allowListEndAddr) {
-            return WH_ERROR_OK;
+    /* Find the last interval starting at or before the range */
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (index->start[mid] <= startAddr) {
+            lo = mid + 1;
+        }
+        else {
+            hi = mid;
         }
     }
+    if ((lo > 0) && (endAddr <= index->end[lo - 1])) {
+        if (NULL != hit) {
+            *hit = (uint16_t)lo;
+        }
+        return WH_ERROR_OK;
+    }
 
     return WH_ERROR_ACCESS;
 }
 
+/* Last-hit entries of the client of the current request */
+static uint16_t* _clientHits(whServerContext* server)
+{
+    uint8_t clientId = (NULL != server->comm) ? server->comm->client_id : 0;
+
+    return server->dma.lastHit[clientId % WH_DMA_ADDR_ALLOWLIST_CACHE_CLIENTS];
+}
+
 static int _checkMemOperAgainstAllowList(const whServerContext* server,
                                          whServerDmaOper oper, void* addr,
-                                         size_t size)
+                                         size_t size, uint16_t* hits)
 {
     int rc = WH_ERROR_OK;
 
@@ -92,10 +166,14 @@ static int _checkMemOperAgainstAllowList(const whServerContext* server,
      * memory operations for some reason?
      */
     if (oper == WH_DMA_OPER_CLIENT_READ_PRE) {
-        rc = _checkAddrAgainstAllowList(server->dma.dmaAddrAllowList->readList, addr, size);
+        rc = _checkAddrAgainstIndex(&server->dma.readIndex,
+                                    (NULL != hits) ? &hits[0] : NULL, addr,
+                                    size);
     }
     else if (oper == WH_DMA_OPER_CLIENT_WRITE_PRE) {
-        rc = _checkAddrAgainstAllowList(server->dma.dmaAddrAllowList->writeList, addr, size);
+        rc = _checkAddrAgainstIndex(&server->dma.writeIndex,
+                                    (NULL != hits) ? &hits[1] : NULL, addr,
+                                    size);
     }
 
     return rc;
@@ -109,7 +187,7 @@ int wh_Server_DmaCheckMemOperAllowed(const whServerContext* server,
         return WH_ERROR_BADARGS;
     }
 
-    return _checkMemOperAgainstAllowList(server, oper, addr, size);
+    return _checkMemOperAgainstAllowList(server, oper, addr, size, NULL);
 }
 
 int wh_Server_DmaRegisterCb32(whServerContext* server, whServerDmaClientMem32Cb cb)
@@ -141,27 +219,72 @@ int wh_Server_DmaRegisterCb64(whServerContext* server, whServerDmaClientMem64Cb
 int wh_Server_DmaRegisterAllowList(whServerContext*                server,
                                    const whServerDmaAddrAllowList* allowlist)
 {
+    whServerDmaAddrIndex readIndex;
+    whServerDmaAddrIndex writeIndex;
+    int                  rc = WH_ERROR_OK;
+
     if (NULL == server || NULL == allowlist) {
         return WH_ERROR_BADARGS;
     }
 
+    /* Leave the current allowlist in place if the new one is invalid */
+    rc = _buildAddrIndex(allowlist->readList, &readIndex);
+    if (rc == WH_ERROR_OK) {
+        rc = _buildAddrIndex(allowlist->writeList, &writeIndex);
+    }
+    if (rc != WH_ERROR_OK) {
+        return rc;
+    }
+
+    /* Mappings were only checked against the previous allowlist */
+    wh_Server_DmaUnmapAll(server);
+
+    server->dma.readIndex        = readIndex;
+    server->dma.writeIndex       = writeIndex;
     server->dma.dmaAddrAllowList = allowlist;
+    memset(server->dma.lastHit, 0, sizeof(server->dma.lastHit));
 
     return WH_ERROR_OK;
 }
 
 
-int wh_Server_DmaProcessClientAddress32(whServerContext* server,
-                                        uint32_t         clientAddr,
-                                        void** xformedCliAddr, uint32_t len,
-                                        whServerDmaOper  oper,
-                                        whServerDmaFlags flags)
+/* Resolve an operation of the current client within one of its mapped
+ * buffers.  Returns 1 with the server pointer set when found, else 0 */
+static int _findMapping(whServerContext* server, uint64_t clientAddr,
+                        uint64_t len, whServerDmaOper oper, void** serverPtr)
 {
-    int rc = WH_ERROR_OK;
+    const whServerDmaMapping* map = NULL;
+    uint16_t owner = 0;
+    uint8_t  access = 0;
+    int      i = 0;
 
-    if (NULL == server || NULL == xformedCliAddr) {
-        return WH_ERROR_BADARGS;
+    if (NULL == server->comm || 0 == len || _checkOperValid(oper) != 0) {
+        return 0;
+    }
+    owner  = (uint16_t)(server->comm->client_id + 1);
+    access = (oper <= WH_DMA_OPER_CLIENT_READ_POST) ? WH_DMA_MAP_READ :
+                                                      WH_DMA_MAP_WRITE;
+
+    for (i = 0; i < WH_DMA_MAP_COUNT; i++) {
+        map = &server->dma.maps[i];
+        if (map->owner == owner && (map->access & access) != 0 &&
+            clientAddr >= map->clientAddr && len <= map->len &&
+            clientAddr - map->clientAddr <= map->len - len) {
+            *serverPtr = (uint8_t*)map->serverPtr +
+                         (size_t)(clientAddr - map->clientAddr);
+            return 1;
+        }
     }
+    return 0;
+}
+
+static int _processClientAddress32(whServerContext* server,
+                                   uint32_t         clientAddr,
+                                   void** xformedCliAddr, uint32_t len,
+                                   whServerDmaOper  oper,
+                                   whServerDmaFlags flags)
+{
+    int rc = WH_ERROR_OK;
 
     /* Transformed address defaults to raw client address */
     *xformedCliAddr = (void*)((uintptr_t)clientAddr);
@@ -177,20 +300,17 @@ int wh_Server_DmaProcessClientAddress32(whServerContext* server,
 
     /* if the server has a allowlist registered, check transformed address
      * against it */
-    return _checkMemOperAgainstAllowList(server, oper, *xformedCliAddr, len);
+    return _checkMemOperAgainstAllowList(server, oper, *xformedCliAddr, len,
+                                         _clientHits(server));
 }
 
-int wh_Server_DmaProcessClientAddress64(whServerContext* server,
-                                        uint64_t         clientAddr,
-                                        void** xformedCliAddr, uint64_t len,
-                                        whServerDmaOper oper, whServerDmaFlags flags)
+static int _processClientAddress64(whServerContext* server,
+                                   uint64_t         clientAddr,
+                                   void** xformedCliAddr, uint64_t len,
+                                   whServerDmaOper oper, whServerDmaFlags flags)
 {
     int rc = WH_ERROR_OK;
 
-    if (NULL == server || NULL == xformedCliAddr) {
-        return WH_ERROR_BADARGS;
-    }
-
     /* Transformed address defaults to raw client address */
     *xformedCliAddr = (void*)((uintptr_t)clientAddr);
 
@@ -204,7 +324,213 @@ int wh_Server_DmaProcessClientAddress64(whServerContext* server,
     }
 
     /* if the server has a allowlist registered, check address against it */
-    return _checkMemOperAgainstAllowList(server, oper, *xformedCliAddr, len);
+    return _checkMemOperAgainstAllowList(server, oper, *xformedCliAddr, len,
+                                         _clientHits(server));
+}
+
+/* Process through the callbacks, ignoring mapped buffers */
+static int _processClientAddress(whServerContext* server, uint64_t clientAddr,
+                                 void** xformedCliAddr, uint64_t len,
+                                 whServerDmaOper oper, whServerDmaFlags flags)
+{
+    /* Only go through the 32-bit callback when it is the one registered */
+    if (NULL == server->dma.cb64 && NULL != server->dma.cb32) {
+        if (clientAddr > UINT32_MAX || len > UINT32_MAX) {
+            return WH_ERROR_BADARGS;
+        }
+        return _processClientAddress32(server, (uint32_t)clientAddr,
+                                       xformedCliAddr, (uint32_t)len, oper,
+                                       flags);
+    }
+    return _processClientAddress64(server, clientAddr, xformedCliAddr, len,
+                                   oper, flags);
+}
+
+int wh_Server_DmaProcessClientAddress32(whServerContext* server,
+                                        uint32_t         clientAddr,
+                                        void** xformedCliAddr, uint32_t len,
+                                        whServerDmaOper  oper,
+                                        whServerDmaFlags flags)
+{
+    if (NULL == server || NULL == xformedCliAddr) {
+        return WH_ERROR_BADARGS;
+    }
+    if (_findMapping(server, clientAddr, len, oper, xformedCliAddr)) {
+        return WH_ERROR_OK;
+    }
+    return _processClientAddress32(server, clientAddr, xformedCliAddr, len,
+                                   oper, flags);
+}
+
+int wh_Server_DmaProcessClientAddress64(whServerContext* server,
+                                        uint64_t         clientAddr,
+                                        void** xformedCliAddr, uint64_t len,
+                                        whServerDmaOper oper, whServerDmaFlags flags)
+{
+    if (NULL == server || NULL == xformedCliAddr) {
+        return WH_ERROR_BADARGS;
+    }
+    if (_findMapping(server, clientAddr, len, oper, xformedCliAddr)) {
+        return WH_ERROR_OK;
+    }
+    return _processClientAddress64(server, clientAddr, xformedCliAddr, len,
+                                   oper, flags);
+}
+
+int wh_Server_DmaProcessClientAddress(whServerContext* server,
+                                      uint64_t clientAddr,
+                                      void** xformedCliAddr, uint64_t len,
+                                      whServerDmaOper oper,
+                                      whServerDmaFlags flags)
+{
+    if (NULL == server || NULL == xformedCliAddr) {
+        return WH_ERROR_BADARGS;
+    }
+    if (_findMapping(server, clientAddr, len, oper, xformedCliAddr)) {
+        return WH_ERROR_OK;
+    }
+    return _processClientAddress(server, clientAddr, xformedCliAddr, len, oper,
+                                 flags);
+}
+
+/* Process the POST operations of a mapping and free it */
+static void _unmap(whServerContext* server, whServerDmaMapping* map)
+{
+    whServerDmaFlags flags = {0};
+    void*            ptr   = map->serverPtr;
+
+    /* Errors are ignored, the mapping is released regardless */
+    if ((map->access & WH_DMA_MAP_WRITE) != 0) {
+        (void)_processClientAddress(server, map->clientAddr, &ptr, map->len,
+                                    WH_DMA_OPER_CLIENT_WRITE_POST, flags);
+    }
+    ptr = map->serverPtr;
+    if ((map->access & WH_DMA_MAP_READ) != 0) {
+        (void)_processClientAddress(server, map->clientAddr, &ptr, map->len,
+                                    WH_DMA_OPER_CLIENT_READ_POST, flags);
+    }
+    map->owner      = 0;
+    map->access     = 0;
+    map->serverPtr  = NULL;
+    map->clientAddr = 0;
+    map->len        = 0;
+    map->generation++;
+}
+
+int wh_Server_DmaMapClientAddress(whServerContext* server, uint64_t clientAddr,
+                                  uint64_t len, uint8_t access,
+                                  uint32_t* out_handle)
+{
+    whServerDmaMapping* map       = NULL;
+    whServerDmaFlags    flags     = {0};
+    void*               readPtr   = NULL;
+    void*               writePtr  = NULL;
+    int                 rc        = WH_ERROR_OK;
+    int                 i         = 0;
+
+    if (NULL == server || NULL == server->comm || NULL == out_handle ||
+        0 == len || clientAddr + len < clientAddr || len > SIZE_MAX ||
+        0 == access ||
+        (access & ~(WH_DMA_MAP_READ | WH_DMA_MAP_WRITE)) != 0) {
+        return WH_ERROR_BADARGS;
+    }
+
+    for (i = 0; i < WH_DMA_MAP_COUNT; i++) {
+        if (0 == server->dma.maps[i].owner) {
+            map = &server->dma.maps[i];
+            break;
+        }
+    }
+    if (NULL == map) {
+        return WH_ERROR_NOSPACE;
+    }
+
+    if ((access & WH_DMA_MAP_READ) != 0) {
+        rc = _processClientAddress(server, clientAddr, &readPtr, len,
+                                   WH_DMA_OPER_CLIENT_READ_PRE, flags);
+        if (rc != WH_ERROR_OK) {
+            return rc;
+        }
+    }
+    if ((access & WH_DMA_MAP_WRITE) != 0) {
+        rc = _processClientAddress(server, clientAddr, &writePtr, len,
+                                   WH_DMA_OPER_CLIENT_WRITE_PRE, flags);
+        if (rc == WH_ERROR_OK && (access & WH_DMA_MAP_READ) != 0 &&
+            writePtr != readPtr) {
+            /* Each direction was given its own buffer, so they cannot be
+             * shared by later operations */
+            (void)_processClientAddress(server, clientAddr, &writePtr, len,
+                                        WH_DMA_OPER_CLIENT_WRITE_POST, flags);
+            rc = WH_ERROR_BADARGS;
+        }
+        if (rc != WH_ERROR_OK) {
+            if ((access & WH_DMA_MAP_READ) != 0) {
+                (void)_processClientAddress(server, clientAddr, &readPtr, len,
+                                            WH_DMA_OPER_CLIENT_READ_POST,
+                                            flags);
+            }
+            return rc;
+        }
+        readPtr = writePtr;
+    }
+
+    map->clientAddr = clientAddr;
+    map->len        = len;
+    map->serverPtr  = readPtr;
+    map->access     = access;
+    map->owner      = (uint16_t)(server->comm->client_id + 1);
+    *out_handle = ((uint32_t)map->generation << 16) | (uint32_t)(i + 1);
+    return WH_ERROR_OK;
+}
+
+int wh_Server_DmaUnmapClientAddress(whServerContext* server, uint32_t handle)
+{
+    whServerDmaMapping* map   = NULL;
+    uint32_t            index = (handle & 0xFFFF);
+
+    if (NULL == server || NULL == server->comm) {
+        return WH_ERROR_BADARGS;
+    }
+    if (0 == index || index > WH_DMA_MAP_COUNT) {
+        return WH_ERROR_NOTFOUND;
+    }
+    map = &server->dma.maps[index - 1];
+    if (0 == map->owner || map->generation != (uint16_t)(handle >> 16)) {
+        return WH_ERROR_NOTFOUND;
+    }
+    if (map->owner != (uint16_t)(server->comm->client_id + 1)) {
+        return WH_ERROR_ACCESS;
+    }
+    _unmap(server, map);
+    return WH_ERROR_OK;
+}
+
+void wh_Server_DmaUnmapClient(whServerContext* server, uint8_t client_id)
+{
+    int i = 0;
+
+    if (NULL == server) {
+        return;
+    }
+    for (i = 0; i < WH_DMA_MAP_COUNT; i++) {
+        if (server->dma.maps[i].owner == (uint16_t)(client_id + 1)) {
+            _unmap(server, &server->dma.maps[i]);
+        }
+    }
+}
+
+void wh_Server_DmaUnmapAll(whServerContext* server)
+{
+    int i = 0;
+
+    if (NULL == server) {
+        return;
+    }
+    for (i = 0; i < WH_DMA_MAP_COUNT; i++) {
+        if (0 != server->dma.maps[i].owner) {
+            _unmap(server, &server->dma.maps[i]);
+        }
+    }
 }
 
 
@@ -223,7 +549,7 @@ int whServerDma_CopyFromClient32(struct whServerContext_t* server,
 
     /* Check the server address against the allow list */
     rc = _checkMemOperAgainstAllowList(server, WH_DMA_OPER_CLIENT_READ_PRE,
-                                       serverPtr, len);
+                                       serverPtr, len, _clientHits(server));
     if (rc != WH_ERROR_OK) {
         return rc;
     }
@@ -264,7 +590,7 @@ int whServerDma_CopyFromClient64(struct whServerContext_t* server,
 
     /* Check the server address against the allow list */
     rc = _checkMemOperAgainstAllowList(server, WH_DMA_OPER_CLIENT_READ_PRE,
-                                       serverPtr, len);
+                                       serverPtr, len, _clientHits(server));
     if (rc != WH_ERROR_OK) {
         return rc;
     }
@@ -304,7 +630,7 @@ int whServerDma_CopyToClient32(struct whServerContext_t* server,
 
     /* Check the server address against the allow list */
     rc = _checkMemOperAgainstAllowList(server, WH_DMA_OPER_CLIENT_WRITE_PRE,
-                                       serverPtr, len);
+                                       serverPtr, len, _clientHits(server));
     if (rc != WH_ERROR_OK) {
         return rc;
     }
@@ -345,7 +671,7 @@ int whServerDma_CopyToClient64(struct whServerContext_t* server,
 
     /* Check the server address against the allow list */
     rc = _checkMemOperAgainstAllowList(server, WH_DMA_OPER_CLIENT_WRITE_PRE,
-                                       serverPtr, len);
+                                       serverPtr, len, _clientHits(server));
     if (rc != WH_ERROR_OK) {
         return rc;
     }
@@ -369,3 +695,124 @@ int whServerDma_CopyToClient64(struct whServerContext_t* server,
 
     return rc;
 }
+
+
+int wh_Server_DmaProcessClientSg(struct whServerContext_t* server,
+                                 const whServerDmaSgEntry* sg, uint16_t count,
+                                 whServerDmaOper oper, whServerDmaFlags flags,
+                                 whServerDmaSgCb cb, void* context)
+{
+    int      rc = WH_ERROR_OK;
+    int      postRc = WH_ERROR_OK;
+    uint16_t i  = 0;
+    void*    serverPtr = NULL;
+
+    if (NULL == server || NULL == cb || (count > 0 && NULL == sg) ||
+        count > WH_DMA_SG_MAX_ENTRIES ||
+        (oper != WH_DMA_OPER_CLIENT_READ_PRE &&
+         oper != WH_DMA_OPER_CLIENT_WRITE_PRE)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    for (i = 0; (rc == WH_ERROR_OK) && (i < count); i++) {
+        if (0 == sg[i].len || sg[i].len > SIZE_MAX) {
+            return WH_ERROR_BADARGS;
+        }
+
+        rc = wh_Server_DmaProcessClientAddress(server, sg[i].clientAddr,
+                                               &serverPtr, sg[i].len, oper,
+                                               flags);
+        if (rc != WH_ERROR_OK) {
+            break;
+        }
+
+        rc = cb(server, context, serverPtr, (size_t)sg[i].len);
+
+        /* Undo the mapping even when the callback failed */
+        postRc = wh_Server_DmaProcessClientAddress(
+            server, sg[i].clientAddr, &serverPtr, sg[i].len,
+            (whServerDmaOper)(oper + 1), flags);
+        if (rc == WH_ERROR_OK) {
+            rc = postRc;
+        }
+    }
+
+    return rc;
+}
+
+/* Cursor over the contiguous server buffer of an Sg copy */
+typedef struct {
+    uint8_t* serverPtr;
+    size_t   left;
+    int      toClient;
+    uint8_t  padding[4];
+} _dmaSgCopy;
+
+static int _dmaSgCopyCb(struct whServerContext_t* server, void* context,
+                        void* serverPtr, size_t len)
+{
+    _dmaSgCopy* copy = (_dmaSgCopy*)context;
+    (void)server;
+
+    if (len > copy->left) {
+        return WH_ERROR_BADARGS;
+    }
+
+    /* TODO: should we add a flag to force client word-sized reads? */
+    if (copy->toClient) {
+        memcpy(serverPtr, copy->serverPtr, len);
+    }
+    else {
+        memcpy(copy->serverPtr, serverPtr, len);
+    }
+    copy->serverPtr += len;
+    copy->left -= len;
+    return WH_ERROR_OK;
+}
+
+static int _dmaCopySg(struct whServerContext_t* server, void* serverPtr,
+                      size_t len, const whServerDmaSgEntry* sg, uint16_t count,
+                      whServerDmaOper oper, whServerDmaFlags flags)
+{
+    int        rc   = WH_ERROR_OK;
+    _dmaSgCopy copy = {0};
+
+    if (NULL == server || NULL == serverPtr || 0 == len) {
+        return WH_ERROR_BADARGS;
+    }
+
+    /* Check the server address against the allow list */
+    rc = _checkMemOperAgainstAllowList(server, oper, serverPtr, len,
+                                       _clientHits(server));
+    if (rc != WH_ERROR_OK) {
+        return rc;
+    }
+
+    copy.serverPtr = (uint8_t*)serverPtr;
+    copy.left      = len;
+    copy.toClient  = (oper == WH_DMA_OPER_CLIENT_WRITE_PRE);
+    rc = wh_Server_DmaProcessClientSg(server, sg, count, oper, flags,
+                                      _dmaSgCopyCb, &copy);
+    if ((rc == WH_ERROR_OK) && (copy.left != 0)) {
+        rc = WH_ERROR_BADARGS;
+    }
+    return rc;
+}
+
+int whServerDma_CopyFromClientSg(struct whServerContext_t* server,
+                                 void* serverPtr, size_t len,
+                                 const whServerDmaSgEntry* sg, uint16_t count,
+                                 whServerDmaFlags flags)
+{
+    return _dmaCopySg(server, serverPtr, len, sg, count,
+                      WH_DMA_OPER_CLIENT_READ_PRE, flags);
+}
+
+int whServerDma_CopyToClientSg(struct whServerContext_t* server,
+                               const whServerDmaSgEntry* sg, uint16_t count,
+                               void* serverPtr, size_t len,
+                               whServerDmaFlags flags)
+{
+    return _dmaCopySg(server, serverPtr, len, sg, count,
+                      WH_DMA_OPER_CLIENT_WRITE_PRE, flags);
+}
@@ -0,0 +1,174 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * src/wh_server_job.c
+ *
+ * Long-running server jobs, advanced between requests and polled by clients
+ */
+
+/* System libraries */
+#include <stdint.h>
+#include <stddef.h>  /* For NULL */
+#include <string.h>  /* For memset, memcpy */
+
+#include "wolfhsm/wh_error.h"
+#include "wolfhsm/wh_comm.h"
+#include "wolfhsm/wh_message_comm.h"
+#include "wolfhsm/wh_server.h"
+#include "wolfhsm/wh_server_job.h"
+
+#if WOLFHSM_SERVER_MAX_JOBS > 0
+
+int wh_Server_JobStart(whServerContext* server, whServerJobCb cb,
+        uint16_t kind, uint16_t state_size, const void* state,
+        uint16_t* out_id)
+{
+    whServerJob* job = NULL;
+    int i = 0;
+
+    if (    (server == NULL) ||
+            (cb == NULL) ||
+            (state_size > sizeof(job->buffer)) ||
+            ((state_size > 0) && (state == NULL))) {
+        return WH_ERROR_BADARGS;
+    }
+
+    for (i = 0; i < WOLFHSM_SERVER_MAX_JOBS; i++) {
+        if (server->job[i].state == WH_SERVER_JOB_FREE) {
+            job = &server->job[i];
+            break;
+        }
+    }
+    if (job == NULL) {
+        return WH_ERROR_NOSPACE;
+    }
+
+    memset(job, 0, sizeof(*job));
+    if (state_size > 0) {
+        memcpy(job->buffer, state, state_size);
+    }
+    /* Id 0 is never handed out */
+    server->job_seq++;
+    if (server->job_seq == 0) {
+        server->job_seq++;
+    }
+    job->id = server->job_seq;
+    job->cb = cb;
+    job->comm = server->comm;
+    job->kind = kind;
+    job->state = WH_SERVER_JOB_RUNNING;
+
+    if (out_id != NULL) {
+        *out_id = job->id;
+    }
+    return WH_ERROR_OK;
+}
+
+int wh_Server_JobStep(whServerContext* server)
+{
+    whCommServer* comm = NULL;
+    int i = 0;
+
+    if (server == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    for (i = 0; i < WOLFHSM_SERVER_MAX_JOBS; i++) {
+        uint16_t index = (server->job_next + i) % WOLFHSM_SERVER_MAX_JOBS;
+        whServerJob* job = &server->job[index];
+        uint16_t size = 0;
+        int rc = 0;
+
+        if (job->state != WH_SERVER_JOB_RUNNING) {
+            continue;
+        }
+
+        /* The slice runs on behalf of the client that started the job */
+        comm = server->comm;
+        server->comm = job->comm;
+        rc = job->cb(server, (uint8_t*)job->buffer, &size);
+        server->comm = comm;
+
+        if (rc != WH_ERROR_NOTREADY) {
+            job->rc = rc;
+            job->size = (size <= sizeof(job->buffer)) ? size : 0;
+            job->state = WH_SERVER_JOB_DONE;
+        }
+        server->job_next = (index + 1) % WOLFHSM_SERVER_MAX_JOBS;
+        return WH_ERROR_OK;
+    }
+    return WH_ERROR_NOTREADY;
+}
+
+int wh_Server_HandleJobRequest(whServerContext* server,
+        uint16_t magic, uint16_t req_size, const void* req_packet,
+        uint16_t *out_resp_size, void* resp_packet)
+{
+    whMessageCommJobRequest req = {0};
+    whMessageCommJobResponse resp = {0};
+    whServerJob* job = NULL;
+    int i = 0;
+
+    if (    (server == NULL) ||
+            (req_packet == NULL) ||
+            (out_resp_size == NULL) ||
+            (resp_packet == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    if (req_size < sizeof(req)) {
+        /* Request is malformed */
+        *out_resp_size = 0;
+        return WH_ERROR_OK;
+    }
+    (void)wh_MessageComm_TranslateJobRequest(magic,
+            (const whMessageCommJobRequest*)req_packet, &req);
+
+    resp.id = req.id;
+    resp.rc = WH_ERROR_NOTFOUND;
+    for (i = 0; i < WOLFHSM_SERVER_MAX_JOBS; i++) {
+        /* Jobs are only visible to the client that started them */
+        if (    (server->job[i].state != WH_SERVER_JOB_FREE) &&
+                (server->job[i].id == req.id) &&
+                (server->job[i].comm == server->comm)) {
+            job = &server->job[i];
+            break;
+        }
+    }
+
+    if (job != NULL) {
+        resp.kind = job->kind;
+        if (job->state == WH_SERVER_JOB_RUNNING) {
+            resp.rc = WH_ERROR_NOTREADY;
+        } else {
+            resp.rc = job->rc;
+            resp.len = job->size;
+            memcpy((uint8_t*)resp_packet + sizeof(resp), job->buffer,
+                    job->size);
+            memset(job, 0, sizeof(*job));
+        }
+    }
+
+    (void)wh_MessageComm_TranslateJobResponse(magic, &resp,
+            (whMessageCommJobResponse*)resp_packet);
+    *out_resp_size = sizeof(resp) + resp.len;
+    return WH_ERROR_OK;
+}
+
+#endif /* WOLFHSM_SERVER_MAX_JOBS > 0 */
@@ -35,74 +35,529 @@
 #include "wolfhsm/wh_server_she.h"
 #endif
 
-int hsmGetUniqueId(whServerContext* server, whNvmId* outId)
+/* Key cache index.  Maps a key id to its cache slot with linear probing so
+ * lookups stay flat as WOLFHSM_NUM_RAMKEYS grows.  Entries hold slot + 1 */
+static uint16_t hsmCacheIndexHash(whKeyId keyId)
+{
+    /* Fibonacci hash, keeping the well mixed upper bits */
+    return (uint16_t)((((uint32_t)keyId * 2654435761u) >> 16) %
+        WOLFHSM_KEYCACHE_INDEX_SIZE);
+}
+
+/* return the slot holding keyId, or -1 */
+static int hsmCacheLookup(whServerContext* server, whKeyId keyId)
+{
+    int i;
+    uint16_t pos;
+    uint16_t entry;
+    if (keyId == WOLFHSM_KEYID_ERASED)
+        return -1;
+    pos = hsmCacheIndexHash(keyId);
+    for (i = 0; i < WOLFHSM_KEYCACHE_INDEX_SIZE; i++) {
+        entry = server->cacheIndex[pos];
+        if (entry == 0)
+            break;
+        if (server->cache[entry - 1].meta->id == keyId)
+            return entry - 1;
+        pos = (pos + 1) % WOLFHSM_KEYCACHE_INDEX_SIZE;
+    }
+    return -1;
+}
+
+/* remove a slot from the index, shifting back entries of its probe run */
+static void hsmCacheIndexRemove(whServerContext* server, int slotIdx)
+{
+    int i;
+    uint16_t pos;
+    uint16_t next;
+    uint16_t home;
+    whKeyId keyId = server->cache[slotIdx].meta->id;
+    if (keyId == WOLFHSM_KEYID_ERASED)
+        return;
+    pos = hsmCacheIndexHash(keyId);
+    for (i = 0; i < WOLFHSM_KEYCACHE_INDEX_SIZE; i++) {
+        if (server->cacheIndex[pos] == 0)
+            return;
+        if (server->cacheIndex[pos] == slotIdx + 1)
+            break;
+        pos = (pos + 1) % WOLFHSM_KEYCACHE_INDEX_SIZE;
+    }
+    if (i >= WOLFHSM_KEYCACHE_INDEX_SIZE)
+        return;
+    server->cacheIndex[pos] = 0;
+    next = pos;
+    for (i = 0; i < WOLFHSM_KEYCACHE_INDEX_SIZE; i++) {
+        next = (next + 1) % WOLFHSM_KEYCACHE_INDEX_SIZE;
+        if (server->cacheIndex[next] == 0)
+            break;
+        home = hsmCacheIndexHash(
+            server->cache[server->cacheIndex[next] - 1].meta->id);
+        /* move the entry into the hole unless its home lies after the hole */
+        if ((next > pos && (home <= pos || home > next)) ||
+            (next < pos && (home <= pos && home > next))) {
+            server->cacheIndex[pos] = server->cacheIndex[next];
+            server->cacheIndex[next] = 0;
+            pos = next;
+        }
+    }
+}
+
+/* return the id map of a key's client, only crypto keys get ids assigned */
+static uint32_t* hsmKeyIdMap(whServerContext* server, whKeyId keyId)
+{
+    if ((keyId & WOLFHSM_KEYTYPE_MASK) != WOLFHSM_KEYTYPE_CRYPTO)
+        return NULL;
+    return server->keyIdMap[(keyId & WOLFHSM_KEYUSER_MASK) >> 8];
+}
+
+static void hsmKeyIdMapSet(whServerContext* server, whKeyId keyId, int used)
+{
+    uint32_t* map = hsmKeyIdMap(server, keyId);
+    uint32_t bit;
+    if (map == NULL)
+        return;
+    bit = (uint32_t)1 << ((keyId & WOLFHSM_KEYID_MASK) % 32);
+    if (used)
+        map[(keyId & WOLFHSM_KEYID_MASK) / 32] |= bit;
+    else
+        map[(keyId & WOLFHSM_KEYID_MASK) / 32] &= ~bit;
+}
+
+static const uint16_t hsmSlabSize[WOLFHSM_KEYCACHE_SLAB_CLASSES] = {
+    WOLFHSM_KEYCACHE_SLAB0_SIZE, WOLFHSM_KEYCACHE_SLAB1_SIZE,
+    WOLFHSM_KEYCACHE_SLAB2_SIZE, WOLFHSM_KEYCACHE_SLAB3_SIZE,
+};
+static const uint16_t hsmSlabCount[WOLFHSM_KEYCACHE_SLAB_CLASSES] = {
+    WOLFHSM_KEYCACHE_SLAB0_COUNT, WOLFHSM_KEYCACHE_SLAB1_COUNT,
+    WOLFHSM_KEYCACHE_SLAB2_COUNT, WOLFHSM_KEYCACHE_SLAB3_COUNT,
+};
+
+/* return the first block of a size class, classes are laid out in order */
+static uint8_t* hsmSlabBase(whServerContext* server, int slab)
+{
+    int i;
+    uint32_t offset = 0;
+    for (i = 0; i < slab; i++)
+        offset += (uint32_t)hsmSlabSize[i] * hsmSlabCount[i];
+    return server->cacheArena + offset;
+}
+
+/* take a block of at least size bytes from the smallest class that has one */
+static int hsmSlabAlloc(whServerContext* server, uint32_t size,
+    uint8_t** outBuf, uint8_t* outSlab)
+{
+    int i;
+    uint16_t block;
+    for (i = 0; i < WOLFHSM_KEYCACHE_SLAB_CLASSES; i++) {
+        if (hsmSlabSize[i] < size)
+            continue;
+        if (server->slabFree[i] != 0) {
+            block = server->slabFree[i] - 1;
+            *outBuf = hsmSlabBase(server, i) + (uint32_t)block * hsmSlabSize[i];
+            /* free blocks hold the next link in their first bytes */
+            XMEMCPY(&server->slabFree[i], *outBuf, sizeof(uint16_t));
+        }
+        else if (server->slabUsed[i] < hsmSlabCount[i]) {
+            block = server->slabUsed[i]++;
+            *outBuf = hsmSlabBase(server, i) + (uint32_t)block * hsmSlabSize[i];
+        }
+        else
+            continue;
+        *outSlab = (uint8_t)i;
+        return 0;
+    }
+    return WH_ERROR_NOSPACE;
+}
+
+/* scrub a block and push it on its class free list */
+static void hsmSlabFree(whServerContext* server, uint8_t* buf, uint8_t slab)
+{
+    uint16_t block;
+    block = (uint16_t)((buf - hsmSlabBase(server, slab)) / hsmSlabSize[slab]);
+    XMEMSET(buf, 0, hsmSlabSize[slab]);
+    XMEMCPY(buf, &server->slabFree[slab], sizeof(uint16_t));
+    server->slabFree[slab] = block + 1;
+}
+
+/* return a slot's block to the arena */
+static void hsmCacheFreeBuffer(whServerContext* server, CacheSlot* slot)
+{
+    if (slot->buffer != NULL) {
+        hsmSlabFree(server, slot->buffer, slot->slab);
+        slot->buffer = NULL;
+    }
+}
+
+#if WOLFHSM_NUM_DECODED_KEYS > 0
+/* free the parsed key held by a decoded entry */
+static void hsmDecodedKeyFree(whServerDecodedKey* entry)
+{
+    switch (entry->type) {
+#ifndef NO_RSA
+    case WH_DECODED_KEY_RSA:
+        wc_FreeRsaKey(entry->key.rsa);
+        break;
+#endif
+#ifdef HAVE_ECC
+    case WH_DECODED_KEY_ECC:
+        wc_ecc_free(entry->key.ecc);
+        break;
+#endif
+#if !defined(NO_AES) && defined(WOLFHSM_SYMMETRIC_INTERNAL)
+    case WH_DECODED_KEY_AES:
+        wc_AesFree(entry->key.aes);
+        break;
+#endif
+    default:
+        break;
+    }
+    entry->type = WH_DECODED_KEY_NONE;
+    entry->slot = -1;
+}
+
+/* invalidate the decoded keys of a slot, keys still in use go stale and are
+ * freed on release */
+static void hsmDecodedKeyDrop(whServerContext* server, int slotIdx)
+{
+    int i;
+    whServerDecodedKey* entry;
+    for (i = 0; i < WOLFHSM_NUM_DECODED_KEYS; i++) {
+        entry = &server->decoded[i];
+        if (entry->type == WH_DECODED_KEY_NONE || entry->slot != slotIdx)
+            continue;
+        if (entry->refs > 0)
+            entry->slot = -1;
+        else
+            hsmDecodedKeyFree(entry);
+    }
+}
+
+whServerDecodedKey* hsmDecodedKeyFind(whServerContext* server, int slotIdx,
+    uint8_t type, int param)
 {
     int i;
+    whServerDecodedKey* entry;
+    for (i = 0; i < WOLFHSM_NUM_DECODED_KEYS; i++) {
+        entry = &server->decoded[i];
+        if (entry->type == type && entry->slot == slotIdx &&
+            entry->param == param) {
+            entry->refs++;
+            entry->lastUse = ++server->cacheTick;
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+whServerDecodedKey* hsmDecodedKeyAlloc(whServerContext* server, int slotIdx,
+    int param)
+{
+    int i;
+    whServerDecodedKey* entry = NULL;
+    /* take an empty entry, or replace the least recently used idle one */
+    for (i = 0; i < WOLFHSM_NUM_DECODED_KEYS; i++) {
+        if (server->decoded[i].refs > 0)
+            continue;
+        if (server->decoded[i].type == WH_DECODED_KEY_NONE) {
+            entry = &server->decoded[i];
+            break;
+        }
+        if (entry == NULL ||
+            (uint32_t)(server->cacheTick - server->decoded[i].lastUse) >
+            (uint32_t)(server->cacheTick - entry->lastUse)) {
+            entry = &server->decoded[i];
+        }
+    }
+    if (entry != NULL) {
+        hsmDecodedKeyFree(entry);
+        entry->slot = slotIdx;
+        entry->param = param;
+        entry->refs = 1;
+        entry->lastUse = ++server->cacheTick;
+    }
+    return entry;
+}
+
+int hsmDecodedKeyRelease(whServerContext* server, const void* key)
+{
+    int i;
+    whServerDecodedKey* entry;
+    for (i = 0; i < WOLFHSM_NUM_DECODED_KEYS; i++) {
+        entry = &server->decoded[i];
+        if ((const void*)&entry->key != key || entry->refs == 0)
+            continue;
+        entry->refs--;
+        /* free keys whose slot changed while they were in use */
+        if (entry->refs == 0 && entry->slot == -1)
+            hsmDecodedKeyFree(entry);
+        return 0;
+    }
+    return WH_ERROR_NOTFOUND;
+}
+
+void hsmDecodedKeyFlush(whServerContext* server)
+{
+    int i;
+    for (i = 0; i < WOLFHSM_NUM_DECODED_KEYS; i++) {
+        hsmDecodedKeyFree(&server->decoded[i]);
+        server->decoded[i].refs = 0;
+    }
+}
+#endif /* WOLFHSM_NUM_DECODED_KEYS > 0 */
+
+/* mark a slot as erased and drop it from the index */
+static void hsmCacheClearSlot(whServerContext* server, int slotIdx)
+{
+    hsmCacheIndexRemove(server, slotIdx);
+#if WOLFHSM_NUM_DECODED_KEYS > 0
+    hsmDecodedKeyDrop(server, slotIdx);
+#endif
+    hsmCacheFreeBuffer(server, &server->cache[slotIdx]);
+    /* committed keys keep their id */
+    if (server->cache[slotIdx].commited == 0)
+        hsmKeyIdMapSet(server, server->cache[slotIdx].meta->id, 0);
+    server->cache[slotIdx].meta->id = WOLFHSM_KEYID_ERASED;
+    server->cache[slotIdx].commited = 0;
+}
+
+/* mark a slot as the most recently used */
+static void hsmCacheTouch(whServerContext* server, int slotIdx)
+{
+    server->cache[slotIdx].lastUse = ++server->cacheTick;
+}
+
+/* find a cached key, counting the hit and refreshing its use */
+static int hsmCacheHit(whServerContext* server, whKeyId keyId)
+{
+    int i = hsmCacheLookup(server, keyId);
+    if (i >= 0) {
+        server->cacheStats.hits++;
+        hsmCacheTouch(server, i);
+    }
+    else {
+        server->cacheStats.misses++;
+    }
+    return i;
+}
+
+/* add a slot to the index once its meta->id is set */
+int hsmCacheIndexSlot(whServerContext* server, int slotIdx)
+{
+    int i;
+    uint16_t pos;
+    if (server == NULL || slotIdx < 0 || slotIdx >= WOLFHSM_NUM_RAMKEYS ||
+        server->cache[slotIdx].meta->id == WOLFHSM_KEYID_ERASED) {
+        return WH_ERROR_BADARGS;
+    }
+    server->cache[slotIdx].pinned =
+        (server->cache[slotIdx].meta->flags & WOLFHSM_NVM_FLAGS_PINNED) != 0;
+    hsmCacheTouch(server, slotIdx);
+    hsmKeyIdMapSet(server, server->cache[slotIdx].meta->id, 1);
+    pos = hsmCacheIndexHash(server->cache[slotIdx].meta->id);
+    for (i = 0; i < WOLFHSM_KEYCACHE_INDEX_SIZE; i++) {
+        if (server->cacheIndex[pos] == 0 ||
+            server->cacheIndex[pos] == slotIdx + 1) {
+            server->cacheIndex[pos] = slotIdx + 1;
+            return 0;
+        }
+        pos = (pos + 1) % WOLFHSM_KEYCACHE_INDEX_SIZE;
+    }
+    /* the index always has room for every slot */
+    return WH_ERROR_NOSPACE;
+}
+
+int hsmKeyIdMapBuild(whServerContext* server)
+{
     int ret = 0;
+    int i;
+    whNvmId id = 0;
+    whNvmId count = 0;
+    whNvmId total = 0;
+    if (server == NULL)
+        return WH_ERROR_BADARGS;
+    XMEMSET(server->keyIdMap, 0, sizeof(server->keyIdMap));
+    /* cached keys */
+    for (i = 0; i < WOLFHSM_NUM_RAMKEYS; i++) {
+        if (server->cache[i].meta->id != WOLFHSM_KEYID_ERASED)
+            hsmKeyIdMapSet(server, server->cache[i].meta->id, 1);
+    }
+    if (server->nvm == NULL)
+        return 0;
+    /* committed keys, bounded by the first count in case of duplicate ids */
+    ret = wh_Nvm_List(server->nvm, WOLFHSM_NVM_ACCESS_ANY,
+        WOLFHSM_NVM_FLAGS_ANY, 0, &total, &id);
+    for (i = 0; ret == 0 && id != 0 && i < total; i++) {
+        hsmKeyIdMapSet(server, id, 1);
+        ret = wh_Nvm_List(server->nvm, WOLFHSM_NVM_ACCESS_ANY,
+            WOLFHSM_NVM_FLAGS_ANY, id, &count, &id);
+    }
+    return ret;
+}
+
+/* return the lowest id the map shows free, or 0 if there are none */
+static whKeyId hsmKeyIdMapNextFree(const uint32_t* map)
+{
+    int i;
+    whKeyId id;
+    uint32_t free;
+    for (i = 0; i < WH_SERVER_KEYID_MAP_WORDS; i++) {
+        free = ~map[i];
+        /* id 0 is the erased id */
+        if (i == 0)
+            free &= ~(uint32_t)1;
+        if (free == 0)
+            continue;
+        id = i * 32;
+        while ((free & 1) == 0) {
+            free >>= 1;
+            id++;
+        }
+        return id;
+    }
+    return 0;
+}
+
+int hsmGetUniqueId(whServerContext* server, whNvmId* outId)
+{
+    int ret;
+    int rebuilt = 0;
     whNvmId id;
+    whNvmMetadata meta[1];
+    uint32_t* map;
     /* apply client_id and type which should be set by caller on outId */
     whNvmId buildId = ((*outId | (server->comm->client_id << 8)) & (~WOLFHSM_KEYID_MASK));
-    whNvmId nvmId = 0;
-    whNvmId keyCount;
-    /* try every index until we find a unique one, don't worry about capacity */
-    for (id = 1; id < WOLFHSM_KEYID_MASK + 1; id++) {
-        buildId = ((buildId & ~WOLFHSM_KEYID_MASK) | id);
-        /* check against cache keys */
-        for (i = 0; i < WOLFHSM_NUM_RAMKEYS; i++) {
-            if (buildId == server->cache[i].meta->id)
-                break;
+    map = hsmKeyIdMap(server, buildId);
+    /* other key types have no map, try every index */
+    if (map == NULL) {
+        for (id = 1; id < WOLFHSM_KEYID_MASK + 1; id++) {
+            buildId = ((buildId & ~WOLFHSM_KEYID_MASK) | id);
+            if (hsmCacheLookup(server, buildId) < 0 &&
+                wh_Nvm_GetMetadata(server->nvm, buildId, meta) ==
+                WH_ERROR_NOTFOUND) {
+                *outId |= buildId;
+                return 0;
+            }
         }
-        /* try again if match */
-        if (i < WOLFHSM_NUM_RAMKEYS)
+        return WH_ERROR_NOSPACE;
+    }
+    while (1) {
+        id = hsmKeyIdMapNextFree(map);
+        if (id == 0) {
+            /* ids freed behind our back, such as by the NVM API, are only
+             * found by rebuilding the map */
+            if (rebuilt)
+                return WH_ERROR_NOSPACE;
+            ret = hsmKeyIdMapBuild(server);
+            if (ret != 0)
+                return ret;
+            rebuilt = 1;
             continue;
-        /* if keyId exists */
-        ret = wh_Nvm_List(server->nvm, WOLFHSM_NVM_ACCESS_ANY,
-            WOLFHSM_NVM_FLAGS_ANY, buildId, &keyCount,
-            &nvmId);
-        /* break if we didn't find a match */
-        if (ret == WH_ERROR_NOTFOUND || nvmId != buildId)
+        }
+        buildId = ((buildId & ~WOLFHSM_KEYID_MASK) | id);
+        /* the map can also miss objects added through the NVM API */
+        if (hsmCacheLookup(server, buildId) < 0 &&
+            wh_Nvm_GetMetadata(server->nvm, buildId, meta) ==
+            WH_ERROR_NOTFOUND) {
             break;
+        }
+        hsmKeyIdMapSet(server, buildId, 1);
     }
-    /* unlikely but cover the case where we've run out of ids */
-    if (id > WOLFHSM_KEYID_MASK)
-        ret = WH_ERROR_NOSPACE;
     /* ultimately, return found id */
-    if (ret == 0)
-        *outId |= buildId;
-    return ret;
+    *outId |= buildId;
+    return 0;
 }
 
-/* return the index of a free slot */
-int hsmCacheFindSlot(whServerContext* server)
+/* return nonzero if user may evict the key in slotIdx.  A user at its quota
+ * only evicts its own keys, and keys of users with a quota are only evicted
+ * by their owner */
+static int hsmCacheMayEvict(whServerContext* server, int slotIdx, int user,
+    int atQuota)
+{
+    int owner = (server->cache[slotIdx].meta->id & WOLFHSM_KEYUSER_MASK) >> 8;
+    if (owner == user)
+        return 1;
+    return !atQuota && server->keyQuota[owner] == 0;
+}
+
+/* return the index of a free slot holding a block of at least size bytes,
+ * evicting a commited key if needed */
+int hsmCacheFindSlot(whServerContext* server, uint32_t size)
 {
     int i;
     int foundIndex = -1;
+    int victim = -1;
+    int haveBuf;
+    int user = -1;
+    int used = 0;
+    int atQuota = 0;
+    uint8_t* buf = NULL;
+    uint8_t slab = 0;
+    if (server->keyQuota != NULL)
+        user = ((server->comm->client_id << 8) & WOLFHSM_KEYUSER_MASK) >> 8;
     for (i = 0; i < WOLFHSM_NUM_RAMKEYS; i++) {
-        /* check for empty slot or rewrite slot */
-        if (foundIndex == -1 && server->cache[i].meta->id ==
-            WOLFHSM_KEYID_ERASED) {
-            foundIndex = i;
-            break;
+        if (server->cache[i].meta->id == WOLFHSM_KEYID_ERASED) {
+            /* reclaim blocks left behind by callers that failed to fill a
+             * slot */
+            hsmCacheFreeBuffer(server, &server->cache[i]);
+            if (foundIndex == -1)
+                foundIndex = i;
         }
+        else if (user >= 0 && ((server->cache[i].meta->id &
+            WOLFHSM_KEYUSER_MASK) >> 8) == user) {
+            used++;
+        }
+    }
+    /* a user at its quota has to replace one of its own keys */
+    if (user >= 0 && server->keyQuota[user] != 0 &&
+        used >= server->keyQuota[user]) {
+        atQuota = 1;
+        foundIndex = -1;
     }
-    /* if no empty slots, check for a commited key we can evict */
-    if (foundIndex == -1) {
+    haveBuf = (hsmSlabAlloc(server, size, &buf, &slab) == 0);
+    /* if short a slot or a block, evict a commited key that isn't pinned */
+    if (foundIndex == -1 || !haveBuf) {
         for (i = 0; i < WOLFHSM_NUM_RAMKEYS; i++) {
-            if (server->cache[i].commited == 1) {
-                foundIndex = i;
-                break;
+            if (server->cache[i].commited != 1 || server->cache[i].pinned)
+                continue;
+            if (user >= 0 && !hsmCacheMayEvict(server, i, user, atQuota))
+                continue;
+            /* without a block the victim has to free a big enough one */
+            if (!haveBuf && hsmSlabSize[server->cache[i].slab] < size)
+                continue;
+#if WOLFHSM_KEYCACHE_EVICT == WOLFHSM_KEYCACHE_EVICT_LRU
+            /* keep the slot that has gone unused the longest, the unsigned
+             * difference stays correct when the tick wraps */
+            if (victim == -1 ||
+                (uint32_t)(server->cacheTick - server->cache[i].lastUse) >
+                (uint32_t)(server->cacheTick -
+                server->cache[victim].lastUse)) {
+                victim = i;
             }
+#else
+            victim = i;
+            break;
+#endif
         }
+        /* return error if we are out of cache slots */
+        if (victim == -1) {
+            if (haveBuf)
+                hsmSlabFree(server, buf, slab);
+            return WH_ERROR_NOSPACE;
+        }
+        hsmCacheClearSlot(server, victim);
+        server->cacheStats.evictions++;
+        if (foundIndex == -1)
+            foundIndex = victim;
+        if (!haveBuf)
+            (void)hsmSlabAlloc(server, size, &buf, &slab);
     }
-    /* return error if we are out of cache slots */
-    if (foundIndex == -1)
-        return WH_ERROR_NOSPACE;
+    server->cache[foundIndex].buffer = buf;
+    server->cache[foundIndex].slab = slab;
     return foundIndex;
 }
 
 int hsmCacheKey(whServerContext* server, whNvmMetadata* meta, uint8_t* in)
 {
-    int i;
     int foundIndex = -1;
     /* make sure id is valid */
     if (server == NULL || meta == NULL || in == NULL ||
@@ -112,31 +567,28 @@ int hsmCacheKey(whServerContext* server, whNvmMetadata* meta, uint8_t* in)
     }
     /* apply client_id */
     meta->id |= (server->comm->client_id << 8);
-    for (i = 0; i < WOLFHSM_NUM_RAMKEYS; i++) {
-        /* check for empty slot or rewrite slot */
-        if ((foundIndex == -1 &&
-            (server->cache[i].meta->id & WOLFHSM_KEYID_MASK) ==
-            WOLFHSM_KEYID_ERASED) ||
-            server->cache[i].meta->id == meta->id) {
-            foundIndex = i;
-        }
-    }
-    /* if no empty slots, check for a commited key we can evict */
-    if (foundIndex == -1) {
-        for (i = 0; i < WOLFHSM_NUM_RAMKEYS; i++) {
-            if (server->cache[i].commited == 1) {
-                foundIndex = i;
-                break;
-            }
-        }
+    /* rewrite the slot of the same key or take a free one */
+    foundIndex = hsmCacheLookup(server, meta->id);
+    /* a rewrite that outgrows its block moves to a bigger one */
+    if (foundIndex >= 0 &&
+        meta->len > hsmSlabSize[server->cache[foundIndex].slab]) {
+        hsmCacheClearSlot(server, foundIndex);
+        foundIndex = -1;
     }
-    /* return error if we are out of cache slots */
     if (foundIndex == -1)
+        foundIndex = hsmCacheFindSlot(server, meta->len);
+    /* return error if we are out of cache slots */
+    if (foundIndex < 0)
         return WH_ERROR_NOSPACE;
+#if WOLFHSM_NUM_DECODED_KEYS > 0
+    /* a rewritten key has to be decoded again */
+    hsmDecodedKeyDrop(server, foundIndex);
+#endif
     /* write key if slot found */
     XMEMCPY((uint8_t*)server->cache[foundIndex].buffer, in, meta->len);
     XMEMCPY((uint8_t*)server->cache[foundIndex].meta, (uint8_t*)meta,
         sizeof(whNvmMetadata));
+    (void)hsmCacheIndexSlot(server, foundIndex);
     /* check if the key is already commited */
     if (wh_Nvm_GetMetadata(server->nvm, meta->id, meta) == WH_ERROR_NOTFOUND)
         server->cache[foundIndex].commited = 0;
@@ -145,52 +597,94 @@ int hsmCacheKey(whServerContext* server, whNvmMetadata* meta, uint8_t* in)
     return 0;
 }
 
-/* try to put the specified key into cache if it isn't already, return index */
-int hsmFreshenKey(whServerContext* server, whKeyId keyId)
+/* read a committed key into a free slot, keyId already carries its user */
+static int hsmCacheLoad(whServerContext* server, whKeyId keyId)
 {
     int ret = 0;
-    int i;
     int foundIndex = -1;
-    uint32_t outSz = WOLFHSM_KEYCACHE_BUFSIZE;
     whNvmMetadata meta[1] = {0};
+    /* try to read the metadata */
+    ret = wh_Nvm_GetMetadata(server->nvm, keyId, meta);
+    if (ret != 0)
+        return ret;
+    foundIndex = hsmCacheFindSlot(server, meta->len);
+    /* return error if we are out of cache slots */
+    if (foundIndex < 0)
+        return WH_ERROR_NOSPACE;
+    /* read the object, the slot stays erased if this fails */
+    ret = wh_Nvm_Read(server->nvm, keyId, 0, meta->len,
+        server->cache[foundIndex].buffer);
+    if (ret != 0)
+        return ret;
+    /* set meta */
+    XMEMCPY((uint8_t*)server->cache[foundIndex].meta, (uint8_t*)meta,
+        sizeof(meta));
+    /* loaded from nvm so it can be evicted again later */
+    server->cache[foundIndex].commited = 1;
+    (void)hsmCacheIndexSlot(server, foundIndex);
+    /* return index */
+    return foundIndex;
+}
+
+/* try to put the specified key into cache if it isn't already, return index */
+int hsmFreshenKey(whServerContext* server, whKeyId keyId)
+{
+    int foundIndex = -1;
     if (server == NULL || keyId == WOLFHSM_KEYID_ERASED)
         return WH_ERROR_BADARGS;
     /* apply client_id */
     keyId |= (server->comm->client_id << 8);
-    for (i = 0; i < WOLFHSM_NUM_RAMKEYS; i++) {
-        /* check for empty slot or rewrite slot */
-        if ((foundIndex == -1 &&
-            server->cache[i].meta->id == WOLFHSM_KEYID_ERASED) ||
-            server->cache[i].meta->id == keyId) {
-            foundIndex = i;
-            if (server->cache[i].meta->id == keyId)
-                return i;
-        }
+    /* return the slot if already cached */
+    foundIndex = hsmCacheHit(server, keyId);
+    if (foundIndex >= 0)
+        return foundIndex;
+    return hsmCacheLoad(server, keyId);
+}
+
+int hsmPreloadKeys(whServerContext* server, uint16_t count,
+    const whKeyId* keyIds)
+{
+    int ret = 0;
+    int err = 0;
+    int i;
+    int slotIdx;
+    whNvmId id = 0;
+    whNvmId listCount = 0;
+    whNvmId total = 0;
+    whNvmMetadata meta[1];
+    if (server == NULL || (count > 0 && keyIds == NULL))
+        return WH_ERROR_BADARGS;
+    if (server->nvm == NULL)
+        return 0;
+    /* configured keys are pinned whatever their nvm flags say */
+    for (i = 0; i < count; i++) {
+        if (keyIds[i] == WOLFHSM_KEYID_ERASED)
+            continue;
+        slotIdx = hsmCacheLookup(server, keyIds[i]);
+        if (slotIdx < 0)
+            slotIdx = hsmCacheLoad(server, keyIds[i]);
+        if (slotIdx >= 0)
+            server->cache[slotIdx].pinned = 1;
+        else if (err == 0)
+            err = slotIdx;
     }
-    /* if no empty slots, check for a commited key we can evict */
-    if (foundIndex == -1) {
-        for (i = 0; i < WOLFHSM_NUM_RAMKEYS; i++) {
-            if (server->cache[i].commited == 1) {
-                foundIndex = i;
-                break;
-            }
+    /* then every key committed with the pinned flag, visited in directory
+     * order so the reads walk the partition front to back */
+    ret = wh_Nvm_List(server->nvm, WOLFHSM_NVM_ACCESS_ANY,
+        WOLFHSM_NVM_FLAGS_ANY, 0, &total, &id);
+    for (i = 0; ret == 0 && id != 0 && i < total; i++) {
+        if (    ((id & WOLFHSM_KEYTYPE_MASK) != 0) &&
+                (hsmCacheLookup(server, id) < 0) &&
+                (wh_Nvm_GetMetadata(server->nvm, id, meta) == 0) &&
+                ((meta->flags & WOLFHSM_NVM_FLAGS_PINNED) != 0)) {
+            slotIdx = hsmCacheLoad(server, id);
+            if (slotIdx < 0 && err == 0)
+                err = slotIdx;
         }
+        ret = wh_Nvm_List(server->nvm, WOLFHSM_NVM_ACCESS_ANY,
+            WOLFHSM_NVM_FLAGS_ANY, id, &listCount, &id);
     }
-    /* return error if we are out of cache slots */
-    if (foundIndex == -1)
-        return WH_ERROR_NOSPACE;
-    /* try to read the metadata */
-    ret = wh_Nvm_GetMetadata(server->nvm, keyId, meta);
-    if (ret == 0) {
-        /* set meta */
-        XMEMCPY((uint8_t*)server->cache[foundIndex].meta, (uint8_t*)meta,
-            sizeof(meta));
-        /* read the object */
-        ret = wh_Nvm_Read(server->nvm, keyId, 0, outSz,
-            server->cache[foundIndex].buffer);
-    }
-    /* return index */
-    return foundIndex;
+    return (err != 0) ? err : ret;
 }
 
 int hsmReadKey(whServerContext* server, whKeyId keyId, whNvmMetadata* outMeta,
@@ -208,23 +702,22 @@ int hsmReadKey(whServerContext* server, whKeyId keyId, whNvmMetadata* outMeta,
     /* apply client_id */
     keyId |= (server->comm->client_id << 8);
     /* check the cache */
-    for (i = 0; i < WOLFHSM_NUM_RAMKEYS; i++) {
+    i = hsmCacheHit(server, keyId);
+    if (i >= 0) {
+        /* check outSz */
+        if (server->cache[i].meta->len > *outSz)
+            return WH_ERROR_NOSPACE;
         /* copy the meta and key before returning */
-        if (server->cache[i].meta->id == keyId) {
-            /* check outSz */
-            if (server->cache[i].meta->len > *outSz)
-                return WH_ERROR_NOSPACE;
-            if (outMeta != NULL) {
-                XMEMCPY((uint8_t*)outMeta, (uint8_t*)server->cache[i].meta,
-                    sizeof(whNvmMetadata));
-            }
-            if (out != NULL) {
-                XMEMCPY(out, server->cache[i].buffer,
-                    server->cache[i].meta->len);
-            }
-            *outSz = server->cache[i].meta->len;
-            return 0;
+        if (outMeta != NULL) {
+            XMEMCPY((uint8_t*)outMeta, (uint8_t*)server->cache[i].meta,
+                sizeof(whNvmMetadata));
         }
+        if (out != NULL) {
+            XMEMCPY(out, server->cache[i].buffer,
+                server->cache[i].meta->len);
+        }
+        *outSz = server->cache[i].meta->len;
+        return 0;
     }
     /* try to read the metadata */
     ret = wh_Nvm_GetMetadata(server->nvm, keyId, meta);
@@ -263,7 +756,6 @@ int hsmReadKey(whServerContext* server, whKeyId keyId, whNvmMetadata* outMeta,
 
 int hsmEvictKey(whServerContext* server, whNvmId keyId)
 {
-    int ret = 0;
     int i;
     /* make sure id is valid */
     if (server == NULL || (keyId & WOLFHSM_KEYID_MASK) == WOLFHSM_KEYID_ERASED)
@@ -271,17 +763,13 @@ int hsmEvictKey(whServerContext* server, whNvmId keyId)
     /* apply client_id */
     keyId |= (server->comm->client_id << 8);
     /* find key */
-    for (i = 0; i < WOLFHSM_NUM_RAMKEYS; i++) {
-        /* mark key as erased */
-        if (server->cache[i].meta->id == keyId) {
-            server->cache[i].meta->id = WOLFHSM_KEYID_ERASED;
-            break;
-        }
-    }
+    i = hsmCacheLookup(server, keyId);
     /* if the key wasn't found return an error */
-    if (i >= WOLFHSM_NUM_RAMKEYS)
-        ret = WH_ERROR_NOTFOUND;
-    return ret;
+    if (i < 0)
+        return WH_ERROR_NOTFOUND;
+    /* mark key as erased */
+    hsmCacheClearSlot(server, i);
+    return 0;
 }
 
 int hsmCommitKey(whServerContext* server, whNvmId keyId)
@@ -295,14 +783,10 @@ int hsmCommitKey(whServerContext* server, whNvmId keyId)
     /* apply client_id */
     keyId |= (server->comm->client_id << 8);
     /* find key in cache */
-    for (i = 0; i < WOLFHSM_NUM_RAMKEYS; i++) {
-        if (server->cache[i].meta->id == keyId) {
-            cacheSlot = &server->cache[i];
-            break;
-        }
-    }
-    if (i >= WOLFHSM_NUM_RAMKEYS)
+    i = hsmCacheLookup(server, keyId);
+    if (i < 0)
         return WH_ERROR_NOTFOUND;
+    cacheSlot = &server->cache[i];
     /* add object */
     ret = wh_Nvm_AddObject(server->nvm, cacheSlot->meta,
         cacheSlot->meta->len, cacheSlot->buffer);
@@ -311,22 +795,69 @@ int hsmCommitKey(whServerContext* server, whNvmId keyId)
     return ret;
 }
 
+int hsmCommitKeys(whServerContext* server, uint16_t count,
+    const whKeyId* keyIds)
+{
+    int ret;
+    int i;
+    int j;
+    int slots[WOLFHSM_PACKET_KEY_COMMIT_MANY_MAX];
+    whNvmMetadata meta[WOLFHSM_PACKET_KEY_COMMIT_MANY_MAX];
+    const uint8_t* data[WOLFHSM_PACKET_KEY_COMMIT_MANY_MAX];
+    whNvmId n = 0;
+    whKeyId keyId;
+    if (server == NULL || (count > 0 && keyIds == NULL) ||
+        count > WOLFHSM_PACKET_KEY_COMMIT_MANY_MAX) {
+        return WH_ERROR_BADARGS;
+    }
+    /* find every key before writing any of them */
+    for (i = 0; i < count; i++) {
+        keyId = keyIds[i];
+        if (keyId == WOLFHSM_KEYID_ERASED)
+            return WH_ERROR_BADARGS;
+        /* apply client_id */
+        keyId |= (server->comm->client_id << 8);
+        slots[n] = hsmCacheLookup(server, keyId);
+        if (slots[n] < 0)
+            return WH_ERROR_NOTFOUND;
+        /* skip repeats */
+        for (j = 0; j < n; j++) {
+            if (slots[j] == slots[n])
+                break;
+        }
+        if (j < n)
+            continue;
+        XMEMCPY((uint8_t*)&meta[n], (uint8_t*)server->cache[slots[n]].meta,
+            sizeof(whNvmMetadata));
+        data[n] = server->cache[slots[n]].buffer;
+        n++;
+    }
+    /* add objects */
+    ret = wh_Nvm_AddObjects(server->nvm, n, meta, data);
+    if (ret == 0) {
+        for (i = 0; i < n; i++)
+            server->cache[slots[i]].commited = 1;
+    }
+    return ret;
+}
+
 int hsmEraseKey(whServerContext* server, whNvmId keyId)
 {
     int i;
+    int ret;
     if (server == NULL || keyId == WOLFHSM_KEYID_ERASED)
         return WH_ERROR_BADARGS;
     /* apply client_id */
     keyId |= (server->comm->client_id << 8);
     /* remove the key from the cache if present */
-    for (i = 0; i < WOLFHSM_NUM_RAMKEYS; i++) {
-        if (server->cache[i].meta->id == keyId) {
-            server->cache[i].meta->id = WOLFHSM_KEYID_ERASED;
-            break;
-        }
-    }
+    i = hsmCacheLookup(server, keyId);
+    if (i >= 0)
+        hsmCacheClearSlot(server, i);
     /* destroy the object */
-    return wh_Nvm_DestroyObjects(server->nvm, 1, &keyId);
+    ret = wh_Nvm_DestroyObjects(server->nvm, 1, &keyId);
+    if (ret == 0)
+        hsmKeyIdMapSet(server, keyId, 0);
+    return ret;
 }
 
 int wh_Server_HandleKeyRequest(whServerContext* server, uint16_t magic,
@@ -412,6 +943,28 @@ int wh_Server_HandleKeyRequest(whServerContext* server, uint16_t magic,
             *size = WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->keyCommitRes);
         }
         break;
+    case WH_KEY_COMMIT_MANY:
+        /* commit the listed cached keys together */
+        if (packet->keyCommitManyReq.count >
+            WOLFHSM_PACKET_KEY_COMMIT_MANY_MAX) {
+            ret = WH_ERROR_BADARGS;
+        }
+        else {
+            whKeyId keyIds[WOLFHSM_PACKET_KEY_COMMIT_MANY_MAX];
+            for (field = 0; field < packet->keyCommitManyReq.count; field++) {
+                keyIds[field] = MAKE_WOLFHSM_KEYID(WOLFHSM_KEYTYPE_CRYPTO,
+                    server->comm->client_id,
+                    packet->keyCommitManyReq.ids[field]);
+            }
+            ret = hsmCommitKeys(server, packet->keyCommitManyReq.count,
+                keyIds);
+        }
+        if (ret == 0) {
+            /* count stays as sent */
+            *size = WOLFHSM_PACKET_STUB_SIZE +
+                sizeof(packet->keyCommitManyRes);
+        }
+        break;
     case WH_KEY_ERASE:
         ret = hsmEraseKey(server, MAKE_WOLFHSM_KEYID(WOLFHSM_KEYTYPE_CRYPTO,
             server->comm->client_id, packet->keyEraseReq.id));
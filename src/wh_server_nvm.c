@@ -34,6 +34,114 @@
 
 #include "wolfhsm/wh_server_nvm.h"
 
+/* Metadata fetched from NVM per call while filling a ListMetadata response */
+#ifndef WH_SERVER_NVM_LIST_BATCH
+#define WH_SERVER_NVM_LIST_BATCH 8
+#endif
+
+/* An object moving between NVM and scatter-gather client buffers */
+typedef struct {
+    whNvmContext* nvm;
+    uint32_t offset;        /* Object offset of the next client byte */
+    whNvmId id;
+    uint16_t carry_len;     /* Bytes waiting in carry */
+    uint8_t carry[8];       /* Partial unit left by the previous buffer */
+} whServerNvmSg;
+
+/* Current metadata epoch, piggybacked on responses for client caches */
+static uint32_t _NvmEpoch(whServerContext* server)
+{
+    uint32_t epoch = 0;
+    (void)wh_Nvm_GetEpoch(server->nvm, &epoch);
+    return epoch;
+}
+
+/* Convert the request list, checking the buffers total at most max_len */
+static int _NvmSgList(const whMessageNvm_DmaSgEntry* req_sg, uint16_t count,
+        uint32_t max_len, whServerDmaSgEntry* sg, uint32_t* out_len)
+{
+    uint32_t total = 0;
+    uint16_t i = 0;
+
+    if (count > WH_MESSAGE_NVM_MAX_DMA_SG_COUNT) {
+        return WH_ERROR_BADARGS;
+    }
+    for (i = 0; i < count; i++) {
+        if (req_sg[i].data_len > max_len - total) {
+            return WH_ERROR_BADARGS;
+        }
+        total += req_sg[i].data_len;
+        sg[i].clientAddr = req_sg[i].data_hostaddr;
+        sg[i].len = req_sg[i].data_len;
+    }
+    *out_len = total;
+    return 0;
+}
+
+/* Stream one client buffer into the open object.  Whole units are written
+ * from client memory in place, only a unit split across buffers is copied */
+static int _NvmSgWrite(whServerContext* server, void* context,
+        void* serverPtr, size_t len)
+{
+    whServerNvmSg* state = (whServerNvmSg*)context;
+    const uint8_t* data = (const uint8_t*)serverPtr;
+    size_t n = 0;
+    int rc = 0;
+    (void)server;
+
+    if (state->carry_len > 0) {
+        n = sizeof(state->carry) - state->carry_len;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(state->carry + state->carry_len, data, n);
+        state->carry_len += (uint16_t)n;
+        data += n;
+        len -= n;
+        if (state->carry_len < sizeof(state->carry)) {
+            return 0;
+        }
+        rc = wh_Nvm_AddObjectWrite(state->nvm, (whNvmSize)state->offset,
+                sizeof(state->carry), state->carry);
+        if (rc != 0) {
+            return rc;
+        }
+        state->offset += sizeof(state->carry);
+        state->carry_len = 0;
+    }
+
+    n = len & ~(sizeof(state->carry) - 1);
+    if (n > 0) {
+        rc = wh_Nvm_AddObjectWrite(state->nvm, (whNvmSize)state->offset,
+                (whNvmSize)n, data);
+        if (rc != 0) {
+            return rc;
+        }
+        state->offset += n;
+        data += n;
+        len -= n;
+    }
+    memcpy(state->carry, data, len);
+    state->carry_len = (uint16_t)len;
+    return 0;
+}
+
+/* Read the next part of the object into one client buffer */
+static int _NvmSgRead(whServerContext* server, void* context,
+        void* serverPtr, size_t len)
+{
+    whServerNvmSg* state = (whServerNvmSg*)context;
+    int rc = 0;
+    (void)server;
+
+    rc = wh_Nvm_Read(state->nvm, state->id, (whNvmSize)state->offset,
+            (whNvmSize)len, (uint8_t*)serverPtr);
+    if (rc == 0) {
+        state->offset += len;
+    }
+    return rc;
+}
+
 int wh_Server_HandleNvmRequest(whServerContext* server,
         uint16_t magic, uint16_t action, uint16_t seq,
         uint16_t req_size, const void* req_packet,
@@ -91,6 +199,7 @@ int wh_Server_HandleNvmRequest(whServerContext* server,
         }
 
         /* Convert the response struct */
+        resp.epoch = _NvmEpoch(server);
         wh_MessageNvm_TranslateSimpleResponse(magic,
                 &resp, (whMessageNvm_SimpleResponse*)resp_packet);
         *out_resp_size = sizeof(resp);
@@ -116,11 +225,71 @@ int wh_Server_HandleNvmRequest(whServerContext* server,
         }
 
         /* Convert the response struct */
+        resp.epoch = _NvmEpoch(server);
         wh_MessageNvm_TranslateListResponse(magic,
                 &resp, (whMessageNvm_ListResponse*)resp_packet);
         *out_resp_size = sizeof(resp);
     }; break;
 
+    case WH_MESSAGE_NVM_ACTION_LISTMETADATA:
+    {
+        whMessageNvm_ListMetadataRequest req = {0};
+        whMessageNvm_ListMetadataResponse resp = {0};
+        whMessageNvm_ListRecord* records = (whMessageNvm_ListRecord*)
+                ((uint8_t*)resp_packet + sizeof(resp));
+        whMessageNvm_ListRecord record = {0};
+        whNvmMetadata meta[WH_SERVER_NVM_LIST_BATCH];
+        whNvmId want = 0;
+        whNvmId got = 0;
+        whNvmId i = 0;
+
+        if (req_size == sizeof(req)) {
+            /* Convert request struct */
+            wh_MessageNvm_TranslateListMetadataRequest(magic,
+                    (whMessageNvm_ListMetadataRequest*)req_packet, &req);
+            if (req.max_count > WH_MESSAGE_NVM_MAX_LIST_RECORDS) {
+                req.max_count = WH_MESSAGE_NVM_MAX_LIST_RECORDS;
+            }
+
+            /* Fill the response a batch at a time until it is full or the
+             * backend runs out of matches */
+            resp.cursor = req.cursor;
+            do {
+                want = req.max_count - resp.count;
+                if (want > WH_SERVER_NVM_LIST_BATCH) {
+                    want = WH_SERVER_NVM_LIST_BATCH;
+                }
+                got = 0;
+                resp.rc = wh_Nvm_ListMetadata(server->nvm,
+                        req.access, req.flags, &resp.cursor, want,
+                        &got, meta);
+                for (i = 0; (resp.rc == 0) && (i < got); i++) {
+                    record.id = meta[i].id;
+                    record.access = meta[i].access;
+                    record.flags = meta[i].flags;
+                    record.len = meta[i].len;
+                    memcpy(record.label, meta[i].label, sizeof(record.label));
+                    wh_MessageNvm_TranslateListRecord(magic,
+                            &record, &records[resp.count + i]);
+                }
+                resp.count += got;
+            } while (   (resp.rc == 0) && (want > 0) && (got == want) &&
+                        (resp.count < req.max_count));
+            if (resp.rc != 0) {
+                resp.count = 0;
+            }
+        } else {
+            /* Request is malformed */
+            resp.rc = WH_ERROR_ABORTED;
+        }
+
+        /* Convert the response struct */
+        wh_MessageNvm_TranslateListMetadataResponse(magic,
+                &resp, (whMessageNvm_ListMetadataResponse*)resp_packet);
+        *out_resp_size = sizeof(resp) +
+                resp.count * sizeof(whMessageNvm_ListRecord);
+    }; break;
+
     case WH_MESSAGE_NVM_ACTION_GETAVAILABLE:
     {
         /* No Request packet */
@@ -137,11 +306,43 @@ int wh_Server_HandleNvmRequest(whServerContext* server,
         }
 
         /* Convert the response struct */
+        resp.epoch = _NvmEpoch(server);
         wh_MessageNvm_TranslateGetAvailableResponse(magic,
                 &resp, (whMessageNvm_GetAvailableResponse*)resp_packet);
         *out_resp_size = sizeof(resp);
     }; break;
 
+    case WH_MESSAGE_NVM_ACTION_GETSTATS:
+    {
+        /* No Request packet */
+        whMessageNvm_GetStatsResponse resp = {0};
+        whNvmStats stats = {0};
+
+        if (req_size == 0) {
+            resp.rc = wh_Nvm_GetStats(server->nvm, &stats);
+        } else {
+            /* Request is malformed */
+            resp.rc = WH_ERROR_ABORTED;
+        }
+        if (resp.rc == 0) {
+            resp.program_ops = stats.program_ops;
+            resp.erase_ops = stats.erase_ops;
+            resp.blank_checks = stats.blank_checks;
+            resp.verifies = stats.verifies;
+            resp.compactions = stats.compactions;
+            resp.partition_erases[0] = stats.partition_erases[0];
+            resp.partition_erases[1] = stats.partition_erases[1];
+            resp.data_bytes = stats.data_bytes;
+            resp.program_bytes = stats.program_bytes;
+            resp.erase_bytes = stats.erase_bytes;
+        }
+
+        /* Convert the response struct */
+        wh_MessageNvm_TranslateGetStatsResponse(magic,
+                &resp, (whMessageNvm_GetStatsResponse*)resp_packet);
+        *out_resp_size = sizeof(resp);
+    }; break;
+
     case WH_MESSAGE_NVM_ACTION_GETMETADATA:
     {
         whMessageNvm_GetMetadataRequest req = {0};
@@ -168,6 +369,7 @@ int wh_Server_HandleNvmRequest(whServerContext* server,
             resp.rc = WH_ERROR_ABORTED;
         }
         /* Convert the response struct */
+        resp.epoch = _NvmEpoch(server);
         wh_MessageNvm_TranslateGetMetadataResponse(magic,
                 &resp, (whMessageNvm_GetMetadataResponse*)resp_packet);
         *out_resp_size = sizeof(resp);
@@ -202,11 +404,102 @@ int wh_Server_HandleNvmRequest(whServerContext* server,
             resp.rc = WH_ERROR_ABORTED;
         }
         /* Convert the response struct */
+        resp.epoch = _NvmEpoch(server);
         wh_MessageNvm_TranslateSimpleResponse(magic,
                 &resp, (whMessageNvm_SimpleResponse*)resp_packet);
         *out_resp_size = sizeof(resp);
    }; break;
 
+    case WH_MESSAGE_NVM_ACTION_ADDOBJECTBEGIN:
+    {
+        whMessageNvm_AddObjectRequest req = {0};
+        whNvmMetadata meta = {0};
+        whMessageNvm_SimpleResponse resp = {0};
+
+        if (req_size == sizeof(req)) {
+            /* Convert request struct */
+            wh_MessageNvm_TranslateAddObjectRequest(magic,
+                    (whMessageNvm_AddObjectRequest*)req_packet, &req);
+            meta.id = req.id;
+            meta.access = req.access;
+            meta.flags = req.flags;
+            meta.len = req.len;
+            memcpy(meta.label, req.label, sizeof(meta.label));
+            resp.rc = wh_Nvm_AddObjectBegin(server->nvm, &meta, req.len);
+            if (resp.rc == 0) {
+                /* Only this client may continue the stream */
+                server->nvm_stream_owner =
+                        (uint16_t)(server->comm->client_id + 1);
+            }
+        } else {
+            /* Request is malformed. */
+            resp.rc = WH_ERROR_ABORTED;
+        }
+        /* Convert the response struct */
+        resp.epoch = _NvmEpoch(server);
+        wh_MessageNvm_TranslateSimpleResponse(magic,
+                &resp, (whMessageNvm_SimpleResponse*)resp_packet);
+        *out_resp_size = sizeof(resp);
+    }; break;
+
+    case WH_MESSAGE_NVM_ACTION_ADDOBJECTWRITE:
+    {
+        whMessageNvm_AddObjectWriteRequest req = {0};
+        uint16_t hdr_len = sizeof(req);
+        const uint8_t* data = (const uint8_t*)req_packet + hdr_len;
+        whMessageNvm_SimpleResponse resp = {0};
+
+        if (req_size >= sizeof(req)) {
+            /* Convert request struct */
+            wh_MessageNvm_TranslateAddObjectWriteRequest(magic,
+                    (whMessageNvm_AddObjectWriteRequest*)req_packet, &req);
+            if (req_size != (hdr_len + req.data_len)) {
+                /* Problem in the request or transport. */
+                resp.rc = WH_ERROR_ABORTED;
+            } else if (server->nvm_stream_owner !=
+                    server->comm->client_id + 1) {
+                resp.rc = WH_ERROR_ACCESS;
+            } else {
+                resp.rc = wh_Nvm_AddObjectWrite(server->nvm,
+                        req.offset, req.data_len, data);
+            }
+        } else {
+            /* Request is malformed. */
+            resp.rc = WH_ERROR_ABORTED;
+        }
+        /* Convert the response struct */
+        resp.epoch = _NvmEpoch(server);
+        wh_MessageNvm_TranslateSimpleResponse(magic,
+                &resp, (whMessageNvm_SimpleResponse*)resp_packet);
+        *out_resp_size = sizeof(resp);
+    }; break;
+
+    case WH_MESSAGE_NVM_ACTION_ADDOBJECTFINISH:
+    {
+        whMessageNvm_AddObjectFinishRequest req = {0};
+        whMessageNvm_SimpleResponse resp = {0};
+
+        if (req_size == sizeof(req)) {
+            /* Convert request struct */
+            wh_MessageNvm_TranslateAddObjectFinishRequest(magic,
+                    (whMessageNvm_AddObjectFinishRequest*)req_packet, &req);
+            if (server->nvm_stream_owner != server->comm->client_id + 1) {
+                resp.rc = WH_ERROR_ACCESS;
+            } else {
+                resp.rc = wh_Nvm_AddObjectFinish(server->nvm, req.commit);
+                server->nvm_stream_owner = 0;
+            }
+        } else {
+            /* Request is malformed. */
+            resp.rc = WH_ERROR_ABORTED;
+        }
+        /* Convert the response struct */
+        resp.epoch = _NvmEpoch(server);
+        wh_MessageNvm_TranslateSimpleResponse(magic,
+                &resp, (whMessageNvm_SimpleResponse*)resp_packet);
+        *out_resp_size = sizeof(resp);
+    }; break;
+
     case WH_MESSAGE_NVM_ACTION_DESTROYOBJECTS:
     {
         whMessageNvm_DestroyObjectsRequest req = {0};
@@ -230,6 +523,7 @@ int wh_Server_HandleNvmRequest(whServerContext* server,
             resp.rc = WH_ERROR_ABORTED;
         }
         /* Convert the response struct */
+        resp.epoch = _NvmEpoch(server);
         wh_MessageNvm_TranslateSimpleResponse(magic,
                 &resp, (whMessageNvm_SimpleResponse*)resp_packet);
         *out_resp_size = sizeof(resp);
@@ -268,6 +562,71 @@ int wh_Server_HandleNvmRequest(whServerContext* server,
         *out_resp_size = sizeof(resp) + data_len;
     }; break;
 
+    case WH_MESSAGE_NVM_ACTION_READOBJECTS:
+    {
+        whMessageNvm_ReadObjectsRequest req = {0};
+        whMessageNvm_ReadObjectsResponse resp = {0};
+        whMessageNvm_ReadObjectsRecord record = {0};
+        whNvmMetadata meta = {0};
+        uint8_t* packet = (uint8_t*)resp_packet;
+        uint16_t offset = sizeof(resp);
+        uint16_t i = 0;
+
+        if (req_size == sizeof(req)) {
+            /* Convert request struct */
+            wh_MessageNvm_TranslateReadObjectsRequest(magic,
+                    (whMessageNvm_ReadObjectsRequest*)req_packet, &req);
+            if (req.list_count > WH_MESSAGE_NVM_MAX_READ_OBJECTS_COUNT) {
+                req.list_count = WH_MESSAGE_NVM_MAX_READ_OBJECTS_COUNT;
+            }
+
+            /* Pack metadata and data until the response is full.  An object
+             * too large for an empty response is returned without its data
+             * so the client can fall back to Read */
+            for (i = 0; i < req.list_count; i++) {
+                resp.rc = wh_Nvm_GetMetadata(server->nvm, req.list[i], &meta);
+                if (    (resp.rc != 0) ||
+                        (offset + sizeof(record) > WH_COMM_DATA_LEN)) {
+                    break;
+                }
+                record.data_len = meta.len;
+                if (offset + sizeof(record) + meta.len > WH_COMM_DATA_LEN) {
+                    if (resp.count > 0) {
+                        break;
+                    }
+                    record.data_len = 0;
+                }
+                if (record.data_len > 0) {
+                    resp.rc = wh_Nvm_Read(server->nvm, meta.id, 0,
+                            record.data_len, packet + offset + sizeof(record));
+                    if (resp.rc != 0) {
+                        break;
+                    }
+                }
+                record.id = meta.id;
+                record.access = meta.access;
+                record.flags = meta.flags;
+                record.len = meta.len;
+                memcpy(record.label, meta.label, sizeof(record.label));
+                wh_MessageNvm_TranslateReadObjectsRecord(magic, &record,
+                        (whMessageNvm_ReadObjectsRecord*)(packet + offset));
+                offset += sizeof(record) + ((record.data_len + 3) & ~3u);
+                resp.count++;
+                if (record.data_len < meta.len) {
+                    break;
+                }
+            }
+        } else {
+            /* Request is malformed */
+            resp.rc = WH_ERROR_ABORTED;
+        }
+
+        /* Convert the response struct */
+        wh_MessageNvm_TranslateReadObjectsResponse(magic,
+                &resp, (whMessageNvm_ReadObjectsResponse*)resp_packet);
+        *out_resp_size = offset;
+    }; break;
+
     case WH_MESSAGE_NVM_ACTION_ADDOBJECTDMA32:
     {
         whMessageNvm_AddObjectDma32Request req = {0};
@@ -321,6 +680,7 @@ int wh_Server_HandleNvmRequest(whServerContext* server,
         }
     transRespAddObjDma32:
         /* Convert the response struct */
+        resp.epoch = _NvmEpoch(server);
         wh_MessageNvm_TranslateSimpleResponse(magic,
                 &resp, (whMessageNvm_SimpleResponse*)resp_packet);
         *out_resp_size = sizeof(resp);
@@ -362,6 +722,7 @@ int wh_Server_HandleNvmRequest(whServerContext* server,
         }
     transRespReadDma32:
         /* Convert the response struct */
+        resp.epoch = _NvmEpoch(server);
         wh_MessageNvm_TranslateSimpleResponse(magic,
                 &resp, (whMessageNvm_SimpleResponse*)resp_packet);
         *out_resp_size = sizeof(resp);
@@ -420,6 +781,7 @@ int wh_Server_HandleNvmRequest(whServerContext* server,
         }
     transRespAddObjectDma64:
         /* Convert the response struct */
+        resp.epoch = _NvmEpoch(server);
         wh_MessageNvm_TranslateSimpleResponse(magic,
                 &resp, (whMessageNvm_SimpleResponse*)resp_packet);
         *out_resp_size = sizeof(resp);
@@ -461,6 +823,196 @@ int wh_Server_HandleNvmRequest(whServerContext* server,
         }
     transRespReadDma64:
         /* Convert the response struct */
+        resp.epoch = _NvmEpoch(server);
+        wh_MessageNvm_TranslateSimpleResponse(magic,
+                &resp, (whMessageNvm_SimpleResponse*)resp_packet);
+        *out_resp_size = sizeof(resp);
+    }; break;
+
+    case WH_MESSAGE_NVM_ACTION_READOBJECTSDMA:
+    {
+        whMessageNvm_ReadObjectsDmaRequest req = {0};
+        whMessageNvm_ReadObjectsResponse resp = {0};
+        whNvmMetadata* metadata = NULL;
+        void* data = NULL;
+        uint16_t i = 0;
+        int rc = 0;
+
+        if (req_size == sizeof(req)) {
+            /* Convert request struct */
+            wh_MessageNvm_TranslateReadObjectsDmaRequest(magic,
+                    (whMessageNvm_ReadObjectsDmaRequest*)req_packet, &req);
+            if (req.list_count > WH_MESSAGE_NVM_MAX_READ_OBJECTS_COUNT) {
+                req.list_count = WH_MESSAGE_NVM_MAX_READ_OBJECTS_COUNT;
+            }
+
+            /* perform platform-specific host address processing */
+            if (req.list_count > 0) {
+                resp.rc = wh_Server_DmaProcessClientAddress(server,
+                        req.metadata_hostaddr, (void**)&metadata,
+                        req.list_count * sizeof(*metadata),
+                        WH_DMA_OPER_CLIENT_WRITE_PRE, (whServerDmaFlags){0});
+                if (resp.rc != WH_ERROR_OK) {
+                    goto transRespReadObjectsDma;
+                }
+            }
+
+            /* Metadata is returned even when the buffer is too small, so the
+             * client learns the size to read it with */
+            for (i = 0; i < req.list_count; i++) {
+                resp.rc = wh_Nvm_GetMetadata(server->nvm, req.list[i].id,
+                        &metadata[i]);
+                if ((resp.rc == 0) &&
+                        (metadata[i].len > req.list[i].data_size)) {
+                    resp.rc = WH_ERROR_NOSPACE;
+                }
+                if ((resp.rc == 0) && (metadata[i].len > 0)) {
+                    resp.rc = wh_Server_DmaProcessClientAddress(server,
+                            req.list[i].data_hostaddr, &data,
+                            metadata[i].len, WH_DMA_OPER_CLIENT_WRITE_PRE,
+                            (whServerDmaFlags){0});
+                    if (resp.rc == 0) {
+                        resp.rc = wh_Nvm_Read(server->nvm, req.list[i].id, 0,
+                                metadata[i].len, (uint8_t*)data);
+                        rc = wh_Server_DmaProcessClientAddress(server,
+                                req.list[i].data_hostaddr, &data,
+                                metadata[i].len, WH_DMA_OPER_CLIENT_WRITE_POST,
+                                (whServerDmaFlags){0});
+                        if (resp.rc == 0) {
+                            resp.rc = rc;
+                        }
+                    }
+                }
+                if (resp.rc != 0) {
+                    break;
+                }
+                resp.count++;
+            }
+
+            if (req.list_count > 0) {
+                rc = wh_Server_DmaProcessClientAddress(server,
+                        req.metadata_hostaddr, (void**)&metadata,
+                        req.list_count * sizeof(*metadata),
+                        WH_DMA_OPER_CLIENT_WRITE_POST, (whServerDmaFlags){0});
+                if (resp.rc == 0) {
+                    resp.rc = rc;
+                }
+            }
+        } else {
+            /* Request is malformed */
+            resp.rc = WH_ERROR_ABORTED;
+        }
+    transRespReadObjectsDma:
+        /* Convert the response struct */
+        wh_MessageNvm_TranslateReadObjectsResponse(magic,
+                &resp, (whMessageNvm_ReadObjectsResponse*)resp_packet);
+        *out_resp_size = sizeof(resp);
+    }; break;
+
+    case WH_MESSAGE_NVM_ACTION_ADDOBJECTDMASG:
+    {
+        whMessageNvm_AddObjectDmaSgRequest req = {0};
+        whMessageNvm_SimpleResponse resp = {0};
+        whServerDmaSgEntry sg[WH_MESSAGE_NVM_MAX_DMA_SG_COUNT];
+        whServerNvmSg state = {0};
+        whNvmMetadata meta = {0};
+        void* metadata = NULL;
+        uint32_t len = 0;
+
+        if (req_size == sizeof(req)) {
+            /* Convert request struct */
+            wh_MessageNvm_TranslateAddObjectDmaSgRequest(magic,
+                    (whMessageNvm_AddObjectDmaSgRequest*)req_packet, &req);
+            resp.rc = _NvmSgList(req.sg, req.sg_count,
+                    WOLFHSM_NVM_MAX_OBJECT_SIZE, sg, &len);
+            if (resp.rc != WH_ERROR_OK) {
+                goto transRespAddObjectDmaSg;
+            }
+
+            /* Take a copy of the metadata, the buffers are read later */
+            resp.rc = wh_Server_DmaProcessClientAddress(server,
+                    req.metadata_hostaddr, &metadata, sizeof(meta),
+                    WH_DMA_OPER_CLIENT_READ_PRE, (whServerDmaFlags){0});
+            if (resp.rc != WH_ERROR_OK) {
+                goto transRespAddObjectDmaSg;
+            }
+            memcpy(&meta, metadata, sizeof(meta));
+            resp.rc = wh_Server_DmaProcessClientAddress(server,
+                    req.metadata_hostaddr, &metadata, sizeof(meta),
+                    WH_DMA_OPER_CLIENT_READ_POST, (whServerDmaFlags){0});
+            if (resp.rc != WH_ERROR_OK) {
+                goto transRespAddObjectDmaSg;
+            }
+
+            /* Stream the buffers to flash, so the object is only added once
+             * every buffer was read */
+            resp.rc = wh_Nvm_AddObjectBegin(server->nvm, &meta, (whNvmSize)len);
+            if (resp.rc != WH_ERROR_OK) {
+                goto transRespAddObjectDmaSg;
+            }
+            state.nvm = server->nvm;
+            resp.rc = wh_Server_DmaProcessClientSg(server, sg, req.sg_count,
+                    WH_DMA_OPER_CLIENT_READ_PRE, (whServerDmaFlags){0},
+                    _NvmSgWrite, &state);
+            if ((resp.rc == WH_ERROR_OK) && (state.carry_len > 0)) {
+                resp.rc = wh_Nvm_AddObjectWrite(server->nvm,
+                        (whNvmSize)state.offset, state.carry_len,
+                        state.carry);
+            }
+            rc = wh_Nvm_AddObjectFinish(server->nvm,
+                    (resp.rc == WH_ERROR_OK));
+            if (resp.rc == WH_ERROR_OK) {
+                resp.rc = rc;
+            }
+            rc = 0;
+        } else {
+            /* Request is malformed */
+            resp.rc = WH_ERROR_ABORTED;
+        }
+    transRespAddObjectDmaSg:
+        /* Convert the response struct */
+        resp.epoch = _NvmEpoch(server);
+        wh_MessageNvm_TranslateSimpleResponse(magic,
+                &resp, (whMessageNvm_SimpleResponse*)resp_packet);
+        *out_resp_size = sizeof(resp);
+    }; break;
+
+    case WH_MESSAGE_NVM_ACTION_READDMASG:
+    {
+        whMessageNvm_ReadDmaSgRequest req = {0};
+        whMessageNvm_SimpleResponse resp = {0};
+        whServerDmaSgEntry sg[WH_MESSAGE_NVM_MAX_DMA_SG_COUNT];
+        whServerNvmSg state = {0};
+        whNvmMetadata meta = {0};
+        uint32_t len = 0;
+
+        if (req_size == sizeof(req)) {
+            /* Convert request struct */
+            wh_MessageNvm_TranslateReadDmaSgRequest(magic,
+                    (whMessageNvm_ReadDmaSgRequest*)req_packet, &req);
+            /* The buffers must lie within the object */
+            resp.rc = wh_Nvm_GetMetadata(server->nvm, req.id, &meta);
+            if ((resp.rc == WH_ERROR_OK) && (req.offset > meta.len)) {
+                resp.rc = WH_ERROR_BADARGS;
+            }
+            if (resp.rc == WH_ERROR_OK) {
+                resp.rc = _NvmSgList(req.sg, req.sg_count,
+                        meta.len - req.offset, sg, &len);
+            }
+            if (resp.rc == WH_ERROR_OK) {
+                state.nvm = server->nvm;
+                state.id = req.id;
+                state.offset = req.offset;
+                resp.rc = wh_Server_DmaProcessClientSg(server, sg,
+                        req.sg_count, WH_DMA_OPER_CLIENT_WRITE_PRE,
+                        (whServerDmaFlags){0}, _NvmSgRead, &state);
+            }
+        } else {
+            /* Request is malformed */
+            resp.rc = WH_ERROR_ABORTED;
+        }
+        /* Convert the response struct */
+        resp.epoch = _NvmEpoch(server);
         wh_MessageNvm_TranslateSimpleResponse(magic,
                 &resp, (whMessageNvm_SimpleResponse*)resp_packet);
         *out_resp_size = sizeof(resp);
@@ -474,3 +1026,13 @@ int wh_Server_HandleNvmRequest(whServerContext* server,
     return rc;
 }
 
+
+void wh_Server_NvmStreamAbort(whServerContext* server, uint8_t client_id)
+{
+    if (    (server != NULL) &&
+            (server->nvm_stream_owner == client_id + 1)) {
+        /* Owner is gone, so drop the partial object for everyone else */
+        (void)wh_Nvm_AddObjectFinish(server->nvm, 0);
+        server->nvm_stream_owner = 0;
+    }
+}
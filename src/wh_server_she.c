@@ -34,6 +34,7 @@
 
 #include "wolfhsm/wh_server.h"
 #include "wolfhsm/wh_server_keystore.h"
+#include "wolfhsm/wh_server_crypto.h"
 #include "wolfhsm/wh_message.h"
 #include "wolfhsm/wh_packet.h"
 #include "wolfhsm/wh_error.h"
@@ -59,6 +60,8 @@ enum WOLFHSM_SHE_SB_STATE {
 /* cmac is global since the bootloader update can be called multiple times */
 Cmac sheCmac[1];
 Aes sheAes[1];
+/* the stream aes holds the key schedule and CBC chain between requests */
+Aes sheCipherAes[1];
 
 static int isLittleEndian() {
     unsigned int x = 1; /* 0x00000001 */
@@ -90,25 +93,30 @@ static int XMEMEQZERO(uint8_t* buffer, uint32_t size)
     return 1;
 }
 
-/* kdf function based on the Miyaguchi-Preneel one-way compression function */
-static int wh_AesMp16(whServerContext* server, uint8_t* in, word32 inSz, uint8_t* out)
+/* kdf function based on the Miyaguchi-Preneel one-way compression function.
+ * chain is the output of the blocks already compressed, zero for a new
+ * compression, so inputs sharing a prefix only need it compressed once */
+static int wh_AesMp16Chain(whServerContext* server, const uint8_t* chain,
+    uint8_t* in, word32 inSz, uint8_t* out)
 {
     int ret;
     int i = 0;
     int j;
     uint8_t paddedInput[AES_BLOCK_SIZE];
-    uint8_t messageZero[WOLFHSM_SHE_KEY_SZ] = {0};
+    uint8_t prev[AES_BLOCK_SIZE];
     /* check valid inputs */
-    if (server == NULL || in == NULL || inSz == 0 || out == NULL)
+    if (server == NULL || chain == NULL || in == NULL || inSz == 0 ||
+        out == NULL) {
         return WH_ERROR_BADARGS;
-    /* init with hw */
-    ret = wc_AesInit(sheAes, NULL, server->crypto->devId);
-    /* do the first block with messageZero as the key */
-    if (ret == 0) {
-        ret = wc_AesSetKeyDirect(sheAes, messageZero,
-            AES_BLOCK_SIZE, NULL, AES_ENCRYPTION);
     }
+    XMEMCPY(prev, chain, AES_BLOCK_SIZE);
+    /* init with hw */
+    ret = wc_AesInit(sheAes, NULL,
+        wh_Server_CryptoDevId(server, WH_SERVER_ENGINE_CAP_AES));
     while (ret == 0 && i < (int)inSz) {
+        /* the previous output is the key for this block */
+        ret = wc_AesSetKeyDirect(sheAes, prev, AES_BLOCK_SIZE, NULL,
+            AES_ENCRYPTION);
         /* copy a block and pad it if we're short */
         if ((int)inSz - i < (int)AES_BLOCK_SIZE) {
             XMEMCPY(paddedInput, in + i, inSz - i);
@@ -117,27 +125,179 @@ static int wh_AesMp16(whServerContext* server, uint8_t* in, word32 inSz, uint8_t
         else
             XMEMCPY(paddedInput, in + i, AES_BLOCK_SIZE);
         /* encrypt this block */
-        ret = wc_AesEncryptDirect(sheAes, out, paddedInput);
-        /* xor with the original message and then the previous block */
-        for (j = 0; j < (int)AES_BLOCK_SIZE; j++) {
-            out[j] ^= paddedInput[j];
-            /* use messageZero as our previous output buffer */
-            out[j] ^= messageZero[j];
-        }
-        /* set the key for the next block */
-        if (ret == 0) {
-            ret = wc_AesSetKeyDirect(sheAes, out, AES_BLOCK_SIZE,
-                NULL, AES_ENCRYPTION);
-        }
+        if (ret == 0)
+            ret = wc_AesEncryptDirect(sheAes, out, paddedInput);
         if (ret == 0) {
-            /* store previous output in messageZero */
-            XMEMCPY(messageZero, out, AES_BLOCK_SIZE);
+            /* xor with the original message and the previous output */
+            for (j = 0; j < (int)AES_BLOCK_SIZE; j++)
+                out[j] ^= paddedInput[j] ^ prev[j];
+            XMEMCPY(prev, out, AES_BLOCK_SIZE);
             /* increment to next block */
             i += AES_BLOCK_SIZE;
         }
     }
     /* free aes for protection */
     wc_AesFree(sheAes);
+    XMEMSET(prev, 0, sizeof(prev));
+    return ret;
+}
+
+static int wh_AesMp16(whServerContext* server, uint8_t* in, word32 inSz,
+    uint8_t* out)
+{
+    const uint8_t messageZero[AES_BLOCK_SIZE] = {0};
+    return wh_AesMp16Chain(server, messageZero, in, inSz, out);
+}
+
+#if WOLFHSM_SHE_KDF_CACHE_COUNT > 0
+/* drop the derivations of a key slot that is being replaced */
+static void hsmSheKdfEvict(whServerContext* server, whKeyId id)
+{
+    int i;
+    for (i = 0; i < WOLFHSM_SHE_KDF_CACHE_COUNT; i++) {
+        if (server->she->kdfCache[i].id == id) {
+            XMEMSET(&server->she->kdfCache[i], 0,
+                sizeof(server->she->kdfCache[i]));
+        }
+    }
+}
+#endif
+
+#if WOLFHSM_SHE_CMAC_CACHE_COUNT > 0
+static void hsmSheCmacEvictEntry(whSheCmacCacheEntry* entry)
+{
+    if (entry->id != 0)
+        (void)wc_CmacFree(entry->cmac);
+    XMEMSET(entry, 0, sizeof(*entry));
+}
+
+/* drop the CMAC of a key slot that is being replaced */
+static void hsmSheCmacEvict(whServerContext* server, whKeyId id)
+{
+    int i;
+    for (i = 0; i < WOLFHSM_SHE_CMAC_CACHE_COUNT; i++) {
+        if (server->she->cmacCache[i].id == id)
+            hsmSheCmacEvictEntry(&server->she->cmacCache[i]);
+    }
+}
+#endif
+
+void wh_Server_SheCacheFlush(whServerContext* server)
+{
+#if WOLFHSM_SHE_CMAC_CACHE_COUNT > 0
+    int i;
+#endif
+    if (server == NULL || server->she == NULL)
+        return;
+#if WOLFHSM_SHE_KDF_CACHE_COUNT > 0
+    XMEMSET(server->she->kdfCache, 0, sizeof(server->she->kdfCache));
+    server->she->kdfNext = 0;
+#endif
+#if WOLFHSM_SHE_CMAC_CACHE_COUNT > 0
+    for (i = 0; i < WOLFHSM_SHE_CMAC_CACHE_COUNT; i++)
+        hsmSheCmacEvictEntry(&server->she->cmacCache[i]);
+    server->she->cmacNext = 0;
+#endif
+}
+
+/* key sheCmac for a new message with the key read from slot id.  Entries
+ * match on the key bytes as well as the slot, so a key replaced outside of
+ * the SHE commands is never used stale */
+static int hsmSheCmacInit(whServerContext* server, whKeyId id,
+    const uint8_t* key, uint32_t keySz)
+{
+    int devId = wh_Server_CryptoDevId(server, WH_SERVER_ENGINE_CAP_AES);
+#if WOLFHSM_SHE_CMAC_CACHE_COUNT > 0
+    int ret;
+    int i;
+    whSheCmacCacheEntry* entry;
+    /* engines keep their own key state, only software contexts can be
+     * copied */
+    if (devId == INVALID_DEVID && keySz == WOLFHSM_SHE_KEY_SZ) {
+        for (i = 0; i < WOLFHSM_SHE_CMAC_CACHE_COUNT; i++) {
+            entry = &server->she->cmacCache[i];
+            if (entry->id == id &&
+                XMEMCMP(entry->key, key, WOLFHSM_SHE_KEY_SZ) == 0) {
+                XMEMCPY(sheCmac, entry->cmac, sizeof(entry->cmac));
+                return 0;
+            }
+        }
+        entry = &server->she->cmacCache[server->she->cmacNext];
+        server->she->cmacNext =
+            (server->she->cmacNext + 1) % WOLFHSM_SHE_CMAC_CACHE_COUNT;
+        hsmSheCmacEvictEntry(entry);
+        ret = wc_InitCmac_ex(entry->cmac, key, keySz, WC_CMAC_AES, NULL,
+            NULL, devId);
+        if (ret == 0) {
+            entry->id = id;
+            XMEMCPY(entry->key, key, WOLFHSM_SHE_KEY_SZ);
+            XMEMCPY(sheCmac, entry->cmac, sizeof(entry->cmac));
+        }
+        else
+            XMEMSET(entry, 0, sizeof(*entry));
+        return ret;
+    }
+#endif
+    return wc_InitCmac_ex(sheCmac, key, keySz, WC_CMAC_AES, NULL, NULL, devId);
+}
+
+/* K = AES-MP(key | constant), with key read from slot id into the start of
+ * kdfInput.  Results are matched on the key bytes so a replaced key never
+ * hits a stale entry, and a key already compressed for another constant only
+ * costs the constant block */
+static int hsmSheKdf(whServerContext* server, whKeyId id, uint8_t* kdfInput,
+    uint32_t keySz, const uint8_t* constant, uint8_t* out)
+{
+    int ret;
+#if WOLFHSM_SHE_KDF_CACHE_COUNT > 0
+    int i;
+    whSheKdfCacheEntry* entry = NULL;
+    uint8_t chain[WOLFHSM_SHE_KEY_SZ];
+#endif
+    /* kdfInput only has room for a SHE key and the constant */
+    if (keySz != WOLFHSM_SHE_KEY_SZ)
+        return WH_SHE_ERC_KEY_INVALID;
+    XMEMCPY(kdfInput + keySz, constant, WOLFHSM_SHE_KEY_SZ);
+#if WOLFHSM_SHE_KDF_CACHE_COUNT > 0
+    for (i = 0; i < WOLFHSM_SHE_KDF_CACHE_COUNT; i++) {
+        if (server->she->kdfCache[i].id == 0 ||
+            XMEMCMP(server->she->kdfCache[i].key, kdfInput,
+            WOLFHSM_SHE_KEY_SZ) != 0) {
+            continue;
+        }
+        if (XMEMCMP(server->she->kdfCache[i].constant, constant,
+            WOLFHSM_SHE_KEY_SZ) == 0) {
+            XMEMCPY(out, server->she->kdfCache[i].out, WOLFHSM_SHE_KEY_SZ);
+            return 0;
+        }
+        entry = &server->she->kdfCache[i];
+    }
+    /* compress the key block unless another constant already did */
+    if (entry != NULL) {
+        XMEMCPY(chain, entry->chain, WOLFHSM_SHE_KEY_SZ);
+        ret = 0;
+    }
+    else
+        ret = wh_AesMp16(server, kdfInput, WOLFHSM_SHE_KEY_SZ, chain);
+    if (ret == 0) {
+        ret = wh_AesMp16Chain(server, chain, kdfInput + WOLFHSM_SHE_KEY_SZ,
+            WOLFHSM_SHE_KEY_SZ, out);
+    }
+    if (ret == 0) {
+        entry = &server->she->kdfCache[server->she->kdfNext];
+        server->she->kdfNext =
+            (server->she->kdfNext + 1) % WOLFHSM_SHE_KDF_CACHE_COUNT;
+        entry->id = id;
+        XMEMCPY(entry->key, kdfInput, WOLFHSM_SHE_KEY_SZ);
+        XMEMCPY(entry->chain, chain, WOLFHSM_SHE_KEY_SZ);
+        XMEMCPY(entry->constant, constant, WOLFHSM_SHE_KEY_SZ);
+        XMEMCPY(entry->out, out, WOLFHSM_SHE_KEY_SZ);
+    }
+    XMEMSET(chain, 0, sizeof(chain));
+#else
+    (void)id;
+    ret = wh_AesMp16(server, kdfInput, WOLFHSM_SHE_KEY_SZ * 2, out);
+#endif
     return ret;
 }
 
@@ -205,7 +365,8 @@ static int hsmSheSecureBootInit(whServerContext* server, whPacket* packet,
      * expected digest so meta->len will be too long */
     if (ret == 0) {
         ret = wc_InitCmac_ex(sheCmac, macKey, WOLFHSM_SHE_KEY_SZ,
-            WC_CMAC_AES, NULL, NULL, server->crypto->devId);
+            WC_CMAC_AES, NULL, NULL,
+            wh_Server_CryptoDevId(server, WH_SERVER_ENGINE_CAP_AES));
     }
     /* hash 12 zeros */
     if (ret == 0) {
@@ -303,6 +464,44 @@ static int hsmSheSecureBootFinish(whServerContext* server, whPacket* packet,
     return ret;
 }
 
+/* secure boot in one request, hashing the image straight from client memory
+ * between the usual init and finish */
+static int hsmSheSecureBootDma(whServerContext* server, whPacket* packet,
+    uint16_t* size)
+{
+    int ret;
+    int rc;
+    uint64_t addr = packet->sheSecureBootDmaReq.addr;
+    uint32_t sz = packet->sheSecureBootDmaReq.sz;
+    void* image = NULL;
+    whServerDmaFlags flags = {0};
+    /* init reads the image size from the same packet */
+    packet->sheSecureBootInitReq.sz = sz;
+    ret = hsmSheSecureBootInit(server, packet, size);
+    if (ret == 0) {
+        ret = wh_Server_DmaProcessClientAddress(server, addr, &image, sz,
+            WH_DMA_OPER_CLIENT_READ_PRE, flags);
+        if (ret == 0) {
+            ret = wc_CmacUpdate(sheCmac, (uint8_t*)image, sz);
+            rc = wh_Server_DmaProcessClientAddress(server, addr, &image, sz,
+                WH_DMA_OPER_CLIENT_READ_POST, flags);
+            if (ret == 0)
+                ret = rc;
+        }
+    }
+    if (ret == 0) {
+        server->she->blSizeReceived = sz;
+        server->she->sbState = WOLFHSM_SHE_SB_FINISH;
+        ret = hsmSheSecureBootFinish(server, packet, size);
+    }
+    if (ret == 0) {
+        packet->sheSecureBootDmaRes.status = WOLFHSM_SHE_ERC_NO_ERROR;
+        *size = WOLFHSM_PACKET_STUB_SIZE +
+            sizeof(packet->sheSecureBootDmaRes);
+    }
+    return ret;
+}
+
 static int hsmSheGetStatus(whServerContext* server, whPacket* packet,
     uint16_t* size)
 {
@@ -326,31 +525,53 @@ static int hsmSheGetStatus(whServerContext* server, whPacket* packet,
     return 0;
 }
 
-static int hsmSheLoadKey(whServerContext* server, whPacket* packet,
-    uint16_t* size)
+/* one M1-M3 key update, held between verifying it and proving it in M4-M5 */
+typedef struct {
+    whNvmMetadata meta[1];
+    uint8_t key[WOLFHSM_SHE_KEY_SZ];
+    uint8_t ids;                /* ID << 4 | AuthID from messageOne */
+} whSheKeyUpdate;
+
+/* check M3 and the target slot, then decrypt M2 into update.  The pending
+ * updates of the same batch may authorize this one but not target its slot
+ * again */
+static int hsmSheKeyUpdateVerify(whServerContext* server,
+    wh_Packet_she_load_key_req* req, const whSheKeyUpdate* pending,
+    int pendingCount, whSheKeyUpdate* update)
 {
-    int ret;
+    int ret = 0;
+    int i;
     int keyRet = 0;
     uint32_t keySz;
     uint32_t field;
     uint8_t kdfInput[WOLFHSM_SHE_KEY_SZ * 2];
     uint8_t cmacOutput[AES_BLOCK_SIZE];
     uint8_t tmpKey[WOLFHSM_SHE_KEY_SZ];
-    whNvmMetadata meta[1];
+    whNvmMetadata meta[1] = {0};
+    const whSheKeyUpdate* authPending = NULL;
+    whKeyId authKeyId = MAKE_WOLFHSM_KEYID(WOLFHSM_KEYTYPE_SHE,
+        server->comm->client_id, hsmShePopAuthId(req->messageOne));
+    whKeyId keyId = MAKE_WOLFHSM_KEYID(WOLFHSM_KEYTYPE_SHE,
+        server->comm->client_id, hsmShePopId(req->messageOne));
+    for (i = 0; i < pendingCount; i++) {
+        if (pending[i].meta->id == keyId)
+            return WH_SHE_ERC_KEY_UPDATE_ERROR;
+        if (pending[i].meta->id == authKeyId)
+            authPending = &pending[i];
+    }
     /* read the auth key by AuthID */
     keySz = sizeof(kdfInput);
-    ret = hsmReadKey(server, MAKE_WOLFHSM_KEYID(WOLFHSM_KEYTYPE_SHE,
-        server->comm->client_id,
-        hsmShePopAuthId(packet->sheLoadKeyReq.messageOne)), NULL, kdfInput,
-        &keySz);
+    if (authPending != NULL) {
+        XMEMCPY(kdfInput, authPending->key, WOLFHSM_SHE_KEY_SZ);
+        keySz = WOLFHSM_SHE_KEY_SZ;
+    }
+    else
+        ret = hsmReadKey(server, authKeyId, NULL, kdfInput, &keySz);
     /* make K2 using AES-MP(authKey | WOLFHSM_SHE_KEY_UPDATE_MAC_C) */
     if (ret == 0) {
-        /* add WOLFHSM_SHE_KEY_UPDATE_MAC_C to the input */
-        XMEMCPY(kdfInput + keySz, WOLFHSM_SHE_KEY_UPDATE_MAC_C,
-            sizeof(WOLFHSM_SHE_KEY_UPDATE_MAC_C));
         /* do kdf */
-        ret = wh_AesMp16(server, kdfInput,
-            keySz + sizeof(WOLFHSM_SHE_KEY_UPDATE_MAC_C), tmpKey);
+        ret = hsmSheKdf(server, authKeyId, kdfInput, keySz,
+            WOLFHSM_SHE_KEY_UPDATE_MAC_C, tmpKey);
     }
     else
         ret = WH_SHE_ERC_KEY_NOT_AVAILABLE;
@@ -358,46 +579,38 @@ static int hsmSheLoadKey(whServerContext* server, whPacket* packet,
     if (ret == 0) {
         field = AES_BLOCK_SIZE;
         ret = wc_AesCmacGenerate_ex(sheCmac, cmacOutput, &field,
-            (uint8_t*)&packet->sheLoadKeyReq,
-            sizeof(packet->sheLoadKeyReq.messageOne) +
-            sizeof(packet->sheLoadKeyReq.messageTwo), tmpKey,
-            WOLFHSM_SHE_KEY_SZ, NULL, server->crypto->devId);
+            (uint8_t*)req, sizeof(req->messageOne) + sizeof(req->messageTwo),
+            tmpKey, WOLFHSM_SHE_KEY_SZ, NULL,
+            wh_Server_CryptoDevId(server, WH_SERVER_ENGINE_CAP_AES));
     }
     /* compare digest to M3 */
-    if (ret == 0 && XMEMCMP(packet->sheLoadKeyReq.messageThree,
-        cmacOutput, field) != 0) {
+    if (ret == 0 && XMEMCMP(req->messageThree, cmacOutput, field) != 0)
         ret = WH_SHE_ERC_KEY_UPDATE_ERROR;
-    }
     /* make K1 using AES-MP(authKey | WOLFHSM_SHE_KEY_UPDATE_ENC_C) */
     if (ret == 0) {
-        /* add WOLFHSM_SHE_KEY_UPDATE_ENC_C to the input */
-        XMEMCPY(kdfInput + keySz, WOLFHSM_SHE_KEY_UPDATE_ENC_C,
-            sizeof(WOLFHSM_SHE_KEY_UPDATE_ENC_C));
         /* do kdf */
-        ret = wh_AesMp16(server, kdfInput,
-            keySz + sizeof(WOLFHSM_SHE_KEY_UPDATE_ENC_C), tmpKey);
+        ret = hsmSheKdf(server, authKeyId, kdfInput, keySz,
+            WOLFHSM_SHE_KEY_UPDATE_ENC_C, tmpKey);
     }
     /* decrypt messageTwo */
     if (ret == 0)
-        ret = wc_AesInit(sheAes, NULL, server->crypto->devId);
+        ret = wc_AesInit(sheAes, NULL,
+            wh_Server_CryptoDevId(server, WH_SERVER_ENGINE_CAP_AES));
     if (ret == 0) {
         ret = wc_AesSetKey(sheAes, tmpKey, WOLFHSM_SHE_KEY_SZ,
             NULL, AES_DECRYPTION);
     }
     if (ret == 0) {
-        ret = wc_AesCbcDecrypt(sheAes,
-            packet->sheLoadKeyReq.messageTwo,
-            packet->sheLoadKeyReq.messageTwo,
-            sizeof(packet->sheLoadKeyReq.messageTwo));
+        ret = wc_AesCbcDecrypt(sheAes, req->messageTwo, req->messageTwo,
+            sizeof(req->messageTwo));
     }
     /* free aes for protection */
     wc_AesFree(sheAes);
+    memset(tmpKey, 0, sizeof(tmpKey));
     /* load the target key */
     if (ret == 0) {
-        ret = hsmReadKey(server, MAKE_WOLFHSM_KEYID(WOLFHSM_KEYTYPE_SHE,
-            server->comm->client_id,
-            hsmShePopId(packet->sheLoadKeyReq.messageOne)), meta, kdfInput,
-            &keySz);
+        keySz = sizeof(kdfInput);
+        ret = hsmReadKey(server, keyId, meta, kdfInput, &keySz);
         /* if the keyslot is empty or write protection is not on continue */
         if (ret == WH_ERROR_NOTFOUND ||
             (((whSheMetadata*)meta->label)->flags &
@@ -408,9 +621,9 @@ static int hsmSheLoadKey(whServerContext* server, whPacket* packet,
         else
             ret = WH_SHE_ERC_WRITE_PROTECTED;
     }
+    memset(kdfInput, 0, sizeof(kdfInput));
     /* check UID == 0 */
-    if (ret == 0 && XMEMEQZERO(packet->sheLoadKeyReq.messageOne,
-        WOLFHSM_SHE_UID_SZ) == 1) {
+    if (ret == 0 && XMEMEQZERO(req->messageOne, WOLFHSM_SHE_UID_SZ) == 1) {
         /* check wildcard */
         if ((((whSheMetadata*)meta->label)->flags & WOLFHSM_SHE_FLAG_WILDCARD)
             == 0) {
@@ -418,102 +631,201 @@ static int hsmSheLoadKey(whServerContext* server, whPacket* packet,
         }
     }
     /* compare to UID */
-    else if (ret == 0 && XMEMCMP(packet->sheLoadKeyReq.messageOne,
-        server->she->uid, sizeof(server->she->uid)) != 0) {
+    else if (ret == 0 && XMEMCMP(req->messageOne, server->she->uid,
+        sizeof(server->she->uid)) != 0) {
         ret = WH_SHE_ERC_KEY_UPDATE_ERROR;
     }
     /* verify counter is greater than stored value */
     if (ret == 0 &&
         keyRet != WH_ERROR_NOTFOUND &&
-        ntohl(*((uint32_t*)packet->sheLoadKeyReq.messageTwo) >> 4) <=
+        ntohl(*((uint32_t*)req->messageTwo) >> 4) <=
         ntohl(((whSheMetadata*)meta->label)->count)) {
         ret = WH_SHE_ERC_KEY_UPDATE_ERROR;
     }
-    /* write key with counter */
+    /* key with counter and flags, ready to write */
     if (ret == 0) {
-        meta->id = MAKE_WOLFHSM_KEYID(WOLFHSM_KEYTYPE_SHE,
-            server->comm->client_id,
-            hsmShePopId(packet->sheLoadKeyReq.messageOne));
-        ((whSheMetadata*)meta->label)->flags =
-            hsmShePopFlags(packet->sheLoadKeyReq.messageTwo);
-        ((whSheMetadata*)meta->label)->count =
-            (*(uint32_t*)packet->sheLoadKeyReq.messageTwo >> 4);
-        meta->len = WOLFHSM_SHE_KEY_SZ;
-        /* cache if ram key, overwrite otherwise */
-        if ((meta->id & WOLFHSM_KEYID_MASK) == WOLFHSM_SHE_RAM_KEY_ID) {
-            ret = hsmCacheKey(server, meta, packet->sheLoadKeyReq.messageTwo
-                + WOLFHSM_SHE_KEY_SZ);
-        }
-        else {
-            ret = wh_Nvm_AddObject(server->nvm, meta, meta->len,
-                packet->sheLoadKeyReq.messageTwo + WOLFHSM_SHE_KEY_SZ);
-            /* read the evicted back from nvm */
-            if (ret == 0) {
-                keySz = WOLFHSM_SHE_KEY_SZ;
-                ret = hsmReadKey(server, meta->id, meta,
-                    packet->sheLoadKeyReq.messageTwo + WOLFHSM_SHE_KEY_SZ,
-                    &keySz);
-            }
-        }
-        if (ret != 0)
-            ret = WH_SHE_ERC_KEY_UPDATE_ERROR;
+        memset(update, 0, sizeof(*update));
+        update->meta->id = keyId;
+        ((whSheMetadata*)update->meta->label)->flags =
+            hsmShePopFlags(req->messageTwo);
+        ((whSheMetadata*)update->meta->label)->count =
+            (*(uint32_t*)req->messageTwo >> 4);
+        update->meta->len = WOLFHSM_SHE_KEY_SZ;
+        XMEMCPY(update->key, req->messageTwo + WOLFHSM_SHE_KEY_SZ,
+            WOLFHSM_SHE_KEY_SZ);
+        update->ids = req->messageOne[WOLFHSM_SHE_M1_SZ - 1];
     }
+    return ret;
+}
+
+/* drop everything derived from a slot that is about to be replaced */
+static void hsmSheKeyUpdateEvict(whServerContext* server, whKeyId id)
+{
+#if WOLFHSM_SHE_KDF_CACHE_COUNT > 0
+    hsmSheKdfEvict(server, id);
+#endif
+#if WOLFHSM_SHE_CMAC_CACHE_COUNT > 0
+    hsmSheCmacEvict(server, id);
+#endif
+    (void)server;
+    (void)id;
+}
+
+/* build M4 and M5 proving update was loaded */
+static int hsmSheKeyUpdateProof(whServerContext* server,
+    whSheKeyUpdate* update, uint8_t* messageFour, uint8_t* messageFive)
+{
+    int ret;
+    uint32_t field;
+    uint8_t kdfInput[WOLFHSM_SHE_KEY_SZ * 2];
+    uint8_t tmpKey[WOLFHSM_SHE_KEY_SZ];
     /* generate K3 using the updated key */
-    if (ret == 0) {
-        /* copy new key to kdfInput */
-        XMEMCPY(kdfInput, packet->sheLoadKeyReq.messageTwo +
-            WOLFHSM_SHE_KEY_SZ, WOLFHSM_SHE_KEY_SZ);
-        /* add WOLFHSM_SHE_KEY_UPDATE_ENC_C to the input */
-        XMEMCPY(kdfInput + meta->len, WOLFHSM_SHE_KEY_UPDATE_ENC_C,
-            sizeof(WOLFHSM_SHE_KEY_UPDATE_ENC_C));
-        /* do kdf */
-        ret = wh_AesMp16(server, kdfInput,
-            meta->len + sizeof(WOLFHSM_SHE_KEY_UPDATE_ENC_C), tmpKey);
-    }
+    XMEMCPY(kdfInput, update->key, WOLFHSM_SHE_KEY_SZ);
+    ret = hsmSheKdf(server, update->meta->id, kdfInput, update->meta->len,
+        WOLFHSM_SHE_KEY_UPDATE_ENC_C, tmpKey);
     if (ret == 0)
-        ret = wc_AesInit(sheAes, NULL, server->crypto->devId);
+        ret = wc_AesInit(sheAes, NULL,
+            wh_Server_CryptoDevId(server, WH_SERVER_ENGINE_CAP_AES));
     if (ret == 0) {
         ret = wc_AesSetKey(sheAes, tmpKey, WOLFHSM_SHE_KEY_SZ,
             NULL, AES_ENCRYPTION);
     }
     if (ret == 0) {
-        /* reset messageTwo with the nvm read counter, pad with a 1 bit */
-        *(uint32_t*)packet->sheLoadKeyReq.messageTwo =
-            (((whSheMetadata*)meta->label)->count << 4);
-        packet->sheLoadKeyReq.messageTwo[3] |= 0x08;
+        /* set the counter, pad with a 1 bit */
+        XMEMSET(messageFour + WOLFHSM_SHE_KEY_SZ, 0, WOLFHSM_SHE_KEY_SZ);
+        *(uint32_t*)(messageFour + WOLFHSM_SHE_KEY_SZ) =
+            (((whSheMetadata*)update->meta->label)->count << 4);
+        messageFour[WOLFHSM_SHE_KEY_SZ + 3] |= 0x08;
         /* encrypt the new counter */
-        ret = wc_AesEncryptDirect(sheAes,
-            packet->sheLoadKeyRes.messageFour + WOLFHSM_SHE_KEY_SZ,
-            packet->sheLoadKeyReq.messageTwo);
+        ret = wc_AesEncryptDirect(sheAes, messageFour + WOLFHSM_SHE_KEY_SZ,
+            messageFour + WOLFHSM_SHE_KEY_SZ);
     }
     /* free aes for protection */
     wc_AesFree(sheAes);
     /* generate K4 using the updated key */
     if (ret == 0) {
-        /* set our UID, ID and AUTHID are already set from messageOne */
-        XMEMCPY(packet->sheLoadKeyRes.messageFour, server->she->uid,
-            sizeof(server->she->uid));
-        /* add WOLFHSM_SHE_KEY_UPDATE_MAC_C to the input */
-        XMEMCPY(kdfInput + meta->len, WOLFHSM_SHE_KEY_UPDATE_MAC_C,
-            sizeof(WOLFHSM_SHE_KEY_UPDATE_MAC_C));
+        /* set our UID, ID and AUTHID */
+        XMEMCPY(messageFour, server->she->uid, sizeof(server->she->uid));
+        messageFour[WOLFHSM_SHE_UID_SZ] = update->ids;
         /* do kdf */
-        ret = wh_AesMp16(server, kdfInput,
-            meta->len + sizeof(WOLFHSM_SHE_KEY_UPDATE_MAC_C), tmpKey);
+        ret = hsmSheKdf(server, update->meta->id, kdfInput,
+            update->meta->len, WOLFHSM_SHE_KEY_UPDATE_MAC_C, tmpKey);
     }
     /* cmac messageFour using K4 as the cmac key */
     if (ret == 0) {
         field = AES_BLOCK_SIZE;
-        ret = wc_AesCmacGenerate_ex(sheCmac, packet->sheLoadKeyRes.messageFive,
-            &field, packet->sheLoadKeyRes.messageFour,
-            sizeof(packet->sheLoadKeyRes.messageFour), tmpKey,
-            WOLFHSM_SHE_KEY_SZ, NULL, server->crypto->devId);
+        ret = wc_AesCmacGenerate_ex(sheCmac, messageFive, &field, messageFour,
+            WOLFHSM_SHE_M4_SZ, tmpKey, WOLFHSM_SHE_KEY_SZ, NULL,
+            wh_Server_CryptoDevId(server, WH_SERVER_ENGINE_CAP_AES));
+    }
+    memset(kdfInput, 0, sizeof(kdfInput));
+    memset(tmpKey, 0, sizeof(tmpKey));
+    return ret;
+}
+
+static int hsmSheLoadKey(whServerContext* server, whPacket* packet,
+    uint16_t* size)
+{
+    int ret;
+    uint32_t keySz;
+    whSheKeyUpdate update[1];
+    ret = hsmSheKeyUpdateVerify(server, &packet->sheLoadKeyReq, NULL, 0,
+        update);
+    /* write key with counter */
+    if (ret == 0) {
+        hsmSheKeyUpdateEvict(server, update->meta->id);
+        /* cache if ram key, overwrite otherwise */
+        if ((update->meta->id & WOLFHSM_KEYID_MASK) ==
+            WOLFHSM_SHE_RAM_KEY_ID) {
+            ret = hsmCacheKey(server, update->meta, update->key);
+        }
+        else {
+            ret = wh_Nvm_AddObject(server->nvm, update->meta,
+                update->meta->len, update->key);
+            /* read the evicted back from nvm */
+            if (ret == 0) {
+                keySz = WOLFHSM_SHE_KEY_SZ;
+                ret = hsmReadKey(server, update->meta->id, update->meta,
+                    update->key, &keySz);
+            }
+        }
+        if (ret != 0)
+            ret = WH_SHE_ERC_KEY_UPDATE_ERROR;
+    }
+    if (ret == 0) {
+        ret = hsmSheKeyUpdateProof(server, update,
+            packet->sheLoadKeyRes.messageFour,
+            packet->sheLoadKeyRes.messageFive);
     }
     if (ret == 0) {
         *size = WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->sheLoadKeyRes);
         /* mark if the ram key was loaded */
-        if ((meta->id & WOLFHSM_KEYID_MASK) == WOLFHSM_SHE_RAM_KEY_ID)
+        if ((update->meta->id & WOLFHSM_KEYID_MASK) == WOLFHSM_SHE_RAM_KEY_ID)
             server->she->ramKeyPlain = 1;
     }
+    memset(update, 0, sizeof(update));
+    return ret;
+}
+
+/* verify every M1-M3 in order, write all of the nvm slots in one batch and
+ * answer with M4-M5 for each.  Nothing is written unless every update
+ * verifies */
+static int hsmSheLoadKeyBatch(whServerContext* server, whPacket* packet,
+    uint16_t* size)
+{
+    int ret = 0;
+    int i;
+    int ramIdx = -1;
+    whNvmId n = 0;
+    uint32_t count = packet->sheLoadKeyBatchReq.count;
+    wh_Packet_she_load_key_req* req;
+    wh_Packet_she_load_key_res* res;
+    whSheKeyUpdate update[WOLFHSM_PACKET_SHE_LOAD_KEY_BATCH_MAX];
+    whNvmMetadata meta[WOLFHSM_PACKET_SHE_LOAD_KEY_BATCH_MAX];
+    const uint8_t* data[WOLFHSM_PACKET_SHE_LOAD_KEY_BATCH_MAX];
+    /* tuples are after the fixed sized fields */
+    req = (wh_Packet_she_load_key_req*)(&packet->sheLoadKeyBatchReq + 1);
+    res = (wh_Packet_she_load_key_res*)(&packet->sheLoadKeyBatchRes + 1);
+    if (count == 0 || count > WOLFHSM_PACKET_SHE_LOAD_KEY_BATCH_MAX)
+        return WH_ERROR_BADARGS;
+    for (i = 0; ret == 0 && i < (int)count; i++)
+        ret = hsmSheKeyUpdateVerify(server, &req[i], update, i, &update[i]);
+    /* the ram key is cached, everything else goes into one nvm batch */
+    if (ret == 0) {
+        for (i = 0; i < (int)count; i++) {
+            hsmSheKeyUpdateEvict(server, update[i].meta->id);
+            if ((update[i].meta->id & WOLFHSM_KEYID_MASK) ==
+                WOLFHSM_SHE_RAM_KEY_ID) {
+                ramIdx = i;
+                continue;
+            }
+            /* drop any cached copy so later reads see the new key */
+            (void)hsmEvictKey(server, update[i].meta->id);
+            XMEMCPY(&meta[n], update[i].meta, sizeof(meta[n]));
+            data[n] = update[i].key;
+            n++;
+        }
+        ret = wh_Nvm_AddObjects(server->nvm, n, meta, data);
+        if (ret == 0 && ramIdx >= 0) {
+            ret = hsmCacheKey(server, update[ramIdx].meta,
+                update[ramIdx].key);
+        }
+        if (ret != 0)
+            ret = WH_SHE_ERC_KEY_UPDATE_ERROR;
+    }
+    /* the requests are all consumed, so the responses can overwrite them */
+    for (i = 0; ret == 0 && i < (int)count; i++) {
+        ret = hsmSheKeyUpdateProof(server, &update[i], res[i].messageFour,
+            res[i].messageFive);
+    }
+    if (ret == 0) {
+        if (ramIdx >= 0)
+            server->she->ramKeyPlain = 1;
+        packet->sheLoadKeyBatchRes.count = count;
+        *size = WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->sheLoadKeyBatchRes) +
+            count * sizeof(*res);
+    }
+    memset(update, 0, sizeof(update));
     return ret;
 }
 
@@ -525,6 +837,12 @@ static int hsmSheLoadPlainKey(whServerContext* server, whPacket* packet,
     meta->id = MAKE_WOLFHSM_KEYID(WOLFHSM_KEYTYPE_SHE,
         server->comm->client_id, WOLFHSM_SHE_RAM_KEY_ID);
     meta->len = WOLFHSM_SHE_KEY_SZ;
+#if WOLFHSM_SHE_KDF_CACHE_COUNT > 0
+    hsmSheKdfEvict(server, meta->id);
+#endif
+#if WOLFHSM_SHE_CMAC_CACHE_COUNT > 0
+    hsmSheCmacEvict(server, meta->id);
+#endif
     /* cache if ram key, overwrite otherwise */
     ret = hsmCacheKey(server, meta, packet->sheLoadPlainKeyReq.key);
     if (ret == 0) {
@@ -562,12 +880,10 @@ static int hsmSheExportRamKey(whServerContext* server, whPacket* packet,
             sizeof(server->she->uid));
         packet->sheExportRamKeyRes.messageOne[15] =
             ((WOLFHSM_SHE_RAM_KEY_ID << 4) | (WOLFHSM_SHE_SECRET_KEY_ID));
-        /* add WOLFHSM_SHE_KEY_UPDATE_ENC_C to the input */
-        XMEMCPY(kdfInput + meta->len, WOLFHSM_SHE_KEY_UPDATE_ENC_C,
-            sizeof(WOLFHSM_SHE_KEY_UPDATE_ENC_C));
         /* generate K1 */
-        ret = wh_AesMp16(server, kdfInput,
-            meta->len + sizeof(WOLFHSM_SHE_KEY_UPDATE_ENC_C), tmpKey);
+        ret = hsmSheKdf(server, MAKE_WOLFHSM_KEYID(WOLFHSM_KEYTYPE_SHE,
+            server->comm->client_id, WOLFHSM_SHE_SECRET_KEY_ID), kdfInput,
+            meta->len, WOLFHSM_SHE_KEY_UPDATE_ENC_C, tmpKey);
     }
     /* build cleartext M2 */
     if (ret == 0) {
@@ -587,7 +903,8 @@ static int hsmSheExportRamKey(whServerContext* server, whPacket* packet,
     }
     /* encrypt M2 with K1 */
     if (ret == 0)
-        ret = wc_AesInit(sheAes, NULL, server->crypto->devId);
+        ret = wc_AesInit(sheAes, NULL,
+            wh_Server_CryptoDevId(server, WH_SERVER_ENGINE_CAP_AES));
     if (ret == 0) {
         ret = wc_AesSetKey(sheAes, tmpKey, WOLFHSM_SHE_KEY_SZ, NULL,
             AES_ENCRYPTION);
@@ -605,12 +922,10 @@ static int hsmSheExportRamKey(whServerContext* server, whPacket* packet,
     /* free aes for protection */
     wc_AesFree(sheAes);
     if (ret == 0) {
-        /* add WOLFHSM_SHE_KEY_UPDATE_MAC_C to the input */
-        XMEMCPY(kdfInput + meta->len, WOLFHSM_SHE_KEY_UPDATE_MAC_C,
-            sizeof(WOLFHSM_SHE_KEY_UPDATE_MAC_C));
         /* generate K2 */
-        ret = wh_AesMp16(server, kdfInput,
-            meta->len + sizeof(WOLFHSM_SHE_KEY_UPDATE_MAC_C), tmpKey);
+        ret = hsmSheKdf(server, MAKE_WOLFHSM_KEYID(WOLFHSM_KEYTYPE_SHE,
+            server->comm->client_id, WOLFHSM_SHE_SECRET_KEY_ID), kdfInput,
+            meta->len, WOLFHSM_SHE_KEY_UPDATE_MAC_C, tmpKey);
     }
     /* cmac messageOne and messageTwo using K2 as the cmac key */
     if (ret == 0) {
@@ -620,21 +935,21 @@ static int hsmSheExportRamKey(whServerContext* server, whPacket* packet,
             (uint8_t*)&packet->sheExportRamKeyRes,
             sizeof(packet->sheExportRamKeyRes.messageOne) +
             sizeof(packet->sheExportRamKeyRes.messageTwo), tmpKey,
-            WOLFHSM_SHE_KEY_SZ, NULL, server->crypto->devId);
+            WOLFHSM_SHE_KEY_SZ, NULL,
+            wh_Server_CryptoDevId(server, WH_SERVER_ENGINE_CAP_AES));
     }
     if (ret == 0) {
         /* copy the ram key to kdfInput */
         XMEMCPY(kdfInput, cmacOutput, WOLFHSM_SHE_KEY_SZ);
-        /* add WOLFHSM_SHE_KEY_UPDATE_ENC_C to the input */
-        XMEMCPY(kdfInput + WOLFHSM_SHE_KEY_SZ, WOLFHSM_SHE_KEY_UPDATE_ENC_C,
-            sizeof(WOLFHSM_SHE_KEY_UPDATE_ENC_C));
         /* generate K3 */
-        ret = wh_AesMp16(server, kdfInput,
-            WOLFHSM_SHE_KEY_SZ + sizeof(WOLFHSM_SHE_KEY_UPDATE_ENC_C), tmpKey);
+        ret = hsmSheKdf(server, MAKE_WOLFHSM_KEYID(WOLFHSM_KEYTYPE_SHE,
+            server->comm->client_id, WOLFHSM_SHE_RAM_KEY_ID), kdfInput,
+            WOLFHSM_SHE_KEY_SZ, WOLFHSM_SHE_KEY_UPDATE_ENC_C, tmpKey);
     }
     /* set K3 as encryption key */
     if (ret == 0)
-        ret = wc_AesInit(sheAes, NULL, server->crypto->devId);
+        ret = wc_AesInit(sheAes, NULL,
+            wh_Server_CryptoDevId(server, WH_SERVER_ENGINE_CAP_AES));
     if (ret == 0) {
         ret = wc_AesSetKey(sheAes, tmpKey, WOLFHSM_SHE_KEY_SZ,
             NULL, AES_ENCRYPTION);
@@ -660,12 +975,10 @@ static int hsmSheExportRamKey(whServerContext* server, whPacket* packet,
             sizeof(server->she->uid));
         packet->sheExportRamKeyRes.messageFour[15] =
             ((WOLFHSM_SHE_RAM_KEY_ID << 4) | (WOLFHSM_SHE_SECRET_KEY_ID));
-        /* add WOLFHSM_SHE_KEY_UPDATE_MAC_C to the input */
-        XMEMCPY(kdfInput + WOLFHSM_SHE_KEY_SZ, WOLFHSM_SHE_KEY_UPDATE_MAC_C,
-            sizeof(WOLFHSM_SHE_KEY_UPDATE_MAC_C));
         /* generate K4 */
-        ret = wh_AesMp16(server, kdfInput,
-            WOLFHSM_SHE_KEY_SZ + sizeof(WOLFHSM_SHE_KEY_UPDATE_MAC_C), tmpKey);
+        ret = hsmSheKdf(server, MAKE_WOLFHSM_KEYID(WOLFHSM_KEYTYPE_SHE,
+            server->comm->client_id, WOLFHSM_SHE_RAM_KEY_ID), kdfInput,
+            WOLFHSM_SHE_KEY_SZ, WOLFHSM_SHE_KEY_UPDATE_MAC_C, tmpKey);
     }
     /* cmac messageFour using K4 as the cmac key */
     if (ret == 0) {
@@ -674,7 +987,8 @@ static int hsmSheExportRamKey(whServerContext* server, whPacket* packet,
             packet->sheExportRamKeyRes.messageFive, &field,
             packet->sheExportRamKeyRes.messageFour,
             sizeof(packet->sheExportRamKeyRes.messageFour), tmpKey,
-            WOLFHSM_SHE_KEY_SZ, NULL, server->crypto->devId);
+            WOLFHSM_SHE_KEY_SZ, NULL,
+            wh_Server_CryptoDevId(server, WH_SERVER_ENGINE_CAP_AES));
     }
     if (ret == 0)
         *size = WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->sheExportRamKeyRes);
@@ -721,7 +1035,8 @@ static int hsmSheInitRnd(whServerContext* server, whPacket* packet,
     }
     /* set up aes */
     if (ret == 0)
-        ret = wc_AesInit(sheAes, NULL, server->crypto->devId);
+        ret = wc_AesInit(sheAes, NULL,
+            wh_Server_CryptoDevId(server, WH_SERVER_ENGINE_CAP_AES));
     if (ret == 0) {
         ret = wc_AesSetKey(sheAes, tmpKey, WOLFHSM_SHE_KEY_SZ,
             NULL, AES_ENCRYPTION);
@@ -763,32 +1078,88 @@ static int hsmSheInitRnd(whServerContext* server, whPacket* packet,
     return ret;
 }
 
-static int hsmSheRnd(whServerContext* server, whPacket* packet, uint16_t* size)
+/* fill out with sz bytes of PRNG output.  Each block is the previous state
+ * encrypted under PRNG_KEY, which is CBC encryption of zeros with the state
+ * as the iv, so one key schedule covers the whole request */
+static int hsmSheRndBlocks(whServerContext* server, uint8_t* out, uint32_t sz)
 {
     int ret = 0;
     /* check that rng has been inited */
     if (server->she->rndInited == 0)
-        ret = WH_SHE_ERC_RNG_SEED;
+        return WH_SHE_ERC_RNG_SEED;
+    if (sz == 0 || (sz % WOLFHSM_SHE_KEY_SZ) != 0)
+        return WH_ERROR_BADARGS;
+    XMEMSET(out, 0, sz);
     /* set up aes */
-    if (ret == 0)
-        ret = wc_AesInit(sheAes, NULL, server->crypto->devId);
-    /* use PRNG_KEY as the encryption key */
+    ret = wc_AesInit(sheAes, NULL,
+        wh_Server_CryptoDevId(server, WH_SERVER_ENGINE_CAP_AES));
+    /* use PRNG_KEY as the encryption key and PRNG_STATE, i - 1 as the iv */
     if (ret == 0) {
         ret = wc_AesSetKey(sheAes, server->she->prngKey,
-            WOLFHSM_SHE_KEY_SZ, NULL, AES_ENCRYPTION);
-    }
-    /* encrypt the PRNG_STATE, i - 1 to i */
-    if (ret == 0) {
-        ret = wc_AesCbcEncrypt(sheAes, server->she->prngState,
-            server->she->prngState, WOLFHSM_SHE_KEY_SZ);
+            WOLFHSM_SHE_KEY_SZ, server->she->prngState, AES_ENCRYPTION);
     }
+    /* encrypt PRNG_STATE, i - 1 to i once per block */
+    if (ret == 0)
+        ret = wc_AesCbcEncrypt(sheAes, out, out, sz);
     /* free aes for protection */
     wc_AesFree(sheAes);
+    /* the last block is the new PRNG_STATE */
     if (ret == 0) {
-        /* copy PRNG_STATE */
-        XMEMCPY(packet->sheRndRes.rnd, server->she->prngState,
+        XMEMCPY(server->she->prngState, out + sz - WOLFHSM_SHE_KEY_SZ,
             WOLFHSM_SHE_KEY_SZ);
+    }
+    return ret;
+}
+
+static int hsmSheRnd(whServerContext* server, whPacket* packet, uint16_t* size)
+{
+    int ret;
+    ret = hsmSheRndBlocks(server, packet->sheRndRes.rnd,
+        sizeof(packet->sheRndRes.rnd));
+    if (ret == 0)
         *size = WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->sheRndRes);
+    return ret;
+}
+
+static int hsmSheRndBulk(whServerContext* server, whPacket* packet,
+    uint16_t* size)
+{
+    int ret = 0;
+    uint32_t sz = packet->sheRndBulkReq.sz;
+    /* rnd is after the fixed sized fields */
+    uint8_t* out = (uint8_t*)(&packet->sheRndBulkRes + 1);
+    if (sz > WOLFHSM_PACKET_SHE_RND_BULK_MAX_SZ)
+        ret = WH_ERROR_BADARGS;
+    if (ret == 0)
+        ret = hsmSheRndBlocks(server, out, sz);
+    if (ret == 0) {
+        packet->sheRndBulkRes.sz = sz;
+        *size = WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->sheRndBulkRes) + sz;
+    }
+    return ret;
+}
+
+static int hsmSheRndDma(whServerContext* server, whPacket* packet,
+    uint16_t* size)
+{
+    int ret;
+    int rc;
+    uint64_t addr = packet->sheRndDmaReq.addr;
+    uint32_t sz = packet->sheRndDmaReq.sz;
+    void* out = NULL;
+    whServerDmaFlags flags = {0};
+    ret = wh_Server_DmaProcessClientAddress(server, addr, &out, sz,
+        WH_DMA_OPER_CLIENT_WRITE_PRE, flags);
+    if (ret == 0) {
+        ret = hsmSheRndBlocks(server, (uint8_t*)out, sz);
+        rc = wh_Server_DmaProcessClientAddress(server, addr, &out, sz,
+            WH_DMA_OPER_CLIENT_WRITE_POST, flags);
+        if (ret == 0)
+            ret = rc;
+    }
+    if (ret == 0) {
+        packet->sheRndDmaRes.status = WOLFHSM_SHE_ERC_NO_ERROR;
+        *size = WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->sheRndDmaRes);
     }
     return ret;
 }
@@ -868,7 +1239,8 @@ static int hsmSheEncEcb(whServerContext* server, whPacket* packet,
         server->comm->client_id, packet->sheEncEcbReq.keyId), NULL,
         tmpKey, &keySz);
     if (ret == 0)
-        ret = wc_AesInit(sheAes, NULL, server->crypto->devId);
+        ret = wc_AesInit(sheAes, NULL,
+            wh_Server_CryptoDevId(server, WH_SERVER_ENGINE_CAP_AES));
     else
         ret = WH_SHE_ERC_KEY_NOT_AVAILABLE;
     if (ret == 0)
@@ -905,7 +1277,8 @@ static int hsmSheEncCbc(whServerContext* server, whPacket* packet,
         server->comm->client_id, packet->sheEncCbcReq.keyId), NULL,
         tmpKey, &keySz);
     if (ret == 0)
-        ret = wc_AesInit(sheAes, NULL, server->crypto->devId);
+        ret = wc_AesInit(sheAes, NULL,
+            wh_Server_CryptoDevId(server, WH_SERVER_ENGINE_CAP_AES));
     else
         ret = WH_SHE_ERC_KEY_NOT_AVAILABLE;
     if (ret == 0) {
@@ -944,7 +1317,8 @@ static int hsmSheDecEcb(whServerContext* server, whPacket* packet,
         server->comm->client_id, packet->sheDecEcbReq.keyId), NULL,
         tmpKey, &keySz);
     if (ret == 0)
-        ret = wc_AesInit(sheAes, NULL, server->crypto->devId);
+        ret = wc_AesInit(sheAes, NULL,
+            wh_Server_CryptoDevId(server, WH_SERVER_ENGINE_CAP_AES));
     else
         ret = WH_SHE_ERC_KEY_NOT_AVAILABLE;
     if (ret == 0)
@@ -981,7 +1355,8 @@ static int hsmSheDecCbc(whServerContext* server, whPacket* packet,
         server->comm->client_id, packet->sheDecCbcReq.keyId), NULL,
         tmpKey, &keySz);
     if (ret == 0)
-        ret = wc_AesInit(sheAes, NULL, server->crypto->devId);
+        ret = wc_AesInit(sheAes, NULL,
+            wh_Server_CryptoDevId(server, WH_SERVER_ENGINE_CAP_AES));
     else
         ret = WH_SHE_ERC_KEY_NOT_AVAILABLE;
     if (ret == 0) {
@@ -1003,25 +1378,28 @@ static int hsmSheGenerateMac(whServerContext* server, whPacket* packet,
     uint16_t* size)
 {
     int ret;
-    uint32_t field = AES_BLOCK_SIZE;
+    word32 field = AES_BLOCK_SIZE;
     uint32_t keySz;
     uint8_t* in;
     uint8_t tmpKey[WOLFHSM_SHE_KEY_SZ];
+    whKeyId keyId = MAKE_WOLFHSM_KEYID(WOLFHSM_KEYTYPE_SHE,
+        server->comm->client_id, packet->sheGenMacReq.keyId);
     /* in and out are after the fixed sized fields */
     in = (uint8_t*)(&packet->sheGenMacReq + 1);
     /* load the key */
     keySz = WOLFHSM_SHE_KEY_SZ;
-    ret = hsmReadKey(server, MAKE_WOLFHSM_KEYID(WOLFHSM_KEYTYPE_SHE,
-        server->comm->client_id, packet->sheGenMacReq.keyId), NULL, tmpKey,
-        &keySz);
+    ret = hsmReadKey(server, keyId, NULL, tmpKey, &keySz);
     /* hash the message */
     if (ret == 0) {
-        ret = wc_AesCmacGenerate_ex(sheCmac, packet->sheGenMacRes.mac, &field,
-            in, packet->sheGenMacReq.sz, tmpKey, WOLFHSM_SHE_KEY_SZ, NULL,
-            server->crypto->devId);
+        ret = hsmSheCmacInit(server, keyId, tmpKey, keySz);
+        if (ret == 0)
+            ret = wc_CmacUpdate(sheCmac, in, packet->sheGenMacReq.sz);
+        if (ret == 0)
+            ret = wc_CmacFinal(sheCmac, packet->sheGenMacRes.mac, &field);
     }
     else
         ret = WH_SHE_ERC_KEY_NOT_AVAILABLE;
+    memset(tmpKey, 0, sizeof(tmpKey));
     if (ret == 0)
         *size = WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->sheGenMacRes);
     return ret;
@@ -1031,32 +1409,202 @@ static int hsmSheVerifyMac(whServerContext* server, whPacket* packet,
     uint16_t* size)
 {
     int ret;
+    int i;
+    uint8_t diff = 0;
+    word32 field = AES_BLOCK_SIZE;
     uint32_t keySz;
+    uint32_t macLen = packet->sheVerifyMacReq.macLen;
     uint8_t* message;
     uint8_t* mac;
     uint8_t tmpKey[WOLFHSM_SHE_KEY_SZ];
+    uint8_t digest[AES_BLOCK_SIZE];
+    whKeyId keyId = MAKE_WOLFHSM_KEYID(WOLFHSM_KEYTYPE_SHE,
+        server->comm->client_id, packet->sheVerifyMacReq.keyId);
     /* in and mac are after the fixed sized fields */
     message = (uint8_t*)(&packet->sheVerifyMacReq + 1);
     mac = message + packet->sheVerifyMacReq.messageLen;
+    if (macLen == 0 || macLen > AES_BLOCK_SIZE)
+        return WH_ERROR_BADARGS;
     /* load the key */
     keySz = WOLFHSM_SHE_KEY_SZ;
-    ret = hsmReadKey(server, MAKE_WOLFHSM_KEYID(WOLFHSM_KEYTYPE_SHE,
-        server->comm->client_id, packet->sheVerifyMacReq.keyId), NULL, tmpKey,
-        &keySz);
+    ret = hsmReadKey(server, keyId, NULL, tmpKey, &keySz);
     /* verify the mac */
     if (ret == 0) {
-        ret = wc_AesCmacVerify_ex(sheCmac, mac, packet->sheVerifyMacReq.macLen,
-            message, packet->sheVerifyMacReq.messageLen, tmpKey, keySz, NULL,
-            server->crypto->devId);
-        /* only evaluate if key was found */
+        ret = hsmSheCmacInit(server, keyId, tmpKey, keySz);
+        if (ret == 0) {
+            ret = wc_CmacUpdate(sheCmac, message,
+                packet->sheVerifyMacReq.messageLen);
+        }
         if (ret == 0)
-            packet->sheVerifyMacRes.status = 0;
-        else
-            packet->sheVerifyMacRes.status = 1;
-        *size = WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->sheVerifyMacRes);
+            ret = wc_CmacFinal(sheCmac, digest, &field);
+        /* constant time compare of the truncated mac */
+        if (ret == 0) {
+            for (i = 0; i < (int)macLen; i++)
+                diff |= digest[i] ^ mac[i];
+            packet->sheVerifyMacRes.status = (diff == 0) ? 0 : 1;
+            *size = WOLFHSM_PACKET_STUB_SIZE +
+                sizeof(packet->sheVerifyMacRes);
+        }
     }
     else
         ret = WH_SHE_ERC_KEY_NOT_AVAILABLE;
+    memset(tmpKey, 0, sizeof(tmpKey));
+    memset(digest, 0, sizeof(digest));
+    return ret;
+}
+
+/* run whole blocks through the open stream, wolfCrypt carries the CBC chain
+ * in the aes between calls */
+static int hsmSheCipherStreamRun(whServerContext* server, uint8_t* out,
+    const uint8_t* in, uint32_t sz)
+{
+    int ret;
+    if (server->she->cipherMode == WOLFHSM_SHE_CIPHER_ECB) {
+        if (server->she->cipherEnc != 0)
+            ret = wc_AesEcbEncrypt(sheCipherAes, out, in, sz);
+        else
+            ret = wc_AesEcbDecrypt(sheCipherAes, out, in, sz);
+    }
+    else {
+        if (server->she->cipherEnc != 0)
+            ret = wc_AesCbcEncrypt(sheCipherAes, out, in, sz);
+        else
+            ret = wc_AesCbcDecrypt(sheCipherAes, out, in, sz);
+    }
+    return ret;
+}
+
+void wh_Server_SheCipherFlush(whServerContext* server)
+{
+    if (server == NULL || server->she == NULL ||
+        server->she->cipherMode == 0) {
+        return;
+    }
+    /* free aes for protection */
+    wc_AesFree(sheCipherAes);
+    server->she->cipherMode = 0;
+    server->she->cipherEnc = 0;
+    server->she->cipherComm = NULL;
+}
+
+static int hsmSheCipherStream(whServerContext* server, whPacket* packet,
+    uint16_t* size)
+{
+    int ret = 0;
+    int rc;
+    uint32_t op;
+    uint32_t sz;
+    uint32_t keySz;
+    uint64_t inAddr;
+    uint64_t outAddr;
+    uint8_t mode;
+    uint8_t* in;
+    uint8_t* out;
+    void* dmaIn = NULL;
+    void* dmaOut = NULL;
+    whServerDmaFlags flags = {0};
+    uint8_t tmpKey[WOLFHSM_SHE_KEY_SZ];
+    /* the response overlays the request, read the fixed fields first */
+    op = packet->sheCipherStreamReq.op;
+    sz = packet->sheCipherStreamReq.sz;
+    inAddr = packet->sheCipherStreamReq.in;
+    outAddr = packet->sheCipherStreamReq.out;
+    mode = packet->sheCipherStreamReq.mode;
+    /* in and out are after the fixed sized fields */
+    in = (uint8_t*)(&packet->sheCipherStreamReq + 1);
+    out = (uint8_t*)(&packet->sheCipherStreamRes + 1);
+    /* another client's stream stays open until that client finalizes it */
+    if (server->she->cipherMode != 0 &&
+        server->she->cipherComm != server->comm) {
+        return WH_SHE_ERC_BUSY;
+    }
+    switch (op)
+    {
+    case WH_SHE_CIPHER_STREAM_INIT:
+        /* a new init replaces the client's previous stream */
+        wh_Server_SheCipherFlush(server);
+        if (mode != WOLFHSM_SHE_CIPHER_ECB && mode != WOLFHSM_SHE_CIPHER_CBC)
+            return WH_ERROR_BADARGS;
+        keySz = WOLFHSM_SHE_KEY_SZ;
+        ret = hsmReadKey(server, MAKE_WOLFHSM_KEYID(WOLFHSM_KEYTYPE_SHE,
+            server->comm->client_id, packet->sheCipherStreamReq.keyId), NULL,
+            tmpKey, &keySz);
+        if (ret == 0)
+            ret = wc_AesInit(sheCipherAes, NULL,
+                wh_Server_CryptoDevId(server, WH_SERVER_ENGINE_CAP_AES));
+        else
+            ret = WH_SHE_ERC_KEY_NOT_AVAILABLE;
+        if (ret == 0) {
+            ret = wc_AesSetKey(sheCipherAes, tmpKey, keySz,
+                mode == WOLFHSM_SHE_CIPHER_CBC ?
+                packet->sheCipherStreamReq.iv : NULL,
+                packet->sheCipherStreamReq.enc != 0 ?
+                AES_ENCRYPTION : AES_DECRYPTION);
+            if (ret != 0)
+                wc_AesFree(sheCipherAes);
+        }
+        memset(tmpKey, 0, sizeof(tmpKey));
+        if (ret == 0) {
+            server->she->cipherMode = mode;
+            server->she->cipherEnc =
+                packet->sheCipherStreamReq.enc != 0 ? 1 : 0;
+            server->she->cipherComm = server->comm;
+        }
+        sz = 0;
+        break;
+    case WH_SHE_CIPHER_STREAM_UPDATE:
+    case WH_SHE_CIPHER_STREAM_UPDATE_DMA:
+        if (server->she->cipherMode == 0)
+            return WH_SHE_ERC_SEQUENCE_ERROR;
+        /* only whole blocks, so the chain never splits one */
+        if ((sz % AES_BLOCK_SIZE) != 0 ||
+            (op == WH_SHE_CIPHER_STREAM_UPDATE &&
+            sz > WOLFHSM_PACKET_SHE_CIPHER_STREAM_MAX_SZ)) {
+            ret = WH_ERROR_BADARGS;
+        }
+        else if (op == WH_SHE_CIPHER_STREAM_UPDATE)
+            ret = hsmSheCipherStreamRun(server, out, in, sz);
+        else {
+            ret = wh_Server_DmaProcessClientAddress(server, inAddr, &dmaIn,
+                sz, WH_DMA_OPER_CLIENT_READ_PRE, flags);
+            if (ret == 0) {
+                ret = wh_Server_DmaProcessClientAddress(server, outAddr,
+                    &dmaOut, sz, WH_DMA_OPER_CLIENT_WRITE_PRE, flags);
+                if (ret == 0) {
+                    ret = hsmSheCipherStreamRun(server, (uint8_t*)dmaOut,
+                        (const uint8_t*)dmaIn, sz);
+                    rc = wh_Server_DmaProcessClientAddress(server, outAddr,
+                        &dmaOut, sz, WH_DMA_OPER_CLIENT_WRITE_POST, flags);
+                    if (ret == 0)
+                        ret = rc;
+                }
+                rc = wh_Server_DmaProcessClientAddress(server, inAddr, &dmaIn,
+                    sz, WH_DMA_OPER_CLIENT_READ_POST, flags);
+                if (ret == 0)
+                    ret = rc;
+            }
+        }
+        /* the chain is unknown after a failed update, close the stream */
+        if (ret != 0)
+            wh_Server_SheCipherFlush(server);
+        break;
+    case WH_SHE_CIPHER_STREAM_FINAL:
+        if (server->she->cipherMode == 0)
+            return WH_SHE_ERC_SEQUENCE_ERROR;
+        wh_Server_SheCipherFlush(server);
+        sz = 0;
+        break;
+    default:
+        ret = WH_ERROR_BADARGS;
+        break;
+    }
+    if (ret == 0) {
+        packet->sheCipherStreamRes.sz = sz;
+        *size = WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->sheCipherStreamRes);
+        /* dma updates wrote their output straight to client memory */
+        if (op == WH_SHE_CIPHER_STREAM_UPDATE)
+            *size += sz;
+    }
     return ret;
 }
 
@@ -1075,6 +1623,7 @@ int wh_Server_HandleSheRequest(whServerContext* server,
         (action != WH_SHE_SECURE_BOOT_INIT &&
         action != WH_SHE_SECURE_BOOT_UPDATE &&
         action != WH_SHE_SECURE_BOOT_FINISH &&
+        action != WH_SHE_SECURE_BOOT_DMA &&
         action != WH_SHE_GET_STATUS &&
         action != WH_SHE_SET_UID)) ||
         (action != WH_SHE_SET_UID && server->she->uidSet == 0)) {
@@ -1097,12 +1646,18 @@ int wh_Server_HandleSheRequest(whServerContext* server,
     case WH_SHE_SECURE_BOOT_FINISH:
         ret = hsmSheSecureBootFinish(server, packet, size);
         break;
+    case WH_SHE_SECURE_BOOT_DMA:
+        ret = hsmSheSecureBootDma(server, packet, size);
+        break;
     case WH_SHE_GET_STATUS:
         ret = hsmSheGetStatus(server, packet, size);
         break;
     case WH_SHE_LOAD_KEY:
         ret = hsmSheLoadKey(server, packet, size);
         break;
+    case WH_SHE_LOAD_KEY_BATCH:
+        ret = hsmSheLoadKeyBatch(server, packet, size);
+        break;
     case WH_SHE_LOAD_PLAIN_KEY:
         ret = hsmSheLoadPlainKey(server, packet, size);
         break;
@@ -1115,6 +1670,12 @@ int wh_Server_HandleSheRequest(whServerContext* server,
     case WH_SHE_RND:
         ret = hsmSheRnd(server, packet, size);
         break;
+    case WH_SHE_RND_BULK:
+        ret = hsmSheRndBulk(server, packet, size);
+        break;
+    case WH_SHE_RND_DMA:
+        ret = hsmSheRndDma(server, packet, size);
+        break;
     case WH_SHE_EXTEND_SEED:
         ret = hsmSheExtendSeed(server, packet, size);
         break;
@@ -1136,6 +1697,9 @@ int wh_Server_HandleSheRequest(whServerContext* server,
     case WH_SHE_VERIFY_MAC:
         ret = hsmSheVerifyMac(server, packet, size);
         break;
+    case WH_SHE_CIPHER_STREAM:
+        ret = hsmSheCipherStream(server, packet, size);
+        break;
     default:
         ret = WH_ERROR_BADARGS;
         break;
@@ -1157,7 +1721,8 @@ int wh_Server_HandleSheRequest(whServerContext* server,
     /* TODO is it safe to call wc_InitCmac over and over or do we need to call final first? */
     if ((action == WH_SHE_SECURE_BOOT_INIT ||
         action == WH_SHE_SECURE_BOOT_UPDATE ||
-        action == WH_SHE_SECURE_BOOT_FINISH) && ret != 0 &&
+        action == WH_SHE_SECURE_BOOT_FINISH ||
+        action == WH_SHE_SECURE_BOOT_DMA) && ret != 0 &&
         ret != WH_SHE_ERC_NO_SECURE_BOOT) {
         server->she->sbState = WOLFHSM_SHE_SB_INIT;
         server->she->blSize = 0;
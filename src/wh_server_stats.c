@@ -0,0 +1,230 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * src/wh_server_stats.c
+ *
+ * Per message kind request statistics
+ */
+
+/* System libraries */
+#include <stdint.h>
+#include <stddef.h>  /* For NULL */
+#include <string.h>  /* For memset, memcpy */
+
+#include "wolfhsm/wh_error.h"
+#include "wolfhsm/wh_comm.h"
+#include "wolfhsm/wh_message.h"
+#include "wolfhsm/wh_message_comm.h"
+#include "wolfhsm/wh_server.h"
+#include "wolfhsm/wh_server_stats.h"
+
+#ifdef WOLFHSM_SERVER_STATS
+
+/** Local declarations */
+static whServerStatsEntry* _Stats_Find(whServerContext* server,
+        uint16_t kind);
+static const whServerStatsEntry* _Stats_Index(const whServerContext* server,
+        uint16_t index, uint16_t* out_total);
+
+
+/** Local implementations */
+static whServerStatsEntry* _Stats_Find(whServerContext* server,
+        uint16_t kind)
+{
+    uint16_t slot = (uint16_t)((WH_MESSAGE_GROUP_INDEX(kind) * 31u +
+            WH_MESSAGE_ACTION(kind)) % WOLFHSM_SERVER_STATS_COUNT);
+    int i = 0;
+
+    if (kind != WH_MESSAGE_KIND_NONE) {
+        /* Linear probe.  Entries are only freed all at once */
+        for (i = 0; i < WOLFHSM_SERVER_STATS_COUNT; i++) {
+            whServerStatsEntry* e = &server->stats[slot];
+            if (e->kind == kind) {
+                return e;
+            }
+            if (e->kind == WH_MESSAGE_KIND_NONE) {
+                e->kind = kind;
+                return e;
+            }
+            slot = (slot + 1) % WOLFHSM_SERVER_STATS_COUNT;
+        }
+    }
+    return &server->stats_other;
+}
+
+static const whServerStatsEntry* _Stats_Index(const whServerContext* server,
+        uint16_t index, uint16_t* out_total)
+{
+    const whServerStatsEntry* found = NULL;
+    uint16_t total = 0;
+    int i = 0;
+
+    for (i = 0; i < WOLFHSM_SERVER_STATS_COUNT; i++) {
+        if (server->stats[i].kind != WH_MESSAGE_KIND_NONE) {
+            if (total == index) {
+                found = &server->stats[i];
+            }
+            total++;
+        }
+    }
+    if (server->stats_other.count != 0) {
+        if (total == index) {
+            found = &server->stats_other;
+        }
+        total++;
+    }
+    if (out_total != NULL) {
+        *out_total = total;
+    }
+    return found;
+}
+
+
+/** Public functions */
+uint64_t wh_Server_StatsTime(whServerContext* server)
+{
+    if ((server == NULL) || (server->time_cb == NULL)) {
+        return 0;
+    }
+    return server->time_cb(server->time_context);
+}
+
+void wh_Server_StatsRecord(whServerContext* server, uint16_t kind,
+        uint16_t req_size, uint16_t resp_size, uint64_t elapsed)
+{
+    whServerStatsEntry* e = NULL;
+    uint32_t t = 0;
+    uint64_t limit = 4;
+    int bin = 0;
+
+    if (server == NULL) {
+        return;
+    }
+
+    e = _Stats_Find(server, kind);
+    t = (elapsed > UINT32_MAX) ? UINT32_MAX : (uint32_t)elapsed;
+
+    if ((e->count == 0) || (t < e->time_min)) {
+        e->time_min = t;
+    }
+    if (t > e->time_max) {
+        e->time_max = t;
+    }
+    e->count++;
+    e->bytes_in += req_size;
+    e->bytes_out += resp_size;
+    e->time_total += elapsed;
+
+    /* Bins grow by powers of 4 */
+    while ((bin < WH_MESSAGE_COMM_STATS_HIST_BINS - 1) && (elapsed >= limit)) {
+        limit *= 4;
+        bin++;
+    }
+    e->hist[bin]++;
+}
+
+int wh_Server_StatsGet(whServerContext* server, uint16_t index,
+        whServerStatsEntry* out_entry)
+{
+    const whServerStatsEntry* e = NULL;
+
+    if (server == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    e = _Stats_Index(server, index, NULL);
+    if (e == NULL) {
+        return WH_ERROR_NOTFOUND;
+    }
+    if (out_entry != NULL) {
+        memcpy(out_entry, e, sizeof(*out_entry));
+    }
+    return WH_ERROR_OK;
+}
+
+int wh_Server_StatsReset(whServerContext* server)
+{
+    if (server == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    memset(server->stats, 0, sizeof(server->stats));
+    memset(&server->stats_other, 0, sizeof(server->stats_other));
+    return WH_ERROR_OK;
+}
+
+int wh_Server_HandleStatsRequest(whServerContext* server,
+        uint16_t magic, uint16_t req_size, const void* req_packet,
+        uint16_t *out_resp_size, void* resp_packet)
+{
+    whMessageCommStatsRequest req = {0};
+    whMessageCommStatsResponse resp = {0};
+    whMessageCommStatsEntry* out = NULL;
+    uint16_t total = 0;
+
+    if (    (server == NULL) ||
+            (req_packet == NULL) ||
+            (out_resp_size == NULL) ||
+            (resp_packet == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    if (req_size < sizeof(req)) {
+        /* Request is malformed */
+        *out_resp_size = 0;
+        return WH_ERROR_OK;
+    }
+    (void)wh_MessageComm_TranslateStatsRequest(magic,
+            (const whMessageCommStatsRequest*)req_packet, &req);
+
+    /* Entries are packed after the response header */
+    out = (whMessageCommStatsEntry*)((uint8_t*)resp_packet + sizeof(resp));
+    (void)_Stats_Index(server, 0, &total);
+    while (     (resp.count < WH_MESSAGE_COMM_STATS_MAX_ENTRIES) &&
+                (req.start + resp.count < total)) {
+        const whServerStatsEntry* e = _Stats_Index(server,
+                req.start + resp.count, NULL);
+        whMessageCommStatsEntry entry = {0};
+
+        entry.count = e->count;
+        entry.bytes_in = e->bytes_in;
+        entry.bytes_out = e->bytes_out;
+        entry.time_min = e->time_min;
+        entry.time_max = e->time_max;
+        entry.time_mean = (e->count != 0) ?
+                (uint32_t)(e->time_total / e->count) : 0;
+        memcpy(entry.hist, e->hist, sizeof(entry.hist));
+        entry.kind = e->kind;
+        (void)wh_MessageComm_TranslateStatsEntry(magic, &entry,
+                &out[resp.count]);
+        resp.count++;
+    }
+    resp.total = total;
+
+    if (req.reset != 0) {
+        (void)wh_Server_StatsReset(server);
+    }
+
+    (void)wh_MessageComm_TranslateStatsResponse(magic, &resp,
+            (whMessageCommStatsResponse*)resp_packet);
+    *out_resp_size = sizeof(resp) + resp.count * sizeof(*out);
+    return WH_ERROR_OK;
+}
+
+#endif /* WOLFHSM_SERVER_STATS */
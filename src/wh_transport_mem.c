@@ -30,6 +30,47 @@
 #include "wolfhsm/wh_comm.h"
 #include "wolfhsm/wh_transport_mem.h"
 
+/* Publish own CSR, then ring the peer if it announced a wait */
+static void _Publish(whTransportMemContext* context,
+        volatile whTransportMemCsr* own, volatile whTransportMemCsr* peer,
+        whTransportMemCsr csr)
+{
+    whTransportMemCsr peer_csr;
+
+    own->u64 = csr.u64;
+
+    if (context->notify_cb != NULL) {
+        /* Read after the write so a racing waiter sees one or the other */
+        peer_csr.u64 = peer->u64;
+        if (peer_csr.s.wait != csr.s.ack) {
+            csr.s.ack = peer_csr.s.wait;
+            own->u64 = csr.u64;
+            (void)context->notify_cb(context->notify_arg, own);
+        }
+    }
+}
+
+/* Announce a wait on own CSR and block until the peer moves from seen */
+static void _Wait(whTransportMemContext* context,
+        volatile whTransportMemCsr* own, volatile whTransportMemCsr* peer,
+        whTransportMemCsr seen)
+{
+    whTransportMemCsr csr;
+
+    if (context->wait_cb == NULL) {
+        return;
+    }
+
+    csr.u64 = own->u64;
+    csr.s.wait++;
+    own->u64 = csr.u64;
+
+    /* Skip the sleep if the peer published while announcing */
+    if (peer->s.notify == seen.s.notify) {
+        (void)context->wait_cb(context->notify_arg, peer, seen);
+    }
+}
+
 int wh_TransportMem_Init(void* c, const void* cf,
         whCommSetConnectedCb connectcb, void* connectcb_arg)
 {
@@ -47,6 +88,12 @@ int wh_TransportMem_Init(void* c, const void* cf,
         return WH_ERROR_BADARGS;
     }
 
+    /* In-place packets must fit in the request buffer */
+    if (    (config->in_place != 0) &&
+            (config->req_size < sizeof(whTransportMemCsr) + WH_COMM_MTU)) {
+        return WH_ERROR_BADARGS;
+    }
+
     memset(context, 0, sizeof(*context));
     context->req        = (whTransportMemCsr*)config->req;
     context->req_size   = config->req_size;
@@ -54,7 +101,16 @@ int wh_TransportMem_Init(void* c, const void* cf,
 
     context->resp       = (whTransportMemCsr*)config->resp;
     context->resp_size  = config->resp_size;
-    context->resp_data  = (void*)(context->resp + 1);
+
+    context->notify_cb  = config->notify_cb;
+    context->wait_cb    = config->wait_cb;
+    context->notify_arg = config->notify_arg;
+    if (config->in_place != 0) {
+        /* Responses overwrite the request data */
+        context->resp_data  = context->req_data;
+    } else {
+        context->resp_data  = (void*)(context->resp + 1);
+    }
 
     context->initialized = 1;
     return WH_ERROR_OK;
@@ -86,14 +142,51 @@ int wh_TransportMem_Cleanup(void* c)
     return 0;
 }
 
+uint8_t* wh_TransportMem_GetBuffer(void* c)
+{
+    whTransportMemContext* context = c;
+
+    /* Shared packet buffer is only exposed in-place */
+    if (    (context == NULL) ||
+            (context->initialized == 0) ||
+            (context->resp_data != context->req_data)) {
+        return NULL;
+    }
+    return (uint8_t*)context->req_data;
+}
+
 int wh_TransportMem_SendRequest(void* c, uint16_t len, const void* data)
+{
+    whCommIov iov[1];
+
+    iov->data = data;
+    iov->len = len;
+    return wh_TransportMem_SendRequestV(c, 1, iov);
+}
+
+int wh_TransportMem_SendRequestV(void* c, uint16_t iov_count,
+        const whCommIov* iov)
 {
     whTransportMemContext* context = c;
     whTransportMemCsr resp;
     whTransportMemCsr req;
+    uint8_t* dest;
+    size_t len = 0;
+    int i;
 
     if (    (context == NULL) ||
-            (context->initialized == 0)) {
+            (context->initialized == 0) ||
+            ((iov_count > 0) && (iov == NULL))) {
+        return WH_ERROR_BADARGS;
+    }
+
+    for (i = 0; i < iov_count; i++) {
+        if ((iov[i].data == NULL) && (iov[i].len != 0)) {
+            return WH_ERROR_BADARGS;
+        }
+        len += iov[i].len;
+    }
+    if (len > context->req_size - sizeof(whTransportMemCsr)) {
         return WH_ERROR_BADARGS;
     }
 
@@ -106,14 +199,21 @@ int wh_TransportMem_SendRequest(void* c, uint16_t len, const void* data)
         return WH_ERROR_NOTREADY;
     }
 
-    if ((data != NULL) && (len != 0)) {
-        memcpy((void*)context->req_data, data, len);
+    /* Gather each fragment directly into the shared buffer */
+    dest = (uint8_t*)context->req_data;
+    for (i = 0; i < iov_count; i++) {
+        if (    (iov[i].data != NULL) &&
+                (iov[i].len != 0) &&
+                (iov[i].data != dest)) {
+            memcpy(dest, iov[i].data, iov[i].len);
+        }
+        dest += iov[i].len;
     }
-    req.s.len = len;
+    req.s.len = (uint16_t)len;
     req.s.notify++;
 
     /* Write the new CSR's */
-    context->req->u64 = req.u64;
+    _Publish(context, context->req, context->resp, req);
 
     return 0;
 }
@@ -135,10 +235,16 @@ int wh_TransportMem_RecvRequest(void* c, uint16_t *out_len, void* data)
 
     /* Check to see if a new request has arrived */
     if(req.s.notify == resp.s.notify) {
-        return WH_ERROR_NOTREADY;
+        _Wait(context, context->resp, context->req, req);
+        req.u64 = context->req->u64;
+        if(req.s.notify == resp.s.notify) {
+            return WH_ERROR_NOTREADY;
+        }
     }
 
-    if ((data != NULL) && (req.s.len != 0)) {
+    if (    (data != NULL) &&
+            (req.s.len != 0) &&
+            (data != context->req_data)) {
         memcpy(data, context->req_data, req.s.len);
     }
     if (out_len != NULL) {
@@ -163,14 +269,16 @@ int wh_TransportMem_SendResponse(void* c, uint16_t len, const void* data)
     req.u64 = context->req->u64;
     resp.u64 = context->resp->u64;
 
-    if ((data != NULL) && (len != 0)) {
+    if (    (data != NULL) &&
+            (len != 0) &&
+            (data != context->resp_data)) {
         memcpy(context->resp_data, data, len);
     }
     resp.s.len = len;
     resp.s.notify = req.s.notify;
 
     /* Write the new CSR's */
-    context->resp->u64 = resp.u64;
+    _Publish(context, context->resp, context->req, resp);
 
     return 0;
 }
@@ -192,10 +300,16 @@ int wh_TransportMem_RecvResponse(void* c, uint16_t *out_len, void* data)
 
     /* Check to see if the current response is the different than the request */
     if(resp.s.notify != req.s.notify) {
-        return WH_ERROR_NOTREADY;
+        _Wait(context, context->req, context->resp, resp);
+        resp.u64 = context->resp->u64;
+        if(resp.s.notify != req.s.notify) {
+            return WH_ERROR_NOTREADY;
+        }
     }
 
-    if ((data != NULL) && (resp.s.len != 0)) {
+    if (    (data != NULL) &&
+            (resp.s.len != 0) &&
+            (data != context->resp_data)) {
         memcpy(data, context->resp_data, resp.s.len);
     }
 
@@ -0,0 +1,309 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * src/wh_transport_memring.c
+ *
+ * Implementation of transport callbacks using 2 memory blocks split into
+ * rings of fixed-size slots
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "wolfhsm/wh_error.h"
+#include "wolfhsm/wh_comm.h"
+#include "wolfhsm/wh_transport_mem.h"
+#include "wolfhsm/wh_transport_memring.h"
+
+/* Slot index for a 16-bit ring counter. slot_count is a power of 2 */
+#define WH_MEMRING_INDEX(_ctx, _count) \
+    ((uint16_t)((_count) & ((_ctx)->slot_count - 1)))
+
+static volatile whTransportMemCsr* _GetSlot(uint8_t* slots,
+        uint16_t slot_size, uint16_t index)
+{
+    return (volatile whTransportMemCsr*)(slots + (uint32_t)index * slot_size);
+}
+
+int wh_TransportMemRing_Init(void* c, const void* cf,
+        whCommSetConnectedCb connectcb, void* connectcb_arg)
+{
+    (void)connectcb; (void)connectcb_arg; /* Not used */
+
+    whTransportMemRingContext* context = c;
+    const whTransportMemRingConfig* config = cf;
+    uint16_t min_size = 0;
+    uint16_t slot_size = 0;
+
+    if (    (context == NULL) ||
+            (config == NULL) ||
+            (config->req == NULL) ||
+            (config->resp == NULL) ||
+            (config->slot_count == 0) ||
+            ((config->slot_count & (config->slot_count - 1)) != 0)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    /* Each slot must hold its CSR plus at least one unit of data */
+    min_size = (config->req_size < config->resp_size) ?
+            config->req_size : config->resp_size;
+    if (min_size < sizeof(whTransportMemCsr)) {
+        return WH_ERROR_BADARGS;
+    }
+    slot_size = (min_size - sizeof(whTransportMemCsr)) / config->slot_count;
+    slot_size -= slot_size % sizeof(whTransportMemCsr);
+    if (slot_size <= sizeof(whTransportMemCsr)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    memset(context, 0, sizeof(*context));
+    context->req        = (whTransportMemCsr*)config->req;
+    context->req_slots  = (uint8_t*)(context->req + 1);
+
+    context->resp       = (whTransportMemCsr*)config->resp;
+    context->resp_slots = (uint8_t*)(context->resp + 1);
+
+    context->slot_count = config->slot_count;
+    context->slot_size  = slot_size;
+
+    /* Resume after any responses already in the ring */
+    context->resp_tail  = context->resp->s.notify;
+
+    context->initialized = 1;
+    return WH_ERROR_OK;
+}
+
+int wh_TransportMemRing_InitClear(void* c, const void* cf,
+        whCommSetConnectedCb connectcb, void* connectcb_arg)
+{
+    whTransportMemRingContext* context = c;
+    const whTransportMemRingConfig* config = cf;
+
+    int rc = wh_TransportMemRing_Init(c, cf, connectcb, connectcb_arg);
+    if (rc == WH_ERROR_OK) {
+        /* Zero the buffers */
+        memset((void*)context->req, 0, config->req_size);
+        memset((void*)context->resp, 0, config->resp_size);
+        context->resp_tail = 0;
+    }
+    return rc;
+}
+
+int wh_TransportMemRing_Cleanup(void* c)
+{
+    whTransportMemRingContext* context = c;
+    if (context == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    context->initialized = 0;
+
+    return 0;
+}
+
+int wh_TransportMemRing_SendRequest(void* c, uint16_t len, const void* data)
+{
+    whCommIov iov[1];
+
+    iov->data = data;
+    iov->len = len;
+    return wh_TransportMemRing_SendRequestV(c, 1, iov);
+}
+
+int wh_TransportMemRing_SendRequestV(void* c, uint16_t iov_count,
+        const whCommIov* iov)
+{
+    whTransportMemRingContext* context = c;
+    volatile whTransportMemCsr* slot;
+    whTransportMemCsr slot_csr;
+    whTransportMemCsr req;
+    uint8_t* dest;
+    size_t len = 0;
+    int i;
+
+    if (    (context == NULL) ||
+            (context->initialized == 0) ||
+            ((iov_count > 0) && (iov == NULL))) {
+        return WH_ERROR_BADARGS;
+    }
+
+    for (i = 0; i < iov_count; i++) {
+        if ((iov[i].data == NULL) && (iov[i].len != 0)) {
+            return WH_ERROR_BADARGS;
+        }
+        len += iov[i].len;
+    }
+    if (len > context->slot_size - sizeof(whTransportMemCsr)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    /* Read current request head */
+    req.u64 = context->req->u64;
+
+    /* Every slot holds a request or an unread response */
+    if ((uint16_t)(req.s.notify - context->resp_tail) >= context->slot_count) {
+        return WH_ERROR_NOTREADY;
+    }
+
+    slot = _GetSlot(context->req_slots, context->slot_size,
+            WH_MEMRING_INDEX(context, req.s.notify));
+    dest = (uint8_t*)(slot + 1);
+    for (i = 0; i < iov_count; i++) {
+        if ((iov[i].data != NULL) && (iov[i].len != 0)) {
+            memcpy(dest, iov[i].data, iov[i].len);
+        }
+        dest += iov[i].len;
+    }
+    slot_csr.u64 = 0;
+    slot_csr.s.notify = req.s.notify;
+    slot_csr.s.len = (uint16_t)len;
+    slot->u64 = slot_csr.u64;
+
+    /* Publish the slot */
+    req.s.notify++;
+    context->req->u64 = req.u64;
+
+    return 0;
+}
+
+int wh_TransportMemRing_RecvRequest(void* c, uint16_t *out_len, void* data)
+{
+    whTransportMemRingContext* context = c;
+    volatile whTransportMemCsr* slot;
+    whTransportMemCsr slot_csr;
+    whTransportMemCsr req;
+    whTransportMemCsr resp;
+
+    if (    (context == NULL) ||
+            (context->initialized == 0)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    /* Read both heads */
+    req.u64 = context->req->u64;
+    resp.u64 = context->resp->u64;
+
+    /* Check to see if there is an unanswered request */
+    if (req.s.notify == resp.s.notify) {
+        return WH_ERROR_NOTREADY;
+    }
+
+    /* Oldest unanswered request */
+    slot = _GetSlot(context->req_slots, context->slot_size,
+            WH_MEMRING_INDEX(context, resp.s.notify));
+    slot_csr.u64 = slot->u64;
+
+    if (slot_csr.s.len > context->slot_size - sizeof(whTransportMemCsr)) {
+        return WH_ERROR_ABORTED;
+    }
+
+    if ((data != NULL) && (slot_csr.s.len != 0)) {
+        memcpy(data, (void*)(slot + 1), slot_csr.s.len);
+    }
+    if (out_len != NULL) {
+        *out_len = slot_csr.s.len;
+    }
+
+    return 0;
+}
+
+int wh_TransportMemRing_SendResponse(void* c, uint16_t len, const void* data)
+{
+    whTransportMemRingContext* context = c;
+    volatile whTransportMemCsr* slot;
+    whTransportMemCsr slot_csr;
+    whTransportMemCsr req;
+    whTransportMemCsr resp;
+
+    if (    (context == NULL) ||
+            (context->initialized == 0)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    if (len > context->slot_size - sizeof(whTransportMemCsr)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    /* Read both heads */
+    req.u64 = context->req->u64;
+    resp.u64 = context->resp->u64;
+
+    /* Nothing to respond to */
+    if (req.s.notify == resp.s.notify) {
+        return WH_ERROR_NOTREADY;
+    }
+
+    slot = _GetSlot(context->resp_slots, context->slot_size,
+            WH_MEMRING_INDEX(context, resp.s.notify));
+    if ((data != NULL) && (len != 0)) {
+        memcpy((void*)(slot + 1), data, len);
+    }
+    slot_csr.u64 = 0;
+    slot_csr.s.notify = resp.s.notify;
+    slot_csr.s.len = len;
+    slot->u64 = slot_csr.u64;
+
+    /* Publish the slot, which also frees the matching request slot */
+    resp.s.notify++;
+    context->resp->u64 = resp.u64;
+
+    return 0;
+}
+
+int wh_TransportMemRing_RecvResponse(void* c, uint16_t *out_len, void* data)
+{
+    whTransportMemRingContext* context = c;
+    volatile whTransportMemCsr* slot;
+    whTransportMemCsr slot_csr;
+    whTransportMemCsr resp;
+
+    if (    (context == NULL) ||
+            (context->initialized == 0)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    /* Read response head */
+    resp.u64 = context->resp->u64;
+
+    /* Check to see if there is an unread response */
+    if (resp.s.notify == context->resp_tail) {
+        return WH_ERROR_NOTREADY;
+    }
+
+    slot = _GetSlot(context->resp_slots, context->slot_size,
+            WH_MEMRING_INDEX(context, context->resp_tail));
+    slot_csr.u64 = slot->u64;
+
+    if (slot_csr.s.len > context->slot_size - sizeof(whTransportMemCsr)) {
+        return WH_ERROR_ABORTED;
+    }
+
+    if ((data != NULL) && (slot_csr.s.len != 0)) {
+        memcpy(data, (void*)(slot + 1), slot_csr.s.len);
+    }
+    if (out_len != NULL) {
+        *out_len = slot_csr.s.len;
+    }
+
+    /* Release the slot */
+    context->resp_tail++;
+
+    return 0;
+}
@@ -96,6 +96,7 @@ extern "C" {
 /** AES Options */
 #define HAVE_AES
 #define HAVE_AESGCM
+#define WOLFSSL_AESGCM_STREAM
 #define GCM_TABLE_4BIT
 #define WOLFSSL_AES_DIRECT
 #define HAVE_AES_ECB
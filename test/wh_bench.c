@@ -0,0 +1,678 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * test/wh_bench.c
+ *
+ * Latency benchmarks of client requests against a server thread.  Output is
+ * CSV on stdout, one header line then one line per transport and case with
+ * the iteration count, min, p50, p90, p99, max and mean latency in
+ * nanoseconds, and operations per second.
+ */
+
+#include <stdint.h>
+#include <stdio.h>  /* For printf */
+#include <stdlib.h> /* For qsort, atoi */
+#include <string.h> /* For memset, strcmp */
+
+#if defined(WH_CONFIG)
+#include "wh_config.h"
+#endif
+
+#include "wh_test_common.h"
+#include "wh_bench.h"
+
+#include "wolfhsm/wh_error.h"
+#include "wolfhsm/wh_comm.h"
+#include "wolfhsm/wh_transport_mem.h"
+#include "wolfhsm/wh_nvm.h"
+#include "wolfhsm/wh_nvm_flash.h"
+#include "wolfhsm/wh_flash_ramsim.h"
+#include "wolfhsm/wh_server.h"
+#include "wolfhsm/wh_message_comm.h"
+#include "wolfhsm/wh_client.h"
+
+#ifndef WOLFHSM_NO_CRYPTO
+#include "wolfssl/wolfcrypt/settings.h"
+#include "wolfssl/wolfcrypt/aes.h"
+#include "wolfssl/wolfcrypt/ecc.h"
+#include "wolfssl/wolfcrypt/rsa.h"
+#include "wolfssl/wolfcrypt/random.h"
+#endif
+
+#if defined(WH_CFG_TEST_POSIX)
+#include <pthread.h> /* For pthread_create/cancel/join/_t */
+#include <time.h>    /* For clock_gettime */
+
+#include "port/posix/posix_transport_tcp.h"
+
+#define BENCH_BUFFER_SIZE \
+    (2 * WH_COMM_MTU > 4096 ? 2 * WH_COMM_MTU : 4096)
+#define BENCH_FLASH_RAM_SIZE (1024 * 1024) /* 1MB */
+#define BENCH_TCP_PORT 23457
+
+/* Untimed operations before each case is measured */
+#define BENCH_WARMUP 16
+#define BENCH_MAX_ITERATIONS 100000
+/* Private key operations take milliseconds, so fewer are timed */
+#define BENCH_SLOW_ITERATIONS 20
+
+#define BENCH_NVM_ID 100
+#define BENCH_NVM_LEN 256
+#define BENCH_KEY_LEN 32
+#define BENCH_AES_LEN 256
+
+/* State shared by the cases of one client */
+typedef struct {
+    whClientContext* client;
+    uint8_t buffer[WH_COMM_DATA_LEN];
+    uint8_t out[WH_COMM_DATA_LEN];
+    uint16_t key_id;
+    uint8_t padding[6];
+#ifndef WOLFHSM_NO_CRYPTO
+    WC_RNG rng[1];
+#if !defined(NO_AES) && defined(HAVE_AES_CBC)
+    Aes aes[1];
+#endif
+#ifdef HAVE_ECC
+    ecc_key ecc[1];
+#endif
+#ifndef NO_RSA
+    RsaKey rsa[1];
+    word32 rsa_len;
+#endif
+#endif /* !WOLFHSM_NO_CRYPTO */
+} whBenchContext;
+
+typedef int (*whBenchFn)(whBenchContext* ctx);
+
+typedef struct {
+    const char* name;
+    whBenchFn setup;        /* Untimed, may be NULL */
+    whBenchFn op;           /* One timed operation */
+    whBenchFn cleanup;      /* Untimed, may be NULL */
+    int max_iterations;     /* 0 for no limit */
+    uint8_t padding[4];
+} whBenchCase;
+
+/* Server thread state */
+typedef struct {
+    whServerContext* server;
+    int rc;
+    uint8_t padding[4];
+} whBenchServer;
+
+static uint64_t _samples[BENCH_MAX_ITERATIONS];
+
+
+/** Cases */
+static int _benchEcho16(whBenchContext* ctx)
+{
+    uint16_t len = 0;
+    return wh_Client_Echo(ctx->client, 16, ctx->buffer, &len, ctx->out);
+}
+
+static int _benchEchoMax(whBenchContext* ctx)
+{
+    uint16_t len = 0;
+    return wh_Client_Echo(ctx->client,
+            sizeof(((whMessageCommLenData*)0)->data), ctx->buffer,
+            &len, ctx->out);
+}
+
+static int _benchNvmAdd(whBenchContext* ctx)
+{
+    int32_t server_rc = 0;
+    int rc = wh_Client_NvmAddObject(ctx->client, BENCH_NVM_ID,
+            WOLFHSM_NVM_ACCESS_ANY, WOLFHSM_NVM_FLAGS_NONE, 0, NULL,
+            BENCH_NVM_LEN, ctx->buffer, &server_rc);
+    return (rc != 0) ? rc : server_rc;
+}
+
+static int _benchNvmRead(whBenchContext* ctx)
+{
+    int32_t server_rc = 0;
+    whNvmSize len = 0;
+    int rc = wh_Client_NvmRead(ctx->client, BENCH_NVM_ID, 0, BENCH_NVM_LEN,
+            &server_rc, &len, ctx->out);
+    return (rc != 0) ? rc : server_rc;
+}
+
+static int _benchNvmDestroy(whBenchContext* ctx)
+{
+    int32_t server_rc = 0;
+    whNvmId id = BENCH_NVM_ID;
+    int rc = wh_Client_NvmDestroyObjects(ctx->client, 1, &id, 0, NULL,
+            &server_rc);
+    return (rc != 0) ? rc : server_rc;
+}
+
+static int _benchNvmAddDestroy(whBenchContext* ctx)
+{
+    int rc = _benchNvmAdd(ctx);
+    if (rc == 0) {
+        rc = _benchNvmDestroy(ctx);
+    }
+    return rc;
+}
+
+#ifndef WOLFHSM_NO_CRYPTO
+static int _benchKeyCache(whBenchContext* ctx)
+{
+    uint8_t label[] = "bench";
+
+    ctx->key_id = WOLFHSM_KEYID_ERASED;
+    return wh_Client_KeyCache(ctx->client, 0, label, sizeof(label),
+            ctx->buffer, BENCH_KEY_LEN, &ctx->key_id);
+}
+
+static int _benchKeyCacheCommit(whBenchContext* ctx)
+{
+    int rc = _benchKeyCache(ctx);
+    if (rc == 0) {
+        rc = wh_Client_KeyCommit(ctx->client, ctx->key_id);
+    }
+    return rc;
+}
+
+static int _benchKeyErase(whBenchContext* ctx)
+{
+    return wh_Client_KeyErase(ctx->client, ctx->key_id);
+}
+
+static int _benchKeyEvict(whBenchContext* ctx)
+{
+    return wh_Client_KeyEvict(ctx->client, ctx->key_id);
+}
+
+/* Export of a key held in the cache */
+static int _benchKeyHit(whBenchContext* ctx)
+{
+    uint32_t len = sizeof(ctx->out);
+    return wh_Client_KeyExport(ctx->client, ctx->key_id, NULL, 0, ctx->out,
+            &len);
+}
+
+/* Export of a committed key after evicting it, so it is read from NVM */
+static int _benchKeyMiss(whBenchContext* ctx)
+{
+    int rc = wh_Client_KeyEvict(ctx->client, ctx->key_id);
+    if (rc == 0) {
+        rc = _benchKeyHit(ctx);
+    }
+    return rc;
+}
+
+#if !defined(NO_AES) && defined(HAVE_AES_CBC)
+static int _benchAesSetup(whBenchContext* ctx)
+{
+    uint8_t iv[AES_BLOCK_SIZE] = {0};
+    int rc = wc_AesInit(ctx->aes, NULL, WOLFHSM_DEV_ID);
+
+#ifdef WOLFHSM_SYMMETRIC_INTERNAL
+    if (rc == 0) {
+        rc = _benchKeyCache(ctx);
+    }
+    if (rc == 0) {
+        wh_Client_SetKeyAes(ctx->aes, ctx->key_id);
+        rc = wc_AesSetIV(ctx->aes, iv);
+    }
+#else
+    if (rc == 0) {
+        rc = wc_AesSetKey(ctx->aes, ctx->buffer, AES_BLOCK_SIZE, iv,
+                AES_ENCRYPTION);
+    }
+#endif
+    return rc;
+}
+
+static int _benchAesCbc(whBenchContext* ctx)
+{
+    return wc_AesCbcEncrypt(ctx->aes, ctx->out, ctx->buffer, BENCH_AES_LEN);
+}
+
+static int _benchAesCleanup(whBenchContext* ctx)
+{
+    wc_AesFree(ctx->aes);
+#ifdef WOLFHSM_SYMMETRIC_INTERNAL
+    return _benchKeyEvict(ctx);
+#else
+    return 0;
+#endif
+}
+#endif /* !NO_AES && HAVE_AES_CBC */
+
+#ifdef HAVE_ECC
+static int _benchEccSetup(whBenchContext* ctx)
+{
+    int rc = wc_ecc_init_ex(ctx->ecc, NULL, WOLFHSM_DEV_ID);
+    if (rc == 0) {
+        rc = wc_ecc_make_key(ctx->rng, 32, ctx->ecc);
+    }
+    return rc;
+}
+
+static int _benchEccSign(whBenchContext* ctx)
+{
+    word32 len = sizeof(ctx->out);
+    return wc_ecc_sign_hash(ctx->buffer, 32, ctx->out, &len, ctx->rng,
+            ctx->ecc);
+}
+
+static int _benchEccCleanup(whBenchContext* ctx)
+{
+    /* The server holds the key in its cache */
+    memcpy(&ctx->key_id, &ctx->ecc->devCtx, sizeof(ctx->key_id));
+    (void)wc_ecc_free(ctx->ecc);
+    return _benchKeyEvict(ctx);
+}
+#endif /* HAVE_ECC */
+
+#ifndef NO_RSA
+static int _benchRsaSetup(whBenchContext* ctx)
+{
+    int rc = wc_InitRsaKey_ex(ctx->rsa, NULL, WOLFHSM_DEV_ID);
+    if (rc == 0) {
+        rc = wc_MakeRsaKey(ctx->rsa, 2048, 65537, ctx->rng);
+    }
+    if (rc == 0) {
+        rc = wc_RsaPublicEncrypt(ctx->buffer, 32, ctx->out, sizeof(ctx->out),
+                ctx->rsa, ctx->rng);
+        if (rc > 0) {
+            ctx->rsa_len = (word32)rc;
+            rc = 0;
+        }
+    }
+    return rc;
+}
+
+static int _benchRsaDecrypt(whBenchContext* ctx)
+{
+    int rc = wc_RsaPrivateDecrypt(ctx->out, ctx->rsa_len, ctx->buffer,
+            sizeof(ctx->buffer), ctx->rsa);
+    return (rc < 0) ? rc : 0;
+}
+
+static int _benchRsaCleanup(whBenchContext* ctx)
+{
+    memcpy(&ctx->key_id, &ctx->rsa->devCtx, sizeof(ctx->key_id));
+    (void)wc_FreeRsaKey(ctx->rsa);
+    return _benchKeyEvict(ctx);
+}
+#endif /* !NO_RSA */
+#endif /* !WOLFHSM_NO_CRYPTO */
+
+static const whBenchCase _cases[] = {
+    {"echo_16", NULL, _benchEcho16, NULL, 0, {0}},
+    {"echo_max", NULL, _benchEchoMax, NULL, 0, {0}},
+    {"nvm_add_256", NULL, _benchNvmAdd, _benchNvmDestroy, 0, {0}},
+    {"nvm_read_256", _benchNvmAdd, _benchNvmRead, _benchNvmDestroy, 0, {0}},
+    {"nvm_add_destroy_256", NULL, _benchNvmAddDestroy, NULL, 0, {0}},
+#ifndef WOLFHSM_NO_CRYPTO
+    {"key_export_hit", _benchKeyCache, _benchKeyHit, _benchKeyErase, 0, {0}},
+    {"key_evict_export_miss", _benchKeyCacheCommit, _benchKeyMiss,
+        _benchKeyErase, 0, {0}},
+#if !defined(NO_AES) && defined(HAVE_AES_CBC)
+    {"aes_cbc_256", _benchAesSetup, _benchAesCbc, _benchAesCleanup, 0, {0}},
+#endif
+#ifdef HAVE_ECC
+    {"ecc_p256_sign", _benchEccSetup, _benchEccSign, _benchEccCleanup,
+        BENCH_SLOW_ITERATIONS * 10, {0}},
+#endif
+#ifndef NO_RSA
+    {"rsa_2048_decrypt", _benchRsaSetup, _benchRsaDecrypt, _benchRsaCleanup,
+        BENCH_SLOW_ITERATIONS, {0}},
+#endif
+#endif /* !WOLFHSM_NO_CRYPTO */
+};
+
+
+/** Harness */
+static uint64_t _benchNow(void)
+{
+    struct timespec ts;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+static int _benchCompare(const void* a, const void* b)
+{
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+/* Nearest rank percentile of the first count sorted samples */
+static unsigned long _benchPercentile(int count, int percent)
+{
+    int rank = (count * percent + 99) / 100;
+    return (unsigned long)_samples[(rank > 0) ? rank - 1 : 0];
+}
+
+static int _benchRunCase(whBenchContext* ctx, const char* transport,
+        const whBenchCase* c, int iterations)
+{
+    uint64_t start = 0;
+    uint64_t total = 0;
+    int count = iterations;
+    int cleanup_rc = 0;
+    int rc = 0;
+    int i = 0;
+
+    if ((c->max_iterations > 0) && (count > c->max_iterations)) {
+        count = c->max_iterations;
+    }
+
+    if (c->setup != NULL) {
+        rc = c->setup(ctx);
+    }
+    for (i = 0; (rc == 0) && (i < BENCH_WARMUP); i++) {
+        rc = c->op(ctx);
+    }
+    for (i = 0; (rc == 0) && (i < count); i++) {
+        start = _benchNow();
+        rc = c->op(ctx);
+        _samples[i] = _benchNow() - start;
+        total += _samples[i];
+    }
+    if (c->cleanup != NULL) {
+        cleanup_rc = c->cleanup(ctx);
+    }
+    if (rc == 0) {
+        rc = cleanup_rc;
+    }
+    if (rc != 0) {
+        WH_ERROR_PRINT("%s,%s failed: %d\n", transport, c->name, rc);
+        return rc;
+    }
+
+    qsort(_samples, count, sizeof(_samples[0]), _benchCompare);
+    printf("%s,%s,%d,%lu,%lu,%lu,%lu,%lu,%lu,%lu\n", transport, c->name,
+            count, (unsigned long)_samples[0],
+            _benchPercentile(count, 50), _benchPercentile(count, 90),
+            _benchPercentile(count, 99), (unsigned long)_samples[count - 1],
+            (unsigned long)(total / count),
+            (unsigned long)((total > 0) ?
+                    (uint64_t)count * 1000000000 / total : 0));
+    return 0;
+}
+
+static int _benchClient(const char* transport, whClientConfig* c_conf,
+        int iterations)
+{
+    static whBenchContext ctx[1];
+    whClientContext client[1];
+    size_t i = 0;
+    int rc = 0;
+
+    memset(client, 0, sizeof(client));
+    memset(ctx, 0, sizeof(ctx));
+    for (i = 0; i < sizeof(ctx->buffer); i++) {
+        ctx->buffer[i] = (uint8_t)i;
+    }
+
+    rc = wh_Client_Init(client, c_conf);
+    if (rc != 0) {
+        return rc;
+    }
+    ctx->client = client;
+
+#ifndef WOLFHSM_NO_CRYPTO
+    rc = wc_InitRng_ex(ctx->rng, NULL, WOLFHSM_DEV_ID);
+#endif
+    for (i = 0; (rc == 0) && (i < sizeof(_cases) / sizeof(_cases[0])); i++) {
+        rc = _benchRunCase(ctx, transport, &_cases[i], iterations);
+    }
+#ifndef WOLFHSM_NO_CRYPTO
+    (void)wc_FreeRng(ctx->rng);
+#endif
+
+    /* Always close so the server thread finishes */
+    (void)wh_Client_CommClose(client);
+    (void)wh_Client_Cleanup(client);
+    return rc;
+}
+
+static void* _benchServerTask(void* arg)
+{
+    whBenchServer* s = (whBenchServer*)arg;
+    whCommConnected connected = WH_COMM_CONNECTED;
+    int rc = 0;
+
+    while (connected == WH_COMM_CONNECTED) {
+        rc = wh_Server_HandleRequestMessage(s->server);
+        if ((rc != WH_ERROR_OK) && (rc != WH_ERROR_NOTREADY)) {
+            break;
+        }
+        (void)wh_Server_GetConnected(s->server, &connected);
+    }
+    s->rc = (rc == WH_ERROR_NOTREADY) ? 0 : rc;
+    return NULL;
+}
+
+/* Run the cases against a server thread using cs_conf, with a RAM flash
+ * backed NVM like the client/server thread tests */
+static int _benchTransport(const char* transport, whClientConfig* c_conf,
+        whCommServerConfig* cs_conf, int iterations)
+{
+    whFlashRamsimCtx fc[1] = {0};
+    whFlashRamsimCfg fc_conf[1] = {{
+        .size       = BENCH_FLASH_RAM_SIZE,
+        .sectorSize = BENCH_FLASH_RAM_SIZE/2,
+        .pageSize   = 8,
+        .erasedByte = (uint8_t)0,
+    }};
+    const whFlashCb  fcb[1] = {WH_FLASH_RAMSIM_CB};
+    whNvmFlashConfig nf_conf[1] = {{
+        .cb      = fcb,
+        .context = fc,
+        .config  = fc_conf,
+    }};
+    whNvmFlashContext nfc[1] = {0};
+    whNvmCb nfcb[1] = {WH_NVM_FLASH_CB};
+    whNvmConfig n_conf[1] = {{
+            .cb = nfcb,
+            .context = nfc,
+            .config = nf_conf,
+    }};
+    whNvmContext nvm[1] = {{0}};
+#ifndef WOLFHSM_NO_CRYPTO
+    crypto_context crypto[1] = {{
+            .devId = INVALID_DEVID,
+    }};
+#endif
+    whServerConfig s_conf[1] = {{
+       .comm_config = cs_conf,
+       .nvm = nvm,
+#ifndef WOLFHSM_NO_CRYPTO
+       .crypto = crypto,
+#endif
+    }};
+    static whServerContext server[1];
+    whBenchServer s = {0};
+    pthread_t sthread;
+    int rc = 0;
+
+    memset(server, 0, sizeof(server));
+    s.server = server;
+
+    rc = wh_Nvm_Init(nvm, n_conf);
+#ifndef WOLFHSM_NO_CRYPTO
+    if (rc == 0) {
+        rc = wolfCrypt_Init();
+    }
+    if (rc == 0) {
+        rc = wc_InitRng_ex(crypto->rng, NULL, crypto->devId);
+    }
+#endif
+    /* Initialized here so the server listens before the client connects */
+    if (rc == 0) {
+        rc = wh_Server_Init(server, s_conf);
+    }
+    if (rc == 0) {
+        rc = wh_Server_SetConnected(server, WH_COMM_CONNECTED);
+    }
+    if (rc == 0) {
+        if (pthread_create(&sthread, NULL, _benchServerTask, &s) != 0) {
+            rc = WH_ERROR_ABORTED;
+        }
+        if (rc == 0) {
+            rc = _benchClient(transport, c_conf, iterations);
+            if (rc != 0) {
+                (void)pthread_cancel(sthread);
+            }
+            (void)pthread_join(sthread, NULL);
+            if (rc == 0) {
+                rc = s.rc;
+            }
+        }
+        (void)wh_Server_Cleanup(server);
+    }
+
+#ifndef WOLFHSM_NO_CRYPTO
+    (void)wc_FreeRng(crypto->rng);
+    (void)wolfCrypt_Cleanup();
+#endif
+    (void)wh_Nvm_Cleanup(nvm);
+    return rc;
+}
+
+static int _benchMem(int iterations)
+{
+    static uint8_t req[BENCH_BUFFER_SIZE];
+    static uint8_t resp[BENCH_BUFFER_SIZE];
+    whTransportMemConfig tmcf[1] = {{
+        .req       = (whTransportMemCsr*)req,
+        .req_size  = sizeof(req),
+        .resp      = (whTransportMemCsr*)resp,
+        .resp_size = sizeof(resp),
+    }};
+    whTransportClientCb         tccb[1]   = {WH_TRANSPORT_MEM_CLIENT_CB};
+    whTransportMemClientContext tmcc[1]   = {0};
+    whCommClientConfig          cc_conf[1] = {{
+                 .transport_cb      = tccb,
+                 .transport_context = (void*)tmcc,
+                 .transport_config  = (void*)tmcf,
+                 .client_id         = 123,
+    }};
+    whClientConfig c_conf[1] = {{
+       .comm = cc_conf,
+    }};
+    whTransportServerCb         tscb[1]   = {WH_TRANSPORT_MEM_SERVER_CB};
+    whTransportMemServerContext tmsc[1]   = {0};
+    whCommServerConfig          cs_conf[1] = {{
+                 .transport_cb      = tscb,
+                 .transport_context = (void*)tmsc,
+                 .transport_config  = (void*)tmcf,
+                 .server_id         = 124,
+    }};
+
+    memset(req, 0, sizeof(req));
+    memset(resp, 0, sizeof(resp));
+    return _benchTransport("mem", c_conf, cs_conf, iterations);
+}
+
+static int _benchTcp(int iterations)
+{
+    posixTransportTcpConfig mytcpconfig[1] = {{
+        .server_ip_string = "127.0.0.1",
+        .server_port      = BENCH_TCP_PORT,
+        .nodelay          = 1,
+    }};
+    whTransportClientCb            pttccb[1] = {PTT_CLIENT_CB};
+    static posixTransportTcpClientContext tcc[1];
+    whCommClientConfig             cc_conf[1] = {{
+                    .transport_cb      = pttccb,
+                    .transport_context = (void*)tcc,
+                    .transport_config  = (void*)mytcpconfig,
+                    .client_id         = 123,
+    }};
+    whClientConfig c_conf[1] = {{
+       .comm = cc_conf,
+    }};
+    whTransportServerCb            pttscb[1] = {PTT_SERVER_CB};
+    static posixTransportTcpServerContext tss[1];
+    whCommServerConfig             cs_conf[1] = {{
+                    .transport_cb      = pttscb,
+                    .transport_context = (void*)tss,
+                    .transport_config  = (void*)mytcpconfig,
+                    .server_id         = 124,
+    }};
+
+    memset(tcc, 0, sizeof(tcc));
+    memset(tss, 0, sizeof(tss));
+    return _benchTransport("tcp", c_conf, cs_conf, iterations);
+}
+
+int whBench_ClientServer(int transports, int iterations)
+{
+    int rc = 0;
+
+    if ((iterations < 1) || (iterations > BENCH_MAX_ITERATIONS)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    printf("transport,case,iterations,min_ns,p50_ns,p90_ns,p99_ns,max_ns,"
+            "mean_ns,ops_per_s\n");
+    if ((transports & WH_BENCH_TRANSPORT_MEM) != 0) {
+        rc = _benchMem(iterations);
+    }
+    if ((rc == 0) && ((transports & WH_BENCH_TRANSPORT_TCP) != 0)) {
+        rc = _benchTcp(iterations);
+    }
+    return rc;
+}
+
+#else /* WH_CFG_TEST_POSIX */
+
+int whBench_ClientServer(int transports, int iterations)
+{
+    (void)transports; (void)iterations;
+    return WH_ERROR_NOTIMPL;
+}
+
+#endif /* WH_CFG_TEST_POSIX */
+
+
+#if !defined(WH_CFG_BENCH_NO_MAIN)
+
+/* Usage: wh_bench [-n iterations] [-t mem|tcp|all] */
+int main(int argc, char** argv)
+{
+    int transports = WH_BENCH_TRANSPORT_ALL;
+    int iterations = 1000;
+    int i = 0;
+
+    for (i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "-n") == 0) {
+            iterations = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "-t") == 0) {
+            if (strcmp(argv[i + 1], "mem") == 0) {
+                transports = WH_BENCH_TRANSPORT_MEM;
+            } else if (strcmp(argv[i + 1], "tcp") == 0) {
+                transports = WH_BENCH_TRANSPORT_TCP;
+            } else {
+                transports = WH_BENCH_TRANSPORT_ALL;
+            }
+        }
+    }
+    return (whBench_ClientServer(transports, iterations) == 0) ? 0 : 1;
+}
+
+#endif /* !WH_CFG_BENCH_NO_MAIN */
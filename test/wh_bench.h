@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef WH_BENCH_H_
+#define WH_BENCH_H_
+
+/* Transports to benchmark, combined in the transports argument */
+#define WH_BENCH_TRANSPORT_MEM 0x01
+#define WH_BENCH_TRANSPORT_TCP 0x02
+#define WH_BENCH_TRANSPORT_ALL (WH_BENCH_TRANSPORT_MEM | WH_BENCH_TRANSPORT_TCP)
+
+/*
+ * Runs each benchmark case against a server thread over each selected
+ * transport.  A case is run untimed for a warm-up, then timed for iterations
+ * operations, or fewer for slow public key operations, and one CSV line of
+ * latency percentiles in nanoseconds is written to stdout per case.
+ *
+ * Requires WH_CFG_TEST_POSIX.  Returns 0 on success and a non-zero error code
+ * on failure
+ */
+int whBench_ClientServer(int transports, int iterations);
+
+#endif /* WH_BENCH_H_ */
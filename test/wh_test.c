@@ -27,6 +27,8 @@
 #include "wh_test_she.h"
 #include "wh_test_flash_ramsim.h"
 #include "wh_test_nvm_flash.h"
+#include "wh_test_nvm_flashlog.h"
+#include "wh_test_counter.h"
 #include "wh_test_clientserver.h"
 
 
@@ -45,6 +47,8 @@ int whTest_Unit(void)
 #endif
     WH_TEST_ASSERT(0 == whTest_Flash_RamSim());
     WH_TEST_ASSERT(0 == whTest_NvmFlash());
+    WH_TEST_ASSERT(0 == whTest_NvmFlashLog());
+    WH_TEST_ASSERT(0 == whTest_Counter());
     WH_TEST_ASSERT(0 == whTest_ClientServer());
 
     return 0;
@@ -33,24 +33,32 @@
 #include "wolfhsm/wh_nvm.h"
 #include "wolfhsm/wh_nvm_flash.h"
 #include "wolfhsm/wh_flash_ramsim.h"
+#include "wolfhsm/wh_counter.h"
 
 #include "wolfhsm/wh_server.h"
+#include "wolfhsm/wh_server_job.h"
 #include "wolfhsm/wh_message.h"
+#include "wolfhsm/wh_message_comm.h"
+#include "wolfhsm/wh_message_nvm.h"
 #include "wolfhsm/wh_client.h"
 
 #if defined(WH_CFG_TEST_POSIX)
 #include <pthread.h> /* For pthread_create/cancel/join/_t */
 #include <unistd.h>  /* For sleep */
+
+#include "port/posix/posix_server_pool.h"
 #endif
 
 
-#define BUFFER_SIZE 4096
+/* Room for a request and response of the largest packet size */
+#define BUFFER_SIZE (2 * WH_COMM_MTU > 4096 ? 2 * WH_COMM_MTU : 4096)
 #define REQ_SIZE 32
 #define RESP_SIZE 64
 #define REPEAT_COUNT 10
 #define ONE_MS 1000
 #define FLASH_RAM_SIZE (1024 * 1024) /* 1MB */
 #define DMA_TEST_MEM_NWORDS 3
+#define NVM_READ_DATA_LEN 32 /* Room for one "Data:%d Counter:%d" object */
 
 typedef struct {
     /* Simulated client memory region */
@@ -175,6 +183,662 @@ static int _testCallbacks(whServerContext* server, whClientContext* client)
     return WH_ERROR_OK;
 }
 
+#if WOLFHSM_SERVER_MAX_CUSTOM_CBS > 0
+/* Where the last raw callback found its request payload */
+static const uint8_t* _customRawReqData = NULL;
+static const uint8_t* _customRawCommData = NULL;
+
+/* Raw callback that returns the payload XORed with the type, in place, as far
+ * as it fits.  The return code is the byte sum of the whole request */
+static int _customRawServerCb(whServerContext* server, uint32_t id,
+                              uint32_t type, const uint8_t* req_data,
+                              uint16_t req_size, uint8_t* resp_data,
+                              uint16_t* inout_resp_size)
+{
+    int      sum = 0;
+    uint16_t i   = 0;
+
+    (void)id;
+    _customRawReqData  = req_data;
+    _customRawCommData = wh_CommServer_GetDataPtr(server->comm);
+
+    for (i = 0; i < req_size; i++) {
+        sum += req_data[i];
+    }
+    if (req_size < *inout_resp_size) {
+        *inout_resp_size = req_size;
+    }
+    for (i = 0; i < *inout_resp_size; i++) {
+        resp_data[i] = req_data[i] ^ (uint8_t)type;
+    }
+    return sum;
+}
+
+/* Helper function to test raw custom callbacks. Client and server must be
+ * already initialized and the server configured to reassemble at least
+ * 2 * WH_COMM_DATA_LEN byte requests */
+static int _testCallbacksRaw(whServerContext* server, whClientContext* client)
+{
+    uint8_t  input[2 * WH_COMM_DATA_LEN];
+    uint8_t  output[WH_COMM_DATA_LEN];
+    uint16_t out_size = 0;
+    int32_t  cb_rc    = 0;
+    int      sum      = 0;
+    int      rc       = 0;
+    uint32_t i        = 0;
+    /* Sparse ids, well past WH_CUSTOM_CB_NUM_CALLBACKS */
+    const uint32_t id = 0x12345678;
+
+    for (i = 0; i < sizeof(input); i++) {
+        input[i] = (uint8_t)(i * 7);
+    }
+
+    /* Unregistered id */
+    out_size = sizeof(output);
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_CustomCbRawRequest(client, id, 0x5A, 16, input));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOHANDLER ==
+                          wh_Client_CustomCbRawResponse(client, &cb_rc,
+                                                        &out_size, output));
+
+    /* Fill the table, then check it is full */
+    for (i = 0; i < WOLFHSM_SERVER_MAX_CUSTOM_CBS; i++) {
+        WH_TEST_RETURN_ON_FAIL(wh_Server_RegisterCustomRawCb(
+            server, id + 1000 * i, _customRawServerCb));
+    }
+    WH_TEST_ASSERT_RETURN(
+        WH_ERROR_NOSPACE ==
+        wh_Server_RegisterCustomRawCb(server, 42, _customRawServerCb));
+    /* Removing an id frees its entry */
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Server_RegisterCustomRawCb(server, id + 1000, NULL));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Server_RegisterCustomRawCb(server, 42, _customRawServerCb));
+    /* Registering an id again replaces it */
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Server_RegisterCustomRawCb(server, id, _customRawServerCb));
+
+    /* Single packet payload is handled in place in the comm buffer */
+    out_size = sizeof(output);
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_CustomCbRawRequest(client, id, 0x5A, 100, input));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_CustomCbRawResponse(client, &cb_rc, &out_size, output));
+    WH_TEST_ASSERT_RETURN(out_size == 100);
+    WH_TEST_ASSERT_RETURN(_customRawReqData ==
+                          _customRawCommData +
+                              sizeof(whMessageCustomCb_RawRequest));
+    for (i = 0, sum = 0; i < 100; i++) {
+        WH_TEST_ASSERT_RETURN(output[i] == (input[i] ^ 0x5A));
+        sum += input[i];
+    }
+    WH_TEST_ASSERT_RETURN(cb_rc == sum);
+
+    /* Response payload that does not fit */
+    out_size = 99;
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_CustomCbRawRequest(client, id, 0x5A, 100, input));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOSPACE ==
+                          wh_Client_CustomCbRawResponse(client, &cb_rc,
+                                                        &out_size, output));
+
+    /* Multi-packet payload is reassembled, with a response capped to one
+     * packet */
+    while ((rc = wh_Client_CustomCbRawRequest(client, id, 0xA5, sizeof(input),
+                                              input)) == WH_ERROR_NOTREADY) {
+        (void)wh_Server_HandleRequestMessage(server);
+    }
+    WH_TEST_RETURN_ON_FAIL(rc);
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    out_size = sizeof(output);
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_CustomCbRawResponse(client, &cb_rc, &out_size, output));
+    WH_TEST_ASSERT_RETURN(out_size ==
+                          WH_COMM_DATA_LEN -
+                              sizeof(whMessageCustomCb_RawResponse));
+    WH_TEST_ASSERT_RETURN(_customRawReqData != _customRawCommData +
+                              sizeof(whMessageCustomCb_RawRequest));
+    for (i = 0, sum = 0; i < sizeof(input); i++) {
+        if (i < out_size) {
+            WH_TEST_ASSERT_RETURN(output[i] == (input[i] ^ 0xA5));
+        }
+        sum += input[i];
+    }
+    WH_TEST_ASSERT_RETURN(cb_rc == sum);
+
+    /* Removing an unregistered id is not an error */
+    for (i = 0; i < WOLFHSM_SERVER_MAX_CUSTOM_CBS; i++) {
+        WH_TEST_RETURN_ON_FAIL(
+            wh_Server_RegisterCustomRawCb(server, id + 1000 * i, NULL));
+    }
+    WH_TEST_RETURN_ON_FAIL(wh_Server_RegisterCustomRawCb(server, 42, NULL));
+
+    return WH_ERROR_OK;
+}
+#endif /* WOLFHSM_SERVER_MAX_CUSTOM_CBS > 0 */
+
+/* Helper function to test the client NVM metadata cache. Client and server
+ * must be already initialized with a client cache configured */
+static int _testNvmCache(whServerContext* server, whClientContext* client)
+{
+    const whNvmId id        = 60;
+    uint8_t       label[]   = "Cached";
+    uint8_t       data[]    = "Cached object data";
+    uint8_t       out_label[sizeof(label)] = {0};
+    int32_t       server_rc = 0;
+    whNvmSize     len       = 0;
+    whNvmId       out_id    = 0;
+    uint32_t      avail_size      = 0;
+    uint32_t      reclaim_size    = 0;
+    whNvmId       avail_objects   = 0;
+    whNvmId       reclaim_objects = 0;
+    int           cached    = 0;
+    uint16_t      i         = 0;
+
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmAddObjectRequest(
+        client, id, WOLFHSM_NVM_ACCESS_ANY, WOLFHSM_NVM_FLAGS_NONE,
+        sizeof(label), label, sizeof(data), data));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmAddObjectResponse(client, &server_rc));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+
+    /* First lookup goes to the server and fills the cache */
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmGetMetadataRequest(client, id));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmGetMetadataResponse(
+        client, &server_rc, &out_id, NULL, NULL, &len, 0, NULL));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+    for (i = 0; i < client->nvm_cache_count; i++) {
+        if (client->nvm_cache[i].id == id) {
+            cached = 1;
+        }
+    }
+    WH_TEST_ASSERT_RETURN(cached == 1);
+
+    /* Repeated lookups are answered without a request */
+    len = 0;
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmGetMetadata(client, id, &server_rc,
+        &out_id, NULL, NULL, &len, sizeof(out_label), out_label));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+    WH_TEST_ASSERT_RETURN(out_id == id);
+    WH_TEST_ASSERT_RETURN(len == sizeof(data));
+    WH_TEST_ASSERT_RETURN(0 == memcmp(out_label, label, sizeof(label)));
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOTREADY ==
+                          wh_Server_HandleRequestMessage(server));
+
+    /* A change made behind the client's back is seen at its next NVM
+     * response, which flushes the cache */
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_DestroyObjects(server->nvm, 1, &id));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmGetAvailableRequest(client));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmGetAvailableResponse(
+        client, &server_rc, &avail_size, &avail_objects, &reclaim_size,
+        &reclaim_objects));
+    for (i = 0; i < client->nvm_cache_count; i++) {
+        WH_TEST_ASSERT_RETURN(client->nvm_cache[i].id != id);
+    }
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmGetMetadataRequest(client, id));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmGetMetadataResponse(
+        client, &server_rc, NULL, NULL, NULL, NULL, 0, NULL));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_NOTFOUND);
+
+    /* Explicit invalidation */
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmAddObjectRequest(
+        client, id, WOLFHSM_NVM_ACCESS_ANY, WOLFHSM_NVM_FLAGS_NONE,
+        sizeof(label), label, sizeof(data), data));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmAddObjectResponse(client, &server_rc));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmGetMetadataRequest(client, id));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmGetMetadataResponse(
+        client, &server_rc, NULL, NULL, NULL, NULL, 0, NULL));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmCacheInvalidate(client));
+    for (i = 0; i < client->nvm_cache_count; i++) {
+        WH_TEST_ASSERT_RETURN(client->nvm_cache[i].id == 0);
+    }
+
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_NvmDestroyObjectsRequest(client, 1, &id));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_NvmDestroyObjectsResponse(client, &server_rc));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+
+    return WH_ERROR_OK;
+}
+
+/* Helper function to test counter requests. Client and server must be
+ * already initialized, with no counter store configured */
+static int _testCounters(whServerContext* server, whClientContext* client)
+{
+    const whFlashCb  fcb[1]     = {WH_FLASH_RAMSIM_CB};
+    whFlashRamsimCtx fc[1]      = {0};
+    whFlashRamsimCfg fc_conf[1] = {{
+        .size       = 2 * 1024,
+        .sectorSize = 1024,
+        .pageSize   = 8,
+        .erasedByte = ~(uint8_t)0,
+    }};
+    whCounterConfig  cc_conf[1] = {{
+        .cb      = fcb,
+        .context = fc,
+        .config  = fc_conf,
+        .reserve = 8,
+    }};
+    whCounterContext counter[1] = {0};
+    int32_t          server_rc  = 0;
+    uint32_t         value      = 0;
+    uint32_t         i          = 0;
+
+    /* No store */
+    WH_TEST_RETURN_ON_FAIL(wh_Client_CounterIncrementRequest(client, 0));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_CounterIncrementResponse(client, &server_rc, &value));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_NOTIMPL);
+
+    WH_TEST_RETURN_ON_FAIL(wh_Counter_Init(counter, cc_conf));
+    server->counter = counter;
+
+    for (i = 1; i <= 20; i++) {
+        WH_TEST_RETURN_ON_FAIL(wh_Client_CounterIncrementRequest(client, 3));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        WH_TEST_RETURN_ON_FAIL(
+            wh_Client_CounterIncrementResponse(client, &server_rc, &value));
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+        WH_TEST_ASSERT_RETURN(value == i);
+    }
+    WH_TEST_RETURN_ON_FAIL(wh_Client_CounterReadRequest(client, 3));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_CounterReadResponse(client, &server_rc, &value));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+    WH_TEST_ASSERT_RETURN(value == 20);
+
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_CounterReadRequest(client, WOLFHSM_NUM_COUNTERS));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_CounterReadResponse(client, &server_rc, &value));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_BADARGS);
+
+    server->counter = NULL;
+    WH_TEST_RETURN_ON_FAIL(wh_Counter_Cleanup(counter));
+
+    return WH_ERROR_OK;
+}
+
+/* Helper function to test batched requests. Client and server must be
+ * already initialized and NVM must be empty */
+static int _testBatch(whServerContext* server, whClientContext* client)
+{
+    uint64_t batch[WH_COMM_DATA_LEN / sizeof(uint64_t)];
+    uint64_t resp[WH_COMM_DATA_LEN / sizeof(uint64_t)];
+    uint16_t resp_size = 0;
+    uint16_t offset    = 0;
+    uint16_t kind      = 0;
+    uint16_t len       = 0;
+    int32_t  rc        = 0;
+    const void* data   = NULL;
+
+    whMessageNvm_GetMetadataRequest meta_req = {0};
+    const whMessageNvm_GetMetadataResponse* meta_resp = NULL;
+    const whMessageNvm_GetAvailableResponse* avail_resp = NULL;
+    whMessageCommLenData echo = {0};
+
+    WH_TEST_RETURN_ON_FAIL(wh_MessageComm_BatchInit(batch, sizeof(batch)));
+
+    /* Small NVM requests */
+    WH_TEST_RETURN_ON_FAIL(wh_MessageComm_BatchAppend(WH_COMM_MAGIC_NATIVE,
+            batch, sizeof(batch),
+            WH_MESSAGE_KIND(WH_MESSAGE_GROUP_NVM,
+                            WH_MESSAGE_NVM_ACTION_GETAVAILABLE),
+            0, 0, NULL));
+    meta_req.id = 99;
+    WH_TEST_RETURN_ON_FAIL(wh_MessageComm_BatchAppend(WH_COMM_MAGIC_NATIVE,
+            batch, sizeof(batch),
+            WH_MESSAGE_KIND(WH_MESSAGE_GROUP_NVM,
+                            WH_MESSAGE_NVM_ACTION_GETMETADATA),
+            0, sizeof(meta_req), &meta_req));
+
+    /* Nested batches are rejected */
+    WH_TEST_RETURN_ON_FAIL(wh_MessageComm_BatchAppend(WH_COMM_MAGIC_NATIVE,
+            batch, sizeof(batch),
+            WH_MESSAGE_KIND(WH_MESSAGE_GROUP_COMM,
+                            WH_MESSAGE_COMM_ACTION_BATCH),
+            0, 0, NULL));
+
+    /* A full-size echo response cannot fit in what is left of the frame */
+    WH_TEST_RETURN_ON_FAIL(wh_MessageComm_BatchAppend(WH_COMM_MAGIC_NATIVE,
+            batch, sizeof(batch),
+            WH_MESSAGE_KIND(WH_MESSAGE_GROUP_COMM,
+                            WH_MESSAGE_COMM_ACTION_ECHO),
+            0, 8, &echo));
+
+    /* Batches are bounded by the frame size */
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOSPACE ==
+            wh_MessageComm_BatchAppend(WH_COMM_MAGIC_NATIVE,
+                batch, sizeof(batch), 0, 0, sizeof(echo), &echo));
+
+    WH_TEST_RETURN_ON_FAIL(wh_Client_CommBatchRequest(client,
+            sizeof(whMessageCommBatchHeader) +
+            ((whMessageCommBatchHeader*)batch)->len, batch));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_CommBatchResponse(client, &resp_size,
+            resp));
+    WH_TEST_ASSERT_RETURN(((whMessageCommBatchHeader*)resp)->count == 4);
+
+    WH_TEST_RETURN_ON_FAIL(wh_MessageComm_BatchNext(WH_COMM_MAGIC_NATIVE,
+            resp, resp_size, &offset, &kind, &rc, &len, &data));
+    WH_TEST_ASSERT_RETURN(rc == 0);
+    WH_TEST_ASSERT_RETURN(len == sizeof(*avail_resp));
+    avail_resp = data;
+    WH_TEST_ASSERT_RETURN(avail_resp->rc == 0);
+    WH_TEST_ASSERT_RETURN(avail_resp->avail_objects +
+            avail_resp->reclaim_objects == NF_OBJECT_COUNT);
+
+    WH_TEST_RETURN_ON_FAIL(wh_MessageComm_BatchNext(WH_COMM_MAGIC_NATIVE,
+            resp, resp_size, &offset, &kind, &rc, &len, &data));
+    WH_TEST_ASSERT_RETURN(WH_MESSAGE_ACTION(kind) ==
+            WH_MESSAGE_NVM_ACTION_GETMETADATA);
+    WH_TEST_ASSERT_RETURN(len == sizeof(*meta_resp));
+    meta_resp = data;
+    WH_TEST_ASSERT_RETURN(meta_resp->rc == WH_ERROR_NOTFOUND);
+
+    WH_TEST_RETURN_ON_FAIL(wh_MessageComm_BatchNext(WH_COMM_MAGIC_NATIVE,
+            resp, resp_size, &offset, &kind, &rc, &len, &data));
+    WH_TEST_ASSERT_RETURN(rc == WH_ERROR_BADARGS);
+    WH_TEST_ASSERT_RETURN(len == 0);
+
+    WH_TEST_RETURN_ON_FAIL(wh_MessageComm_BatchNext(WH_COMM_MAGIC_NATIVE,
+            resp, resp_size, &offset, &kind, &rc, &len, &data));
+    WH_TEST_ASSERT_RETURN(rc == WH_ERROR_NOSPACE);
+    WH_TEST_ASSERT_RETURN(len == 0);
+
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOTFOUND ==
+            wh_MessageComm_BatchNext(WH_COMM_MAGIC_NATIVE,
+                resp, resp_size, &offset, &kind, &rc, &len, &data));
+
+    return WH_ERROR_OK;
+}
+
+#if WOLFHSM_SERVER_MAX_JOBS > 0
+#define JOB_TEST_SLICES 3
+#define JOB_TEST_RESULT 0xC0FFEEu
+
+/* Job that counts down its state once per slice */
+static int _countdownJob(whServerContext* server, uint8_t* buffer,
+        uint16_t* out_size)
+{
+    uint32_t* count = (uint32_t*)buffer;
+    (void)server;
+
+    if (--(*count) > 0) {
+        return WH_ERROR_NOTREADY;
+    }
+    *count = JOB_TEST_RESULT;
+    *out_size = sizeof(*count);
+    return WH_ERROR_OK;
+}
+
+/* Custom callback that accepts the request as a countdown job */
+static int _customServerJobCb(whServerContext*                 server,
+                              const whMessageCustomCb_Request* req,
+                              whMessageCustomCb_Response*      resp)
+{
+    uint32_t count = JOB_TEST_SLICES;
+    uint16_t id = 0;
+    int rc = wh_Server_JobStart(server, _countdownJob,
+            WH_MESSAGE_KIND(WH_MESSAGE_GROUP_CUSTOM, req->id),
+            sizeof(count), &count, &id);
+
+    resp->type = req->type;
+    memcpy(resp->data.buffer.data, &id, sizeof(id));
+    return rc;
+}
+
+static int _testJobs(whServerContext* server, whClientContext* client)
+{
+    whMessageCustomCb_Request  req  = {0};
+    whMessageCustomCb_Response resp = {0};
+    uint8_t  echo[8] = "job";
+    uint16_t echo_len = 0;
+    uint16_t id = 0;
+    uint16_t kind = 0;
+    uint16_t len = 0;
+    uint32_t result = 0;
+    int32_t  rc = 0;
+
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Server_RegisterCustomCb(server, 0, _customServerJobCb));
+
+    /* Start the job.  The first slice runs after the request is handled */
+    req.id = 0;
+    req.type = WH_MESSAGE_CUSTOM_CB_TYPE_USER_DEFINED_START;
+    WH_TEST_RETURN_ON_FAIL(wh_Client_CustomCbRequest(client, &req));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_CustomCbResponse(client, &resp));
+    WH_TEST_ASSERT_RETURN(resp.err == WH_ERROR_OK);
+    WH_TEST_ASSERT_RETURN(resp.rc == WH_ERROR_OK);
+    memcpy(&id, resp.data.buffer.data, sizeof(id));
+    WH_TEST_ASSERT_RETURN(id != 0);
+
+    /* Still running, second slice */
+    WH_TEST_RETURN_ON_FAIL(wh_Client_JobRequest(client, id));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    len = sizeof(result);
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_JobResponse(client, &rc, &kind, &len, &result));
+    WH_TEST_ASSERT_RETURN(rc == WH_ERROR_NOTREADY);
+    WH_TEST_ASSERT_RETURN(len == 0);
+
+    /* Other requests are served while the job runs, last slice */
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_EchoRequest(client, sizeof(echo), echo));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_EchoResponse(client, &echo_len, echo));
+    WH_TEST_ASSERT_RETURN(echo_len == sizeof(echo));
+
+    /* No request and no running job */
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOTREADY ==
+            wh_Server_HandleRequestMessage(server));
+
+    /* Fetch the result, which releases the job */
+    WH_TEST_RETURN_ON_FAIL(wh_Client_JobRequest(client, id));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    len = sizeof(result);
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_JobResponse(client, &rc, &kind, &len, &result));
+    WH_TEST_ASSERT_RETURN(rc == WH_ERROR_OK);
+    WH_TEST_ASSERT_RETURN(kind == WH_MESSAGE_KIND(WH_MESSAGE_GROUP_CUSTOM, 0));
+    WH_TEST_ASSERT_RETURN(len == sizeof(result));
+    WH_TEST_ASSERT_RETURN(result == JOB_TEST_RESULT);
+
+    WH_TEST_RETURN_ON_FAIL(wh_Client_JobRequest(client, id));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_JobResponse(client, &rc, NULL, NULL, NULL));
+    WH_TEST_ASSERT_RETURN(rc == WH_ERROR_NOTFOUND);
+
+    return WH_ERROR_OK;
+}
+#endif /* WOLFHSM_SERVER_MAX_JOBS > 0 */
+
+#if WOLFHSM_SERVER_MAX_HANDLERS > 0
+/* Echo override that always answers with a single byte */
+static int _echoOverrideHandler(whServerContext* server,
+        uint16_t magic, uint16_t action, uint16_t seq,
+        uint16_t req_size, const void* req_packet,
+        uint16_t* out_resp_size, void* resp_packet)
+{
+    whMessageCommLenData resp = {0};
+    (void)server; (void)magic; (void)action; (void)seq;
+    (void)req_size; (void)req_packet;
+
+    resp.len = 1;
+    resp.data[0] = 'X';
+    memcpy(resp_packet, &resp, sizeof(resp));
+    *out_resp_size = sizeof(resp);
+    return WH_ERROR_OK;
+}
+
+/* Group handler that returns the action followed by the request bytes */
+static int _groupHandler(whServerContext* server,
+        uint16_t magic, uint16_t action, uint16_t seq,
+        uint16_t req_size, const void* req_packet,
+        uint16_t* out_resp_size, void* resp_packet)
+{
+    uint8_t* out = (uint8_t*)resp_packet;
+    (void)server; (void)magic; (void)seq;
+
+    memmove(out + 1, req_packet, req_size);
+    out[0] = (uint8_t)action;
+    *out_resp_size = req_size + 1;
+    return WH_ERROR_OK;
+}
+
+static int _testHandlers(whServerContext* server, whClientContext* client)
+{
+    const uint16_t echo_kind = WH_MESSAGE_KIND(WH_MESSAGE_GROUP_COMM,
+                                               WH_MESSAGE_COMM_ACTION_ECHO);
+    uint8_t  req[4] = {1, 2, 3, 4};
+    uint8_t  resp[WH_COMM_DATA_LEN] = {0};
+    uint16_t len = 0;
+    uint16_t group = 0;
+    uint16_t action = 0;
+    int i = 0;
+
+    /* Per-kind override replaces a single action of a built-in group */
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Server_RegisterHandler(server, echo_kind, _echoOverrideHandler));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_EchoRequest(client, sizeof(req), req));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_EchoResponse(client, &len, resp));
+    WH_TEST_ASSERT_RETURN((len == 1) && (resp[0] == 'X'));
+
+    /* Overrides are bounded */
+    for (i = 1; i < WOLFHSM_SERVER_MAX_HANDLERS; i++) {
+        WH_TEST_RETURN_ON_FAIL(wh_Server_RegisterHandler(server,
+            WH_MESSAGE_KIND(WH_MESSAGE_GROUP_IMAGE, i), _groupHandler));
+    }
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOSPACE == wh_Server_RegisterHandler(
+        server, WH_MESSAGE_KIND(WH_MESSAGE_GROUP_IMAGE, i), _groupHandler));
+    for (i = 1; i < WOLFHSM_SERVER_MAX_HANDLERS; i++) {
+        WH_TEST_RETURN_ON_FAIL(wh_Server_RegisterHandler(server,
+            WH_MESSAGE_KIND(WH_MESSAGE_GROUP_IMAGE, i), NULL));
+    }
+
+    /* Removing the override restores the built-in handler */
+    WH_TEST_RETURN_ON_FAIL(wh_Server_RegisterHandler(server, echo_kind, NULL));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_EchoRequest(client, sizeof(req), req));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_EchoResponse(client, &len, resp));
+    WH_TEST_ASSERT_RETURN((len == sizeof(req)) &&
+                          (0 == memcmp(req, resp, sizeof(req))));
+
+    /* Group without a built-in handler */
+    WH_TEST_RETURN_ON_FAIL(wh_Client_SendRequest(client,
+            WH_MESSAGE_GROUP_IMAGE, 7, sizeof(req), req));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_RecvResponse(client, &group, &action,
+            &len, resp));
+    WH_TEST_ASSERT_RETURN(len == 0);
+
+    WH_TEST_RETURN_ON_FAIL(wh_Server_RegisterGroupHandler(server,
+            WH_MESSAGE_GROUP_IMAGE, _groupHandler));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_SendRequest(client,
+            WH_MESSAGE_GROUP_IMAGE, 7, sizeof(req), req));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_RecvResponse(client, &group, &action,
+            &len, resp));
+    WH_TEST_ASSERT_RETURN((group == WH_MESSAGE_GROUP_IMAGE) && (action == 7));
+    WH_TEST_ASSERT_RETURN((len == sizeof(req) + 1) && (resp[0] == 7));
+    WH_TEST_ASSERT_RETURN(0 == memcmp(req, resp + 1, sizeof(req)));
+
+    WH_TEST_RETURN_ON_FAIL(wh_Server_RegisterGroupHandler(server,
+            WH_MESSAGE_GROUP_IMAGE, NULL));
+    WH_TEST_ASSERT_RETURN(WH_ERROR_BADARGS == wh_Server_RegisterGroupHandler(
+            server, WH_MESSAGE_GROUP_NONE, _groupHandler));
+
+    return WH_ERROR_OK;
+}
+#endif /* WOLFHSM_SERVER_MAX_HANDLERS > 0 */
+
+#ifdef WOLFHSM_SERVER_STATS
+/* Fake clock that advances 10 units per read */
+static uint64_t _testStatsTime(void* context)
+{
+    uint64_t* now = (uint64_t*)context;
+    *now += 10;
+    return *now;
+}
+
+static int _testStats(whServerContext* server, whClientContext* client)
+{
+    const uint16_t echo_kind = WH_MESSAGE_KIND(WH_MESSAGE_GROUP_COMM,
+                                               WH_MESSAGE_COMM_ACTION_ECHO);
+    whMessageCommStatsEntry entries[4];
+    whServerStatsEntry local = {0};
+    const whMessageCommStatsEntry* echo = NULL;
+    uint8_t  data[4] = {1, 2, 3, 4};
+    uint16_t total = 0;
+    uint16_t count = 0;
+    uint16_t len = 0;
+    int i = 0;
+
+    /* Start from clean counters.  The reset request itself is counted */
+    WH_TEST_RETURN_ON_FAIL(wh_Client_CommStatsRequest(client, 0, 1));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_CommStatsResponse(client, &total, NULL, NULL));
+    WH_TEST_ASSERT_RETURN(total > 0);
+
+    for (i = 0; i < 3; i++) {
+        WH_TEST_RETURN_ON_FAIL(
+            wh_Client_EchoRequest(client, sizeof(data), data));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        WH_TEST_RETURN_ON_FAIL(wh_Client_EchoResponse(client, &len, data));
+    }
+
+    count = sizeof(entries) / sizeof(entries[0]);
+    WH_TEST_RETURN_ON_FAIL(wh_Client_CommStatsRequest(client, 0, 0));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_CommStatsResponse(client, &total, &count, entries));
+    WH_TEST_ASSERT_RETURN(total == 2);
+    WH_TEST_ASSERT_RETURN(count == 2);
+    for (i = 0; i < count; i++) {
+        if (entries[i].kind == echo_kind) {
+            echo = &entries[i];
+        }
+    }
+    WH_TEST_ASSERT_RETURN(echo != NULL);
+    WH_TEST_ASSERT_RETURN(echo->count == 3);
+    WH_TEST_ASSERT_RETURN(echo->bytes_in == 3 * sizeof(whMessageCommLenData));
+    WH_TEST_ASSERT_RETURN(echo->bytes_out == 3 * sizeof(whMessageCommLenData));
+    /* Every dispatch reads the fake clock twice */
+    WH_TEST_ASSERT_RETURN(echo->time_min == 10);
+    WH_TEST_ASSERT_RETURN(echo->time_max == 10);
+    WH_TEST_ASSERT_RETURN(echo->time_mean == 10);
+    WH_TEST_ASSERT_RETURN(echo->hist[1] == 3);
+
+    /* Server side access.  The last read is now counted as well */
+    WH_TEST_RETURN_ON_FAIL(wh_Server_StatsGet(server, 0, &local));
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOTFOUND ==
+                          wh_Server_StatsGet(server, total, &local));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_StatsReset(server));
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOTFOUND ==
+                          wh_Server_StatsGet(server, 0, &local));
+
+    return WH_ERROR_OK;
+}
+#endif /* WOLFHSM_SERVER_STATS */
+
 static int _customServerDmaCb(struct whServerContext_t* server,
                               void* clientAddr, void** serverPtr, uint32_t len,
                               whServerDmaOper oper, whServerDmaFlags flags)
@@ -412,6 +1076,60 @@ static int _testDma(whServerContext* server, whClientContext* client)
                                   (whServerDmaFlags){0}));
     }
 
+    /* Regions are indexed in address order, and overlapping or touching
+     * regions allow ranges that span them */
+    {
+        static uint8_t pool[32 * WH_DMA_ADDR_ALLOWLIST_COUNT];
+        whServerDmaAddrAllowList poolList = {0};
+        int i = 0;
+
+        /* Every other 16 byte block, registered in reverse order, and a
+         * last region overlapping the first block */
+        for (i = 0; i < WH_DMA_ADDR_ALLOWLIST_COUNT - 1; i++) {
+            poolList.readList[i].addr =
+                &pool[32 * (WH_DMA_ADDR_ALLOWLIST_COUNT - 2 - i)];
+            poolList.readList[i].size = 16;
+        }
+        poolList.readList[i].addr = &pool[8];
+        poolList.readList[i].size = 16;
+        poolList.writeList[0].addr = &pool[0];
+        poolList.writeList[0].size = sizeof(pool);
+        WH_TEST_RETURN_ON_FAIL(
+            wh_Server_DmaRegisterAllowList(server, &poolList));
+
+        for (i = 1; i < WH_DMA_ADDR_ALLOWLIST_COUNT - 1; i++) {
+            WH_TEST_ASSERT_RETURN(WH_ERROR_OK ==
+                wh_Server_DmaCheckMemOperAllowed(server,
+                    WH_DMA_OPER_CLIENT_READ_PRE, &pool[32 * i], 16));
+            WH_TEST_ASSERT_RETURN(WH_ERROR_ACCESS ==
+                wh_Server_DmaCheckMemOperAllowed(server,
+                    WH_DMA_OPER_CLIENT_READ_PRE, &pool[32 * i + 8], 16));
+        }
+        /* The first block and the region overlapping it merge */
+        WH_TEST_ASSERT_RETURN(WH_ERROR_OK ==
+            wh_Server_DmaCheckMemOperAllowed(server,
+                WH_DMA_OPER_CLIENT_READ_PRE, &pool[4], 20));
+        WH_TEST_ASSERT_RETURN(WH_ERROR_ACCESS ==
+            wh_Server_DmaCheckMemOperAllowed(server,
+                WH_DMA_OPER_CLIENT_READ_PRE, &pool[4], 21));
+        WH_TEST_ASSERT_RETURN(WH_ERROR_OK ==
+            wh_Server_DmaCheckMemOperAllowed(server,
+                WH_DMA_OPER_CLIENT_WRITE_PRE, &pool[100], 16));
+
+        /* A region wrapping the address space is refused and the previous
+         * allowlist stays registered */
+        poolList.writeList[1].addr = (void*)(~(uintptr_t)0 - 3);
+        poolList.writeList[1].size = 8;
+        WH_TEST_ASSERT_RETURN(WH_ERROR_BADARGS ==
+            wh_Server_DmaRegisterAllowList(server, &poolList));
+        WH_TEST_ASSERT_RETURN(WH_ERROR_OK ==
+            wh_Server_DmaCheckMemOperAllowed(server,
+                WH_DMA_OPER_CLIENT_READ_PRE, &pool[32], 16));
+
+        WH_TEST_RETURN_ON_FAIL(
+            wh_Server_DmaRegisterAllowList(server, &allowList));
+    }
+
     /* Finally, check that registering a NULL callbacks clears the DMA callback
      * table, and that the copies otherwise work as normal */
     WH_TEST_RETURN_ON_FAIL(wh_Server_DmaRegisterCb32(server, NULL));
@@ -458,6 +1176,313 @@ static int _testDma(whServerContext* server, whClientContext* client)
     return rc;
 }
 
+#define STREAM_TEST_LEN (3 * WH_COMM_DATA_LEN + 100)
+
+/* Stream an object larger than any single request through Begin, Write and
+ * Finish, one request at a time */
+static int _testNvmStream(whServerContext* server, whClientContext* client)
+{
+    static uint8_t data[STREAM_TEST_LEN];
+    static uint8_t check[STREAM_TEST_LEN];
+    const whNvmId  id        = 77;
+    uint8_t        label[]   = "Streamed";
+    whNvmMetadata  meta      = {0};
+    int32_t        server_rc = 0;
+    uint16_t       offset    = 0;
+    uint16_t       chunk     = 0;
+    uint8_t        client_id = 0;
+    size_t         i         = 0;
+
+    for (i = 0; i < sizeof(data); i++) {
+        data[i] = (uint8_t)(i ^ (i >> 8));
+    }
+
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmAddObjectBeginRequest(client, id,
+            WOLFHSM_NVM_ACCESS_ANY, WOLFHSM_NVM_FLAGS_NONE, sizeof(label),
+            label, sizeof(data)));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmAddObjectBeginResponse(client,
+            &server_rc));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+
+    /* Other changes wait for the stream */
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmAddObjectRequest(client, id + 1,
+            WOLFHSM_NVM_ACCESS_ANY, WOLFHSM_NVM_FLAGS_NONE, 0, NULL, 8,
+            data));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmAddObjectResponse(client,
+            &server_rc));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_NOTREADY);
+
+    while (offset < sizeof(data)) {
+        chunk = (uint16_t)(sizeof(data) - offset);
+        if (chunk > WH_MESSAGE_NVM_MAX_ADD_OBJECT_WRITE_LEN) {
+            chunk = WH_MESSAGE_NVM_MAX_ADD_OBJECT_WRITE_LEN;
+        }
+        WH_TEST_RETURN_ON_FAIL(wh_Client_NvmAddObjectWriteRequest(client,
+                offset, chunk, data + offset));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        WH_TEST_RETURN_ON_FAIL(wh_Client_NvmAddObjectWriteResponse(client,
+                &server_rc));
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+        offset += chunk;
+
+        /* Not visible until Finish */
+        WH_TEST_ASSERT_RETURN(WH_ERROR_NOTFOUND ==
+                wh_Nvm_GetMetadata(server->nvm, id, &meta));
+    }
+
+    /* Only the client that began the stream may finish it */
+    client_id = server->comm->client_id;
+    server->comm->client_id = client_id + 1;
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmAddObjectFinishRequest(client, 1));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmAddObjectFinishResponse(client,
+            &server_rc));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_ACCESS);
+    server->comm->client_id = client_id;
+
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmAddObjectFinishRequest(client, 1));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmAddObjectFinishResponse(client,
+            &server_rc));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_GetMetadata(server->nvm, id, &meta));
+    WH_TEST_ASSERT_RETURN(meta.len == sizeof(data));
+    WH_TEST_ASSERT_RETURN(0 == memcmp(meta.label, label, sizeof(label)));
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_Read(server->nvm, id, 0, sizeof(check),
+            check));
+    WH_TEST_ASSERT_RETURN(0 == memcmp(check, data, sizeof(data)));
+
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_DestroyObjects(server->nvm, 1, &id));
+    return WH_ERROR_OK;
+}
+
+/* Add an object from buffers that do not split on flash units and read it
+ * back into differently split buffers */
+static int _testNvmDmaSg(whServerContext* server, whClientContext* client)
+{
+    uint8_t       data[3 * 37];
+    uint8_t       check[sizeof(data)];
+    whNvmMetadata meta      = {0};
+    whClientDmaSg sg[3]     = {{data, 5}, {data + 5, 19}, {data + 24, 87}};
+    whClientDmaSg readSg[3] = {{check, 64}, {check + 64, 1},
+                               {check + 65, 46}};
+    int32_t       server_rc = 0;
+    size_t        i         = 0;
+
+    for (i = 0; i < sizeof(data); i++) {
+        data[i] = (uint8_t)(i * 7 + 3);
+    }
+    meta.id = 78;
+    meta.access = WOLFHSM_NVM_ACCESS_ANY;
+
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmAddObjectDmaSgRequest(client, &meta,
+            3, sg));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmAddObjectDmaSgResponse(client,
+            &server_rc));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+
+    memset(&meta, 0, sizeof(meta));
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_GetMetadata(server->nvm, 78, &meta));
+    WH_TEST_ASSERT_RETURN(meta.len == sizeof(data));
+
+    memset(check, 0, sizeof(check));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmReadDmaSgRequest(client, 78, 0, 3,
+            readSg));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmReadDmaSgResponse(client,
+            &server_rc));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+    WH_TEST_ASSERT_RETURN(0 == memcmp(check, data, sizeof(data)));
+
+    /* Reading past the end of the object fails */
+    readSg[0].len = sizeof(data);
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmReadDmaSgRequest(client, 78, 1, 1,
+            readSg));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmReadDmaSgResponse(client,
+            &server_rc));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_BADARGS);
+
+    /* Empty buffers and overlong lists are rejected before sending */
+    sg[1].len = 0;
+    WH_TEST_ASSERT_RETURN(WH_ERROR_BADARGS ==
+            wh_Client_NvmAddObjectDmaSgRequest(client, &meta, 3, sg));
+    WH_TEST_ASSERT_RETURN(WH_ERROR_BADARGS ==
+            wh_Client_NvmReadDmaSgRequest(client, 78, 0,
+                    WH_MESSAGE_NVM_MAX_DMA_SG_COUNT + 1, readSg));
+
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_DestroyObjects(server->nvm, 1, &meta.id));
+    return WH_ERROR_OK;
+}
+
+static int _dmaMapCbCount = 0;
+static int _dmaMapCbDeny  = 0;
+
+/* Leaves client addresses unchanged and counts the operations processed.
+ * PRE operations are refused while _dmaMapCbDeny is set */
+static int _countingServerDma64Cb(struct whServerContext_t* server,
+                                  uint64_t clientAddr, void** serverPtr,
+                                  uint64_t len, whServerDmaOper oper,
+                                  whServerDmaFlags flags)
+{
+    (void)server; (void)clientAddr; (void)serverPtr; (void)len; (void)flags;
+    _dmaMapCbCount++;
+    if ((_dmaMapCbDeny != 0) && ((oper == WH_DMA_OPER_CLIENT_READ_PRE) ||
+            (oper == WH_DMA_OPER_CLIENT_WRITE_PRE))) {
+        return WH_ERROR_ACCESS;
+    }
+    return WH_ERROR_OK;
+}
+
+/* Requests within a mapped buffer skip the DMA callbacks until it is
+ * unmapped, and only for the client that mapped it */
+static int _testDmaMap(whServerContext* server, whClientContext* client)
+{
+    uint64_t      arenaBuf[32];
+    uint8_t*      arena     = (uint8_t*)arenaBuf;
+    uint8_t       outside[32];
+    whNvmMetadata* meta     = (whNvmMetadata*)(void*)arenaBuf;
+    uint8_t*      data      = arena + 128;
+    uint8_t*      check     = arena + 192;
+    int32_t       server_rc = 0;
+    uint32_t      handle    = 0;
+    uint32_t      handles[WH_DMA_MAP_COUNT];
+    uint8_t       client_id = 0;
+    uint32_t      out_client_id = 0;
+    uint32_t      out_server_id = 0;
+    int           i         = 0;
+
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Server_DmaRegisterCb64(server, _countingServerDma64Cb));
+
+    memset(arena, 0, sizeof(arenaBuf));
+    meta->id = 79;
+    meta->access = WOLFHSM_NVM_ACCESS_ANY;
+    for (i = 0; i < 32; i++) {
+        data[i] = (uint8_t)(0xA0 + i);
+    }
+
+    _dmaMapCbCount = 0;
+    WH_TEST_RETURN_ON_FAIL(wh_Client_DmaMapRequest(client, arena,
+            sizeof(arenaBuf), WH_DMA_MAP_READ | WH_DMA_MAP_WRITE));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_DmaMapResponse(client, &server_rc,
+            &handle));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+    WH_TEST_ASSERT_RETURN(_dmaMapCbCount == 2);
+
+    /* Metadata, data and read back all lie within the mapping */
+    _dmaMapCbCount = 0;
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmAddObjectDmaRequest(client, meta, 32,
+            data));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmAddObjectDmaResponse(client,
+            &server_rc));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmReadDmaRequest(client, 79, 0, 32,
+            check));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmReadDmaResponse(client, &server_rc));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+    WH_TEST_ASSERT_RETURN(_dmaMapCbCount == 0);
+    WH_TEST_ASSERT_RETURN(0 == memcmp(check, data, 32));
+
+    /* Buffers outside the mapping still go through the callbacks */
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmReadDmaRequest(client, 79, 0,
+            sizeof(outside), outside));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmReadDmaResponse(client, &server_rc));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+    WH_TEST_ASSERT_RETURN(_dmaMapCbCount == 2);
+
+    /* Another client neither uses nor unmaps the mapping */
+    client_id = server->comm->client_id;
+    server->comm->client_id = client_id + 1;
+    _dmaMapCbCount = 0;
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmReadDmaRequest(client, 79, 0, 32,
+            check));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmReadDmaResponse(client, &server_rc));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+    WH_TEST_ASSERT_RETURN(_dmaMapCbCount == 2);
+    WH_TEST_ASSERT_RETURN(WH_ERROR_ACCESS ==
+                          wh_Server_DmaUnmapClientAddress(server, handle));
+    server->comm->client_id = client_id;
+
+    /* Unmapping processes the POST operations once */
+    _dmaMapCbCount = 0;
+    WH_TEST_RETURN_ON_FAIL(wh_Client_DmaUnmapRequest(client, handle));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_DmaUnmapResponse(client, &server_rc));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+    WH_TEST_ASSERT_RETURN(_dmaMapCbCount == 2);
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOTFOUND ==
+                          wh_Server_DmaUnmapClientAddress(server, handle));
+
+    /* Closing unmaps the buffers of the client, processing their POST
+     * operations */
+    WH_TEST_RETURN_ON_FAIL(wh_Client_CommInitRequest(client));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_CommInitResponse(client, &out_client_id,
+            &out_server_id));
+    client_id = server->comm->client_id;
+    WH_TEST_RETURN_ON_FAIL(wh_Client_DmaMapRequest(client, arena,
+            sizeof(arenaBuf), WH_DMA_MAP_READ | WH_DMA_MAP_WRITE));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_DmaMapResponse(client, &server_rc,
+            &handle));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+    _dmaMapCbCount = 0;
+    WH_TEST_RETURN_ON_FAIL(wh_Client_CommCloseRequest(client));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_CommCloseResponse(client));
+    WH_TEST_ASSERT_RETURN(_dmaMapCbCount == 2);
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOTFOUND ==
+                          wh_Server_DmaUnmapClientAddress(server, handle));
+
+    /* A new connection with the same client id gets no stale mapping, its
+     * buffers are checked again and can be refused */
+    WH_TEST_RETURN_ON_FAIL(wh_Server_SetConnected(server, WH_COMM_CONNECTED));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_CommInitRequest(client));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_CommInitResponse(client, &out_client_id,
+            &out_server_id));
+    WH_TEST_ASSERT_RETURN(server->comm->client_id == client_id);
+    _dmaMapCbCount = 0;
+    _dmaMapCbDeny  = 1;
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmReadDmaRequest(client, 79, 0, 32,
+            check));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmReadDmaResponse(client, &server_rc));
+    _dmaMapCbDeny  = 0;
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_ACCESS);
+    WH_TEST_ASSERT_RETURN(_dmaMapCbCount > 0);
+
+    /* The table is bounded and a reused slot gets a new handle */
+    for (i = 0; i < WH_DMA_MAP_COUNT; i++) {
+        WH_TEST_RETURN_ON_FAIL(wh_Server_DmaMapClientAddress(server,
+                (uint64_t)(uintptr_t)arena, sizeof(arenaBuf), WH_DMA_MAP_READ,
+                &handles[i]));
+        WH_TEST_ASSERT_RETURN(handles[i] != handle);
+    }
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOSPACE ==
+            wh_Server_DmaMapClientAddress(server, (uint64_t)(uintptr_t)arena,
+                    sizeof(arenaBuf), WH_DMA_MAP_READ, &handle));
+    wh_Server_DmaUnmapAll(server);
+    for (i = 0; i < WH_DMA_MAP_COUNT; i++) {
+        WH_TEST_ASSERT_RETURN(WH_ERROR_NOTFOUND ==
+                wh_Server_DmaUnmapClientAddress(server, handles[i]));
+    }
+
+    WH_TEST_RETURN_ON_FAIL(wh_Server_DmaRegisterCb64(server, NULL));
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_DestroyObjects(server->nvm, 1, &meta->id));
+    return WH_ERROR_OK;
+}
+
 int _clientServerSequentialTestConnectCb(void* context, whCommConnected connected)
 {
     if (clientServerSequentialTestServerCtx == NULL) {
@@ -499,17 +1524,23 @@ int whTest_ClientServerSequential(void)
 
     whClientContext client[1] = {0};
 
+    whNvmMetadata  nvm_cache[4];
     whClientConfig c_conf[1] = {{
-        .comm = cc_conf,
+        .comm            = cc_conf,
+        .nvm_cache       = nvm_cache,
+        .nvm_cache_count = sizeof(nvm_cache) / sizeof(nvm_cache[0]),
     }};
 
     /* Server configuration/contexts */
     whTransportServerCb         tscb[1]    = {WH_TRANSPORT_MEM_SERVER_CB};
     whTransportMemServerContext tmsc[1]    = {0};
+    uint64_t cs_frag[3 * WH_COMM_DATA_LEN / sizeof(uint64_t)];
     whCommServerConfig          cs_conf[1] = {{
                  .transport_cb      = tscb,
                  .transport_context = (void*)tmsc,
                  .transport_config  = (void*)tmcf,
+                 .frag_buffer       = (uint8_t*)cs_frag,
+                 .frag_size         = sizeof(cs_frag),
                  .server_id         = 124,
     }};
 
@@ -544,11 +1575,19 @@ int whTest_ClientServerSequential(void)
     }};
 #endif
 
+#ifdef WOLFHSM_SERVER_STATS
+    uint64_t now = 0;
+#endif
+
     whServerConfig  s_conf[1] = {{
          .comm_config = cs_conf,
          .nvm         = nvm,
 #ifndef WOLFHSM_NO_CRYPTO
          .crypto      = crypto,
+#endif
+#ifdef WOLFHSM_SERVER_STATS
+         .time_cb      = _testStatsTime,
+         .time_context = &now,
 #endif
     }};
     whServerContext server[1] = {0};
@@ -805,6 +1844,20 @@ int whTest_ClientServerSequential(void)
         }
     } while (list_count > 0);
 
+    /* Destroys only leave tombstones, so every entry is free or reclaimable */
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmGetAvailableRequest(client));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmGetAvailableResponse(
+        client, &server_rc, &avail_size, &avail_objects, &reclaim_size,
+        &reclaim_objects));
+    WH_TEST_ASSERT_RETURN(avail_objects + reclaim_objects == NF_OBJECT_COUNT);
+
+    /* An empty destroy compacts the partition */
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmDestroyObjectsRequest(client, 0, NULL));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_NvmDestroyObjectsResponse(client, &server_rc));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
 
     WH_TEST_RETURN_ON_FAIL(wh_Client_NvmGetAvailableRequest(client));
     WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
@@ -813,6 +1866,25 @@ int whTest_ClientServerSequential(void)
         &reclaim_objects));
     WH_TEST_ASSERT_RETURN(avail_objects == NF_OBJECT_COUNT);
 
+    /* The wear counters saw the adds and the compaction */
+    {
+        whNvmStats stats = {0};
+
+        WH_TEST_RETURN_ON_FAIL(wh_Client_NvmGetStatsRequest(client));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        WH_TEST_RETURN_ON_FAIL(
+            wh_Client_NvmGetStatsResponse(client, &server_rc, &stats));
+#ifdef WOLFHSM_NVM_STATS
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+        WH_TEST_ASSERT_RETURN(stats.data_bytes > 0);
+        WH_TEST_ASSERT_RETURN(stats.program_bytes > stats.data_bytes);
+        WH_TEST_ASSERT_RETURN(stats.compactions > 0);
+        WH_TEST_ASSERT_RETURN(stats.erase_ops > 0);
+#else
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_NOTIMPL);
+#endif
+    }
+
     for (counter = 0; counter < 5; counter++) {
         whNvmMetadata meta = {
             .id     = counter + 40,
@@ -903,6 +1975,63 @@ int whTest_ClientServerSequential(void)
         WH_TEST_ASSERT_RETURN(0 == memcmp(send_buffer, recv_buffer, len));
     }
 
+    {
+        /* Fetch every object written above in one request, then again through
+         * DMA.  The trailing id is missing and ends the list */
+        whNvmId       read_ids[6]   = {40, 41, 42, 43, 44, 99};
+        whNvmMetadata read_meta[6];
+        whNvmSize     read_lens[6];
+        uint8_t       read_data[6][NVM_READ_DATA_LEN];
+        uint8_t*      read_bufs[6];
+        whNvmSize     read_sizes[6];
+        whNvmId       read_count = 0;
+        uint16_t      used       = 0;
+        char          expected[NVM_READ_DATA_LEN];
+        int           i          = 0;
+        int           len        = 0;
+
+        WH_TEST_RETURN_ON_FAIL(wh_Client_NvmReadObjectsRequest(client, 6,
+                                                               read_ids));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        WH_TEST_RETURN_ON_FAIL(wh_Client_NvmReadObjectsResponse(
+            client, &server_rc, 6, &read_count, read_meta, read_lens,
+            sizeof(read_data), read_data[0]));
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_NOTFOUND);
+        WH_TEST_ASSERT_RETURN(read_count == 5);
+        for (i = 0; i < 5; i++) {
+            len = snprintf(expected, sizeof(expected), "Data:%d Counter:%d",
+                           40 + i, i);
+            WH_TEST_ASSERT_RETURN(read_meta[i].id == 40 + i);
+            WH_TEST_ASSERT_RETURN(read_lens[i] == len);
+            WH_TEST_ASSERT_RETURN(
+                0 == memcmp(read_data[0] + used, expected, len));
+            used += read_lens[i];
+        }
+
+        for (i = 0; i < 6; i++) {
+            read_bufs[i]  = read_data[i];
+            read_sizes[i] = sizeof(read_data[i]);
+        }
+        /* One byte short for the last object stops the read there */
+        read_sizes[4] = read_meta[4].len - 1;
+        memset(read_meta, 0, sizeof(read_meta));
+        WH_TEST_RETURN_ON_FAIL(wh_Client_NvmReadObjectsDmaRequest(
+            client, 5, read_ids, read_meta, read_bufs, read_sizes));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        WH_TEST_RETURN_ON_FAIL(wh_Client_NvmReadObjectsDmaResponse(
+            client, &server_rc, &read_count));
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_NOSPACE);
+        WH_TEST_ASSERT_RETURN(read_count == 4);
+        WH_TEST_ASSERT_RETURN(read_meta[4].len == read_sizes[4] + 1);
+        for (i = 0; i < 4; i++) {
+            len = snprintf(expected, sizeof(expected), "Data:%d Counter:%d",
+                           40 + i, i);
+            WH_TEST_ASSERT_RETURN(read_meta[i].id == 40 + i);
+            WH_TEST_ASSERT_RETURN(read_meta[i].len == len);
+            WH_TEST_ASSERT_RETURN(0 == memcmp(read_data[i], expected, len));
+        }
+    }
+
     do {
         WH_TEST_RETURN_ON_FAIL(
             wh_Client_NvmListRequest(client, list_access, list_flags, list_id));
@@ -966,14 +2095,53 @@ int whTest_ClientServerSequential(void)
            (int)reclaim_objects);
 #endif
     WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
-    WH_TEST_ASSERT_RETURN(avail_objects == NF_OBJECT_COUNT);
+    /* Destroyed objects are reclaimable until the next compaction */
+    WH_TEST_ASSERT_RETURN(avail_objects + reclaim_objects == NF_OBJECT_COUNT);
+
+    /* Test batched requests */
+    WH_TEST_RETURN_ON_FAIL(_testBatch(server, client));
+
+    /* Test the client NVM metadata cache */
+    WH_TEST_RETURN_ON_FAIL(_testNvmCache(server, client));
+
+    /* Test monotonic counters */
+    WH_TEST_RETURN_ON_FAIL(_testCounters(server, client));
+
+#if WOLFHSM_SERVER_MAX_HANDLERS > 0
+    /* Test registered message handlers */
+    WH_TEST_RETURN_ON_FAIL(_testHandlers(server, client));
+#endif
 
     /* Test custom registered callbacks */
     WH_TEST_RETURN_ON_FAIL(_testCallbacks(server, client));
 
+#if WOLFHSM_SERVER_MAX_CUSTOM_CBS > 0
+    /* Test raw custom callbacks */
+    WH_TEST_RETURN_ON_FAIL(_testCallbacksRaw(server, client));
+#endif
+
+    /* Test scatter-gather NVM DMA, before _testDma leaves an allowlist */
+    WH_TEST_RETURN_ON_FAIL(_testNvmDmaSg(server, client));
+
+    /* Test persistent DMA mappings */
+    WH_TEST_RETURN_ON_FAIL(_testDmaMap(server, client));
+
     /* Test DMA callbacks and address allowlisting */
     WH_TEST_RETURN_ON_FAIL(_testDma(server, client));
 
+    /* Test streamed NVM objects */
+    WH_TEST_RETURN_ON_FAIL(_testNvmStream(server, client));
+
+#ifdef WOLFHSM_SERVER_STATS
+    /* Test request statistics */
+    WH_TEST_RETURN_ON_FAIL(_testStats(server, client));
+#endif
+
+#if WOLFHSM_SERVER_MAX_JOBS > 0
+    /* Test long-running jobs */
+    WH_TEST_RETURN_ON_FAIL(_testJobs(server, client));
+#endif
+
     /* Check that we are still connected */
     WH_TEST_RETURN_ON_FAIL(wh_Server_GetConnected(server, &server_connected));
     WH_TEST_ASSERT_RETURN(server_connected == WH_COMM_CONNECTED);
@@ -1139,6 +2307,41 @@ int whTest_ClientCfg(whClientConfig* clientCfg)
         WH_TEST_ASSERT_RETURN(0 == memcmp(send_buffer, recv_buffer, len));
     }
 
+    {
+        /* Page through the metadata two records at a time */
+        whNvmMetadata list_meta[2];
+        uint32_t      list_cursor = 0;
+        whNvmId       list_got    = 0;
+        whNvmId       list_total  = 0;
+        whNvmId       i           = 0;
+        char          expected[WOLFHSM_NVM_LABEL_LEN];
+
+        do {
+            WH_TEST_RETURN_ON_FAIL(ret = wh_Client_NvmListMetadata(
+                client, WOLFHSM_NVM_ACCESS_ANY, WOLFHSM_NVM_FLAGS_ANY,
+                &list_cursor, 2, &server_rc, &list_got, list_meta));
+            WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+            for (i = 0; i < list_got; i++) {
+                snprintf(expected, sizeof(expected), "Label:%d",
+                         20 + list_total);
+                WH_TEST_ASSERT_RETURN(list_meta[i].id == 20 + list_total);
+                WH_TEST_ASSERT_RETURN(0 == strncmp((char*)list_meta[i].label,
+                                                   expected,
+                                                   WH_MESSAGE_NVM_LIST_LABEL_LEN));
+                list_total++;
+            }
+        } while (list_got == 2);
+        WH_TEST_ASSERT_RETURN(list_total == 5);
+
+        /* Nothing was written with this access, so nothing matches */
+        list_cursor = 0;
+        WH_TEST_RETURN_ON_FAIL(ret = wh_Client_NvmListMetadata(
+            client, 0x1234, WOLFHSM_NVM_FLAGS_ANY, &list_cursor, 2,
+            &server_rc, &list_got, list_meta));
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+        WH_TEST_ASSERT_RETURN(list_got == 0);
+    }
+
     whNvmAccess list_access = WOLFHSM_NVM_ACCESS_ANY;
     whNvmFlags  list_flags  = WOLFHSM_NVM_FLAGS_ANY;
     whNvmId     list_id     = 0;
@@ -1185,7 +2388,7 @@ int whTest_ClientCfg(whClientConfig* clientCfg)
     WH_TEST_RETURN_ON_FAIL(wh_Client_NvmGetAvailable(
         client, &server_rc, &avail_size, &avail_objects, &reclaim_size,
         &reclaim_objects));
-    WH_TEST_ASSERT_RETURN(avail_objects == WOLFHSM_NUM_NVMOBJECTS);
+    WH_TEST_ASSERT_RETURN(avail_objects + reclaim_objects == WOLFHSM_NUM_NVMOBJECTS);
 
     for (counter = 0; counter < 5; counter++) {
         whNvmMetadata meta = {
@@ -1293,6 +2496,10 @@ int whTest_ClientCfg(whClientConfig* clientCfg)
         }
     } while (list_count > 0);
 
+    /* Compact away the destroyed objects */
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmDestroyObjects(client, 0, NULL, 0,
+                NULL, &server_rc));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
 
     WH_TEST_RETURN_ON_FAIL(ret = wh_Client_NvmCleanup(client, &server_rc));
 #if defined(WH_CFG_TEST_VERBOSE)
@@ -1349,6 +2556,226 @@ int whTest_ServerCfgLoop(whServerConfig* serverCfg)
 }
 
 
+#if WOLFHSM_SERVER_MAX_COMMS >= 3
+#define MULTI_COMM_COUNT 3
+static int whTest_ClientServerMultiComm(void)
+{
+    /* One memory transport per client */
+    uint8_t              req[MULTI_COMM_COUNT][BUFFER_SIZE]  = {{0}};
+    uint8_t              resp[MULTI_COMM_COUNT][BUFFER_SIZE] = {{0}};
+    whTransportMemConfig tmcf[MULTI_COMM_COUNT]              = {{0}};
+
+    whTransportClientCb         tccb[1] = {WH_TRANSPORT_MEM_CLIENT_CB};
+    whTransportMemClientContext tmcc[MULTI_COMM_COUNT] = {{0}};
+    whCommClientConfig          cc_conf[MULTI_COMM_COUNT] = {{0}};
+    whClientConfig              c_conf[MULTI_COMM_COUNT] = {{0}};
+    whClientContext             client[MULTI_COMM_COUNT];
+
+    whTransportServerCb         tscb[1] = {WH_TRANSPORT_MEM_SERVER_CB};
+    whTransportMemServerContext tmsc[MULTI_COMM_COUNT] = {{0}};
+    whCommServerConfig          cs_conf[MULTI_COMM_COUNT] = {{0}};
+    /* Client 2 is polled ahead of clients 0 and 1 */
+    const uint8_t               priority[MULTI_COMM_COUNT] = {0, 0, 1};
+
+    /* RamSim Flash state and configuration */
+    whFlashRamsimCtx fc[1]      = {0};
+    whFlashRamsimCfg fc_conf[1] = {{
+        .size       = FLASH_RAM_SIZE,
+        .sectorSize = FLASH_RAM_SIZE/2,
+        .pageSize   = 8,
+        .erasedByte = (uint8_t)0,
+    }};
+    const whFlashCb  fcb[1]     = {WH_FLASH_RAMSIM_CB};
+
+    whNvmFlashConfig  nf_conf[1] = {{
+        .cb      = fcb,
+        .context = fc,
+        .config  = fc_conf,
+    }};
+    whNvmFlashContext nfc[1]     = {0};
+    whNvmCb           nfcb[1]    = {WH_NVM_FLASH_CB};
+
+    whNvmConfig  n_conf[1] = {{
+        .cb      = nfcb,
+        .context = nfc,
+        .config  = nf_conf,
+    }};
+    whNvmContext nvm[1]    = {{0}};
+
+#ifndef WOLFHSM_NO_CRYPTO
+    crypto_context crypto[1] = {{
+        .devId = INVALID_DEVID,
+    }};
+#endif
+
+    whServerConfig  s_conf[1] = {{
+        .comm_config   = cs_conf,
+        .comm_priority = priority,
+        .comm_count    = MULTI_COMM_COUNT,
+        .nvm           = nvm,
+#ifndef WOLFHSM_NO_CRYPTO
+        .crypto        = crypto,
+#endif
+    }};
+    whServerContext server[1] = {0};
+
+    uint32_t        client_id = 0;
+    uint32_t        server_id = 0;
+    whCommConnected connected = WH_COMM_DISCONNECTED;
+    const whNvmId   stream_id = 61;
+    uint8_t         stream[]  = "Streamed object data";
+    int32_t         server_rc = 0;
+    int             i         = 0;
+
+    memset(client, 0, sizeof(client));
+    for (i = 0; i < MULTI_COMM_COUNT; i++) {
+        tmcf[i].req       = (whTransportMemCsr*)req[i];
+        tmcf[i].req_size  = sizeof(req[i]);
+        tmcf[i].resp      = (whTransportMemCsr*)resp[i];
+        tmcf[i].resp_size = sizeof(resp[i]);
+
+        cc_conf[i].transport_cb      = tccb;
+        cc_conf[i].transport_context = (void*)&tmcc[i];
+        cc_conf[i].transport_config  = (void*)&tmcf[i];
+        cc_conf[i].client_id         = 1 + i;
+        c_conf[i].comm               = &cc_conf[i];
+
+        cs_conf[i].transport_cb      = tscb;
+        cs_conf[i].transport_context = (void*)&tmsc[i];
+        cs_conf[i].transport_config  = (void*)&tmcf[i];
+        cs_conf[i].server_id         = 124;
+    }
+
+#ifndef WOLFHSM_NO_CRYPTO
+    WH_TEST_RETURN_ON_FAIL(wolfCrypt_Init());
+    WH_TEST_RETURN_ON_FAIL(wc_InitRng_ex(crypto->rng, NULL, crypto->devId));
+#endif
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_Init(nvm, n_conf));
+
+    WH_TEST_RETURN_ON_FAIL(wh_Server_Init(server, s_conf));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_SetConnected(server, WH_COMM_CONNECTED));
+    for (i = 0; i < MULTI_COMM_COUNT; i++) {
+        WH_TEST_RETURN_ON_FAIL(wh_Client_Init(&client[i], &c_conf[i]));
+    }
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOTREADY ==
+                          wh_Server_HandleRequestMessage(server));
+
+    /* Each request is answered by the endpoint it arrived on, highest
+     * priority first */
+    for (i = 0; i < MULTI_COMM_COUNT; i++) {
+        WH_TEST_RETURN_ON_FAIL(wh_Client_CommInitRequest(&client[i]));
+    }
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOTREADY ==
+            wh_Client_CommInitResponse(&client[0], &client_id, &server_id));
+    WH_TEST_RETURN_ON_FAIL(
+            wh_Client_CommInitResponse(&client[2], &client_id, &server_id));
+    WH_TEST_ASSERT_RETURN(client_id == 3);
+
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(
+            wh_Client_CommInitResponse(&client[0], &client_id, &server_id));
+    WH_TEST_ASSERT_RETURN(client_id == 1);
+    WH_TEST_RETURN_ON_FAIL(
+            wh_Client_CommInitResponse(&client[1], &client_id, &server_id));
+    WH_TEST_ASSERT_RETURN(client_id == 2);
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOTREADY ==
+                          wh_Server_HandleRequestMessage(server));
+
+    /* Equal priorities take turns even when the first is always busy */
+    WH_TEST_RETURN_ON_FAIL(wh_Client_CommInitRequest(&client[0]));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_CommInitRequest(&client[1]));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(
+            wh_Client_CommInitResponse(&client[0], &client_id, &server_id));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_CommInitRequest(&client[0]));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(
+            wh_Client_CommInitResponse(&client[1], &client_id, &server_id));
+    WH_TEST_ASSERT_RETURN(client_id == 2);
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(
+            wh_Client_CommInitResponse(&client[0], &client_id, &server_id));
+    WH_TEST_ASSERT_RETURN(client_id == 1);
+
+    /* Client 1 opens an NVM stream that blocks the others */
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmAddObjectBeginRequest(&client[1],
+            stream_id, WOLFHSM_NVM_ACCESS_ANY, WOLFHSM_NVM_FLAGS_NONE,
+            0, NULL, sizeof(stream)));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(
+            wh_Client_NvmAddObjectBeginResponse(&client[1], &server_rc));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmAddObjectBeginRequest(&client[0],
+            stream_id, WOLFHSM_NVM_ACCESS_ANY, WOLFHSM_NVM_FLAGS_NONE,
+            0, NULL, sizeof(stream)));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(
+            wh_Client_NvmAddObjectBeginResponse(&client[0], &server_rc));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_NOTREADY);
+
+    /* Closing one client leaves the others connected and served */
+    WH_TEST_RETURN_ON_FAIL(wh_Client_CommCloseRequest(&client[1]));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_CommCloseResponse(&client[1]));
+    /* Client 2 sorted ahead, so client 1 is served by the last endpoint */
+    WH_TEST_ASSERT_RETURN(server->endpoint[0].connected == WH_COMM_CONNECTED);
+    WH_TEST_ASSERT_RETURN(server->endpoint[1].connected == WH_COMM_CONNECTED);
+    WH_TEST_ASSERT_RETURN(server->endpoint[2].connected ==
+                          WH_COMM_DISCONNECTED);
+    WH_TEST_RETURN_ON_FAIL(wh_Server_GetConnected(server, &connected));
+    WH_TEST_ASSERT_RETURN(connected == WH_COMM_CONNECTED);
+
+    WH_TEST_RETURN_ON_FAIL(wh_Client_CommInitRequest(&client[1]));
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOTREADY ==
+                          wh_Server_HandleRequestMessage(server));
+    for (i = 0; i < MULTI_COMM_COUNT; i += 2) {
+        WH_TEST_RETURN_ON_FAIL(wh_Client_CommInitRequest(&client[i]));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        WH_TEST_RETURN_ON_FAIL(
+                wh_Client_CommInitResponse(&client[i], &client_id, &server_id));
+        WH_TEST_ASSERT_RETURN(client_id == 1 + i);
+    }
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOTREADY ==
+            wh_Client_CommInitResponse(&client[1], &client_id, &server_id));
+
+    /* The closed client's stream was abandoned, so client 0 can write */
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmAddObjectBeginRequest(&client[0],
+            stream_id, WOLFHSM_NVM_ACCESS_ANY, WOLFHSM_NVM_FLAGS_NONE,
+            0, NULL, sizeof(stream)));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(
+            wh_Client_NvmAddObjectBeginResponse(&client[0], &server_rc));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmAddObjectWriteRequest(&client[0],
+            0, sizeof(stream), stream));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(
+            wh_Client_NvmAddObjectWriteResponse(&client[0], &server_rc));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmAddObjectFinishRequest(&client[0], 1));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(
+            wh_Client_NvmAddObjectFinishResponse(&client[0], &server_rc));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+    WH_TEST_ASSERT_RETURN(server->nvm_stream_owner == 0);
+
+    for (i = 0; i < MULTI_COMM_COUNT; i++) {
+        WH_TEST_RETURN_ON_FAIL(wh_Client_Cleanup(&client[i]));
+    }
+    WH_TEST_RETURN_ON_FAIL(wh_Server_Cleanup(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_Cleanup(nvm));
+
+#ifndef WOLFHSM_NO_CRYPTO
+    wc_FreeRng(crypto->rng);
+    wolfCrypt_Cleanup();
+#endif
+
+    return WH_ERROR_OK;
+}
+#endif /* WOLFHSM_SERVER_MAX_COMMS >= 3 */
+
 #if defined(WH_CFG_TEST_POSIX)
 static void* _whClientTask(void *cf)
 {
@@ -1388,7 +2815,7 @@ static void _whClientServerThreadTest(whClientConfig* c_conf,
     }
 }
 
-static int wh_ClientServer_MemThreadTest(void)
+static int wh_ClientServer_MemThreadTest(uint8_t in_place)
 {
     uint8_t req[BUFFER_SIZE] = {0};
     uint8_t resp[BUFFER_SIZE] = {0};
@@ -1398,6 +2825,7 @@ static int wh_ClientServer_MemThreadTest(void)
         .req_size  = sizeof(req),
         .resp      = (whTransportMemCsr*)resp,
         .resp_size = sizeof(resp),
+        .in_place  = in_place,
     }};
     /* Client configuration/contexts */
     whTransportClientCb         tccb[1]   = {WH_TRANSPORT_MEM_CLIENT_CB};
@@ -1479,6 +2907,196 @@ static int wh_ClientServer_MemThreadTest(void)
 
     return WH_ERROR_OK;
 }
+
+#define POOL_WORKER_COUNT 2
+
+typedef struct {
+    whClientConfig* config;
+    whNvmId base_id;
+    uint8_t padding[2];
+    int rc;
+} whTestPoolClient;
+
+/* Each client adds, reads back and destroys its own NVM objects while the
+ * other client does the same through another worker */
+static void* _whPoolClientTask(void* arg)
+{
+    whTestPoolClient* task = (whTestPoolClient*)arg;
+    whClientContext client[1] = {0};
+    uint8_t send_buffer[64] = {0};
+    uint8_t recv_buffer[64] = {0};
+    whNvmSize recv_len = 0;
+    int32_t server_rc = 0;
+    whNvmId id = 0;
+    int counter = 0;
+    int rc = 0;
+
+    rc = wh_Client_Init(client, task->config);
+    for (counter = 0; (rc == 0) && (counter < REPEAT_COUNT); counter++) {
+        id = task->base_id + counter;
+        memset(send_buffer, (int)id, sizeof(send_buffer));
+        rc = wh_Client_NvmAddObject(client, id, 0, 0, 0, NULL,
+                sizeof(send_buffer), send_buffer, &server_rc);
+        if ((rc == 0) && (server_rc == 0)) {
+            rc = wh_Client_NvmRead(client, id, 0, sizeof(recv_buffer),
+                    &server_rc, &recv_len, recv_buffer);
+        }
+        if (    (rc == 0) &&
+                ((server_rc != 0) ||
+                 (recv_len != sizeof(recv_buffer)) ||
+                 (memcmp(send_buffer, recv_buffer, recv_len) != 0))) {
+            rc = WH_ERROR_ABORTED;
+        }
+        if (rc == 0) {
+            rc = wh_Client_NvmDestroyObjects(client, 1, &id, 0, NULL,
+                    &server_rc);
+        }
+        if ((rc == 0) && (server_rc != 0)) {
+            rc = server_rc;
+        }
+    }
+    (void)wh_Client_Cleanup(client);
+    task->rc = rc;
+    return NULL;
+}
+
+static int wh_ClientServer_PoolThreadTest(void)
+{
+    uint8_t req[POOL_WORKER_COUNT][BUFFER_SIZE]  = {{0}};
+    uint8_t resp[POOL_WORKER_COUNT][BUFFER_SIZE] = {{0}};
+    whTransportMemConfig tmcf[POOL_WORKER_COUNT] = {{0}};
+
+    whTransportClientCb         tccb[1] = {WH_TRANSPORT_MEM_CLIENT_CB};
+    whTransportMemClientContext tmcc[POOL_WORKER_COUNT] = {{0}};
+    whCommClientConfig          cc_conf[POOL_WORKER_COUNT] = {{0}};
+    whClientConfig              c_conf[POOL_WORKER_COUNT] = {{0}};
+    whTestPoolClient            task[POOL_WORKER_COUNT];
+    pthread_t                   cthread[POOL_WORKER_COUNT];
+    int                         started[POOL_WORKER_COUNT] = {0};
+
+    whTransportServerCb         tscb[1] = {WH_TRANSPORT_MEM_SERVER_CB};
+    whTransportMemServerContext tmsc[POOL_WORKER_COUNT] = {{0}};
+    whCommServerConfig          cs_conf[POOL_WORKER_COUNT] = {{0}};
+
+    /* RamSim Flash state and configuration */
+    whFlashRamsimCtx fc[1] = {0};
+    whFlashRamsimCfg fc_conf[1] = {{
+        .size       = FLASH_RAM_SIZE,
+        .sectorSize = FLASH_RAM_SIZE/2,
+        .pageSize   = 8,
+        .erasedByte = (uint8_t)0,
+    }};
+    const whFlashCb  fcb[1]          = {WH_FLASH_RAMSIM_CB};
+
+    whNvmFlashConfig nf_conf[1] = {{
+        .cb      = fcb,
+        .context = fc,
+        .config  = fc_conf,
+    }};
+    whNvmFlashContext nfc[1] = {0};
+    whNvmCb nfcb[1] = {WH_NVM_FLASH_CB};
+
+    /* NVM is shared by every worker behind the pool lock */
+    static posixServerPool pool[1];
+    whNvmLockCb nlcb[1] = {PSP_NVM_LOCK_CB};
+    whNvmConfig n_conf[1] = {{
+            .cb = nfcb,
+            .context = nfc,
+            .config = nf_conf,
+            .lock_cb = nlcb,
+            .lock_context = pool,
+    }};
+    whNvmContext nvm[1] = {{0}};
+
+#ifndef WOLFHSM_NO_CRYPTO
+    /* Each worker owns a crypto context */
+    crypto_context crypto[POOL_WORKER_COUNT] = {{
+            .devId = INVALID_DEVID,
+    }};
+#endif
+
+    whServerConfig s_conf[POOL_WORKER_COUNT];
+    posixServerPoolConfig psp_conf[1] = {{
+            .server_config = s_conf,
+            .worker_count  = POOL_WORKER_COUNT,
+    }};
+    int ret = 0;
+    int i = 0;
+
+    memset(s_conf, 0, sizeof(s_conf));
+    for (i = 0; i < POOL_WORKER_COUNT; i++) {
+        tmcf[i].req       = (whTransportMemCsr*)req[i];
+        tmcf[i].req_size  = sizeof(req[i]);
+        tmcf[i].resp      = (whTransportMemCsr*)resp[i];
+        tmcf[i].resp_size = sizeof(resp[i]);
+
+        cc_conf[i].transport_cb      = tccb;
+        cc_conf[i].transport_context = (void*)&tmcc[i];
+        cc_conf[i].transport_config  = (void*)&tmcf[i];
+        cc_conf[i].client_id         = 1 + i;
+        c_conf[i].comm               = &cc_conf[i];
+
+        cs_conf[i].transport_cb      = tscb;
+        cs_conf[i].transport_context = (void*)&tmsc[i];
+        cs_conf[i].transport_config  = (void*)&tmcf[i];
+        cs_conf[i].server_id         = 124;
+
+        s_conf[i].comm_config = &cs_conf[i];
+        s_conf[i].nvm         = nvm;
+#ifndef WOLFHSM_NO_CRYPTO
+        crypto[i].devId       = INVALID_DEVID;
+        s_conf[i].crypto      = &crypto[i];
+#endif
+    }
+
+    WH_TEST_RETURN_ON_FAIL(posixServerPool_Init(pool));
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_Init(nvm, n_conf));
+#ifndef WOLFHSM_NO_CRYPTO
+    WH_TEST_RETURN_ON_FAIL(wolfCrypt_Init());
+    for (i = 0; i < POOL_WORKER_COUNT; i++) {
+        WH_TEST_RETURN_ON_FAIL(wc_InitRng_ex(crypto[i].rng, NULL,
+                crypto[i].devId));
+    }
+#endif
+    WH_TEST_RETURN_ON_FAIL(posixServerPool_Start(pool, psp_conf));
+
+    for (i = 0; i < POOL_WORKER_COUNT; i++) {
+        task[i].config  = &c_conf[i];
+        task[i].base_id = 100 + (i * REPEAT_COUNT);
+        task[i].rc      = WH_ERROR_NOTREADY;
+        if (pthread_create(&cthread[i], NULL, _whPoolClientTask,
+                &task[i]) == 0) {
+            started[i] = 1;
+        } else {
+            task[i].rc = WH_ERROR_ABORTED;
+        }
+    }
+    for (i = 0; i < POOL_WORKER_COUNT; i++) {
+        if (started[i] != 0) {
+            (void)pthread_join(cthread[i], NULL);
+        }
+        if ((ret == 0) && (task[i].rc != 0)) {
+            WH_ERROR_PRINT("[client %d] pool test failed rc=%d\n", i,
+                    task[i].rc);
+            ret = task[i].rc;
+        }
+    }
+
+    if (posixServerPool_Stop(pool) != 0) {
+        ret = WH_ERROR_ABORTED;
+    }
+    WH_TEST_RETURN_ON_FAIL(posixServerPool_Cleanup(pool));
+    wh_Nvm_Cleanup(nvm);
+
+#ifndef WOLFHSM_NO_CRYPTO
+    for (i = 0; i < POOL_WORKER_COUNT; i++) {
+        wc_FreeRng(crypto[i].rng);
+    }
+    wolfCrypt_Cleanup();
+#endif
+
+    return ret;
+}
 #endif /* WH_CFG_TEST_POSIX */
 
 
@@ -1488,9 +3106,20 @@ int whTest_ClientServer(void)
     printf("Testing client/server sequential: mem...\n");
     WH_TEST_ASSERT(0 == whTest_ClientServerSequential());
 
+#if WOLFHSM_SERVER_MAX_COMMS >= 3
+    printf("Testing client/server multi-endpoint: mem...\n");
+    WH_TEST_ASSERT(0 == whTest_ClientServerMultiComm());
+#endif
+
 #if defined(WH_CFG_TEST_POSIX)
     printf("Testing client/server: (pthread) mem...\n");
-    WH_TEST_ASSERT(0 == wh_ClientServer_MemThreadTest());
+    WH_TEST_ASSERT(0 == wh_ClientServer_MemThreadTest(0));
+
+    printf("Testing client/server: (pthread) in-place mem...\n");
+    WH_TEST_ASSERT(0 == wh_ClientServer_MemThreadTest(1));
+
+    printf("Testing client/server: (pthread) worker pool...\n");
+    WH_TEST_ASSERT(0 == wh_ClientServer_PoolThreadTest());
 
 
 #endif /* defined(WH_CFG_TEST_POSIX) */
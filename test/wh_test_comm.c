@@ -29,6 +29,7 @@
 #include "wolfhsm/wh_error.h"
 #include "wolfhsm/wh_comm.h"
 #include "wolfhsm/wh_transport_mem.h"
+#include "wolfhsm/wh_transport_memring.h"
 #include "wolfhsm/wh_server.h"
 #include "wolfhsm/wh_client.h"
 
@@ -36,18 +37,37 @@
 #include <pthread.h> /* For pthread_create/cancel/join/_t */
 #include <unistd.h>  /* For sleep */
 #include "port/posix/posix_transport_tcp.h"
+#include "port/posix/posix_transport_mem_futex.h"
+#include "port/posix/posix_transport_unix.h"
+#include "port/posix/posix_transport_shm.h"
 #endif
 
 
-#define BUFFER_SIZE 4096
+/* Room for a request and response of the largest packet size */
+#define BUFFER_SIZE (2 * WH_COMM_MTU > 4096 ? 2 * WH_COMM_MTU : 4096)
 #define REQ_SIZE 32
 #define RESP_SIZE 64
 #define REPEAT_COUNT 10
 #define ONE_MS 1000
+#define RING_SLOTS 4
+
+#ifdef WOLFHSM_COMM_STATS
+/* Stand-in clock that advances once per sample */
+static uint64_t _CommTestTime(void* context)
+{
+    uint64_t* now = (uint64_t*)context;
+    return ++(*now);
+}
+#endif
 
 int whTest_CommMem(void)
 {
     int ret = 0;
+#ifdef WOLFHSM_COMM_STATS
+    uint64_t    now = 0;
+    whCommStats c_stats[1];
+    whCommStats s_stats[1];
+#endif
 
     /* Transport memory configuration */
     uint8_t              req[BUFFER_SIZE] = {0};
@@ -68,6 +88,10 @@ int whTest_CommMem(void)
                  .transport_context = (void*)tmcc,
                  .transport_config  = (void*)tmcf,
                  .client_id         = 123,
+#ifdef WOLFHSM_COMM_STATS
+                 .time_cb           = _CommTestTime,
+                 .time_context      = (void*)&now,
+#endif
     }};
     whCommClient                client[1] = {0};
 
@@ -175,12 +199,709 @@ int whTest_CommMem(void)
 #endif
     }
 
+#ifdef WOLFHSM_COMM_STATS
+    WH_TEST_RETURN_ON_FAIL(wh_CommClient_StatsGet(client, c_stats));
+    WH_TEST_RETURN_ON_FAIL(wh_CommServer_StatsGet(server, s_stats));
+    WH_TEST_ASSERT_RETURN(c_stats->tx.packets == REPEAT_COUNT);
+    WH_TEST_ASSERT_RETURN(c_stats->rx.packets == REPEAT_COUNT);
+    WH_TEST_ASSERT_RETURN(s_stats->tx.packets == REPEAT_COUNT);
+    WH_TEST_ASSERT_RETURN(s_stats->rx.packets == REPEAT_COUNT);
+    WH_TEST_ASSERT_RETURN(c_stats->tx.bytes == s_stats->rx.bytes);
+    WH_TEST_ASSERT_RETURN(s_stats->tx.bytes == c_stats->rx.bytes);
+    WH_TEST_ASSERT_RETURN(c_stats->tx.bytes >=
+            REPEAT_COUNT * sizeof(whCommHeader));
+    /* The first response was polled once before it was sent */
+    WH_TEST_ASSERT_RETURN(c_stats->rx.notready == 1);
+    WH_TEST_ASSERT_RETURN(c_stats->rx.spin_max == 1);
+    WH_TEST_ASSERT_RETURN(c_stats->rx.spin_time_max != 0);
+    WH_TEST_ASSERT_RETURN(s_stats->rx.notready == 1);
+    WH_TEST_ASSERT_RETURN(s_stats->rx.spin_time_max == 0);
+    WH_TEST_ASSERT_RETURN(c_stats->seq_gaps == 0);
+    WH_TEST_ASSERT_RETURN(s_stats->seq_gaps == 0);
+
+    /* Skip a request seq, as if a request was lost */
+    client->seq++;
+    WH_TEST_RETURN_ON_FAIL(
+        wh_CommClient_SendRequest(client, tx_req_flags, tx_req_type,
+            &tx_req_seq, tx_req_len, tx_req));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_CommServer_RecvRequest(server, &rx_req_flags, &rx_req_type,
+                                  &rx_req_seq, &rx_req_len, rx_req));
+    WH_TEST_RETURN_ON_FAIL(wh_CommServer_StatsGet(server, s_stats));
+    WH_TEST_ASSERT_RETURN(s_stats->rx.packets == REPEAT_COUNT + 1);
+    WH_TEST_ASSERT_RETURN(s_stats->seq_gaps == 1);
+    WH_TEST_RETURN_ON_FAIL(
+        wh_CommServer_SendResponse(server, rx_req_flags, rx_req_type,
+                                   rx_req_seq, tx_resp_len, tx_resp));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_CommClient_RecvResponse(client, &rx_resp_flags, &rx_resp_type,
+                                   &rx_resp_seq, &rx_resp_len, rx_resp));
+    WH_TEST_RETURN_ON_FAIL(wh_CommClient_StatsGet(client, c_stats));
+    WH_TEST_ASSERT_RETURN(c_stats->seq_gaps == 1);
+
+    WH_TEST_RETURN_ON_FAIL(wh_CommClient_StatsReset(client));
+    WH_TEST_RETURN_ON_FAIL(wh_CommServer_StatsReset(server));
+    WH_TEST_RETURN_ON_FAIL(wh_CommClient_StatsGet(client, c_stats));
+    WH_TEST_RETURN_ON_FAIL(wh_CommServer_StatsGet(server, s_stats));
+    WH_TEST_ASSERT_RETURN(c_stats->tx.packets == 0);
+    WH_TEST_ASSERT_RETURN(s_stats->rx.packets == 0);
+    WH_TEST_ASSERT_RETURN(s_stats->seq_gaps == 0);
+#endif /* WOLFHSM_COMM_STATS */
+
     WH_TEST_RETURN_ON_FAIL(wh_CommServer_Cleanup(server));
     WH_TEST_RETURN_ON_FAIL(wh_CommClient_Cleanup(client));
 
     return ret;
 }
 
+int whTest_CommMemInPlace(void)
+{
+    /* Transport memory configuration.  Response buffer only holds a CSR */
+    uint8_t              req[BUFFER_SIZE] = {0};
+    uint8_t              resp[sizeof(whTransportMemCsr)] = {0};
+    whTransportMemConfig tmcf[1] = {{
+        .req       = (whTransportMemCsr*)req,
+        .req_size  = sizeof(req),
+        .resp      = (whTransportMemCsr*)resp,
+        .resp_size = sizeof(resp),
+        .in_place  = 1,
+    }};
+
+    /* Client configuration/contexts */
+    whTransportClientCb         tccb[1]   = {WH_TRANSPORT_MEM_CLIENT_CB};
+    whTransportMemClientContext tmcc[1]   = {0};
+    whCommClientConfig          c_conf[1] = {{
+                 .transport_cb      = tccb,
+                 .transport_context = (void*)tmcc,
+                 .transport_config  = (void*)tmcf,
+                 .client_id         = 123,
+    }};
+    whCommClient                client[1] = {0};
+
+    /* Server configuration/contexts */
+    whTransportServerCb         tscb[1]   = {WH_TRANSPORT_MEM_SERVER_CB};
+    whTransportMemServerContext tmsc[1]   = {0};
+    whCommServerConfig          s_conf[1] = {{
+                 .transport_cb      = tscb,
+                 .transport_context = (void*)tmsc,
+                 .transport_config  = (void*)tmcf,
+                 .server_id         = 124,
+    }};
+    whCommServer                server[1] = {0};
+
+    uint8_t* shared   = req + sizeof(whTransportMemCsr) + WH_COMM_HEADER_LEN;
+    uint8_t* tx       = NULL;
+    uint8_t* rx       = NULL;
+    uint16_t rx_magic = 0;
+    uint16_t rx_kind  = 0;
+    uint16_t rx_seq   = 0;
+    uint16_t rx_len   = 0;
+    uint16_t tx_seq   = 0;
+    int      counter  = 0;
+
+    /* Request buffer must hold a full packet */
+    tmcf->req_size = WH_COMM_MTU;
+    WH_TEST_ASSERT_RETURN(WH_ERROR_BADARGS ==
+            wh_CommClient_Init(client, c_conf));
+    tmcf->req_size = sizeof(req);
+
+    WH_TEST_RETURN_ON_FAIL(wh_CommClient_Init(client, c_conf));
+    WH_TEST_RETURN_ON_FAIL(wh_CommServer_Init(server, s_conf, NULL, NULL));
+
+    /* Both sides work directly in the shared request region */
+    tx = wh_CommClient_GetDataPtr(client);
+    rx = wh_CommServer_GetDataPtr(server);
+    WH_TEST_ASSERT_RETURN(tx == shared);
+    WH_TEST_ASSERT_RETURN(rx == shared);
+
+    for (counter = 0; counter < REPEAT_COUNT; counter++) {
+        snprintf((char*)tx, REQ_SIZE, "Request:%u", counter);
+        WH_TEST_RETURN_ON_FAIL(wh_CommClient_SendRequest(client,
+                WH_COMM_MAGIC_NATIVE, counter, &tx_seq,
+                strlen((char*)tx) + 1, tx));
+
+        /* The in-flight packet must not be rewritten */
+        WH_TEST_ASSERT_RETURN(WH_ERROR_NOTREADY ==
+                wh_CommClient_SendRequest(client, WH_COMM_MAGIC_NATIVE, 0,
+                    NULL, 0, NULL));
+
+        WH_TEST_RETURN_ON_FAIL(wh_CommServer_RecvRequest(server, &rx_magic,
+                &rx_kind, &rx_seq, &rx_len, rx));
+        WH_TEST_ASSERT_RETURN(rx_kind == counter);
+        WH_TEST_ASSERT_RETURN(rx_seq == tx_seq);
+
+        /* Respond over the request */
+        memcpy(rx, "Response", 8);
+        WH_TEST_RETURN_ON_FAIL(wh_CommServer_SendResponse(server, rx_magic,
+                rx_kind, rx_seq, rx_len, rx));
+
+        WH_TEST_RETURN_ON_FAIL(wh_CommClient_RecvResponse(client, &rx_magic,
+                &rx_kind, &rx_seq, &rx_len, tx));
+        WH_TEST_ASSERT_RETURN(rx_seq == tx_seq);
+        WH_TEST_ASSERT_RETURN(0 == memcmp(tx, "Response", 8));
+    }
+
+    WH_TEST_RETURN_ON_FAIL(wh_CommServer_Cleanup(server));
+    WH_TEST_RETURN_ON_FAIL(wh_CommClient_Cleanup(client));
+
+    return 0;
+}
+
+int whTest_CommTranslate(void)
+{
+    /* Transport memory configuration */
+    uint8_t              req[BUFFER_SIZE] = {0};
+    uint8_t              resp[BUFFER_SIZE] = {0};
+    whTransportMemConfig tmcf[1] = {{
+        .req       = (whTransportMemCsr*)req,
+        .req_size  = sizeof(req),
+        .resp      = (whTransportMemCsr*)resp,
+        .resp_size = sizeof(resp),
+    }};
+
+    /* Client configuration/contexts */
+    whTransportClientCb         tccb[1]   = {WH_TRANSPORT_MEM_CLIENT_CB};
+    whTransportMemClientContext tmcc[1]   = {0};
+    whCommClientConfig          c_conf[1] = {{
+                 .transport_cb      = tccb,
+                 .transport_context = (void*)tmcc,
+                 .transport_config  = (void*)tmcf,
+                 .client_id         = 123,
+    }};
+    whCommClient                client[1] = {0};
+
+    /* Server configuration/contexts */
+    whTransportServerCb         tscb[1]   = {WH_TRANSPORT_MEM_SERVER_CB};
+    whTransportMemServerContext tmsc[1]   = {0};
+    whCommServerConfig          s_conf[1] = {{
+                 .transport_cb      = tscb,
+                 .transport_context = (void*)tmsc,
+                 .transport_config  = (void*)tmcf,
+                 .server_id         = 124,
+    }};
+    whCommServer                server[1] = {0};
+
+    uint8_t  data[REQ_SIZE] = {0};
+    uint16_t rx_magic       = 0;
+    uint16_t rx_kind        = 0;
+    uint16_t rx_seq         = 0;
+    uint16_t rx_len         = 0;
+    int      rc             = 0;
+
+    /* Native magic never changes a value */
+    WH_TEST_ASSERT_RETURN(0x1122u ==
+            wh_Translate16(WH_COMM_MAGIC_NATIVE, 0x1122u));
+    WH_TEST_ASSERT_RETURN(0x11223344ul ==
+            wh_Translate32(WH_COMM_MAGIC_NATIVE, 0x11223344ul));
+    WH_TEST_ASSERT_RETURN(0x1122334455667788ull ==
+            wh_Translate64(WH_COMM_MAGIC_NATIVE, 0x1122334455667788ull));
+
+#ifndef WOLFHSM_COMM_NATIVE
+    /* Swapped magic reverses the bytes */
+    WH_TEST_ASSERT_RETURN(0x2211u ==
+            wh_Translate16(WH_COMM_MAGIC_SWAP, 0x1122u));
+    WH_TEST_ASSERT_RETURN(0x44332211ul ==
+            wh_Translate32(WH_COMM_MAGIC_SWAP, 0x11223344ul));
+    WH_TEST_ASSERT_RETURN(0x8877665544332211ull ==
+            wh_Translate64(WH_COMM_MAGIC_SWAP, 0x1122334455667788ull));
+#endif
+
+    WH_TEST_RETURN_ON_FAIL(wh_CommClient_Init(client, c_conf));
+    WH_TEST_RETURN_ON_FAIL(wh_CommServer_Init(server, s_conf, NULL, NULL));
+
+    WH_TEST_RETURN_ON_FAIL(wh_CommClient_SendRequest(client,
+            WH_COMM_MAGIC_SWAP, 0x0102, NULL, sizeof(data), data));
+    rc = wh_CommServer_RecvRequest(server, &rx_magic, &rx_kind, &rx_seq,
+            &rx_len, data);
+#ifdef WOLFHSM_COMM_NATIVE
+    /* Native builds only talk to native peers */
+    WH_TEST_ASSERT_RETURN(rc == WH_ERROR_ABORTED);
+#else
+    WH_TEST_RETURN_ON_FAIL(rc);
+    WH_TEST_ASSERT_RETURN(rx_magic == WH_COMM_MAGIC_SWAP);
+    WH_TEST_ASSERT_RETURN(rx_kind == 0x0102);
+    WH_TEST_ASSERT_RETURN(rx_len == sizeof(data));
+#endif
+
+    WH_TEST_RETURN_ON_FAIL(wh_CommServer_Cleanup(server));
+    WH_TEST_RETURN_ON_FAIL(wh_CommClient_Cleanup(client));
+
+    return 0;
+}
+
+int whTest_CommMemRing(void)
+{
+    /* Transport memory configuration */
+    uint8_t                  req[BUFFER_SIZE]  = {0};
+    uint8_t                  resp[BUFFER_SIZE] = {0};
+    whTransportMemRingConfig tmrcf[1]          = {{
+                 .req        = req,
+                 .req_size   = sizeof(req),
+                 .resp       = resp,
+                 .resp_size  = sizeof(resp),
+                 .slot_count = RING_SLOTS,
+    }};
+
+    whTransportClientCb             tccb[1] = {WH_TRANSPORT_MEMRING_CLIENT_CB};
+    whTransportMemRingClientContext tmrcc[1] = {0};
+    whTransportServerCb             tscb[1] = {WH_TRANSPORT_MEMRING_SERVER_CB};
+    whTransportMemRingServerContext tmrsc[1] = {0};
+
+    whTransportMemRingConfig bad_cf[1] = {{
+                 .req        = req,
+                 .req_size   = sizeof(req),
+                 .resp       = resp,
+                 .resp_size  = sizeof(resp),
+                 .slot_count = 3,
+    }};
+
+    uint8_t  tx[REQ_SIZE] = {0};
+    uint8_t  rx[RESP_SIZE] = {0};
+    uint16_t rx_len = 0;
+    int      counter = 0;
+    int      round = 0;
+
+    /* Slot counts must be a power of 2 */
+    WH_TEST_ASSERT_RETURN(WH_ERROR_BADARGS ==
+            tccb->Init(tmrcc, bad_cf, NULL, NULL));
+
+    WH_TEST_RETURN_ON_FAIL(tccb->Init(tmrcc, tmrcf, NULL, NULL));
+    WH_TEST_RETURN_ON_FAIL(tscb->Init(tmrsc, tmrcf, NULL, NULL));
+
+    /* Nothing queued in either direction */
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOTREADY ==
+            tscb->Recv(tmrsc, &rx_len, rx));
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOTREADY ==
+            tccb->Recv(tmrcc, &rx_len, rx));
+
+    /* Run enough rounds to wrap the ring several times */
+    for (round = 0; round < REPEAT_COUNT; round++) {
+        /* Fill every slot before the server runs */
+        for (counter = 0; counter < RING_SLOTS; counter++) {
+            snprintf((char*)tx, sizeof(tx), "Request:%u:%u", round, counter);
+            WH_TEST_RETURN_ON_FAIL(tccb->Send(tmrcc,
+                    strlen((char*)tx) + 1, tx));
+        }
+        WH_TEST_ASSERT_RETURN(WH_ERROR_NOTREADY ==
+                tccb->Send(tmrcc, sizeof(tx), tx));
+
+        /* Server drains the ring in order */
+        for (counter = 0; counter < RING_SLOTS; counter++) {
+            WH_TEST_RETURN_ON_FAIL(tscb->Recv(tmrsc, &rx_len, rx));
+            snprintf((char*)tx, sizeof(tx), "Request:%u:%u", round, counter);
+            WH_TEST_ASSERT_RETURN(rx_len == strlen((char*)tx) + 1);
+            WH_TEST_ASSERT_RETURN(0 == memcmp(rx, tx, rx_len));
+            snprintf((char*)tx, sizeof(tx), "Response:%u:%u", round, counter);
+            WH_TEST_RETURN_ON_FAIL(tscb->Send(tmrsc,
+                    strlen((char*)tx) + 1, tx));
+        }
+        WH_TEST_ASSERT_RETURN(WH_ERROR_NOTREADY ==
+                tscb->Recv(tmrsc, &rx_len, rx));
+
+        /* Slots stay busy until the client reads the responses */
+        WH_TEST_ASSERT_RETURN(WH_ERROR_NOTREADY ==
+                tccb->Send(tmrcc, sizeof(tx), tx));
+
+        for (counter = 0; counter < RING_SLOTS; counter++) {
+            WH_TEST_RETURN_ON_FAIL(tccb->Recv(tmrcc, &rx_len, rx));
+            snprintf((char*)tx, sizeof(tx), "Response:%u:%u", round, counter);
+            WH_TEST_ASSERT_RETURN(rx_len == strlen((char*)tx) + 1);
+            WH_TEST_ASSERT_RETURN(0 == memcmp(rx, tx, rx_len));
+        }
+        WH_TEST_ASSERT_RETURN(WH_ERROR_NOTREADY ==
+                tccb->Recv(tmrcc, &rx_len, rx));
+    }
+
+    WH_TEST_RETURN_ON_FAIL(tscb->Cleanup(tmrsc));
+    WH_TEST_RETURN_ON_FAIL(tccb->Cleanup(tmrcc));
+
+    return 0;
+}
+
+int whTest_CommPipeline(void)
+{
+    /* Transport memory configuration */
+    uint8_t                  req[BUFFER_SIZE]  = {0};
+    uint8_t                  resp[BUFFER_SIZE] = {0};
+    whTransportMemRingConfig tmrcf[1]          = {{
+                 .req        = req,
+                 .req_size   = sizeof(req),
+                 .resp       = resp,
+                 .resp_size  = sizeof(resp),
+                 .slot_count = RING_SLOTS,
+    }};
+
+    /* Client configuration/contexts with a pipelining window */
+    whTransportClientCb             tccb[1]  = {WH_TRANSPORT_MEMRING_CLIENT_CB};
+    whTransportMemRingClientContext tmrcc[1] = {0};
+    whCommClientSlot                slots[RING_SLOTS];
+    whCommClientConfig              c_conf[1] = {{
+                     .transport_cb      = tccb,
+                     .transport_context = (void*)tmrcc,
+                     .transport_config  = (void*)tmrcf,
+                     .slots             = slots,
+                     .slot_count        = RING_SLOTS,
+                     .client_id         = 123,
+    }};
+    whCommClient                    client[1] = {0};
+
+    /* Server configuration/contexts */
+    whTransportServerCb             tscb[1]  = {WH_TRANSPORT_MEMRING_SERVER_CB};
+    whTransportMemRingServerContext tmrsc[1] = {0};
+    whCommServerConfig              s_conf[1] = {{
+                     .transport_cb      = tscb,
+                     .transport_context = (void*)tmrsc,
+                     .transport_config  = (void*)tmrcf,
+                     .server_id         = 124,
+    }};
+    whCommServer                    server[1] = {0};
+
+    uint8_t  tx[REQ_SIZE]  = {0};
+    uint8_t  rx[RESP_SIZE] = {0};
+    uint16_t seqs[RING_SLOTS];
+    uint16_t rx_magic = 0;
+    uint16_t rx_kind  = 0;
+    uint16_t rx_seq   = 0;
+    uint16_t rx_len   = 0;
+    int      counter  = 0;
+
+    WH_TEST_RETURN_ON_FAIL(wh_CommClient_Init(client, c_conf));
+    WH_TEST_RETURN_ON_FAIL(wh_CommServer_Init(server, s_conf, NULL, NULL));
+
+    /* Fill the window without waiting on any response */
+    for (counter = 0; counter < RING_SLOTS; counter++) {
+        snprintf((char*)tx, sizeof(tx), "Request:%u", counter);
+        WH_TEST_RETURN_ON_FAIL(wh_CommClient_SendRequest(client,
+                WH_COMM_MAGIC_NATIVE, counter, &seqs[counter],
+                strlen((char*)tx) + 1, tx));
+    }
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOTREADY ==
+            wh_CommClient_SendRequest(client, WH_COMM_MAGIC_NATIVE, 0, NULL,
+                sizeof(tx), tx));
+
+    /* Server echoes each request back in order */
+    for (counter = 0; counter < RING_SLOTS; counter++) {
+        WH_TEST_RETURN_ON_FAIL(wh_CommServer_RecvRequest(server, &rx_magic,
+                &rx_kind, &rx_seq, &rx_len, rx));
+        WH_TEST_ASSERT_RETURN(rx_seq == seqs[counter]);
+        WH_TEST_RETURN_ON_FAIL(wh_CommServer_SendResponse(server, rx_magic,
+                rx_kind, rx_seq, rx_len, rx));
+    }
+
+    /* Wait on the third response first.  Earlier ones are parked. */
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOTREADY ==
+            wh_CommClient_RecvResponseSeq(client, seqs[2], &rx_magic,
+                &rx_kind, &rx_len, rx));
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOTREADY ==
+            wh_CommClient_RecvResponseSeq(client, seqs[2], &rx_magic,
+                &rx_kind, &rx_len, rx));
+    WH_TEST_RETURN_ON_FAIL(wh_CommClient_RecvResponseSeq(client, seqs[2],
+            &rx_magic, &rx_kind, &rx_len, rx));
+    WH_TEST_ASSERT_RETURN(rx_kind == 2);
+    WH_TEST_ASSERT_RETURN(0 == strcmp((char*)rx, "Request:2"));
+
+    /* A slot was freed, so another request fits */
+    WH_TEST_RETURN_ON_FAIL(wh_CommClient_SendRequest(client,
+            WH_COMM_MAGIC_NATIVE, 0, &seqs[2], 0, NULL));
+
+    /* Parked responses come back oldest first */
+    for (counter = 0; counter < 2; counter++) {
+        WH_TEST_RETURN_ON_FAIL(wh_CommClient_RecvResponse(client, &rx_magic,
+                &rx_kind, &rx_seq, &rx_len, rx));
+        snprintf((char*)tx, sizeof(tx), "Request:%u", counter);
+        WH_TEST_ASSERT_RETURN(rx_seq == seqs[counter]);
+        WH_TEST_ASSERT_RETURN(0 == strcmp((char*)rx, (char*)tx));
+    }
+    WH_TEST_RETURN_ON_FAIL(wh_CommClient_RecvResponseSeq(client, seqs[3],
+            &rx_magic, &rx_kind, &rx_len, rx));
+    WH_TEST_ASSERT_RETURN(0 == strcmp((char*)rx, "Request:3"));
+
+    /* Only the late request is still in flight */
+    WH_TEST_ASSERT_RETURN(client->inflight == 1);
+    WH_TEST_ASSERT_RETURN(WH_ERROR_BADARGS ==
+            wh_CommClient_RecvResponseSeq(client, seqs[0], &rx_magic,
+                &rx_kind, &rx_len, rx));
+
+    WH_TEST_RETURN_ON_FAIL(wh_CommServer_Cleanup(server));
+    WH_TEST_RETURN_ON_FAIL(wh_CommClient_Cleanup(client));
+
+    return 0;
+}
+
+
+int whTest_CommGather(void)
+{
+    /* Transport memory configuration */
+    uint8_t              req[BUFFER_SIZE]  = {0};
+    uint8_t              resp[BUFFER_SIZE] = {0};
+    whTransportMemConfig tmcf[1]           = {{
+                  .req       = req,
+                  .req_size  = sizeof(req),
+                  .resp      = resp,
+                  .resp_size = sizeof(resp),
+    }};
+
+    /* Client configuration/contexts */
+    whTransportClientCb         tccb[1]   = {WH_TRANSPORT_MEM_CLIENT_CB};
+    whTransportMemClientContext tmcc[1]   = {0};
+    whCommClientConfig          c_conf[1] = {{
+                 .transport_cb      = tccb,
+                 .transport_context = (void*)tmcc,
+                 .transport_config  = (void*)tmcf,
+                 .client_id         = 123,
+    }};
+    whCommClient                client[1] = {0};
+
+    /* Server configuration/contexts */
+    whTransportServerCb         tscb[1]   = {WH_TRANSPORT_MEM_SERVER_CB};
+    whTransportMemServerContext tmsc[1]   = {0};
+    whCommServerConfig          s_conf[1] = {{
+                 .transport_cb      = tscb,
+                 .transport_context = (void*)tmsc,
+                 .transport_config  = (void*)tmcf,
+                 .server_id         = 124,
+    }};
+    whCommServer                server[1] = {0};
+
+    const char hdr[]     = "Header:";
+    const char payload[] = "Payload";
+    whCommIov  iov[3]    = {
+        {.data = hdr, .len = strlen(hdr)},
+        {.data = NULL, .len = 0},
+        {.data = payload, .len = sizeof(payload)},
+    };
+    whCommIov  big[2]    = {
+        {.data = req, .len = WH_COMM_DATA_LEN},
+        {.data = payload, .len = 1},
+    };
+    uint8_t  rx[RESP_SIZE] = {0};
+    uint16_t rx_magic      = 0;
+    uint16_t rx_kind       = 0;
+    uint16_t rx_seq        = 0;
+    uint16_t rx_len        = 0;
+    uint16_t tx_seq        = 0;
+    int      pass          = 0;
+
+    /* Gather in the transport, then through the comm client buffer */
+    for (pass = 0; pass < 2; pass++) {
+        if (pass == 1) {
+            tccb->SendV = NULL;
+        }
+        WH_TEST_RETURN_ON_FAIL(wh_CommClient_Init(client, c_conf));
+        WH_TEST_RETURN_ON_FAIL(wh_CommServer_Init(server, s_conf, NULL, NULL));
+
+        WH_TEST_ASSERT_RETURN(WH_ERROR_BADARGS ==
+                wh_CommClient_SendRequestV(client, WH_COMM_MAGIC_NATIVE, 0,
+                    NULL, 2, big));
+        /* A missing fragment with a length must not send a short message */
+        WH_TEST_ASSERT_RETURN(WH_ERROR_BADARGS ==
+                wh_CommClient_SendRequest(client, WH_COMM_MAGIC_NATIVE, 0,
+                    NULL, sizeof(payload), NULL));
+        WH_TEST_ASSERT_RETURN(WH_ERROR_BADARGS ==
+                tccb->Send(tmcc, sizeof(payload), NULL));
+        WH_TEST_RETURN_ON_FAIL(wh_CommClient_SendRequestV(client,
+                WH_COMM_MAGIC_NATIVE, 7, &tx_seq, 3, iov));
+
+        WH_TEST_RETURN_ON_FAIL(wh_CommServer_RecvRequest(server, &rx_magic,
+                &rx_kind, &rx_seq, &rx_len, rx));
+        WH_TEST_ASSERT_RETURN(rx_kind == 7);
+        WH_TEST_ASSERT_RETURN(rx_seq == tx_seq);
+        WH_TEST_ASSERT_RETURN(rx_len == strlen(hdr) + sizeof(payload));
+        WH_TEST_ASSERT_RETURN(0 == strcmp((char*)rx, "Header:Payload"));
+
+        WH_TEST_RETURN_ON_FAIL(wh_CommServer_Cleanup(server));
+        WH_TEST_RETURN_ON_FAIL(wh_CommClient_Cleanup(client));
+    }
+
+    return 0;
+}
+
+
+int whTest_CommFrag(void)
+{
+    /* Transport memory configuration */
+    uint8_t              req[BUFFER_SIZE]  = {0};
+    uint8_t              resp[BUFFER_SIZE] = {0};
+    whTransportMemConfig tmcf[1]           = {{
+                  .req       = req,
+                  .req_size  = sizeof(req),
+                  .resp      = resp,
+                  .resp_size = sizeof(resp),
+    }};
+
+    /* Client configuration/contexts */
+    whTransportClientCb         tccb[1]   = {WH_TRANSPORT_MEM_CLIENT_CB};
+    whTransportMemClientContext tmcc[1]   = {0};
+    whCommClientConfig          c_conf[1] = {{
+                 .transport_cb      = tccb,
+                 .transport_context = (void*)tmcc,
+                 .transport_config  = (void*)tmcf,
+                 .client_id         = 123,
+    }};
+    whCommClient                client[1] = {0};
+
+    /* Server configuration/contexts */
+    uint64_t                    frag[(2 * WH_COMM_DATA_LEN + 104) / 8] = {0};
+    whTransportServerCb         tscb[1]   = {WH_TRANSPORT_MEM_SERVER_CB};
+    whTransportMemServerContext tmsc[1]   = {0};
+    whCommServerConfig          s_conf[1] = {{
+                 .transport_cb      = tscb,
+                 .transport_context = (void*)tmsc,
+                 .transport_config  = (void*)tmcf,
+                 .frag_buffer       = (uint8_t*)frag,
+                 .frag_size         = sizeof(frag),
+                 .server_id         = 124,
+    }};
+    whCommServer                server[1] = {0};
+
+    uint8_t   tx[2 * WH_COMM_DATA_LEN + 100] = {0};
+    whCommIov iov[2]   = {
+        {.data = tx, .len = 10},
+        {.data = tx + 10, .len = sizeof(tx) - 10},
+    };
+    whCommIov over[2]  = {
+        {.data = tx, .len = sizeof(tx)},
+        {.data = tx, .len = WH_COMM_DATA_LEN},
+    };
+    uint8_t*  rx_data  = NULL;
+    uint16_t  rx_magic = 0;
+    uint16_t  rx_kind  = 0;
+    uint16_t  rx_seq   = 0;
+    uint16_t  rx_len   = 0;
+    uint16_t  tx_seq   = 0;
+    int       rc       = 0;
+    int       srv_rc   = 0;
+    int       frames   = 0;
+    size_t    i        = 0;
+
+    for (i = 0; i < sizeof(tx); i++) {
+        tx[i] = (uint8_t)i;
+    }
+
+    WH_TEST_RETURN_ON_FAIL(wh_CommClient_Init(client, c_conf));
+    WH_TEST_RETURN_ON_FAIL(wh_CommServer_Init(server, s_conf, NULL, NULL));
+
+    /* Small requests are sent as a single frame */
+    WH_TEST_RETURN_ON_FAIL(wh_CommClient_SendRequestFragV(client,
+            WH_COMM_MAGIC_NATIVE, 5, &tx_seq, 1, iov));
+    WH_TEST_RETURN_ON_FAIL(wh_CommServer_RecvRequestFrag(server, &rx_magic,
+            &rx_kind, &rx_seq, &rx_len, &rx_data));
+    WH_TEST_ASSERT_RETURN(rx_data == wh_CommServer_GetDataPtr(server));
+    WH_TEST_ASSERT_RETURN(rx_len == 10);
+    WH_TEST_RETURN_ON_FAIL(wh_CommServer_SendResponse(server, rx_magic,
+            rx_kind, rx_seq, 0, NULL));
+    WH_TEST_RETURN_ON_FAIL(wh_CommClient_RecvResponse(client, NULL, NULL,
+            NULL, NULL, NULL));
+
+    /* Large request is acked frame by frame and dispatched once */
+    do {
+        rc = wh_CommClient_SendRequestFragV(client, WH_COMM_MAGIC_NATIVE, 7,
+                &tx_seq, 2, iov);
+        if (rc == WH_ERROR_NOTREADY) {
+            srv_rc = wh_CommServer_RecvRequestFrag(server, &rx_magic,
+                    &rx_kind, &rx_seq, &rx_len, &rx_data);
+            WH_TEST_ASSERT_RETURN(srv_rc == WH_ERROR_NOTREADY);
+            frames++;
+        }
+    } while (rc == WH_ERROR_NOTREADY);
+    WH_TEST_RETURN_ON_FAIL(rc);
+    WH_TEST_ASSERT_RETURN(frames == 2);
+
+    WH_TEST_RETURN_ON_FAIL(wh_CommServer_RecvRequestFrag(server, &rx_magic,
+            &rx_kind, &rx_seq, &rx_len, &rx_data));
+    WH_TEST_ASSERT_RETURN(rx_data == (uint8_t*)frag);
+    WH_TEST_ASSERT_RETURN(rx_kind == 7);
+    WH_TEST_ASSERT_RETURN(rx_seq == tx_seq);
+    WH_TEST_ASSERT_RETURN(rx_len == sizeof(tx));
+    WH_TEST_ASSERT_RETURN(0 == memcmp(rx_data, tx, sizeof(tx)));
+    WH_TEST_RETURN_ON_FAIL(wh_CommServer_SendResponse(server, rx_magic,
+            rx_kind, rx_seq, 4, rx_data));
+    WH_TEST_RETURN_ON_FAIL(wh_CommClient_RecvResponse(client, NULL, NULL,
+            &rx_seq, &rx_len, NULL));
+    WH_TEST_ASSERT_RETURN(rx_seq == tx_seq);
+    WH_TEST_ASSERT_RETURN(rx_len == 4);
+
+    /* An abandoned partial request does not swallow the next request */
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOTREADY ==
+            wh_CommClient_SendRequestFragV(client, WH_COMM_MAGIC_NATIVE, 7,
+                &tx_seq, 2, iov));
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOTREADY ==
+            wh_CommServer_RecvRequestFrag(server, &rx_magic, &rx_kind,
+                &rx_seq, &rx_len, &rx_data));
+    WH_TEST_RETURN_ON_FAIL(wh_CommClient_Cleanup(client));
+    WH_TEST_RETURN_ON_FAIL(wh_CommClient_Init(client, c_conf));
+
+    WH_TEST_RETURN_ON_FAIL(wh_CommClient_SendRequestFragV(client,
+            WH_COMM_MAGIC_NATIVE, 7, &tx_seq, 1, iov));
+    WH_TEST_RETURN_ON_FAIL(wh_CommServer_RecvRequestFrag(server, &rx_magic,
+            &rx_kind, &rx_seq, &rx_len, &rx_data));
+    WH_TEST_ASSERT_RETURN(rx_data == wh_CommServer_GetDataPtr(server));
+    WH_TEST_ASSERT_RETURN(rx_seq == tx_seq);
+    WH_TEST_ASSERT_RETURN(rx_len == 10);
+    WH_TEST_RETURN_ON_FAIL(wh_CommServer_SendResponse(server, rx_magic,
+            rx_kind, rx_seq, 0, NULL));
+    WH_TEST_RETURN_ON_FAIL(wh_CommClient_RecvResponse(client, NULL, NULL,
+            NULL, NULL, NULL));
+
+    /* A new fragmented request restarts the reassembly */
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOTREADY ==
+            wh_CommClient_SendRequestFragV(client, WH_COMM_MAGIC_NATIVE, 7,
+                &tx_seq, 2, iov));
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOTREADY ==
+            wh_CommServer_RecvRequestFrag(server, &rx_magic, &rx_kind,
+                &rx_seq, &rx_len, &rx_data));
+    WH_TEST_RETURN_ON_FAIL(wh_CommClient_Cleanup(client));
+    WH_TEST_RETURN_ON_FAIL(wh_CommClient_Init(client, c_conf));
+
+    do {
+        rc = wh_CommClient_SendRequestFragV(client, WH_COMM_MAGIC_NATIVE, 7,
+                &tx_seq, 2, iov);
+        if (rc == WH_ERROR_NOTREADY) {
+            srv_rc = wh_CommServer_RecvRequestFrag(server, &rx_magic,
+                    &rx_kind, &rx_seq, &rx_len, &rx_data);
+            WH_TEST_ASSERT_RETURN(srv_rc == WH_ERROR_NOTREADY);
+        }
+    } while (rc == WH_ERROR_NOTREADY);
+    WH_TEST_RETURN_ON_FAIL(rc);
+    WH_TEST_RETURN_ON_FAIL(wh_CommServer_RecvRequestFrag(server, &rx_magic,
+            &rx_kind, &rx_seq, &rx_len, &rx_data));
+    WH_TEST_ASSERT_RETURN(rx_data == (uint8_t*)frag);
+    WH_TEST_ASSERT_RETURN(rx_len == sizeof(tx));
+    WH_TEST_ASSERT_RETURN(0 == memcmp(rx_data, tx, sizeof(tx)));
+    WH_TEST_RETURN_ON_FAIL(wh_CommServer_SendResponse(server, rx_magic,
+            rx_kind, rx_seq, 0, NULL));
+    WH_TEST_RETURN_ON_FAIL(wh_CommClient_RecvResponse(client, NULL, NULL,
+            NULL, NULL, NULL));
+
+    /* Requests larger than the reassembly buffer are dropped */
+    do {
+        rc = wh_CommClient_SendRequestFragV(client, WH_COMM_MAGIC_NATIVE, 7,
+                &tx_seq, 2, over);
+        if (rc == WH_ERROR_NOTREADY) {
+            srv_rc = wh_CommServer_RecvRequestFrag(server, &rx_magic,
+                    &rx_kind, &rx_seq, &rx_len, &rx_data);
+            WH_TEST_ASSERT_RETURN(srv_rc == WH_ERROR_NOTREADY);
+        }
+    } while (rc == WH_ERROR_NOTREADY);
+    WH_TEST_ASSERT_RETURN(rc == WH_ERROR_ABORTED);
+
+    /* Servers that do not reassemble reject the first fragment */
+    do {
+        rc = wh_CommClient_SendRequestFragV(client, WH_COMM_MAGIC_NATIVE, 7,
+                &tx_seq, 2, iov);
+        if (rc == WH_ERROR_NOTREADY) {
+            srv_rc = wh_CommServer_RecvRequest(server, &rx_magic,
+                    &rx_kind, &rx_seq, &rx_len, frag);
+            WH_TEST_ASSERT_RETURN(srv_rc == WH_ERROR_NOTREADY);
+        }
+    } while (rc == WH_ERROR_NOTREADY);
+    WH_TEST_ASSERT_RETURN(rc == WH_ERROR_NOHANDLER);
+
+    WH_TEST_RETURN_ON_FAIL(wh_CommServer_Cleanup(server));
+    WH_TEST_RETURN_ON_FAIL(wh_CommClient_Cleanup(client));
+
+    return 0;
+}
 
 #if defined WH_CFG_TEST_POSIX
 
@@ -404,11 +1125,91 @@ void wh_CommClientServer_MemThreadTest(void)
     _whCommClientServerThreadTest(c_conf, s_conf);
 }
 
+void wh_CommClientServer_MemFutexThreadTest(void)
+{
+    /* Sleep on a futex instead of spinning on the CSR's */
+    posixTransportMemFutexConfig ptmfcf[1] = {{
+        .timeout_us = 100 * ONE_MS,
+    }};
+
+    /* Transport memory configuration */
+    uint8_t              req[BUFFER_SIZE] = {0};
+    uint8_t              resp[BUFFER_SIZE] = {0};
+    whTransportMemConfig tmcf[1] = {{
+        .req        = (whTransportMemCsr*)req,
+        .req_size   = sizeof(req),
+        .resp       = (whTransportMemCsr*)resp,
+        .resp_size  = sizeof(resp),
+        .notify_cb  = posixTransportMemFutex_Notify,
+        .wait_cb    = posixTransportMemFutex_Wait,
+        .notify_arg = ptmfcf,
+    }};
+
+    /* Client configuration/contexts */
+    whTransportClientCb         tmccb[1]  = {WH_TRANSPORT_MEM_CLIENT_CB};
+    whTransportMemClientContext csc[1]    = {};
+    whCommClientConfig          c_conf[1] = {{
+                 .transport_cb      = tmccb,
+                 .transport_context = (void*)csc,
+                 .transport_config  = (void*)tmcf,
+                 .client_id         = 123,
+    }};
+
+    /* Server configuration/contexts */
+    whTransportServerCb         tmscb[1]  = {WH_TRANSPORT_MEM_SERVER_CB};
+    whTransportMemServerContext css[1]    = {};
+    whCommServerConfig          s_conf[1] = {{
+                 .transport_cb      = tmscb,
+                 .transport_context = (void*)css,
+                 .transport_config  = (void*)tmcf,
+                 .server_id         = 124,
+    }};
+
+    _whCommClientServerThreadTest(c_conf, s_conf);
+}
+
+void wh_CommClientServer_MemRingThreadTest(void)
+{
+    /* Transport memory configuration */
+    uint8_t                  req[BUFFER_SIZE]  = {0};
+    uint8_t                  resp[BUFFER_SIZE] = {0};
+    whTransportMemRingConfig tmrcf[1]          = {{
+                 .req        = req,
+                 .req_size   = sizeof(req),
+                 .resp       = resp,
+                 .resp_size  = sizeof(resp),
+                 .slot_count = RING_SLOTS,
+    }};
+
+    /* Client configuration/contexts */
+    whTransportClientCb             tmrccb[1] = {WH_TRANSPORT_MEMRING_CLIENT_CB};
+    whTransportMemRingClientContext csc[1]    = {};
+    whCommClientConfig              c_conf[1] = {{
+                     .transport_cb      = tmrccb,
+                     .transport_context = (void*)csc,
+                     .transport_config  = (void*)tmrcf,
+                     .client_id         = 123,
+    }};
+
+    /* Server configuration/contexts */
+    whTransportServerCb             tmrscb[1] = {WH_TRANSPORT_MEMRING_SERVER_CB};
+    whTransportMemRingServerContext css[1]    = {};
+    whCommServerConfig              s_conf[1] = {{
+                     .transport_cb      = tmrscb,
+                     .transport_context = (void*)css,
+                     .transport_config  = (void*)tmrcf,
+                     .server_id         = 124,
+    }};
+
+    _whCommClientServerThreadTest(c_conf, s_conf);
+}
+
 void wh_CommClientServer_TcpThreadTest(void)
 {
     posixTransportTcpConfig mytcpconfig[1] = {{
         .server_ip_string = "127.0.0.1",
         .server_port      = 23456,
+        .nodelay          = 1,
     }};
 
 
@@ -436,6 +1237,285 @@ void wh_CommClientServer_TcpThreadTest(void)
     _whCommClientServerThreadTest(c_conf, s_conf);
 }
 
+void wh_CommClientServer_UnixThreadTest(void)
+{
+    posixTransportUnixConfig myunixconfig[1] = {{
+        .socket_path = "/tmp/wh_test_comm.sock",
+    }};
+
+    /* Client configuration/contexts */
+    whTransportClientCb             ptuccb[1] = {PTU_CLIENT_CB};
+    posixTransportUnixClientContext tuc[1]    = {};
+    whCommClientConfig              c_conf[1] = {{
+                     .transport_cb      = ptuccb,
+                     .transport_context = (void*)tuc,
+                     .transport_config  = (void*)myunixconfig,
+                     .client_id         = 123,
+    }};
+
+    /* Server configuration/contexts */
+    whTransportServerCb             ptuscb[1] = {PTU_SERVER_CB};
+    posixTransportUnixServerContext tus[1]    = {};
+    whCommServerConfig              s_conf[1] = {{
+                     .transport_cb      = ptuscb,
+                     .transport_context = (void*)tus,
+                     .transport_config  = (void*)myunixconfig,
+                     .server_id         = 124,
+    }};
+
+    _whCommClientServerThreadTest(c_conf, s_conf);
+}
+
+int whTest_CommUnixReconnect(void)
+{
+    posixTransportUnixConfig myunixconfig[1] = {{
+        .socket_path = "/tmp/wh_test_comm_reconnect.sock",
+    }};
+
+    /* Client configuration/contexts */
+    whTransportClientCb             ptuccb[1] = {PTU_CLIENT_CB};
+    posixTransportUnixClientContext tuc[1]    = {};
+    whCommClientConfig              c_conf[1] = {{
+                     .transport_cb      = ptuccb,
+                     .transport_context = (void*)tuc,
+                     .transport_config  = (void*)myunixconfig,
+                     .client_id         = 123,
+    }};
+    whCommClient                    client[1] = {0};
+
+    /* Server configuration/contexts */
+    whTransportServerCb             ptuscb[1] = {PTU_SERVER_CB};
+    posixTransportUnixServerContext tus[1]    = {};
+    whCommServerConfig              s_conf[1] = {{
+                     .transport_cb      = ptuscb,
+                     .transport_context = (void*)tus,
+                     .transport_config  = (void*)myunixconfig,
+                     .server_id         = 124,
+    }};
+    whCommServer                    server[1] = {0};
+
+    uint8_t  tx[REQ_SIZE]  = {0};
+    uint8_t  rx[RESP_SIZE] = {0};
+    uint16_t rx_magic      = 0;
+    uint16_t rx_kind       = 0;
+    uint16_t rx_seq        = 0;
+    uint16_t rx_len        = 0;
+    int      pass          = 0;
+    int      ret           = 0;
+
+    WH_TEST_RETURN_ON_FAIL(wh_CommServer_Init(server, s_conf, NULL, NULL));
+
+    /* A client that goes away must not stop the next one being served */
+    for (pass = 0; pass < 2; pass++) {
+        WH_TEST_RETURN_ON_FAIL(wh_CommClient_Init(client, c_conf));
+
+        snprintf((char*)tx, sizeof(tx), "Request:%u", pass);
+        WH_TEST_RETURN_ON_FAIL(wh_CommClient_SendRequest(client,
+                WH_COMM_MAGIC_NATIVE, pass, NULL, strlen((char*)tx) + 1, tx));
+        do {
+            ret = wh_CommServer_RecvRequest(server, &rx_magic, &rx_kind,
+                    &rx_seq, &rx_len, rx);
+        } while ((ret == WH_ERROR_NOTREADY) && (usleep(ONE_MS) == 0));
+        WH_TEST_ASSERT_RETURN(ret == 0);
+        WH_TEST_ASSERT_RETURN(0 == strcmp((char*)tx, (char*)rx));
+
+        WH_TEST_RETURN_ON_FAIL(wh_CommServer_SendResponse(server, rx_magic,
+                rx_kind, rx_seq, rx_len, rx));
+        do {
+            ret = wh_CommClient_RecvResponse(client, &rx_magic, &rx_kind,
+                    &rx_seq, &rx_len, rx);
+        } while ((ret == WH_ERROR_NOTREADY) && (usleep(ONE_MS) == 0));
+        WH_TEST_ASSERT_RETURN(ret == 0);
+        WH_TEST_ASSERT_RETURN(rx_kind == pass);
+
+        WH_TEST_RETURN_ON_FAIL(wh_CommClient_Cleanup(client));
+
+        /* The server sees the close and goes back to accepting */
+        WH_TEST_ASSERT_RETURN(WH_ERROR_NOTREADY ==
+                wh_CommServer_RecvRequest(server, &rx_magic, &rx_kind,
+                    &rx_seq, &rx_len, rx));
+        WH_TEST_ASSERT_RETURN(tus->accept_fd_p1 == 0);
+    }
+
+    WH_TEST_RETURN_ON_FAIL(wh_CommServer_Cleanup(server));
+    return 0;
+}
+
+void wh_CommClientServer_ShmThreadTest(void)
+{
+    posixTransportShmConfig myshmconfig[1] = {{
+        .name      = "/wh_test_comm",
+        .req_size  = BUFFER_SIZE,
+        .resp_size = BUFFER_SIZE,
+    }};
+
+    /* Client configuration/contexts, mapped separately from the server */
+    whTransportClientCb      ptsccb[1] = {PTS_CLIENT_CB};
+    posixTransportShmContext tsc[1]    = {};
+    whCommClientConfig       c_conf[1] = {{
+              .transport_cb      = ptsccb,
+              .transport_context = (void*)tsc,
+              .transport_config  = (void*)myshmconfig,
+              .client_id         = 123,
+    }};
+
+    /* Server configuration/contexts */
+    whTransportServerCb      ptsscb[1] = {PTS_SERVER_CB};
+    posixTransportShmContext tss[1]    = {};
+    whCommServerConfig       s_conf[1] = {{
+              .transport_cb      = ptsscb,
+              .transport_context = (void*)tss,
+              .transport_config  = (void*)myshmconfig,
+              .server_id         = 124,
+    }};
+
+    _whCommClientServerThreadTest(c_conf, s_conf);
+}
+
+#define TCP_MULTI_CLIENTS 4
+
+static void* _whCommMultiClientTask(void* cf)
+{
+    whCommClientConfig* config = (whCommClientConfig*)cf;
+    whCommClient        client[1];
+    int                 ret     = 0;
+    int                 counter = 0;
+    uint8_t             tx[REQ_SIZE]  = {0};
+    uint8_t             rx[RESP_SIZE] = {0};
+    char                expect[RESP_SIZE];
+    uint16_t            rx_magic = 0;
+    uint16_t            rx_kind  = 0;
+    uint16_t            rx_seq   = 0;
+    uint16_t            rx_len   = 0;
+
+    ret = wh_CommClient_Init(client, config);
+    WH_TEST_ASSERT_MSG(0 == ret, "Client Init: ret=%d", ret);
+
+    for (counter = 0; (ret == 0) && (counter < REPEAT_COUNT); counter++) {
+        snprintf((char*)tx, sizeof(tx), "Client:%u:%u", config->client_id,
+                 counter);
+        do {
+            ret = wh_CommClient_SendRequest(client, WH_COMM_MAGIC_NATIVE,
+                    config->client_id, NULL, strlen((char*)tx) + 1, tx);
+        } while ((ret == WH_ERROR_NOTREADY) && (usleep(ONE_MS) == 0));
+        WH_TEST_ASSERT_MSG(0 == ret, "Client SendRequest: ret=%d", ret);
+
+        do {
+            ret = wh_CommClient_RecvResponse(client, &rx_magic, &rx_kind,
+                    &rx_seq, &rx_len, rx);
+        } while ((ret == WH_ERROR_NOTREADY) && (usleep(ONE_MS) == 0));
+        WH_TEST_ASSERT_MSG(0 == ret, "Client RecvResponse: ret=%d", ret);
+
+        /* Responses must come back on the requesting connection */
+        snprintf(expect, sizeof(expect), "Response:%s", tx);
+        WH_TEST_ASSERT_MSG(0 == strcmp(expect, (char*)rx),
+                           "Client %u got %s", config->client_id, rx);
+    }
+
+    ret = wh_CommClient_Cleanup(client);
+    WH_TEST_ASSERT_MSG(0 == ret, "Client Cleanup: ret=%d", ret);
+    return NULL;
+}
+
+static void* _whCommMultiServerTask(void* s)
+{
+    whCommServer* server = (whCommServer*)s;
+    int           ret    = 0;
+    int           count  = 0;
+    uint8_t       bound[TCP_MULTI_CLIENTS] = {0};
+    uint8_t       rx[REQ_SIZE]   = {0};
+    uint8_t       tx[RESP_SIZE]  = {0};
+    uint16_t      rx_magic = 0;
+    uint16_t      rx_kind  = 0;
+    uint16_t      rx_seq   = 0;
+    uint16_t      rx_len   = 0;
+
+    while ((ret == 0) && (count < TCP_MULTI_CLIENTS * REPEAT_COUNT)) {
+        do {
+            ret = wh_CommServer_RecvRequest(server, &rx_magic, &rx_kind,
+                    &rx_seq, &rx_len, rx);
+        } while ((ret == WH_ERROR_NOTREADY) && (usleep(ONE_MS) == 0));
+        WH_TEST_ASSERT_MSG(0 == ret, "Server RecvRequest: ret=%d", ret);
+        WH_TEST_ASSERT_MSG(rx_kind < TCP_MULTI_CLIENTS, "Kind %u", rx_kind);
+
+        /* Each connection keeps its own identity */
+        if (bound[rx_kind] == 0) {
+            bound[rx_kind] = server->client_id;
+        }
+        WH_TEST_ASSERT_MSG(bound[rx_kind] == server->client_id,
+                           "Client %u seen as %u", rx_kind, server->client_id);
+
+        snprintf((char*)tx, sizeof(tx), "Response:%s", rx);
+        do {
+            ret = wh_CommServer_SendResponse(server, rx_magic, rx_kind,
+                    rx_seq, strlen((char*)tx) + 1, tx);
+        } while (ret == WH_ERROR_NOTREADY);
+        WH_TEST_ASSERT_MSG(0 == ret, "Server SendResponse: ret=%d", ret);
+        count++;
+    }
+    return NULL;
+}
+
+void wh_CommClientServer_TcpMultiThreadTest(void)
+{
+    posixTransportTcpConfig mytcpconfig[1] = {{
+        .server_ip_string = "127.0.0.1",
+        .server_port      = 23457,
+        .nodelay          = 1,
+    }};
+
+    /* Client configuration/contexts */
+    whTransportClientCb            pttccb[1] = {PTT_CLIENT_CB};
+    posixTransportTcpClientContext tcc[TCP_MULTI_CLIENTS];
+    whCommClientConfig             c_conf[TCP_MULTI_CLIENTS];
+    pthread_t                      cthread[TCP_MULTI_CLIENTS];
+
+    /* Server configuration/contexts */
+    whTransportServerCb                 pttmscb[1] = {PTT_MULTI_SERVER_CB};
+    posixTransportTcpMultiServerContext tmss[1];
+    whCommServerConfig                  s_conf[1]  = {{
+                         .transport_cb      = pttmscb,
+                         .transport_context = (void*)tmss,
+                         .transport_config  = (void*)mytcpconfig,
+                         .server_id         = 124,
+    }};
+    whCommServer                        server[1];
+    pthread_t                           sthread;
+
+    void* retval;
+    int   i  = 0;
+    int   rc = 0;
+
+    memset(c_conf, 0, sizeof(c_conf));
+    for (i = 0; i < TCP_MULTI_CLIENTS; i++) {
+        c_conf[i].transport_cb      = pttccb;
+        c_conf[i].transport_context = (void*)&tcc[i];
+        c_conf[i].transport_config  = (void*)mytcpconfig;
+        c_conf[i].client_id         = (uint8_t)i;
+    }
+
+    /* Listen before any client connects */
+    rc = wh_CommServer_Init(server, s_conf, NULL, NULL);
+    WH_TEST_ASSERT_MSG(0 == rc, "Server Init: ret=%d", rc);
+
+    rc = pthread_create(&sthread, NULL, _whCommMultiServerTask, server);
+    for (i = 0; (rc == 0) && (i < TCP_MULTI_CLIENTS); i++) {
+        rc = pthread_create(&cthread[i], NULL, _whCommMultiClientTask,
+                            &c_conf[i]);
+        WH_TEST_ASSERT_MSG(0 == rc, "Client thread create:%d", rc);
+    }
+    while (i > 0) {
+        i--;
+        pthread_join(cthread[i], &retval);
+    }
+    if (rc == 0) {
+        pthread_join(sthread, &retval);
+    }
+
+    rc = wh_CommServer_Cleanup(server);
+    WH_TEST_ASSERT_MSG(0 == rc, "Server Cleanup: ret=%d", rc);
+}
+
 #endif /* defined(WH_CFG_TEST_POSIX) */
 
 int whTest_Comm(void)
@@ -443,12 +1523,48 @@ int whTest_Comm(void)
     printf("Testing comms: mem...\n");
     WH_TEST_ASSERT(0 == whTest_CommMem());
 
+    printf("Testing comms: in-place mem...\n");
+    WH_TEST_ASSERT(0 == whTest_CommMemInPlace());
+
+    printf("Testing comms: translation...\n");
+    WH_TEST_ASSERT(0 == whTest_CommTranslate());
+
+    printf("Testing comms: memring...\n");
+    WH_TEST_ASSERT(0 == whTest_CommMemRing());
+
+    printf("Testing comms: pipelined memring...\n");
+    WH_TEST_ASSERT(0 == whTest_CommPipeline());
+
+    printf("Testing comms: gathered mem...\n");
+    WH_TEST_ASSERT(0 == whTest_CommGather());
+
+    printf("Testing comms: fragmented mem...\n");
+    WH_TEST_ASSERT(0 == whTest_CommFrag());
+
 #if defined(WH_CFG_TEST_POSIX)
     printf("Testing comms: (pthread) mem...\n");
     wh_CommClientServer_MemThreadTest();
 
+    printf("Testing comms: (pthread) futex mem...\n");
+    wh_CommClientServer_MemFutexThreadTest();
+
+    printf("Testing comms: (pthread) memring...\n");
+    wh_CommClientServer_MemRingThreadTest();
+
     printf("Testing comms: (pthread) tcp...\n");
     wh_CommClientServer_TcpThreadTest();
+
+    printf("Testing comms: (pthread) unix seqpacket...\n");
+    wh_CommClientServer_UnixThreadTest();
+
+    printf("Testing comms: unix seqpacket reconnect...\n");
+    WH_TEST_ASSERT(0 == whTest_CommUnixReconnect());
+
+    printf("Testing comms: (pthread) shm...\n");
+    wh_CommClientServer_ShmThreadTest();
+
+    printf("Testing comms: (pthread) multi-client tcp...\n");
+    wh_CommClientServer_TcpMultiThreadTest();
 #endif /* defined(WH_CFG_TEST_POSIX) */
 
     return 0;
@@ -25,6 +25,41 @@
  */
 int whTest_CommMem(void);
 
+/*
+ * Runs the comms tests using the memory transport in-place mode, where both
+ * sides build and parse packets directly in shared memory.
+ * Returns 0 on success and a non-zero error code on failure
+ */
+int whTest_CommMemInPlace(void);
+
+/*
+ * Runs the byte order translation tests, including how a packet with a
+ * swapped endian marker is received.
+ * Returns 0 on success and a non-zero error code on failure
+ */
+int whTest_CommTranslate(void);
+
+/*
+ * Runs the transport tests using the memory ring backend, queueing several
+ * requests before the server drains them.
+ * Returns 0 on success and a non-zero error code on failure
+ */
+int whTest_CommMemRing(void);
+
+/*
+ * Runs the pipelined comm client tests over the memory ring backend, claiming
+ * responses out of order.
+ * Returns 0 on success and a non-zero error code on failure
+ */
+int whTest_CommPipeline(void);
+
+/*
+ * Runs the scatter/gather request tests over the memory backend, both with
+ * and without transport gather support.
+ * Returns 0 on success and a non-zero error code on failure
+ */
+int whTest_CommGather(void);
+
 /* Runs all the comms tests using a memory transport as the backend, and
  * optionally using the POSIX TCP backend if WH_CFG_TEST_POSIX is defined.
  *
@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdint.h>
+#include <stdio.h>
+
+#if defined(WH_CONFIG)
+#include "wh_config.h"
+#endif
+
+/* core test includes */
+#include "wh_test_common.h"
+#include "wh_test_counter.h"
+
+/* APIs to test */
+#include "wolfhsm/wh_error.h"
+#include "wolfhsm/wh_flash_unit.h"
+#include "wolfhsm/wh_counter.h"
+
+/* Flash simulator backend to host the counters */
+#include "wolfhsm/wh_flash_ramsim.h"
+
+#define TEST_PARTITION_SIZE 1024
+#define TEST_RESERVE 16
+#define TEST_INCREMENTS 1000
+
+/* Mount the same flash again without reinitializing the device */
+static int _Reload(const whCounterConfig* cfg, whCounterContext* reload)
+{
+    static whFlashCb reloadCb;
+    whCounterConfig  reloadCfg = *cfg;
+
+    reloadCb         = *cfg->cb;
+    reloadCb.Init    = NULL;
+    reloadCb.Cleanup = NULL;
+    reloadCfg.cb     = &reloadCb;
+    return wh_Counter_Init(reload, &reloadCfg);
+}
+
+int whTest_Counter(void)
+{
+    const whFlashCb  myCb[1]          = {WH_FLASH_RAMSIM_CB};
+    whFlashRamsimCtx myHalFlashCtx[1] = {0};
+    whFlashRamsimCfg myHalFlashCfg[1] = {{
+        .size       = 2 * TEST_PARTITION_SIZE,
+        .sectorSize = TEST_PARTITION_SIZE,
+        .pageSize   = 8,
+        .erasedByte = ~(uint8_t)0,
+    }};
+    whCounterConfig myCounterCfg = {
+        .cb             = myCb,
+        .context        = myHalFlashCtx,
+        .config         = myHalFlashCfg,
+        .partition_size = TEST_PARTITION_SIZE,
+        .reserve        = TEST_RESERVE,
+    };
+    whCounterContext   context[1] = {0};
+    whCounterContext   reload[1]  = {0};
+    whFlashRamsimStats stats      = {0};
+    uint32_t           value      = 0;
+    uint32_t           last       = 0;
+    uint32_t           epoch      = 0;
+    whCounterId        id         = 0;
+    int                i          = 0;
+
+    printf("Testing journaled counters with RAM sim...\n");
+
+    WH_TEST_RETURN_ON_FAIL(wh_Counter_Init(context, &myCounterCfg));
+    for (id = 0; id < WOLFHSM_NUM_COUNTERS; id++) {
+        WH_TEST_RETURN_ON_FAIL(wh_Counter_Read(context, id, &value));
+        WH_TEST_ASSERT_RETURN(value == 0);
+    }
+    WH_TEST_ASSERT_RETURN(WH_ERROR_BADARGS ==
+            wh_Counter_Read(context, WOLFHSM_NUM_COUNTERS, &value));
+    WH_TEST_ASSERT_RETURN(WH_ERROR_BADARGS ==
+            wh_Counter_Increment(context, WOLFHSM_NUM_COUNTERS, &value));
+
+    /* Only one increment per reserve programs flash */
+    printf("--Increment\n");
+    WH_TEST_RETURN_ON_FAIL(whFlashRamsim_ResetStats(myHalFlashCtx));
+    for (i = 0; i < TEST_INCREMENTS; i++) {
+        WH_TEST_RETURN_ON_FAIL(wh_Counter_Increment(context, 0, &value));
+        WH_TEST_ASSERT_RETURN(value == (uint32_t)i + 1);
+    }
+    WH_TEST_RETURN_ON_FAIL(wh_Counter_Read(context, 0, &value));
+    WH_TEST_ASSERT_RETURN(value == TEST_INCREMENTS);
+    WH_TEST_RETURN_ON_FAIL(whFlashRamsim_GetStats(myHalFlashCtx, &stats));
+    WH_TEST_ASSERT_RETURN(stats.programs ==
+            WHFU_DIV_ROUND_UP(TEST_INCREMENTS, TEST_RESERVE));
+    WH_TEST_ASSERT_RETURN(stats.erases == 0);
+
+    /* A restart resumes past every value handed out */
+    printf("--Reload\n");
+    WH_TEST_RETURN_ON_FAIL(_Reload(&myCounterCfg, reload));
+    WH_TEST_RETURN_ON_FAIL(wh_Counter_Read(reload, 0, &value));
+    WH_TEST_ASSERT_RETURN(value >= TEST_INCREMENTS);
+    WH_TEST_ASSERT_RETURN(value <= TEST_INCREMENTS + TEST_RESERVE);
+    WH_TEST_RETURN_ON_FAIL(wh_Counter_Read(reload, 1, &value));
+    WH_TEST_ASSERT_RETURN(value == 0);
+
+    /* Filling the journal checkpoints into the other partition */
+    printf("--Checkpoint\n");
+    epoch = reload->epoch;
+    last  = 0;
+    for (i = 0; i < TEST_PARTITION_SIZE / 8 * TEST_RESERVE; i++) {
+        WH_TEST_RETURN_ON_FAIL(wh_Counter_Increment(reload, 1, &value));
+        WH_TEST_ASSERT_RETURN(value > last);
+        last = value;
+    }
+    WH_TEST_ASSERT_RETURN(reload->epoch == epoch + 1);
+    WH_TEST_RETURN_ON_FAIL(wh_Counter_Checkpoint(reload));
+    WH_TEST_RETURN_ON_FAIL(wh_Counter_Increment(reload, 1, &value));
+    WH_TEST_ASSERT_RETURN(value == last + 1);
+    last = value;
+    WH_TEST_RETURN_ON_FAIL(_Reload(&myCounterCfg, context));
+    WH_TEST_ASSERT_RETURN(context->epoch == epoch + 2);
+    WH_TEST_RETURN_ON_FAIL(wh_Counter_Read(context, 1, &value));
+    WH_TEST_ASSERT_RETURN(value >= last);
+    WH_TEST_RETURN_ON_FAIL(wh_Counter_Read(context, 0, &value));
+    WH_TEST_ASSERT_RETURN(value >= TEST_INCREMENTS);
+
+    /* Counters stop at the top rather than wrap */
+    printf("--Saturate\n");
+    context->value[2] = UINT32_MAX - 1;
+    context->limit[2] = UINT32_MAX - 1;
+    WH_TEST_RETURN_ON_FAIL(wh_Counter_Increment(context, 2, &value));
+    WH_TEST_ASSERT_RETURN(value == UINT32_MAX);
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOSPACE ==
+            wh_Counter_Increment(context, 2, &value));
+    WH_TEST_RETURN_ON_FAIL(_Reload(&myCounterCfg, reload));
+    WH_TEST_RETURN_ON_FAIL(wh_Counter_Read(reload, 2, &value));
+    WH_TEST_ASSERT_RETURN(value == UINT32_MAX);
+
+    printf("--Done\n");
+    /* The reloaded context does not own the flash */
+    WH_TEST_RETURN_ON_FAIL(wh_Counter_Cleanup(reload));
+    WH_TEST_RETURN_ON_FAIL(myCb->Cleanup(myHalFlashCtx));
+    return 0;
+}
@@ -28,6 +28,7 @@
 #ifndef WOLFHSM_NO_CRYPTO
 
 #include "wolfssl/wolfcrypt/settings.h"
+#include "wolfssl/wolfcrypt/signature.h"
 
 #if defined(WH_CONFIG)
 #include "wh_config.h"
@@ -40,6 +41,7 @@
 #include "wolfhsm/wh_comm.h"
 #include "wolfhsm/wh_message.h"
 #include "wolfhsm/wh_server.h"
+#include "wolfhsm/wh_server_keystore.h"
 #include "wolfhsm/wh_client.h"
 #include "wolfhsm/wh_transport_mem.h"
 
@@ -66,6 +68,314 @@ enum {
 
 
 #define PLAINTEXT "mytextisbigplain"
+#define WH_TEST_CACHE_KEYS 8
+
+#if defined(WOLFHSM_SYMMETRIC_INTERNAL) && defined(HAVE_AESGCM) && \
+    defined(WOLFSSL_AESGCM_STREAM)
+#define WH_TEST_SESSION_SZ 3000
+
+/* Run AES-GCM over several requests and check it against a one-shot local
+ * encryption with the same key */
+static int whTest_CryptoCipherSession(whClientContext* client)
+{
+    static uint8_t plainText[WH_TEST_SESSION_SZ];
+    static uint8_t cipherText[WH_TEST_SESSION_SZ];
+    static uint8_t expected[WH_TEST_SESSION_SZ];
+    static uint8_t finalText[WH_TEST_SESSION_SZ];
+    uint8_t key[16];
+    uint8_t iv[12];
+    uint8_t authIn[20];
+    uint8_t authTag[16];
+    uint8_t expectedTag[16];
+    uint8_t label[WOLFHSM_NVM_LABEL_LEN] = {0};
+    uint16_t keyId = 0;
+    uint16_t session = 0;
+    Aes aes[1];
+    int i;
+
+    for (i = 0; i < WH_TEST_SESSION_SZ; i++)
+        plainText[i] = (uint8_t)i;
+    memset(key, 0x3C, sizeof(key));
+    memset(iv, 0x5A, sizeof(iv));
+    memset(authIn, 0xA5, sizeof(authIn));
+
+    WH_TEST_RETURN_ON_FAIL(wc_AesInit(aes, NULL, INVALID_DEVID));
+    WH_TEST_RETURN_ON_FAIL(wc_AesGcmSetKey(aes, key, sizeof(key)));
+    WH_TEST_RETURN_ON_FAIL(wc_AesGcmEncrypt(aes, expected, plainText,
+        sizeof(plainText), iv, sizeof(iv), expectedTag, sizeof(expectedTag),
+        authIn, sizeof(authIn)));
+    wc_AesFree(aes);
+
+    WH_TEST_RETURN_ON_FAIL(wh_Client_KeyCache(client, 0, label, sizeof(label),
+        key, sizeof(key), &keyId));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_CipherSessionInit(client,
+        WC_CIPHER_AES_GCM, 1, keyId, iv, sizeof(iv), authIn, sizeof(authIn),
+        &session));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_CipherSessionUpdate(client, session,
+        plainText, sizeof(plainText), cipherText));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_CipherSessionFinal(client, session,
+        authTag, sizeof(authTag)));
+    WH_TEST_ASSERT_RETURN(memcmp(cipherText, expected, sizeof(expected)) == 0);
+    WH_TEST_ASSERT_RETURN(memcmp(authTag, expectedTag, sizeof(authTag)) == 0);
+    /* the session is closed by final */
+    WH_TEST_ASSERT_RETURN(wh_Client_CipherSessionUpdate(client, session,
+        plainText, 16, cipherText) == WH_ERROR_NOTFOUND);
+
+    WH_TEST_RETURN_ON_FAIL(wh_Client_CipherSessionInit(client,
+        WC_CIPHER_AES_GCM, 0, keyId, iv, sizeof(iv), authIn, sizeof(authIn),
+        &session));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_CipherSessionUpdate(client, session,
+        cipherText, sizeof(cipherText), finalText));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_CipherSessionFinal(client, session,
+        authTag, sizeof(authTag)));
+    WH_TEST_ASSERT_RETURN(memcmp(finalText, plainText, sizeof(plainText)) == 0);
+
+    /* a bad tag fails final */
+    WH_TEST_RETURN_ON_FAIL(wh_Client_CipherSessionInit(client,
+        WC_CIPHER_AES_GCM, 0, keyId, iv, sizeof(iv), authIn, sizeof(authIn),
+        &session));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_CipherSessionUpdate(client, session,
+        cipherText, sizeof(cipherText), finalText));
+    authTag[0] ^= 1;
+    WH_TEST_ASSERT_RETURN(wh_Client_CipherSessionFinal(client, session,
+        authTag, sizeof(authTag)) == AES_GCM_AUTH_E);
+
+    WH_TEST_RETURN_ON_FAIL(wh_Client_KeyEvict(client, keyId));
+    printf("AES GCM SESSION SUCCESS\n");
+    return 0;
+}
+#endif
+
+#if WOLFHSM_SERVER_MAX_HASH_SESSIONS > 0 && !defined(NO_SHA256)
+#define WH_TEST_HASH_SZ 3000
+
+/* Hash, HMAC and CMAC over several requests, and through dma, checked against
+ * local one-shot results */
+static int whTest_CryptoHashSession(whClientContext* client)
+{
+    static uint8_t in[WH_TEST_HASH_SZ];
+    uint8_t key[16];
+    uint8_t digest[WC_SHA256_DIGEST_SIZE];
+    uint8_t expected[WC_SHA256_DIGEST_SIZE];
+    uint8_t label[WOLFHSM_NVM_LABEL_LEN] = {0};
+    uint32_t digestSz;
+    uint16_t keyId = 0;
+    uint16_t session = 0;
+    wc_Sha256 sha[1];
+#ifndef NO_HMAC
+    Hmac hmac[1];
+#endif
+#if defined(WOLFSSL_CMAC) && !defined(NO_AES)
+    word32 cmacSz;
+#endif
+    int i;
+
+    for (i = 0; i < WH_TEST_HASH_SZ; i++)
+        in[i] = (uint8_t)(i * 5);
+    memset(key, 0x4B, sizeof(key));
+
+    WH_TEST_RETURN_ON_FAIL(wc_InitSha256_ex(sha, NULL, INVALID_DEVID));
+    WH_TEST_RETURN_ON_FAIL(wc_Sha256Update(sha, in, sizeof(in)));
+    WH_TEST_RETURN_ON_FAIL(wc_Sha256Final(sha, expected));
+    wc_Sha256Free(sha);
+
+    /* split across requests, then across a dma update */
+    WH_TEST_RETURN_ON_FAIL(wh_Client_HashSessionInit(client,
+        WH_HASH_SESSION_SHA256, 0, &session));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_HashSessionUpdate(client, session, in,
+        sizeof(in)));
+    digestSz = sizeof(digest);
+    WH_TEST_RETURN_ON_FAIL(wh_Client_HashSessionFinal(client, session, digest,
+        &digestSz));
+    WH_TEST_ASSERT_RETURN(digestSz == sizeof(expected));
+    WH_TEST_ASSERT_RETURN(memcmp(digest, expected, sizeof(expected)) == 0);
+    /* the session is closed by final */
+    WH_TEST_ASSERT_RETURN(wh_Client_HashSessionUpdate(client, session, in,
+        16) == WH_ERROR_NOTFOUND);
+
+    WH_TEST_RETURN_ON_FAIL(wh_Client_HashSessionInit(client,
+        WH_HASH_SESSION_SHA256, 0, &session));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_HashSessionUpdate(client, session, in,
+        100));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_HashSessionUpdateDma(client, session,
+        in + 100, sizeof(in) - 100));
+    digestSz = sizeof(digest);
+    WH_TEST_RETURN_ON_FAIL(wh_Client_HashSessionFinal(client, session, digest,
+        &digestSz));
+    WH_TEST_ASSERT_RETURN(memcmp(digest, expected, sizeof(expected)) == 0);
+
+    WH_TEST_RETURN_ON_FAIL(wh_Client_KeyCache(client, 0, label, sizeof(label),
+        key, sizeof(key), &keyId));
+#ifndef NO_HMAC
+    WH_TEST_RETURN_ON_FAIL(wc_HmacInit(hmac, NULL, INVALID_DEVID));
+    WH_TEST_RETURN_ON_FAIL(wc_HmacSetKey(hmac, WC_SHA256, key, sizeof(key)));
+    WH_TEST_RETURN_ON_FAIL(wc_HmacUpdate(hmac, in, sizeof(in)));
+    WH_TEST_RETURN_ON_FAIL(wc_HmacFinal(hmac, expected));
+    wc_HmacFree(hmac);
+    WH_TEST_RETURN_ON_FAIL(wh_Client_HashSessionInit(client,
+        WH_HASH_SESSION_HMAC_SHA256, keyId, &session));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_HashSessionUpdate(client, session, in,
+        sizeof(in)));
+    digestSz = sizeof(digest);
+    WH_TEST_RETURN_ON_FAIL(wh_Client_HashSessionFinal(client, session, digest,
+        &digestSz));
+    WH_TEST_ASSERT_RETURN(digestSz == WC_SHA256_DIGEST_SIZE);
+    WH_TEST_ASSERT_RETURN(memcmp(digest, expected, digestSz) == 0);
+#endif
+#if defined(WOLFSSL_CMAC) && !defined(NO_AES)
+    cmacSz = AES_BLOCK_SIZE;
+    WH_TEST_RETURN_ON_FAIL(wc_AesCmacGenerate(expected, &cmacSz, in,
+        sizeof(in), key, sizeof(key)));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_HashSessionInit(client,
+        WH_HASH_SESSION_CMAC_AES, keyId, &session));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_HashSessionUpdateDma(client, session,
+        in, sizeof(in)));
+    digestSz = sizeof(digest);
+    WH_TEST_RETURN_ON_FAIL(wh_Client_HashSessionFinal(client, session, digest,
+        &digestSz));
+    WH_TEST_ASSERT_RETURN(digestSz == cmacSz);
+    WH_TEST_ASSERT_RETURN(memcmp(digest, expected, digestSz) == 0);
+#endif
+    WH_TEST_RETURN_ON_FAIL(wh_Client_KeyEvict(client, keyId));
+    /* a mac needs a cached key */
+    WH_TEST_ASSERT_RETURN(wh_Client_HashSessionInit(client,
+        WH_HASH_SESSION_HMAC_SHA256, keyId, &session) == WH_ERROR_NOTFOUND);
+    printf("HASH SESSION SUCCESS\n");
+    return 0;
+}
+#endif
+
+#if defined(WOLFHSM_SYMMETRIC_INTERNAL) && defined(HAVE_AESGCM)
+#define WH_TEST_DMA_SZ 3000
+
+/* AES-GCM through the DMA device id, which is not limited by the packet size.
+ * Checked against a one-shot local encryption with the same key */
+static int whTest_CryptoCipherDma(whClientContext* client)
+{
+    static uint8_t plainText[WH_TEST_DMA_SZ];
+    static uint8_t cipherText[WH_TEST_DMA_SZ];
+    static uint8_t expected[WH_TEST_DMA_SZ];
+    static uint8_t finalText[WH_TEST_DMA_SZ];
+    uint8_t key[16];
+    uint8_t iv[12];
+    uint8_t authIn[20];
+    uint8_t authTag[16];
+    uint8_t expectedTag[16];
+    uint8_t label[WOLFHSM_NVM_LABEL_LEN] = {0};
+    uint16_t keyId = 0;
+    Aes aes[1];
+    int i;
+
+    for (i = 0; i < WH_TEST_DMA_SZ; i++)
+        plainText[i] = (uint8_t)(i * 3);
+    memset(key, 0xC3, sizeof(key));
+    memset(iv, 0x1E, sizeof(iv));
+    memset(authIn, 0x77, sizeof(authIn));
+
+    WH_TEST_RETURN_ON_FAIL(wc_AesInit(aes, NULL, INVALID_DEVID));
+    WH_TEST_RETURN_ON_FAIL(wc_AesGcmSetKey(aes, key, sizeof(key)));
+    WH_TEST_RETURN_ON_FAIL(wc_AesGcmEncrypt(aes, expected, plainText,
+        sizeof(plainText), iv, sizeof(iv), expectedTag, sizeof(expectedTag),
+        authIn, sizeof(authIn)));
+    wc_AesFree(aes);
+
+    WH_TEST_RETURN_ON_FAIL(wh_Client_KeyCache(client, 0, label, sizeof(label),
+        key, sizeof(key), &keyId));
+    WH_TEST_RETURN_ON_FAIL(wc_AesInit(aes, NULL, WOLFHSM_DEV_ID_DMA));
+    wh_Client_SetKeyAes(aes, keyId);
+    WH_TEST_RETURN_ON_FAIL(wc_AesGcmEncrypt(aes, cipherText, plainText,
+        sizeof(plainText), iv, sizeof(iv), authTag, sizeof(authTag),
+        authIn, sizeof(authIn)));
+    WH_TEST_ASSERT_RETURN(memcmp(cipherText, expected, sizeof(expected)) == 0);
+    WH_TEST_ASSERT_RETURN(memcmp(authTag, expectedTag, sizeof(authTag)) == 0);
+    WH_TEST_RETURN_ON_FAIL(wc_AesGcmDecrypt(aes, finalText, cipherText,
+        sizeof(cipherText), iv, sizeof(iv), authTag, sizeof(authTag),
+        authIn, sizeof(authIn)));
+    WH_TEST_ASSERT_RETURN(memcmp(finalText, plainText, sizeof(plainText)) == 0);
+    authTag[0] ^= 1;
+    WH_TEST_ASSERT_RETURN(wc_AesGcmDecrypt(aes, finalText, cipherText,
+        sizeof(cipherText), iv, sizeof(iv), authTag, sizeof(authTag),
+        authIn, sizeof(authIn)) == AES_GCM_AUTH_E);
+    wc_AesFree(aes);
+
+    WH_TEST_RETURN_ON_FAIL(wh_Client_KeyEvict(client, keyId));
+    printf("AES GCM DMA SUCCESS\n");
+    return 0;
+}
+#endif
+
+#if !defined(WOLFHSM_SERVER_NO_GROUP_IMAGE) && !defined(NO_RSA)
+/* Verify an image against standard PKCS#1 v1.5 signatures, which carry the
+ * DER encoded DigestInfo, made locally with each supported hash */
+static int whTest_CryptoImageVerifyRsa(whClientContext* client, WC_RNG* rng)
+{
+    static uint8_t image[2 * WOLFHSM_SERVER_IMAGE_CHUNK_SZ + 37];
+    static uint8_t der[WOLFHSM_KEYCACHE_BUFSIZE];
+    const enum wc_HashType wcHash[] = {
+        WC_HASH_TYPE_SHA256,
+#ifdef WOLFSSL_SHA384
+        WC_HASH_TYPE_SHA384,
+#endif
+    };
+    const uint32_t whHash[] = {
+        WH_HASH_SESSION_SHA256,
+#ifdef WOLFSSL_SHA384
+        WH_HASH_SESSION_SHA384,
+#endif
+    };
+    const int hashCount = (int)(sizeof(whHash) / sizeof(whHash[0]));
+    uint8_t sig[256];
+    uint8_t label[WOLFHSM_NVM_LABEL_LEN] = {0};
+    word32 sigSz = 0;
+    uint32_t other;
+    uint16_t keyId = 0;
+    RsaKey rsa[1];
+    int derSz;
+    int res;
+    int i;
+
+    for (i = 0; i < (int)sizeof(image); i++)
+        image[i] = (uint8_t)(i * 7);
+    WH_TEST_RETURN_ON_FAIL(wc_InitRsaKey_ex(rsa, NULL, INVALID_DEVID));
+    WH_TEST_RETURN_ON_FAIL(wc_MakeRsaKey(rsa, 2048, 65537, rng));
+    derSz = wc_RsaKeyToDer(rsa, der, sizeof(der));
+    WH_TEST_ASSERT_RETURN(derSz > 0);
+    WH_TEST_RETURN_ON_FAIL(wh_Client_KeyCache(client, 0, label, sizeof(label),
+        der, (uint32_t)derSz, &keyId));
+
+    for (i = 0; i < hashCount; i++) {
+        sigSz = sizeof(sig);
+        WH_TEST_RETURN_ON_FAIL(wc_SignatureGenerate(wcHash[i],
+            WC_SIGNATURE_TYPE_RSA_W_ENC, image, sizeof(image), sig, &sigSz,
+            rsa, sizeof(*rsa), rng));
+        res = 0;
+        WH_TEST_RETURN_ON_FAIL(wh_Client_ImageVerify(client, keyId,
+            WH_IMAGE_SIG_RSA, 0, whHash[i], image, sizeof(image), sig, sigSz,
+            &res));
+        WH_TEST_ASSERT_RETURN(res == 1);
+        /* the DigestInfo names the hash, so another one does not match */
+        if (hashCount > 1) {
+            other = whHash[(i + 1) % hashCount];
+            WH_TEST_RETURN_ON_FAIL(wh_Client_ImageVerify(client, keyId,
+                WH_IMAGE_SIG_RSA, 0, other, image, sizeof(image), sig, sigSz,
+                &res));
+            WH_TEST_ASSERT_RETURN(res == 0);
+        }
+        /* a change in the image is caught */
+        image[sizeof(image) - 1] ^= 1;
+        WH_TEST_RETURN_ON_FAIL(wh_Client_ImageVerify(client, keyId,
+            WH_IMAGE_SIG_RSA, 0, whHash[i], image, sizeof(image), sig, sigSz,
+            &res));
+        WH_TEST_ASSERT_RETURN(res == 0);
+        image[sizeof(image) - 1] ^= 1;
+    }
+
+    wc_FreeRsaKey(rsa);
+    WH_TEST_RETURN_ON_FAIL(wh_Client_KeyEvict(client, keyId));
+    printf("IMAGE VERIFY RSA SUCCESS\n");
+    return 0;
+}
+#endif
 
 int whTest_CryptoClientConfig(whClientConfig* config)
 {
@@ -82,6 +392,8 @@ int whTest_CryptoClientConfig(whClientConfig* config)
     curve25519_key curve25519PublicKey[1];
     uint32_t outLen;
     uint16_t keyId;
+    uint16_t keyIds[WH_TEST_CACHE_KEYS];
+    int i;
     uint8_t key[16];
     uint8_t keyEnd[16];
     uint8_t labelStart[WOLFHSM_NVM_LABEL_LEN];
@@ -121,6 +433,22 @@ int whTest_CryptoClientConfig(whClientConfig* config)
         printf("Failed to wc_RNG_GenerateBlock %d\n", ret);
         goto exit;
     }
+    {
+        /* larger than one response, filled over several requests */
+        static uint8_t bigBlock[3000];
+        memset(bigBlock, 0, sizeof(bigBlock));
+        if ((ret = wc_RNG_GenerateBlock(rng, bigBlock, sizeof(bigBlock))) != 0) {
+            WH_ERROR_PRINT("Failed to wc_RNG_GenerateBlock %d\n", ret);
+            goto exit;
+        }
+        for (i = 0; i < 32 && bigBlock[sizeof(bigBlock) - 1 - i] == 0; i++)
+            ;
+        if (i == 32) {
+            WH_ERROR_PRINT("RNG block not filled\n");
+            ret = -1;
+            goto exit;
+        }
+    }
     printf("RNG SUCCESS\n");
     /* test cache/export */
     keyId = 0;
@@ -235,6 +563,42 @@ int whTest_CryptoClientConfig(whClientConfig* config)
         goto exit;
     }
     printf("KEY ERASE SUCCESS\n");
+    /* test cache lookups with several keys resident at once */
+    for (i = 0; i < WH_TEST_CACHE_KEYS; i++) {
+        keyIds[i] = 0;
+        key[0] = (uint8_t)i;
+        if ((ret = wh_Client_KeyCache(client, 0, labelStart, sizeof(labelStart), key, sizeof(key), &keyIds[i])) != 0) {
+            WH_ERROR_PRINT("Failed to wh_Client_KeyCache %d\n", ret);
+            goto exit;
+        }
+    }
+    /* commit them all in one batch, then read each back from nvm */
+    if ((ret = wh_Client_KeyCommitMany(client, WH_TEST_CACHE_KEYS, keyIds)) != 0) {
+        WH_ERROR_PRINT("Failed to wh_Client_KeyCommitMany %d\n", ret);
+        goto exit;
+    }
+    for (i = WH_TEST_CACHE_KEYS - 1; i >= 0; i--) {
+        key[0] = (uint8_t)i;
+        if ((ret = wh_Client_KeyEvict(client, keyIds[i])) != 0) {
+            WH_ERROR_PRINT("Failed to wh_Client_KeyEvict %d\n", ret);
+            goto exit;
+        }
+        outLen = sizeof(keyEnd);
+        if ((ret = wh_Client_KeyExport(client, keyIds[i], labelEnd, sizeof(labelEnd), keyEnd, &outLen)) != 0) {
+            WH_ERROR_PRINT("Failed to wh_Client_KeyExport %d\n", ret);
+            goto exit;
+        }
+        if (outLen != sizeof(key) || XMEMCMP(key, keyEnd, outLen) != 0) {
+            WH_ERROR_PRINT("KEY CACHE MANY FAILED TO MATCH\n");
+            ret = -1;
+            goto exit;
+        }
+        if ((ret = wh_Client_KeyErase(client, keyIds[i])) != 0) {
+            WH_ERROR_PRINT("Failed to wh_Client_KeyErase %d\n", ret);
+            goto exit;
+        }
+    }
+    printf("KEY CACHE/COMMIT MANY SUCCESS\n");
     /* test aes CBC */
     if((ret = wc_AesInit(aes, NULL, WOLFHSM_DEV_ID)) != 0) {
         printf("Failed to wc_AesInit %d\n", ret);
@@ -327,6 +691,25 @@ int whTest_CryptoClientConfig(whClientConfig* config)
         printf("AES GCM SUCCESS\n");
     else
         printf("AES GCM FAILED TO MATCH\n");
+#if defined(WOLFHSM_SYMMETRIC_INTERNAL) && defined(HAVE_AESGCM) && \
+    defined(WOLFSSL_AESGCM_STREAM)
+    if ((ret = whTest_CryptoCipherSession(client)) != 0) {
+        WH_ERROR_PRINT("Failed to whTest_CryptoCipherSession %d\n", ret);
+        goto exit;
+    }
+#endif
+#if WOLFHSM_SERVER_MAX_HASH_SESSIONS > 0 && !defined(NO_SHA256)
+    if ((ret = whTest_CryptoHashSession(client)) != 0) {
+        WH_ERROR_PRINT("Failed to whTest_CryptoHashSession %d\n", ret);
+        goto exit;
+    }
+#endif
+#if defined(WOLFHSM_SYMMETRIC_INTERNAL) && defined(HAVE_AESGCM)
+    if ((ret = whTest_CryptoCipherDma(client)) != 0) {
+        WH_ERROR_PRINT("Failed to whTest_CryptoCipherDma %d\n", ret);
+        goto exit;
+    }
+#endif
     /* test rsa */
     if((ret = wc_InitRsaKey_ex(rsa, NULL, WOLFHSM_DEV_ID)) != 0) {
         printf("Failed to wc_InitRsaKey_ex %d\n", ret);
@@ -367,6 +750,12 @@ int whTest_CryptoClientConfig(whClientConfig* config)
         printf("RSA SUCCESS\n");
     else
         printf("RSA FAILED TO MATCH\n");
+#ifndef WOLFHSM_SERVER_NO_GROUP_IMAGE
+    if ((ret = whTest_CryptoImageVerifyRsa(client, rng)) != 0) {
+        WH_ERROR_PRINT("Failed to whTest_CryptoImageVerifyRsa %d\n", ret);
+        goto exit;
+    }
+#endif
     /* test ecc */
     if((ret = wc_ecc_init_ex(eccPrivate, NULL, WOLFHSM_DEV_ID)) != 0) {
         printf("Failed to wc_ecc_init_ex %d\n", ret);
@@ -410,6 +799,122 @@ int whTest_CryptoClientConfig(whClientConfig* config)
         printf("ECC SIGN/VERIFY SUCCESS\n");
     else
         printf("ECC SIGN/VERIFY FAIL\n");
+    {
+        whClientEccVerifyItem items[3];
+        uint8_t badSig[256];
+        uint32_t batchRes = 0;
+        memcpy(badSig, finalText, outLen);
+        badSig[outLen - 1] ^= 1;
+        for (i = 0; i < 3; i++) {
+            items[i].sig = (uint8_t*)finalText;
+            items[i].sigSz = outLen;
+            items[i].hash = (uint8_t*)cipherText;
+            items[i].hashSz = 32;
+            items[i].keyId = (intptr_t)eccPrivate->devCtx;
+        }
+        items[1].sig = badSig;
+        if ((ret = wh_Client_EccVerifyBatch(client,
+                wc_ecc_get_curve_id(eccPrivate->idx), items,
+                3, &batchRes)) != 0) {
+            WH_ERROR_PRINT("Failed to wh_Client_EccVerifyBatch %d\n", ret);
+            goto exit;
+        }
+        if (batchRes != 0x5) {
+            WH_ERROR_PRINT("ECC VERIFY BATCH FAIL %x\n", (unsigned)batchRes);
+            ret = -1;
+            goto exit;
+        }
+        printf("ECC VERIFY BATCH SUCCESS\n");
+    }
+    {
+        /* split sign and verify, nothing else is sent in between here but a
+         * scheduler could run other work before each response */
+        uint8_t sig[256];
+        uint32_t sigSz = sizeof(sig);
+        whNvmId eccKeyId = (whNvmId)((intptr_t)eccPrivate->devCtx);
+        int curveId = wc_ecc_get_curve_id(eccPrivate->idx);
+        res = 0;
+        WH_TEST_RETURN_ON_FAIL(wh_Client_EccSignRequest(client, eccKeyId,
+            curveId, (uint8_t*)cipherText, 32));
+        do {
+            ret = wh_Client_EccSignResponse(client, sig, &sigSz);
+        } while (ret == WH_ERROR_NOTREADY);
+        if (ret != 0) {
+            WH_ERROR_PRINT("Failed to wh_Client_EccSignResponse %d\n", ret);
+            goto exit;
+        }
+        WH_TEST_RETURN_ON_FAIL(wh_Client_EccVerifyRequest(client, eccKeyId,
+            curveId, sig, sigSz, (uint8_t*)cipherText, 32));
+        do {
+            ret = wh_Client_EccVerifyResponse(client, &res);
+        } while (ret == WH_ERROR_NOTREADY);
+        if (ret != 0 || res != 1) {
+            WH_ERROR_PRINT("ECC SPLIT SIGN/VERIFY FAIL %d %d\n", ret, res);
+            ret = (ret != 0) ? ret : -1;
+            goto exit;
+        }
+        printf("ECC SPLIT SIGN/VERIFY SUCCESS\n");
+    }
+#ifndef WOLFHSM_SERVER_NO_GROUP_IMAGE
+    {
+        /* sign the digest of an image larger than several dma chunks, then
+         * have the server hash and verify it in one request */
+        static uint8_t image[3 * WOLFHSM_SERVER_IMAGE_CHUNK_SZ + 100];
+        uint8_t digest[WC_SHA256_DIGEST_SIZE];
+        uint8_t sig[256];
+        uint32_t sigSz = sizeof(sig);
+        whNvmId eccKeyId = (whNvmId)((intptr_t)eccPrivate->devCtx);
+        int curveId = wc_ecc_get_curve_id(eccPrivate->idx);
+        wc_Sha256 sha[1];
+        for (i = 0; i < (int)sizeof(image); i++)
+            image[i] = (uint8_t)(i * 3);
+        WH_TEST_RETURN_ON_FAIL(wc_InitSha256_ex(sha, NULL, INVALID_DEVID));
+        WH_TEST_RETURN_ON_FAIL(wc_Sha256Update(sha, image, sizeof(image)));
+        WH_TEST_RETURN_ON_FAIL(wc_Sha256Final(sha, digest));
+        wc_Sha256Free(sha);
+        WH_TEST_RETURN_ON_FAIL(wh_Client_EccSign(client, eccKeyId, curveId,
+            digest, sizeof(digest), sig, &sigSz));
+        res = 0;
+        WH_TEST_RETURN_ON_FAIL(wh_Client_ImageVerify(client, eccKeyId,
+            WH_IMAGE_SIG_ECC, curveId, WH_HASH_SESSION_SHA256, image,
+            sizeof(image), sig, sigSz, &res));
+        WH_TEST_ASSERT_RETURN(res == 1);
+        /* a change in the last chunk is caught */
+        image[sizeof(image) - 1] ^= 1;
+        WH_TEST_RETURN_ON_FAIL(wh_Client_ImageVerify(client, eccKeyId,
+            WH_IMAGE_SIG_ECC, curveId, WH_HASH_SESSION_SHA256, image,
+            sizeof(image), sig, sigSz, &res));
+        WH_TEST_ASSERT_RETURN(res == 0);
+        image[sizeof(image) - 1] ^= 1;
+#ifdef WOLFSSL_SHA384
+        {
+            /* and again over a SHA-384 digest */
+            uint8_t digest384[WC_SHA384_DIGEST_SIZE];
+            wc_Sha384 sha384[1];
+            WH_TEST_RETURN_ON_FAIL(wc_InitSha384_ex(sha384, NULL,
+                INVALID_DEVID));
+            WH_TEST_RETURN_ON_FAIL(wc_Sha384Update(sha384, image,
+                sizeof(image)));
+            WH_TEST_RETURN_ON_FAIL(wc_Sha384Final(sha384, digest384));
+            wc_Sha384Free(sha384);
+            sigSz = sizeof(sig);
+            WH_TEST_RETURN_ON_FAIL(wh_Client_EccSign(client, eccKeyId,
+                curveId, digest384, sizeof(digest384), sig, &sigSz));
+            res = 0;
+            WH_TEST_RETURN_ON_FAIL(wh_Client_ImageVerify(client, eccKeyId,
+                WH_IMAGE_SIG_ECC, curveId, WH_HASH_SESSION_SHA384, image,
+                sizeof(image), sig, sigSz, &res));
+            WH_TEST_ASSERT_RETURN(res == 1);
+            /* the SHA-256 digest of the image does not match it */
+            WH_TEST_RETURN_ON_FAIL(wh_Client_ImageVerify(client, eccKeyId,
+                WH_IMAGE_SIG_ECC, curveId, WH_HASH_SESSION_SHA256, image,
+                sizeof(image), sig, sigSz, &res));
+            WH_TEST_ASSERT_RETURN(res == 0);
+        }
+#endif
+        printf("IMAGE VERIFY SUCCESS\n");
+    }
+#endif
     /* test curve25519 */
     if ((ret = wc_curve25519_init_ex(curve25519PrivateKey, NULL, WOLFHSM_DEV_ID)) != 0) {
         WH_ERROR_PRINT("Failed to wc_curve25519_init_ex %d\n", ret);
@@ -508,6 +1013,376 @@ int whTest_CryptoServerConfig(whServerConfig* config)
     return ret;
 }
 
+/* Key cache tests drive the keystore directly on a server, setting the
+ * client id of its comm to act as different clients */
+#define WH_TEST_KEYCACHE_ID(_n) \
+    MAKE_WOLFHSM_KEYID(WOLFHSM_KEYTYPE_CRYPTO, 0, (_n) + 1)
+#define WH_TEST_KEYCACHE_KEY_SZ 16
+
+/* cache a key filled with its own id, committing it if asked */
+static int _whTest_KeyCacheAdd(whServerContext* server, uint8_t clientId,
+    whKeyId keyId, whNvmFlags flags, int commit)
+{
+    int ret;
+    uint8_t key[WH_TEST_KEYCACHE_KEY_SZ];
+    whNvmMetadata meta[1] = {{0}};
+
+    memset(key, (uint8_t)keyId, sizeof(key));
+    meta->id = keyId;
+    meta->flags = flags;
+    meta->len = sizeof(key);
+    server->comm->client_id = clientId;
+    ret = hsmCacheKey(server, meta, key);
+    if ((ret == 0) && (commit != 0)) {
+        ret = hsmCommitKey(server, keyId);
+    }
+    return ret;
+}
+
+/* return the cache slot holding a key of a client, or -1 */
+static int _whTest_KeyCacheSlot(whServerContext* server, uint8_t clientId,
+    whKeyId keyId)
+{
+    int i;
+    keyId |= (whKeyId)(clientId << 8);
+    for (i = 0; i < WOLFHSM_NUM_RAMKEYS; i++) {
+        if (server->cache[i].meta->id == keyId) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* Fill the cache, touch the keys in a known order and check the least
+ * recently used committed key is the one evicted */
+static int _whTest_KeyCacheLru(whServerConfig* config)
+{
+    whServerContext server[1] = {0};
+    uint8_t key[WH_TEST_KEYCACHE_KEY_SZ];
+    uint32_t keySz = sizeof(key);
+    int victim = -1;
+    int i;
+
+    WH_TEST_RETURN_ON_FAIL(wh_Server_Init(server, config));
+    for (i = 0; i < WOLFHSM_NUM_RAMKEYS; i++) {
+        WH_TEST_RETURN_ON_FAIL(_whTest_KeyCacheAdd(server, 1,
+            WH_TEST_KEYCACHE_ID(i), WOLFHSM_NVM_FLAGS_NONE, 1));
+    }
+    WH_TEST_ASSERT_RETURN(server->cacheStats.hits == 0);
+    WH_TEST_ASSERT_RETURN(server->cacheStats.misses == 0);
+    WH_TEST_ASSERT_RETURN(server->cacheStats.evictions == 0);
+
+    /* touch the keys last to first, leaving the last the least recent */
+    for (i = WOLFHSM_NUM_RAMKEYS - 1; i >= 0; i--) {
+        WH_TEST_ASSERT_RETURN(
+            hsmFreshenKey(server, WH_TEST_KEYCACHE_ID(i)) >= 0);
+    }
+    WH_TEST_ASSERT_RETURN(server->cacheStats.hits == WOLFHSM_NUM_RAMKEYS);
+    WH_TEST_ASSERT_RETURN(server->cacheStats.misses == 0);
+
+    /* a new key takes the slot of the least recently used one */
+    WH_TEST_RETURN_ON_FAIL(_whTest_KeyCacheAdd(server, 1,
+        WH_TEST_KEYCACHE_ID(WOLFHSM_NUM_RAMKEYS), WOLFHSM_NVM_FLAGS_NONE, 0));
+    WH_TEST_ASSERT_RETURN(server->cacheStats.evictions == 1);
+    for (i = 0; i < WOLFHSM_NUM_RAMKEYS; i++) {
+        if (_whTest_KeyCacheSlot(server, 1, WH_TEST_KEYCACHE_ID(i)) < 0) {
+            if (victim >= 0) {
+                return WH_TEST_FAIL;
+            }
+            victim = i;
+        }
+    }
+#if WOLFHSM_KEYCACHE_EVICT == WOLFHSM_KEYCACHE_EVICT_LRU
+    WH_TEST_ASSERT_RETURN(victim == WOLFHSM_NUM_RAMKEYS - 1);
+#else
+    WH_TEST_ASSERT_RETURN(victim >= 0);
+#endif
+
+    /* reading the evicted key misses, reloads it and evicts the next least
+     * recently used, the uncommitted key is never a victim */
+    WH_TEST_RETURN_ON_FAIL(hsmReadKey(server,
+        WH_TEST_KEYCACHE_ID(victim), NULL, key, &keySz));
+    WH_TEST_ASSERT_RETURN(keySz == sizeof(key));
+    WH_TEST_ASSERT_RETURN(key[0] == (uint8_t)WH_TEST_KEYCACHE_ID(victim));
+    WH_TEST_ASSERT_RETURN(server->cacheStats.hits == WOLFHSM_NUM_RAMKEYS);
+    WH_TEST_ASSERT_RETURN(server->cacheStats.misses == 1);
+    WH_TEST_ASSERT_RETURN(server->cacheStats.evictions == 2);
+    WH_TEST_ASSERT_RETURN(_whTest_KeyCacheSlot(server, 1,
+        WH_TEST_KEYCACHE_ID(WOLFHSM_NUM_RAMKEYS)) >= 0);
+    WH_TEST_ASSERT_RETURN(_whTest_KeyCacheSlot(server, 1,
+        WH_TEST_KEYCACHE_ID(victim)) >= 0);
+#if WOLFHSM_KEYCACHE_EVICT == WOLFHSM_KEYCACHE_EVICT_LRU
+    WH_TEST_ASSERT_RETURN(_whTest_KeyCacheSlot(server, 1,
+        WH_TEST_KEYCACHE_ID(WOLFHSM_NUM_RAMKEYS - 2)) < 0);
+#endif
+
+    /* the read is now a hit */
+    WH_TEST_RETURN_ON_FAIL(hsmReadKey(server,
+        WH_TEST_KEYCACHE_ID(victim), NULL, key, &keySz));
+    WH_TEST_ASSERT_RETURN(server->cacheStats.hits == WOLFHSM_NUM_RAMKEYS + 1);
+    WH_TEST_ASSERT_RETURN(server->cacheStats.misses == 1);
+    WH_TEST_ASSERT_RETURN(server->cacheStats.evictions == 2);
+
+    return wh_Server_Cleanup(server);
+}
+
+/* Check preloaded and pinned keys are resident after init, are never
+ * evicted and leave NOSPACE once they alone fill the cache */
+static int _whTest_KeyCachePinned(whServerConfig* config)
+{
+    whServerContext server[1] = {0};
+    whServerConfig conf[1];
+    whKeyId preload[WOLFHSM_NUM_RAMKEYS];
+    uint8_t key[WH_TEST_KEYCACHE_KEY_SZ];
+    uint32_t keySz = sizeof(key);
+    uint32_t misses;
+    int i;
+
+    /* commit a full cache of keys, the first flagged pinned */
+    WH_TEST_RETURN_ON_FAIL(wh_Server_Init(server, config));
+    for (i = 0; i < WOLFHSM_NUM_RAMKEYS; i++) {
+        WH_TEST_RETURN_ON_FAIL(_whTest_KeyCacheAdd(server, 1,
+            WH_TEST_KEYCACHE_ID(i),
+            (i == 0) ? WOLFHSM_NVM_FLAGS_PINNED : WOLFHSM_NVM_FLAGS_NONE, 1));
+    }
+    WH_TEST_RETURN_ON_FAIL(wh_Server_Cleanup(server));
+
+    /* restart preloading the second, the flagged key comes in as well */
+    for (i = 0; i < WOLFHSM_NUM_RAMKEYS; i++) {
+        preload[i] = WH_TEST_KEYCACHE_ID(i) | (whKeyId)(1 << 8);
+    }
+    *conf = *config;
+    conf->preload_keys = &preload[1];
+    conf->preload_count = 1;
+    WH_TEST_RETURN_ON_FAIL(wh_Server_Init(server, conf));
+    for (i = 0; i < WOLFHSM_NUM_RAMKEYS; i++) {
+        if (i < 2) {
+            WH_TEST_ASSERT_RETURN(_whTest_KeyCacheSlot(server, 1,
+                WH_TEST_KEYCACHE_ID(i)) >= 0);
+            WH_TEST_ASSERT_RETURN(server->cache[_whTest_KeyCacheSlot(server,
+                1, WH_TEST_KEYCACHE_ID(i))].pinned == 1);
+        }
+        else {
+            WH_TEST_ASSERT_RETURN(_whTest_KeyCacheSlot(server, 1,
+                WH_TEST_KEYCACHE_ID(i)) < 0);
+        }
+    }
+
+    /* fill the rest of the cache, leaving the pinned keys least recently
+     * used, then push out unpinned keys with one more */
+    server->comm->client_id = 1;
+    for (i = 2; i < WOLFHSM_NUM_RAMKEYS; i++) {
+        WH_TEST_ASSERT_RETURN(
+            hsmFreshenKey(server, WH_TEST_KEYCACHE_ID(i)) >= 0);
+    }
+    WH_TEST_ASSERT_RETURN(server->cacheStats.evictions == 0);
+    WH_TEST_RETURN_ON_FAIL(_whTest_KeyCacheAdd(server, 1,
+        WH_TEST_KEYCACHE_ID(WOLFHSM_NUM_RAMKEYS), WOLFHSM_NVM_FLAGS_NONE, 1));
+    WH_TEST_ASSERT_RETURN(server->cacheStats.evictions == 1);
+    /* cycling through the unpinned keys evicts once per miss */
+    misses = server->cacheStats.misses;
+    for (i = 2; i < WOLFHSM_NUM_RAMKEYS; i++) {
+        WH_TEST_ASSERT_RETURN(
+            hsmFreshenKey(server, WH_TEST_KEYCACHE_ID(i)) >= 0);
+    }
+    WH_TEST_ASSERT_RETURN(server->cacheStats.misses > misses);
+    WH_TEST_ASSERT_RETURN(server->cacheStats.evictions ==
+        1 + server->cacheStats.misses - misses);
+    WH_TEST_ASSERT_RETURN(_whTest_KeyCacheSlot(server, 1,
+        WH_TEST_KEYCACHE_ID(0)) >= 0);
+    WH_TEST_ASSERT_RETURN(_whTest_KeyCacheSlot(server, 1,
+        WH_TEST_KEYCACHE_ID(1)) >= 0);
+    WH_TEST_RETURN_ON_FAIL(wh_Server_Cleanup(server));
+
+    /* pin every slot, there is then nothing to evict */
+    conf->preload_count = WOLFHSM_NUM_RAMKEYS - 1;
+    WH_TEST_RETURN_ON_FAIL(wh_Server_Init(server, conf));
+    for (i = 0; i < WOLFHSM_NUM_RAMKEYS; i++) {
+        WH_TEST_ASSERT_RETURN(server->cache[i].pinned == 1);
+    }
+    WH_TEST_ASSERT_RETURN(_whTest_KeyCacheAdd(server, 1,
+        WH_TEST_KEYCACHE_ID(WOLFHSM_NUM_RAMKEYS + 1), WOLFHSM_NVM_FLAGS_NONE,
+        0) == WH_ERROR_NOSPACE);
+    WH_TEST_ASSERT_RETURN(hsmFreshenKey(server,
+        WH_TEST_KEYCACHE_ID(WOLFHSM_NUM_RAMKEYS)) == WH_ERROR_NOSPACE);
+    /* a committed key is still read, just not cached */
+    WH_TEST_RETURN_ON_FAIL(hsmReadKey(server,
+        WH_TEST_KEYCACHE_ID(WOLFHSM_NUM_RAMKEYS), NULL, key, &keySz));
+    WH_TEST_ASSERT_RETURN(_whTest_KeyCacheSlot(server, 1,
+        WH_TEST_KEYCACHE_ID(WOLFHSM_NUM_RAMKEYS)) < 0);
+    WH_TEST_ASSERT_RETURN(server->cacheStats.evictions == 0);
+
+    return wh_Server_Cleanup(server);
+}
+
+/* return the number of cache slots a client holds */
+static int _whTest_KeyCacheCount(whServerContext* server, uint8_t clientId)
+{
+    int i;
+    int count = 0;
+    for (i = 0; i < WOLFHSM_NUM_RAMKEYS; i++) {
+        if ((server->cache[i].meta->id != WOLFHSM_KEYID_ERASED) &&
+            (((server->cache[i].meta->id & WOLFHSM_KEYUSER_MASK) >> 8) ==
+            clientId)) {
+            count++;
+        }
+    }
+    return count;
+}
+
+/* Check a client at its quota only evicts its own committed keys, keeps
+ * its keys from other clients and that clients without one are unlimited */
+static int _whTest_KeyCacheQuota(whServerConfig* config)
+{
+    whServerContext server[1] = {0};
+    whServerConfig conf[1];
+    uint8_t quota[WH_SERVER_KEYID_MAP_USERS] = {0};
+    uint32_t evictions;
+    int i;
+
+    /* client 1 holds at most 2 slots, clients 2 and 3 are unlimited */
+    quota[1] = 2;
+    *conf = *config;
+    conf->key_quota = quota;
+    WH_TEST_RETURN_ON_FAIL(wh_Server_Init(server, conf));
+
+    /* at its quota client 1 replaces its own key despite free slots */
+    for (i = 0; i < 3; i++) {
+        WH_TEST_RETURN_ON_FAIL(_whTest_KeyCacheAdd(server, 1,
+            WH_TEST_KEYCACHE_ID(i), WOLFHSM_NVM_FLAGS_NONE, 1));
+    }
+    WH_TEST_ASSERT_RETURN(server->cacheStats.evictions == 1);
+    WH_TEST_ASSERT_RETURN(_whTest_KeyCacheCount(server, 1) == 2);
+    WH_TEST_ASSERT_RETURN(_whTest_KeyCacheSlot(server, 1,
+        WH_TEST_KEYCACHE_ID(2)) >= 0);
+
+    /* with none of its keys committed there is nothing it may evict */
+    WH_TEST_RETURN_ON_FAIL(hsmEvictKey(server, WH_TEST_KEYCACHE_ID(1)));
+    WH_TEST_RETURN_ON_FAIL(hsmEvictKey(server, WH_TEST_KEYCACHE_ID(2)));
+    for (i = 10; i < 12; i++) {
+        WH_TEST_RETURN_ON_FAIL(_whTest_KeyCacheAdd(server, 1,
+            WH_TEST_KEYCACHE_ID(i), WOLFHSM_NVM_FLAGS_NONE, 0));
+    }
+    WH_TEST_ASSERT_RETURN(_whTest_KeyCacheAdd(server, 1,
+        WH_TEST_KEYCACHE_ID(12), WOLFHSM_NVM_FLAGS_NONE, 0) ==
+        WH_ERROR_NOSPACE);
+    WH_TEST_ASSERT_RETURN(hsmFreshenKey(server, WH_TEST_KEYCACHE_ID(1)) ==
+        WH_ERROR_NOSPACE);
+    WH_TEST_ASSERT_RETURN(server->cacheStats.evictions == 1);
+
+    /* back to two committed keys, then client 2 takes every other slot */
+    WH_TEST_RETURN_ON_FAIL(hsmEvictKey(server, WH_TEST_KEYCACHE_ID(10)));
+    WH_TEST_RETURN_ON_FAIL(hsmEvictKey(server, WH_TEST_KEYCACHE_ID(11)));
+    WH_TEST_ASSERT_RETURN(hsmFreshenKey(server, WH_TEST_KEYCACHE_ID(1)) >= 0);
+    WH_TEST_ASSERT_RETURN(hsmFreshenKey(server, WH_TEST_KEYCACHE_ID(2)) >= 0);
+    for (i = 0; i < WOLFHSM_NUM_RAMKEYS - 2; i++) {
+        WH_TEST_RETURN_ON_FAIL(_whTest_KeyCacheAdd(server, 2,
+            WH_TEST_KEYCACHE_ID(i), WOLFHSM_NVM_FLAGS_NONE, 0));
+    }
+    WH_TEST_ASSERT_RETURN(_whTest_KeyCacheCount(server, 2) ==
+        WOLFHSM_NUM_RAMKEYS - 2);
+
+    /* client 2 may not evict the committed keys of client 1 */
+    evictions = server->cacheStats.evictions;
+    WH_TEST_ASSERT_RETURN(_whTest_KeyCacheAdd(server, 2,
+        WH_TEST_KEYCACHE_ID(WOLFHSM_NUM_RAMKEYS), WOLFHSM_NVM_FLAGS_NONE,
+        0) == WH_ERROR_NOSPACE);
+    WH_TEST_ASSERT_RETURN(server->cacheStats.evictions == evictions);
+    WH_TEST_ASSERT_RETURN(_whTest_KeyCacheCount(server, 1) == 2);
+
+    /* keys of a client without a quota are evicted by anyone as before */
+    server->comm->client_id = 2;
+    WH_TEST_RETURN_ON_FAIL(hsmEvictKey(server, WH_TEST_KEYCACHE_ID(0)));
+    WH_TEST_RETURN_ON_FAIL(_whTest_KeyCacheAdd(server, 3,
+        WH_TEST_KEYCACHE_ID(0), WOLFHSM_NVM_FLAGS_NONE, 1));
+    WH_TEST_RETURN_ON_FAIL(_whTest_KeyCacheAdd(server, 2,
+        WH_TEST_KEYCACHE_ID(WOLFHSM_NUM_RAMKEYS), WOLFHSM_NVM_FLAGS_NONE, 0));
+    WH_TEST_ASSERT_RETURN(server->cacheStats.evictions == evictions + 1);
+    WH_TEST_ASSERT_RETURN(_whTest_KeyCacheCount(server, 3) == 0);
+    WH_TEST_ASSERT_RETURN(_whTest_KeyCacheCount(server, 1) == 2);
+
+    /* even those are off limits to a client at its quota */
+    server->comm->client_id = 1;
+    WH_TEST_RETURN_ON_FAIL(hsmEvictKey(server, WH_TEST_KEYCACHE_ID(1)));
+    WH_TEST_RETURN_ON_FAIL(hsmEvictKey(server, WH_TEST_KEYCACHE_ID(2)));
+    for (i = 10; i < 12; i++) {
+        WH_TEST_RETURN_ON_FAIL(_whTest_KeyCacheAdd(server, 1,
+            WH_TEST_KEYCACHE_ID(i), WOLFHSM_NVM_FLAGS_NONE, 0));
+    }
+    server->comm->client_id = 2;
+    WH_TEST_RETURN_ON_FAIL(hsmEvictKey(server,
+        WH_TEST_KEYCACHE_ID(WOLFHSM_NUM_RAMKEYS)));
+    WH_TEST_RETURN_ON_FAIL(_whTest_KeyCacheAdd(server, 3,
+        WH_TEST_KEYCACHE_ID(1), WOLFHSM_NVM_FLAGS_NONE, 1));
+    WH_TEST_ASSERT_RETURN(_whTest_KeyCacheAdd(server, 1,
+        WH_TEST_KEYCACHE_ID(12), WOLFHSM_NVM_FLAGS_NONE, 0) ==
+        WH_ERROR_NOSPACE);
+    WH_TEST_ASSERT_RETURN(_whTest_KeyCacheSlot(server, 3,
+        WH_TEST_KEYCACHE_ID(1)) >= 0);
+
+    return wh_Server_Cleanup(server);
+}
+
+/* Run each key cache test on a server over freshly erased NVM */
+static int whTest_CryptoKeyCache(void)
+{
+    uint8_t req[BUFFER_SIZE] = {0};
+    uint8_t resp[BUFFER_SIZE] = {0};
+    whTransportMemConfig tmcf[1] = {{
+        .req       = (whTransportMemCsr*)req,
+        .req_size  = sizeof(req),
+        .resp      = (whTransportMemCsr*)resp,
+        .resp_size = sizeof(resp),
+    }};
+    whTransportServerCb         tscb[1]   = {WH_TRANSPORT_MEM_SERVER_CB};
+    whTransportMemServerContext tmsc[1]   = {0};
+    whCommServerConfig          cs_conf[1] = {{
+                 .transport_cb      = tscb,
+                 .transport_context = (void*)tmsc,
+                 .transport_config  = (void*)tmcf,
+                 .server_id         = 124,
+    }};
+    whFlashRamsimCtx fc[1] = {0};
+    whFlashRamsimCfg fc_conf[1] = {{
+        .size       = 1024 * 1024, /* 1MB  Flash */
+        .sectorSize = 128 * 1024,  /* 128KB  Sector Size */
+        .pageSize   = 8,           /* 8B   Page Size */
+        .erasedByte = ~(uint8_t)0,
+    }};
+    const whFlashCb  fcb[1]          = {WH_FLASH_RAMSIM_CB};
+    whNvmFlashConfig nf_conf[1] = {{
+        .cb      = fcb,
+        .context = fc,
+        .config  = fc_conf,
+    }};
+    whNvmFlashContext nfc[1] = {0};
+    whNvmCb nfcb[1] = {WH_NVM_FLASH_CB};
+    whNvmConfig n_conf[1] = {{
+            .cb = nfcb,
+            .context = nfc,
+            .config = nf_conf,
+    }};
+    whNvmContext nvm[1] = {{0}};
+    whServerConfig s_conf[1] = {{
+       .comm_config = cs_conf,
+       .nvm = nvm,
+    }};
+    int (*tests[])(whServerConfig*) = {
+        _whTest_KeyCacheLru,
+        _whTest_KeyCachePinned,
+        _whTest_KeyCacheQuota,
+    };
+    int ret = 0;
+    size_t i;
+
+    for (i = 0; (ret == 0) && (i < sizeof(tests) / sizeof(tests[0])); i++) {
+        WH_TEST_RETURN_ON_FAIL(wh_Nvm_Init(nvm, n_conf));
+        ret = tests[i](s_conf);
+        (void)wh_Nvm_Cleanup(nvm);
+    }
+    return ret;
+}
+
 #if defined(WH_CFG_TEST_POSIX)
 static void* _whClientTask(void *cf)
 {
@@ -635,6 +1510,8 @@ static int wh_ClientServer_MemThreadTest(void)
 
 int whTest_Crypto(void)
 {
+    printf("Testing crypto: key cache...\n");
+    WH_TEST_RETURN_ON_FAIL(whTest_CryptoKeyCache());
 #if defined(WH_CFG_TEST_POSIX)
     printf("Testing crypto: (pthread) mem...\n");
     WH_TEST_RETURN_ON_FAIL(wh_ClientServer_MemThreadTest());
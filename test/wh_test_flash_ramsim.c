@@ -29,6 +29,7 @@
 #define TEST_PAGE_SIZE (256)
 
 static void fillTestData(uint8_t* buffer, uint32_t size, uint32_t baseValue);
+static int  testCostModel(void);
 #if defined(WH_TEST_FLASH_RAMSIM_DEBUG)
 static void printMemory(uint8_t* buffer, uint32_t size, uint32_t offset);
 #endif
@@ -53,6 +54,52 @@ static void printMemory(uint8_t* buffer, uint32_t size, uint32_t offset)
 }
 #endif /* WH_TEST_FLASH_RAMSIM_DEBUG */
 
+/* Each operation advances the stats and the shared clock by its cost */
+static int testCostModel(void)
+{
+    whFlashRamsimCtx   ctx;
+    whFlashRamsimStats stats;
+    uint64_t           clockNs = 1000;
+    whFlashRamsimCfg   cfg     = {.size             = TEST_SECTOR_SIZE * 2,
+                                  .sectorSize       = TEST_SECTOR_SIZE,
+                                  .pageSize         = TEST_PAGE_SIZE,
+                                  .erasedByte       = 0xFF,
+                                  .readNsPerByte    = 2,
+                                  .programNsPerPage = 300,
+                                  .eraseNsPerSector = 50000,
+                                  .clockNs          = &clockNs};
+    uint8_t            data[TEST_PAGE_SIZE * 2] = {0};
+
+    WH_TEST_RETURN_ON_FAIL(whFlashRamsim_Init(&ctx, &cfg));
+    WH_TEST_RETURN_ON_FAIL(
+        whFlashRamsim_Erase(&ctx, 0, TEST_SECTOR_SIZE * 2));
+    WH_TEST_RETURN_ON_FAIL(whFlashRamsim_Program(&ctx, 0, sizeof(data), data));
+    WH_TEST_RETURN_ON_FAIL(whFlashRamsim_Read(&ctx, 0, 100, data));
+    WH_TEST_RETURN_ON_FAIL(whFlashRamsim_Verify(&ctx, 0, 10, data));
+    WH_TEST_RETURN_ON_FAIL(whFlashRamsim_BlankCheck(
+        &ctx, TEST_SECTOR_SIZE, TEST_SECTOR_SIZE));
+
+    /* Failed operations cost nothing */
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOTBLANK ==
+                          whFlashRamsim_Program(&ctx, 0, sizeof(data), data));
+
+    WH_TEST_RETURN_ON_FAIL(whFlashRamsim_GetStats(&ctx, &stats));
+    WH_TEST_ASSERT_RETURN(stats.erases == 1 && stats.eraseSectors == 2);
+    WH_TEST_ASSERT_RETURN(stats.programs == 1 && stats.programPages == 2);
+    WH_TEST_ASSERT_RETURN(stats.reads == 1 && stats.readBytes == 100);
+    WH_TEST_ASSERT_RETURN(stats.verifies == 1 && stats.blankChecks == 1);
+    WH_TEST_ASSERT_RETURN(stats.timeNs == 2 * 50000 + 2 * 300 +
+                                              (100 + 10 + TEST_SECTOR_SIZE) * 2);
+    WH_TEST_ASSERT_RETURN(clockNs == 1000 + stats.timeNs);
+
+    WH_TEST_RETURN_ON_FAIL(whFlashRamsim_ResetStats(&ctx));
+    WH_TEST_RETURN_ON_FAIL(whFlashRamsim_GetStats(&ctx, &stats));
+    WH_TEST_ASSERT_RETURN(stats.timeNs == 0 && stats.reads == 0);
+
+    whFlashRamsim_Cleanup(&ctx);
+    return 0;
+}
+
 
 int whTest_Flash_RamSim(void)
 {
@@ -194,5 +241,5 @@ int whTest_Flash_RamSim(void)
 
     whFlashRamsim_Cleanup(&ctx);
 
-    return 0;
+    return testCostModel();
 }
@@ -37,8 +37,16 @@
 #include <unistd.h>  /* For unlink */
 #include "port/posix/posix_transport_tcp.h"
 #include "port/posix/posix_flash_file.h"
+#include "port/posix/posix_flash_mmap.h"
 #endif
 
+/* Partitions are kept small to exercise compaction, but must still fit the
+ * larger directories of the WOLFHSM_PROFILE_LARGE sizes */
+#define TEST_SECTOR_SIZE \
+    ((WOLFHSM_NUM_NVMOBJECTS > 32) ? 64 * 1024 : 4096)
+#define TEST_FILE_PARTITION_SIZE \
+    ((WOLFHSM_NUM_NVMOBJECTS > 32) ? 64 * 1024 : 16384)
+
 #if defined(WH_CFG_TEST_VERBOSE)
 static void _HexDump(const char* p, size_t data_len)
 {
@@ -138,14 +146,23 @@ static int addObjectWithReadBackCheck(const whNvmCb*     cb,
                                       const uint8_t* data)
 
 {
-    whNvmMetadata metaBuf = {0};
-    unsigned char dataBuf[256];
+    whNvmMetadata  metaBuf = {0};
+    unsigned char  dataBuf[256];
+    const uint8_t* mapped = NULL;
+    int            rc     = 0;
 
     WH_TEST_RETURN_ON_FAIL(cb->AddObject(context, meta, data_len, data));
     WH_TEST_RETURN_ON_FAIL(cb->Read(context, meta->id, 0, data_len, dataBuf));
     WH_TEST_RETURN_ON_FAIL(cb->GetMetadata(context, meta->id, &metaBuf));
     WH_TEST_ASSERT_RETURN(meta->id == metaBuf.id);
     WH_TEST_ASSERT_RETURN(0 == memcmp(data, dataBuf, data_len));
+
+    /* Memory mapped flash also hands out the data in place */
+    rc = cb->ReadPointer(context, meta->id, 0, data_len, &mapped);
+    if (rc != WH_ERROR_NOTIMPL) {
+        WH_TEST_RETURN_ON_FAIL(rc);
+        WH_TEST_ASSERT_RETURN(0 == memcmp(data, mapped, data_len));
+    }
     return 0;
 }
 
@@ -266,6 +283,29 @@ int whTest_NvmFlashCfg(whNvmFlashConfig* cfg)
     _ShowList(cb, context);
 #endif
 
+#ifdef WOLFHSM_NVM_STATS
+    /* Every add was counted once, and the reclaim copied and erased */
+    {
+        whNvmStats stats = {0};
+
+        WH_TEST_RETURN_ON_FAIL(cb->GetStats(context, &stats));
+        WH_TEST_ASSERT_RETURN(stats.data_bytes ==
+                              sizeof(data1) + sizeof(data2) + sizeof(data3) +
+                              sizeof(update1) + sizeof(update2) +
+                              sizeof(update3));
+        WH_TEST_ASSERT_RETURN(stats.program_bytes > stats.data_bytes);
+        WH_TEST_ASSERT_RETURN(stats.program_ops > 0);
+        WH_TEST_ASSERT_RETURN(stats.blank_checks >= stats.program_ops);
+        WH_TEST_ASSERT_RETURN(stats.compactions == 1);
+        WH_TEST_ASSERT_RETURN(stats.erase_ops > 0);
+        WH_TEST_ASSERT_RETURN(stats.erase_ops == stats.partition_erases[0] +
+                                                 stats.partition_erases[1]);
+        WH_TEST_ASSERT_RETURN(stats.erase_bytes ==
+                              (uint64_t)stats.erase_ops *
+                              cfg->cb->PartitionSize(cfg->context));
+    }
+#endif
+
     /* Ensure reclamation doesn't destroy active objects */
     {
         whNvmMetadata metaBuf = {0};
@@ -310,6 +350,366 @@ int whTest_NvmFlashCfg(whNvmFlashConfig* cfg)
     _ShowList(cb, context);
 #endif
 
+    /* Add a batch of objects in one pass */
+    printf("--Add 3 objects in one batch\n");
+    {
+        whNvmMetadata batch[3] = {{0}};
+        const uint8_t* batchData[3] = {update1, data2, update3};
+        whNvmMetadata metaBuf = {0};
+        unsigned char dataBuf[256];
+        size_t i = 0;
+
+        for (i = 0; i < 3; i++) {
+            batch[i].id = ids[i];
+        }
+        batch[0].len = sizeof(update1);
+        batch[1].len = sizeof(data2);
+        batch[2].len = sizeof(update3);
+
+        /* Duplicate ids are rejected without adding anything */
+        batch[2].id = ids[0];
+        if ((ret = cb->AddObjects(context, 3, batch, batchData)) !=
+                WH_ERROR_BADARGS) {
+            WH_ERROR_PRINT("AddObjects with duplicates returned %d\n", ret);
+            ret = WH_TEST_FAIL;
+            goto cleanup;
+        }
+        if (cb->GetMetadata(context, ids[0], &metaBuf) != WH_ERROR_NOTFOUND) {
+            ret = WH_TEST_FAIL;
+            goto cleanup;
+        }
+        batch[2].id = ids[2];
+
+        if ((ret = cb->AddObjects(context, 3, batch, batchData)) != 0) {
+            goto cleanup;
+        }
+        for (i = 0; i < 3; i++) {
+            if (    ((ret = cb->GetMetadata(context, ids[i], &metaBuf)) != 0) ||
+                    ((ret = cb->Read(context, ids[i], 0, metaBuf.len,
+                                        dataBuf)) != 0) ) {
+                WH_ERROR_PRINT("Read after batch add returned %d\n", ret);
+                goto cleanup;
+            }
+            if (    (metaBuf.len != batch[i].len) ||
+                    (memcmp(dataBuf, batchData[i], metaBuf.len) != 0) ) {
+                ret = WH_TEST_FAIL;
+                goto cleanup;
+            }
+        }
+    }
+
+#if defined(WH_CFG_TEST_VERBOSE)
+    _ShowAvailable(cb, context);
+    _ShowList(cb, context);
+#endif
+
+    /* Ids a multiple of the index size apart share a hash chain */
+    printf("--Add and destroy colliding ids\n");
+    {
+        whNvmId chain[3] = {1, 1 + NF_INDEX_COUNT, 1 + 2 * NF_INDEX_COUNT};
+        whNvmMetadata metaBuf = {0};
+        unsigned char dataBuf[256];
+        size_t i = 0;
+
+        for (i = 0; i < 3; i++) {
+            whNvmMetadata meta = {.id = chain[i], .label = "Chain"};
+            ret = addObjectWithReadBackCheck(cb, context, &meta,
+                                             sizeof(data1), data1);
+            if (ret != 0) {
+                goto cleanup;
+            }
+        }
+        /* Removing the middle of the chain must leave the tail reachable */
+        if ((ret = destroyObjectWithReadBackCheck(cb, context, 1,
+                                                  &chain[1])) != 0) {
+            goto cleanup;
+        }
+        {
+            whNvmMetadata meta = {.id = chain[2], .label = "Chain"};
+            ret = addObjectWithReadBackCheck(cb, context, &meta,
+                                             sizeof(update2), update2);
+            if (ret != 0) {
+                goto cleanup;
+            }
+        }
+        if (    ((ret = cb->GetMetadata(context, chain[0], &metaBuf)) != 0) ||
+                ((ret = cb->Read(context, chain[0], 0, metaBuf.len,
+                                    dataBuf)) != 0) ) {
+            WH_ERROR_PRINT("Read of chain head returned %d\n", ret);
+            goto cleanup;
+        }
+    }
+
+    /* Tombstones survive a reload of the directory, compaction drops them in
+     * bounded background steps */
+    printf("--Reload and compact tombstones\n");
+    {
+        whFlashCb         reloadCb   = *cfg->cb;
+        whNvmFlashConfig  reloadCfg  = *cfg;
+        whNvmFlashContext reload[1]  = {0};
+        whNvmMetadata     metaBuf    = {0};
+        whNvmId           chainHead  = 1;
+        whNvmId           reclaimObj = 0;
+        whNvmId           availObj   = 0;
+        whNvmId           reloadObj[2];
+        int               steps      = 0;
+        unsigned char     dataBuf[256];
+
+        if ((ret = cb->DestroyObjects(context, 1, &chainHead)) != 0) {
+            goto cleanup;
+        }
+
+        /* Parse the same flash again without reinitializing the device */
+        reloadCb.Init    = NULL;
+        reloadCb.Cleanup = NULL;
+        reloadCfg.cb     = &reloadCb;
+        if ((ret = cb->Init(reload, &reloadCfg)) != 0) {
+            goto cleanup;
+        }
+        if (    (cb->GetMetadata(reload, chainHead, &metaBuf) !=
+                    WH_ERROR_NOTFOUND) ||
+                (cb->GetMetadata(reload, 1 + 2 * NF_INDEX_COUNT, &metaBuf) !=
+                    0) ) {
+            WH_ERROR_PRINT("Tombstone not recovered after reload\n");
+            ret = WH_TEST_FAIL;
+            goto cleanup;
+        }
+        /* The reloaded directory, checkpointed or not, matches the live one */
+        (void)cb->GetAvailable(context, NULL, &availObj, NULL, &reclaimObj);
+        (void)cb->GetAvailable(reload, NULL, &reloadObj[0], NULL,
+                               &reloadObj[1]);
+        if ((availObj != reloadObj[0]) || (reclaimObj != reloadObj[1])) {
+            WH_ERROR_PRINT("Reloaded directory differs\n");
+            ret = WH_TEST_FAIL;
+            goto cleanup;
+        }
+
+        /* Enough is reclaimable that the destroys queued a compaction.
+         * Reads between steps wait out any erase still outstanding */
+        while ((ret = cb->CompactStep(context)) == WH_ERROR_NOTREADY) {
+            steps++;
+            if (    (cb->GetMetadata(context, 1 + 2 * NF_INDEX_COUNT,
+                                     &metaBuf) != 0) ||
+                    (cb->Read(context, 1 + 2 * NF_INDEX_COUNT, 0, metaBuf.len,
+                              dataBuf) != 0) ) {
+                WH_ERROR_PRINT("Read during compaction step %d failed\n",
+                               steps);
+                ret = WH_TEST_FAIL;
+                goto cleanup;
+            }
+        }
+        if ((ret != 0) || (steps < 2)) {
+            WH_ERROR_PRINT("CompactStep returned %d after %d steps\n", ret,
+                           steps);
+            ret = WH_TEST_FAIL;
+            goto cleanup;
+        }
+        if (    (cb->GetMetadata(context, chainHead, &metaBuf) !=
+                    WH_ERROR_NOTFOUND) ||
+                ((ret = cb->GetMetadata(context, 1 + 2 * NF_INDEX_COUNT,
+                                        &metaBuf)) != 0) ) {
+            WH_ERROR_PRINT("Compaction lost or revived objects\n");
+            ret = WH_TEST_FAIL;
+            goto cleanup;
+        }
+        if ((ret = cb->Compact(context)) != 0) {
+            goto cleanup;
+        }
+        if ((ret = cb->GetAvailable(context, NULL, NULL, NULL,
+                                    &reclaimObj)) != 0) {
+            goto cleanup;
+        }
+        if (reclaimObj != 0) {
+            WH_ERROR_PRINT("Compact left %u reclaimable\n",
+                           (unsigned int)reclaimObj);
+            ret = WH_TEST_FAIL;
+            goto cleanup;
+        }
+    }
+
+    /* A cursor pages through the same ids as List, in directory order, and
+     * is refused once compaction has moved the entries */
+    printf("--List metadata with a cursor\n");
+    {
+        whNvmMetadata metaBuf    = {0};
+        uint32_t      cursor     = 0;
+        whNvmId       listId     = 0;
+        whNvmId       listCount  = 0;
+        whNvmId       got        = 0;
+        whNvmId       total      = 0;
+
+        do {
+            if ((ret = cb->ListMetadata(context, WOLFHSM_NVM_ACCESS_ANY,
+                                        WOLFHSM_NVM_FLAGS_ANY, &cursor, 1,
+                                        &got, &metaBuf)) != 0) {
+                goto cleanup;
+            }
+            if (got == 1) {
+                (void)cb->List(context, WOLFHSM_NVM_ACCESS_ANY,
+                               WOLFHSM_NVM_FLAGS_ANY, listId, &listCount,
+                               &listId);
+                if ((listCount == 0) || (listId != metaBuf.id)) {
+                    WH_ERROR_PRINT("ListMetadata returned id %u, List %u\n",
+                                   (unsigned int)metaBuf.id,
+                                   (unsigned int)listId);
+                    ret = WH_TEST_FAIL;
+                    goto cleanup;
+                }
+                total++;
+            }
+        } while (got == 1);
+        (void)cb->List(context, WOLFHSM_NVM_ACCESS_ANY,
+                       WOLFHSM_NVM_FLAGS_ANY, 0, &listCount, &listId);
+        if ((total == 0) || (total != listCount)) {
+            WH_ERROR_PRINT("ListMetadata found %u of %u\n",
+                           (unsigned int)total, (unsigned int)listCount);
+            ret = WH_TEST_FAIL;
+            goto cleanup;
+        }
+
+        cursor = 0;
+        if (    ((ret = cb->ListMetadata(context, WOLFHSM_NVM_ACCESS_ANY,
+                                         WOLFHSM_NVM_FLAGS_ANY, &cursor, 1,
+                                         &got, &metaBuf)) != 0) ||
+                ((ret = cb->Compact(context)) != 0) ) {
+            goto cleanup;
+        }
+        if ((ret = cb->ListMetadata(context, WOLFHSM_NVM_ACCESS_ANY,
+                                    WOLFHSM_NVM_FLAGS_ANY, &cursor, 1, &got,
+                                    &metaBuf)) != WH_ERROR_ABORTED) {
+            WH_ERROR_PRINT("Stale cursor returned %d\n", ret);
+            ret = WH_TEST_FAIL;
+            goto cleanup;
+        }
+        ret = 0;
+    }
+
+    /* A streamed object replaces the old version only once finished, and
+     * nothing else may modify the store while the stream is open */
+    printf("--Stream an object in pieces\n");
+    {
+        whFlashCb         reloadCb  = *cfg->cb;
+        whNvmFlashConfig  reloadCfg = *cfg;
+        whNvmFlashContext reload[1] = {0};
+        whNvmMetadata     meta      = {.id = 600, .label = "Streamed"};
+        whNvmMetadata     metaBuf   = {0};
+        unsigned char     streamed[1000];
+        unsigned char     dataBuf[sizeof(streamed)];
+        whNvmSize         offset    = 0;
+        whNvmSize         chunk     = 0;
+        size_t            i         = 0;
+
+        for (i = 0; i < sizeof(streamed); i++) {
+            streamed[i] = (unsigned char)(i * 7 + 1);
+        }
+        if (    ((ret = cb->AddObject(context, &meta, sizeof(data1),
+                                      data1)) != 0) ||
+                ((ret = cb->AddObjectBegin(context, &meta,
+                                           sizeof(streamed))) != 0) ) {
+            goto cleanup;
+        }
+        if (    (cb->AddObject(context, &meta1, sizeof(data1), data1) !=
+                    WH_ERROR_NOTREADY) ||
+                (cb->AddObjectBegin(context, &meta1, 8) !=
+                    WH_ERROR_NOTREADY) ||
+                (cb->AddObjectWrite(context, 8, 8, streamed) !=
+                    WH_ERROR_BADARGS) ) {
+            WH_ERROR_PRINT("Store accepted changes during a stream\n");
+            ret = WH_TEST_FAIL;
+            goto cleanup;
+        }
+        while (offset < sizeof(streamed)) {
+            chunk = sizeof(streamed) - offset;
+            if (chunk > 256) {
+                chunk = 256;
+            }
+            if ((ret = cb->AddObjectWrite(context, offset, chunk,
+                                          streamed + offset)) != 0) {
+                goto cleanup;
+            }
+            offset += chunk;
+
+            /* The previous version stays readable until Finish */
+            if (    ((ret = cb->GetMetadata(context, meta.id, &metaBuf)) !=
+                        0) ||
+                    (metaBuf.len != sizeof(data1)) ||
+                    ((ret = cb->Read(context, meta.id, 0, sizeof(data1),
+                                     dataBuf)) != 0) ||
+                    (memcmp(dataBuf, data1, sizeof(data1)) != 0) ) {
+                WH_ERROR_PRINT("Old version lost mid stream: %d\n", ret);
+                ret = WH_TEST_FAIL;
+                goto cleanup;
+            }
+        }
+        if (    ((ret = cb->AddObjectFinish(context, 1)) != 0) ||
+                ((ret = cb->Read(context, meta.id, 0, sizeof(streamed),
+                                 dataBuf)) != 0) ||
+                (memcmp(dataBuf, streamed, sizeof(streamed)) != 0) ) {
+            WH_ERROR_PRINT("Streamed object mismatch: %d\n", ret);
+            ret = WH_TEST_FAIL;
+            goto cleanup;
+        }
+
+        /* An abandoned stream leaves the committed version in place */
+        if (    ((ret = cb->AddObjectBegin(context, &meta, 64)) != 0) ||
+                ((ret = cb->AddObjectWrite(context, 0, 16, dataBuf)) != 0) ||
+                ((ret = cb->AddObjectFinish(context, 0)) != 0) ||
+                ((ret = cb->Read(context, meta.id, 0, sizeof(streamed),
+                                 dataBuf)) != 0) ||
+                (memcmp(dataBuf, streamed, sizeof(streamed)) != 0) ) {
+            WH_ERROR_PRINT("Abandoned stream changed object: %d\n", ret);
+            ret = WH_TEST_FAIL;
+            goto cleanup;
+        }
+
+        /* The unfinished entry is skipped when the flash is parsed again */
+        reloadCb.Init    = NULL;
+        reloadCb.Cleanup = NULL;
+        reloadCfg.cb     = &reloadCb;
+        if (    ((ret = cb->Init(reload, &reloadCfg)) != 0) ||
+                ((ret = cb->Read(reload, meta.id, 0, sizeof(streamed),
+                                 dataBuf)) != 0) ||
+                (memcmp(dataBuf, streamed, sizeof(streamed)) != 0) ) {
+            WH_ERROR_PRINT("Streamed object lost on reload: %d\n", ret);
+            ret = WH_TEST_FAIL;
+            goto cleanup;
+        }
+        if ((ret = destroyObjectWithReadBackCheck(cb, context, 1,
+                                                  &meta.id)) != 0) {
+            goto cleanup;
+        }
+    }
+
+    /* Repeated reads of a small object come from RAM and follow updates */
+    printf("--Cached reads follow updates\n");
+    {
+        whNvmMetadata meta = {.id = 500, .label = "Cached"};
+        unsigned char dataBuf[8];
+        int i = 0;
+
+        if ((ret = cb->AddObject(context, &meta, sizeof(data2), data2)) !=
+                0) {
+            goto cleanup;
+        }
+        for (i = 0; i < 2; i++) {
+            if (    ((ret = cb->Read(context, meta.id, 1, 3, dataBuf)) !=
+                        0) ||
+                    (memcmp(dataBuf, &data2[1], 3) != 0) ) {
+                WH_ERROR_PRINT("Cached read %d returned %d\n", i, ret);
+                ret = WH_TEST_FAIL;
+                goto cleanup;
+            }
+        }
+        if ((ret = addObjectWithReadBackCheck(cb, context, &meta,
+                                              sizeof(data3), data3)) != 0) {
+            goto cleanup;
+        }
+        if ((ret = destroyObjectWithReadBackCheck(cb, context, 1,
+                                                  &meta.id)) != 0) {
+            goto cleanup;
+        }
+    }
+
     printf("--Done\n");
 
 cleanup:
@@ -332,9 +732,10 @@ int whTest_NvmFlash_RamSim(void)
     whFlashRamsimCtx myHalFlashCtx[1] = {0};
     whFlashRamsimCfg myHalFlashCfg[1] = {{
         .size       = 1024 * 1024, /* 1MB  Flash */
-        .sectorSize = 4096,        /* 4KB  Sector Size */
+        .sectorSize = TEST_SECTOR_SIZE,
         .pageSize   = 8,           /* 8B   Page Size */
         .erasedByte = (uint8_t)0,
+        .busyPolls  = 2,           /* Erases stay busy for 2 polls */
     }};
 
     /* NVM Configuration using PosixSim HAL Flash */
@@ -342,12 +743,94 @@ int whTest_NvmFlash_RamSim(void)
         .cb      = myCb,
         .context = myHalFlashCtx,
         .config  = myHalFlashCfg,
+        .compact_objects = 4,
+        .checkpoint = 1,
+        .verify = WHFU_VERIFY_FINISH,
+        .program_page = 256,
     };
 
+    WH_TEST_RETURN_ON_FAIL(whTest_NvmFlashCfg(&myNvmCfg));
 
+    /* Again as memory mapped flash, read in place */
+    myHalFlashCfg->mapped = 1;
     return whTest_NvmFlashCfg(&myNvmCfg);
 }
 
+/* Compact a full directory with checkpoints enabled.  There is no entry to
+ * spare for the checkpoint then, so the objects are copied without one */
+static int whTest_NvmFlash_CompactFull(void)
+{
+    const whFlashCb  myCb[1]          = {WH_FLASH_RAMSIM_CB};
+    whFlashRamsimCtx myHalFlashCtx[1] = {0};
+    whFlashRamsimCfg myHalFlashCfg[1] = {{
+        .size       = 1024 * 1024, /* 1MB  Flash */
+        .sectorSize = TEST_SECTOR_SIZE,
+        .pageSize   = 8,           /* 8B   Page Size */
+        .erasedByte = (uint8_t)0,
+    }};
+    whNvmFlashConfig myNvmCfg = {
+        .cb      = myCb,
+        .context = myHalFlashCtx,
+        .config  = myHalFlashCfg,
+        .checkpoint = 1,
+    };
+    const whNvmCb     cb[1]      = {WH_NVM_FLASH_CB};
+    whNvmFlashContext context[1] = {0};
+    whNvmMetadata     meta       = {0};
+    uint8_t           data[4]    = {0};
+    uint8_t           dataBuf[4] = {0};
+    uint32_t          free_space = 0;
+    whNvmId           free_objects = 0;
+    whNvmId           id = 0;
+    int               ret = 0;
+    int               i = 0;
+
+    WH_TEST_RETURN_ON_FAIL(cb->Init(context, &myNvmCfg));
+
+    for (i = 0; (ret == 0) && (i < NF_OBJECT_COUNT); i++) {
+        meta.id = (whNvmId)(i + 1);
+        memset(data, i, sizeof(data));
+        ret = cb->AddObject(context, &meta, sizeof(data), data);
+    }
+    if (ret == 0) {
+        ret = cb->GetAvailable(context, &free_space, &free_objects, NULL,
+                NULL);
+    }
+    if ((ret == 0) && (free_objects != 0)) {
+        ret = WH_TEST_FAIL;
+    }
+
+    /* Full, then again with one entry free for the checkpoint */
+    if (ret == 0) {
+        ret = cb->Compact(context);
+    }
+    if (ret == 0) {
+        id = NF_OBJECT_COUNT;
+        ret = cb->DestroyObjects(context, 1, &id);
+    }
+    if (ret == 0) {
+        ret = cb->Compact(context);
+    }
+
+    for (i = 0; (ret == 0) && (i < NF_OBJECT_COUNT - 1); i++) {
+        memset(data, i, sizeof(data));
+        ret = cb->Read(context, (whNvmId)(i + 1), 0, sizeof(dataBuf),
+                dataBuf);
+        if ((ret == 0) && (memcmp(data, dataBuf, sizeof(data)) != 0)) {
+            ret = WH_TEST_FAIL;
+        }
+    }
+
+    if (ret == 0) {
+        WH_TEST_RETURN_ON_FAIL(cb->Cleanup(context));
+    }
+    else {
+        WH_ERROR_PRINT("Compacting a full directory failed: %d\n", ret);
+        (void)cb->Cleanup(context);
+    }
+    return ret;
+}
+
 
 #if defined(WH_CFG_TEST_POSIX)
 
@@ -358,8 +841,38 @@ int whTest_NvmFlash_PosixFileSim(void)
     posixFlashFileContext myHalFlashContext[1] = {0};
     posixFlashFileConfig  myHalFlashConfig[1]  = {{
           .filename       = "myNvm.bin",
-          .partition_size = 16384,
+          .partition_size = TEST_FILE_PARTITION_SIZE,
+          .erased_byte    = (~(uint8_t)0),
+    }};
+
+
+    /* NVM Configuration using PosixSim HAL Flash */
+    whNvmFlashConfig myNvmCfg = {
+        .cb      = myCb,
+        .context = myHalFlashContext,
+        .config  = myHalFlashConfig,
+        .compact_objects = 4,
+    };
+
+
+    WH_TEST_ASSERT(0 == whTest_NvmFlashCfg(&myNvmCfg));
+
+    /* Remove the configured file on success*/
+    unlink(myHalFlashConfig[0].filename);
+    return 0;
+}
+
+int whTest_NvmFlash_PosixMmapSim(void)
+{
+    /* HAL Flash state and configuration */
+    const whFlashCb       myCb[1]              = {POSIX_FLASH_MMAP_CB};
+    posixFlashMmapContext myHalFlashContext[1] = {0};
+    posixFlashMmapConfig  myHalFlashConfig[1]  = {{
+          .filename       = "myNvmMmap.bin",
+          .partition_size = TEST_FILE_PARTITION_SIZE,
           .erased_byte    = (~(uint8_t)0),
+          .sync           = POSIX_FLASH_MMAP_SYNC_LOCK |
+                            POSIX_FLASH_MMAP_SYNC_CLEANUP,
     }};
 
 
@@ -368,6 +881,7 @@ int whTest_NvmFlash_PosixFileSim(void)
         .cb      = myCb,
         .context = myHalFlashContext,
         .config  = myHalFlashConfig,
+        .compact_objects = 4,
     };
 
 
@@ -385,10 +899,14 @@ int whTest_NvmFlash(void)
 {
     printf("Testing NVM flash with RAM sim...\n");
     WH_TEST_ASSERT(0 == whTest_NvmFlash_RamSim());
+    printf("Testing NVM flash compaction of a full directory...\n");
+    WH_TEST_ASSERT(0 == whTest_NvmFlash_CompactFull());
 
 #if defined(WH_CFG_TEST_POSIX)
     printf("Testing NVM flash with POSIX file sim...\n");
     WH_TEST_ASSERT(0 == whTest_NvmFlash_PosixFileSim());
+    printf("Testing NVM flash with POSIX mmap sim...\n");
+    WH_TEST_ASSERT(0 == whTest_NvmFlash_PosixMmapSim());
 #endif
 
     return 0;
@@ -0,0 +1,219 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#if defined(WH_CONFIG)
+#include "wh_config.h"
+#endif
+
+/* core test includes */
+#include "wh_test_common.h"
+#include "wh_test_nvm_flashlog.h"
+
+/* APIs to test */
+#include "wolfhsm/wh_error.h"
+#include "wolfhsm/wh_nvm.h"
+#include "wolfhsm/wh_flash_unit.h"
+#include "wolfhsm/wh_nvm_flashlog.h"
+
+/* NVM simulator backends to use for testing NVM module */
+#include "wolfhsm/wh_flash_ramsim.h"
+
+#define TEST_SECTOR_SIZE 4096
+#define TEST_SECTOR_COUNT 4
+#define TEST_HOT_LEN 200
+#define TEST_COLD_COUNT 8
+#define TEST_HOT_WRITES 200
+
+/* Check every object against its expected contents */
+static int _CheckObjects(const whNvmCb* cb, whNvmFlashLogContext* context,
+        const uint8_t* hot, whNvmId destroyed)
+{
+    whNvmMetadata meta = {0};
+    uint8_t       dataBuf[TEST_HOT_LEN];
+    whNvmId       id = 0;
+
+    WH_TEST_RETURN_ON_FAIL(cb->GetMetadata(context, 1, &meta));
+    WH_TEST_ASSERT_RETURN(meta.len == TEST_HOT_LEN);
+    WH_TEST_RETURN_ON_FAIL(cb->Read(context, 1, 0, TEST_HOT_LEN, dataBuf));
+    WH_TEST_ASSERT_RETURN(0 == memcmp(dataBuf, hot, TEST_HOT_LEN));
+
+    for (id = 2; id < 2 + TEST_COLD_COUNT; id++) {
+        if (id == destroyed) {
+            WH_TEST_ASSERT_RETURN(WH_ERROR_NOTFOUND ==
+                                  cb->GetMetadata(context, id, &meta));
+            WH_TEST_ASSERT_RETURN(WH_ERROR_NOTFOUND ==
+                                  cb->Read(context, id, 0, 1, dataBuf));
+            continue;
+        }
+        WH_TEST_RETURN_ON_FAIL(cb->Read(context, id, 0, sizeof(id),
+                                        dataBuf));
+        WH_TEST_ASSERT_RETURN(0 == memcmp(dataBuf, &id, sizeof(id)));
+    }
+    return 0;
+}
+
+/* Mount the same flash again without reinitializing the device */
+static int _Reload(const whNvmCb* cb, const whNvmFlashLogConfig* cfg,
+        whNvmFlashLogContext* reload)
+{
+    static whFlashCb    reloadCb;
+    whNvmFlashLogConfig reloadCfg = *cfg;
+
+    reloadCb         = *cfg->cb;
+    reloadCb.Init    = NULL;
+    reloadCb.Cleanup = NULL;
+    reloadCfg.cb     = &reloadCb;
+    return cb->Init(reload, &reloadCfg);
+}
+
+int whTest_NvmFlashLog(void)
+{
+    const whFlashCb  myCb[1]          = {WH_FLASH_RAMSIM_CB};
+    whFlashRamsimCtx myHalFlashCtx[1] = {0};
+    whFlashRamsimCfg myHalFlashCfg[1] = {{
+        .size       = TEST_SECTOR_SIZE * TEST_SECTOR_COUNT,
+        .sectorSize = TEST_SECTOR_SIZE,
+        .pageSize   = 8,
+        .erasedByte = ~(uint8_t)0,
+    }};
+    whNvmFlashLogConfig myNvmCfg = {
+        .cb           = myCb,
+        .context      = myHalFlashCtx,
+        .config       = myHalFlashCfg,
+        .sector_size  = TEST_SECTOR_SIZE,
+        .sector_count = TEST_SECTOR_COUNT,
+    };
+    const whNvmCb        cb[1]      = {WH_NVM_FLASHLOG_CB};
+    whNvmFlashLogContext context[1] = {0};
+    whNvmFlashLogContext reload[1]  = {0};
+    whNvmMetadata        meta       = {0};
+    uint8_t              hot[TEST_HOT_LEN];
+    uint32_t             reclaimSize = 0;
+    uint32_t             availSize   = 0;
+    whNvmId              availObjects = 0;
+    whNvmId              count        = 0;
+    whNvmId              id           = 0;
+    whNvmId              destroyed    = 0;
+    int                  i            = 0;
+    int                  worn         = 0;
+
+    printf("Testing NVM flash log with RAM sim...\n");
+
+    WH_TEST_RETURN_ON_FAIL(cb->Init(context, &myNvmCfg));
+
+    /* Objects that never change, sharing the log with one rewritten often */
+    printf("--Add cold objects\n");
+    for (id = 2; id < 2 + TEST_COLD_COUNT; id++) {
+        memset(&meta, 0, sizeof(meta));
+        meta.id = id;
+        WH_TEST_RETURN_ON_FAIL(cb->AddObject(context, &meta, sizeof(id),
+                                             (const uint8_t*)&id));
+    }
+
+    /* Far more data than the store holds, so sectors are reclaimed */
+    printf("--Rewrite a hot object\n");
+    memset(&meta, 0, sizeof(meta));
+    meta.id = 1;
+    for (i = 0; i < TEST_HOT_WRITES; i++) {
+        memset(hot, i, sizeof(hot));
+        WH_TEST_RETURN_ON_FAIL(cb->AddObject(context, &meta, sizeof(hot),
+                                             hot));
+        WH_TEST_RETURN_ON_FAIL(_CheckObjects(cb, context, hot, 0));
+    }
+    WH_TEST_RETURN_ON_FAIL(cb->List(context, WOLFHSM_NVM_ACCESS_ANY,
+                                    WOLFHSM_NVM_FLAGS_ANY, 0, &count, &id));
+    WH_TEST_ASSERT_RETURN(count == 1 + TEST_COLD_COUNT);
+
+    /* Reclaim spreads erases over the sectors and keeps one spare */
+    for (i = 0; i < TEST_SECTOR_COUNT; i++) {
+        if (context->sectors[i].erase_count > 1) {
+            worn++;
+        }
+    }
+    WH_TEST_ASSERT_RETURN(worn >= TEST_SECTOR_COUNT - 1);
+
+    /* A destroy leaves a tombstone that survives a reload */
+    printf("--Destroy and reload\n");
+    destroyed = 3;
+    WH_TEST_RETURN_ON_FAIL(cb->DestroyObjects(context, 1, &destroyed));
+    WH_TEST_RETURN_ON_FAIL(_CheckObjects(cb, context, hot, destroyed));
+    WH_TEST_RETURN_ON_FAIL(cb->GetAvailable(context, &availSize,
+                                            &availObjects, &reclaimSize,
+                                            NULL));
+    WH_TEST_ASSERT_RETURN(availObjects ==
+                          WOLFHSM_NUM_NVMOBJECTS - TEST_COLD_COUNT);
+    WH_TEST_RETURN_ON_FAIL(_Reload(cb, &myNvmCfg, reload));
+    WH_TEST_RETURN_ON_FAIL(_CheckObjects(cb, reload, hot, destroyed));
+    {
+        uint32_t reloadReclaim = 0;
+        uint32_t reloadAvail   = 0;
+
+        WH_TEST_RETURN_ON_FAIL(cb->GetAvailable(reload, &reloadAvail, NULL,
+                                                &reloadReclaim, NULL));
+        WH_TEST_ASSERT_RETURN(reloadAvail == availSize);
+        WH_TEST_ASSERT_RETURN(reloadReclaim == reclaimSize);
+    }
+
+    /* An interrupted append is skipped on mount and its space is garbage */
+    printf("--Recover an interrupted append\n");
+    {
+        const nflSector* head = &context->sectors[context->head];
+        whFlashUnit torn = ((whFlashUnit)1234 << 32) |
+                           ((uint32_t)16 << 16) | 0xA500u;
+
+        WH_TEST_RETURN_ON_FAIL(wh_FlashUnit_Program(
+            myCb, myHalFlashCtx,
+            context->head * (TEST_SECTOR_SIZE / WHFU_BYTES_PER_UNIT) +
+                head->next_unit,
+            1, &torn));
+        WH_TEST_RETURN_ON_FAIL(_Reload(cb, &myNvmCfg, reload));
+        WH_TEST_RETURN_ON_FAIL(_CheckObjects(cb, reload, hot, destroyed));
+        WH_TEST_ASSERT_RETURN(reload->sectors[reload->head].next_unit >
+                              head->next_unit);
+        memset(hot, 0x5A, sizeof(hot));
+        WH_TEST_RETURN_ON_FAIL(cb->AddObject(reload, &meta, sizeof(hot),
+                                             hot));
+        WH_TEST_RETURN_ON_FAIL(_CheckObjects(cb, reload, hot, destroyed));
+    }
+
+    /* Compaction reclaims every closed sector with garbage */
+    printf("--Compact\n");
+    WH_TEST_RETURN_ON_FAIL(cb->Compact(reload));
+    WH_TEST_RETURN_ON_FAIL(_CheckObjects(cb, reload, hot, destroyed));
+    for (i = 0; i < TEST_SECTOR_COUNT; i++) {
+        if (i != reload->head) {
+            WH_TEST_ASSERT_RETURN(reload->sectors[i].garbage == 0);
+        }
+    }
+    WH_TEST_RETURN_ON_FAIL(_Reload(cb, &myNvmCfg, context));
+    WH_TEST_RETURN_ON_FAIL(_CheckObjects(cb, context, hot, destroyed));
+
+    /* Larger than a sector can never fit */
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOSPACE ==
+                          cb->AddObject(context, &meta, TEST_SECTOR_SIZE,
+                                        (const uint8_t*)myHalFlashCtx));
+
+    printf("--Done\n");
+    /* The reloaded context does not own the flash */
+    WH_TEST_RETURN_ON_FAIL(cb->Cleanup(context));
+    WH_TEST_RETURN_ON_FAIL(myCb->Cleanup(myHalFlashCtx));
+    return 0;
+}
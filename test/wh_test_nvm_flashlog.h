@@ -0,0 +1,28 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef WH_TEST_NVM_FLASHLOG_H_
+#define WH_TEST_NVM_FLASHLOG_H_
+
+/*
+ * Runs the log structured NVM tests using a RAM-based flash memory simulator.
+ * Returns 0 on success, and a non-zero error code on failure
+ */
+int whTest_NvmFlashLog(void);
+
+#endif /* WH_TEST_NVM_FLASHLOG_H_ */
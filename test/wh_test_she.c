@@ -60,11 +60,72 @@ enum {
     };
 
 
+/* Program a fresh boot MAC key and the CMAC of a random bootloader, then set
+ * the UID so the server is ready for secure boot */
+static int _whTest_SheProgramBoot(whClientContext* client, WC_RNG* rng,
+    uint8_t* bootloader, uint32_t bootloaderSz, uint8_t* uid, uint32_t uidSz)
+{
+    int ret = 0;
+    Cmac cmac[1];
+    uint8_t key[16] = {0};
+    uint8_t zeros[WOLFHSM_SHE_BOOT_MAC_PREFIX_LEN] = {0};
+    uint8_t bootMacDigest[16] = {0};
+    uint32_t digestSz = sizeof(bootMacDigest);
+
+    if ((ret = wc_RNG_GenerateBlock(rng, key, sizeof(key))) != 0) {
+        WH_ERROR_PRINT("Failed to wc_RNG_GenerateBlock %d\n", ret);
+        return ret;
+    }
+    /* generate a fake bootloader */
+    if ((ret = wc_RNG_GenerateBlock(rng, bootloader, bootloaderSz)) != 0) {
+        WH_ERROR_PRINT("Failed to wc_RNG_GenerateBlock %d\n", ret);
+        return ret;
+    }
+    /* cmac 0..0 | size | bootloader */
+    if ((ret = wc_InitCmac(cmac, key, sizeof(key), WC_CMAC_AES, NULL)) != 0) {
+        WH_ERROR_PRINT("Failed to wc_InitCmac %d\n", ret);
+        return ret;
+    }
+    if ((ret = wc_CmacUpdate(cmac, zeros, sizeof(zeros))) != 0) {
+        WH_ERROR_PRINT("Failed to wc_CmacUpdate %d\n", ret);
+        return ret;
+    }
+    if ((ret = wc_CmacUpdate(cmac, (uint8_t*)&bootloaderSz, sizeof(bootloaderSz))) != 0) {
+        WH_ERROR_PRINT("Failed to wc_CmacUpdate %d\n", ret);
+        return ret;
+    }
+    if ((ret = wc_CmacUpdate(cmac, bootloader, bootloaderSz)) != 0) {
+        WH_ERROR_PRINT("Failed to wc_CmacUpdate %d\n", ret);
+        return ret;
+    }
+    digestSz = AES_BLOCK_SIZE;
+    if ((ret = wc_CmacFinal(cmac, bootMacDigest, &digestSz)) != 0) {
+        WH_ERROR_PRINT("Failed to wc_CmacFinal %d\n", ret);
+        return ret;
+    }
+    /* store cmac key */
+    if ((ret = wh_Client_ShePreProgramKey(client, WOLFHSM_SHE_BOOT_MAC_KEY_ID, 0, key, sizeof(key))) != 0) {
+        WH_ERROR_PRINT("Failed to wh_Client_ShePreProgramKey %d\n", ret);
+        return ret;
+    }
+    /* store cmac digest */
+    if ((ret = wh_Client_ShePreProgramKey(client, WOLFHSM_SHE_BOOT_MAC, 0, bootMacDigest, sizeof(bootMacDigest))) != 0) {
+        WH_ERROR_PRINT("Failed to wh_Client_ShePreProgramKey %d\n", ret);
+        return ret;
+    }
+    /* set the she uid */
+    if ((ret = wh_Client_SheSetUid(client, uid, uidSz)) != 0) {
+        WH_ERROR_PRINT("Failed to wh_Client_SheSetUid %d\n", ret);
+        return ret;
+    }
+    return ret;
+}
+
 int whTest_SheClientConfig(whClientConfig* config)
 {
     int ret = 0;
+    int i;
     WC_RNG rng[1];
-    Cmac cmac[1];
     whClientContext client[1] = {0};
     uint8_t key[16] = {0};
     uint32_t keySz = sizeof(key);
@@ -80,12 +141,9 @@ int whTest_SheClientConfig(whClientConfig* config)
         0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c};
     uint8_t prngSeed[] = {0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96, 0xe9,
         0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a};
-    uint8_t zeros[WOLFHSM_SHE_BOOT_MAC_PREFIX_LEN] = {0};
     uint8_t bootloader[512];
-    uint8_t bootMacDigest[16] = {0};
     uint8_t vectorMasterEcuKey[16] = {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06,
         0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f};
-    uint32_t digestSz = sizeof(bootMacDigest);
     uint32_t bootloaderSz = sizeof(bootloader);
     uint8_t vectorMessageOne[] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
         0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x41};
@@ -113,63 +171,36 @@ int whTest_SheClientConfig(whClientConfig* config)
     uint8_t messageThree[WOLFHSM_SHE_M3_SZ];
     uint8_t messageFour[WOLFHSM_SHE_M4_SZ];
     uint8_t messageFive[WOLFHSM_SHE_M5_SZ];
+    uint8_t batchOne[WOLFHSM_SHE_M1_SZ * 2];
+    uint8_t batchTwo[WOLFHSM_SHE_M2_SZ * 2];
+    uint8_t batchThree[WOLFHSM_SHE_M3_SZ * 2];
+    uint8_t batchFour[WOLFHSM_SHE_M4_SZ * 2];
+    uint8_t batchFive[WOLFHSM_SHE_M5_SZ * 2];
+    uint8_t outBatchFour[WOLFHSM_SHE_M4_SZ * 2];
+    uint8_t outBatchFive[WOLFHSM_SHE_M5_SZ * 2];
 
     if (config == NULL) {
         return WH_ERROR_BADARGS;
     }
 
     WH_TEST_RETURN_ON_FAIL(wh_Client_Init(client, config));
-    /* generate a new cmac key */
     if ((ret = wc_InitRng_ex(rng, NULL, WOLFHSM_DEV_ID)) != 0) {
         WH_ERROR_PRINT("Failed to wc_InitRng_ex %d\n", ret);
         goto exit;
     }
-    if ((ret = wc_RNG_GenerateBlock(rng, key, sizeof(key))) != 0) {
-        WH_ERROR_PRINT("Failed to wc_RNG_GenerateBlock %d\n", ret);
-        goto exit;
-    }
-    /* generate a fake bootloader */
-    if ((ret = wc_RNG_GenerateBlock(rng, bootloader, sizeof(bootloader))) != 0) {
-        WH_ERROR_PRINT("Failed to wc_RNG_GenerateBlock %d\n", ret);
+    /* generate a new cmac key and bootloader */
+    if ((ret = _whTest_SheProgramBoot(client, rng, bootloader, bootloaderSz,
+            sheUid, sizeof(sheUid))) != 0) {
         goto exit;
     }
-    /* cmac 0..0 | size | bootloader */
-    if ((ret = wc_InitCmac(cmac, key, sizeof(key), WC_CMAC_AES, NULL)) != 0) {
-        WH_ERROR_PRINT("Failed to wc_InitCmac %d\n", ret);
-        goto exit;
-    }
-    if ((ret = wc_CmacUpdate(cmac, zeros, sizeof(zeros))) != 0) {
-        WH_ERROR_PRINT("Failed to wc_CmacUpdate %d\n", ret);
-        goto exit;
-    }
-    if ((ret = wc_CmacUpdate(cmac, (uint8_t*)&bootloaderSz, sizeof(bootloaderSz))) != 0) {
-        WH_ERROR_PRINT("Failed to wc_CmacUpdate %d\n", ret);
-        goto exit;
-    }
-    if ((ret = wc_CmacUpdate(cmac, bootloader, sizeof(bootloader))) != 0) {
-        WH_ERROR_PRINT("Failed to wc_CmacUpdate %d\n", ret);
-        goto exit;
-    }
-    digestSz = AES_BLOCK_SIZE;
-    if ((ret = wc_CmacFinal(cmac, bootMacDigest, &digestSz)) != 0) {
-        WH_ERROR_PRINT("Failed to wc_CmacFinal %d\n", ret);
-        goto exit;
-    }
-    /* store cmac key */
-    if ((ret = wh_Client_ShePreProgramKey(client, WOLFHSM_SHE_BOOT_MAC_KEY_ID, 0, key, sizeof(key))) != 0) {
-        WH_ERROR_PRINT("Failed to wh_Client_ShePreProgramKey %d\n", ret);
-        goto exit;
-    }
-    /* store cmac digest */
-    if ((ret = wh_Client_ShePreProgramKey(client, WOLFHSM_SHE_BOOT_MAC, 0, bootMacDigest, sizeof(bootMacDigest))) != 0) {
-        WH_ERROR_PRINT("Failed to wh_Client_ShePreProgramKey %d\n", ret);
-        goto exit;
-    }
-    /* set the she uid */
-    if ((ret = wh_Client_SheSetUid(client, sheUid, sizeof(sheUid))) != 0) {
-        WH_ERROR_PRINT("Failed to wh_Client_SheSetUid %d\n", ret);
+    /* a tampered bootloader fails and leaves secure boot ready to retry */
+    bootloader[0] ^= 1;
+    if ((ret = wh_Client_SheSecureBoot(client, bootloader, bootloaderSz)) == 0) {
+        WH_ERROR_PRINT("Tampered bootloader passed wh_Client_SheSecureBoot\n");
+        ret = -1;
         goto exit;
     }
+    bootloader[0] ^= 1;
     /* verify bootloader */
     if ((ret = wh_Client_SheSecureBoot(client, bootloader, bootloaderSz)) != 0) {
         WH_ERROR_PRINT("Failed to wh_Client_SheSecureBoot %d\n", ret);
@@ -221,7 +252,9 @@ int whTest_SheClientConfig(whClientConfig* config)
         goto exit;
     }
     printf("SHE wh_SheGenerateLoadableKey SUCCESS\n");
-    /* test CMD_LOAD_KEY with test vector */
+    /* test CMD_LOAD_KEY with test vector.  K1 and K2 of the master ecu key
+     * come from the server's kdf cache, filled as K3 and K4 when that key was
+     * loaded above */
     if ((ret = wh_Client_SheLoadKey(client, vectorMessageOne, vectorMessageTwo, vectorMessageThree, outMessageFour, outMessageFive)) != 0) {
         WH_ERROR_PRINT("Failed to wh_Client_SheLoadKey %d\n", ret);
         goto exit;
@@ -233,6 +266,34 @@ int whTest_SheClientConfig(whClientConfig* config)
         goto exit;
     }
     printf("SHE LOAD KEY SUCCESS\n");
+    /* batch load key 4 again with a higher counter and key 5 authorized by
+     * the new key 4 from the same batch */
+    if ((ret = wh_SheGenerateLoadableKey(4, WOLFHSM_SHE_MASTER_ECU_KEY_ID, 2, 0, sheUid, vectorRawKey, vectorMasterEcuKey, batchOne, batchTwo, batchThree, batchFour, batchFive)) != 0) {
+        WH_ERROR_PRINT("Failed to wh_SheGenerateLoadableKey %d\n", ret);
+        goto exit;
+    }
+    if ((ret = wh_SheGenerateLoadableKey(5, 4, 1, 0, sheUid, vectorMasterEcuKey, vectorRawKey, batchOne + WOLFHSM_SHE_M1_SZ, batchTwo + WOLFHSM_SHE_M2_SZ, batchThree + WOLFHSM_SHE_M3_SZ, batchFour + WOLFHSM_SHE_M4_SZ, batchFive + WOLFHSM_SHE_M5_SZ)) != 0) {
+        WH_ERROR_PRINT("Failed to wh_SheGenerateLoadableKey %d\n", ret);
+        goto exit;
+    }
+    if ((ret = wh_Client_SheLoadKeyBatch(client, 2, batchOne, batchTwo, batchThree, outBatchFour, outBatchFive)) != 0) {
+        WH_ERROR_PRINT("Failed to wh_Client_SheLoadKeyBatch %d\n", ret);
+        goto exit;
+    }
+    if (memcmp(outBatchFour, batchFour, sizeof(batchFour)) != 0 ||
+        memcmp(outBatchFive, batchFive, sizeof(batchFive)) != 0) {
+        WH_ERROR_PRINT("wh_Client_SheLoadKeyBatch FAILED TO MATCH\n");
+        ret = -1;
+        goto exit;
+    }
+    /* replaying the batch must fail on the counters and write nothing */
+    if ((ret = wh_Client_SheLoadKeyBatch(client, 2, batchOne, batchTwo, batchThree, outBatchFour, outBatchFive)) != WH_SHE_ERC_KEY_UPDATE_ERROR) {
+        WH_ERROR_PRINT("wh_Client_SheLoadKeyBatch replay %d\n", ret);
+        ret = -1;
+        goto exit;
+    }
+    ret = 0;
+    printf("SHE LOAD KEY BATCH SUCCESS\n");
     if ((ret = wh_Client_SheInitRnd(client)) != 0) {
         WH_ERROR_PRINT("Failed to wh_Client_SheInitRnd %d\n", ret);
         goto exit;
@@ -246,6 +307,25 @@ int whTest_SheClientConfig(whClientConfig* config)
         goto exit;
     }
     printf("SHE RND SUCCESS\n");
+    /* bulk and dma RND keep stepping the same PRNG state, so no block may
+     * repeat */
+    if ((ret = wh_Client_SheRndBulk(client, finalText, sizeof(finalText) / 2)) != 0) {
+        WH_ERROR_PRINT("Failed to wh_Client_SheRndBulk %d\n", ret);
+        goto exit;
+    }
+    if ((ret = wh_Client_SheRndDma(client, finalText + sizeof(finalText) / 2, sizeof(finalText) / 2)) != 0) {
+        WH_ERROR_PRINT("Failed to wh_Client_SheRndDma %d\n", ret);
+        goto exit;
+    }
+    for (i = 0; i < (int)sizeof(finalText); i += WOLFHSM_SHE_KEY_SZ) {
+        if (memcmp(finalText + i, key, WOLFHSM_SHE_KEY_SZ) == 0 ||
+            (i > 0 && memcmp(finalText + i, finalText + i - WOLFHSM_SHE_KEY_SZ, WOLFHSM_SHE_KEY_SZ) == 0)) {
+            WH_ERROR_PRINT("SHE bulk RND repeated a block\n");
+            ret = -1;
+            goto exit;
+        }
+    }
+    printf("SHE RND BULK SUCCESS\n");
     if ((ret = wh_Client_SheLoadPlainKey(client, key, sizeof(key))) != 0) {
         WH_ERROR_PRINT("Failed to wh_Client_SheLoadPlainKey %d\n", ret);
         goto exit;
@@ -284,6 +364,55 @@ int whTest_SheClientConfig(whClientConfig* config)
         goto exit;
     }
     printf("SHE CBC SUCCESS\n");
+    /* stream the same CBC encryption, chaining across an inline update and a
+     * dma update, and check it against the one-shot result */
+    memset(finalText, 0, sizeof(finalText));
+    if ((ret = wh_Client_SheCipherInit(client, WOLFHSM_SHE_RAM_KEY_ID, WOLFHSM_SHE_CIPHER_CBC, 1, iv, sizeof(iv))) != 0) {
+        WH_ERROR_PRINT("Failed to wh_Client_SheCipherInit %d\n", ret);
+        goto exit;
+    }
+    if ((ret = wh_Client_SheCipherUpdate(client, plainText, finalText, sizeof(plainText) / 2)) != 0) {
+        WH_ERROR_PRINT("Failed to wh_Client_SheCipherUpdate %d\n", ret);
+        goto exit;
+    }
+    if ((ret = wh_Client_SheCipherUpdateDma(client, plainText + sizeof(plainText) / 2, finalText + sizeof(plainText) / 2, sizeof(plainText) / 2)) != 0) {
+        WH_ERROR_PRINT("Failed to wh_Client_SheCipherUpdateDma %d\n", ret);
+        goto exit;
+    }
+    if ((ret = wh_Client_SheCipherFinal(client)) != 0) {
+        WH_ERROR_PRINT("Failed to wh_Client_SheCipherFinal %d\n", ret);
+        goto exit;
+    }
+    if (memcmp(finalText, cipherText, sizeof(cipherText)) != 0) {
+        WH_ERROR_PRINT("SHE CBC STREAM FAILED TO MATCH\n");
+        ret = -1;
+        goto exit;
+    }
+    if ((ret = wh_Client_SheCipherInit(client, WOLFHSM_SHE_RAM_KEY_ID, WOLFHSM_SHE_CIPHER_CBC, 0, iv, sizeof(iv))) != 0) {
+        WH_ERROR_PRINT("Failed to wh_Client_SheCipherInit %d\n", ret);
+        goto exit;
+    }
+    if ((ret = wh_Client_SheCipherUpdate(client, cipherText, finalText, sizeof(cipherText))) != 0) {
+        WH_ERROR_PRINT("Failed to wh_Client_SheCipherUpdate %d\n", ret);
+        goto exit;
+    }
+    if ((ret = wh_Client_SheCipherFinal(client)) != 0) {
+        WH_ERROR_PRINT("Failed to wh_Client_SheCipherFinal %d\n", ret);
+        goto exit;
+    }
+    if (memcmp(finalText, plainText, sizeof(plainText)) != 0) {
+        WH_ERROR_PRINT("SHE CBC STREAM FAILED TO MATCH\n");
+        ret = -1;
+        goto exit;
+    }
+    /* the stream is closed, so another final is out of sequence */
+    if ((ret = wh_Client_SheCipherFinal(client)) != WH_SHE_ERC_SEQUENCE_ERROR) {
+        WH_ERROR_PRINT("SHE cipher final after close returned %d\n", ret);
+        ret = -1;
+        goto exit;
+    }
+    ret = 0;
+    printf("SHE CBC STREAM SUCCESS\n");
     if ((ret = wh_Client_SheGenerateMac(client, WOLFHSM_SHE_RAM_KEY_ID, plainText, sizeof(plainText), cipherText, sizeof(cipherText))) != 0) {
         WH_ERROR_PRINT("Failed to wh_Client_SheGenerateMac %d\n", ret);
         goto exit;
@@ -296,6 +425,17 @@ int whTest_SheClientConfig(whClientConfig* config)
         WH_ERROR_PRINT("SHE CMAC FAILED TO VERIFY\n");
         goto exit;
     }
+    /* a bad mac reports a failed status, not an error */
+    cipherText[0] ^= 0x01;
+    if ((ret = wh_Client_SheVerifyMac(client, WOLFHSM_SHE_RAM_KEY_ID, plainText, sizeof(plainText), cipherText, sizeof(cipherText), &sreg)) != 0) {
+        WH_ERROR_PRINT("Failed to wh_Client_SheVerifyMac %d\n", ret);
+        goto exit;
+    }
+    if (sreg != 1) {
+        WH_ERROR_PRINT("SHE CMAC VERIFIED A BAD MAC\n");
+        ret = -1;
+        goto exit;
+    }
     printf("SHE CMAC SUCCESS\n");
 exit:
     /* Tell server to close */
@@ -311,6 +451,72 @@ exit:
     return ret;
 }
 
+/* Secure boot a server that has not booted yet with the one-request DMA path */
+int whTest_SheSecureBootDmaClientConfig(whClientConfig* config)
+{
+    int ret = 0;
+    WC_RNG rng[1];
+    whClientContext client[1] = {0};
+    uint8_t sheUid[] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x01};
+    uint8_t bootloader[512];
+    uint32_t bootloaderSz = sizeof(bootloader);
+    uint8_t sreg;
+
+    if (config == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    memset(rng, 0, sizeof(rng));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_Init(client, config));
+    if ((ret = wc_InitRng_ex(rng, NULL, WOLFHSM_DEV_ID)) != 0) {
+        WH_ERROR_PRINT("Failed to wc_InitRng_ex %d\n", ret);
+        goto exit;
+    }
+    if ((ret = _whTest_SheProgramBoot(client, rng, bootloader, bootloaderSz,
+            sheUid, sizeof(sheUid))) != 0) {
+        goto exit;
+    }
+    /* a tampered bootloader fails and leaves secure boot ready to retry */
+    bootloader[0] ^= 1;
+    if ((ret = wh_Client_SheSecureBootDma(client, bootloader, bootloaderSz)) == 0) {
+        WH_ERROR_PRINT("Tampered bootloader passed wh_Client_SheSecureBootDma\n");
+        ret = -1;
+        goto exit;
+    }
+    bootloader[0] ^= 1;
+    /* verify bootloader in one request, read by the server over dma */
+    if ((ret = wh_Client_SheSecureBootDma(client, bootloader, bootloaderSz)) != 0) {
+        WH_ERROR_PRINT("Failed to wh_Client_SheSecureBootDma %d\n", ret);
+        goto exit;
+    }
+    if ((ret = wh_Client_SheGetStatus(client, &sreg)) != 0) {
+        WH_ERROR_PRINT("Failed to wh_Client_SheGetStatus %d\n", ret);
+        goto exit;
+    }
+    if ((sreg & WOLFHSM_SHE_SREG_BOOT_OK) == 0 ||
+        (sreg & WOLFHSM_SHE_SREG_BOOT_FINISHED) == 0 ||
+        (sreg & WOLFHSM_SHE_SREG_SECURE_BOOT) == 0) {
+        WH_ERROR_PRINT("Failed to secureBoot with SHE CMAC over dma\n");
+        ret = -1;
+        goto exit;
+    }
+    printf("SHE secure boot DMA SUCCESS\n");
+exit:
+    wc_FreeRng(rng);
+    /* Tell server to close */
+    WH_TEST_RETURN_ON_FAIL(wh_Client_CommClose(client));
+
+    if (ret == 0) {
+        WH_TEST_RETURN_ON_FAIL(wh_Client_Cleanup(client));
+    }
+    else {
+        wh_Client_Cleanup(client);
+    }
+
+    return ret;
+}
+
 int whTest_SheServerConfig(whServerConfig* config)
 {
     whServerContext server[1] = {0};
@@ -350,6 +556,12 @@ static void* _whClientTask(void *cf)
     return NULL;
 }
 
+static void* _whClientBootDmaTask(void *cf)
+{
+    WH_TEST_ASSERT(0 == whTest_SheSecureBootDmaClientConfig(cf));
+    return NULL;
+}
+
 static void* _whServerTask(void* cf)
 {
     WH_TEST_ASSERT(0 == whTest_SheServerConfig(cf));
@@ -358,7 +570,8 @@ static void* _whServerTask(void* cf)
 
 
 static void _whClientServerThreadTest(whClientConfig* c_conf,
-                                whServerConfig* s_conf)
+                                whServerConfig* s_conf,
+                                void* (*client_task)(void*))
 {
     pthread_t cthread = {0};
     pthread_t sthread = {0};
@@ -368,7 +581,7 @@ static void _whClientServerThreadTest(whClientConfig* c_conf,
 
     rc = pthread_create(&sthread, NULL, _whServerTask, s_conf);
     if (rc == 0) {
-        rc = pthread_create(&cthread, NULL, _whClientTask, c_conf);
+        rc = pthread_create(&cthread, NULL, client_task, c_conf);
         if (rc == 0) {
             /* All good. Block on joining */
             pthread_join(cthread, &retval);
@@ -382,7 +595,7 @@ static void _whClientServerThreadTest(whClientConfig* c_conf,
     }
 }
 
-static int wh_ClientServer_MemThreadTest(void)
+static int wh_ClientServer_MemThreadTest(void* (*client_task)(void*))
 {
     uint8_t req[BUFFER_SIZE] = {0};
     uint8_t resp[BUFFER_SIZE] = {0};
@@ -462,7 +675,7 @@ static int wh_ClientServer_MemThreadTest(void)
     WH_TEST_RETURN_ON_FAIL(wolfCrypt_Init());
     WH_TEST_RETURN_ON_FAIL(wc_InitRng_ex(crypto->rng, NULL, crypto->devId));
 
-    _whClientServerThreadTest(c_conf, s_conf);
+    _whClientServerThreadTest(c_conf, s_conf, client_task);
 
     wh_Nvm_Cleanup(nvm);
     wc_FreeRng(crypto->rng);
@@ -477,7 +690,11 @@ int whTest_She(void)
 {
 #if defined(WH_CFG_TEST_POSIX)
     printf("Testing SHE: (pthread) mem...\n");
-    WH_TEST_RETURN_ON_FAIL(wh_ClientServer_MemThreadTest());
+    WH_TEST_RETURN_ON_FAIL(wh_ClientServer_MemThreadTest(_whClientTask));
+    /* A fresh server, since secure boot only runs once per boot */
+    printf("Testing SHE: (pthread) mem secure boot dma...\n");
+    WH_TEST_RETURN_ON_FAIL(
+            wh_ClientServer_MemThreadTest(_whClientBootDmaTask));
 #endif
     return 0;
 }
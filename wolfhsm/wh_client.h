@@ -44,6 +44,7 @@
 
 /* Component includes */
 #include "wolfhsm/wh_comm.h"
+#include "wolfhsm/wh_message_comm.h"
 #include "wolfhsm/wh_message_customcb.h"
 
 #ifndef WOLFHSM_NO_CRYPTO
@@ -56,17 +57,40 @@
 #include "wolfssl/wolfcrypt/ecc.h"
 #endif
 
+/* Random bytes the crypto callback fetches at once to serve small RNG calls
+ * locally.  Should be a multiple of 8.  0 disables the cache */
+#ifndef WOLFHSM_CLIENT_RNG_CACHE_SIZE
+#define WOLFHSM_CLIENT_RNG_CACHE_SIZE 256
+#endif
+
 /* Client context */
 struct whClientContext_t {
     whCommClient comm[1];
     uint16_t last_req_id;
     uint16_t last_req_kind;
+#if !defined(WOLFHSM_NO_CRYPTO) && !defined(WC_NO_RNG) && \
+    WOLFHSM_CLIENT_RNG_CACHE_SIZE > 0
+    uint16_t rngCacheLen;       /* Unused bytes at the start of rngCache */
+    uint8_t pad[2];
+    uint8_t rngCache[WOLFHSM_CLIENT_RNG_CACHE_SIZE];
+#else
     uint8_t pad[4];
+#endif
+    whNvmMetadata* nvm_cache;
+    uint32_t nvm_epoch;         /* Server NVM epoch the cache is valid for */
+    uint16_t nvm_cache_count;
+    uint16_t nvm_cache_next;    /* Entry replaced next when the cache is full */
 };
 typedef struct whClientContext_t whClientContext;
 
 struct whClientConfig_t {
     whCommClientConfig* comm;
+    /* Optional cache of nvm_cache_count metadata entries that answers
+     * wh_Client_NvmGetMetadata locally.  It is flushed whenever an NVM
+     * response reports a new server epoch.  NULL/0 disables the cache */
+    whNvmMetadata* nvm_cache;
+    uint16_t nvm_cache_count;
+    uint8_t pad[6];
 };
 typedef struct whClientConfig_t whClientConfig;
 
@@ -85,6 +109,14 @@ int wh_Client_Cleanup(whClientContext* c);
 int wh_Client_SendRequest(whClientContext* c,
         uint16_t group, uint16_t action,
         uint16_t data_size, const void* data);
+int wh_Client_SendRequestV(whClientContext* c,
+        uint16_t group, uint16_t action,
+        uint16_t iov_count, const whCommIov* iov);
+/* Request data may exceed WH_COMM_DATA_LEN and is sent in fragments.  Returns
+ * WH_ERROR_NOTREADY until the final fragment is sent */
+int wh_Client_SendRequestFragV(whClientContext* c,
+        uint16_t group, uint16_t action,
+        uint16_t iov_count, const whCommIov* iov);
 int wh_Client_RecvResponse(whClientContext *c,
         uint16_t *out_group, uint16_t *out_action,
         uint16_t *out_size, void* data);
@@ -108,8 +140,74 @@ int wh_Client_EchoResponse(whClientContext* c, uint16_t *out_size, void* data);
 int wh_Client_Echo(whClientContext* c, uint16_t snd_len, const void* snd_data,
         uint16_t *out_rcv_len, void* rcv_data);
 
+/* Send several sub-requests in one message.  The batch is built with
+ * wh_MessageComm_BatchInit/BatchAppend and the response, which must have room
+ * for WH_COMM_DATA_LEN bytes, is read back with wh_MessageComm_BatchNext */
+int wh_Client_CommBatchRequest(whClientContext* c, uint16_t size,
+        const void* batch);
+int wh_Client_CommBatchResponse(whClientContext* c, uint16_t* out_size,
+        void* batch);
+int wh_Client_CommBatch(whClientContext* c, uint16_t size, const void* batch,
+        uint16_t* out_size, void* out_batch);
+
+/* Poll a job accepted by the server.  out_rc is WH_ERROR_NOTREADY while the
+ * job runs and WH_ERROR_NOTFOUND for an unknown id.  Otherwise it is the job
+ * result and up to *inout_size bytes of result data, formatted as the response
+ * to a request of out_kind, are copied to data.  A finished job is released */
+int wh_Client_JobRequest(whClientContext* c, uint16_t id);
+int wh_Client_JobResponse(whClientContext* c, int32_t* out_rc,
+        uint16_t* out_kind, uint16_t* inout_size, void* data);
+int wh_Client_Job(whClientContext* c, uint16_t id, int32_t* out_rc,
+        uint16_t* out_kind, uint16_t* inout_size, void* data);
+
+/* Read server request statistics.  Up to *inout_count entries starting at
+ * index start are copied to entries, and *inout_count is updated.  out_total
+ * is the number of entries on the server.  If reset is nonzero the server
+ * clears its statistics after the read.  Returns WH_ERROR_ABORTED if the
+ * server does not support statistics */
+int wh_Client_CommStatsRequest(whClientContext* c, uint16_t start,
+        uint8_t reset);
+int wh_Client_CommStatsResponse(whClientContext* c, uint16_t* out_total,
+        uint16_t* inout_count, whMessageCommStatsEntry* entries);
+int wh_Client_CommStats(whClientContext* c, uint16_t start, uint8_t reset,
+        uint16_t* out_total, uint16_t* inout_count,
+        whMessageCommStatsEntry* entries);
+
+/* Have the server keep the len bytes at addr mapped for DMA with access, a
+ * mask of WH_DMA_MAP_*.  Later DMA requests of this client with buffers inside
+ * the mapping skip the server's per-request mapping work.  Keep the handle to
+ * unmap it, which the client should do before it reuses the memory.  The
+ * server rejects a mapping with WH_ERROR_NOSPACE when its table is full */
+int wh_Client_DmaMapRequest(whClientContext* c, const void* addr, size_t len,
+        uint8_t access);
+int wh_Client_DmaMapResponse(whClientContext* c, int32_t* out_rc,
+        uint32_t* out_handle);
+int wh_Client_DmaMap(whClientContext* c, const void* addr, size_t len,
+        uint8_t access, int32_t* out_rc, uint32_t* out_handle);
+
+int wh_Client_DmaUnmapRequest(whClientContext* c, uint32_t handle);
+int wh_Client_DmaUnmapResponse(whClientContext* c, int32_t* out_rc);
+int wh_Client_DmaUnmap(whClientContext* c, uint32_t handle, int32_t* out_rc);
+
+/** Counter functions
+ * Monotonic counters of the server counter store.  *out_rc is
+ * WH_ERROR_NOTIMPL when the server has none, and an increment returns the
+ * new value */
+int wh_Client_CounterReadRequest(whClientContext* c, whCounterId id);
+int wh_Client_CounterReadResponse(whClientContext* c, int32_t* out_rc,
+        uint32_t* out_value);
+int wh_Client_CounterRead(whClientContext* c, whCounterId id,
+        int32_t* out_rc, uint32_t* out_value);
+
+int wh_Client_CounterIncrementRequest(whClientContext* c, whCounterId id);
+int wh_Client_CounterIncrementResponse(whClientContext* c, int32_t* out_rc,
+        uint32_t* out_value);
+int wh_Client_CounterIncrement(whClientContext* c, whCounterId id,
+        int32_t* out_rc, uint32_t* out_value);
+
 /** Key functions */
 #ifndef WOLFHSM_NO_CRYPTO
+
 int wh_Client_KeyCacheRequest_ex(whClientContext* c, uint32_t flags,
     uint8_t* label, uint32_t labelSz, uint8_t* in, uint32_t inSz,
     uint16_t keyId);
@@ -130,13 +228,173 @@ int wh_Client_KeyExport(whClientContext* c, uint16_t keyId,
 int wh_Client_KeyCommitRequest(whClientContext* c, whNvmId keyId);
 int wh_Client_KeyCommitResponse(whClientContext* c);
 int wh_Client_KeyCommit(whClientContext* c, whNvmId keyId);
+/* Commit up to WOLFHSM_PACKET_KEY_COMMIT_MANY_MAX cached keys in one request.
+ * The blocking wh_Client_KeyCommitMany takes any count, sending as many
+ * requests as needed */
+int wh_Client_KeyCommitManyRequest(whClientContext* c, uint16_t count,
+    const whNvmId* keyIds);
+int wh_Client_KeyCommitManyResponse(whClientContext* c);
+int wh_Client_KeyCommitMany(whClientContext* c, uint16_t count,
+    const whNvmId* keyIds);
 int wh_Client_KeyEraseRequest(whClientContext* c, whNvmId keyId);
 int wh_Client_KeyEraseResponse(whClientContext* c);
 int wh_Client_KeyErase(whClientContext* c, whNvmId keyId);
 void wh_Client_SetKeyCurve25519(curve25519_key* key, whNvmId keyId);
 void wh_Client_SetKeyRsa(RsaKey* key, whNvmId keyId);
 void wh_Client_SetKeyAes(Aes* aes, whNvmId keyId);
-#endif
+
+/** One-shot crypto functions
+ * Split request and response forms of the operations wolfHSM_CryptoCb runs
+ * blocking, using the same packets, so a caller can start an operation and
+ * collect the result later.  Each request must fit in one packet, otherwise
+ * WH_ERROR_BADARGS is returned.  Responses return WH_ERROR_ABORTED if the
+ * output does not fit in the buffer given */
+#ifndef NO_AES
+/* aes holds the key as set up for wolfHSM_CryptoCb: the cached key id from
+ * wh_Client_SetKeyAes when the server uses WOLFHSM_SYMMETRIC_INTERNAL, else
+ * the key itself.  CBC uses the iv in aes */
+#ifdef HAVE_AES_CBC
+int wh_Client_AesCbcRequest(whClientContext* c, Aes* aes, int enc,
+    const uint8_t* in, uint32_t sz);
+int wh_Client_AesCbcResponse(whClientContext* c, uint8_t* out,
+    uint32_t* inout_sz);
+int wh_Client_AesCbc(whClientContext* c, Aes* aes, int enc,
+    const uint8_t* in, uint32_t sz, uint8_t* out);
+#endif /* HAVE_AES_CBC */
+#ifdef HAVE_AESGCM
+/* authTag is sent when decrypting and returned after the output when
+ * encrypting, so a decrypt response may pass a NULL authTag */
+int wh_Client_AesGcmRequest(whClientContext* c, Aes* aes, int enc,
+    const uint8_t* in, uint32_t sz, const uint8_t* iv, uint32_t ivSz,
+    const uint8_t* authIn, uint32_t authInSz, const uint8_t* authTag,
+    uint32_t authTagSz);
+int wh_Client_AesGcmResponse(whClientContext* c, uint8_t* out,
+    uint32_t* inout_sz, uint8_t* authTag, uint32_t authTagSz);
+int wh_Client_AesGcm(whClientContext* c, Aes* aes, int enc,
+    const uint8_t* in, uint32_t sz, const uint8_t* iv, uint32_t ivSz,
+    const uint8_t* authIn, uint32_t authInSz, uint8_t* authTag,
+    uint32_t authTagSz, uint8_t* out);
+#endif /* HAVE_AESGCM */
+#endif /* !NO_AES */
+#ifdef HAVE_ECC
+/* Sign or verify hash with the cached key keyId.  out_res is 1 when the
+ * signature verified */
+int wh_Client_EccSignRequest(whClientContext* c, whNvmId keyId, int curveId,
+    const uint8_t* hash, uint32_t hashSz);
+int wh_Client_EccSignResponse(whClientContext* c, uint8_t* sig,
+    uint32_t* inout_sigSz);
+int wh_Client_EccSign(whClientContext* c, whNvmId keyId, int curveId,
+    const uint8_t* hash, uint32_t hashSz, uint8_t* sig, uint32_t* inout_sigSz);
+int wh_Client_EccVerifyRequest(whClientContext* c, whNvmId keyId,
+    int curveId, const uint8_t* sig, uint32_t sigSz, const uint8_t* hash,
+    uint32_t hashSz);
+int wh_Client_EccVerifyResponse(whClientContext* c, int* out_res);
+int wh_Client_EccVerify(whClientContext* c, whNvmId keyId, int curveId,
+    const uint8_t* sig, uint32_t sigSz, const uint8_t* hash, uint32_t hashSz,
+    int* out_res);
+#endif /* HAVE_ECC */
+
+/** Cipher session functions
+ * Encrypt or decrypt data larger than one request with a cached AES key.  type
+ * is WC_CIPHER_AES_CBC or WC_CIPHER_AES_GCM.  GCM additional data is given at
+ * init.  CBC updates must be a multiple of AES_BLOCK_SIZE.  Final returns the
+ * GCM tag when encrypting and checks it when decrypting, and always closes the
+ * session, as does any failed update.  Decrypted GCM data is not
+ * authenticated until final succeeds */
+int wh_Client_CipherSessionInitRequest(whClientContext* c, uint32_t type,
+    int enc, whNvmId keyId, const uint8_t* iv, uint32_t ivSz,
+    const uint8_t* authIn, uint32_t authInSz);
+int wh_Client_CipherSessionInitResponse(whClientContext* c,
+    uint16_t* out_session);
+int wh_Client_CipherSessionInit(whClientContext* c, uint32_t type, int enc,
+    whNvmId keyId, const uint8_t* iv, uint32_t ivSz, const uint8_t* authIn,
+    uint32_t authInSz, uint16_t* out_session);
+/* A request carries at most WOLFHSM_PACKET_CIPHER_SESSION_MAX_SZ bytes.  The
+ * blocking wh_Client_CipherSessionUpdate takes any size */
+int wh_Client_CipherSessionUpdateRequest(whClientContext* c, uint16_t session,
+    const uint8_t* in, uint32_t sz);
+int wh_Client_CipherSessionUpdateResponse(whClientContext* c, uint8_t* out,
+    uint32_t* inout_sz);
+int wh_Client_CipherSessionUpdate(whClientContext* c, uint16_t session,
+    const uint8_t* in, uint32_t sz, uint8_t* out);
+int wh_Client_CipherSessionFinalRequest(whClientContext* c, uint16_t session,
+    const uint8_t* authTag, uint32_t authTagSz);
+int wh_Client_CipherSessionFinalResponse(whClientContext* c, uint8_t* authTag,
+    uint32_t authTagSz);
+/* authTag receives the tag when encrypting and holds it when decrypting */
+int wh_Client_CipherSessionFinal(whClientContext* c, uint16_t session,
+    uint8_t* authTag, uint32_t authTagSz);
+
+/** Hash session functions
+ * Hash data larger than one request on the server.  type is one of the
+ * WH_HASH_SESSION_* types. HMAC and CMAC sessions use the cached key keyId,
+ * which stays on the server, other types ignore it.  Update data is either
+ * sent in the request or, with the Dma variants, read by the server straight
+ * from client memory.  Final returns the digest or MAC and always closes the
+ * session, as does any failed update */
+int wh_Client_HashSessionInitRequest(whClientContext* c, uint32_t type,
+    whNvmId keyId);
+int wh_Client_HashSessionInitResponse(whClientContext* c,
+    uint16_t* out_session);
+int wh_Client_HashSessionInit(whClientContext* c, uint32_t type,
+    whNvmId keyId, uint16_t* out_session);
+/* A request carries at most WOLFHSM_PACKET_HASH_SESSION_MAX_SZ bytes.  The
+ * blocking wh_Client_HashSessionUpdate takes any size */
+int wh_Client_HashSessionUpdateRequest(whClientContext* c, uint16_t session,
+    const uint8_t* in, uint32_t sz);
+int wh_Client_HashSessionUpdateDmaRequest(whClientContext* c,
+    uint16_t session, const uint8_t* in, uint32_t sz);
+/* Response to either update request */
+int wh_Client_HashSessionUpdateResponse(whClientContext* c);
+int wh_Client_HashSessionUpdate(whClientContext* c, uint16_t session,
+    const uint8_t* in, uint32_t sz);
+int wh_Client_HashSessionUpdateDma(whClientContext* c, uint16_t session,
+    const uint8_t* in, uint32_t sz);
+int wh_Client_HashSessionFinalRequest(whClientContext* c, uint16_t session);
+/* inout_sz is the size of out and receives the digest size */
+int wh_Client_HashSessionFinalResponse(whClientContext* c, uint8_t* out,
+    uint32_t* inout_sz);
+int wh_Client_HashSessionFinal(whClientContext* c, uint16_t session,
+    uint8_t* out, uint32_t* inout_sz);
+
+#ifdef HAVE_ECC
+/** One signature of a batch verify */
+typedef struct {
+    const uint8_t* sig;
+    const uint8_t* hash;
+    whNvmId keyId;
+    uint16_t sigSz;
+    uint16_t hashSz;
+    uint8_t padding[2];
+} whClientEccVerifyItem;
+
+/** Batch ECDSA verify
+ * Verify up to WOLFHSM_PACKET_ECC_VERIFY_BATCH_MAX signatures against cached
+ * public keys of one curve in a single request.  Bit i of out_res is set when
+ * items[i] verified.  Items that use the same key should be adjacent so the
+ * server decodes it once.  Returns WH_ERROR_BADARGS if the items do not fit in
+ * one request */
+int wh_Client_EccVerifyBatchRequest(whClientContext* c, int curveId,
+    const whClientEccVerifyItem* items, uint16_t count);
+int wh_Client_EccVerifyBatchResponse(whClientContext* c, uint32_t* out_res);
+int wh_Client_EccVerifyBatch(whClientContext* c, int curveId,
+    const whClientEccVerifyItem* items, uint16_t count, uint32_t* out_res);
+#endif /* HAVE_ECC */
+
+/** Image verify
+ * Verify a signed image in client memory in a single request.  The server
+ * reads the image through DMA, hashes it with the WH_HASH_SESSION_SHA256 or
+ * WH_HASH_SESSION_SHA384 hashType and checks sig against the cached public key
+ * keyId.  sigType is WH_IMAGE_SIG_ECC, with the curveId of the key, or
+ * WH_IMAGE_SIG_RSA.  out_res is 1 when the signature matches */
+int wh_Client_ImageVerifyRequest(whClientContext* c, whNvmId keyId,
+    uint32_t sigType, int curveId, uint32_t hashType, const uint8_t* image,
+    uint64_t imageSz, const uint8_t* sig, uint32_t sigSz);
+int wh_Client_ImageVerifyResponse(whClientContext* c, int* out_res);
+int wh_Client_ImageVerify(whClientContext* c, whNvmId keyId,
+    uint32_t sigType, int curveId, uint32_t hashType, const uint8_t* image,
+    uint64_t imageSz, const uint8_t* sig, uint32_t sigSz, int* out_res);
+#endif /* !WOLFHSM_NO_CRYPTO */
 
 /** NVM functions */
 int wh_Client_NvmInitRequest(whClientContext* c);
@@ -157,6 +415,14 @@ int wh_Client_NvmGetAvailable(whClientContext* c, int32_t *out_rc,
         uint32_t *out_avail_size, whNvmId *out_avail_objects,
         uint32_t *out_reclaim_size, whNvmId *out_reclaim_objects);
 
+/* Flash wear counters of the server NVM.  *out_rc is WH_ERROR_NOTIMPL when
+ * its backend does not track them */
+int wh_Client_NvmGetStatsRequest(whClientContext* c);
+int wh_Client_NvmGetStatsResponse(whClientContext* c, int32_t *out_rc,
+        whNvmStats* out_stats);
+int wh_Client_NvmGetStats(whClientContext* c, int32_t *out_rc,
+        whNvmStats* out_stats);
+
 int wh_Client_NvmAddObjectRequest(whClientContext* c,
         whNvmId id, whNvmAccess access, whNvmFlags flags,
         whNvmSize label_len, uint8_t* label,
@@ -167,6 +433,35 @@ int wh_Client_NvmAddObject(whClientContext* c,
         whNvmSize label_len, uint8_t* label,
         whNvmSize len, const uint8_t* data, int32_t *out_rc);
 
+/* Stream an object of len bytes to flash without the server holding all of it.
+ * Write the data in order with offset equal to the bytes already written, in
+ * pieces of at most WH_MESSAGE_NVM_MAX_ADD_OBJECT_WRITE_LEN that are whole
+ * multiples of 8 bytes except the last.  The object replaces any earlier
+ * version only at a Finish with commit set, and Finish with commit 0
+ * abandons it.  Only one stream may be open, and the server returns
+ * WH_ERROR_NOTREADY for other NVM changes until it is finished */
+int wh_Client_NvmAddObjectBeginRequest(whClientContext* c,
+        whNvmId id, whNvmAccess access, whNvmFlags flags,
+        whNvmSize label_len, uint8_t* label, whNvmSize len);
+int wh_Client_NvmAddObjectBeginResponse(whClientContext* c, int32_t *out_rc);
+int wh_Client_NvmAddObjectBegin(whClientContext* c,
+        whNvmId id, whNvmAccess access, whNvmFlags flags,
+        whNvmSize label_len, uint8_t* label, whNvmSize len, int32_t *out_rc);
+int wh_Client_NvmAddObjectWriteRequest(whClientContext* c,
+        whNvmSize offset, whNvmSize len, const uint8_t* data);
+int wh_Client_NvmAddObjectWriteResponse(whClientContext* c, int32_t *out_rc);
+int wh_Client_NvmAddObjectWrite(whClientContext* c,
+        whNvmSize offset, whNvmSize len, const uint8_t* data, int32_t *out_rc);
+int wh_Client_NvmAddObjectFinishRequest(whClientContext* c, int commit);
+int wh_Client_NvmAddObjectFinishResponse(whClientContext* c, int32_t *out_rc);
+int wh_Client_NvmAddObjectFinish(whClientContext* c, int commit,
+        int32_t *out_rc);
+/* Blocking helper streaming all of data through Begin, Write and Finish */
+int wh_Client_NvmAddObjectStream(whClientContext* c,
+        whNvmId id, whNvmAccess access, whNvmFlags flags,
+        whNvmSize label_len, uint8_t* label,
+        whNvmSize len, const uint8_t* data, int32_t *out_rc);
+
 int wh_Client_NvmListRequest(whClientContext* c,
         whNvmAccess access, whNvmFlags flags, whNvmId start_id);
 int wh_Client_NvmListResponse(whClientContext* c, int32_t *out_rc,
@@ -175,6 +470,26 @@ int wh_Client_NvmList(whClientContext* c,
         whNvmAccess access, whNvmFlags flags, whNvmId start_id,
         int32_t *out_rc, whNvmId *out_count, whNvmId *out_id);
 
+/* Fetch the metadata of up to max_count objects per round trip, resuming
+ * from an opaque cursor that starts at 0.  Labels are truncated to
+ * WH_MESSAGE_NVM_LIST_LABEL_LEN bytes.  The list is done once fewer than
+ * max_count are returned.  A server_rc of WH_ERROR_ABORTED means the
+ * directory was compacted under the cursor and the list must restart */
+int wh_Client_NvmListMetadataRequest(whClientContext* c,
+        whNvmAccess access, whNvmFlags flags, uint32_t cursor,
+        whNvmId max_count);
+int wh_Client_NvmListMetadataResponse(whClientContext* c, int32_t *out_rc,
+        uint32_t *out_cursor, whNvmId max_count, whNvmId *out_count,
+        whNvmMetadata* out_meta);
+int wh_Client_NvmListMetadata(whClientContext* c,
+        whNvmAccess access, whNvmFlags flags, uint32_t *inout_cursor,
+        whNvmId max_count, int32_t *out_rc, whNvmId *out_count,
+        whNvmMetadata* out_meta);
+
+/* The blocking wh_Client_NvmGetMetadata is answered from the optional
+ * metadata cache when it holds id.  Responses refill the cache.  Changes by
+ * other clients are only seen at the next NVM response, so call
+ * wh_Client_NvmCacheInvalidate before a lookup that must be current */
 int wh_Client_NvmGetMetadataRequest(whClientContext* c, whNvmId id);
 int wh_Client_NvmGetMetadataResponse(whClientContext* c, int32_t *out_rc,
         whNvmId *out_id, whNvmAccess *out_access, whNvmFlags *out_flags,
@@ -185,6 +500,9 @@ int wh_Client_NvmGetMetadata(whClientContext* c, whNvmId id,
         whNvmFlags *out_flags, whNvmSize *out_len,
         whNvmSize label_len, uint8_t* label);
 
+/* Drop all entries of the metadata cache */
+int wh_Client_NvmCacheInvalidate(whClientContext* c);
+
 int wh_Client_NvmDestroyObjectsRequest(whClientContext* c,
         whNvmId list_count, const whNvmId* id_list);
 int wh_Client_NvmDestroyObjectsResponse(whClientContext* c, int32_t *out_rc);
@@ -200,6 +518,23 @@ int wh_Client_NvmRead(whClientContext* c,
         whNvmId id, whNvmSize offset, whNvmSize data_len,
         int32_t *out_rc, whNvmSize *out_len, uint8_t* data);
 
+/* Fetch the metadata and data of up to WH_MESSAGE_NVM_MAX_READ_OBJECTS_COUNT
+ * objects in one round trip.  out_meta and out_lens need list_count entries
+ * and the data of each returned object is placed back to back in data.
+ * out_count may be short when the response fills, so request the rest again.
+ * An object too large to fit on its own comes back with an out_lens of 0 and
+ * its data is read with wh_Client_NvmRead.  When the server stops on an
+ * error, server_rc is the result for id_list[out_count] */
+int wh_Client_NvmReadObjectsRequest(whClientContext* c,
+        whNvmId list_count, const whNvmId* id_list);
+int wh_Client_NvmReadObjectsResponse(whClientContext* c, int32_t *out_rc,
+        whNvmId max_count, whNvmId *out_count, whNvmMetadata* out_meta,
+        whNvmSize *out_lens, whNvmSize data_size, uint8_t* data);
+int wh_Client_NvmReadObjects(whClientContext* c,
+        whNvmId list_count, const whNvmId* id_list,
+        int32_t *out_rc, whNvmId *out_count, whNvmMetadata* out_meta,
+        whNvmSize *out_lens, whNvmSize data_size, uint8_t* data);
+
 int wh_Client_NvmAddObjectDma32Request(whClientContext* c,
         uint32_t metadata_hostaddr,
         whNvmSize data_len, uint32_t data_hostaddr);
@@ -248,6 +583,48 @@ int wh_Client_NvmReadDma(whClientContext* c,
         whNvmId id, whNvmSize offset, whNvmSize data_len, uint8_t* data,
         int32_t *out_rc);
 
+/* Have the server write the metadata of each object to meta[i] and its data
+ * to the data_size[i] bytes at data[i].  The server stops at the first object
+ * it cannot read, with WH_ERROR_NOSPACE when its buffer is too small.  Its
+ * metadata is still written, so the length is known.  out_count is the
+ * number of objects fully read */
+int wh_Client_NvmReadObjectsDmaRequest(whClientContext* c,
+        whNvmId list_count, const whNvmId* id_list, whNvmMetadata* meta,
+        uint8_t* const* data, const whNvmSize* data_size);
+int wh_Client_NvmReadObjectsDmaResponse(whClientContext* c, int32_t *out_rc,
+        whNvmId *out_count);
+int wh_Client_NvmReadObjectsDma(whClientContext* c,
+        whNvmId list_count, const whNvmId* id_list, whNvmMetadata* meta,
+        uint8_t* const* data, const whNvmSize* data_size,
+        int32_t *out_rc, whNvmId *out_count);
+
+/* One client buffer of a scatter-gather list */
+typedef struct {
+    void* data;
+    size_t len;
+} whClientDmaSg;
+
+/* Have the server add an object whose data is the sg_count buffers in sg, in
+ * order, without the client gathering them into one buffer first.  At most
+ * WH_MESSAGE_NVM_MAX_DMA_SG_COUNT buffers, and nothing is added unless every
+ * buffer could be read */
+int wh_Client_NvmAddObjectDmaSgRequest(whClientContext* c,
+        whNvmMetadata* metadata, uint16_t sg_count, const whClientDmaSg* sg);
+int wh_Client_NvmAddObjectDmaSgResponse(whClientContext* c, int32_t *out_rc);
+int wh_Client_NvmAddObjectDmaSg(whClientContext* c,
+        whNvmMetadata* metadata, uint16_t sg_count, const whClientDmaSg* sg,
+        int32_t *out_rc);
+
+/* Have the server scatter object data starting at offset across the sg_count
+ * buffers in sg, in order */
+int wh_Client_NvmReadDmaSgRequest(whClientContext* c,
+        whNvmId id, whNvmSize offset, uint16_t sg_count,
+        const whClientDmaSg* sg);
+int wh_Client_NvmReadDmaSgResponse(whClientContext* c, int32_t *out_rc);
+int wh_Client_NvmReadDmaSg(whClientContext* c,
+        whNvmId id, whNvmSize offset, uint16_t sg_count,
+        const whClientDmaSg* sg, int32_t *out_rc);
+
 
 /* Client custom-callback support */
 int wh_Client_CustomCbRequest(whClientContext* c, const whMessageCustomCb_Request* req);
@@ -261,5 +638,24 @@ int wh_Client_CustomCbCheckRegisteredResponse(whClientContext* c, uint16_t* outI
 /* Blocking call to check if a callback is registered */
 int wh_Client_CustomCbCheckRegistered(whClientContext* c, uint16_t id, int* responseError);
 
+/* Sends req_size payload bytes to the raw callback registered as id on the
+ * server.  Payloads larger than a packet are sent in fragments, returning
+ * WH_ERROR_NOTREADY until the last is sent, and are limited by the server's
+ * reassembly buffer */
+int wh_Client_CustomCbRawRequest(whClientContext* c, uint32_t id,
+                                 uint32_t type, uint16_t req_size,
+                                 const void* req_data);
+/* Receives the callback return code and copies up to *inout_resp_size bytes
+ * of response payload, updating *inout_resp_size.  Returns WH_ERROR_NOHANDLER
+ * if no callback is registered and WH_ERROR_NOSPACE if the payload does not
+ * fit */
+int wh_Client_CustomCbRawResponse(whClientContext* c, int32_t* out_rc,
+                                  uint16_t* inout_resp_size, void* resp_data);
+/* Blocking call to a raw callback */
+int wh_Client_CustomCbRaw(whClientContext* c, uint32_t id, uint32_t type,
+                          uint16_t req_size, const void* req_data,
+                          int32_t* out_rc, uint16_t* inout_resp_size,
+                          void* resp_data);
+
 
 #endif /* WOLFHSM_WH_CLIENT_H_ */
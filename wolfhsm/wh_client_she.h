@@ -38,6 +38,13 @@ int wh_Client_SheSetUidResponse(whClientContext* c);
 int wh_Client_SheSetUid(whClientContext* c, uint8_t* uid, uint32_t uidSz);
 int wh_Client_SheSecureBoot(whClientContext* c, uint8_t* bootloader,
     uint32_t bootloaderLen);
+/* Secure boot in one request.  The server reads the image from client memory
+ * through its DMA callbacks, so bootloader must be reachable by the server */
+int wh_Client_SheSecureBootDmaRequest(whClientContext* c,
+    const uint8_t* bootloader, uint32_t bootloaderLen);
+int wh_Client_SheSecureBootDmaResponse(whClientContext* c);
+int wh_Client_SheSecureBootDma(whClientContext* c, const uint8_t* bootloader,
+    uint32_t bootloaderLen);
 int wh_Client_SheGetStatusRequest(whClientContext* c);
 int wh_Client_SheGetStatusResponse(whClientContext* c, uint8_t* sreg);
 int wh_Client_SheGetStatus(whClientContext* c, uint8_t* sreg);
@@ -48,6 +55,13 @@ int wh_Client_SheLoadKeyResponse(whClientContext* c, uint8_t* messageFour,
 int wh_Client_SheLoadKey(whClientContext* c, uint8_t* messageOne,
     uint8_t* messageTwo, uint8_t* messageThree, uint8_t* messageFour,
     uint8_t* messageFive);
+int wh_Client_SheLoadKeyBatchRequest(whClientContext* c, uint32_t count,
+    uint8_t* messageOne, uint8_t* messageTwo, uint8_t* messageThree);
+int wh_Client_SheLoadKeyBatchResponse(whClientContext* c, uint32_t count,
+    uint8_t* messageFour, uint8_t* messageFive);
+int wh_Client_SheLoadKeyBatch(whClientContext* c, uint32_t count,
+    uint8_t* messageOne, uint8_t* messageTwo, uint8_t* messageThree,
+    uint8_t* messageFour, uint8_t* messageFive);
 int wh_Client_SheLoadPlainKeyRequest(whClientContext* c, uint8_t* key,
     uint32_t keySz);
 int wh_Client_SheLoadPlainKeyResponse(whClientContext* c);
@@ -65,6 +79,17 @@ int wh_Client_SheInitRnd(whClientContext* c);
 int wh_Client_SheRndRequest(whClientContext* c);
 int wh_Client_SheRndResponse(whClientContext* c, uint8_t* out, uint32_t* outSz);
 int wh_Client_SheRnd(whClientContext* c, uint8_t* out, uint32_t* outSz);
+/* Many RND blocks per request, with the same PRNG state as SheRnd.  sz is a
+ * multiple of WOLFHSM_SHE_KEY_SZ.  The blocking call splits any size over as
+ * many requests as needed */
+int wh_Client_SheRndBulkRequest(whClientContext* c, uint32_t sz);
+int wh_Client_SheRndBulkResponse(whClientContext* c, uint8_t* out,
+    uint32_t* outSz);
+int wh_Client_SheRndBulk(whClientContext* c, uint8_t* out, uint32_t sz);
+/* The server writes the RND blocks to out through its DMA callbacks */
+int wh_Client_SheRndDmaRequest(whClientContext* c, uint8_t* out, uint32_t sz);
+int wh_Client_SheRndDmaResponse(whClientContext* c);
+int wh_Client_SheRndDma(whClientContext* c, uint8_t* out, uint32_t sz);
 int wh_Client_SheExtendSeedRequest(whClientContext* c, uint8_t* entropy,
     uint32_t entropySz);
 int wh_Client_SheExtendSeedResponse(whClientContext* c);
@@ -101,4 +126,29 @@ int wh_Client_SheVerifyMacRequest(whClientContext* c, uint8_t keyId,
 int wh_Client_SheVerifyMacResponse(whClientContext* c, uint8_t* outStatus);
 int wh_Client_SheVerifyMac(whClientContext* c, uint8_t keyId, uint8_t* message,
     uint32_t messageLen, uint8_t* mac, uint32_t macLen, uint8_t* outStatus);
+/* Streaming ECB or CBC with mode WOLFHSM_SHE_CIPHER_ECB or _CBC.  The server
+ * keeps the key schedule and the CBC chain from init until final, so updates
+ * carry only whole blocks of data.  One stream per server, owned by the
+ * client that opened it */
+int wh_Client_SheCipherInitRequest(whClientContext* c, uint8_t keyId,
+    uint8_t mode, int enc, uint8_t* iv, uint32_t ivSz);
+int wh_Client_SheCipherInitResponse(whClientContext* c);
+int wh_Client_SheCipherInit(whClientContext* c, uint8_t keyId, uint8_t mode,
+    int enc, uint8_t* iv, uint32_t ivSz);
+int wh_Client_SheCipherUpdateRequest(whClientContext* c, uint8_t* in,
+    uint32_t sz);
+int wh_Client_SheCipherUpdateResponse(whClientContext* c, uint8_t* out,
+    uint32_t sz);
+/* Any multiple of the block size, split over as many requests as needed */
+int wh_Client_SheCipherUpdate(whClientContext* c, uint8_t* in, uint8_t* out,
+    uint32_t sz);
+/* The server reads in and writes out through its DMA callbacks */
+int wh_Client_SheCipherUpdateDmaRequest(whClientContext* c, const uint8_t* in,
+    uint8_t* out, uint32_t sz);
+int wh_Client_SheCipherUpdateDmaResponse(whClientContext* c);
+int wh_Client_SheCipherUpdateDma(whClientContext* c, const uint8_t* in,
+    uint8_t* out, uint32_t sz);
+int wh_Client_SheCipherFinalRequest(whClientContext* c);
+int wh_Client_SheCipherFinalResponse(whClientContext* c);
+int wh_Client_SheCipherFinal(whClientContext* c);
 #endif
@@ -40,6 +40,9 @@
 #define WOLFHSM_WH_COMM_H_
 
 #include <stdint.h>  /* For sized ints */
+#include <stddef.h>  /* For size_t */
+
+#include "wolfhsm/wh_common.h"  /* For WH_COMM_DATA_LEN */
 
 /** Packet content types */
 
@@ -49,7 +52,6 @@
  */
 enum {
     WH_COMM_HEADER_LEN = 8,    /* whCommHeader */
-    WH_COMM_DATA_LEN = 1280,
     WH_COMM_MTU = (WH_COMM_HEADER_LEN + WH_COMM_DATA_LEN),
     WH_COMM_MTU_U64_COUNT = (WH_COMM_MTU + 7) / 8,  /* internal U64 buffer */
 };
@@ -83,7 +85,8 @@ typedef struct {
 
 enum {
     WH_COMM_AUX_REQ_NORMAL      = 0x0000, /* Normal request. No session */
-    /* Request Aux values 1-0xFFFE are session ids */
+    /* Request Aux values 1-0xFFFD are session ids */
+    WH_COMM_AUX_REQ_MORE        = 0xFFFE, /* Fragment with more to follow */
     WH_COMM_AUX_REQ_NORESP      = 0xFFFF, /* Async request without response*/
 
     WH_COMM_AUX_RESP_OK         = 0x0000, /* Response is valid */
@@ -98,10 +101,18 @@ uint16_t wh_Translate16(uint16_t magic, uint16_t val);
 uint32_t wh_Translate32(uint16_t magic, uint32_t val);
 uint64_t wh_Translate64(uint16_t magic, uint64_t val);
 
+#ifdef WOLFHSM_COMM_NATIVE
+/* Client and server share endianness.  Packets not marked with a native magic
+ * are rejected, so struct members are copied as is without testing magic */
+#define WH_T16(_m, _d, _s, _f) ((void)(_m), _d->_f = _s->_f)
+#define WH_T32(_m, _d, _s, _f) ((void)(_m), _d->_f = _s->_f)
+#define WH_T64(_m, _d, _s, _f) ((void)(_m), _d->_f = _s->_f)
+#else
 /* Helper macros for struct members */
 #define WH_T16(_m, _d, _s, _f) _d->_f = wh_Translate16(_m, _s->_f)
 #define WH_T32(_m, _d, _s, _f) _d->_f = wh_Translate32(_m, _s->_f)
 #define WH_T64(_m, _d, _s, _f) _d->_f = wh_Translate64(_m, _s->_f)
+#endif /* WOLFHSM_COMM_NATIVE */
 
 
 /** Common client/server functions */
@@ -118,6 +129,59 @@ typedef int (*whCommSetConnectedCb)(void* context, whCommConnected connected);
 
 
 
+/* Fragment of a request gathered by wh_CommClient_SendRequestV */
+typedef struct {
+    const void* data;
+    size_t len;
+} whCommIov;
+
+/* Max number of caller fragments in a single gathered request */
+#define WH_COMM_IOV_MAX_COUNT 8
+
+
+/** Endpoint packet statistics.  Define WOLFHSM_COMM_STATS to enable */
+#ifdef WOLFHSM_COMM_STATS
+
+/* Return a monotonic timestamp, such as microseconds.  Without a callback
+ * spins are only measured in retries */
+typedef uint64_t (*whCommTimeCb)(void* context);
+
+/* Counters of transport calls in one direction.  A spin is a run of
+ * WH_ERROR_NOTREADY results ended by a successful call.  On a server, receive
+ * spins are idle time between requests.
+ */
+typedef struct {
+    uint64_t bytes;
+    uint64_t spin_time_max;     /* Longest spin in time_cb units */
+    uint32_t packets;
+    uint32_t notready;          /* Calls that returned WH_ERROR_NOTREADY */
+    uint32_t spin_max;          /* Most NOTREADY calls before a success */
+    uint8_t padding[4];
+} whCommStatsDir;
+
+typedef struct {
+    whCommStatsDir tx;
+    whCommStatsDir rx;
+    uint32_t seq_gaps;          /* Packets whose seq did not follow the last */
+    uint8_t padding[4];
+} whCommStats;
+
+/* Per-endpoint bookkeeping behind whCommStats */
+typedef struct {
+    whCommStats stats;
+    whCommTimeCb time_cb;
+    void* time_context;
+    uint64_t tx_spin_start;
+    uint64_t rx_spin_start;
+    uint32_t tx_spin;
+    uint32_t rx_spin;
+    uint16_t rx_seq;            /* Seq of the last packet received */
+    uint8_t padding[6];
+} whCommStatsState;
+
+#endif /* WOLFHSM_COMM_STATS */
+
+
 /** CommClient component types */
 
 /* Client transport interface */
@@ -138,6 +202,12 @@ typedef struct {
      */
     int (*Send)(void* context, uint16_t size, const void* data);
 
+    /* Optional. Send a new request gathered from iov_count fragments that
+     * total no more than the MTU, copying each directly into the transport
+     * buffer.  Same returns as Send.
+     */
+    int (*SendV)(void* context, uint16_t iov_count, const whCommIov* iov);
+
     /* Receive a new response from the server.
      * Returns: 0 on success,
      *          WH_ERROR_BADARGS if NULL data or context
@@ -146,6 +216,12 @@ typedef struct {
      */
     int (*Recv)(void* context, uint16_t *out_size, void* data);
 
+    /* Optional. Get a transport owned buffer of at least WH_COMM_MTU bytes
+     * that Send and Recv use without copying.  The comm layer builds packets
+     * directly in it.  Returns NULL if the comm buffer should be used.
+     */
+    uint8_t* (*GetBuffer)(void* context);
+
     /* Close the connection.
      * Returns: 0 on success,
      *          WH_ERROR_BADARGS if NULL context
@@ -153,13 +229,40 @@ typedef struct {
     int (*Cleanup)(void* context);
 } whTransportClientCb;
 
+/* Pipelining slot states */
+enum {
+    WH_COMM_SLOT_FREE       = 0,    /* No request outstanding */
+    WH_COMM_SLOT_PENDING    = 1,    /* Request sent, waiting for response */
+    WH_COMM_SLOT_READY      = 2,    /* Response received, not yet claimed */
+};
+
+/* Bookkeeping for one in-flight request when pipelining.  A response that
+ * arrives while the caller is waiting on a different sequence number is
+ * parked in its slot's packet buffer until claimed.
+ */
+typedef struct {
+    uint64_t packet[WH_COMM_MTU_U64_COUNT];
+    uint16_t seq;
+    uint16_t size;      /* Size of the parked response packet */
+    uint16_t state;
+    uint8_t pad[2];
+} whCommClientSlot;
+
 typedef struct {
     const whTransportClientCb* transport_cb;
     void* transport_context;
     const void* transport_config;
     whCommSetConnectedCb connect_cb;
+    /* Optional pipelining window. NULL/0 keeps strict request/response
+     * lockstep */
+    whCommClientSlot* slots;
+    uint16_t slot_count;
     uint8_t client_id;
-    uint8_t pad[7];
+    uint8_t pad[5];
+#ifdef WOLFHSM_COMM_STATS
+    whCommTimeCb time_cb;
+    void* time_context;
+#endif
 } whCommClientConfig;
 
 /* Context structure for a client.  Note the client context will track the
@@ -170,6 +273,7 @@ typedef struct {
     void* transport_context;
     const whTransportClientCb* transport_cb;
     whCommSetConnectedCb connect_cb;
+    whCommClientSlot* slots;
     whCommHeader* hdr;
     uint8_t* data;
     int initialized;
@@ -178,7 +282,15 @@ typedef struct {
     uint16_t size;
     uint8_t client_id;
     uint8_t server_id;
-    uint8_t pad[4];
+    uint16_t slot_count;
+    uint16_t inflight;      /* Pipelined or in-place requests outstanding */
+    uint16_t frag_offset;   /* Data already sent by SendRequestFragV */
+    uint16_t frag_seq;      /* Seq of the fragment awaiting its ack */
+    uint8_t frag_wait;
+    uint8_t padding[3];
+#ifdef WOLFHSM_COMM_STATS
+    whCommStatsState stats;
+#endif
 } whCommClient;
 
 
@@ -189,20 +301,49 @@ typedef struct {
 int wh_CommClient_Init(whCommClient* context, const whCommClientConfig* config);
 
 /* If a request buffer is available, send a new request to the server.  The
- * transport will update the sequence number on success.
+ * transport will update the sequence number on success.  When pipelining,
+ * returns WH_ERROR_NOTREADY while slot_count requests are in flight.
  */
 int wh_CommClient_SendRequest(whCommClient* context, uint16_t magic,
     uint16_t kind, uint16_t *out_seq, uint16_t data_size, const void* data);
 
+/* Same as wh_CommClient_SendRequest, but the request data is gathered from
+ * up to WH_COMM_IOV_MAX_COUNT fragments.  Transports that provide SendV copy
+ * each fragment once, directly into their buffer.
+ */
+int wh_CommClient_SendRequestV(whCommClient* context, uint16_t magic,
+    uint16_t kind, uint16_t *out_seq, uint16_t iov_count, const whCommIov* iov);
+
+/* Same as wh_CommClient_SendRequestV, but the request data may exceed
+ * WH_COMM_DATA_LEN.  Larger requests are split into frames marked with
+ * WH_COMM_AUX_REQ_MORE that the server acknowledges and reassembles before
+ * dispatch.  Returns WH_ERROR_NOTREADY while fragments remain, so call again
+ * with the same arguments until the final frame is sent and out_seq is set.
+ * The response is then received as usual.  Returns WH_ERROR_NOHANDLER if the
+ * server cannot reassemble and WH_ERROR_ABORTED if the request does not fit.
+ */
+int wh_CommClient_SendRequestFragV(whCommClient* context, uint16_t magic,
+    uint16_t kind, uint16_t *out_seq, uint16_t iov_count, const whCommIov* iov);
+
 /* If a response packet has been buffered, get the header and copy the data out
- * of the buffer.
+ * of the buffer.  When pipelining, parked responses are returned oldest first
+ * before the transport is polled.
  */
 int wh_CommClient_RecvResponse(whCommClient* context,
         uint16_t* out_magic, uint16_t* out_kind, uint16_t* out_seq,
         uint16_t* out_size, void* data);
 
+/* Pipelining only.  Get the response matching seq, parking any other
+ * in-flight response that arrives first.  Returns WH_ERROR_NOTREADY until the
+ * matching response is received and WH_ERROR_BADARGS if seq is not in flight.
+ */
+int wh_CommClient_RecvResponseSeq(whCommClient* context, uint16_t seq,
+        uint16_t* out_magic, uint16_t* out_kind,
+        uint16_t* out_size, void* data);
+
 /* Get a pointer to the data portion of the internal buffer that is
- * HW_COMM_DATA_LEN bytes.
+ * HW_COMM_DATA_LEN bytes.  If the transport provides GetBuffer, this points
+ * into the transport buffer so requests built here are sent without a copy.
  */
 uint8_t* wh_CommClient_GetDataPtr(whCommClient* context);
 
@@ -211,6 +352,14 @@ uint8_t* wh_CommClient_GetDataPtr(whCommClient* context);
  */
 int wh_CommClient_Cleanup(whCommClient* context);
 
+#ifdef WOLFHSM_COMM_STATS
+/* Copy the packet statistics of the client endpoint to out_stats */
+int wh_CommClient_StatsGet(whCommClient* context, whCommStats* out_stats);
+
+/* Clear the packet statistics of the client endpoint */
+int wh_CommClient_StatsReset(whCommClient* context);
+#endif /* WOLFHSM_COMM_STATS */
+
 
 /** CommServer component types */
 
@@ -240,6 +389,24 @@ typedef struct {
      */
     int (*Send)(void* context, uint16_t data_size, const void* data);
 
+    /* Optional. Multi-connection transports report the client id bound to
+     * the connection of the last received request.  Called after each
+     * successful Recv to update the comm client_id.
+     */
+    int (*GetClientId)(void* context, uint8_t* out_client_id);
+
+    /* Optional. Bind a client id to the connection of the last received
+     * request.  Called before each Send so a comm init sticks to its
+     * connection.
+     */
+    int (*SetClientId)(void* context, uint8_t client_id);
+
+    /* Optional. Get a transport owned buffer of at least WH_COMM_MTU bytes
+     * that Send and Recv use without copying.  The comm layer builds packets
+     * directly in it.  Returns NULL if the comm buffer should be used.
+     */
+    uint8_t* (*GetBuffer)(void* context);
+
     /* Close the connection.
      * Returns: 0 on success,
      *          WH_ERROR_BADARGS if NULL context
@@ -251,8 +418,16 @@ typedef struct {
     void* transport_context;
     const whTransportServerCb* transport_cb;
     const void* transport_config;
+    /* Optional 8-byte aligned buffer to reassemble fragmented requests up to
+     * frag_size bytes.  NULL/0 rejects fragments */
+    uint8_t* frag_buffer;
+    uint16_t frag_size;
     uint8_t server_id;
-    uint8_t pad[7];
+    uint8_t pad[5];
+#ifdef WOLFHSM_COMM_STATS
+    whCommTimeCb time_cb;
+    void* time_context;
+#endif
 } whCommServerConfig;
 
 /* Context structure for a server.  Note the client context will track the
@@ -264,10 +439,20 @@ typedef struct {
     const whTransportServerCb* transport_cb;
     whCommHeader* hdr;
     uint8_t* data;
+    uint8_t* frag_buffer;
     int initialized;
     uint16_t reqid;
     uint8_t client_id;
     uint8_t server_id;
+    uint16_t frag_size;
+    uint16_t frag_len;      /* Bytes reassembled so far */
+    uint16_t frag_kind;
+    uint16_t frag_seq;      /* Seq of the last fragment reassembled */
+    uint8_t frag_client_id;
+    uint8_t padding[7];
+#ifdef WOLFHSM_COMM_STATS
+    whCommStatsState stats;
+#endif
 } whCommServer;
 
 /* Reset the state of the server context and begin the connection to a client
@@ -284,6 +469,18 @@ int wh_CommServer_RecvRequest(whCommServer* context,
         uint16_t* out_magic, uint16_t* out_kind, uint16_t* out_seq,
         uint16_t* out_size, void* data);
 
+/* Same as wh_CommServer_RecvRequest, but fragmented requests are reassembled
+ * into the configured frag_buffer.  Each fragment is acknowledged here and
+ * returns WH_ERROR_NOTREADY.  Once the final fragment arrives, out_data points
+ * to the complete request of up to frag_size bytes, otherwise it points to the
+ * internal buffer.  Responses are still limited to WH_COMM_DATA_LEN bytes.
+ * A request that does not continue the pending one by kind and seq discards
+ * the partial reassembly and is handled on its own.
+ */
+int wh_CommServer_RecvRequestFrag(whCommServer* context,
+        uint16_t* out_magic, uint16_t* out_kind, uint16_t* out_seq,
+        uint16_t* out_size, uint8_t** out_data);
+
 /* Upon completion of the request, send the response packet using the same seq
  * as the incoming request.  Note that overriding the seq number should only be
  * used for asynchronous notifications, such as keep-alive or close.
@@ -293,11 +490,20 @@ int wh_CommServer_SendResponse(whCommServer* context,
         uint16_t data_size, const void* data);
 
 /* Get a pointer to the data portion of the internal buffer that is
- * WH_COMM_DATA_LEN bytes long.
+ * WH_COMM_DATA_LEN bytes long.  If the transport provides GetBuffer, this
+ * points into the transport buffer so requests are handled in place.
  */
 uint8_t* wh_CommServer_GetDataPtr(whCommServer* context);
 
 
 int wh_CommServer_Cleanup(whCommServer* context);
 
+#ifdef WOLFHSM_COMM_STATS
+/* Copy the packet statistics of the server endpoint to out_stats */
+int wh_CommServer_StatsGet(whCommServer* context, whCommStats* out_stats);
+
+/* Clear the packet statistics of the server endpoint */
+int wh_CommServer_StatsReset(whCommServer* context);
+#endif /* WOLFHSM_COMM_STATS */
+
 #endif /* WOLFHSM_WH_COMM_H_ */
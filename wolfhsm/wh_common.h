@@ -29,16 +29,172 @@
 
 /* Device Id to be registered and passed to wolfCrypt functions */
 #define WOLFHSM_DEV_ID 0x5748534D  /* "WHSM" */
+/* Device Id for objects whose bulk data the server reads and writes directly
+ * in client memory */
+#define WOLFHSM_DEV_ID_DMA 0x57444D41  /* "WDMA" */
 
 #define WOLFHSM_DIGEST_STUB 8
 
+/** Sizing profiles
+ * Define WOLFHSM_PROFILE_SMALL for SHE-only parts with little SRAM, or
+ * WOLFHSM_PROFILE_LARGE for gateways with many clients, keys and objects.
+ * Without either the defaults below are used.  A size defined on its own
+ * overrides the profile.  WH_COMM_DATA_LEN is part of the protocol, so clients
+ * and servers must be built with the same value */
+#if defined(WOLFHSM_PROFILE_SMALL) && defined(WOLFHSM_PROFILE_LARGE)
+#error "Define at most one of WOLFHSM_PROFILE_SMALL and WOLFHSM_PROFILE_LARGE"
+#endif
+
+#if defined(WOLFHSM_PROFILE_SMALL)
+#ifndef WH_COMM_DATA_LEN
+#define WH_COMM_DATA_LEN 512
+#endif
+#ifndef WOLFHSM_NUM_RAMKEYS
+#define WOLFHSM_NUM_RAMKEYS 4
+#endif
+#ifndef WOLFHSM_NUM_NVMOBJECTS
+#define WOLFHSM_NUM_NVMOBJECTS 16
+#endif
+#ifndef WOLFHSM_NUM_COUNTERS
+#define WOLFHSM_NUM_COUNTERS 4
+#endif
+/* 64 bytes is the largest key cached.  SHE keys are 16 bytes, so the slab
+ * arena is 16*4 + 32*2 + 48*1 + 64*1 = 240 bytes */
+#ifndef WOLFHSM_KEYCACHE_BUFSIZE
+#define WOLFHSM_KEYCACHE_BUFSIZE 64
+#endif
+#ifndef WOLFHSM_KEYCACHE_SLAB0_SIZE
+#define WOLFHSM_KEYCACHE_SLAB0_SIZE 16
+#endif
+#ifndef WOLFHSM_KEYCACHE_SLAB0_COUNT
+#define WOLFHSM_KEYCACHE_SLAB0_COUNT 4
+#endif
+#ifndef WOLFHSM_KEYCACHE_SLAB1_SIZE
+#define WOLFHSM_KEYCACHE_SLAB1_SIZE 32
+#endif
+#ifndef WOLFHSM_KEYCACHE_SLAB1_COUNT
+#define WOLFHSM_KEYCACHE_SLAB1_COUNT 2
+#endif
+#ifndef WOLFHSM_KEYCACHE_SLAB2_SIZE
+#define WOLFHSM_KEYCACHE_SLAB2_SIZE 48
+#endif
+#ifndef WOLFHSM_KEYCACHE_SLAB2_COUNT
+#define WOLFHSM_KEYCACHE_SLAB2_COUNT 1
+#endif
+#ifndef WOLFHSM_KEYCACHE_SLAB3_COUNT
+#define WOLFHSM_KEYCACHE_SLAB3_COUNT 1
+#endif
+
+#elif defined(WOLFHSM_PROFILE_LARGE)
+#ifndef WH_COMM_DATA_LEN
+#define WH_COMM_DATA_LEN 4096
+#endif
+#ifndef WOLFHSM_NUM_RAMKEYS
+#define WOLFHSM_NUM_RAMKEYS 64
+#endif
+#ifndef WOLFHSM_NUM_NVMOBJECTS
+#define WOLFHSM_NUM_NVMOBJECTS 256
+#endif
+#ifndef WOLFHSM_NUM_COUNTERS
+#define WOLFHSM_NUM_COUNTERS 32
+#endif
+/* RSA-4096 private keys */
+#ifndef WOLFHSM_KEYCACHE_BUFSIZE
+#define WOLFHSM_KEYCACHE_BUFSIZE 2400
+#endif
+#ifndef WOLFHSM_KEYCACHE_SLAB0_COUNT
+#define WOLFHSM_KEYCACHE_SLAB0_COUNT 64
+#endif
+#ifndef WOLFHSM_KEYCACHE_SLAB1_COUNT
+#define WOLFHSM_KEYCACHE_SLAB1_COUNT 32
+#endif
+#ifndef WOLFHSM_KEYCACHE_SLAB2_COUNT
+#define WOLFHSM_KEYCACHE_SLAB2_COUNT 32
+#endif
+#ifndef WOLFHSM_KEYCACHE_SLAB3_COUNT
+#define WOLFHSM_KEYCACHE_SLAB3_COUNT 16
+#endif
+#endif /* WOLFHSM_PROFILE_* */
+
 /** Resource allocations */
+/* Bytes of data in a request or response packet, after the header */
+#ifndef WH_COMM_DATA_LEN
+#define WH_COMM_DATA_LEN 1280
+#endif
+
+/* Number of RAM keys */
+#ifndef WOLFHSM_NUM_RAMKEYS
+#define WOLFHSM_NUM_RAMKEYS 16
+#endif
+
+/* Number of non-volatile 32-bit counters */
+#ifndef WOLFHSM_NUM_COUNTERS
+#define WOLFHSM_NUM_COUNTERS 8
+#endif
+
+/* Number of NVM objects in the directory */
+#ifndef WOLFHSM_NUM_NVMOBJECTS
+#define WOLFHSM_NUM_NVMOBJECTS 32
+#endif
+
+/* Size in bytes of largest cached key */
+#ifndef WOLFHSM_KEYCACHE_BUFSIZE
+#define WOLFHSM_KEYCACHE_BUFSIZE 1200
+#endif
+
+/* Parsed RSA and ECC keys kept alongside their key cache slots.  0 decodes
+ * the cached key on every use */
+#ifndef WOLFHSM_NUM_DECODED_KEYS
+#define WOLFHSM_NUM_DECODED_KEYS 0
+#endif
+
+/* Entries in the key cache id index.  Twice the keys keeps probes short */
+#define WOLFHSM_KEYCACHE_INDEX_SIZE (2 * WOLFHSM_NUM_RAMKEYS)
+
+/* Key cache arena.  Each cached key takes a block from the smallest size class
+ * that fits, or from a larger class once that one is used up.  Class sizes
+ * must be ascending and at least 2 bytes, the last is the largest cacheable
+ * key */
+#define WOLFHSM_KEYCACHE_SLAB_CLASSES 4
+#ifndef WOLFHSM_KEYCACHE_SLAB0_SIZE
+#define WOLFHSM_KEYCACHE_SLAB0_SIZE 32
+#endif
+#ifndef WOLFHSM_KEYCACHE_SLAB0_COUNT
+#define WOLFHSM_KEYCACHE_SLAB0_COUNT 16
+#endif
+#ifndef WOLFHSM_KEYCACHE_SLAB1_SIZE
+#define WOLFHSM_KEYCACHE_SLAB1_SIZE 64
+#endif
+#ifndef WOLFHSM_KEYCACHE_SLAB1_COUNT
+#define WOLFHSM_KEYCACHE_SLAB1_COUNT 8
+#endif
+#ifndef WOLFHSM_KEYCACHE_SLAB2_SIZE
+#define WOLFHSM_KEYCACHE_SLAB2_SIZE 256
+#endif
+#ifndef WOLFHSM_KEYCACHE_SLAB2_COUNT
+#define WOLFHSM_KEYCACHE_SLAB2_COUNT 8
+#endif
+#ifndef WOLFHSM_KEYCACHE_SLAB3_SIZE
+#define WOLFHSM_KEYCACHE_SLAB3_SIZE WOLFHSM_KEYCACHE_BUFSIZE
+#endif
+#ifndef WOLFHSM_KEYCACHE_SLAB3_COUNT
+#define WOLFHSM_KEYCACHE_SLAB3_COUNT 8
+#endif
+#define WOLFHSM_KEYCACHE_ARENA_SIZE                                     \
+    (WOLFHSM_KEYCACHE_SLAB0_SIZE * WOLFHSM_KEYCACHE_SLAB0_COUNT +       \
+     WOLFHSM_KEYCACHE_SLAB1_SIZE * WOLFHSM_KEYCACHE_SLAB1_COUNT +       \
+     WOLFHSM_KEYCACHE_SLAB2_SIZE * WOLFHSM_KEYCACHE_SLAB2_COUNT +       \
+     WOLFHSM_KEYCACHE_SLAB3_SIZE * WOLFHSM_KEYCACHE_SLAB3_COUNT)
+
+/* Key cache eviction policies, applied to committed and unpinned keys only */
+#define WOLFHSM_KEYCACHE_EVICT_FIRST 0  /* Lowest numbered slot */
+#define WOLFHSM_KEYCACHE_EVICT_LRU   1  /* Least recently used slot */
+#ifndef WOLFHSM_KEYCACHE_EVICT
+#define WOLFHSM_KEYCACHE_EVICT WOLFHSM_KEYCACHE_EVICT_LRU
+#endif
+
 enum {
-    WOLFHSM_NUM_COUNTERS = 8,       /* Number of non-volatile 32-bit counters */
-    WOLFHSM_NUM_RAMKEYS = 16,        /* Number of RAM keys */
-    WOLFHSM_NUM_NVMOBJECTS = 32,    /* Number of NVM objects in the directory */
     WOLFHSM_NUM_MANIFESTS = 8,      /* Number of compiletime manifests */
-    WOLFHSM_KEYCACHE_BUFSIZE = 1200, /* Size in bytes of key cache buffer  */
 };
 
 
@@ -70,6 +226,21 @@ typedef uint16_t whKeyId;
 #define WOLFHSM_KEYFLAG_HMAC        0x6000
 #define WOLFHSM_KEYFLAG_CMAC        0x7000
 
+/* Hash and MAC session types */
+enum {
+    WH_HASH_SESSION_SHA256 = 1,
+    WH_HASH_SESSION_SHA384 = 2,
+    WH_HASH_SESSION_HMAC_SHA256 = 3,
+    WH_HASH_SESSION_HMAC_SHA384 = 4,
+    WH_HASH_SESSION_CMAC_AES = 5,
+};
+
+/* Signature schemes of an image verify */
+enum {
+    WH_IMAGE_SIG_ECC = 1,       /* ECDSA, DER encoded signature */
+    WH_IMAGE_SIG_RSA = 2,       /* RSA PKCS#1 v1.5 of the encoded digest */
+};
+
 /* Key Types */
 #define WOLFHSM_KEYTYPE_CRYPTO  0x1000
 /* She keys are technically raw keys but a SHE keyId needs */
@@ -104,6 +275,10 @@ enum {
 #define WOLFHSM_NVM_ACCESS_ANY (0xFFFF)
 #define WOLFHSM_NVM_FLAGS_ANY (0xFFFF)
 
+/* Object flags */
+#define WOLFHSM_NVM_FLAGS_NONE   (0x0000)
+#define WOLFHSM_NVM_FLAGS_PINNED (0x0001) /* Never evicted from the key cache */
+
 /* User-specified metadata for an NVM object, MUST be a multiple of
  * WHFU_BYTES_PER_UNIT */
 typedef struct {
@@ -115,6 +290,22 @@ typedef struct {
 } whNvmMetadata;
 /* static_assert(sizeof(whNvmMetadata) == WOLFHSM_NVM_METADATA_LEN) */
 
+/* Flash wear counters since the backend was initialized.  Write
+ * amplification is program_bytes over data_bytes.  Backends leave the fields
+ * they do not track 0 */
+typedef struct {
+    uint64_t data_bytes;        /* Object data bytes callers added */
+    uint64_t program_bytes;     /* Bytes programmed, with headers and copies */
+    uint64_t erase_bytes;       /* Bytes erased */
+    uint32_t program_ops;       /* Program operations issued */
+    uint32_t erase_ops;         /* Erase operations issued */
+    uint32_t blank_checks;      /* Blank check operations issued */
+    uint32_t verifies;          /* Verify operations issued */
+    uint32_t compactions;       /* Partition regenerations completed */
+    uint32_t partition_erases[2];   /* Erases of each partition */
+    uint8_t padding[4];
+} whNvmStats;
+
 
 /* Custom request shared defs */
 #define WH_CUSTOM_CB_NUM_CALLBACKS 8
@@ -153,6 +344,9 @@ typedef struct {
 #define WOLFHSM_SHE_FLAG_DEBUGGER_PROTECTION (1 << 2)
 #define WOLFHSM_SHE_FLAG_USAGE (1 << 3)
 #define WOLFHSM_SHE_FLAG_WILDCARD (1 << 4)
+/* streaming cipher modes */
+#define WOLFHSM_SHE_CIPHER_ECB 1
+#define WOLFHSM_SHE_CIPHER_CBC 2
 #define WOLFHSM_SHE_M1_SZ 16
 #define WOLFHSM_SHE_M2_SZ 32
 #define WOLFHSM_SHE_M3_SZ WOLFHSM_SHE_M1_SZ
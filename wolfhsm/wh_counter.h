@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * wolfhsm/wh_counter.h
+ *
+ * Non-volatile monotonic counters served from RAM and journaled to flash.
+ *
+ * The flash is split into two partitions.  The active one starts with a
+ * checkpoint of every counter and is followed by one unit journal records:
+ *
+ *   header:      magic and epoch           (programmed last)
+ *   checkpoint:  WOLFHSM_NUM_COUNTERS 32-bit limits
+ *   records:     counter id, ~id and a new limit, appended in order
+ *
+ * A limit is the highest value a counter may reach before the next record.
+ * An increment that reaches it appends a record raising it by reserve, so
+ * only one increment in reserve programs flash.  After a restart counters
+ * continue from their limit, which skips at most reserve values but never
+ * repeats one.  A full journal is checkpointed into the other partition with
+ * the next epoch, and the highest valid epoch is used at init.
+ *
+ * Example usage:
+ *
+ * whCounterConfig ccfg[1] = {{
+ *      .cb = myFlashCb,
+ *      .context = myFlashContext,
+ *      .config = myFlashConfig,
+ *      .partition_size = 4096,
+ *      .reserve = 64,
+ * }};
+ * whCounterContext cc[1] = {0};
+ * rc = wh_Counter_Init(cc, ccfg);
+ */
+
+#ifndef WOLFHSM_WH_COUNTER_H_
+#define WOLFHSM_WH_COUNTER_H_
+
+#include <stdint.h>
+
+#include "wolfhsm/wh_common.h"
+#include "wolfhsm/wh_flash.h"
+
+typedef struct whCounterConfig_t {
+    const whFlashCb* cb;        /* whFlash callback */
+    void* context;              /* whFlash context to be passed to cb */
+    const void* config;         /* Config to be passed to cb->Init */
+    uint32_t partition_size;    /* Bytes in each partition.  0 for
+                                 * PartitionSize */
+    uint32_t reserve;           /* Increments per journal record.  0 is 1 */
+} whCounterConfig;
+
+typedef struct whCounterContext_t {
+    const whFlashCb* cb;        /* Flash callbacks */
+    void* flash;                /* Flash context to use */
+    uint32_t partition_units;
+    uint32_t reserve;
+    uint32_t epoch;             /* Epoch of the active partition */
+    uint32_t next_unit;         /* First unit not yet programmed */
+    uint16_t active;            /* Active partition, 0 or 1 */
+    uint8_t padding[2];
+    int initialized;
+    uint32_t value[WOLFHSM_NUM_COUNTERS];
+    uint32_t limit[WOLFHSM_NUM_COUNTERS];
+} whCounterContext;
+
+/* Load the counters from flash, formatting it if neither partition holds a
+ * checkpoint */
+int wh_Counter_Init(whCounterContext* context, const whCounterConfig* config);
+int wh_Counter_Cleanup(whCounterContext* context);
+
+/* Current value of a counter */
+int wh_Counter_Read(whCounterContext* context, whCounterId id,
+        uint32_t* out_value);
+
+/* Add one to a counter and return its new value.  Returns WH_ERROR_NOSPACE
+ * once the counter has reached UINT32_MAX */
+int wh_Counter_Increment(whCounterContext* context, whCounterId id,
+        uint32_t* out_value);
+
+/* Write every limit to the other partition and start an empty journal
+ * there.  Done automatically when the journal is full */
+int wh_Counter_Checkpoint(whCounterContext* context);
+
+#endif /* WOLFHSM_WH_COUNTER_H_ */
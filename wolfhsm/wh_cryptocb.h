@@ -47,6 +47,10 @@
 #include "wolfssl/wolfcrypt/cryptocb.h"
 
 int wolfHSM_CryptoCb(int devId, wc_CryptoInfo* info, void* ctx);
+/* Registered as WOLFHSM_DEV_ID_DMA.  AES input and output stay in client memory
+ * and are accessed by the server through DMA, so they are not limited by the
+ * packet size.  Other algorithms are passed to wolfHSM_CryptoCb */
+int wolfHSM_CryptoCbDma(int devId, wc_CryptoInfo* info, void* ctx);
 
 #ifdef __cplusplus
     } /* extern "C" */
@@ -35,6 +35,7 @@ enum {
     WH_ERROR_BADARGS        = -400, /* No side effects. Fix args. */
     WH_ERROR_NOTREADY       = -401, /* Retry function. */
     WH_ERROR_ABORTED        = -402, /* Function has fatally failed. Cleanup. */
+    WH_ERROR_NOTIMPL        = -403, /* Not supported by this back end */
 
     /* NVM-specific status returns */
     WH_ERROR_LOCKED         = -410, /* Unlock and retry if necessary */
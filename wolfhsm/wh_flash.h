@@ -50,6 +50,25 @@ typedef struct {
             uint32_t offset, uint32_t size, const uint8_t* data);
     int (*BlankCheck)(void* context,
             uint32_t offset, uint32_t size);
+
+    /* Optional non-blocking erase and program.  A start returns once the
+     * controller has accepted the operation and Poll returns
+     * WH_ERROR_NOTREADY until it completes, then its result.  Only one
+     * operation may be outstanding and no other callback may be used until
+     * Poll has reported it complete.  Program data must stay valid until
+     * then.  Leave all three NULL for a synchronous back end */
+    int (*EraseStart)(void* context,
+            uint32_t offset, uint32_t size);
+    int (*ProgramStart)(void* context,
+            uint32_t offset, uint32_t size, const uint8_t* data);
+    int (*Poll)(void* context);
+
+    /* Optional direct access to memory mapped flash.  Sets *out_ptr to the
+     * size bytes at offset, which stay readable in place until the range is
+     * next programmed or erased.  Returns WH_ERROR_NOTIMPL, or is NULL, when
+     * the array is not addressable */
+    int (*Map)(void* context,
+            uint32_t offset, uint32_t size, const uint8_t** out_ptr);
 } whFlashCb;
 
 #endif /* WOLFHSM_WH_FLASH_H_ */
@@ -27,17 +27,59 @@ typedef struct {
     uint32_t sectorSize;
     uint32_t pageSize;
     uint8_t  erasedByte;
-    uint8_t padding[3];
+    uint8_t  busyPolls;     /* Polls that report a started erase or program
+                             * as busy before it completes */
+    uint8_t  mapped;        /* Nonzero to offer Map, as memory mapped flash
+                             * would */
+    uint8_t padding[1];
+    /* Optional cost model, 0 for free.  Read time also covers the bytes
+     * compared by Verify and BlankCheck */
+    uint32_t readNsPerByte;
+    uint32_t programNsPerPage;
+    uint32_t eraseNsPerSector;
+    uint8_t  padding2[4];
+    uint64_t* clockNs;      /* Optional virtual clock advanced by the modeled
+                             * time, may be shared by several simulators */
 } whFlashRamsimCfg;
 
+/* Operation counts and modeled time, since Init or the last ResetStats */
+typedef struct {
+    uint64_t timeNs;
+    uint32_t reads;
+    uint32_t readBytes;
+    uint32_t programs;
+    uint32_t programPages;
+    uint32_t erases;
+    uint32_t eraseSectors;
+    uint32_t verifies;
+    uint32_t blankChecks;
+} whFlashRamsimStats;
+
+/* Operation started by EraseStart or ProgramStart */
+#define WH_FLASH_RAMSIM_OP_NONE     0
+#define WH_FLASH_RAMSIM_OP_ERASE    1
+#define WH_FLASH_RAMSIM_OP_PROGRAM  2
+
 typedef struct {
     uint8_t* memory;
     uint32_t size;
     uint32_t sectorSize;
     uint32_t pageSize;
     int      writeLocked;
+    const uint8_t* pendingData;
+    uint32_t pendingOffset;
+    uint32_t pendingSize;
+    int      pendingOp;     /* WH_FLASH_RAMSIM_OP_* */
+    uint32_t pendingPolls;  /* Polls left before it completes */
     uint8_t  erasedByte;
-    uint8_t padding[7];
+    uint8_t  busyPolls;
+    uint8_t  mapped;
+    uint8_t padding[1];
+    uint32_t readNsPerByte;
+    uint32_t programNsPerPage;
+    uint32_t eraseNsPerSector;
+    uint64_t* clockNs;
+    whFlashRamsimStats stats;
 } whFlashRamsimCtx;
 
 
@@ -55,6 +97,16 @@ int whFlashRamsim_BlankCheck(void* context, uint32_t offset, uint32_t size);
 uint32_t whFlashRamsim_PartitionSize(void* context);
 int whFlashRamsim_WriteLock(void* context, uint32_t offset, uint32_t size);
 int whFlashRamsim_WriteUnlock(void* context, uint32_t offset, uint32_t size);
+int whFlashRamsim_EraseStart(void* context, uint32_t offset, uint32_t size);
+int whFlashRamsim_ProgramStart(void* context, uint32_t offset, uint32_t size,
+                               const uint8_t* data);
+int whFlashRamsim_Poll(void* context);
+int whFlashRamsim_Map(void* context, uint32_t offset, uint32_t size,
+                      const uint8_t** out_ptr);
+
+/* Copy the counters into out_stats */
+int whFlashRamsim_GetStats(void* context, whFlashRamsimStats* out_stats);
+int whFlashRamsim_ResetStats(void* context);
 
 /* clang-format off */
 #define WH_FLASH_RAMSIM_CB                           \
@@ -69,6 +121,10 @@ int whFlashRamsim_WriteUnlock(void* context, uint32_t offset, uint32_t size);
         .Erase         = whFlashRamsim_Erase,         \
         .Verify        = whFlashRamsim_Verify,        \
         .BlankCheck    = whFlashRamsim_BlankCheck,    \
+        .EraseStart    = whFlashRamsim_EraseStart,    \
+        .ProgramStart  = whFlashRamsim_ProgramStart,  \
+        .Poll          = whFlashRamsim_Poll,          \
+        .Map           = whFlashRamsim_Map,           \
     }
 /* clang-format on */
 
@@ -75,6 +75,19 @@ int wh_FlashUnit_BlankCheck(const whFlashCb* cb, void* context, uint32_t offset,
 int wh_FlashUnit_Erase(const whFlashCb* cb, void* context, uint32_t offset,
         uint32_t count);
 
+/* Start erasing or programming count units at offset without waiting.
+ * Returns WH_ERROR_NOTREADY once the operation is outstanding, to be completed
+ * with wh_FlashUnit_Poll.  Back ends without the non-blocking callbacks run
+ * the synchronous version instead and return its result */
+int wh_FlashUnit_EraseStart(const whFlashCb* cb, void* context,
+        uint32_t offset, uint32_t count);
+int wh_FlashUnit_ProgramStart(const whFlashCb* cb, void* context,
+        uint32_t offset, uint32_t count, const whFlashUnit* data);
+
+/* Returns WH_ERROR_NOTREADY while an operation started above is outstanding,
+ * then its result.  0 when nothing is outstanding */
+int wh_FlashUnit_Poll(const whFlashCb* cb, void* context);
+
 /** Helper functions to use buffered reads and writes for bytes */
 
 int wh_FlashUnit_ReadBytes(const whFlashCb* cb, void* context, uint32_t byte_offset,
@@ -83,4 +96,83 @@ int wh_FlashUnit_ReadBytes(const whFlashCb* cb, void* context, uint32_t byte_off
 int wh_FlashUnit_ProgramBytes(const whFlashCb* cb, void* context, uint32_t byte_offset,
         uint32_t byte_count, const uint8_t* data);
 
+/* Point *out_data at byte_count bytes of memory mapped flash at byte_offset.
+ * Returns WH_ERROR_NOTIMPL when the back end cannot, so callers fall back to
+ * wh_FlashUnit_ReadBytes */
+int wh_FlashUnit_MapBytes(const whFlashCb* cb, void* context,
+        uint32_t byte_offset, uint32_t byte_count, const uint8_t** out_data);
+
+/** Write combining helpers
+ *
+ * A writer buffers contiguous unit programs and issues them as one program
+ * operation per flash page, which matters on NOR parts where every program
+ * pays the page latency.  Writes are programmed in the order they were made:
+ * a write that does not extend the buffered range flushes it first.  Callers
+ * end every sequence with wh_FlashUnit_WriterFinish, which programs the write
+ * that commits the sequence only after everything before it. */
+
+/* Which program operations are read back and compared */
+typedef enum {
+    WHFU_VERIFY_ALWAYS  = 0,    /* Every program operation */
+    WHFU_VERIFY_FINISH  = 1,    /* Only the commit of each sequence */
+    WHFU_VERIFY_NEVER   = 2,    /* None, the device checks itself (ECC) */
+} whFlashUnitVerify;
+
+/* Flash operation counters.  A writer adds the blank checks, programs and
+ * verifies it issues once given one with wh_FlashUnit_WriterSetStats.  The
+ * erase fields are for the owner to count its own erases */
+typedef struct {
+    uint64_t program_bytes;
+    uint64_t erase_bytes;
+    uint32_t program_ops;
+    uint32_t erase_ops;
+    uint32_t blank_checks;
+    uint32_t verifies;
+} whFlashUnitStats;
+
+/* Units a writer can combine into one program operation */
+#ifndef WHFU_WRITER_UNITS
+#define WHFU_WRITER_UNITS 32
+#endif
+
+typedef struct {
+    const whFlashCb* cb;
+    void* context;
+    whFlashUnitStats* stats;    /* Opt: Counters to add to, may be NULL */
+    uint32_t page_units;        /* Program page in units, 0 for no limit */
+    uint32_t offset;            /* Unit offset of buffer[0] */
+    uint32_t count;             /* Units buffered */
+    whFlashUnitVerify verify;
+    whFlashUnit buffer[WHFU_WRITER_UNITS];
+} whFlashUnitWriter;
+
+/* page_bytes is the device program page.  0 or a page that is not a multiple
+ * of the unit only limits combining to the buffer size */
+int wh_FlashUnit_WriterInit(whFlashUnitWriter* w, const whFlashCb* cb,
+        void* context, uint32_t page_bytes, whFlashUnitVerify verify);
+
+/* Count the operations of w in stats from now on.  NULL stops counting */
+void wh_FlashUnit_WriterSetStats(whFlashUnitWriter* w,
+        whFlashUnitStats* stats);
+
+/* Buffer count units for offset, programming what was buffered before when
+ * the new units do not extend it */
+int wh_FlashUnit_WriterProgram(whFlashUnitWriter* w, uint32_t offset,
+        uint32_t count, const whFlashUnit* data);
+
+/* Byte version of WriterProgram.  Like wh_FlashUnit_ProgramBytes, a partial
+ * final unit is zero filled */
+int wh_FlashUnit_WriterProgramBytes(whFlashUnitWriter* w, uint32_t byte_offset,
+        uint32_t byte_count, const uint8_t* data);
+
+/* Program everything buffered */
+int wh_FlashUnit_WriterFlush(whFlashUnitWriter* w);
+
+/* Drop everything buffered, used after a sequence has failed */
+void wh_FlashUnit_WriterDiscard(whFlashUnitWriter* w);
+
+/* Flush, then program the count units that commit the sequence */
+int wh_FlashUnit_WriterFinish(whFlashUnitWriter* w, uint32_t offset,
+        uint32_t count, const whFlashUnit* data);
+
 #endif /* WOLFHSM_WH_FLASH_UNIT_H_ */
@@ -52,6 +52,21 @@ enum {
     WH_KEY_EXPORT,
     WH_KEY_COMMIT,
     WH_KEY_ERASE,
+    WH_KEY_COMMIT_MANY,
+};
+
+/* crypto actions, past the wolfCrypt WC_ALGO_TYPE_* values used for the
+ * CryptoCb requests */
+enum {
+    WH_CRYPTO_CIPHER_SESSION = 0x80,
+    WH_CRYPTO_CIPHER_DMA = 0x81,
+    WH_CRYPTO_ECC_VERIFY_BATCH = 0x82,
+    WH_CRYPTO_HASH_SESSION = 0x83,
+};
+
+/* image actions */
+enum {
+    WH_IMAGE_VERIFY,
 };
 
 /* SHE actions */
@@ -73,6 +88,11 @@ enum {
     WH_SHE_DEC_CBC,
     WH_SHE_GEN_MAC,
     WH_SHE_VERIFY_MAC,
+    WH_SHE_SECURE_BOOT_DMA,
+    WH_SHE_CIPHER_STREAM,
+    WH_SHE_RND_BULK,
+    WH_SHE_RND_DMA,
+    WH_SHE_LOAD_KEY_BATCH,
 };
 
 /* Construct the message kind based on group and action */
@@ -82,6 +102,9 @@ enum {
 /* Extract the group from the message kind */
 #define WH_MESSAGE_GROUP(_K)        ((_K) & WH_MESSAGE_GROUP_MASK)
 
+/* Extract the group number (0-255) from the message kind, for table lookups */
+#define WH_MESSAGE_GROUP_INDEX(_K)  (WH_MESSAGE_GROUP(_K) >> 8)
+
 /* Extract the action from the message kind */
 #define WH_MESSAGE_ACTION(_K)      ((_K) & WH_MESSAGE_ACTION_MASK)
 
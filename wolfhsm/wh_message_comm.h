@@ -36,6 +36,11 @@ enum {
     WH_MESSAGE_COMM_ACTION_CLOSE     = 0x03,
     WH_MESSAGE_COMM_ACTION_INFO      = 0x04,
     WH_MESSAGE_COMM_ACTION_ECHO      = 0x05,
+    WH_MESSAGE_COMM_ACTION_BATCH     = 0x06,
+    WH_MESSAGE_COMM_ACTION_JOB       = 0x07,
+    WH_MESSAGE_COMM_ACTION_STATS     = 0x08,
+    WH_MESSAGE_COMM_ACTION_DMAMAP    = 0x09,
+    WH_MESSAGE_COMM_ACTION_DMAUNMAP  = 0x0A,
 };
 
 
@@ -77,6 +82,156 @@ int wh_MessageComm_TranslateInitResponse(uint16_t magic,
         const whMessageCommInitResponse* src,
         whMessageCommInitResponse* dest);
 
+/* Batch request/response envelope.  A header is followed by count entries,
+ * each an entry header plus len bytes of a sub-message padded to
+ * WH_MESSAGE_COMM_BATCH_ALIGN.  The server dispatches every sub-request in
+ * order and returns the responses in the same format, with rc set to the
+ * handler's return code.  Sub-requests are handled in a scratch buffer, so a
+ * response that does not fit in the remaining frame is returned empty with rc
+ * set to WH_ERROR_NOSPACE.  Batches may not be nested.
+ */
+enum {
+    WH_MESSAGE_COMM_BATCH_ALIGN = 8,
+};
+
+typedef struct {
+    uint16_t count;     /* Number of entries */
+    uint16_t len;       /* Total bytes of entries following the header */
+    uint8_t pad[4];
+} whMessageCommBatchHeader;
+
+typedef struct {
+    uint16_t kind;      /* Message kind of the sub-message */
+    uint16_t len;       /* Unpadded length of the sub-message */
+    int32_t rc;         /* Response only.  Return code of the handler */
+} whMessageCommBatchEntry;
+
+/* Reset a batch buffer to hold no entries */
+int wh_MessageComm_BatchInit(void* batch, uint16_t batch_size);
+
+/* Append an entry to a batch buffer of batch_size bytes.  On success, the
+ * header count and len are updated.  Returns WH_ERROR_NOSPACE if the entry
+ * does not fit */
+int wh_MessageComm_BatchAppend(uint16_t magic, void* batch, uint16_t batch_size,
+        uint16_t kind, int32_t rc, uint16_t len, const void* data);
+
+/* Iterate the entries of a batch of batch_size used bytes, such as the
+ * received message size.  The header is not read, so entries may be consumed
+ * while the buffer is reused.  *inout_offset must be 0 on the first call and
+ * is advanced past the returned entry.  out_data points into the batch.
+ * Returns WH_ERROR_NOTFOUND after the last entry */
+int wh_MessageComm_BatchNext(uint16_t magic, const void* batch,
+        uint16_t batch_size, uint16_t* inout_offset,
+        uint16_t* out_kind, int32_t* out_rc, uint16_t* out_len,
+        const void** out_data);
+
+/* Job poll request/response.  rc is WH_ERROR_NOTREADY while the job runs
+ * and WH_ERROR_NOTFOUND if the client owns no job with this id.  Otherwise rc
+ * is the job result and len bytes of result data follow in the format of the
+ * response to the original request of the given kind.  The job is released
+ * once its result is returned. */
+typedef struct {
+    uint16_t id;
+    uint8_t pad[2];
+} whMessageCommJobRequest;
+
+typedef struct {
+    int32_t rc;
+    uint16_t id;
+    uint16_t kind;
+    uint16_t len;
+    uint8_t pad[2];
+} whMessageCommJobResponse;
+
+int wh_MessageComm_TranslateJobRequest(uint16_t magic,
+        const whMessageCommJobRequest* src,
+        whMessageCommJobRequest* dest);
+
+int wh_MessageComm_TranslateJobResponse(uint16_t magic,
+        const whMessageCommJobResponse* src,
+        whMessageCommJobResponse* dest);
+
+/* Server request statistics.  The server returns up to
+ * WH_MESSAGE_COMM_STATS_MAX_ENTRIES of its total entries, starting at index
+ * start, and clears every entry after building the response if reset is set.
+ * Times are in the units of the server time callback.  hist[i] counts requests
+ * serviced in less than 4^(i+1) units, and the last bin counts the rest */
+#define WH_MESSAGE_COMM_STATS_HIST_BINS 8
+
+typedef struct {
+    uint16_t start;
+    uint8_t reset;
+    uint8_t pad[1];
+} whMessageCommStatsRequest;
+
+typedef struct {
+    uint32_t count;
+    uint32_t bytes_in;
+    uint32_t bytes_out;
+    uint32_t time_min;
+    uint32_t time_max;
+    uint32_t time_mean;
+    uint32_t hist[WH_MESSAGE_COMM_STATS_HIST_BINS];
+    uint16_t kind;          /* WH_MESSAGE_KIND_NONE for untracked kinds */
+    uint8_t pad[2];
+} whMessageCommStatsEntry;
+
+typedef struct {
+    int32_t rc;
+    uint16_t total;         /* Entries available on the server */
+    uint16_t count;         /* Entries following this header */
+} whMessageCommStatsResponse;
+
+#define WH_MESSAGE_COMM_STATS_MAX_ENTRIES                   \
+    ((WH_COMM_DATA_LEN - sizeof(whMessageCommStatsResponse)) / \
+        sizeof(whMessageCommStatsEntry))
+
+int wh_MessageComm_TranslateStatsRequest(uint16_t magic,
+        const whMessageCommStatsRequest* src,
+        whMessageCommStatsRequest* dest);
+
+int wh_MessageComm_TranslateStatsResponse(uint16_t magic,
+        const whMessageCommStatsResponse* src,
+        whMessageCommStatsResponse* dest);
+
+int wh_MessageComm_TranslateStatsEntry(uint16_t magic,
+        const whMessageCommStatsEntry* src,
+        whMessageCommStatsEntry* dest);
+
+/* Persistent DMA mapping of a client buffer.  Until it is unmapped, client
+ * addresses within the buffer resolve without the server DMA callbacks.  The
+ * unmap response returns the handle it was given */
+#define WH_DMA_MAP_READ  0x01   /* Server may read the buffer */
+#define WH_DMA_MAP_WRITE 0x02   /* Server may write the buffer */
+
+typedef struct {
+    uint64_t addr;
+    uint64_t len;
+    uint8_t access;         /* WH_DMA_MAP_* */
+    uint8_t pad[7];
+} whMessageCommDmaMapRequest;
+
+typedef struct {
+    int32_t rc;
+    uint32_t handle;
+} whMessageCommDmaMapResponse;
+
+typedef struct {
+    uint32_t handle;
+} whMessageCommDmaUnmapRequest;
+
+int wh_MessageComm_TranslateDmaMapRequest(uint16_t magic,
+        const whMessageCommDmaMapRequest* src,
+        whMessageCommDmaMapRequest* dest);
+
+int wh_MessageComm_TranslateDmaMapResponse(uint16_t magic,
+        const whMessageCommDmaMapResponse* src,
+        whMessageCommDmaMapResponse* dest);
+
+int wh_MessageComm_TranslateDmaUnmapRequest(uint16_t magic,
+        const whMessageCommDmaUnmapRequest* src,
+        whMessageCommDmaUnmapRequest* dest);
+
 /* Info request/response data */
 enum {
     WOLFHSM_INFO_VERSION_LEN = 8,
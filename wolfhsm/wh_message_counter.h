@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * wolfhsm/wh_message_counter.h
+ *
+ * Monotonic counter messages.  They share WH_MESSAGE_GROUP_KEY with the
+ * keystore, using actions past the WH_KEY_* values
+ */
+
+#ifndef WOLFHSM_WH_MESSAGE_COUNTER_H_
+#define WOLFHSM_WH_MESSAGE_COUNTER_H_
+
+#include <stdint.h>
+#include "wolfhsm/wh_common.h"
+#include "wolfhsm/wh_comm.h"
+#include "wolfhsm/wh_message.h"
+
+enum {
+    WH_MESSAGE_COUNTER_ACTION_READ          = 0x80,
+    WH_MESSAGE_COUNTER_ACTION_INCREMENT     = 0x81,
+};
+
+/** Counter Read and Increment Request */
+typedef struct {
+    uint16_t id;
+    uint8_t padding[6];
+} whMessageCounter_Request;
+
+int wh_MessageCounter_TranslateRequest(uint16_t magic,
+        const whMessageCounter_Request* src,
+        whMessageCounter_Request* dest);
+
+/** Counter Read and Increment Response */
+typedef struct {
+    int32_t rc;
+    uint32_t value;
+} whMessageCounter_Response;
+
+int wh_MessageCounter_TranslateResponse(uint16_t magic,
+        const whMessageCounter_Response* src,
+        whMessageCounter_Response* dest);
+
+#endif /* WOLFHSM_WH_MESSAGE_COUNTER_H_ */
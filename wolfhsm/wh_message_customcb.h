@@ -80,6 +80,29 @@ typedef struct {
 } whMessageCustomCb_Response;
 
 
+/* Message action for raw custom requests. Fixed-format requests use the
+ * callback id as the action, which is below WH_CUSTOM_CB_NUM_CALLBACKS */
+#define WH_MESSAGE_CUSTOM_CB_ACTION_RAW (0xFF)
+
+/* Header of a raw custom request, followed by up to the server's fragment
+ * reassembly size of payload bytes. Padded to the size of the response header
+ * so a payload handled in place starts at the same address in both */
+typedef struct {
+    uint32_t id;   /* identifier of registered raw callback */
+    uint32_t type; /* user-defined, passed through to the callback */
+    uint8_t  padding[8];
+} whMessageCustomCb_RawRequest;
+
+/* Header of a raw custom response, followed by up to
+ * WH_COMM_DATA_LEN - sizeof(whMessageCustomCb_RawResponse) payload bytes */
+typedef struct {
+    uint32_t id;   /* identifier of registered raw callback */
+    uint32_t type; /* type from the request */
+    int32_t  rc;   /* Return code from custom callback. Invalid if err != 0 */
+    int32_t  err;  /* wolfHSM-specific error. If err != 0, rc is invalid */
+} whMessageCustomCb_RawResponse;
+
+
 /* Translates a custom request message. The whMessageCustomCb_Request.data field
  * will not be translated for whMessageCustomCb_Request.type values greater than
  * WH_MESSAGE_CUSTOM_CB_TYPE_USER_DEFINED_START */
@@ -94,4 +117,16 @@ int wh_MessageCustomCb_TranslateResponse(uint16_t magic,
                                          const whMessageCustomCb_Response* src,
                                          whMessageCustomCb_Response*       dst);
 
+/* Translates the header of a raw custom request. The payload is never
+ * translated */
+int wh_MessageCustomCb_TranslateRawRequest(
+    uint16_t magic, const whMessageCustomCb_RawRequest* src,
+    whMessageCustomCb_RawRequest* dst);
+
+/* Translates the header of a raw custom response. The payload is never
+ * translated */
+int wh_MessageCustomCb_TranslateRawResponse(
+    uint16_t magic, const whMessageCustomCb_RawResponse* src,
+    whMessageCustomCb_RawResponse* dst);
+
 #endif /* WH_MESSAGE_CUSTOM_CB_H_*/
\ No newline at end of file
@@ -39,23 +39,44 @@ enum {
     WH_MESSAGE_NVM_ACTION_GETMETADATA       = 0x6,
     WH_MESSAGE_NVM_ACTION_DESTROYOBJECTS    = 0x7,
     WH_MESSAGE_NVM_ACTION_READ              = 0x8,
+    WH_MESSAGE_NVM_ACTION_LISTMETADATA      = 0x9,
+    WH_MESSAGE_NVM_ACTION_READOBJECTS       = 0xA,
+    WH_MESSAGE_NVM_ACTION_ADDOBJECTBEGIN    = 0xB,
+    WH_MESSAGE_NVM_ACTION_ADDOBJECTWRITE    = 0xC,
+    WH_MESSAGE_NVM_ACTION_ADDOBJECTFINISH   = 0xD,
+    WH_MESSAGE_NVM_ACTION_GETSTATS          = 0xE,
     WH_MESSAGE_NVM_ACTION_ADDOBJECTDMA32    = 0x14,
     WH_MESSAGE_NVM_ACTION_READDMA32         = 0x18,
     WH_MESSAGE_NVM_ACTION_ADDOBJECTDMA64    = 0x24,
     WH_MESSAGE_NVM_ACTION_READDMA64         = 0x28,
+    WH_MESSAGE_NVM_ACTION_READOBJECTSDMA    = 0x2A,
+    WH_MESSAGE_NVM_ACTION_ADDOBJECTDMASG    = 0x2B,
+    WH_MESSAGE_NVM_ACTION_READDMASG         = 0x2C,
 };
 
 enum {
     /* must be odd for struct whMessageNvm_DestroyObjectsRequest  alignment */
     WH_MESSAGE_NVM_MAX_DESTROY_OBJECTS_COUNT = 9,
+    /* must be odd for struct whMessageNvm_ReadObjectsRequest alignment */
+    WH_MESSAGE_NVM_MAX_READ_OBJECTS_COUNT = 15,
     WH_MESSAGE_NVM_MAX_ADD_OBJECT_LEN =
             WH_COMM_DATA_LEN - WOLFHSM_NVM_METADATA_LEN,
     WH_MESSAGE_NVM_MAX_READ_LEN = WH_COMM_DATA_LEN - sizeof(int32_t),
+    /* Whole units, since only the last piece of a stream may be partial */
+    WH_MESSAGE_NVM_MAX_ADD_OBJECT_WRITE_LEN =
+            (WH_COMM_DATA_LEN - 2 * sizeof(uint16_t)) & ~7u,
+    /* Client buffers in a scatter-gather DMA request */
+    WH_MESSAGE_NVM_MAX_DMA_SG_COUNT = 16,
+    /* Leading label bytes returned with each ListMetadata record */
+    WH_MESSAGE_NVM_LIST_LABEL_LEN = 8,
 };
 
 /* Simple reusable response message */
+/* Responses that carry epoch report the metadata generation after the
+ * request, see wh_Nvm_GetEpoch */
 typedef struct {
     int32_t rc;
+    uint32_t epoch;
 } whMessageNvm_SimpleResponse;
 
 int wh_MessageNvm_TranslateSimpleResponse(uint16_t magic,
@@ -98,12 +119,34 @@ typedef struct {
     uint32_t reclaim_size;
     uint16_t avail_objects;
     uint16_t reclaim_objects;
+    uint32_t epoch;
 } whMessageNvm_GetAvailableResponse;
 
 int wh_MessageNvm_TranslateGetAvailableResponse(uint16_t magic,
         const whMessageNvm_GetAvailableResponse* src,
         whMessageNvm_GetAvailableResponse* dest);
 
+/** NVM GetStats Request */
+/* Empty message */
+
+/** NVM GetStats Response */
+typedef struct {
+    int32_t rc;
+    uint32_t program_ops;
+    uint32_t erase_ops;
+    uint32_t blank_checks;
+    uint32_t verifies;
+    uint32_t compactions;
+    uint32_t partition_erases[2];
+    uint64_t data_bytes;
+    uint64_t program_bytes;
+    uint64_t erase_bytes;
+} whMessageNvm_GetStatsResponse;
+
+int wh_MessageNvm_TranslateGetStatsResponse(uint16_t magic,
+        const whMessageNvm_GetStatsResponse* src,
+        whMessageNvm_GetStatsResponse* dest);
+
 /** NVM AddObject Request */
 typedef struct {
     uint16_t id;
@@ -121,6 +164,38 @@ int wh_MessageNvm_TranslateAddObjectRequest(uint16_t magic,
 /** NVM AddObject Response */
 /* Use SimpleResponse */
 
+/** NVM AddObjectBegin Request */
+/* Use AddObjectRequest with len as the total object size and no data */
+
+/** NVM AddObjectBegin Response */
+/* Use SimpleResponse */
+
+/** NVM AddObjectWrite Request */
+typedef struct {
+    uint16_t offset;
+    uint16_t data_len;
+    /* Data up to WH_MESSAGE_NVM_MAX_ADD_OBJECT_WRITE_LEN follows */
+} whMessageNvm_AddObjectWriteRequest;
+
+int wh_MessageNvm_TranslateAddObjectWriteRequest(uint16_t magic,
+        const whMessageNvm_AddObjectWriteRequest* src,
+        whMessageNvm_AddObjectWriteRequest* dest);
+
+/** NVM AddObjectWrite Response */
+/* Use SimpleResponse */
+
+/** NVM AddObjectFinish Request */
+typedef struct {
+    uint16_t commit;        /* 0 abandons the object */
+} whMessageNvm_AddObjectFinishRequest;
+
+int wh_MessageNvm_TranslateAddObjectFinishRequest(uint16_t magic,
+        const whMessageNvm_AddObjectFinishRequest* src,
+        whMessageNvm_AddObjectFinishRequest* dest);
+
+/** NVM AddObjectFinish Response */
+/* Use SimpleResponse */
+
 /** NVM List Request */
 typedef struct {
     uint16_t access;
@@ -137,12 +212,58 @@ typedef struct {
     int32_t rc;
     uint16_t count;
     uint16_t id;
+    uint32_t epoch;
 } whMessageNvm_ListResponse;
 
 int wh_MessageNvm_TranslateListResponse(uint16_t magic,
         const whMessageNvm_ListResponse* src,
         whMessageNvm_ListResponse* dest);
 
+/** NVM ListMetadata Request */
+typedef struct {
+    uint32_t cursor;        /* 0 to start, else from the last response */
+    uint16_t access;
+    uint16_t flags;
+    uint16_t max_count;     /* Capped at WH_MESSAGE_NVM_MAX_LIST_RECORDS */
+    uint8_t padding[2];
+} whMessageNvm_ListMetadataRequest;
+
+int wh_MessageNvm_TranslateListMetadataRequest(uint16_t magic,
+        const whMessageNvm_ListMetadataRequest* src,
+        whMessageNvm_ListMetadataRequest* dest);
+
+/** NVM ListMetadata Response */
+typedef struct {
+    int32_t rc;
+    uint32_t cursor;        /* Resumes after the last record */
+    uint16_t count;         /* Fewer than requested when the list is done */
+    uint8_t padding[2];
+    /* count whMessageNvm_ListRecord follow */
+} whMessageNvm_ListMetadataResponse;
+
+int wh_MessageNvm_TranslateListMetadataResponse(uint16_t magic,
+        const whMessageNvm_ListMetadataResponse* src,
+        whMessageNvm_ListMetadataResponse* dest);
+
+/** One object in a ListMetadata Response */
+typedef struct {
+    uint16_t id;
+    uint16_t access;
+    uint16_t flags;
+    uint16_t len;
+    uint8_t label[WH_MESSAGE_NVM_LIST_LABEL_LEN];
+} whMessageNvm_ListRecord;
+
+int wh_MessageNvm_TranslateListRecord(uint16_t magic,
+        const whMessageNvm_ListRecord* src,
+        whMessageNvm_ListRecord* dest);
+
+enum {
+    WH_MESSAGE_NVM_MAX_LIST_RECORDS =
+            (WH_COMM_DATA_LEN - sizeof(whMessageNvm_ListMetadataResponse)) /
+            sizeof(whMessageNvm_ListRecord),
+};
+
 /** NVM GetMetadata Request */
 typedef struct {
     uint16_t id;
@@ -155,6 +276,7 @@ int wh_MessageNvm_TranslateGetMetadataRequest(uint16_t magic,
 /** NVM GetMetadata Response */
 typedef struct {
     int32_t rc;
+    uint32_t epoch;
     uint16_t id;
     uint16_t access;
     uint16_t flags;
@@ -200,6 +322,44 @@ int wh_MessageNvm_TranslateReadResponse(uint16_t magic,
         const whMessageNvm_ReadResponse* src,
         whMessageNvm_ReadResponse* dest);
 
+/** NVM ReadObjects Request */
+typedef struct {
+    uint16_t list[WH_MESSAGE_NVM_MAX_READ_OBJECTS_COUNT];
+    uint16_t list_count;
+} whMessageNvm_ReadObjectsRequest;
+
+int wh_MessageNvm_TranslateReadObjectsRequest(uint16_t magic,
+        const whMessageNvm_ReadObjectsRequest* src,
+        whMessageNvm_ReadObjectsRequest* dest);
+
+/** NVM ReadObjects Response */
+typedef struct {
+    int32_t rc;             /* Result for the object after the last record */
+    uint16_t count;
+    uint8_t padding[2];
+    /* count whMessageNvm_ReadObjectsRecord follow, each trailed by data_len
+     * bytes of data padded to a multiple of 4 */
+} whMessageNvm_ReadObjectsResponse;
+
+int wh_MessageNvm_TranslateReadObjectsResponse(uint16_t magic,
+        const whMessageNvm_ReadObjectsResponse* src,
+        whMessageNvm_ReadObjectsResponse* dest);
+
+/** One object in a ReadObjects Response */
+typedef struct {
+    uint16_t id;
+    uint16_t access;
+    uint16_t flags;
+    uint16_t len;
+    uint16_t data_len;      /* len, or 0 when the data alone does not fit */
+    uint8_t padding[2];
+    uint8_t label[WOLFHSM_NVM_LABEL_LEN];
+} whMessageNvm_ReadObjectsRecord;
+
+int wh_MessageNvm_TranslateReadObjectsRecord(uint16_t magic,
+        const whMessageNvm_ReadObjectsRecord* src,
+        whMessageNvm_ReadObjectsRecord* dest);
+
 /** NVM AddObjectDma32 Request */
 typedef struct {
     uint32_t metadata_hostaddr;
@@ -262,4 +422,68 @@ int wh_MessageNvm_TranslateReadDma64Request(uint16_t magic,
 /** NVM ReadDma64 Response */
 /* Use SimpleResponse */
 
+/** One destination buffer of a ReadObjectsDma Request */
+typedef struct {
+    uint64_t data_hostaddr;
+    uint16_t id;
+    uint16_t data_size;     /* Bytes available at data_hostaddr */
+    uint8_t padding[4];
+} whMessageNvm_ReadObjectsDmaEntry;
+
+/** NVM ReadObjectsDma Request */
+typedef struct {
+    uint64_t metadata_hostaddr;     /* Array of list_count whNvmMetadata */
+    uint16_t list_count;
+    uint8_t padding[6];
+    whMessageNvm_ReadObjectsDmaEntry list[
+            WH_MESSAGE_NVM_MAX_READ_OBJECTS_COUNT];
+} whMessageNvm_ReadObjectsDmaRequest;
+
+int wh_MessageNvm_TranslateReadObjectsDmaRequest(uint16_t magic,
+        const whMessageNvm_ReadObjectsDmaRequest* src,
+        whMessageNvm_ReadObjectsDmaRequest* dest);
+
+/** NVM ReadObjectsDma Response */
+/* Use ReadObjectsResponse without records */
+
+/** One client buffer of a scatter-gather DMA Request */
+typedef struct {
+    uint64_t data_hostaddr;
+    uint32_t data_len;
+    uint8_t padding[4];
+} whMessageNvm_DmaSgEntry;
+
+/** NVM AddObjectDmaSg Request */
+typedef struct {
+    uint64_t metadata_hostaddr;
+    uint16_t sg_count;
+    uint8_t padding[6];
+    /* Object data is the buffers concatenated in order */
+    whMessageNvm_DmaSgEntry sg[WH_MESSAGE_NVM_MAX_DMA_SG_COUNT];
+} whMessageNvm_AddObjectDmaSgRequest;
+
+int wh_MessageNvm_TranslateAddObjectDmaSgRequest(uint16_t magic,
+        const whMessageNvm_AddObjectDmaSgRequest* src,
+        whMessageNvm_AddObjectDmaSgRequest* dest);
+
+/** NVM AddObjectDmaSg Response */
+/* Use SimpleResponse */
+
+/** NVM ReadDmaSg Request */
+typedef struct {
+    uint16_t id;
+    uint16_t offset;
+    uint16_t sg_count;
+    uint8_t padding[2];
+    /* Data from offset is split across the buffers in order */
+    whMessageNvm_DmaSgEntry sg[WH_MESSAGE_NVM_MAX_DMA_SG_COUNT];
+} whMessageNvm_ReadDmaSgRequest;
+
+int wh_MessageNvm_TranslateReadDmaSgRequest(uint16_t magic,
+        const whMessageNvm_ReadDmaSgRequest* src,
+        whMessageNvm_ReadDmaSgRequest* dest);
+
+/** NVM ReadDmaSg Response */
+/* Use SimpleResponse */
+
 #endif /* WOLFHSM_WH_MESSAGE_NVM_H_ */
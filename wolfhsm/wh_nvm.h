@@ -31,6 +31,8 @@
  * NVM objects are added with a fixed length and data.  Removal of objects
  * causes the backend to replicate the entire partition without the
  * listed objects present, which also maximizes the contiguous free space.
+ * Backends may instead record the removal and defer the replication until
+ * enough space is reclaimable, or until wh_Nvm_Compact is called.
  *
  */
 
@@ -65,11 +67,40 @@ typedef struct {
     int (*AddObject)(void* context, whNvmMetadata *meta,
             whNvmSize data_len, const uint8_t* data);
 
+    /* Optional. Add count objects in one pass, each with meta[i].len bytes
+     * from data[i].  Either all fit or none are added.  NULL falls back to
+     * AddObject for each one */
+    int (*AddObjects)(void* context, whNvmId count, whNvmMetadata* meta,
+            const uint8_t* const* data);
+
+    /* Optional. Add an object whose data_len bytes arrive in pieces.  Begin
+     * opens the object, Write stores the next piece at offset, which must
+     * follow the previous one and, except for the last piece, be a multiple
+     * of 8 bytes long.  Finish with commit makes the object visible once all
+     * of the data was written, without commit it is dropped.  The previous
+     * version stays readable until then.  Only one object may be open and
+     * other changes return WH_ERROR_NOTREADY meanwhile.  NULL means objects
+     * must be added whole */
+    int (*AddObjectBegin)(void* context, whNvmMetadata *meta,
+            whNvmSize data_len);
+    int (*AddObjectWrite)(void* context, whNvmSize offset,
+            whNvmSize data_len, const uint8_t* data);
+    int (*AddObjectFinish)(void* context, int commit);
+
     /* Retrieve the next matching id starting at start_id. Sets out_count to the
      * total number of id's that match access and flags. */
     int (*List)(void* context, whNvmAccess access, whNvmFlags flags,
         whNvmId start_id, whNvmId *out_count, whNvmId *out_id);
 
+    /* Optional. Retrieve the metadata of up to max_count objects that match
+     * access and flags, resuming from *inout_cursor (0 to start) and updating
+     * it to continue after the last one returned.  The enumeration is done
+     * once fewer than max_count are returned.  NULL falls back to List and
+     * GetMetadata for each object */
+    int (*ListMetadata)(void* context, whNvmAccess access, whNvmFlags flags,
+        uint32_t *inout_cursor, whNvmId max_count, whNvmId *out_count,
+        whNvmMetadata* out_meta);
+
     /* Retrieve object metadata using the id */
     int (*GetMetadata)(void* context, whNvmId id,
             whNvmMetadata* meta);
@@ -80,21 +111,58 @@ typedef struct {
      * switch the active partition, and erase the old active (now inactive)
      * partition.  Interruption prior completing the write of the new partition will
      * recover as before the replication.  Interruption after the new partition is
-     * fully populated will recover as after, including restarting erasure. */
+     * fully populated will recover as after, including restarting erasure.
+     * A backend may instead atomically mark each listed object destroyed and
+     * replicate later.  An empty list always replicates. */
     int (*DestroyObjects)(void* context, whNvmId list_count,
             const whNvmId* id_list);
 
+    /* Optional. Regenerate the partition without any reclaimable objects.
+     * Backends that defer reclamation on destroy compact on their own once a
+     * threshold is reached, this lets the caller do it at a quiet time.  NULL
+     * falls back to DestroyObjects with an empty list */
+    int (*Compact)(void* context);
+
+    /* Optional. Advance a pending background compaction by a bounded amount
+     * of work.  Returns WH_ERROR_NOTREADY while more remains and 0 when there
+     * is nothing left to do.  NULL means compaction is never deferred */
+    int (*CompactStep)(void* context);
+
     /* Read the data of the object starting at the byte offset */
     int (*Read)(void* context, whNvmId id, whNvmSize offset,
             whNvmSize data_len, uint8_t* data);
+
+    /* Optional. Point *out_data at the object data in memory mapped storage
+     * instead of copying it.  The data stays readable in place until the next
+     * call that modifies the NVM.  Returns WH_ERROR_NOTIMPL when the storage
+     * is not addressable, NULL means it never is */
+    int (*ReadPointer)(void* context, whNvmId id, whNvmSize offset,
+            whNvmSize data_len, const uint8_t** out_data);
+
+    /* Optional. Copy the wear counters into *out_stats.  Returns
+     * WH_ERROR_NOTIMPL when the backend was built without them, NULL means it
+     * never tracks them */
+    int (*GetStats)(void* context, whNvmStats* out_stats);
 } whNvmCb;
 
 
+/* Optional lock that serializes every NVM call when the context is shared by
+ * several server workers.  Return 0 on success */
+typedef struct {
+    int (*Lock)(void* context);
+    int (*Unlock)(void* context);
+} whNvmLockCb;
+
+
 /** NVM Context helper structs and functions */
 /* Simple helper context structure associated with an NVM instance */
 typedef struct whNvmContext_t {
     whNvmCb *cb;
     void* context;
+    const whNvmLockCb* lock_cb;
+    void* lock_context;
+    uint32_t epoch;     /* Bumped by every call that may change metadata */
+    uint8_t padding[4];
 } whNvmContext;
 
 /* Simple helper configuration structure associated with an NVM instance */
@@ -102,6 +170,8 @@ typedef struct whNvmConfig_t {
     whNvmCb *cb;
     void* context;
     void* config;
+    const whNvmLockCb* lock_cb;     /* Optional. NULL for single owner */
+    void* lock_context;
 } whNvmConfig;
 
 
@@ -115,17 +185,49 @@ int wh_Nvm_GetAvailable(whNvmContext* context,
 int wh_Nvm_AddObject(whNvmContext* context, whNvmMetadata *meta,
         whNvmSize data_len, const uint8_t* data);
 
+int wh_Nvm_AddObjects(whNvmContext* context, whNvmId count,
+        whNvmMetadata* meta, const uint8_t* const* data);
+
+/* Streamed AddObject.  Return WH_ERROR_NOTIMPL when the back end cannot */
+int wh_Nvm_AddObjectBegin(whNvmContext* context, whNvmMetadata *meta,
+        whNvmSize data_len);
+int wh_Nvm_AddObjectWrite(whNvmContext* context, whNvmSize offset,
+        whNvmSize data_len, const uint8_t* data);
+int wh_Nvm_AddObjectFinish(whNvmContext* context, int commit);
+
 int wh_Nvm_List(whNvmContext* context,
         whNvmAccess access, whNvmFlags flags, whNvmId start_id,
         whNvmId *out_count, whNvmId *out_id);
 
+int wh_Nvm_ListMetadata(whNvmContext* context,
+        whNvmAccess access, whNvmFlags flags, uint32_t *inout_cursor,
+        whNvmId max_count, whNvmId *out_count, whNvmMetadata* out_meta);
+
 int wh_Nvm_GetMetadata(whNvmContext* context, whNvmId id,
         whNvmMetadata* meta);
 
 int wh_Nvm_DestroyObjects(whNvmContext* context, whNvmId list_count,
         const whNvmId* id_list);
 
+int wh_Nvm_Compact(whNvmContext* context);
+
+int wh_Nvm_CompactStep(whNvmContext* context);
+
 int wh_Nvm_Read(whNvmContext* context, whNvmId id, whNvmSize offset,
         whNvmSize data_len, uint8_t* data);
 
+/* Direct pointer to the object data, or WH_ERROR_NOTIMPL to fall back to
+ * wh_Nvm_Read.  A shared context must be kept from other workers, for example
+ * by the caller's own serialization, while the pointer is used */
+int wh_Nvm_ReadPointer(whNvmContext* context, whNvmId id, whNvmSize offset,
+        whNvmSize data_len, const uint8_t** out_data);
+
+/* Generation of the object metadata.  Changes whenever an object may have
+ * been added or destroyed, so metadata cached at one epoch is still valid
+ * while the epoch is unchanged */
+int wh_Nvm_GetEpoch(whNvmContext* context, uint32_t* out_epoch);
+
+/* Wear counters of the backend, or WH_ERROR_NOTIMPL when it has none */
+int wh_Nvm_GetStats(whNvmContext* context, whNvmStats* out_stats);
+
 #endif /* WOLFHSM_WH_NVM_H_ */
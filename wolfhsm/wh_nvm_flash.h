@@ -35,6 +35,55 @@
 /* Number of objects in a directory */
 #define NF_OBJECT_COUNT (WOLFHSM_NUM_NVMOBJECTS)
 
+/* Number of slots in the id to object index hash.  Twice the object count
+ * keeps the probe sequences short and guarantees a free slot */
+#define NF_INDEX_COUNT (2 * NF_OBJECT_COUNT)
+
+/* Object epoch bit marking a tombstone: a data-less copy of a destroyed
+ * object's metadata that hides every older object with the same id */
+#define NF_EPOCH_TOMBSTONE (0x80000000ul)
+
+/* Object epoch bit marking a checkpoint: an entry with id WH_NVM_INVALID_ID
+ * that compaction writes first, whose metadata len counts the entries copied
+ * in after it.  Mount reads those in bulk and only scans what follows */
+#define NF_EPOCH_CHECKPOINT (0x40000000ul)
+#define NF_EPOCH_FLAGS (NF_EPOCH_TOMBSTONE | NF_EPOCH_CHECKPOINT)
+
+/* Objects decoded per read when loading checkpointed entries */
+#ifndef NF_SUMMARY_READ_OBJECTS
+#define NF_SUMMARY_READ_OBJECTS 8
+#endif
+
+/* Default compaction thresholds, used when the config leaves them 0.
+ * Destroyed objects only leave a tombstone until either is reached */
+#define NF_COMPACT_DEFAULT_OBJECTS (NF_OBJECT_COUNT / 2)
+#define NF_COMPACT_DEFAULT_DIVISOR 2    /* Half of the partition */
+
+/* Most objects copied by one background compaction step */
+#ifndef NF_COMPACT_STEP_OBJECTS
+#define NF_COMPACT_STEP_OBJECTS 4
+#endif
+
+/* Objects whose data wh_NvmFlash_Read keeps in RAM, evicting the least
+ * recently read.  Only objects of at most NF_DATA_CACHE_BYTES, a multiple of
+ * 8, are cached.  Flash with a Map callback is read in place instead.  0
+ * disables the cache */
+#ifndef NF_DATA_CACHE_COUNT
+#define NF_DATA_CACHE_COUNT 4
+#endif
+#ifndef NF_DATA_CACHE_BYTES
+#define NF_DATA_CACHE_BYTES 64
+#endif
+
+/* Background compaction progress */
+typedef enum {
+    NF_COMPACT_IDLE     = 0,    /* Nothing pending */
+    NF_COMPACT_ERASE    = 1,    /* Erase and start the inactive partition */
+    NF_COMPACT_COPY     = 2,    /* Copy used objects a few at a time */
+    NF_COMPACT_COMMIT   = 3,    /* Program the count and switch partitions */
+    NF_COMPACT_RETIRE   = 4,    /* Erase the old partition */
+} nfCompactStep;
+
 /* In-memory computed status of an Object or Directory */
 typedef enum {
     NF_STATUS_UNKNOWN    = 0,    /* State is unknown/not read yet */
@@ -52,27 +101,55 @@ typedef struct {
     uint32_t count;
 } nfMemState;
 
-/* In-memory version of an Object */
+/* In-memory hot fields of an Object, walked by lookups, listing and data
+ * placement.  id mirrors the id in the object's metadata */
 typedef struct {
     nfMemState state;
-    whNvmMetadata metadata;
-} nfMemObject;
+    whNvmId id;
+    uint8_t padding[2];
+} nfMemEntry;
 
-/* In-memory version of a Directory */
+/* In-memory version of a Directory.  Entry n is entries[n] with its metadata
+ * in metadata[n], so scans stay in the dense entries and only a match pulls
+ * in the labels */
 typedef struct {
-    nfMemObject objects[NF_OBJECT_COUNT];
+    nfMemEntry entries[NF_OBJECT_COUNT];
+    whNvmMetadata metadata[NF_OBJECT_COUNT];
     int next_free_object;
     uint32_t next_free_data;
     int reclaimable_entries;
     uint32_t reclaimable_data;
+    /* Open addressed id hash holding object index + 1, 0 when empty.  Each id
+     * keeps a single slot that is repointed when the object is replaced */
+    uint16_t index[NF_INDEX_COUNT];
 } nfMemDirectory;
 
+#if NF_DATA_CACHE_COUNT > 0
+/* RAM copy of a whole object's data */
+typedef struct {
+    uint8_t data[NF_DATA_CACHE_BYTES];
+    uint32_t used;              /* Read tick of the last hit, 0 when empty */
+    whNvmId id;                 /* WH_NVM_INVALID_ID when empty */
+    uint8_t padding[2];
+} nfDataCacheEntry;
+#endif
+
 /** whNvm config and context structure definitions */
 /* In memory configuration structure associated with an NVM instance */
 typedef struct whNvmFlashConfig_t {
     const whFlashCb* cb;    /* whFlash callback */
     void* context;          /* whFlash context to be passed to cb */
     const void* config;     /* Config to be passed to cb->Init */
+    uint32_t compact_units;     /* Reclaimable data units that trigger a
+                                 * compaction.  0 for half the partition */
+    whNvmId compact_objects;    /* Reclaimable entries that trigger a
+                                 * compaction.  0 for half the directory */
+    uint8_t checkpoint;         /* Nonzero to write a mount checkpoint at
+                                 * each compaction, using one entry */
+    uint8_t verify;             /* whFlashUnitVerify policy for programs */
+    uint32_t program_page;      /* Device program page in bytes that writes
+                                 * are combined up to.  0 for no limit */
+    uint8_t padding[4];
 } whNvmFlashConfig;
 
 typedef struct whNvmFlashContext_t {
@@ -83,7 +160,35 @@ typedef struct whNvmFlashContext_t {
     uint32_t partition_units;       /* Size of partition in units */
     int active;                     /* Which partition (0 or 1) is active */
     int initialized;
-    uint8_t padding[4];
+    uint32_t compact_units;         /* Reclaimable units before compaction */
+    uint32_t compact_objects;       /* Reclaimable entries before compaction */
+    nfCompactStep compact_step;     /* Background compaction progress */
+    int compact_entry;              /* Next source object to copy */
+    uint32_t compact_object;        /* Next destination object */
+    uint32_t compact_data;          /* Next destination data unit */
+    uint8_t checkpoint;             /* Write a checkpoint when compacting */
+    uint8_t erasing;                /* Compaction erase still outstanding */
+    uint8_t streaming;              /* An AddObjectBegin is still open */
+    uint8_t compact_reserved;       /* First destination entry is kept for
+                                     * the checkpoint */
+    uint32_t stream_epoch;          /* Epoch of the object being streamed */
+    uint32_t stream_written;        /* Bytes of it written so far */
+    whNvmMetadata stream_meta;
+    whFlashUnitWriter writer;       /* Combines programs of one sequence */
+#if NF_DATA_CACHE_COUNT > 0
+    nfDataCacheEntry cache[NF_DATA_CACHE_COUNT];
+    uint32_t cache_tick;            /* Last read tick handed out */
+    uint8_t cache_padding[4];
+#endif
+#ifdef WOLFHSM_NVM_STATS
+    /* Wear counters for wh_NvmFlash_GetStats.  Define WOLFHSM_NVM_STATS to
+     * enable */
+    whFlashUnitStats stats;         /* Flash operations, programs by writer */
+    uint64_t data_bytes;            /* Object data bytes added */
+    uint32_t compactions;           /* Partition switches */
+    uint32_t partition_erases[2];
+    uint8_t stats_padding[4];
+#endif
 } whNvmFlashContext;
 
 /** whNvm Interface */
@@ -92,27 +197,52 @@ int wh_NvmFlash_Cleanup(void* c);
 int wh_NvmFlash_List(void* c,
         whNvmAccess access, whNvmFlags flags, whNvmId start_id,
         whNvmId *out_avail_objects, whNvmId *out_id);
+int wh_NvmFlash_ListMetadata(void* c,
+        whNvmAccess access, whNvmFlags flags, uint32_t *inout_cursor,
+        whNvmId max_count, whNvmId *out_count, whNvmMetadata* out_meta);
 int wh_NvmFlash_GetAvailable(void* c,
         uint32_t *out_avail_size, whNvmId *out_avail_objects,
         uint32_t *out_reclaim_size, whNvmId *out_reclaim_objects);
 int wh_NvmFlash_GetMetadata(void* c, whNvmId id, whNvmMetadata* meta);
 int wh_NvmFlash_AddObject(void* c, whNvmMetadata* meta,
         whNvmSize data_len, const uint8_t* data);
+int wh_NvmFlash_AddObjects(void* c, whNvmId count, whNvmMetadata* meta,
+        const uint8_t* const* data);
 int wh_NvmFlash_DestroyObjects(void* c, whNvmId list_count,
         const whNvmId* id_list);
+int wh_NvmFlash_Compact(void* c);
+int wh_NvmFlash_CompactStep(void* c);
+int wh_NvmFlash_AddObjectBegin(void* c, whNvmMetadata* meta,
+        whNvmSize data_len);
+int wh_NvmFlash_AddObjectWrite(void* c, whNvmSize offset,
+        whNvmSize data_len, const uint8_t* data);
+int wh_NvmFlash_AddObjectFinish(void* c, int commit);
 int wh_NvmFlash_Read(void* c, whNvmId id, whNvmSize offset,
         whNvmSize data_len, uint8_t* data);
+int wh_NvmFlash_ReadPointer(void* c, whNvmId id, whNvmSize offset,
+        whNvmSize data_len, const uint8_t** out_data);
+/* Returns WH_ERROR_NOTIMPL unless built with WOLFHSM_NVM_STATS */
+int wh_NvmFlash_GetStats(void* c, whNvmStats* out_stats);
 
 #define WH_NVM_FLASH_CB                             \
 {                                                   \
     .Init = wh_NvmFlash_Init,                       \
     .Cleanup = wh_NvmFlash_Cleanup,                 \
     .List = wh_NvmFlash_List,                       \
+    .ListMetadata = wh_NvmFlash_ListMetadata,       \
     .GetAvailable = wh_NvmFlash_GetAvailable,       \
     .GetMetadata = wh_NvmFlash_GetMetadata,         \
     .AddObject = wh_NvmFlash_AddObject,             \
+    .AddObjects = wh_NvmFlash_AddObjects,           \
     .DestroyObjects = wh_NvmFlash_DestroyObjects,   \
+    .Compact = wh_NvmFlash_Compact,                 \
+    .CompactStep = wh_NvmFlash_CompactStep,         \
+    .AddObjectBegin = wh_NvmFlash_AddObjectBegin,   \
+    .AddObjectWrite = wh_NvmFlash_AddObjectWrite,   \
+    .AddObjectFinish = wh_NvmFlash_AddObjectFinish, \
     .Read = wh_NvmFlash_Read,                       \
+    .ReadPointer = wh_NvmFlash_ReadPointer,         \
+    .GetStats = wh_NvmFlash_GetStats,               \
 }
 
 #endif /* WOLFHSM_WH_NVMFLASH_H_ */
@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * wolfhsm/wh_nvm_flashlog.h
+ *
+ * Concrete library to implement an NVM data store as a log of flash sectors.
+ *
+ * Instead of two ping-pong partitions, the flash is split into sector_count
+ * erase sectors that are appended to in turn.  Each sector starts with a
+ * header unit holding its erase count, then a sequence unit programmed when
+ * the sector joins the log.  Records follow back to back:
+ *
+ *   head:      epoch, data length and flags    (programmed first)
+ *   metadata:  whNvmMetadata
+ *   data:      data length bytes, rounded up to units
+ *   commit:    the epoch again                 (programmed last)
+ *
+ * A record only exists once its commit is programmed.  The highest epoch of an
+ * id wins and later records win ties, so a record copied forward replaces the
+ * original.  Destroying an object appends a data-less tombstone.
+ *
+ * When space runs out the closed sector with the most garbage is reclaimed:
+ * its current records are appended to the log and the sector is erased, so a
+ * compaction costs one sector rather than the whole store.  One erased sector
+ * is always kept spare so a reclaim can complete, and free sectors are used in
+ * order of lowest erase count.
+ *
+ * Example usage:
+ *
+ * whNvmFlashLogConfig nflcfg[1] = {{
+ *      .cb = myFlashCb,
+ *      .context = myFlashContext,
+ *      .config = myFlashConfig,
+ *      .sector_size = 4096,
+ *      .sector_count = 8,
+ * }};
+ * whNvmFlashLogContext nflc[1] = {0};
+ * whNvmCb nflcb[1] = {WH_NVM_FLASHLOG_CB};
+ */
+
+#ifndef WOLFHSM_WH_NVM_FLASHLOG_H_
+#define WOLFHSM_WH_NVM_FLASHLOG_H_
+
+#include <stdint.h>
+
+#include "wolfhsm/wh_common.h"
+#include "wolfhsm/wh_flash.h"
+
+/* Most sectors a log may span */
+#ifndef NFL_MAX_SECTORS
+#define NFL_MAX_SECTORS 16
+#endif
+
+/* Directory entries.  Live objects are limited to WOLFHSM_NUM_NVMOBJECTS, the
+ * rest hold tombstones until the records they hide are reclaimed */
+#define NFL_ENTRY_COUNT (2 * WOLFHSM_NUM_NVMOBJECTS)
+
+/* In-memory state of a sector */
+typedef struct {
+    uint32_t seq;           /* Position in the log, 0 when free */
+    uint32_t erase_count;
+    uint32_t next_unit;     /* First unit not yet programmed */
+    uint32_t garbage;       /* Units of superseded or uncommitted records */
+} nflSector;
+
+/* In-memory state of the current record of an id */
+typedef struct {
+    whNvmMetadata metadata;
+    uint32_t epoch;
+    uint32_t unit;          /* Unit of the record head within its sector */
+    uint16_t sector;
+    uint16_t stale;         /* Older records of this id still in flash */
+    uint8_t status;         /* NFL_ENTRY_* */
+    uint8_t padding[3];
+} nflEntry;
+
+#define NFL_ENTRY_FREE 0
+#define NFL_ENTRY_LIVE 1
+#define NFL_ENTRY_TOMB 2
+
+/** whNvm config and context structure definitions */
+typedef struct whNvmFlashLogConfig_t {
+    const whFlashCb* cb;    /* whFlash callback */
+    void* context;          /* whFlash context to be passed to cb */
+    const void* config;     /* Config to be passed to cb->Init */
+    uint32_t sector_size;   /* Erase sector in bytes.  0 for PartitionSize */
+    uint16_t sector_count;  /* Sectors used, 3 to NFL_MAX_SECTORS */
+    uint8_t padding[2];
+} whNvmFlashLogConfig;
+
+typedef struct whNvmFlashLogContext_t {
+    const whFlashCb* cb;            /* Flash callbacks */
+    void* flash;                    /* Flash context to use */
+    uint32_t sector_units;          /* Size of a sector in units */
+    uint16_t sector_count;
+    uint16_t head;                  /* Sector being appended to */
+    uint32_t seq;                   /* Highest sequence handed out */
+    int initialized;
+    nflSector sectors[NFL_MAX_SECTORS];
+    nflEntry entries[NFL_ENTRY_COUNT];
+} whNvmFlashLogContext;
+
+/** whNvm Interface */
+int wh_NvmFlashLog_Init(void* c, const void* cf);
+int wh_NvmFlashLog_Cleanup(void* c);
+int wh_NvmFlashLog_List(void* c,
+        whNvmAccess access, whNvmFlags flags, whNvmId start_id,
+        whNvmId *out_count, whNvmId *out_id);
+int wh_NvmFlashLog_GetAvailable(void* c,
+        uint32_t *out_avail_size, whNvmId *out_avail_objects,
+        uint32_t *out_reclaim_size, whNvmId *out_reclaim_objects);
+int wh_NvmFlashLog_GetMetadata(void* c, whNvmId id, whNvmMetadata* meta);
+int wh_NvmFlashLog_AddObject(void* c, whNvmMetadata* meta,
+        whNvmSize data_len, const uint8_t* data);
+int wh_NvmFlashLog_DestroyObjects(void* c, whNvmId list_count,
+        const whNvmId* id_list);
+int wh_NvmFlashLog_Compact(void* c);
+int wh_NvmFlashLog_Read(void* c, whNvmId id, whNvmSize offset,
+        whNvmSize data_len, uint8_t* data);
+
+#define WH_NVM_FLASHLOG_CB                              \
+{                                                       \
+    .Init = wh_NvmFlashLog_Init,                        \
+    .Cleanup = wh_NvmFlashLog_Cleanup,                  \
+    .List = wh_NvmFlashLog_List,                        \
+    .GetAvailable = wh_NvmFlashLog_GetAvailable,        \
+    .GetMetadata = wh_NvmFlashLog_GetMetadata,          \
+    .AddObject = wh_NvmFlashLog_AddObject,              \
+    .DestroyObjects = wh_NvmFlashLog_DestroyObjects,    \
+    .Compact = wh_NvmFlashLog_Compact,                  \
+    .Read = wh_NvmFlashLog_Read,                        \
+}
+
+#endif /* WOLFHSM_WH_NVM_FLASHLOG_H_ */
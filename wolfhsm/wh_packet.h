@@ -21,6 +21,7 @@
 #ifndef WOLFHSM_PACKET_H
 #define WOLFHSM_PACKET_H
 #include "wolfhsm/wh_common.h"
+#include "wolfhsm/wh_comm.h"
 
 #if (defined(__IAR_SYSTEMS_ICC__) && (__IAR_SYSTEMS_ICC__ > 8)) || \
                                                     defined(__GNUC__)
@@ -35,6 +36,17 @@
 
 #define WOLFHSM_PACKET_STUB_SIZE 6
 
+/* Packet header flags */
+/* Request: the server may accept the request as a job.
+ * Response: the request was accepted as the job in jobRes, whose result is
+ * polled with the COMM JOB action */
+#define WOLFHSM_PACKET_FLAG_JOB 0x0001
+
+typedef struct WOLFHSM_PACK wh_Packet_job_res
+{
+    uint32_t jobId;
+} wh_Packet_job_res;
+
 typedef struct WOLFHSM_PACK wh_Packet_cipher_any_req
 {
     uint32_t type;
@@ -76,6 +88,117 @@ typedef struct WOLFHSM_PACK wh_Packet_cipher_aesgcm_res
     /* uint8_t authTag[authTagSz] */
 } wh_Packet_cipher_aesgcm_res;
 
+/* One-shot AES on client memory.  The server reads in and writes out
+ * through DMA, the small fields travel inline */
+typedef struct WOLFHSM_PACK wh_Packet_cipher_dma_req
+{
+    uint64_t in;
+    uint64_t out;
+    uint64_t sz;
+    uint32_t type;      /* WC_CIPHER_AES_CBC or WC_CIPHER_AES_GCM */
+    uint32_t enc;
+    uint32_t keyLen;
+    uint32_t ivSz;
+    uint32_t authInSz;
+    uint32_t authTagSz;
+    /* key[keyLen] | iv[ivSz] | authIn[authInSz] |
+     * authTag[authTagSz] when decrypting */
+} wh_Packet_cipher_dma_req;
+
+typedef struct WOLFHSM_PACK wh_Packet_cipher_dma_res
+{
+    uint32_t sz;
+    uint32_t authTagSz;
+    /* uint8_t authTag[authTagSz] when encrypting */
+} wh_Packet_cipher_dma_res;
+
+/* Streaming cipher session operations */
+enum {
+    WH_CIPHER_SESSION_INIT = 0,
+    WH_CIPHER_SESSION_UPDATE = 1,
+    WH_CIPHER_SESSION_FINAL = 2,
+};
+
+typedef struct WOLFHSM_PACK wh_Packet_cipher_session_req
+{
+    uint32_t op;        /* WH_CIPHER_SESSION_* */
+    uint32_t type;      /* WC_CIPHER_AES_CBC or WC_CIPHER_AES_GCM */
+    uint32_t enc;
+    uint32_t keyId;
+    uint32_t session;
+    uint32_t sz;
+    uint32_t ivSz;
+    uint32_t authInSz;
+    uint32_t authTagSz;
+    /* init: iv[ivSz] | authIn[authInSz]
+     * update: in[sz]
+     * final: authTag[authTagSz] when decrypting */
+} wh_Packet_cipher_session_req;
+
+/* Largest whole number of AES blocks an update request can carry */
+#define WOLFHSM_PACKET_CIPHER_SESSION_MAX_SZ                            \
+    ((WH_COMM_DATA_LEN - WOLFHSM_PACKET_STUB_SIZE -                     \
+        sizeof(wh_Packet_cipher_session_req)) & ~(16 - 1))
+
+typedef struct WOLFHSM_PACK wh_Packet_cipher_session_res
+{
+    uint32_t session;
+    uint32_t sz;
+    uint32_t authTagSz;
+    /* update: out[sz]
+     * final: authTag[authTagSz] when encrypting */
+} wh_Packet_cipher_session_res;
+
+/* Streaming hash and MAC session operations */
+enum {
+    WH_HASH_SESSION_INIT = 0,
+    WH_HASH_SESSION_UPDATE = 1,
+    WH_HASH_SESSION_UPDATE_DMA = 2,
+    WH_HASH_SESSION_FINAL = 3,
+};
+
+typedef struct WOLFHSM_PACK wh_Packet_hash_session_req
+{
+    uint64_t in;        /* update dma: client address of the input */
+    uint32_t op;        /* WH_HASH_SESSION_* */
+    uint32_t type;      /* WH_HASH_SESSION_SHA256 etc */
+    uint32_t keyId;     /* init of HMAC and CMAC sessions */
+    uint32_t session;
+    uint32_t sz;
+    /* update: in[sz] */
+} wh_Packet_hash_session_req;
+
+/* Most input an update request can carry */
+#define WOLFHSM_PACKET_HASH_SESSION_MAX_SZ                              \
+    (WH_COMM_DATA_LEN - WOLFHSM_PACKET_STUB_SIZE -                      \
+        sizeof(wh_Packet_hash_session_req))
+
+typedef struct WOLFHSM_PACK wh_Packet_hash_session_res
+{
+    uint32_t session;
+    uint32_t sz;
+    /* final: digest[sz] */
+} wh_Packet_hash_session_res;
+
+/* Verify a signed image in client memory.  The server reads the image through
+ * DMA, hashes it and checks sig with the cached public key keyId */
+typedef struct WOLFHSM_PACK wh_Packet_image_verify_req
+{
+    uint64_t addr;      /* client address of the image */
+    uint64_t sz;
+    uint32_t keyId;
+    uint32_t hashType;  /* WH_HASH_SESSION_SHA256 or WH_HASH_SESSION_SHA384 */
+    uint32_t sigType;   /* WH_IMAGE_SIG_* */
+    uint32_t curveId;   /* ECC only */
+    uint32_t sigSz;
+    /* sig[sigSz] */
+} wh_Packet_image_verify_req;
+
+typedef struct WOLFHSM_PACK wh_Packet_image_verify_res
+{
+    uint32_t res;       /* 1 when the signature matches the image */
+} wh_Packet_image_verify_res;
+
 typedef struct WOLFHSM_PACK wh_Packet_pk_any_req
 {
     uint32_t type;
@@ -177,6 +300,31 @@ typedef struct WOLFHSM_PACK wh_Packet_pk_ecc_verify_res
     uint32_t res;
 } wh_Packet_pk_ecc_verify_res;
 
+/* One bit of the batch result per entry */
+#define WOLFHSM_PACKET_ECC_VERIFY_BATCH_MAX 32
+
+typedef struct WOLFHSM_PACK wh_Packet_pk_ecc_verify_batch_req
+{
+    uint32_t curveId;
+    uint32_t count;
+    /* wh_Packet_pk_ecc_verify_batch_entry entries[] */
+} wh_Packet_pk_ecc_verify_batch_req;
+
+typedef struct WOLFHSM_PACK wh_Packet_pk_ecc_verify_batch_entry
+{
+    uint32_t keyId;
+    uint16_t sigSz;
+    uint16_t hashSz;
+    /* uint8_t sig[] */
+    /* uint8_t hash[] */
+} wh_Packet_pk_ecc_verify_batch_entry;
+
+typedef struct WOLFHSM_PACK wh_Packet_pk_ecc_verify_batch_res
+{
+    uint32_t count;
+    uint32_t res;   /* bit i set when entry i verified */
+} wh_Packet_pk_ecc_verify_batch_res;
+
 typedef struct WOLFHSM_PACK wh_Packet_pk_ecc_check_req
 {
     uint32_t type;
@@ -225,6 +373,10 @@ typedef struct WOLFHSM_PACK wh_Packet_rng_res
     /* uint8_t out[]; */
 } wh_Packet_rng_res;
 
+/* Most random bytes one response can carry, larger requests are truncated */
+#define WOLFHSM_PACKET_RNG_MAX_SZ                                       \
+    (WH_COMM_DATA_LEN - WOLFHSM_PACKET_STUB_SIZE - sizeof(wh_Packet_rng_res))
+
 typedef struct WOLFHSM_PACK wh_Packet_cmac_req
 {
     uint8_t opType;
@@ -279,6 +431,20 @@ typedef struct WOLFHSM_PACK wh_Packet_key_commit_res
     uint32_t ok;
 } wh_Packet_key_commit_res;
 
+/* Max key ids in one WH_KEY_COMMIT_MANY request */
+#define WOLFHSM_PACKET_KEY_COMMIT_MANY_MAX 32
+
+typedef struct WOLFHSM_PACK wh_Packet_key_commit_many_req
+{
+    uint32_t count;
+    uint16_t ids[WOLFHSM_PACKET_KEY_COMMIT_MANY_MAX];
+} wh_Packet_key_commit_many_req;
+
+typedef struct WOLFHSM_PACK wh_Packet_key_commit_many_res
+{
+    uint32_t count;
+} wh_Packet_key_commit_many_res;
+
 typedef struct WOLFHSM_PACK wh_Packet_key_export_req
 {
     uint32_t id;
@@ -333,6 +499,19 @@ typedef struct WOLFHSM_PACK wh_Packet_she_secure_boot_update_res
     uint32_t status;
 } wh_Packet_she_secure_boot_update_res;
 
+/* Init, update and finish in one request over the whole image, which the
+ * server reads from client memory */
+typedef struct WOLFHSM_PACK wh_Packet_she_secure_boot_dma_req
+{
+    uint64_t addr;
+    uint32_t sz;
+} wh_Packet_she_secure_boot_dma_req;
+
+typedef struct WOLFHSM_PACK wh_Packet_she_secure_boot_dma_res
+{
+    uint32_t status;
+} wh_Packet_she_secure_boot_dma_res;
+
 /* no req body for a finish request */
 typedef struct WOLFHSM_PACK wh_Packet_she_secure_boot_finish_res
 {
@@ -358,6 +537,21 @@ typedef struct WOLFHSM_PACK wh_Packet_she_load_key_res
     uint8_t messageFive[WOLFHSM_SHE_M5_SZ];
 } wh_Packet_she_load_key_res;
 
+/* the most M1-M3 tuples accepted by one batched load key */
+#define WOLFHSM_PACKET_SHE_LOAD_KEY_BATCH_MAX 16
+
+typedef struct WOLFHSM_PACK wh_Packet_she_load_key_batch_req
+{
+    uint32_t count;
+    /* wh_Packet_she_load_key_req keys[count] */
+} wh_Packet_she_load_key_batch_req;
+
+typedef struct WOLFHSM_PACK wh_Packet_she_load_key_batch_res
+{
+    uint32_t count;
+    /* wh_Packet_she_load_key_res keys[count] */
+} wh_Packet_she_load_key_batch_res;
+
 typedef struct WOLFHSM_PACK wh_Packet_she_load_plain_key_req
 {
     uint8_t key[WOLFHSM_SHE_KEY_SZ];
@@ -382,6 +576,35 @@ typedef struct WOLFHSM_PACK wh_Packet_she_rnd_res
     uint8_t rnd[WOLFHSM_SHE_KEY_SZ];
 } wh_Packet_she_rnd_res;
 
+/* Many RND blocks in one request, sz a multiple of WOLFHSM_SHE_KEY_SZ */
+typedef struct WOLFHSM_PACK wh_Packet_she_rnd_bulk_req
+{
+    uint32_t sz;
+} wh_Packet_she_rnd_bulk_req;
+
+typedef struct WOLFHSM_PACK wh_Packet_she_rnd_bulk_res
+{
+    uint32_t sz;
+    /* uint8_t rnd[sz] */
+} wh_Packet_she_rnd_bulk_res;
+
+/* Largest whole number of blocks a bulk response can carry */
+#define WOLFHSM_PACKET_SHE_RND_BULK_MAX_SZ                              \
+    ((WH_COMM_DATA_LEN - WOLFHSM_PACKET_STUB_SIZE -                     \
+        sizeof(wh_Packet_she_rnd_bulk_res)) & ~(WOLFHSM_SHE_KEY_SZ - 1))
+
+/* RND blocks written straight to client memory */
+typedef struct WOLFHSM_PACK wh_Packet_she_rnd_dma_req
+{
+    uint64_t addr;
+    uint32_t sz;
+} wh_Packet_she_rnd_dma_req;
+
+typedef struct WOLFHSM_PACK wh_Packet_she_rnd_dma_res
+{
+    uint32_t status;
+} wh_Packet_she_rnd_dma_res;
+
 typedef struct WOLFHSM_PACK wh_Packet_she_extend_seed_req
 {
     uint8_t entropy[WOLFHSM_SHE_KEY_SZ];
@@ -471,6 +694,40 @@ typedef struct WOLFHSM_PACK wh_Packet_she_verify_mac_res
 {
     uint8_t status;
 } wh_Packet_she_verify_mac_res;
+
+/* Streaming ECB and CBC.  The server keeps the key schedule and the CBC chain
+ * between updates until the stream is finalized */
+enum {
+    WH_SHE_CIPHER_STREAM_INIT = 0,
+    WH_SHE_CIPHER_STREAM_UPDATE = 1,
+    WH_SHE_CIPHER_STREAM_UPDATE_DMA = 2,
+    WH_SHE_CIPHER_STREAM_FINAL = 3,
+};
+
+typedef struct WOLFHSM_PACK wh_Packet_she_cipher_stream_req
+{
+    uint64_t in;        /* update dma: client addresses of in and out */
+    uint64_t out;
+    uint32_t op;        /* WH_SHE_CIPHER_STREAM_* */
+    uint32_t sz;        /* update: whole blocks only */
+    uint8_t keyId;      /* init only */
+    uint8_t mode;       /* init: WOLFHSM_SHE_CIPHER_ECB or _CBC */
+    uint8_t enc;        /* init: 1 to encrypt, 0 to decrypt */
+    uint8_t iv[WOLFHSM_SHE_KEY_SZ];     /* init of a CBC stream */
+    /* update: in[sz] */
+} wh_Packet_she_cipher_stream_req;
+
+/* Largest whole number of blocks an update request can carry */
+#define WOLFHSM_PACKET_SHE_CIPHER_STREAM_MAX_SZ                         \
+    ((WH_COMM_DATA_LEN - WOLFHSM_PACKET_STUB_SIZE -                     \
+        sizeof(wh_Packet_she_cipher_stream_req)) &                      \
+        ~(WOLFHSM_SHE_KEY_SZ - 1))
+
+typedef struct WOLFHSM_PACK wh_Packet_she_cipher_stream_res
+{
+    uint32_t sz;
+    /* update: out[sz] */
+} wh_Packet_she_cipher_stream_res;
 #endif
 
 /* use packed structs so we can read a packet in directly */
@@ -489,6 +746,14 @@ typedef struct WOLFHSM_PACK whPacket
         wh_Packet_cipher_aescbc_req cipherAesCbcReq;
         /* AES GCM */
         wh_Packet_cipher_aesgcm_req cipherAesGcmReq;
+        /* cipher session */
+        wh_Packet_cipher_session_req cipherSessionReq;
+        /* hash session */
+        wh_Packet_hash_session_req hashSessionReq;
+        /* cipher dma */
+        wh_Packet_cipher_dma_req cipherDmaReq;
+        /* image verify */
+        wh_Packet_image_verify_req imageVerifyReq;
         /* pk */
         wh_Packet_pk_any_req pkAnyReq;
         /* RSA */
@@ -500,6 +765,7 @@ typedef struct WOLFHSM_PACK whPacket
         wh_Packet_pk_ecdh_req pkEcdhReq;
         wh_Packet_pk_ecc_sign_req pkEccSignReq;
         wh_Packet_pk_ecc_verify_req pkEccVerifyReq;
+        wh_Packet_pk_ecc_verify_batch_req pkEccVerifyBatchReq;
         wh_Packet_pk_ecc_check_req pkEccCheckReq;
         /* curve25519 */
         wh_Packet_pk_curve25519kg_req pkCurve25519kgReq;
@@ -516,17 +782,28 @@ typedef struct WOLFHSM_PACK whPacket
         wh_Packet_key_evict_req keyEvictReq;
         /* key commit */
         wh_Packet_key_commit_req keyCommitReq;
+        wh_Packet_key_commit_many_req keyCommitManyReq;
         /* key export */
         wh_Packet_key_export_req keyExportReq;
         /* key erase */
         wh_Packet_key_erase_req keyEraseReq;
 
         /* FIXED SIZE RESPONSES */
+        /* job accepted */
+        wh_Packet_job_res jobRes;
         /* cipher */
         /* AES CBC */
         wh_Packet_cipher_aescbc_res cipherAesCbcRes;
         /* AES GCM */
         wh_Packet_cipher_aesgcm_res cipherAesGcmRes;
+        /* cipher session */
+        wh_Packet_cipher_session_res cipherSessionRes;
+        /* hash session */
+        wh_Packet_hash_session_res hashSessionRes;
+        /* cipher dma */
+        wh_Packet_cipher_dma_res cipherDmaRes;
+        /* image verify */
+        wh_Packet_image_verify_res imageVerifyRes;
         /* pk */
         /* RSA */
         wh_Packet_pk_rsakg_res pkRsakgRes;
@@ -537,6 +814,7 @@ typedef struct WOLFHSM_PACK whPacket
         wh_Packet_pk_ecdh_res pkEcdhRes;
         wh_Packet_pk_ecc_sign_res pkEccSignRes;
         wh_Packet_pk_ecc_verify_res pkEccVerifyRes;
+        wh_Packet_pk_ecc_verify_batch_res pkEccVerifyBatchRes;
         wh_Packet_pk_ecc_check_res pkEccCheckRes;
         /* rng */
         wh_Packet_rng_res rngRes;
@@ -548,6 +826,7 @@ typedef struct WOLFHSM_PACK whPacket
         wh_Packet_key_evict_res keyEvictRes;
         /* key commit */
         wh_Packet_key_commit_res keyCommitRes;
+        wh_Packet_key_commit_many_res keyCommitManyRes;
         /* key export */
         wh_Packet_key_export_res keyExportRes;
         /* key erase */
@@ -560,13 +839,21 @@ typedef struct WOLFHSM_PACK whPacket
         wh_Packet_she_secure_boot_update_req sheSecureBootUpdateReq;
         wh_Packet_she_secure_boot_update_res sheSecureBootUpdateRes;
         wh_Packet_she_secure_boot_finish_res sheSecureBootFinishRes;
+        wh_Packet_she_secure_boot_dma_req sheSecureBootDmaReq;
+        wh_Packet_she_secure_boot_dma_res sheSecureBootDmaRes;
         wh_Packet_she_get_status_res sheGetStatusRes;
         wh_Packet_she_load_key_req sheLoadKeyReq;
         wh_Packet_she_load_key_res sheLoadKeyRes;
+        wh_Packet_she_load_key_batch_req sheLoadKeyBatchReq;
+        wh_Packet_she_load_key_batch_res sheLoadKeyBatchRes;
         wh_Packet_she_load_plain_key_req sheLoadPlainKeyReq;
         wh_Packet_she_export_ram_key_res sheExportRamKeyRes;
         wh_Packet_she_init_rng_res sheInitRngRes;
         wh_Packet_she_rnd_res sheRndRes;
+        wh_Packet_she_rnd_bulk_req sheRndBulkReq;
+        wh_Packet_she_rnd_bulk_res sheRndBulkRes;
+        wh_Packet_she_rnd_dma_req sheRndDmaReq;
+        wh_Packet_she_rnd_dma_res sheRndDmaRes;
         wh_Packet_she_extend_seed_req sheExtendSeedReq;
         wh_Packet_she_extend_seed_res sheExtendSeedRes;
         wh_Packet_she_enc_ecb_req sheEncEcbReq;
@@ -581,6 +868,8 @@ typedef struct WOLFHSM_PACK whPacket
         wh_Packet_she_gen_mac_res sheGenMacRes;
         wh_Packet_she_verify_mac_req sheVerifyMacReq;
         wh_Packet_she_verify_mac_res sheVerifyMacRes;
+        wh_Packet_she_cipher_stream_req sheCipherStreamReq;
+        wh_Packet_she_cipher_stream_res sheCipherStreamRes;
 #endif
     };
 } whPacket;
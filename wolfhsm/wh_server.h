@@ -31,6 +31,9 @@
 #include "wolfhsm/wh_common.h"
 #include "wolfhsm/wh_comm.h"
 #include "wolfhsm/wh_nvm.h"
+#include "wolfhsm/wh_counter.h"
+#include "wolfhsm/wh_message.h"
+#include "wolfhsm/wh_message_comm.h"
 #include "wolfhsm/wh_message_customcb.h"
 
 #ifndef WOLFHSM_NO_CRYPTO
@@ -40,6 +43,10 @@
 #include "wolfssl/wolfcrypt/ecc.h"
 #include "wolfssl/wolfcrypt/curve25519.h"
 #include "wolfssl/wolfcrypt/cryptocb.h"
+#include "wolfssl/wolfcrypt/sha256.h"
+#include "wolfssl/wolfcrypt/sha512.h"
+#include "wolfssl/wolfcrypt/hmac.h"
+#include "wolfssl/wolfcrypt/cmac.h"
 #endif  /* WOLFHSM_NO_CRYPTO */
 
 /* Forward declaration of the server structure so its elements can reference
@@ -50,12 +57,79 @@ typedef struct whServerContext_t whServerContext;
 /** Server crypto context and resource allocation */
 typedef struct CacheSlot {
     uint8_t commited;
+    uint8_t pinned;             /* Set from WOLFHSM_NVM_FLAGS_PINNED */
+    uint8_t slab;               /* Size class of buffer */
+    uint8_t padding[1];
+    uint32_t lastUse;           /* Cache tick of the last access */
     whNvmMetadata meta[1];
-    uint8_t buffer[WOLFHSM_KEYCACHE_BUFSIZE];
+    uint8_t* buffer;            /* Block in the key cache arena or NULL */
 } CacheSlot;
 
+#if WOLFHSM_NUM_DECODED_KEYS > 0
+/* Decoded key types */
+enum {
+    WH_DECODED_KEY_NONE = 0,
+    WH_DECODED_KEY_RSA = 1,
+    WH_DECODED_KEY_ECC = 2,
+    WH_DECODED_KEY_AES = 3,
+};
+
+/* Parsed form of a cached key, valid until its cache slot changes */
+typedef struct {
+    union {
+#ifndef NO_RSA
+        RsaKey rsa[1];
+#endif
+#ifdef HAVE_ECC
+        ecc_key ecc[1];
+#endif
+#if !defined(NO_AES) && defined(WOLFHSM_SYMMETRIC_INTERNAL)
+        Aes aes[1];
+#endif
+        uint8_t none;
+    } key;
+    uint32_t lastUse;           /* Cache tick of the last access */
+    int param;                  /* ECC curve id or AES mode of the key */
+    int16_t slot;               /* Source cache slot, -1 once stale */
+    uint8_t type;               /* WH_DECODED_KEY_* */
+    uint8_t refs;               /* Users in the current request */
+} whServerDecodedKey;
+#endif
+
+/* Key id map dimensions, a bit per key id for each client */
+#define WH_SERVER_KEYID_MAP_USERS ((WOLFHSM_KEYUSER_MASK >> 8) + 1)
+#define WH_SERVER_KEYID_MAP_WORDS ((WOLFHSM_KEYID_MASK + 1) / 32)
+
+/* Key cache counters.  Misses are lookups that had to go to NVM */
+typedef struct {
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t evictions;
+} whServerKeyCacheStats;
+
+/* Operations a crypto engine can run.  CMAC counts as AES */
+enum {
+    WH_SERVER_ENGINE_CAP_AES    = 0x01,
+    WH_SERVER_ENGINE_CAP_HASH   = 0x02, /* SHA-2 and HMAC */
+    WH_SERVER_ENGINE_CAP_PK     = 0x04, /* RSA, ECC and Curve25519 */
+};
+
+/* Returns nonzero while the engine can not start another operation */
+typedef int (*whServerCryptoEngineBusyCb)(void* context);
+
+/* A hardware crypto device registered with wolfCrypt under devId */
+typedef struct {
+    whServerCryptoEngineBusyCb busy;    /* Optional, NULL if never busy */
+    void* busy_context;
+    int devId;
+    uint32_t caps;                      /* WH_SERVER_ENGINE_CAP_* */
+} whServerCryptoEngine;
+
 typedef struct {
     int devId;
+    uint16_t engineCount;
+    uint16_t engineNext;        /* Engine tried first by the next operation */
+    const whServerCryptoEngine* engines;
     Aes aes[1];
     RsaKey rsa[1];
     ecc_key eccPrivate[1];
@@ -65,7 +139,109 @@ typedef struct {
     WC_RNG rng[1];
 } crypto_context;
 
+/* Maximum number of streaming cipher sessions open at once.  0 disables
+ * cipher sessions */
+#ifndef WOLFHSM_SERVER_MAX_CIPHER_SESSIONS
+#define WOLFHSM_SERVER_MAX_CIPHER_SESSIONS 2
+#endif
+
+#if !defined(NO_AES) && WOLFHSM_SERVER_MAX_CIPHER_SESSIONS > 0
+/* AES state carried between the requests of a cipher session */
+typedef struct {
+    Aes aes[1];
+    whCommServer* comm;         /* Endpoint of the client owning the session */
+    uint32_t type;              /* WC_CIPHER_AES_CBC or WC_CIPHER_AES_GCM */
+    uint16_t id;                /* 0 when free */
+    uint8_t enc;
+    uint8_t padding[1];
+} whServerCipherSession;
+#endif
+
+/* Maximum number of streaming hash, HMAC and CMAC sessions open at once.  0
+ * disables hash sessions */
+#ifndef WOLFHSM_SERVER_MAX_HASH_SESSIONS
+#define WOLFHSM_SERVER_MAX_HASH_SESSIONS 2
+#endif
+
+/* Bytes of client memory an image verify maps and hashes at a time.  The next
+ * chunk is mapped before the current one is hashed, so a DMA callback that
+ * copies can start fetching it early */
+#ifndef WOLFHSM_SERVER_IMAGE_CHUNK_SZ
+#define WOLFHSM_SERVER_IMAGE_CHUNK_SZ 1024
+#endif
+
+/* Random bytes kept ready for RNG requests, refilled while the server is idle.
+ * Should be a multiple of 8.  0 disables the pool */
+#ifndef WOLFHSM_SERVER_RNG_POOL_SIZE
+#define WOLFHSM_SERVER_RNG_POOL_SIZE 256
+#endif
+
+/* Random bytes generated into the pool per idle pass */
+#ifndef WOLFHSM_SERVER_RNG_POOL_REFILL
+#define WOLFHSM_SERVER_RNG_POOL_REFILL 64
+#endif
+
+#if WOLFHSM_SERVER_MAX_HASH_SESSIONS > 0
+/* Hash or MAC state carried between the requests of a hash session */
+typedef struct {
+    union {
+#ifndef NO_SHA256
+        wc_Sha256 sha256[1];
+#endif
+#ifdef WOLFSSL_SHA384
+        wc_Sha384 sha384[1];
+#endif
+#ifndef NO_HMAC
+        Hmac hmac[1];
+#endif
+#if defined(WOLFSSL_CMAC) && !defined(NO_AES)
+        Cmac cmac[1];
+#endif
+        uint64_t align;
+    } state;
+    whCommServer* comm;         /* Endpoint of the client owning the session */
+    uint32_t type;              /* WH_HASH_SESSION_SHA256 etc */
+    uint16_t id;                /* 0 when free */
+    uint8_t padding[2];
+} whServerHashSession;
+#endif
+
 #ifdef WOLFHSM_SHE_EXTENSION
+/* Number of SHE key derivations kept for reuse by key loading.  0 disables
+ * the cache */
+#ifndef WOLFHSM_SHE_KDF_CACHE_COUNT
+#define WOLFHSM_SHE_KDF_CACHE_COUNT 4
+#endif
+
+#if WOLFHSM_SHE_KDF_CACHE_COUNT > 0
+/* One AES-MP(key | constant) result, plus the compression of key alone which
+ * every constant derived from the same key starts from */
+typedef struct {
+    whKeyId id;                 /* Slot of the source key, 0 when free */
+    uint8_t padding[6];
+    uint8_t key[WOLFHSM_SHE_KEY_SZ];
+    uint8_t chain[WOLFHSM_SHE_KEY_SZ];
+    uint8_t constant[WOLFHSM_SHE_KEY_SZ];
+    uint8_t out[WOLFHSM_SHE_KEY_SZ];
+} whSheKdfCacheEntry;
+#endif
+
+/* Number of SHE keys whose initialized CMAC is kept for MAC generate and
+ * verify.  0 disables the cache */
+#ifndef WOLFHSM_SHE_CMAC_CACHE_COUNT
+#define WOLFHSM_SHE_CMAC_CACHE_COUNT 4
+#endif
+
+#if WOLFHSM_SHE_CMAC_CACHE_COUNT > 0
+/* CMAC with the key schedule and subkeys done, copied for each message */
+typedef struct {
+    Cmac cmac[1];
+    whKeyId id;                 /* Slot of the key, 0 when free */
+    uint8_t padding[6];
+    uint8_t key[WOLFHSM_SHE_KEY_SZ];
+} whSheCmacCacheEntry;
+#endif
+
 typedef struct {
     uint8_t sbState;
     uint8_t cmacKeyFound;
@@ -77,6 +253,20 @@ typedef struct {
     uint8_t prngState[WOLFHSM_SHE_KEY_SZ];
     uint8_t prngKey[WOLFHSM_SHE_KEY_SZ];
     uint8_t uid[WOLFHSM_SHE_UID_SZ];
+    uint8_t cipherMode;         /* WOLFHSM_SHE_CIPHER_*, 0 with no stream */
+    uint8_t cipherEnc;
+    uint8_t padding[7];
+    whCommServer* cipherComm;   /* Endpoint of the client owning the stream */
+#if WOLFHSM_SHE_KDF_CACHE_COUNT > 0
+    whSheKdfCacheEntry kdfCache[WOLFHSM_SHE_KDF_CACHE_COUNT];
+    uint32_t kdfNext;           /* Next entry to replace */
+    uint8_t padding2[4];
+#endif
+#if WOLFHSM_SHE_CMAC_CACHE_COUNT > 0
+    whSheCmacCacheEntry cmacCache[WOLFHSM_SHE_CMAC_CACHE_COUNT];
+    uint32_t cmacNext;          /* Next entry to replace */
+    uint8_t padding3[4];
+#endif
 } she_context;
 #endif
 #endif  /* WOLFHSM_NO_CRYPTO */
@@ -90,10 +280,100 @@ typedef int (*whServerCustomCb)(
     whMessageCustomCb_Response*      resp /* response from callback to client */
 );
 
+/* Type definition for a raw custom server callback.  req_data points at
+ * req_size payload bytes in the comm or fragment reassembly buffer, and the
+ * response payload is written to resp_data, which may be the same address.
+ * inout_resp_size holds the room available on entry and must be set to the
+ * bytes written.  The return value is passed to the client as rc */
+typedef int (*whServerCustomRawCb)(
+    whServerContext* server,    /* points to dispatching server ctx */
+    uint32_t id,                /* identifier the callback was registered as */
+    uint32_t type,              /* user-defined type from the request */
+    const uint8_t* req_data, uint16_t req_size,
+    uint8_t* resp_data, uint16_t* inout_resp_size
+);
+
+/* Maximum number of raw custom callbacks, registered under any id */
+#ifndef WOLFHSM_SERVER_MAX_CUSTOM_CBS
+#define WOLFHSM_SERVER_MAX_CUSTOM_CBS 16
+#endif
+
+/* Raw custom callback registered under id */
+typedef struct {
+    whServerCustomRawCb cb;
+    uint32_t id;
+    uint8_t padding[4];
+} whServerCustomRawEntry;
+
+
+/** Server message handlers */
+
+/* Handle a request of the given group and action.  The request is in
+ * req_packet and the response is written to resp_packet, which may be the same
+ * buffer with room for WH_COMM_DATA_LEN bytes.  A nonzero return drops the
+ * request without a response */
+typedef int (*whServerHandlerCb)(whServerContext* server,
+        uint16_t magic, uint16_t action, uint16_t seq,
+        uint16_t req_size, const void* req_packet,
+        uint16_t* out_resp_size, void* resp_packet);
+
+/* Number of group handler table entries, indexed by WH_MESSAGE_GROUP_INDEX */
+#define WH_SERVER_GROUP_COUNT \
+    (WH_MESSAGE_GROUP_INDEX(WH_MESSAGE_GROUP_CUSTOM) + 1)
+
+/* Maximum number of per-kind handler overrides.  0 disables overrides */
+#ifndef WOLFHSM_SERVER_MAX_HANDLERS
+#define WOLFHSM_SERVER_MAX_HANDLERS 4
+#endif
+
+/* Handler override for a single message kind */
+typedef struct {
+    whServerHandlerCb cb;
+    uint16_t kind;
+    uint8_t padding[6];
+} whServerHandler;
+
+
+/** Server request statistics.  Define WOLFHSM_SERVER_STATS to enable */
+#ifdef WOLFHSM_SERVER_STATS
+
+/* Number of distinct message kinds tracked.  Further kinds are accumulated
+ * into a single entry with kind WH_MESSAGE_KIND_NONE */
+#ifndef WOLFHSM_SERVER_STATS_COUNT
+#define WOLFHSM_SERVER_STATS_COUNT 32
+#endif
+
+/* Return a monotonic timestamp, such as microseconds.  Without a callback
+ * only the request counts and sizes are tracked */
+typedef uint64_t (*whServerTimeCb)(void* context);
+
+typedef struct {
+    uint64_t time_total;
+    uint32_t count;
+    uint32_t bytes_in;
+    uint32_t bytes_out;
+    uint32_t time_min;
+    uint32_t time_max;
+    uint32_t hist[WH_MESSAGE_COMM_STATS_HIST_BINS];
+    uint16_t kind;
+    uint8_t padding[2];
+} whServerStatsEntry;
+
+#endif /* WOLFHSM_SERVER_STATS */
+
 
 /** Server DMA address translation and validation */
 
+/* Regions in each of the read and write allowlists */
+#ifndef WH_DMA_ADDR_ALLOWLIST_COUNT
 #define WH_DMA_ADDR_ALLOWLIST_COUNT (10)
+#endif
+
+/* Clients with their own last matched allowlist region, by client id modulo
+ * the count.  Must be even to keep whServerDmaContext padding free */
+#ifndef WH_DMA_ADDR_ALLOWLIST_CACHE_CLIENTS
+#define WH_DMA_ADDR_ALLOWLIST_CACHE_CLIENTS (4)
+#endif
 
 /* Indicates to a DMA callback the type of memory operation the callback must
  * act on. Common use cases are remapping client addresses into server address
@@ -138,6 +418,22 @@ typedef struct {
 
 typedef whServerDmaAddr whServerDmaAddrList[WH_DMA_ADDR_ALLOWLIST_COUNT];
 
+/* Most client buffers in one scatter-gather list */
+#ifndef WH_DMA_SG_MAX_ENTRIES
+#define WH_DMA_SG_MAX_ENTRIES (16)
+#endif
+
+/* One client buffer of a scatter-gather list, as a client address */
+typedef struct {
+    uint64_t clientAddr;
+    uint64_t len;
+} whServerDmaSgEntry;
+
+/* Called on each buffer of a scatter-gather list once it is mapped into the
+ * server.  A nonzero return stops the walk */
+typedef int (*whServerDmaSgCb)(struct whServerContext_t* server,
+                               void* context, void* serverPtr, size_t len);
+
 /* Holds allowable client read/write addresses */
 typedef struct {
     whServerDmaAddrList readList;  /* Allowed client read addresses */
@@ -151,49 +447,211 @@ typedef struct {
     const whServerDmaAddrAllowList* dmaAddrAllowList; /* allowed addresses */
 } whServerDmaConfig;
 
+/* Allowlist regions merged into disjoint intervals sorted by address.  Built
+ * when the allowlist is registered so each check is a binary search */
+typedef struct {
+    uintptr_t start[WH_DMA_ADDR_ALLOWLIST_COUNT];
+    uintptr_t end[WH_DMA_ADDR_ALLOWLIST_COUNT];   /* One past the region */
+    size_t count;
+} whServerDmaAddrIndex;
+
+/* Client buffers that may stay mapped between requests */
+#ifndef WH_DMA_MAP_COUNT
+#define WH_DMA_MAP_COUNT (4)
+#endif
+
+/* A client buffer processed once by the DMA callbacks and reused by every
+ * operation of its owner that falls within it */
+typedef struct {
+    uint64_t clientAddr;
+    uint64_t len;
+    void* serverPtr;
+    uint16_t owner;         /* Client id + 1, 0 when free */
+    uint16_t generation;    /* Changed on unmap so stale handles fail */
+    uint8_t access;         /* WH_DMA_MAP_* */
+    uint8_t padding[3];
+} whServerDmaMapping;
+
 typedef struct {
     whServerDmaClientMem32Cb        cb32; /* DMA callback for 32-bit system */
     whServerDmaClientMem64Cb        cb64; /* DMA callback for 64-bit system */
     const whServerDmaAddrAllowList* dmaAddrAllowList; /* allowed addresses */
+    whServerDmaAddrIndex readIndex;
+    whServerDmaAddrIndex writeIndex;
+    whServerDmaMapping maps[WH_DMA_MAP_COUNT];
+    /* Interval + 1 of the last read and write match of each client */
+    uint16_t lastHit[WH_DMA_ADDR_ALLOWLIST_CACHE_CLIENTS][2];
 } whServerDmaContext;
 
 
 /** Server config and context */
 
+/* Maximum number of comm endpoints served by one server context */
+#ifndef WOLFHSM_SERVER_MAX_COMMS
+#define WOLFHSM_SERVER_MAX_COMMS 1
+#endif
+
 typedef struct whServerConfig_t {
+    /* Array of comm_count endpoint configs. comm_count 0 is treated as 1 */
     whCommServerConfig* comm_config;
+    /* Optional per-endpoint priority.  Higher priority endpoints are polled
+     * first and equal priorities are served round-robin */
+    const uint8_t* comm_priority;
     whNvmContext* nvm;
+    /* Optional monotonic counter store, already initialized */
+    whCounterContext* counter;
 
 #ifndef WOLFHSM_NO_CRYPTO
     crypto_context* crypto;
 #ifdef WOLFHSM_SHE_EXTENSION
     she_context* she;
 #endif
+    /* Optional list of full key ids, including the client id, to load into
+     * the cache and pin during init.  Keys committed with
+     * WOLFHSM_NVM_FLAGS_PINNED are preloaded as well */
+    const whKeyId* preload_keys;
+    /* Optional key cache slots each client may hold, indexed by client id
+     * with WH_SERVER_KEYID_MAP_USERS entries.  A client with a quota only
+     * evicts its own keys once it reaches the quota, and its keys are never
+     * evicted by other clients.  0 leaves a client unlimited and its keys
+     * evictable by anyone.  Pinned and preloaded keys count toward it */
+    const uint8_t* key_quota;
 #if defined WOLF_CRYPTO_CB /* TODO: should we be relying on wolfSSL defines? */
     int devId;
+    /* Optional array of engine_count crypto engines.  When given, each
+     * operation goes to the next idle engine able to run it, or to software
+     * when they are all busy, and devId is not used */
+    const whServerCryptoEngine* engines;
 #endif
 #endif  /* WOLFHSM_NO_CRYPTO */
     whServerDmaConfig* dmaConfig;
+#ifdef WOLFHSM_SERVER_STATS
+    whServerTimeCb time_cb;
+    void* time_context;
+#endif
+    uint16_t comm_count;
+#ifndef WOLFHSM_NO_CRYPTO
+    uint16_t preload_count;
+    uint16_t engine_count;
+    uint8_t padding[2];
+#else
+    uint8_t padding[6];
+#endif
 } whServerConfig;
 
+/* Maximum number of long-running jobs in progress.  0 disables jobs */
+#ifndef WOLFHSM_SERVER_MAX_JOBS
+#define WOLFHSM_SERVER_MAX_JOBS 2
+#endif
+
+/* Bytes of state and result held by each job */
+#ifndef WOLFHSM_SERVER_JOB_BUFSIZE
+#define WOLFHSM_SERVER_JOB_BUFSIZE 256
+#endif
+
+/* Advance a job by one slice.  buffer holds the state given at start and, on
+ * completion, the result data of *out_size bytes.  Return WH_ERROR_NOTREADY to
+ * be called again, or the result code to complete the job */
+typedef int (*whServerJobCb)(whServerContext* server, uint8_t* buffer,
+        uint16_t* out_size);
+
+typedef enum {
+    WH_SERVER_JOB_FREE = 0,
+    WH_SERVER_JOB_RUNNING = 1,
+    WH_SERVER_JOB_DONE = 2,
+} whServerJobState;
+
+typedef struct {
+    uint64_t buffer[(WOLFHSM_SERVER_JOB_BUFSIZE + 7) / 8];
+    whServerJobCb cb;
+    whCommServer* comm;         /* Endpoint of the client owning the job */
+    int32_t rc;
+    uint16_t id;
+    uint16_t kind;              /* Message kind of the original request */
+    uint16_t size;              /* Result size once done */
+    uint8_t state;              /* whServerJobState */
+    uint8_t padding[5];
+} whServerJob;
+
+/* Comm endpoint state */
+typedef struct {
+    whCommServer comm[1];
+    whServerContext* server;    /* Back pointer for the connect callback */
+    int connected;
+    uint8_t priority;
+    uint8_t next;               /* Round-robin offset within the priority */
+    uint8_t padding[2];
+} whServerEndpoint;
 
 /* Context structure to maintain the state of an HSM server */
 struct whServerContext_t {
-    whCommServer comm[1];
+    whCommServer* comm;         /* Endpoint of the current request */
     whNvmContext* nvm;
+    whCounterContext* counter;
 #ifndef WOLFHSM_NO_CRYPTO
     crypto_context* crypto;
+    const uint8_t* keyQuota;    /* Per client cache slots or NULL */
     CacheSlot cache[WOLFHSM_NUM_RAMKEYS];
+    /* Key id to cache slot + 1, open addressed.  0 marks an empty entry */
+    uint16_t cacheIndex[WOLFHSM_KEYCACHE_INDEX_SIZE];
+    uint8_t cacheArena[WOLFHSM_KEYCACHE_ARENA_SIZE];
+    /* Blocks of each size class handed out at least once */
+    uint16_t slabUsed[WOLFHSM_KEYCACHE_SLAB_CLASSES];
+    /* Free list head of each size class as block + 1, 0 when empty */
+    uint16_t slabFree[WOLFHSM_KEYCACHE_SLAB_CLASSES];
+#if WOLFHSM_NUM_DECODED_KEYS > 0
+    whServerDecodedKey decoded[WOLFHSM_NUM_DECODED_KEYS];
+#endif
+    /* Crypto key ids of each client that are cached or committed */
+    uint32_t keyIdMap[WH_SERVER_KEYID_MAP_USERS][WH_SERVER_KEYID_MAP_WORDS];
+    uint32_t cacheTick;         /* Advances on every cache access */
+    whServerKeyCacheStats cacheStats;
+#if !defined(NO_AES) && WOLFHSM_SERVER_MAX_CIPHER_SESSIONS > 0
+    whServerCipherSession cipherSession[WOLFHSM_SERVER_MAX_CIPHER_SESSIONS];
+#endif
+#if WOLFHSM_SERVER_MAX_HASH_SESSIONS > 0
+    whServerHashSession hashSession[WOLFHSM_SERVER_MAX_HASH_SESSIONS];
+#endif
+#if !defined(WC_NO_RNG) && WOLFHSM_SERVER_RNG_POOL_SIZE > 0
+    /* The first rngPoolLen bytes are unused random bytes, taken from the end */
+    uint8_t rngPool[WOLFHSM_SERVER_RNG_POOL_SIZE];
+#endif
 #ifdef WOLFHSM_SHE_EXTENSION
     she_context* she;
 #endif
 #endif  /* WOLFHSM_NO_CRYPTO */
     whServerCustomCb customHandlerTable[WH_CUSTOM_CB_NUM_CALLBACKS];
+#if WOLFHSM_SERVER_MAX_CUSTOM_CBS > 0
+    /* Sparse, unordered table of raw callbacks by id */
+    whServerCustomRawEntry customRawTable[WOLFHSM_SERVER_MAX_CUSTOM_CBS];
+#endif
+    /* Group handlers, NULL for unsupported groups */
+    whServerHandlerCb handler[WH_SERVER_GROUP_COUNT];
+#if WOLFHSM_SERVER_MAX_HANDLERS > 0
+    whServerHandler override[WOLFHSM_SERVER_MAX_HANDLERS];
+#endif
     whServerDmaContext dma;
-    int connected;
-#ifdef WOLFHSM_SHE_EXTENSION
+#ifdef WOLFHSM_SERVER_STATS
+    whServerTimeCb time_cb;
+    void* time_context;
+    /* Open addressed by message kind */
+    whServerStatsEntry stats[WOLFHSM_SERVER_STATS_COUNT];
+    whServerStatsEntry stats_other;
 #endif
-    uint8_t padding[4];
+    /* Endpoints sorted by descending priority */
+    whServerEndpoint endpoint[WOLFHSM_SERVER_MAX_COMMS];
+#if WOLFHSM_SERVER_MAX_JOBS > 0
+    whServerJob job[WOLFHSM_SERVER_MAX_JOBS];
+#endif
+    uint32_t override_groups;   /* Bit per group index with overrides */
+    uint16_t endpoint_count;
+    uint16_t job_seq;           /* Last job id handed out */
+    uint16_t job_next;          /* Next job to advance */
+    uint16_t cipher_seq;        /* Last cipher session id handed out */
+    uint16_t hash_seq;          /* Last hash session id handed out */
+    uint16_t rngPoolLen;        /* Unused bytes at the start of rngPool */
+    uint16_t nvm_stream_owner;  /* Client id + 1 of an open NVM stream */
+    uint8_t padding[6];
 };
 
 
@@ -204,19 +662,23 @@ struct whServerContext_t {
  */
 int wh_Server_Init(whServerContext* server, whServerConfig* config);
 
-/* Allow an external input to set the connected state. */
+/* Allow an external input to set the connected state of every endpoint. */
 int wh_Server_SetConnected(whServerContext *server, whCommConnected connected);
 
 /* Invoke SetConnected but using an untyped context pointer, suitable for a
  * CommServer callback */
 int wh_Server_SetConnectedCb(void* s, whCommConnected connected);
 
-/* Return the connected state. */
+/* Return the connected state.  Connected if any endpoint is connected. */
 int wh_Server_GetConnected(whServerContext *server,
                             whCommConnected *out_connected);
 
 /*
- * Receive and handle an incoming request message if present.
+ * Receive and handle an incoming request message if present.  With several
+ * endpoints, at most one request is handled per call, taken from the first
+ * connected endpoint with a pending request in priority then round-robin
+ * order.  One slice of a running job is then advanced, so jobs progress
+ * between requests.  Returns WH_ERROR_NOTREADY only if there was no work.
  */
 int wh_Server_HandleRequestMessage(whServerContext* server);
 
@@ -225,6 +687,34 @@ int wh_Server_HandleRequestMessage(whServerContext* server);
  */
 int wh_Server_Cleanup(whServerContext* server);
 
+/** Server message handler functions */
+
+/* Set the handler for every action of a message group, replacing the built-in
+ * handler.  A NULL cb disables the group, so its requests get an empty
+ * response.  Built-in groups may be compiled out with
+ * WOLFHSM_SERVER_NO_GROUP_<NVM|KEY|CRYPTO|PKCS11|SHE|CUSTOM> */
+int wh_Server_RegisterGroupHandler(whServerContext* server, uint16_t group,
+        whServerHandlerCb cb);
+
+/* Set a handler for a single message kind that takes precedence over the
+ * group handler.  A NULL cb removes the override.  Returns WH_ERROR_NOSPACE if
+ * WOLFHSM_SERVER_MAX_HANDLERS overrides are already registered */
+int wh_Server_RegisterHandler(whServerContext* server, uint16_t kind,
+        whServerHandlerCb cb);
+
+#ifdef WOLFHSM_SERVER_STATS
+/** Server request statistics functions */
+
+/* Copy statistics entry index to out_entry.  Used entries are numbered from 0
+ * and the untracked entry, if used, is last.  Returns WH_ERROR_NOTFOUND past
+ * the last entry */
+int wh_Server_StatsGet(whServerContext* server, uint16_t index,
+        whServerStatsEntry* out_entry);
+
+/* Clear all statistics entries */
+int wh_Server_StatsReset(whServerContext* server);
+#endif /* WOLFHSM_SERVER_STATS */
+
 /** Server custom callback functions */
 
 /* Registers a custom callback with the server
@@ -233,6 +723,13 @@ int wh_Server_RegisterCustomCb( whServerContext* server,
                                 uint16_t actionId,
                                 whServerCustomCb cb);
 
+/* Registers a raw custom callback under any id, replacing a callback already
+ * registered under it.  A NULL cb removes the callback.  Returns
+ * WH_ERROR_NOSPACE if WOLFHSM_SERVER_MAX_CUSTOM_CBS ids are already registered
+ */
+int wh_Server_RegisterCustomRawCb(whServerContext* server, uint32_t id,
+                                  whServerCustomRawCb cb);
+
 /* Receive and handle an incoming custom callback request
 */
 int wh_Server_HandleCustomCbRequest(whServerContext* server, uint16_t magic,
@@ -249,10 +746,13 @@ int wh_Server_DmaRegisterCb32(struct whServerContext_t* server,
                               whServerDmaClientMem32Cb  cb);
 int wh_Server_DmaRegisterCb64(struct whServerContext_t* server,
                               whServerDmaClientMem64Cb  cb);
+/* Registers the allowed addresses.  The lists are indexed into the server, so
+ * later changes to allowlist do not apply until it is registered again */
 int wh_Server_DmaRegisterAllowList(struct whServerContext_t*       server,
                                    const whServerDmaAddrAllowList* allowlist);
 
-/* Checks a desired memory operation against the server allowlist */
+/* Checks a desired memory operation against the server allowlist.  An
+ * operation must lie within one region, or regions that overlap or touch */
 int wh_Server_DmaCheckMemOperAllowed(const struct whServerContext_t* server,
                                      whServerDmaOper oper, void* addr,
                                      size_t size);
@@ -266,6 +766,12 @@ int wh_Server_DmaProcessClientAddress64(struct whServerContext_t* server,
                                         uint64_t clientAddr, void** serverPtr,
                                         uint64_t len, whServerDmaOper oper,
                                         whServerDmaFlags flags);
+/* Uses the 32-bit callback when it is the only one registered, else the
+ * 64-bit path */
+int wh_Server_DmaProcessClientAddress(struct whServerContext_t* server,
+                                      uint64_t clientAddr, void** serverPtr,
+                                      uint64_t len, whServerDmaOper oper,
+                                      whServerDmaFlags flags);
 
 /* Helper functions to copy data to/from client addresses that invoke the
  * appropriate callbacks and allowlist checks */
@@ -283,4 +789,42 @@ int whServerDma_CopyToClient64(struct whServerContext_t* server,
                                uint64_t clientAddr, void* serverPtr, size_t len,
                                whServerDmaFlags flags);
 
+/* Map len bytes at clientAddr for the current client with access, a mask of
+ * WH_DMA_MAP_*.  The PRE operations of each access are processed now, and
+ * later operations of the client within the buffer use the mapped pointer
+ * without callbacks or allowlist checks.  The callbacks must return a pointer
+ * that aliases client memory until the matching POST operations, which are
+ * processed when the buffer is unmapped */
+int wh_Server_DmaMapClientAddress(struct whServerContext_t* server,
+                                  uint64_t clientAddr, uint64_t len,
+                                  uint8_t access, uint32_t* out_handle);
+/* Unmap a buffer of the current client.  WH_ERROR_NOTFOUND for a stale or
+ * unknown handle and WH_ERROR_ACCESS for a buffer of another client */
+int wh_Server_DmaUnmapClientAddress(struct whServerContext_t* server,
+                                    uint32_t handle);
+/* Unmap every buffer of client_id, which has closed or disconnected */
+void wh_Server_DmaUnmapClient(struct whServerContext_t* server,
+                              uint8_t client_id);
+/* Unmap every buffer of every client */
+void wh_Server_DmaUnmapAll(struct whServerContext_t* server);
+
+/* Walk a scatter-gather list in order.  Each buffer is processed for
+ * oper, a READ_PRE or WRITE_PRE operation, which checks it against the
+ * allowlist, then passed to cb, then processed for the matching POST */
+int wh_Server_DmaProcessClientSg(struct whServerContext_t* server,
+                                 const whServerDmaSgEntry* sg, uint16_t count,
+                                 whServerDmaOper oper, whServerDmaFlags flags,
+                                 whServerDmaSgCb cb, void* context);
+
+/* Gather the client buffers of sg into len bytes at serverPtr, or scatter
+ * len bytes from serverPtr into them.  The buffers must total len */
+int whServerDma_CopyFromClientSg(struct whServerContext_t* server,
+                                 void* serverPtr, size_t len,
+                                 const whServerDmaSgEntry* sg, uint16_t count,
+                                 whServerDmaFlags flags);
+int whServerDma_CopyToClientSg(struct whServerContext_t* server,
+                               const whServerDmaSgEntry* sg, uint16_t count,
+                               void* serverPtr, size_t len,
+                               whServerDmaFlags flags);
+
 #endif /* WOLFHSM_WH_SERVER_H_ */
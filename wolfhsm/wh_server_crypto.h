@@ -24,5 +24,33 @@
 int wh_Server_HandleCryptoRequest(whServerContext* server, uint16_t action,
     uint8_t* data, uint16_t* size);
 
+#ifndef WOLFHSM_SERVER_NO_GROUP_IMAGE
+/* WH_MESSAGE_GROUP_IMAGE requests, processed in place like the crypto ones */
+int wh_Server_HandleImageRequest(whServerContext* server, uint16_t action,
+    uint8_t* data, uint16_t* size);
+#endif
+
+/* devId for the next operation needing the WH_SERVER_ENGINE_CAP_* bits in cap.
+ * Configured engines are tried round-robin, skipping busy ones, and
+ * INVALID_DEVID runs the operation in software when none is free.  Without
+ * engines this is the server devId */
+int wh_Server_CryptoDevId(whServerContext* server, uint32_t cap);
+
+#if !defined(NO_AES) && WOLFHSM_SERVER_MAX_CIPHER_SESSIONS > 0
+/* Close every open cipher session */
+void wh_Server_CipherSessionFlush(whServerContext* server);
+#endif
+
+#if !defined(WC_NO_RNG) && WOLFHSM_SERVER_RNG_POOL_SIZE > 0
+/* Generate up to WOLFHSM_SERVER_RNG_POOL_REFILL bytes into the random pool.
+ * Returns WH_ERROR_NOTREADY when the pool is already full */
+int wh_Server_CryptoRngPoolRefill(whServerContext* server);
+#endif
+
+#if WOLFHSM_SERVER_MAX_HASH_SESSIONS > 0
+/* Close every open hash session */
+void wh_Server_HashSessionFlush(whServerContext* server);
+#endif
+
 
 #endif
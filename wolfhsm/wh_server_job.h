@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef WOLFHSM_WH_SERVER_JOB_H_
+#define WOLFHSM_WH_SERVER_JOB_H_
+
+/*
+ * WolfHSM Internal Server API
+ *
+ * Long-running requests may be accepted as jobs.  The handler starts a job
+ * and answers right away with the job id, then the server advances one slice
+ * of a running job after each call to wh_Server_HandleRequestMessage.  The
+ * owning client polls the result with the COMM JOB action, which releases the
+ * job once it is done.
+ */
+
+#include <stdint.h>
+
+#include "wolfhsm/wh_server.h"
+
+#if WOLFHSM_SERVER_MAX_JOBS > 0
+
+/* Start a job for the client of the current request.  state_size bytes of
+ * state are copied into the job buffer for cb.  Returns WH_ERROR_NOSPACE if
+ * every job is in use, so the caller may run the request synchronously */
+int wh_Server_JobStart(whServerContext* server, whServerJobCb cb,
+        uint16_t kind, uint16_t state_size, const void* state,
+        uint16_t* out_id);
+
+/* Advance one slice of the next running job.  Returns WH_ERROR_NOTREADY if no
+ * job is running */
+int wh_Server_JobStep(whServerContext* server);
+
+/* Handle a COMM JOB request and generate a response
+ * Defined in server_job.c */
+int wh_Server_HandleJobRequest(whServerContext* server,
+        uint16_t magic, uint16_t req_size, const void* req_packet,
+        uint16_t *out_resp_size, void* resp_packet);
+
+#endif /* WOLFHSM_SERVER_MAX_JOBS > 0 */
+
+#endif /* WOLFHSM_WH_SERVER_JOB_H_ */
@@ -22,14 +22,41 @@
 #include "wolfhsm/wh_server.h"
 
 int hsmGetUniqueId(whServerContext* server, whNvmId* outId);
-int hsmCacheFindSlot(whServerContext* server);
+/* Rebuild the key id map from the cache and NVM */
+int hsmKeyIdMapBuild(whServerContext* server);
+int hsmCacheFindSlot(whServerContext* server, uint32_t size);
+/* Index a slot from hsmCacheFindSlot after setting its meta->id */
+int hsmCacheIndexSlot(whServerContext* server, int slotIdx);
 int hsmCacheKey(whServerContext* server, whNvmMetadata* meta, uint8_t* in);
 int hsmFreshenKey(whServerContext* server, whKeyId keyId);
+/* Load and pin the listed keys, which carry their client id, then every
+ * committed key flagged WOLFHSM_NVM_FLAGS_PINNED.  Keys are still loaded
+ * after a failure, the first error is returned */
+int hsmPreloadKeys(whServerContext* server, uint16_t count,
+    const whKeyId* keyIds);
 int hsmReadKey(whServerContext* server, whKeyId keyId, whNvmMetadata* outMeta,
     uint8_t* out, uint32_t* outSz);
 int hsmEvictKey(whServerContext* server, uint16_t keyId);
 int hsmCommitKey(whServerContext* server, uint16_t keyId);
+/* Commit several cached keys with a single NVM batch.  Duplicate ids are
+ * committed once */
+int hsmCommitKeys(whServerContext* server, uint16_t count,
+    const whKeyId* keyIds);
 int hsmEraseKey(whServerContext* server, whNvmId keyId);
+#if !defined(WOLFHSM_NO_CRYPTO) && WOLFHSM_NUM_DECODED_KEYS > 0
+/* Return the decoded key of a cache slot with a reference held, or NULL.
+ * param tells apart forms of one key, the ECC curve or the AES mode */
+whServerDecodedKey* hsmDecodedKeyFind(whServerContext* server, int slotIdx,
+    uint8_t type, int param);
+/* Claim an entry to decode a cache slot into, or NULL if all are in use.  The
+ * caller sets type once the key is decoded */
+whServerDecodedKey* hsmDecodedKeyAlloc(whServerContext* server, int slotIdx,
+    int param);
+/* Drop the reference on a decoded key, returns NOTFOUND if key isn't one */
+int hsmDecodedKeyRelease(whServerContext* server, const void* key);
+/* Free every decoded key */
+void hsmDecodedKeyFlush(whServerContext* server);
+#endif
 int wh_Server_HandleKeyRequest(whServerContext* server, uint16_t magic,
     uint16_t action, uint16_t seq, uint8_t* data, uint16_t* size);
 
@@ -35,4 +35,8 @@ int wh_Server_HandleNvmRequest(whServerContext* server,
         uint16_t req_size, const void* req_packet,
         uint16_t *out_resp_size, void* resp_packet);
 
+/* Abort an NVM AddObject stream left open by client_id, which has closed or
+ * disconnected.  Streams owned by other clients are left alone. */
+void wh_Server_NvmStreamAbort(whServerContext* server, uint8_t client_id);
+
 #endif /* WOLFHSM_WH_SERVER_NVM_H_ */
@@ -27,4 +27,9 @@ typedef struct {
 
 int wh_Server_HandleSheRequest(whServerContext* server,
     uint16_t action, uint8_t* data, uint16_t* size);
+/* Close any open cipher stream, called from wh_Server_Cleanup */
+void wh_Server_SheCipherFlush(whServerContext* server);
+/* Wipe the cached key derivations and CMAC contexts, called from
+ * wh_Server_Cleanup */
+void wh_Server_SheCacheFlush(whServerContext* server);
 #endif
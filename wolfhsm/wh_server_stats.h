@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef WOLFHSM_WH_SERVER_STATS_H_
+#define WOLFHSM_WH_SERVER_STATS_H_
+
+/*
+ * WolfHSM Internal Server API
+ *
+ * Per message kind request statistics, updated as each request is handled
+ * and read by clients with the COMM STATS action.
+ */
+
+#include <stdint.h>
+
+#include "wolfhsm/wh_server.h"
+
+#ifdef WOLFHSM_SERVER_STATS
+
+/* Return the current time from the server time callback, or 0 */
+uint64_t wh_Server_StatsTime(whServerContext* server);
+
+/* Account one handled request of the given kind */
+void wh_Server_StatsRecord(whServerContext* server, uint16_t kind,
+        uint16_t req_size, uint16_t resp_size, uint64_t elapsed);
+
+/* Handle a COMM STATS request and generate a response
+ * Defined in server_stats.c */
+int wh_Server_HandleStatsRequest(whServerContext* server,
+        uint16_t magic, uint16_t req_size, const void* req_packet,
+        uint16_t *out_resp_size, void* resp_packet);
+
+#endif /* WOLFHSM_SERVER_STATS */
+
+#endif /* WOLFHSM_WH_SERVER_STATS_H_ */
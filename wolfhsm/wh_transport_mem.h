@@ -89,24 +89,21 @@
  * whCommServer cs[1] = {0};
  * wh_CommServer_Init(cs, csc);
  *
+ * In-place mode
+ * Setting in_place in the shared config makes both sides use the request data
+ * region for the response as well, and exposes it through GetBuffer so the
+ * CommClient and CommServer build and parse packets directly in shared memory
+ * without any bulk copy.  The response buffer then only carries its CSR.  The
+ * request buffer must hold a full WH_COMM_MTU packet, both sides must agree on
+ * the setting, and the client must not touch its data buffer between sending a
+ * request and receiving the response.
+ *
  */
 
 #include <stdint.h>
 
 #include "wolfhsm/wh_comm.h"
 
-/** Common configuration structure */
-typedef struct {
-    void* req;
-    void* resp;
-    uint16_t req_size;
-    uint16_t resp_size;
-    uint8_t padding[4];
-} whTransportMemConfig;
-
-
-/** Common context */
-
 /* Memory buffer control/status layout.  Data buffer follows immediately */
 typedef union whTransportMemCsr_t {
     uint64_t u64;
@@ -118,11 +115,44 @@ typedef union whTransportMemCsr_t {
     } s;
 } whTransportMemCsr;
 
+/* Optional doorbell hooks
+ * Before sleeping, a receiver increments the wait field of its own CSR.  A
+ * sender that publishes a new notify and finds the peer's wait count ahead of
+ * its own ack copies it to ack and rings the doorbell on its own CSR.
+ *
+ * Wait is called when a receive finds nothing new.  It may block until the
+ * notify field of csr differs from seen, the peer rings, or a bounded timeout
+ * expires.  Notify wakes a peer blocked on csr.  Both return 0 on success.
+ */
+typedef int (*whTransportMemNotifyCb)(void* arg,
+        volatile whTransportMemCsr* csr);
+typedef int (*whTransportMemWaitCb)(void* arg,
+        volatile whTransportMemCsr* csr, whTransportMemCsr seen);
+
+/** Common configuration structure */
+typedef struct {
+    void* req;
+    void* resp;
+    uint16_t req_size;
+    uint16_t resp_size;
+    uint8_t in_place;   /* Opt: Share the request data region. See above */
+    uint8_t padding[3];
+    whTransportMemNotifyCb notify_cb;   /* Opt: Ring the peer */
+    whTransportMemWaitCb wait_cb;       /* Opt: Sleep instead of polling */
+    void* notify_arg;
+} whTransportMemConfig;
+
+
+/** Common context */
+
 typedef struct {
     volatile whTransportMemCsr* req;
     volatile whTransportMemCsr* resp;
     void* req_data;
     void* resp_data;
+    whTransportMemNotifyCb notify_cb;
+    whTransportMemWaitCb wait_cb;
+    void* notify_arg;
     int initialized;
     uint16_t req_size;
     uint16_t resp_size;
@@ -138,7 +168,10 @@ int wh_TransportMem_Init(void* c, const void* cf,
 int wh_TransportMem_InitClear(void* c, const void* cf,
         whCommSetConnectedCb connectcb, void* connectcb_arg);
 int wh_TransportMem_Cleanup(void* c);
+uint8_t* wh_TransportMem_GetBuffer(void* c);
 int wh_TransportMem_SendRequest(void* c, uint16_t len, const void* data);
+int wh_TransportMem_SendRequestV(void* c, uint16_t iov_count,
+        const whCommIov* iov);
 int wh_TransportMem_RecvRequest(void* c, uint16_t *out_len, void* data);
 int wh_TransportMem_SendResponse(void* c, uint16_t len, const void* data);
 int wh_TransportMem_RecvResponse(void* c, uint16_t *out_len, void* data);
@@ -147,7 +180,9 @@ int wh_TransportMem_RecvResponse(void* c, uint16_t *out_len, void* data);
 {                                               \
     .Init =     wh_TransportMem_InitClear,      \
     .Send =     wh_TransportMem_SendRequest,    \
+    .SendV =    wh_TransportMem_SendRequestV,   \
     .Recv =     wh_TransportMem_RecvResponse,   \
+    .GetBuffer = wh_TransportMem_GetBuffer,     \
     .Cleanup =  wh_TransportMem_Cleanup,        \
 }
 
@@ -156,6 +191,7 @@ int wh_TransportMem_RecvResponse(void* c, uint16_t *out_len, void* data);
     .Init =     wh_TransportMem_Init,           \
     .Recv =     wh_TransportMem_RecvRequest,    \
     .Send =     wh_TransportMem_SendResponse,   \
+    .GetBuffer = wh_TransportMem_GetBuffer,     \
     .Cleanup =  wh_TransportMem_Cleanup,        \
 }
 
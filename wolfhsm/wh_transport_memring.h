@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * wolfhsm/wh_transport_memring.h
+ *
+ * wolfHSM Transport binding using 2 memory blocks split into rings of slots
+ */
+
+#ifndef WH_TRANSPORT_MEMRING_H_
+#define WH_TRANSPORT_MEMRING_H_
+
+/* Memory ring comms
+ * Like the memory block transport, client and server share a request and a
+ * response buffer.  The top 64-bits of each buffer are a control and status
+ * register whose notify field is the ring head: the total number of entries
+ * produced into that buffer.  The remainder of each buffer is split into
+ * slot_count fixed-size slots, each of which starts with its own 64-bit CSR
+ * holding the length of the data that follows.
+ *
+ * Request slot N is answered in response slot N, so the client may have up to
+ * slot_count requests outstanding and the server can drain them back to back.
+ * slot_count must be a power of 2 so slot indexes stay contiguous when the
+ * 16-bit heads wrap.
+ *
+ * The client sends a request by:
+ *  1. Check for a free slot: req->notify - resp_tail < slot_count
+ *  2. Write request data to slot req->notify % slot_count
+ *  3. Increment the request head: req->notify++
+ *
+ * The client receives the oldest response by:
+ *  1. Check for a new response: resp->notify != resp_tail
+ *  2. Read response data from slot resp_tail % slot_count
+ *  3. Increment the local tail: resp_tail++
+ *
+ * The server handles the oldest request by:
+ *  1. Check for new request: req->notify != resp->notify
+ *  2. Read request data from slot resp->notify % slot_count
+ *
+ * The server sends a response by:
+ *  1. Write response data to slot resp->notify % slot_count
+ *  2. Increment the response head: resp->notify++
+ *
+ *
+ * Example usage:
+ *
+ * uint8_t req_buffer[4 * 1024];
+ * uint8_t resp_buffer[4 * 1024];
+ *
+ * whTransportMemRingConfig tmrcfg[1] = {{
+ *      .req = req_buffer,
+ *      .req_size = sizeof(req_buffer),
+ *      .resp = resp_buffer
+ *      .resp_size = sizeof(resp_buffer),
+ *      .slot_count = 4,
+ * }};
+ *
+ * whTransportClientCb tmrccb[1] = {WH_TRANSPORT_MEMRING_CLIENT_CB};
+ * whTransportMemRingClientContext tmrcc[1] = {0};
+ * whCommClientConfig ccc[1] = {{
+ *      .transport_cb = tmrccb,
+ *      .transport_context = tmrcc,
+ *      .transport_config = tmrcfg,
+ *      .client_id = 1234,
+ * }};
+ *
+ * whTransportServerCb tmrscb[1] = {WH_TRANSPORT_MEMRING_SERVER_CB};
+ * whTransportMemRingServerContext tmrsc[1] = {0};
+ * whCommServerConfig csc[1] = {{
+ *      .transport_cb = tmrscb,
+ *      .transport_context = tmrsc,
+ *      .transport_config = tmrcfg,
+ *      .server_id = 5678,
+ * }};
+ *
+ */
+
+#include <stdint.h>
+
+#include "wolfhsm/wh_comm.h"
+#include "wolfhsm/wh_transport_mem.h"
+
+/** Common configuration structure */
+typedef struct {
+    void* req;
+    void* resp;
+    uint16_t req_size;
+    uint16_t resp_size;
+    uint16_t slot_count;    /* Power of 2 */
+    uint8_t padding[2];
+} whTransportMemRingConfig;
+
+
+/** Common context */
+typedef struct {
+    volatile whTransportMemCsr* req;
+    volatile whTransportMemCsr* resp;
+    uint8_t* req_slots;
+    uint8_t* resp_slots;
+    int initialized;
+    uint16_t slot_count;
+    uint16_t slot_size;     /* Bytes per slot, including the slot CSR */
+    uint16_t resp_tail;     /* Client only. Next response to receive */
+    uint8_t padding[6];
+} whTransportMemRingContext;
+
+/* Naming conveniences. Reuses the same types. */
+typedef whTransportMemRingContext whTransportMemRingClientContext;
+typedef whTransportMemRingContext whTransportMemRingServerContext;
+
+/** Callback function declarations */
+int wh_TransportMemRing_Init(void* c, const void* cf,
+        whCommSetConnectedCb connectcb, void* connectcb_arg);
+int wh_TransportMemRing_InitClear(void* c, const void* cf,
+        whCommSetConnectedCb connectcb, void* connectcb_arg);
+int wh_TransportMemRing_Cleanup(void* c);
+int wh_TransportMemRing_SendRequest(void* c, uint16_t len, const void* data);
+int wh_TransportMemRing_SendRequestV(void* c, uint16_t iov_count,
+        const whCommIov* iov);
+int wh_TransportMemRing_RecvRequest(void* c, uint16_t *out_len, void* data);
+int wh_TransportMemRing_SendResponse(void* c, uint16_t len, const void* data);
+int wh_TransportMemRing_RecvResponse(void* c, uint16_t *out_len, void* data);
+
+#define WH_TRANSPORT_MEMRING_CLIENT_CB              \
+{                                                   \
+    .Init =     wh_TransportMemRing_InitClear,      \
+    .Send =     wh_TransportMemRing_SendRequest,    \
+    .SendV =    wh_TransportMemRing_SendRequestV,   \
+    .Recv =     wh_TransportMemRing_RecvResponse,   \
+    .Cleanup =  wh_TransportMemRing_Cleanup,        \
+}
+
+#define WH_TRANSPORT_MEMRING_SERVER_CB              \
+{                                                   \
+    .Init =     wh_TransportMemRing_Init,           \
+    .Recv =     wh_TransportMemRing_RecvRequest,    \
+    .Send =     wh_TransportMemRing_SendResponse,   \
+    .Cleanup =  wh_TransportMemRing_Cleanup,        \
+}
+
+
+#endif /* WH_TRANSPORT_MEMRING_H_ */